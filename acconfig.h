@@ -39,6 +39,10 @@
 
 #undef REALLOC_0_WORKS
 
+#undef G_ATOMIC_GCC_BUILTINS
+#undef G_ATOMIC_GCC_SYNC
+#undef G_ATOMIC_I486
+#undef G_ATOMIC_X86_64
 #undef G_COMPILED_WITH_DEBUGGING
 #undef G_THREADS_ENABLED
 
@@ -64,6 +68,7 @@
 #undef HAVE_SYS_TIMES_H
 #undef HAVE_STRERROR
 #undef HAVE_STRSIGNAL
+#undef HAVE_TLS
 #undef HAVE_UNISTD_H
 #undef HAVE_VALUES_H
 #undef HAVE_WCHAR_H
@@ -0,0 +1,132 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+static guint bench_repeats = 5;
+static gboolean bench_quick_mode = FALSE;
+static guint32 bench_seed = 12345;
+
+void
+bench_init (gint    *argc,
+	    gchar ***argv)
+{
+  gint i, j;
+
+  for (i = 1, j = 1; i < *argc; i++)
+    {
+      gchar *arg = (*argv)[i];
+
+      if (strcmp (arg, "--quick") == 0)
+	bench_quick_mode = TRUE;
+      else if (strncmp (arg, "--repeats=", 10) == 0 && atoi (arg + 10) > 0)
+	bench_repeats = atoi (arg + 10);
+      else
+	(*argv)[j++] = arg;
+    }
+  *argc = j;
+
+  printf ("# benchmark\tvariant\tsize\tops\tbest_sec\tmedian_sec\tmedian_ns_per_op\n");
+  fflush (stdout);
+}
+
+gboolean
+bench_quick (void)
+{
+  return bench_quick_mode;
+}
+
+guint32
+bench_random (void)
+{
+  bench_seed = bench_seed * 1103515245 + 12345;
+
+  return bench_seed;
+}
+
+static gint
+compare_seconds (const void *a,
+		 const void *b)
+{
+  const gdouble *da = a;
+  const gdouble *db = b;
+
+  return *da < *db ? -1 : *da > *db;
+}
+
+void
+bench_run (const gchar	*benchmark,
+	   const gchar	*variant,
+	   gulong	 size,
+	   BenchFunc	 setup,
+	   BenchRunFunc	 run,
+	   BenchFunc	 teardown,
+	   gpointer	 data)
+{
+  gdouble *seconds;
+  gdouble median;
+  GTimer *timer;
+  gulong ops = 0;
+  guint i;
+
+  seconds = g_new (gdouble, bench_repeats);
+  timer = g_timer_new ();
+
+  for (i = 0; i < bench_repeats; i++)
+    {
+      if (setup)
+	setup (data);
+      g_timer_start (timer);
+      ops = run (data);
+      g_timer_stop (timer);
+      seconds[i] = g_timer_elapsed (timer, NULL);
+      if (teardown)
+	teardown (data);
+    }
+
+  qsort (seconds, bench_repeats, sizeof (gdouble), compare_seconds);
+  if (bench_repeats % 2)
+    median = seconds[bench_repeats / 2];
+  else
+    median = (seconds[bench_repeats / 2 - 1] + seconds[bench_repeats / 2]) / 2;
+
+  printf ("%s\t%s\t%lu\t%lu\t%.6f\t%.6f\t%.1f\n",
+	  benchmark, variant, size, ops, seconds[0], median,
+	  ops > 0 ? median * 1e9 / ops : 0.0);
+  fflush (stdout);
+
+  g_timer_destroy (timer);
+  g_free (seconds);
+}
@@ -0,0 +1,58 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "glib.h"
+
+/* Every measurement is run a number of times (5 by default, set with
+ * --repeats=N) and reported as one tab separated line:
+ *
+ *   benchmark  variant  size  ops  best_sec  median_sec  median_ns_per_op
+ *
+ * preceded by a header line starting with '#'. Only run() is timed;
+ * setup() and teardown(), which may be NULL, run before and after
+ * each repetition. With --quick, the benchmarks use smaller sizes.
+ */
+typedef void	(*BenchFunc)	(gpointer data);
+typedef gulong	(*BenchRunFunc)	(gpointer data);
+
+void		bench_init	(gint		*argc,
+				 gchar	      ***argv);
+gboolean	bench_quick	(void);
+void		bench_run	(const gchar	*benchmark,
+				 const gchar	*variant,
+				 gulong		 size,
+				 BenchFunc	 setup,
+				 BenchRunFunc	 run,
+				 BenchFunc	 teardown,
+				 gpointer	 data);
+
+/* a fixed pseudo random sequence, so runs are repeatable */
+guint32		bench_random	(void);
+
+#endif /* __BENCH_H__ */
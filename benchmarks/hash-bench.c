@@ -0,0 +1,304 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+/* GHashTable and GTree behind one interface, so both run the same
+ * insert, lookup and remove benchmarks on the same keys
+ */
+typedef struct _Container Container;
+typedef struct _Run	  Run;
+
+struct _Container
+{
+  const gchar *name;
+  gboolean     string_keys;
+  gpointer   (*new)	(void);
+  void	     (*insert)	(gpointer c, gpointer key);
+  gpointer   (*lookup)	(gpointer c, gpointer key);
+  void	     (*remove)	(gpointer c, gpointer key);
+  void	     (*destroy)	(gpointer c);
+};
+
+struct _Run
+{
+  Container *container;
+  gpointer  *keys;
+  gulong     n_keys;
+  gpointer  *instances;
+  guint	     n_instances;
+};
+
+static gint
+compare_int_keys (gconstpointer a,
+		  gconstpointer b)
+{
+  guint ka = GPOINTER_TO_UINT (a);
+  guint kb = GPOINTER_TO_UINT (b);
+
+  return ka < kb ? -1 : ka > kb;
+}
+
+static gint
+compare_str_keys (gconstpointer a,
+		  gconstpointer b)
+{
+  return strcmp (a, b);
+}
+
+static gpointer
+hash_new (void)
+{
+  return g_hash_table_new (NULL, NULL);
+}
+
+static gpointer
+hash_str_new (void)
+{
+  return g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+static void
+hash_insert (gpointer c,
+	     gpointer key)
+{
+  g_hash_table_insert (c, key, key);
+}
+
+static gpointer
+hash_lookup (gpointer c,
+	     gpointer key)
+{
+  return g_hash_table_lookup (c, key);
+}
+
+static void
+hash_remove (gpointer c,
+	     gpointer key)
+{
+  g_hash_table_remove (c, key);
+}
+
+static void
+hash_destroy (gpointer c)
+{
+  g_hash_table_destroy (c);
+}
+
+static gpointer
+tree_new (void)
+{
+  return g_tree_new (compare_int_keys);
+}
+
+static gpointer
+tree_str_new (void)
+{
+  return g_tree_new (compare_str_keys);
+}
+
+static void
+tree_insert (gpointer c,
+	     gpointer key)
+{
+  g_tree_insert (c, key, key);
+}
+
+static gpointer
+tree_lookup (gpointer c,
+	     gpointer key)
+{
+  return g_tree_lookup (c, key);
+}
+
+static void
+tree_remove (gpointer c,
+	     gpointer key)
+{
+  g_tree_remove (c, key);
+}
+
+static void
+tree_destroy (gpointer c)
+{
+  g_tree_destroy (c);
+}
+
+static Container containers[] = {
+  { "hash",	FALSE, hash_new,     hash_insert, hash_lookup, hash_remove, hash_destroy },
+  { "hash-str", TRUE,  hash_str_new, hash_insert, hash_lookup, hash_remove, hash_destroy },
+  { "tree",	FALSE, tree_new,     tree_insert, tree_lookup, tree_remove, tree_destroy },
+  { "tree-str", TRUE,  tree_str_new, tree_insert, tree_lookup, tree_remove, tree_destroy },
+};
+
+/* about a million operations per repetition at every size; small
+ * containers are repeated in several instances
+ */
+#define OPS_PER_RUN 1000000
+
+static void
+setup_empty (gpointer data)
+{
+  Run *run = data;
+  guint i;
+
+  for (i = 0; i < run->n_instances; i++)
+    run->instances[i] = run->container->new ();
+}
+
+static void
+setup_filled (gpointer data)
+{
+  Run *run = data;
+  gulong k;
+  guint i;
+
+  setup_empty (data);
+  for (i = 0; i < run->n_instances; i++)
+    for (k = 0; k < run->n_keys; k++)
+      run->container->insert (run->instances[i], run->keys[k]);
+}
+
+static void
+teardown (gpointer data)
+{
+  Run *run = data;
+  guint i;
+
+  for (i = 0; i < run->n_instances; i++)
+    run->container->destroy (run->instances[i]);
+}
+
+static gulong
+run_insert (gpointer data)
+{
+  Run *run = data;
+  gulong k;
+  guint i;
+
+  for (i = 0; i < run->n_instances; i++)
+    for (k = 0; k < run->n_keys; k++)
+      run->container->insert (run->instances[i], run->keys[k]);
+
+  return run->n_instances * run->n_keys;
+}
+
+static gulong
+run_lookup (gpointer data)
+{
+  Run *run = data;
+  gulong k, n_found = 0;
+  guint i;
+
+  for (i = 0; i < run->n_instances; i++)
+    for (k = 0; k < run->n_keys; k++)
+      n_found += run->container->lookup (run->instances[i], run->keys[k]) != NULL;
+  g_assert (n_found == run->n_instances * run->n_keys);
+
+  return n_found;
+}
+
+static gulong
+run_remove (gpointer data)
+{
+  Run *run = data;
+  gulong k;
+  guint i;
+
+  for (i = 0; i < run->n_instances; i++)
+    for (k = 0; k < run->n_keys; k++)
+      run->container->remove (run->instances[i], run->keys[k]);
+
+  return run->n_instances * run->n_keys;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const gulong sizes[] = { 16, 1000, 100000, 1000000 };
+  gulong n_sizes = sizeof (sizes) / sizeof (sizes[0]);
+  gpointer *int_keys, *str_keys;
+  gulong max_keys, k;
+  guint c, s;
+
+  bench_init (&argc, &argv);
+  if (bench_quick ())
+    n_sizes--;
+  max_keys = sizes[n_sizes - 1];
+
+  /* distinct keys in a shuffled order */
+  int_keys = g_new (gpointer, max_keys);
+  str_keys = g_new (gpointer, max_keys);
+  for (k = 0; k < max_keys; k++)
+    int_keys[k] = GUINT_TO_POINTER (k + 1);
+  for (k = max_keys - 1; k > 0; k--)
+    {
+      gulong j = bench_random () % (k + 1);
+      gpointer tmp = int_keys[k];
+
+      int_keys[k] = int_keys[j];
+      int_keys[j] = tmp;
+    }
+  for (k = 0; k < max_keys; k++)
+    str_keys[k] = g_strdup_printf ("key-%u", GPOINTER_TO_UINT (int_keys[k]));
+
+  for (s = 0; s < n_sizes; s++)
+    for (c = 0; c < sizeof (containers) / sizeof (containers[0]); c++)
+      {
+	Run run;
+
+	run.container = &containers[c];
+	run.keys = containers[c].string_keys ? str_keys : int_keys;
+	run.n_keys = sizes[s];
+	run.n_instances = MAX (1, OPS_PER_RUN / sizes[s]);
+	run.instances = g_new (gpointer, run.n_instances);
+
+	bench_run ("insert", containers[c].name, sizes[s],
+		   setup_empty, run_insert, teardown, &run);
+	bench_run ("lookup", containers[c].name, sizes[s],
+		   setup_filled, run_lookup, teardown, &run);
+	bench_run ("remove", containers[c].name, sizes[s],
+		   setup_filled, run_remove, teardown, &run);
+
+	g_free (run.instances);
+      }
+
+  for (k = 0; k < max_keys; k++)
+    g_free (str_keys[k]);
+  g_free (str_keys);
+  g_free (int_keys);
+
+  return 0;
+}
@@ -0,0 +1,253 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "bench.h"
+
+#define N_ITERATIONS 20000
+
+typedef struct _LoopRun LoopRun;
+
+struct _LoopRun
+{
+  GMainPollBackend backend;
+  guint		   n;
+  gint		  *fds;
+  GIOChannel	 **channels;
+  guint		  *tags;
+  gulong	   n_dispatched;
+};
+
+static gboolean
+read_watch (GIOChannel   *channel,
+	    GIOCondition  condition,
+	    gpointer      data)
+{
+  LoopRun *run = data;
+  gchar buf[16];
+  guint n_read = 0;
+
+  g_io_channel_read (channel, buf, sizeof (buf), &n_read);
+  run->n_dispatched++;
+
+  return TRUE;
+}
+
+static gboolean
+count_source (gpointer data)
+{
+  LoopRun *run = data;
+
+  run->n_dispatched++;
+
+  return TRUE;
+}
+
+static gboolean
+never_fires (gpointer data)
+{
+  g_assert_not_reached ();
+
+  return FALSE;
+}
+
+static void
+io_setup (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  g_assert (g_main_set_poll_backend (run->backend));
+  run->fds = g_new (gint, 2 * run->n);
+  run->channels = g_new (GIOChannel*, run->n);
+  run->tags = g_new (guint, run->n);
+  for (i = 0; i < run->n; i++)
+    {
+      g_assert (pipe (run->fds + 2 * i) == 0);
+      run->channels[i] = g_io_channel_unix_new (run->fds[2 * i]);
+      run->tags[i] = g_io_add_watch (run->channels[i], G_IO_IN, read_watch, run);
+    }
+  run->n_dispatched = 0;
+}
+
+static void
+io_teardown (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  for (i = 0; i < run->n; i++)
+    {
+      g_source_remove (run->tags[i]);
+      g_io_channel_unref (run->channels[i]);
+      close (run->fds[2 * i]);
+      close (run->fds[2 * i + 1]);
+    }
+  g_free (run->fds);
+  g_free (run->channels);
+  g_free (run->tags);
+  g_main_set_poll_backend (G_MAIN_POLL_DEFAULT);
+}
+
+/* one descriptor of many gets ready per iteration */
+static gulong
+io_run (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  for (i = 0; i < N_ITERATIONS; i++)
+    {
+      g_assert (write (run->fds[2 * (i % run->n) + 1], "x", 1) == 1);
+      g_main_iteration (TRUE);
+    }
+  g_assert (run->n_dispatched == N_ITERATIONS);
+
+  return i;
+}
+
+static void
+timeouts_setup (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  run->tags = g_new (guint, run->n + 1);
+  for (i = 0; i < run->n; i++)
+    run->tags[i] = g_timeout_add (3600 * 1000, never_fires, run);
+  run->tags[i] = g_idle_add (count_source, run);
+  run->n_dispatched = 0;
+}
+
+static void
+dispatch_setup (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  run->tags = g_new (guint, run->n + 1);
+  for (i = 0; i < run->n; i++)
+    run->tags[i] = g_timeout_add (0, count_source, run);
+  run->tags[i] = 0;
+  run->n_dispatched = 0;
+}
+
+static void
+timeouts_teardown (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  for (i = 0; i <= run->n; i++)
+    if (run->tags[i])
+      g_source_remove (run->tags[i]);
+  g_free (run->tags);
+}
+
+/* idle iterations, while many timeouts are pending */
+static gulong
+timeouts_run (gpointer data)
+{
+  LoopRun *run = data;
+  guint i;
+
+  for (i = 0; i < N_ITERATIONS; i++)
+    g_main_iteration (FALSE);
+  g_assert (run->n_dispatched == N_ITERATIONS);
+
+  return i;
+}
+
+/* expired timeouts dispatched per second */
+static gulong
+dispatch_run (gpointer data)
+{
+  LoopRun *run = data;
+
+  while (run->n_dispatched < N_ITERATIONS)
+    g_main_iteration (TRUE);
+
+  return run->n_dispatched;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const struct {
+    const gchar *name;
+    GMainPollBackend backend;
+  } backends[] = {
+    { "poll",	G_MAIN_POLL_DEFAULT },
+    { "epoll",	G_MAIN_POLL_EPOLL },
+    { "kqueue", G_MAIN_POLL_KQUEUE },
+  };
+  static const guint n_fds[] = { 1, 16, 128, 256 };
+  static const guint n_timeouts[] = { 1, 64, 4096, 65536 };
+  guint n_sizes = 4;
+  LoopRun run;
+  guint b, s;
+
+  bench_init (&argc, &argv);
+  if (bench_quick ())
+    n_sizes--;
+
+  /* the size column is the number of descriptors or timeouts */
+  for (b = 0; b < sizeof (backends) / sizeof (backends[0]); b++)
+    {
+      if (!g_main_set_poll_backend (backends[b].backend))
+	continue;
+      g_main_set_poll_backend (G_MAIN_POLL_DEFAULT);
+
+      run.backend = backends[b].backend;
+      for (s = 0; s < n_sizes; s++)
+	{
+	  run.n = n_fds[s];
+	  bench_run ("io-watch", backends[b].name, run.n,
+		     io_setup, io_run, io_teardown, &run);
+	}
+    }
+
+  for (s = 0; s < n_sizes; s++)
+    {
+      run.n = n_timeouts[s];
+      bench_run ("timeouts-pending", "idle", run.n,
+		 timeouts_setup, timeouts_run, timeouts_teardown, &run);
+      bench_run ("timeouts-expired", "dispatch", run.n,
+		 dispatch_setup, dispatch_run, timeouts_teardown, &run);
+    }
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include "bench.h"
+
+#define BATCH		1000
+#define OPS_PER_RUN	1000000
+
+typedef struct _ChunkRun ChunkRun;
+typedef struct _ListRun	 ListRun;
+
+struct _ChunkRun
+{
+  gint	     type;		/* -1 for g_malloc() */
+  gint	     atom_size;
+  GMemChunk *chunk;
+  gpointer   atoms[BATCH];
+};
+
+struct _ListRun
+{
+  gboolean     slist;
+  guint	       n_threads;
+  GThreadPool *pool;
+};
+
+static void
+chunk_setup (gpointer data)
+{
+  ChunkRun *run = data;
+
+  if (run->type >= 0)
+    run->chunk = g_mem_chunk_new ("bench chunk", run->atom_size,
+				  run->atom_size * 256, run->type);
+}
+
+static void
+chunk_teardown (gpointer data)
+{
+  ChunkRun *run = data;
+
+  if (run->type >= 0)
+    g_mem_chunk_destroy (run->chunk);
+}
+
+/* allocates BATCH atoms and frees them again, until OPS_PER_RUN
+ * allocations; G_ALLOC_ONLY chunks are reset instead
+ */
+static gulong
+chunk_run (gpointer data)
+{
+  ChunkRun *run = data;
+  gulong n;
+  guint i;
+
+  for (n = 0; n < OPS_PER_RUN; n += BATCH)
+    {
+      if (run->type < 0)
+	{
+	  for (i = 0; i < BATCH; i++)
+	    run->atoms[i] = g_malloc (run->atom_size);
+	  for (i = 0; i < BATCH; i++)
+	    g_free (run->atoms[i]);
+	}
+      else
+	{
+	  for (i = 0; i < BATCH; i++)
+	    run->atoms[i] = g_mem_chunk_alloc (run->chunk);
+	  if (run->type == G_ALLOC_ONLY)
+	    g_mem_chunk_reset (run->chunk);
+	  else
+	    for (i = 0; i < BATCH; i++)
+	      g_mem_chunk_free (run->chunk, run->atoms[i]);
+	}
+    }
+
+  return n;
+}
+
+static void
+list_job (gpointer data,
+	  gpointer user_data)
+{
+  ListRun *run = user_data;
+  guint n_nodes = OPS_PER_RUN / run->n_threads;
+  guint n, i;
+
+  for (n = 0; n < n_nodes; n += BATCH)
+    {
+      if (run->slist)
+	{
+	  GSList *slist = NULL;
+
+	  for (i = 0; i < BATCH; i++)
+	    slist = g_slist_prepend (slist, data);
+	  g_slist_free (slist);
+	}
+      else
+	{
+	  GList *list = NULL;
+
+	  for (i = 0; i < BATCH; i++)
+	    list = g_list_prepend (list, data);
+	  g_list_free (list);
+	}
+    }
+}
+
+static void
+list_setup (gpointer data)
+{
+  ListRun *run = data;
+
+  run->pool = g_thread_pool_new (list_job, run, run->n_threads);
+}
+
+/* every thread allocates and frees its share of the nodes with the
+ * shared list allocator
+ */
+static gulong
+list_run (gpointer data)
+{
+  ListRun *run = data;
+  guint i;
+
+  for (i = 0; i < run->n_threads; i++)
+    g_thread_pool_push (run->pool, GUINT_TO_POINTER (i + 1));
+  g_thread_pool_free (run->pool, FALSE);
+
+  return OPS_PER_RUN / run->n_threads / BATCH * BATCH * run->n_threads;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const struct {
+    const gchar *name;
+    gint type;
+  } variants[] = {
+    { "g_malloc",	    -1 },
+    { "mem-chunk-only",	    G_ALLOC_ONLY },
+    { "mem-chunk",	    G_ALLOC_AND_FREE },
+    { "mem-chunk-slab",	    G_ALLOC_AND_FREE_SLAB },
+    { "mem-chunk-mt",	    G_ALLOC_AND_FREE_MT },
+  };
+  static const gint atom_sizes[] = { 16, 64, 256 };
+  guint v, s, n_threads, max_threads;
+
+  bench_init (&argc, &argv);
+
+#ifdef G_THREADS_ENABLED
+  g_thread_init (NULL);
+#endif
+  max_threads = g_thread_supported () ? (bench_quick () ? 4 : 8) : 1;
+
+  for (s = 0; s < sizeof (atom_sizes) / sizeof (atom_sizes[0]); s++)
+    for (v = 0; v < sizeof (variants) / sizeof (variants[0]); v++)
+      {
+	ChunkRun run;
+
+	run.type = variants[v].type;
+	run.atom_size = atom_sizes[s];
+	bench_run ("alloc-free", variants[v].name, atom_sizes[s],
+		   chunk_setup, chunk_run, chunk_teardown, &run);
+      }
+
+  /* the size column is the number of threads */
+  for (n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    for (v = 0; v < 2; v++)
+      {
+	ListRun run;
+
+	run.slist = v;
+	run.n_threads = n_threads;
+	bench_run ("list-threads", run.slist ? "gslist" : "glist", n_threads,
+		   list_setup, list_run, NULL, &run);
+      }
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "bench.h"
+
+typedef struct _ScanRun ScanRun;
+
+struct _ScanRun
+{
+  gint	       input;		/* 0 text, 1 file, 2 mmap */
+  gchar	      *file_name;
+  gchar	      *text;
+  gulong       text_len;
+  gint	       fd;
+  GScanner    *scanner;
+};
+
+static void
+scan_setup (gpointer data)
+{
+  ScanRun *run = data;
+
+  run->scanner = g_scanner_new (NULL);
+  if (run->input == 0)
+    g_scanner_input_text (run->scanner, run->text, run->text_len);
+  else
+    {
+      run->fd = open (run->file_name, O_RDONLY);
+      g_assert (run->fd >= 0);
+      if (run->input == 1)
+	g_scanner_input_file (run->scanner, run->fd);
+      else
+	g_scanner_input_mmap (run->scanner, run->fd);
+    }
+}
+
+static void
+scan_teardown (gpointer data)
+{
+  ScanRun *run = data;
+
+  g_scanner_destroy (run->scanner);
+  if (run->input != 0)
+    close (run->fd);
+}
+
+static gulong
+scan_run (gpointer data)
+{
+  ScanRun *run = data;
+  gulong n_tokens = 0;
+
+  while (g_scanner_get_next_token (run->scanner) != G_TOKEN_EOF)
+    n_tokens++;
+
+  return n_tokens;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const gchar *inputs[] = { "text", "file", "mmap" };
+  static const gulong sizes[] = { 65536, 1048576, 16777216 };
+  gulong n_sizes = sizeof (sizes) / sizeof (sizes[0]);
+  ScanRun run;
+  GString *text;
+  FILE *file;
+  guint s, i;
+
+  bench_init (&argc, &argv);
+  if (bench_quick ())
+    n_sizes--;
+
+  run.file_name = g_strdup_printf ("%s/scanner-bench-%d.txt",
+				   g_get_tmp_dir (), (gint) getpid ());
+
+  /* the size column is the input size in bytes */
+  for (s = 0; s < n_sizes; s++)
+    {
+      text = g_string_new (NULL);
+      for (i = 0; text->len < sizes[s]; i++)
+	g_string_sprintfa (text, "ident_%u = %u + 3.25 * (\"string %u\" - 0x%x); "
+			   "/* comment */\n", i, i * 7, i, i);
+
+      file = fopen (run.file_name, "w");
+      g_assert (file != NULL);
+      g_assert (fwrite (text->str, 1, text->len, file) == text->len);
+      fclose (file);
+
+      run.text = text->str;
+      run.text_len = text->len;
+      for (i = 0; i < sizeof (inputs) / sizeof (inputs[0]); i++)
+	{
+	  run.input = i;
+	  bench_run ("scanner", inputs[i], text->len,
+		     scan_setup, scan_run, scan_teardown, &run);
+	}
+      g_string_free (text, TRUE);
+    }
+
+  unlink (run.file_name);
+  g_free (run.file_name);
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include "bench.h"
+
+#define OPS_PER_RUN 1000000
+
+typedef struct _StringRun StringRun;
+
+struct _StringRun
+{
+  gulong length;		/* the strings are restarted at this length */
+  gint	 op;
+};
+
+enum
+{
+  OP_APPEND,
+  OP_APPEND_C,
+  OP_SPRINTFA,
+  OP_SPRINTF
+};
+
+static gulong
+string_run (gpointer data)
+{
+  StringRun *run = data;
+  GString *string;
+  gulong n;
+
+  string = g_string_new (NULL);
+  for (n = 0; n < OPS_PER_RUN; n++)
+    {
+      if (string->len >= run->length)
+	{
+	  g_string_free (string, TRUE);
+	  string = g_string_new (NULL);
+	}
+      switch (run->op)
+	{
+	case OP_APPEND:
+	  g_string_append (string, "abcdefgh");
+	  break;
+	case OP_APPEND_C:
+	  g_string_append_c (string, 'a');
+	  break;
+	case OP_SPRINTFA:
+	  g_string_sprintfa (string, "%lu:%s,", n, "item");
+	  break;
+	case OP_SPRINTF:
+	  g_string_sprintf (string, "%lu:%s,", n, "item");
+	  break;
+	}
+    }
+  g_string_free (string, TRUE);
+
+  return n;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  static const gchar *ops[] = { "append", "append_c", "sprintfa", "sprintf" };
+  static const gulong lengths[] = { 16, 256, 65536, 16777216 };
+  guint o, l;
+
+  bench_init (&argc, &argv);
+
+  /* the size column is the length the strings grow to */
+  for (o = 0; o < sizeof (ops) / sizeof (ops[0]); o++)
+    for (l = 0; l < sizeof (lengths) / sizeof (lengths[0]); l++)
+      {
+	StringRun run;
+
+	if (o == OP_SPRINTF && l > 0)
+	  break;
+	run.op = o;
+	run.length = lengths[l];
+	bench_run ("gstring", ops[o], lengths[l], NULL, string_run, NULL, &run);
+      }
+
+  return 0;
+}
@@ -51,6 +51,11 @@ struct _GRealArray
 static gint g_nearest_pow        (gint        num);
 static void g_array_maybe_expand (GRealArray *array,
 				  gint        len);
+static void g_array_maybe_shrink (GRealArray *array);
+static void g_array_sort_elts    (guint8       *base,
+				  guint         n_elts,
+				  guint         elt_size,
+				  GCompareFunc  compare_func);
 
 static GMemChunk *array_mem_chunk = NULL;
 G_LOCK_DEFINE_STATIC (array_mem_chunk);
@@ -183,6 +188,8 @@ g_array_remove_index (GArray* farray,
 
   array->len -= 1;
 
+  g_array_maybe_shrink (array);
+
   return farray;
 }
 
@@ -207,9 +214,75 @@ g_array_remove_index_fast (GArray* farray,
 
   array->len -= 1;
 
+  g_array_maybe_shrink (array);
+
   return farray;
 }
 
+void
+g_array_sort (GArray      *farray,
+	      GCompareFunc compare_func)
+{
+  GRealArray *array = (GRealArray*) farray;
+
+  g_return_if_fail (array);
+  g_return_if_fail (compare_func);
+
+  g_array_sort_elts (array->data, array->len, array->elt_size, compare_func);
+}
+
+gboolean
+g_array_binary_search (GArray       *farray,
+		       gconstpointer target,
+		       GCompareFunc  compare_func,
+		       guint        *index)
+{
+  GRealArray *array = (GRealArray*) farray;
+  guint lower, upper;
+
+  g_return_val_if_fail (array, FALSE);
+  g_return_val_if_fail (compare_func, FALSE);
+
+  /* find the first element not less than target, so that a miss
+   * yields the position target would have to be inserted at
+   */
+  lower = 0;
+  upper = array->len;
+  while (lower < upper)
+    {
+      guint mid = lower + (upper - lower) / 2;
+
+      if (compare_func (array->data + array->elt_size * mid, target) < 0)
+	lower = mid + 1;
+      else
+	upper = mid;
+    }
+
+  if (index)
+    *index = lower;
+
+  return (lower < array->len &&
+	  compare_func (array->data + array->elt_size * lower, target) == 0);
+}
+
+void
+g_array_shrink (GArray *farray)
+{
+  GRealArray *array = (GRealArray*) farray;
+  guint want_alloc;
+
+  g_return_if_fail (array);
+
+  want_alloc = (array->len + array->zero_terminated) * array->elt_size;
+  want_alloc = MAX (g_nearest_pow (want_alloc), MIN_ARRAY_SIZE);
+
+  if (want_alloc < array->alloc)
+    {
+      array->alloc = want_alloc;
+      array->data = g_realloc (array->data, array->alloc);
+    }
+}
+
 static gint
 g_nearest_pow (gint num)
 {
@@ -241,6 +314,201 @@ g_array_maybe_expand (GRealArray *array,
     }
 }
 
+/* Once a burst has passed and the array has drained to a quarter of
+ * its allocation, give half of it back.  Keeping the drained array at
+ * half (rather than exactly) full means alternating appends and
+ * removals around one size cannot realloc on every call.
+ */
+static void
+g_array_maybe_shrink (GRealArray *array)
+{
+  guint want_alloc = (array->len + array->zero_terminated) * array->elt_size;
+
+  if (array->alloc > MIN_ARRAY_SIZE && want_alloc <= array->alloc / 4)
+    {
+      array->alloc = MAX (array->alloc / 2, MIN_ARRAY_SIZE);
+      array->data = g_realloc (array->data, array->alloc);
+    }
+}
+
+/* Introsort: quicksort with a median of three pivot, falling back to
+ * heapsort once the recursion gets too deep and to insertion sort for
+ * short runs.  Elements of 4 and 8 bytes, which covers pointers and
+ * most scalar arrays, are swapped as integers instead of bytewise.
+ */
+#define G_ARRAY_SORT_THRESHOLD	16
+
+#define g_array_sort_elt(i)	(base + elt_size * (i))
+
+static inline void
+g_array_sort_swap (guint8 *a,
+		   guint8 *b,
+		   guint   elt_size)
+{
+  switch (elt_size)
+    {
+      guint32 t32;
+#ifdef G_HAVE_GINT64
+      guint64 t64;
+#endif
+
+    case 4:
+      t32 = *(guint32*) a;
+      *(guint32*) a = *(guint32*) b;
+      *(guint32*) b = t32;
+      break;
+#ifdef G_HAVE_GINT64
+    case 8:
+      t64 = *(guint64*) a;
+      *(guint64*) a = *(guint64*) b;
+      *(guint64*) b = t64;
+      break;
+#endif
+    default:
+      while (elt_size--)
+	{
+	  guint8 t = *a;
+
+	  *a++ = *b;
+	  *b++ = t;
+	}
+      break;
+    }
+}
+
+static void
+g_array_sort_insertion (guint8      *base,
+			guint        n_elts,
+			guint        elt_size,
+			GCompareFunc compare_func)
+{
+  guint i, j;
+
+  for (i = 1; i < n_elts; i++)
+    for (j = i; j > 0 && compare_func (g_array_sort_elt (j - 1), g_array_sort_elt (j)) > 0; j--)
+      g_array_sort_swap (g_array_sort_elt (j - 1), g_array_sort_elt (j), elt_size);
+}
+
+static void
+g_array_sort_sift (guint8      *base,
+		   guint        root,
+		   guint        n_elts,
+		   guint        elt_size,
+		   GCompareFunc compare_func)
+{
+  guint child;
+
+  while ((child = 2 * root + 1) < n_elts)
+    {
+      if (child + 1 < n_elts &&
+	  compare_func (g_array_sort_elt (child), g_array_sort_elt (child + 1)) < 0)
+	child++;
+      if (compare_func (g_array_sort_elt (root), g_array_sort_elt (child)) >= 0)
+	return;
+      g_array_sort_swap (g_array_sort_elt (root), g_array_sort_elt (child), elt_size);
+      root = child;
+    }
+}
+
+static void
+g_array_sort_heap (guint8      *base,
+		   guint        n_elts,
+		   guint        elt_size,
+		   GCompareFunc compare_func)
+{
+  guint i;
+
+  for (i = n_elts / 2; i > 0; i--)
+    g_array_sort_sift (base, i - 1, n_elts, elt_size, compare_func);
+  for (i = n_elts - 1; i > 0; i--)
+    {
+      g_array_sort_swap (base, g_array_sort_elt (i), elt_size);
+      g_array_sort_sift (base, 0, i, elt_size, compare_func);
+    }
+}
+
+static void
+g_array_sort_intro (guint8      *base,
+		    guint        n_elts,
+		    guint        elt_size,
+		    GCompareFunc compare_func,
+		    guint        depth)
+{
+  while (n_elts > G_ARRAY_SORT_THRESHOLD)
+    {
+      guint mid = n_elts / 2;
+      guint last = n_elts - 1;
+      guint i, j;
+
+      if (!depth--)
+	{
+	  g_array_sort_heap (base, n_elts, elt_size, compare_func);
+	  return;
+	}
+
+      /* order first, middle and last, then park the median at 0 */
+      if (compare_func (g_array_sort_elt (mid), base) < 0)
+	g_array_sort_swap (g_array_sort_elt (mid), base, elt_size);
+      if (compare_func (g_array_sort_elt (last), g_array_sort_elt (mid)) < 0)
+	{
+	  g_array_sort_swap (g_array_sort_elt (last), g_array_sort_elt (mid), elt_size);
+	  if (compare_func (g_array_sort_elt (mid), base) < 0)
+	    g_array_sort_swap (g_array_sort_elt (mid), base, elt_size);
+	}
+      g_array_sort_swap (g_array_sort_elt (mid), base, elt_size);
+
+      /* Hoare partition around base[0]; both scans stop on equal
+       * elements, which keeps runs of duplicates balanced
+       */
+      i = 0;
+      j = n_elts;
+      for (;;)
+	{
+	  do
+	    i++;
+	  while (i < n_elts && compare_func (g_array_sort_elt (i), base) < 0);
+	  do
+	    j--;
+	  while (compare_func (g_array_sort_elt (j), base) > 0);
+	  if (i >= j)
+	    break;
+	  g_array_sort_swap (g_array_sort_elt (i), g_array_sort_elt (j), elt_size);
+	}
+      g_array_sort_swap (base, g_array_sort_elt (j), elt_size);
+
+      /* recurse into the smaller half, iterate on the larger one */
+      if (j < n_elts - j - 1)
+	{
+	  g_array_sort_intro (base, j, elt_size, compare_func, depth);
+	  base = g_array_sort_elt (j + 1);
+	  n_elts -= j + 1;
+	}
+      else
+	{
+	  g_array_sort_intro (g_array_sort_elt (j + 1), n_elts - j - 1,
+			      elt_size, compare_func, depth);
+	  n_elts = j;
+	}
+    }
+
+  g_array_sort_insertion (base, n_elts, elt_size, compare_func);
+}
+
+static void
+g_array_sort_elts (guint8      *base,
+		   guint        n_elts,
+		   guint        elt_size,
+		   GCompareFunc compare_func)
+{
+  guint depth = 0;
+  guint n;
+
+  for (n = n_elts; n > 1; n >>= 1)
+    depth += 2;
+
+  g_array_sort_intro (base, n_elts, elt_size, compare_func, depth);
+}
+
 /* Pointer Array
  */
 
@@ -255,6 +523,7 @@ struct _GRealPtrArray
 
 static void g_ptr_array_maybe_expand (GRealPtrArray *array,
 				      gint           len);
+static void g_ptr_array_maybe_shrink (GRealPtrArray *array);
 
 static GMemChunk *ptr_array_mem_chunk = NULL;
 G_LOCK_DEFINE_STATIC (ptr_array_mem_chunk);
@@ -317,6 +586,47 @@ g_ptr_array_maybe_expand (GRealPtrArray *array,
     }
 }
 
+/* same policy as g_array_maybe_shrink() */
+static void
+g_ptr_array_maybe_shrink (GRealPtrArray *array)
+{
+  if (array->alloc > MIN_ARRAY_SIZE && array->len <= array->alloc / 4)
+    {
+      array->alloc = MAX (array->alloc / 2, MIN_ARRAY_SIZE);
+      array->pdata = g_renew (gpointer, array->pdata, array->alloc);
+    }
+}
+
+void
+g_ptr_array_shrink (GPtrArray *farray)
+{
+  GRealPtrArray *array = (GRealPtrArray*) farray;
+  guint want_alloc;
+
+  g_return_if_fail (array);
+
+  want_alloc = MAX (g_nearest_pow (array->len), MIN_ARRAY_SIZE);
+
+  if (want_alloc < array->alloc)
+    {
+      array->alloc = want_alloc;
+      array->pdata = g_renew (gpointer, array->pdata, array->alloc);
+    }
+}
+
+void
+g_ptr_array_sort (GPtrArray   *farray,
+		  GCompareFunc compare_func)
+{
+  GRealPtrArray *array = (GRealPtrArray*) farray;
+
+  g_return_if_fail (array);
+  g_return_if_fail (compare_func);
+
+  g_array_sort_elts ((guint8*) array->pdata, array->len, sizeof (gpointer),
+		     compare_func);
+}
+
 void
 g_ptr_array_set_size  (GPtrArray   *farray,
 		       gint	     length)
@@ -352,6 +662,8 @@ g_ptr_array_remove_index (GPtrArray* farray,
 
   array->len -= 1;
 
+  g_ptr_array_maybe_shrink (array);
+
   return result;
 }
 
@@ -375,6 +687,8 @@ g_ptr_array_remove_index_fast (GPtrArray* farray,
 
   array->len -= 1;
 
+  g_ptr_array_maybe_shrink (array);
+
   return result;
 }
 
@@ -488,3 +802,178 @@ GByteArray* g_byte_array_remove_index_fast (GByteArray *array,
 
   return array;
 }
+
+/* Ring arrays
+ */
+
+typedef struct _GRealRingArray  GRealRingArray;
+
+struct _GRealRingArray
+{
+  guint   len;
+  guint8 *data;
+  guint   alloc;
+  guint   head;
+  guint   elt_size;
+};
+
+#define g_ring_array_elt(array,i) \
+  ((array)->data + (array)->elt_size * (((array)->head + (i)) & ((array)->alloc - 1)))
+
+static GMemChunk *ring_array_mem_chunk = NULL;
+G_LOCK_DEFINE_STATIC (ring_array_mem_chunk);
+
+GRingArray*
+g_ring_array_new (guint elt_size)
+{
+  GRealRingArray *array;
+
+  g_return_val_if_fail (elt_size > 0, NULL);
+
+  G_LOCK (ring_array_mem_chunk);
+  if (!ring_array_mem_chunk)
+    ring_array_mem_chunk = g_mem_chunk_new ("ring array mem chunk",
+					    sizeof (GRealRingArray),
+					    1024, G_ALLOC_AND_FREE);
+
+  array = g_chunk_new (GRealRingArray, ring_array_mem_chunk);
+  G_UNLOCK (ring_array_mem_chunk);
+
+  array->len      = 0;
+  array->data     = NULL;
+  array->alloc    = 0;
+  array->head     = 0;
+  array->elt_size = elt_size;
+
+  return (GRingArray*) array;
+}
+
+void
+g_ring_array_free (GRingArray *farray)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_if_fail (array);
+
+  g_free (array->data);
+
+  G_LOCK (ring_array_mem_chunk);
+  g_mem_chunk_free (ring_array_mem_chunk, array);
+  G_UNLOCK (ring_array_mem_chunk);
+}
+
+/* alloc is always a power of two, so positions wrap with a mask.
+ * Growing at least doubles the buffer, which leaves enough room
+ * behind the old end to unwrap the elements stored at its start.
+ */
+static void
+g_ring_array_maybe_expand (GRealRingArray *array)
+{
+  guint old_alloc;
+
+  if (array->len < array->alloc)
+    return;
+
+  old_alloc = array->alloc;
+  array->alloc = g_nearest_pow (old_alloc + 1);
+  array->alloc = MAX (array->alloc, MIN_ARRAY_SIZE);
+  array->data = g_realloc (array->data, array->elt_size * array->alloc);
+
+  if (array->head + array->len > old_alloc)
+    memcpy (array->data + array->elt_size * old_alloc,
+	    array->data,
+	    array->elt_size * (array->head + array->len - old_alloc));
+}
+
+void
+g_ring_array_push_head (GRingArray   *farray,
+			gconstpointer data)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_if_fail (array);
+
+  g_ring_array_maybe_expand (array);
+
+  array->head = (array->head - 1) & (array->alloc - 1);
+  array->len += 1;
+
+  memcpy (array->data + array->elt_size * array->head, data, array->elt_size);
+}
+
+void
+g_ring_array_push_tail (GRingArray   *farray,
+			gconstpointer data)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_if_fail (array);
+
+  g_ring_array_maybe_expand (array);
+
+  memcpy (g_ring_array_elt (array, array->len), data, array->elt_size);
+
+  array->len += 1;
+}
+
+gboolean
+g_ring_array_pop_head (GRingArray *farray,
+		       gpointer    data)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_val_if_fail (array, FALSE);
+
+  if (!array->len)
+    return FALSE;
+
+  if (data)
+    memcpy (data, array->data + array->elt_size * array->head, array->elt_size);
+
+  array->head = (array->head + 1) & (array->alloc - 1);
+  array->len -= 1;
+
+  return TRUE;
+}
+
+gboolean
+g_ring_array_pop_tail (GRingArray *farray,
+		       gpointer    data)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_val_if_fail (array, FALSE);
+
+  if (!array->len)
+    return FALSE;
+
+  array->len -= 1;
+
+  if (data)
+    memcpy (data, g_ring_array_elt (array, array->len), array->elt_size);
+
+  return TRUE;
+}
+
+gpointer
+g_ring_array_peek (GRingArray *farray,
+		   guint       index)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_val_if_fail (array, NULL);
+  g_return_val_if_fail (index < array->len, NULL);
+
+  return g_ring_array_elt (array, index);
+}
+
+void
+g_ring_array_clear (GRingArray *farray)
+{
+  GRealRingArray *array = (GRealRingArray*) farray;
+
+  g_return_if_fail (array);
+
+  array->head = 0;
+  array->len = 0;
+}
@@ -0,0 +1,339 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+/* 
+ * MT safe
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "glib.h"
+
+/* Items first go to a bounded ring of sequenced cells (after Dmitry
+ * Vyukov's MPMC queue), that producers and consumers claim with a
+ * compare-and-swap on its tail or head.  Once the ring is full, and
+ * for as long as anything is left there, items are put on a locked
+ * overflow GQueue instead; consumers always look at the ring first,
+ * and only take from the overflow queue while it is really empty, so
+ * the order of the items is kept.  The mutex is also taken to
+ * sleep in g_async_queue_pop() and, when someone sleeps there, to
+ * wake them.  The unsigned positions and lengths go through the gint
+ * atomics, they only ever wrap around.
+ */
+#define G_ASYNC_QUEUE_RING_SIZE	1024	/* a power of two */
+#define G_ASYNC_QUEUE_SPIN	128
+#define G_ASYNC_QUEUE_CACHE_LINE	64
+
+typedef struct _GAsyncQueueCell GAsyncQueueCell;
+
+struct _GAsyncQueueCell
+{
+  guint sequence;
+  gpointer data;
+};
+
+struct _GAsyncQueue
+{
+  GMutex *mutex;
+  GCond *cond;
+  gint ref_count;
+  gint n_waiting;
+  GQueue *overflow;		/* protected by mutex */
+  guint overflow_len;
+
+  GAsyncQueueCell *cells;
+  guint mask;
+
+  /* keep producers and consumers off each other's cache line */
+  gchar pad1[G_ASYNC_QUEUE_CACHE_LINE];
+  guint tail;
+  gchar pad2[G_ASYNC_QUEUE_CACHE_LINE - sizeof (guint)];
+  guint head;
+  gchar pad3[G_ASYNC_QUEUE_CACHE_LINE - sizeof (guint)];
+};
+
+static gboolean
+g_async_queue_ring_push (GAsyncQueue *queue,
+			 gpointer     data)
+{
+  GAsyncQueueCell *cell;
+  guint pos;
+
+  pos = g_atomic_int_get ((gint*) &queue->tail);
+  for (;;)
+    {
+      gint diff;
+
+      cell = &queue->cells[pos & queue->mask];
+      diff = (gint) ((guint) g_atomic_int_get ((gint*) &cell->sequence) - pos);
+      if (diff == 0 &&
+	  g_atomic_int_compare_and_exchange ((gint*) &queue->tail, pos, pos + 1))
+	break;
+      else if (diff < 0)
+	return FALSE;		/* full */
+      else
+	pos = g_atomic_int_get ((gint*) &queue->tail);
+    }
+
+  cell->data = data;
+  g_atomic_int_set ((gint*) &cell->sequence, pos + 1);
+
+  return TRUE;
+}
+
+static gpointer
+g_async_queue_ring_pop (GAsyncQueue *queue)
+{
+  GAsyncQueueCell *cell;
+  gpointer data;
+  guint pos;
+
+  pos = g_atomic_int_get ((gint*) &queue->head);
+  for (;;)
+    {
+      gint diff;
+
+      cell = &queue->cells[pos & queue->mask];
+      diff = (gint) ((guint) g_atomic_int_get ((gint*) &cell->sequence) - (pos + 1));
+      if (diff == 0 &&
+	  g_atomic_int_compare_and_exchange ((gint*) &queue->head, pos, pos + 1))
+	break;
+      else if (diff < 0)
+	return NULL;		/* empty */
+      else
+	pos = g_atomic_int_get ((gint*) &queue->head);
+    }
+
+  data = cell->data;
+  g_atomic_int_set ((gint*) &cell->sequence, pos + queue->mask + 1);
+
+  return data;
+}
+
+static gpointer
+g_async_queue_try_pop_internal (GAsyncQueue *queue,
+				gboolean     locked)
+{
+  gpointer data;
+
+  data = g_async_queue_ring_pop (queue);
+  if (data || !g_atomic_int_get ((gint*) &queue->overflow_len))
+    return data;
+
+  if (!locked)
+    g_mutex_lock (queue->mutex);
+  /* the ring has to be really empty, with the lock held so that no
+   * newer item gets on the overflow queue meanwhile: a cell that a
+   * producer claimed but didn't fill yet makes it look empty, while
+   * that item is older than what the producer puts on the overflow
+   * queue next.  The producer wakes us once the cell is filled.
+   */
+  if (g_atomic_int_get ((gint*) &queue->head) != g_atomic_int_get ((gint*) &queue->tail))
+    data = NULL;
+  else
+    data = g_queue_pop_head (queue->overflow);
+  if (data)
+    g_atomic_int_set ((gint*) &queue->overflow_len, queue->overflow_len - 1);
+  if (!locked)
+    g_mutex_unlock (queue->mutex);
+
+  return data;
+}
+
+static gpointer
+g_async_queue_pop_internal (GAsyncQueue *queue,
+			    GTimeVal    *end_time)
+{
+  gpointer data;
+  guint i;
+
+  data = g_async_queue_try_pop_internal (queue, FALSE);
+  if (data || !queue->mutex)
+    return data;
+
+  /* the producer is often only a moment away */
+  for (i = 0; i < G_ASYNC_QUEUE_SPIN; i++)
+    {
+      data = g_async_queue_try_pop_internal (queue, FALSE);
+      if (data)
+	return data;
+    }
+
+  g_mutex_lock (queue->mutex);
+  g_atomic_int_add (&queue->n_waiting, 1);
+  g_atomic_memory_barrier ();
+  while (!(data = g_async_queue_try_pop_internal (queue, TRUE)))
+    {
+      if (!end_time)
+	g_cond_wait (queue->cond, queue->mutex);
+      else if (!g_cond_timed_wait (queue->cond, queue->mutex, end_time))
+	{
+	  data = g_async_queue_try_pop_internal (queue, TRUE);
+	  break;
+	}
+    }
+  g_atomic_int_add (&queue->n_waiting, -1);
+  /* a wakeup may have been spent on an item that was not ready yet,
+   * so hand it on to the next waiter while there is anything left
+   */
+  if (data && queue->n_waiting &&
+      (queue->overflow_len ||
+       g_atomic_int_get ((gint*) &queue->head) != g_atomic_int_get ((gint*) &queue->tail)))
+    g_cond_signal (queue->cond);
+  g_mutex_unlock (queue->mutex);
+
+  return data;
+}
+
+GAsyncQueue*
+g_async_queue_new (void)
+{
+  GAsyncQueue *queue;
+
+  queue = g_new0 (GAsyncQueue, 1);
+  if (g_thread_supported ())
+    {
+      queue->mutex = g_mutex_new ();
+      queue->cond = g_cond_new ();
+    }
+  queue->ref_count = 1;
+  queue->overflow = g_queue_new ();
+
+  {
+    guint i;
+
+    queue->mask = G_ASYNC_QUEUE_RING_SIZE - 1;
+    queue->cells = g_new (GAsyncQueueCell, G_ASYNC_QUEUE_RING_SIZE);
+    for (i = 0; i < G_ASYNC_QUEUE_RING_SIZE; i++)
+      queue->cells[i].sequence = i;
+  }
+
+  return queue;
+}
+
+void
+g_async_queue_ref (GAsyncQueue *queue)
+{
+  g_return_if_fail (queue != NULL);
+
+  g_atomic_int_inc (&queue->ref_count);
+}
+
+void
+g_async_queue_unref (GAsyncQueue *queue)
+{
+  g_return_if_fail (queue != NULL);
+  /* checked before dropping the reference, so that the queue is still
+   * there for the threads waiting on it, and not leaked
+   */
+  g_return_if_fail (g_atomic_int_get (&queue->ref_count) > 1 ||
+		    g_atomic_int_get (&queue->n_waiting) == 0);
+
+  if (!g_atomic_int_dec_and_test (&queue->ref_count))
+    return;
+
+  if (queue->mutex)
+    {
+      g_mutex_free (queue->mutex);
+      g_cond_free (queue->cond);
+    }
+  g_queue_free (queue->overflow);
+  g_free (queue->cells);
+  g_free (queue);
+}
+
+void
+g_async_queue_push (GAsyncQueue *queue,
+		    gpointer     data)
+{
+  g_return_if_fail (queue != NULL);
+  g_return_if_fail (data != NULL);
+
+  if (!g_atomic_int_get ((gint*) &queue->overflow_len) &&
+      g_async_queue_ring_push (queue, data))
+    {
+      /* pairs with the barrier in g_async_queue_pop_internal():
+       * either the consumer sees the item or we see it waiting
+       */
+      g_atomic_memory_barrier ();
+      if (g_atomic_int_get (&queue->n_waiting))
+	{
+	  g_mutex_lock (queue->mutex);
+	  g_cond_signal (queue->cond);
+	  g_mutex_unlock (queue->mutex);
+	}
+      return;
+    }
+
+  g_mutex_lock (queue->mutex);
+  g_queue_push_tail (queue->overflow, data);
+  g_atomic_int_set ((gint*) &queue->overflow_len, queue->overflow_len + 1);
+  if (g_atomic_int_get (&queue->n_waiting))
+    g_cond_signal (queue->cond);
+  g_mutex_unlock (queue->mutex);
+}
+
+gpointer
+g_async_queue_pop (GAsyncQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  return g_async_queue_pop_internal (queue, NULL);
+}
+
+gpointer
+g_async_queue_try_pop (GAsyncQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  return g_async_queue_try_pop_internal (queue, FALSE);
+}
+
+gpointer
+g_async_queue_timed_pop (GAsyncQueue *queue,
+			 GTimeVal    *end_time)
+{
+  g_return_val_if_fail (queue != NULL, NULL);
+  g_return_val_if_fail (end_time != NULL, NULL);
+
+  return g_async_queue_pop_internal (queue, end_time);
+}
+
+gint
+g_async_queue_length (GAsyncQueue *queue)
+{
+  gint length;
+
+  g_return_val_if_fail (queue != NULL, 0);
+
+  length = (gint) ((guint) g_atomic_int_get ((gint*) &queue->tail) -
+		   (guint) g_atomic_int_get ((gint*) &queue->head));
+  length += g_atomic_int_get ((gint*) &queue->overflow_len);
+
+  return MAX (length, 0);
+}
@@ -0,0 +1,491 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+/* 
+ * MT safe
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "glib.h"
+
+#if defined (G_ATOMIC_WIN32)
+#define STRICT
+#include <windows.h>
+#endif
+
+/* glib.h may implement these as macros for the compiler at hand,
+ * the functions are still needed for everybody else
+ */
+#undef g_atomic_int_exchange_and_add
+#undef g_atomic_int_add
+#undef g_atomic_int_compare_and_exchange
+#undef g_atomic_pointer_compare_and_exchange
+#undef g_atomic_int_get
+#undef g_atomic_int_set
+#undef g_atomic_pointer_get
+#undef g_atomic_pointer_set
+#undef g_atomic_memory_barrier
+
+/* configure picks the implementation: the __atomic builtins of
+ * recent gccs, the older __sync builtins, inline assembly for x86
+ * processors, the Interlocked functions on Win32, or a static mutex.
+ * The read-modify-write operations are full barriers, gets are
+ * acquire and sets release operations.
+ */
+#if defined (G_ATOMIC_GCC_BUILTINS)
+
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+  return __atomic_fetch_add (atomic, val, __ATOMIC_SEQ_CST);
+}
+
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  __atomic_add_fetch (atomic, val, __ATOMIC_SEQ_CST);
+}
+
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+  return __atomic_compare_exchange_n (atomic, &oldval, newval, FALSE,
+				      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+  return __atomic_compare_exchange_n (atomic, &oldval, newval, FALSE,
+				      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+gint
+g_atomic_int_get (gint *atomic)
+{
+  return __atomic_load_n (atomic, __ATOMIC_ACQUIRE);
+}
+
+void
+g_atomic_int_set (gint *atomic,
+		  gint  newval)
+{
+  __atomic_store_n (atomic, newval, __ATOMIC_RELEASE);
+}
+
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+  return __atomic_load_n (atomic, __ATOMIC_ACQUIRE);
+}
+
+void
+g_atomic_pointer_set (gpointer *atomic,
+		      gpointer  newval)
+{
+  __atomic_store_n (atomic, newval, __ATOMIC_RELEASE);
+}
+
+void
+g_atomic_memory_barrier (void)
+{
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+#elif defined (G_ATOMIC_GCC_SYNC)
+
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+  return __sync_fetch_and_add (atomic, val);
+}
+
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  __sync_fetch_and_add (atomic, val);
+}
+
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+  return __sync_bool_compare_and_swap (atomic, oldval, newval);
+}
+
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+  return __sync_bool_compare_and_swap (atomic, oldval, newval);
+}
+
+gint
+g_atomic_int_get (gint *atomic)
+{
+  gint result = *(volatile gint *) atomic;
+
+  __sync_synchronize ();
+
+  return result;
+}
+
+void
+g_atomic_int_set (gint *atomic,
+		  gint  newval)
+{
+  __sync_synchronize ();
+  *(volatile gint *) atomic = newval;
+}
+
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+  gpointer result = *(volatile gpointer *) atomic;
+
+  __sync_synchronize ();
+
+  return result;
+}
+
+void
+g_atomic_pointer_set (gpointer *atomic,
+		      gpointer  newval)
+{
+  __sync_synchronize ();
+  *(volatile gpointer *) atomic = newval;
+}
+
+void
+g_atomic_memory_barrier (void)
+{
+  __sync_synchronize ();
+}
+
+#elif defined (G_ATOMIC_I486) || defined (G_ATOMIC_X86_64)
+
+/* x86 neither reorders loads with other loads nor stores with other
+ * stores, so plain moves are acquire loads and release stores, as
+ * long as the compiler keeps them in place
+ */
+#define G_ATOMIC_COMPILER_BARRIER() __asm__ __volatile__ ("" : : : "memory")
+
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+  gint result;
+
+  __asm__ __volatile__ ("lock; xaddl %0,%1"
+			: "=r" (result), "=m" (*atomic)
+			: "0" (val), "m" (*atomic)
+			: "memory");
+  return result;
+}
+
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  __asm__ __volatile__ ("lock; addl %1,%0"
+			: "=m" (*atomic)
+			: "ir" (val), "m" (*atomic)
+			: "memory");
+}
+
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+  gint result;
+
+  __asm__ __volatile__ ("lock; cmpxchgl %2, %1"
+			: "=a" (result), "=m" (*atomic)
+			: "r" (newval), "m" (*atomic), "0" (oldval)
+			: "memory");
+  return result == oldval;
+}
+
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+  gpointer result;
+
+#ifdef G_ATOMIC_X86_64
+  __asm__ __volatile__ ("lock; cmpxchgq %2, %1"
+			: "=a" (result), "=m" (*atomic)
+			: "r" (newval), "m" (*atomic), "0" (oldval)
+			: "memory");
+#else
+  __asm__ __volatile__ ("lock; cmpxchgl %2, %1"
+			: "=a" (result), "=m" (*atomic)
+			: "r" (newval), "m" (*atomic), "0" (oldval)
+			: "memory");
+#endif
+  return result == oldval;
+}
+
+gint
+g_atomic_int_get (gint *atomic)
+{
+  gint result = *(volatile gint *) atomic;
+
+  G_ATOMIC_COMPILER_BARRIER ();
+
+  return result;
+}
+
+void
+g_atomic_int_set (gint *atomic,
+		  gint  newval)
+{
+  G_ATOMIC_COMPILER_BARRIER ();
+  *(volatile gint *) atomic = newval;
+}
+
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+  gpointer result = *(volatile gpointer *) atomic;
+
+  G_ATOMIC_COMPILER_BARRIER ();
+
+  return result;
+}
+
+void
+g_atomic_pointer_set (gpointer *atomic,
+		      gpointer  newval)
+{
+  G_ATOMIC_COMPILER_BARRIER ();
+  *(volatile gpointer *) atomic = newval;
+}
+
+/* stores can still pass later loads otherwise */
+void
+g_atomic_memory_barrier (void)
+{
+#ifdef G_ATOMIC_X86_64
+  __asm__ __volatile__ ("mfence" : : : "memory");
+#else	/* mfence needs SSE2 */
+  __asm__ __volatile__ ("lock; addl $0,0(%%esp)" : : : "memory");
+#endif
+}
+
+#elif defined (G_ATOMIC_WIN32)
+
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+  return InterlockedExchangeAdd ((LONG volatile *) atomic, val);
+}
+
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  InterlockedExchangeAdd ((LONG volatile *) atomic, val);
+}
+
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+  return InterlockedCompareExchange ((LONG volatile *) atomic,
+				     newval, oldval) == oldval;
+}
+
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+  return InterlockedCompareExchangePointer (atomic, newval, oldval) == oldval;
+}
+
+/* the Interlocked functions are full barriers */
+gint
+g_atomic_int_get (gint *atomic)
+{
+  return InterlockedCompareExchange ((LONG volatile *) atomic, 0, 0);
+}
+
+void
+g_atomic_int_set (gint *atomic,
+		  gint  newval)
+{
+  InterlockedExchange ((LONG volatile *) atomic, newval);
+}
+
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+  return InterlockedCompareExchangePointer (atomic, NULL, NULL);
+}
+
+void
+g_atomic_pointer_set (gpointer *atomic,
+		      gpointer  newval)
+{
+  InterlockedExchangePointer (atomic, newval);
+}
+
+void
+g_atomic_memory_barrier (void)
+{
+  LONG dummy;
+
+  InterlockedExchange (&dummy, 0);
+}
+
+#else /* no atomic operations, use a mutex */
+
+G_LOCK_DEFINE_STATIC (g_atomic);
+
+gint
+g_atomic_int_exchange_and_add (gint *atomic,
+			       gint  val)
+{
+  gint result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  *atomic += val;
+  G_UNLOCK (g_atomic);
+
+  return result;
+}
+
+void
+g_atomic_int_add (gint *atomic,
+		  gint  val)
+{
+  G_LOCK (g_atomic);
+  *atomic += val;
+  G_UNLOCK (g_atomic);
+}
+
+gboolean
+g_atomic_int_compare_and_exchange (gint *atomic,
+				   gint  oldval,
+				   gint  newval)
+{
+  gboolean result;
+
+  G_LOCK (g_atomic);
+  result = *atomic == oldval;
+  if (result)
+    *atomic = newval;
+  G_UNLOCK (g_atomic);
+
+  return result;
+}
+
+gboolean
+g_atomic_pointer_compare_and_exchange (gpointer *atomic,
+				       gpointer  oldval,
+				       gpointer  newval)
+{
+  gboolean result;
+
+  G_LOCK (g_atomic);
+  result = *atomic == oldval;
+  if (result)
+    *atomic = newval;
+  G_UNLOCK (g_atomic);
+
+  return result;
+}
+
+gint
+g_atomic_int_get (gint *atomic)
+{
+  gint result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  G_UNLOCK (g_atomic);
+
+  return result;
+}
+
+void
+g_atomic_int_set (gint *atomic,
+		  gint  newval)
+{
+  G_LOCK (g_atomic);
+  *atomic = newval;
+  G_UNLOCK (g_atomic);
+}
+
+gpointer
+g_atomic_pointer_get (gpointer *atomic)
+{
+  gpointer result;
+
+  G_LOCK (g_atomic);
+  result = *atomic;
+  G_UNLOCK (g_atomic);
+
+  return result;
+}
+
+void
+g_atomic_pointer_set (gpointer *atomic,
+		      gpointer  newval)
+{
+  G_LOCK (g_atomic);
+  *atomic = newval;
+  G_UNLOCK (g_atomic);
+}
+
+/* every other operation takes the lock as well */
+void
+g_atomic_memory_barrier (void)
+{
+  G_LOCK (g_atomic);
+  G_UNLOCK (g_atomic);
+}
+
+#endif /* no atomic operations */
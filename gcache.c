@@ -31,7 +31,23 @@
 #include "glib.h"
 
 
+/* A cache is split into a power of two number of shards, plain
+ * caches have a single one.  Every shard owns the nodes whose key
+ * hashes to it, with its own lock, key table and LRU list of
+ * unreferenced nodes, and separately the value table for the values
+ * hashing to it, under a second lock.  Locks are always taken key
+ * side first and at most one of each kind is held, so removing a
+ * value and evicting nodes of other shards can't deadlock.
+ *
+ * Values are built without holding any lock: a miss inserts a pending
+ * node, and concurrent inserts of the same key take a reference on it
+ * and wait on the shard condition until its value is there.
+ */
+#define CACHE_DEFAULT_SHARDS	16
+#define CACHE_MAX_SHARDS	256
+
 typedef struct _GCacheNode  GCacheNode;
+typedef struct _GCacheShard GCacheShard;
 typedef struct _GRealCache  GRealCache;
 
 struct _GCacheNode
@@ -39,6 +55,35 @@ struct _GCacheNode
   /* A reference counted node */
   gpointer value;
   gint ref_count;
+
+  gpointer key;
+  GCacheShard *shard;
+  guint pending : 1;
+
+  /* Unreferenced nodes kept around are linked into the LRU list */
+  GCacheNode *prev;
+  GCacheNode *next;
+};
+
+struct _GCacheShard
+{
+  GMutex *lock;
+  GCond *cond;
+
+  /* Associates keys with nodes */
+  GHashTable *key_table;
+
+  /* Unreferenced nodes, most recently released first */
+  GCacheNode *unused_head;
+  GCacheNode *unused_tail;
+  guint n_unused;
+
+  GCacheStats stats;
+
+  GMutex *value_lock;
+
+  /* Associates values with nodes */
+  GHashTable *value_table;
 };
 
 struct _GRealCache
@@ -55,31 +100,63 @@ struct _GRealCache
   /* Called to destroy a key */
   GCacheDestroyFunc key_destroy_func;
 
-  /* Associates keys with nodes */
-  GHashTable *key_table;
+  GHashFunc hash_key_func;
+  GHashFunc hash_value_func;
 
-  /* Associates nodes with keys */
-  GHashTable *value_table;
+  guint n_shards;
+  guint shard_shift;
+  GCacheShard *shards;
+
+  /* Unreferenced nodes kept by each shard */
+  guint max_unused;
 };
 
+#define G_CACHE_SHARD(cache, hash_val)					\
+   (&(cache)->shards[(cache)->n_shards > 1 ?				\
+		     ((guint32) ((hash_val) * 2654435769U)) >> (cache)->shard_shift : 0])
+#define G_CACHE_KEY_SHARD(cache, key)					\
+   G_CACHE_SHARD (cache, (* (cache)->hash_key_func) (key))
+#define G_CACHE_VALUE_SHARD(cache, value)				\
+   G_CACHE_SHARD (cache, (* (cache)->hash_value_func) (value))
+
+/* plain caches and caches created before g_thread_init() have no locks */
+#define G_CACHE_LOCK(mutex)		\
+   G_STMT_START {			\
+     if (mutex)				\
+       g_mutex_lock (mutex);		\
+   } G_STMT_END
+#define G_CACHE_UNLOCK(mutex)		\
+   G_STMT_START {			\
+     if (mutex)				\
+       g_mutex_unlock (mutex);		\
+   } G_STMT_END
+
 
 static GCacheNode* g_cache_node_new     (gpointer value);
 static void        g_cache_node_destroy (GCacheNode *node);
+static GCacheNode* g_cache_shard_trim   (GRealCache  *rcache,
+					 GCacheShard *shard,
+					 guint        n_unused);
+static void        g_cache_free_nodes   (GRealCache  *rcache,
+					 GCacheNode  *nodes);
 
 
 static GMemChunk *node_mem_chunk = NULL;
 G_LOCK_DEFINE_STATIC (node_mem_chunk);
 
-GCache*
-g_cache_new (GCacheNewFunc      value_new_func,
-	     GCacheDestroyFunc  value_destroy_func,
-	     GCacheDupFunc      key_dup_func,
-	     GCacheDestroyFunc  key_destroy_func,
-	     GHashFunc          hash_key_func,
-	     GHashFunc          hash_value_func,
-	     GCompareFunc       key_compare_func)
+static GCache*
+g_cache_new_sharded (GCacheNewFunc      value_new_func,
+		     GCacheDestroyFunc  value_destroy_func,
+		     GCacheDupFunc      key_dup_func,
+		     GCacheDestroyFunc  key_destroy_func,
+		     GHashFunc          hash_key_func,
+		     GHashFunc          hash_value_func,
+		     GCompareFunc       key_compare_func,
+		     guint              n_shards,
+		     gboolean           locked)
 {
   GRealCache *cache;
+  guint i;
 
   g_return_val_if_fail (value_new_func != NULL, NULL);
   g_return_val_if_fail (value_destroy_func != NULL, NULL);
@@ -94,22 +171,101 @@ g_cache_new (GCacheNewFunc      value_new_func,
   cache->value_destroy_func = value_destroy_func;
   cache->key_dup_func = key_dup_func;
   cache->key_destroy_func = key_destroy_func;
-  cache->key_table = g_hash_table_new (hash_key_func, key_compare_func);
-  cache->value_table = g_hash_table_new (hash_value_func, NULL);
+  cache->hash_key_func = hash_key_func;
+  cache->hash_value_func = hash_value_func;
+  cache->max_unused = 0;
+
+  cache->n_shards = 1;
+  cache->shard_shift = 32;
+  while (cache->n_shards < n_shards)
+    {
+      cache->n_shards <<= 1;
+      cache->shard_shift--;
+    }
+
+  cache->shards = g_new (GCacheShard, cache->n_shards);
+  for (i = 0; i < cache->n_shards; i++)
+    {
+      GCacheShard *shard = &cache->shards[i];
+
+      shard->lock = locked ? g_mutex_new () : NULL;
+      shard->cond = locked ? g_cond_new () : NULL;
+      shard->key_table = g_hash_table_new (hash_key_func, key_compare_func);
+      shard->unused_head = NULL;
+      shard->unused_tail = NULL;
+      shard->n_unused = 0;
+      shard->stats.hits = 0;
+      shard->stats.misses = 0;
+      shard->stats.evictions = 0;
+      shard->value_lock = locked ? g_mutex_new () : NULL;
+      shard->value_table = g_hash_table_new (hash_value_func, NULL);
+    }
 
   return (GCache*) cache;
 }
 
+GCache*
+g_cache_new (GCacheNewFunc      value_new_func,
+	     GCacheDestroyFunc  value_destroy_func,
+	     GCacheDupFunc      key_dup_func,
+	     GCacheDestroyFunc  key_destroy_func,
+	     GHashFunc          hash_key_func,
+	     GHashFunc          hash_value_func,
+	     GCompareFunc       key_compare_func)
+{
+  return g_cache_new_sharded (value_new_func, value_destroy_func,
+			      key_dup_func, key_destroy_func,
+			      hash_key_func, hash_value_func,
+			      key_compare_func, 1, FALSE);
+}
+
+GCache*
+g_cache_new_concurrent (GCacheNewFunc      value_new_func,
+			GCacheDestroyFunc  value_destroy_func,
+			GCacheDupFunc      key_dup_func,
+			GCacheDestroyFunc  key_destroy_func,
+			GHashFunc          hash_key_func,
+			GHashFunc          hash_value_func,
+			GCompareFunc       key_compare_func,
+			guint              n_shards)
+{
+  if (!n_shards)
+    n_shards = CACHE_DEFAULT_SHARDS;
+  n_shards = MIN (n_shards, CACHE_MAX_SHARDS);
+
+  return g_cache_new_sharded (value_new_func, value_destroy_func,
+			      key_dup_func, key_destroy_func,
+			      hash_key_func, hash_value_func,
+			      key_compare_func, n_shards,
+			      g_thread_supported ());
+}
+
 void
 g_cache_destroy (GCache *cache)
 {
   GRealCache *rcache;
+  guint i;
 
   g_return_if_fail (cache != NULL);
 
   rcache = (GRealCache*) cache;
-  g_hash_table_destroy (rcache->key_table);
-  g_hash_table_destroy (rcache->value_table);
+  for (i = 0; i < rcache->n_shards; i++)
+    g_cache_free_nodes (rcache, g_cache_shard_trim (rcache, &rcache->shards[i], 0));
+
+  for (i = 0; i < rcache->n_shards; i++)
+    {
+      GCacheShard *shard = &rcache->shards[i];
+
+      g_hash_table_destroy (shard->key_table);
+      g_hash_table_destroy (shard->value_table);
+      if (shard->lock)
+	{
+	  g_mutex_free (shard->lock);
+	  g_cond_free (shard->cond);
+	  g_mutex_free (shard->value_lock);
+	}
+    }
+  g_free (rcache->shards);
   g_free (rcache);
 }
 
@@ -118,28 +274,80 @@ g_cache_insert (GCache   *cache,
 		gpointer  key)
 {
   GRealCache *rcache;
+  GCacheShard *shard;
+  GCacheShard *value_shard;
   GCacheNode *node;
   gpointer value;
 
   g_return_val_if_fail (cache != NULL, NULL);
 
   rcache = (GRealCache*) cache;
+  shard = G_CACHE_KEY_SHARD (rcache, key);
 
-  node = g_hash_table_lookup (rcache->key_table, key);
+  G_CACHE_LOCK (shard->lock);
+  node = g_hash_table_lookup (shard->key_table, key);
   if (node)
     {
+      shard->stats.hits += 1;
+      if (node->ref_count == 0)
+	{
+	  if (node->prev)
+	    node->prev->next = node->next;
+	  else
+	    shard->unused_head = node->next;
+	  if (node->next)
+	    node->next->prev = node->prev;
+	  else
+	    shard->unused_tail = node->prev;
+	  shard->n_unused -= 1;
+	}
       node->ref_count += 1;
-      return node->value;
+
+      /* another thread is still building the value */
+      if (node->pending)
+	{
+	  /* without locks, only value_new_func itself can get here */
+	  if (!shard->cond)
+	    {
+	      node->ref_count -= 1;
+	      g_warning ("g_cache_insert(): key inserted while creating its value");
+	      return NULL;
+	    }
+
+	  while (node->pending)
+	    g_cond_wait (shard->cond, shard->lock);
+	}
+
+      value = node->value;
+      G_CACHE_UNLOCK (shard->lock);
+
+      return value;
     }
 
+  shard->stats.misses += 1;
   key = (* rcache->key_dup_func) (key);
+  node = g_cache_node_new (NULL);
+  node->key = key;
+  node->shard = shard;
+  node->pending = TRUE;
+  g_hash_table_insert (shard->key_table, key, node);
+  G_CACHE_UNLOCK (shard->lock);
+
   value = (* rcache->value_new_func) (key);
-  node = g_cache_node_new (value);
 
-  g_hash_table_insert (rcache->key_table, key, node);
-  g_hash_table_insert (rcache->value_table, value, key);
+  G_CACHE_LOCK (shard->lock);
+  node->value = value;
+  node->pending = FALSE;
+  if (shard->cond)
+    g_cond_broadcast (shard->cond);
+
+  value_shard = G_CACHE_VALUE_SHARD (rcache, value);
+  G_CACHE_LOCK (value_shard->value_lock);
+  g_hash_table_insert (value_shard->value_table, value, node);
+  G_CACHE_UNLOCK (value_shard->value_lock);
+  G_CACHE_UNLOCK (shard->lock);
 
-  return node->value;
+  return value;
 }
 
 void
@@ -147,43 +355,215 @@ g_cache_remove (GCache   *cache,
 		gpointer  value)
 {
   GRealCache *rcache;
+  GCacheShard *shard;
   GCacheNode *node;
-  gpointer key;
+  GCacheNode *evicted = NULL;
 
   g_return_if_fail (cache != NULL);
 
   rcache = (GRealCache*) cache;
 
-  key = g_hash_table_lookup (rcache->value_table, value);
-  node = g_hash_table_lookup (rcache->key_table, key);
+  /* the caller's reference keeps the node alive after the unlock */
+  shard = G_CACHE_VALUE_SHARD (rcache, value);
+  G_CACHE_LOCK (shard->value_lock);
+  node = g_hash_table_lookup (shard->value_table, value);
+  G_CACHE_UNLOCK (shard->value_lock);
 
   g_return_if_fail (node != NULL);
 
-  node->ref_count -= 1;
-  if (node->ref_count == 0)
+  shard = node->shard;
+  G_CACHE_LOCK (shard->lock);
+  if (node->ref_count > 0)
+    {
+      node->ref_count -= 1;
+      if (node->ref_count == 0)
+	{
+	  node->prev = NULL;
+	  node->next = shard->unused_head;
+	  if (shard->unused_head)
+	    shard->unused_head->prev = node;
+	  else
+	    shard->unused_tail = node;
+	  shard->unused_head = node;
+	  shard->n_unused += 1;
+
+	  evicted = g_cache_shard_trim (rcache, shard, rcache->max_unused);
+	}
+    }
+  else
+    g_warning ("g_cache_remove(): value %p has no references", value);
+  G_CACHE_UNLOCK (shard->lock);
+
+  g_cache_free_nodes (rcache, evicted);
+}
+
+/* Unlinks the least recently released nodes of SHARD, which must be
+ * locked, until at most n_unused unreferenced ones are left.  Returns
+ * them chained through their next pointers, to be freed with
+ * g_cache_free_nodes() once the lock is released.
+ */
+static GCacheNode*
+g_cache_shard_trim (GRealCache  *rcache,
+		    GCacheShard *shard,
+		    guint        n_unused)
+{
+  GCacheNode *evicted = NULL;
+
+  while (shard->n_unused > n_unused)
+    {
+      GCacheNode *node = shard->unused_tail;
+      GCacheShard *value_shard;
+
+      shard->unused_tail = node->prev;
+      if (shard->unused_tail)
+	shard->unused_tail->next = NULL;
+      else
+	shard->unused_head = NULL;
+      shard->n_unused -= 1;
+      shard->stats.evictions += 1;
+
+      value_shard = G_CACHE_VALUE_SHARD (rcache, node->value);
+      G_CACHE_LOCK (value_shard->value_lock);
+      g_hash_table_remove (value_shard->value_table, node->value);
+      G_CACHE_UNLOCK (value_shard->value_lock);
+      g_hash_table_remove (shard->key_table, node->key);
+
+      node->next = evicted;
+      evicted = node;
+    }
+
+  return evicted;
+}
+
+static void
+g_cache_free_nodes (GRealCache *rcache,
+		    GCacheNode *nodes)
+{
+  while (nodes)
     {
-      g_hash_table_remove (rcache->value_table, value);
-      g_hash_table_remove (rcache->key_table, key);
+      GCacheNode *node = nodes;
 
-      (* rcache->key_destroy_func) (key);
+      nodes = node->next;
+      (* rcache->key_destroy_func) (node->key);
       (* rcache->value_destroy_func) (node->value);
       g_cache_node_destroy (node);
     }
 }
 
+/* bounds are split evenly over the shards */
+static guint
+g_cache_shard_bound (GRealCache *rcache,
+		     guint       n_unused)
+{
+  return n_unused / rcache->n_shards + (n_unused % rcache->n_shards != 0);
+}
+
+void
+g_cache_set_max_unused (GCache *cache,
+			guint   max_unused)
+{
+  GRealCache *rcache;
+
+  g_return_if_fail (cache != NULL);
+
+  rcache = (GRealCache*) cache;
+  rcache->max_unused = g_cache_shard_bound (rcache, max_unused);
+
+  g_cache_trim (cache, max_unused);
+}
+
+void
+g_cache_trim (GCache *cache,
+	      guint   n_unused)
+{
+  GRealCache *rcache;
+  guint i;
+
+  g_return_if_fail (cache != NULL);
+
+  rcache = (GRealCache*) cache;
+  n_unused = g_cache_shard_bound (rcache, n_unused);
+
+  for (i = 0; i < rcache->n_shards; i++)
+    {
+      GCacheShard *shard = &rcache->shards[i];
+      GCacheNode *evicted;
+
+      G_CACHE_LOCK (shard->lock);
+      evicted = g_cache_shard_trim (rcache, shard, n_unused);
+      G_CACHE_UNLOCK (shard->lock);
+
+      g_cache_free_nodes (rcache, evicted);
+    }
+}
+
+void
+g_cache_get_stats (GCache      *cache,
+		   GCacheStats *stats)
+{
+  GRealCache *rcache;
+  guint i;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (stats != NULL);
+
+  rcache = (GRealCache*) cache;
+  stats->hits = 0;
+  stats->misses = 0;
+  stats->evictions = 0;
+
+  for (i = 0; i < rcache->n_shards; i++)
+    {
+      GCacheShard *shard = &rcache->shards[i];
+
+      G_CACHE_LOCK (shard->lock);
+      stats->hits += shard->stats.hits;
+      stats->misses += shard->stats.misses;
+      stats->evictions += shard->stats.evictions;
+      G_CACHE_UNLOCK (shard->lock);
+    }
+}
+
+typedef struct
+{
+  GHFunc func;
+  gpointer user_data;
+} GCacheForeach;
+
+static void
+g_cache_key_foreach_node (gpointer value,
+			  gpointer node,
+			  gpointer user_data)
+{
+  GCacheForeach *foreach = user_data;
+
+  (* foreach->func) (value, ((GCacheNode*) node)->key, foreach->user_data);
+}
+
 void
 g_cache_key_foreach (GCache   *cache,
 		     GHFunc    func,
 		     gpointer  user_data)
 {
   GRealCache *rcache;
+  GCacheForeach foreach;
+  guint i;
 
   g_return_if_fail (cache != NULL);
   g_return_if_fail (func != NULL);
 
   rcache = (GRealCache*) cache;
+  foreach.func = func;
+  foreach.user_data = user_data;
+
+  for (i = 0; i < rcache->n_shards; i++)
+    {
+      GCacheShard *shard = &rcache->shards[i];
 
-  g_hash_table_foreach (rcache->value_table, func, user_data);
+      G_CACHE_LOCK (shard->value_lock);
+      g_hash_table_foreach (shard->value_table, g_cache_key_foreach_node, &foreach);
+      G_CACHE_UNLOCK (shard->value_lock);
+    }
 }
 
 void
@@ -192,13 +572,21 @@ g_cache_value_foreach (GCache   *cache,
 		       gpointer  user_data)
 {
   GRealCache *rcache;
+  guint i;
 
   g_return_if_fail (cache != NULL);
   g_return_if_fail (func != NULL);
 
   rcache = (GRealCache*) cache;
 
-  g_hash_table_foreach (rcache->key_table, func, user_data);
+  for (i = 0; i < rcache->n_shards; i++)
+    {
+      GCacheShard *shard = &rcache->shards[i];
+
+      G_CACHE_LOCK (shard->lock);
+      g_hash_table_foreach (shard->key_table, func, user_data);
+      G_CACHE_UNLOCK (shard->lock);
+    }
 }
 
 
@@ -217,6 +605,11 @@ g_cache_node_new (gpointer value)
 
   node->value = value;
   node->ref_count = 1;
+  node->key = NULL;
+  node->shard = NULL;
+  node->pending = FALSE;
+  node->prev = NULL;
+  node->next = NULL;
 
   return node;
 }
@@ -31,8 +31,32 @@
 #include "glib.h"
 #include <string.h>
 
-static void completion_check_cache (GCompletion* cmp,
-				    gchar**	 new_prefix);
+/* The items are indexed by a radix trie over their strings: every
+ * edge carries a label of one or more characters, the children of a
+ * node are kept sorted by the first character of their labels, and
+ * items hang off the node their string ends at.  Completing a prefix
+ * walks down along the prefix and collects the subtree below, and the
+ * longest common prefix of the matches is the path to the first node
+ * that has items or more than one child.
+ */
+typedef struct _GCompletionNode GCompletionNode;
+
+struct _GCompletionNode
+{
+  gchar *label;
+  guint label_len;
+  GCompletionNode *parent;
+  GCompletionNode *next;
+  GCompletionNode *children;
+  GSList *items;
+};
+
+#define	G_COMPLETION_STRING(cmp, item) \
+  ((cmp)->func ? (cmp)->func (item) : (gchar*) (item))
+
+static GCompletionNode* completion_node_new	(const gchar	 *label,
+						 guint		  label_len);
+static void		completion_node_free	(GCompletionNode *node);
 
 GCompletion* 
 g_completion_new (GCompletionFunc func)
@@ -44,10 +68,230 @@ g_completion_new (GCompletionFunc func)
   gcomp->cache = NULL;
   gcomp->prefix = NULL;
   gcomp->func = func;
+  gcomp->trie = completion_node_new ("", 0);
 
   return gcomp;
 }
 
+static GCompletionNode*
+completion_node_new (const gchar *label,
+		     guint	  label_len)
+{
+  GCompletionNode *node = g_new (GCompletionNode, 1);
+
+  node->label = g_strndup (label, label_len);
+  node->label_len = label_len;
+  node->parent = NULL;
+  node->next = NULL;
+  node->children = NULL;
+  node->items = NULL;
+
+  return node;
+}
+
+static void
+completion_node_free (GCompletionNode *node)
+{
+  while (node->children)
+    {
+      GCompletionNode *child = node->children;
+
+      node->children = child->next;
+      completion_node_free (child);
+    }
+  g_slist_free (node->items);
+  g_free (node->label);
+  g_free (node);
+}
+
+/* returns the child of NODE whose label starts with C, and in *PREV
+ * the sibling it (or a new child starting with C) goes after
+ */
+static GCompletionNode*
+completion_node_child (GCompletionNode  *node,
+		       guchar		 c,
+		       GCompletionNode **prev)
+{
+  GCompletionNode *child;
+
+  *prev = NULL;
+  for (child = node->children; child; child = child->next)
+    {
+      guchar first = child->label[0];
+
+      if (first == c)
+	return child;
+      if (first > c)
+	break;
+      *prev = child;
+    }
+
+  return NULL;
+}
+
+static void
+completion_node_link (GCompletionNode *parent,
+		      GCompletionNode *prev,
+		      GCompletionNode *node)
+{
+  node->parent = parent;
+  if (prev)
+    {
+      node->next = prev->next;
+      prev->next = node;
+    }
+  else
+    {
+      node->next = parent->children;
+      parent->children = node;
+    }
+}
+
+static void
+completion_trie_insert (GCompletionNode *node,
+			const gchar	*string,
+			gpointer	 item)
+{
+  while (*string)
+    {
+      GCompletionNode *child, *prev, *mid;
+      guint n;
+
+      child = completion_node_child (node, *string, &prev);
+      if (!child)
+	{
+	  child = completion_node_new (string, strlen (string));
+	  completion_node_link (node, prev, child);
+	  node = child;
+	  break;
+	}
+
+      for (n = 1; n < child->label_len && child->label[n] == string[n]; n++)
+	;
+
+      if (n < child->label_len)
+	{
+	  /* split the edge: CHILD hangs off a new node for the shared part */
+	  gchar *label = g_strdup (child->label + n);
+
+	  mid = completion_node_new (child->label, n);
+	  mid->parent = node;
+	  mid->next = child->next;
+	  if (prev)
+	    prev->next = mid;
+	  else
+	    node->children = mid;
+
+	  g_free (child->label);
+	  child->label = label;
+	  child->label_len -= n;
+	  child->parent = mid;
+	  child->next = NULL;
+	  mid->children = child;
+	  child = mid;
+	}
+
+      node = child;
+      string += n;
+    }
+
+  node->items = g_slist_prepend (node->items, item);
+}
+
+/* finds the node of the subtree holding all the strings starting with
+ * PREFIX, and appends the path to it to PATH if that is non-NULL
+ */
+static GCompletionNode*
+completion_trie_lookup (GCompletionNode *node,
+			const gchar	*prefix,
+			GString		*path)
+{
+  while (*prefix)
+    {
+      GCompletionNode *prev;
+      guint n;
+
+      node = completion_node_child (node, *prefix, &prev);
+      if (!node)
+	return NULL;
+
+      for (n = 1; n < node->label_len && node->label[n] == prefix[n]; n++)
+	;
+      if (n < node->label_len && prefix[n])
+	return NULL;
+
+      if (path)
+	g_string_append (path, node->label);
+      prefix += n;
+      if (n < node->label_len)
+	break;
+    }
+
+  /* nodes left without items by removals are not merged with their
+   * only child, so skip down to where the matches diverge
+   */
+  while (!node->items && node->children && !node->children->next)
+    {
+      node = node->children;
+      if (path)
+	g_string_append (path, node->label);
+    }
+
+  return node;
+}
+
+static GList*
+completion_trie_collect (GCompletionNode *node,
+			 GList		 *list)
+{
+  GSList *slist;
+
+  for (slist = node->items; slist; slist = slist->next)
+    list = g_list_prepend (list, slist->data);
+  for (node = node->children; node; node = node->next)
+    list = completion_trie_collect (node, list);
+
+  return list;
+}
+
+static void
+completion_trie_remove (GCompletionNode *node,
+			const gchar	*string,
+			gpointer	 item)
+{
+  GCompletionNode *parent;
+
+  while (*string)
+    {
+      GCompletionNode *prev;
+
+      node = completion_node_child (node, *string, &prev);
+      if (!node || strncmp (node->label, string, node->label_len) != 0)
+	return;
+      string += node->label_len;
+    }
+
+  node->items = g_slist_remove (node->items, item);
+
+  /* prune the branches that lead nowhere any more */
+  while ((parent = node->parent) && !node->items && !node->children)
+    {
+      if (parent->children == node)
+	parent->children = node->next;
+      else
+	{
+	  GCompletionNode *sibling = parent->children;
+
+	  while (sibling->next != node)
+	    sibling = sibling->next;
+	  sibling->next = node->next;
+	}
+      node->next = NULL;
+      completion_node_free (node);
+      node = parent;
+    }
+}
+
 void 
 g_completion_add_items (GCompletion* cmp,
 			GList*	     items)
@@ -74,6 +318,7 @@ g_completion_add_items (GCompletion* cmp,
   while (it)
     {
       cmp->items = g_list_prepend (cmp->items, it->data);
+      completion_trie_insert (cmp->trie, G_COMPLETION_STRING (cmp, it->data), it->data);
       it = it->next;
     }
 }
@@ -90,7 +335,14 @@ g_completion_remove_items (GCompletion* cmp,
   it = items;
   while (cmp->items && it)
     {
-      cmp->items = g_list_remove (cmp->items, it->data);
+      GList *link = g_list_find (cmp->items, it->data);
+
+      if (link)
+	{
+	  cmp->items = g_list_remove_link (cmp->items, link);
+	  g_list_free_1 (link);
+	  completion_trie_remove (cmp->trie, G_COMPLETION_STRING (cmp, it->data), it->data);
+	}
       it = it->next;
     }
 
@@ -113,50 +365,8 @@ g_completion_clear_items (GCompletion* cmp)
   cmp->cache = NULL;
   g_free (cmp->prefix);
   cmp->prefix = NULL;
-}
-
-static void   
-completion_check_cache (GCompletion* cmp,
-			gchar**	     new_prefix)
-{
-  register GList* list;
-  register gint len;
-  register gint i;
-  register gint plen;
-  gchar* postfix;
-  gchar* s;
-  
-  if (!new_prefix)
-    return;
-  if (!cmp->cache)
-    {
-      *new_prefix = NULL;
-      return;
-    }
-  
-  len = strlen(cmp->prefix);
-  list = cmp->cache;
-  s = cmp->func ? cmp->func (list->data) : (gchar*) list->data;
-  postfix = s + len;
-  plen = strlen (postfix);
-  list = list->next;
-  
-  while (list && plen)
-    {
-      s = cmp->func ? cmp->func (list->data) : (gchar*) list->data;
-      s += len;
-      for (i = 0; i < plen; ++i)
-	{
-	  if (postfix[i] != s[i])
-	    break;
-	}
-      plen = i;
-      list = list->next;
-    }
-  
-  *new_prefix = g_new0 (gchar, len + plen + 1);
-  strncpy (*new_prefix, cmp->prefix, len);
-  strncpy (*new_prefix + len, postfix, plen);
+  completion_node_free (cmp->trie);
+  cmp->trie = completion_node_new ("", 0);
 }
 
 GList* 
@@ -164,62 +374,37 @@ g_completion_complete (GCompletion* cmp,
 		       gchar*	    prefix,
 		       gchar**	    new_prefix)
 {
-  gint plen, len;
-  gint done = 0;
-  GList* list;
+  GCompletionNode *node = NULL;
+  GString *path = NULL;
   
   g_return_val_if_fail (cmp != NULL, NULL);
   g_return_val_if_fail (prefix != NULL, NULL);
   
-  len = strlen (prefix);
-  if (cmp->prefix && cmp->cache)
+  g_list_free (cmp->cache);
+  cmp->cache = NULL;
+  if (cmp->prefix)
     {
-      plen = strlen (cmp->prefix);
-      if (plen <= len && !strncmp (prefix, cmp->prefix, plen))
-	{ 
-	  /* use the cache */
-	  list = cmp->cache;
-	  while (list)
-	    {
-	      GList *next = list->next;
-	      
-	      if (strncmp (prefix,
-			   cmp->func ? cmp->func (list->data) : (gchar*) list->data,
-			   len))
-		{
-		  cmp->cache = g_list_remove_link (cmp->cache, list);
-		  g_list_free_1 (list);
-		}
-
-	      list = next;
-	    }
-	  done = 1;
-	}
+      g_free (cmp->prefix);
+      cmp->prefix = NULL;
     }
-  
-  if (!done)
+
+  if (*prefix)
     {
-      /* normal code */
-      g_list_free (cmp->cache);
-      cmp->cache = NULL;
-      list = cmp->items;
-      while (*prefix && list)
-	{
-	  if (!strncmp (prefix,
-			cmp->func ? cmp->func (list->data) : (gchar*) list->data,
-			len))
-	    cmp->cache = g_list_prepend (cmp->cache, list->data);
-	  list = list->next;
-	}
+      if (new_prefix)
+	path = g_string_new (NULL);
+      node = completion_trie_lookup (cmp->trie, prefix, path);
     }
-  if (cmp->prefix)
+
+  if (node)
     {
-      g_free (cmp->prefix);
-      cmp->prefix = NULL;
+      cmp->cache = g_list_reverse (completion_trie_collect (node, NULL));
+      cmp->prefix = g_strdup (prefix);
     }
-  if (cmp->cache)
-    cmp->prefix = g_strdup (prefix);
-  completion_check_cache (cmp, new_prefix);
+
+  if (new_prefix)
+    *new_prefix = node ? g_strdup (path->str) : NULL;
+  if (path)
+    g_string_free (path, TRUE);
   
   return *prefix ? cmp->cache : cmp->items;
 }
@@ -230,6 +415,7 @@ g_completion_free (GCompletion* cmp)
   g_return_if_fail (cmp != NULL);
   
   g_completion_clear_items (cmp);
+  completion_node_free (cmp->trie);
   g_free (cmp);
 }
 
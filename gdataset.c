@@ -38,21 +38,65 @@
 
 /* --- defines --- */
 #define	G_QUARK_BLOCK_SIZE			(512)
-#define	G_DATA_MEM_CHUNK_PREALLOC		(128)
-#define	G_DATA_CACHE_MAX			(512)
+#define	G_DATA_MIN_ALLOC			(2)
 #define	G_DATASET_MEM_CHUNK_PREALLOC		(32)
+#define	G_QUARK_DIRECTORY_MIN_SIZE		(16)
+#define	G_QUARK_TABLE_MIN_SIZE			(256)
+
+/* Quarks are looked up without taking g_quark_global: the strings live
+ * in blocks that are never moved or freed, and the open addressed quark
+ * table is only ever added to. New quarks are created under the lock
+ * and published with g_atomic_*_set(), which the readers pair with
+ * g_atomic_*_get(). When the block directory or the table get replaced
+ * by bigger copies, the old ones are kept around (on g_quark_retired)
+ * as readers may still be looking at them.
+ */
+
+/* A datalist is an array of elements sorted by quark. The GData pointer
+ * of the list's owner doubles as the list's lock: while the lowest bit
+ * is set, one thread owns the list. The lock is only held while the
+ * array is looked at or changed, never across destroy notifiers, so
+ * contention is short and spinning for it is cheap, unless the owner
+ * got preempted: after G_DATALIST_SPIN tries, a waiting thread yields
+ * the processor between tries.
+ */
+#define	G_DATALIST_LOCK_BIT		((gulong) 1)
+#define	G_DATALIST_SPIN			(64)	/* tries before yielding */
+#define	G_DATALIST_GET_POINTER(datalist)	\
+  ((GData*) ((gulong) *(datalist) & ~G_DATALIST_LOCK_BIT))
 
 
 /* --- structures --- */
 typedef struct _GDataset GDataset;
-struct _GData
+typedef struct _GDataElt GDataElt;
+struct _GDataElt
 {
-  GData *next;
   GQuark id;
   gpointer data;
   GDestroyNotify destroy_func;
 };
 
+struct _GData
+{
+  guint len;
+  guint alloc;
+  GDataElt elts[1];	/* alloc elements, sorted by id */
+};
+
+typedef struct _GQuarkSlot GQuarkSlot;
+typedef struct _GQuarkTable GQuarkTable;
+struct _GQuarkSlot
+{
+  guint hash;
+  GQuark quark;		/* 0 for empty slots */
+};
+
+struct _GQuarkTable
+{
+  guint mask;
+  GQuarkSlot slots[1];	/* mask + 1 slots */
+};
+
 struct _GDataset
 {
   gconstpointer location;
@@ -62,7 +106,8 @@ struct _GDataset
 
 /* --- prototypes --- */
 static inline GDataset*	g_dataset_lookup		(gconstpointer	  dataset_location);
-static inline void	g_datalist_clear_i		(GData		**datalist);
+static inline void	g_datalist_clear_i		(GData		**datalist,
+							 gboolean	  dataset);
 static void		g_dataset_destroy_internal	(GDataset	 *dataset);
 static inline void	g_data_set_internal		(GData     	**datalist,
 							 GQuark   	  key_id,
@@ -70,7 +115,8 @@ static inline void	g_data_set_internal		(GData     	**datalist,
 							 GDestroyNotify   destroy_func,
 							 GDataset	 *dataset);
 static void		g_data_initialize		(void);
-static inline GQuark	g_quark_new			(gchar  	*string);
+static inline GQuark	g_quark_new			(gchar  	*string,
+							 guint		  hash);
 
 
 /* --- variables --- */
@@ -79,52 +125,119 @@ static GHashTable   *g_dataset_location_ht = NULL;
 static GDataset     *g_dataset_cached = NULL; /* should this be
 						 threadspecific? */
 static GMemChunk    *g_dataset_mem_chunk = NULL;
-static GMemChunk    *g_data_mem_chunk = NULL;
-static GData	    *g_data_cache = NULL;
-static guint	     g_data_cache_length = 0;
 
 G_LOCK_DEFINE_STATIC (g_quark_global);
-static GHashTable   *g_quark_ht = NULL;
-static gchar       **g_quarks = NULL;
+static GQuarkTable  *g_quark_table = NULL;
+static guint         g_quark_table_nnodes = 0;
+static gchar      ***g_quark_blocks = NULL;
+static guint         g_quark_n_blocks = 0;
 static GQuark        g_quark_seq_id = 0;
+static GSList       *g_quark_retired = NULL;
 
 
 /* --- functions --- */
 
-/* HOLDS: g_dataset_global_lock */
+/* locks datalist and returns its array */
+static inline GData*
+g_datalist_lock (GData **datalist)
+{
+  guint i;
+
+  for (i = 0; ; i++)
+    {
+      GData *old = g_atomic_pointer_get ((gpointer*) datalist);
+
+      old = (GData*) ((gulong) old & ~G_DATALIST_LOCK_BIT);
+      if (g_atomic_pointer_compare_and_exchange ((gpointer*) datalist, old,
+						 (GData*) ((gulong) old | G_DATALIST_LOCK_BIT)))
+	return old;
+      if (i >= G_DATALIST_SPIN)
+	g_thread_yield ();
+    }
+}
+
+/* unlocks datalist, replacing the array g_datalist_lock() returned
+ * with list
+ */
 static inline void
-g_datalist_clear_i (GData **datalist)
+g_datalist_unlock (GData **datalist,
+		   GData  *locked,
+		   GData  *list)
 {
-  register GData *list;
+  /* orders the unlock after the changes to the array */
+  g_atomic_pointer_set ((gpointer*) datalist, list);
+}
+
+/* HOLDS: the lock of the datalist data belongs to */
+static inline gboolean
+g_data_search (GData   *data,
+	       GQuark   key_id,
+	       guint   *index)
+{
+  guint lower = 0;
+  guint upper = data ? data->len : 0;
+
+  while (lower < upper)
+    {
+      guint middle = (lower + upper) / 2;
+
+      if (data->elts[middle].id < key_id)
+	lower = middle + 1;
+      else
+	upper = middle;
+    }
+  *index = lower;
+
+  return data && lower < data->len && data->elts[lower].id == key_id;
+}
+
+/* the ids the datalist holds at the time of the call */
+static GQuark*
+g_datalist_keys (GData **datalist,
+		 guint  *n_keys)
+{
+  GQuark *keys = NULL;
+  GData *data;
+  guint i;
+
+  data = g_datalist_lock (datalist);
+  *n_keys = data ? data->len : 0;
+  if (*n_keys)
+    {
+      keys = g_new (GQuark, *n_keys);
+      for (i = 0; i < *n_keys; i++)
+	keys[i] = data->elts[i].id;
+    }
+  g_datalist_unlock (datalist, data, data);
+
+  return keys;
+}
+
+/* HOLDS: g_dataset_global_lock if dataset */
+static inline void
+g_datalist_clear_i (GData  **datalist,
+		    gboolean dataset)
+{
+  register GData *data;
+  guint i;
   
   /* unlink *all* items before walking their destructors
    */
-  list = *datalist;
-  *datalist = NULL;
+  data = g_datalist_lock (datalist);
+  g_datalist_unlock (datalist, data, NULL);
+
+  if (!data)
+    return;
   
-  while (list)
-    {
-      register GData *prev;
-      
-      prev = list;
-      list = prev->next;
-      
-      if (prev->destroy_func)
-	{
-	  G_UNLOCK (g_dataset_global);
-	  prev->destroy_func (prev->data);
-	  G_LOCK (g_dataset_global);
-	}
-      
-      if (g_data_cache_length < G_DATA_CACHE_MAX)
-	{
-	  prev->next = g_data_cache;
-	  g_data_cache = prev;
-	  g_data_cache_length++;
-	}
-      else
-	g_mem_chunk_free (g_data_mem_chunk, prev);
-    }
+  if (dataset)
+    G_UNLOCK (g_dataset_global);
+  for (i = 0; i < data->len; i++)
+    if (data->elts[i].destroy_func)
+      data->elts[i].destroy_func (data->elts[i].data);
+  if (dataset)
+    G_LOCK (g_dataset_global);
+
+  g_free (data);
 }
 
 void
@@ -132,13 +245,8 @@ g_datalist_clear (GData **datalist)
 {
   g_return_if_fail (datalist != NULL);
   
-  G_LOCK (g_dataset_global);
-  if (!g_dataset_location_ht)
-    g_data_initialize ();
-
-  while (*datalist)
-    g_datalist_clear_i (datalist);
-  G_UNLOCK (g_dataset_global);
+  while (G_DATALIST_GET_POINTER (datalist))
+    g_datalist_clear_i (datalist, FALSE);
 }
 
 /* HOLDS: g_dataset_global_lock */
@@ -166,7 +274,7 @@ g_dataset_destroy_internal (GDataset *dataset)
   dataset_location = dataset->location;
   while (dataset)
     {
-      if (!dataset->datalist)
+      if (!G_DATALIST_GET_POINTER (&dataset->datalist))
 	{
 	  if (dataset == g_dataset_cached)
 	    g_dataset_cached = NULL;
@@ -175,7 +283,7 @@ g_dataset_destroy_internal (GDataset *dataset)
 	  break;
 	}
       
-      g_datalist_clear_i (&dataset->datalist);
+      g_datalist_clear_i (&dataset->datalist, TRUE);
       dataset = g_dataset_lookup (dataset_location);
     }
 }
@@ -197,7 +305,7 @@ g_dataset_destroy (gconstpointer  dataset_location)
   G_UNLOCK (g_dataset_global);
 }
 
-/* HOLDS: g_dataset_global_lock */
+/* HOLDS: g_dataset_global_lock if dataset */
 static inline void
 g_data_set_internal (GData	  **datalist,
 		     GQuark         key_id,
@@ -206,107 +314,85 @@ g_data_set_internal (GData	  **datalist,
 		     GDataset	   *dataset)
 {
   register GData *list;
+  GData *locked;
+  GDestroyNotify dfunc = NULL;
+  gpointer ddata = NULL;
+  guint i;
   
-  list = *datalist;
+  locked = list = g_datalist_lock (datalist);
   if (!data)
     {
-      register GData *prev;
-      
-      prev = NULL;
-      while (list)
+      if (!g_data_search (list, key_id, &i))
 	{
-	  if (list->id == key_id)
-	    {
-	      if (prev)
-		prev->next = list->next;
-	      else
-		{
-		  *datalist = list->next;
-		  
-		  /* the dataset destruction *must* be done
-		   * prior to invokation of the data destroy function
-		   */
-		  if (!*datalist && dataset)
-		    g_dataset_destroy_internal (dataset);
-		}
-	      
-	      /* the GData struct *must* already be unlinked
-	       * when invoking the destroy function.
-	       * we use (data==NULL && destroy_func!=NULL) as
-	       * a special hint combination to "steal"
-	       * data without destroy notification
-	       */
-	      if (list->destroy_func && !destroy_func)
-		{
-		  G_UNLOCK (g_dataset_global);
-		  list->destroy_func (list->data);
-		  G_LOCK (g_dataset_global);
-		}
-	      
-	      if (g_data_cache_length < G_DATA_CACHE_MAX)
-		{
-		  list->next = g_data_cache;
-		  g_data_cache = list;
-		  g_data_cache_length++;
-		}
-	      else
-		g_mem_chunk_free (g_data_mem_chunk, list);
-	      
-	      return;
-	    }
-	  
-	  prev = list;
-	  list = list->next;
+	  g_datalist_unlock (datalist, list, list);
+	  return;
 	}
-    }
-  else
-    {
-      while (list)
+
+      /* we use (data==NULL && destroy_func!=NULL) as
+       * a special hint combination to "steal"
+       * data without destroy notification
+       */
+      if (!destroy_func)
 	{
-	  if (list->id == key_id)
-	    {
-	      if (!list->destroy_func)
-		{
-		  list->data = data;
-		  list->destroy_func = destroy_func;
-		}
-	      else
-		{
-		  register GDestroyNotify dfunc;
-		  register gpointer ddata;
-		  
-		  dfunc = list->destroy_func;
-		  ddata = list->data;
-		  list->data = data;
-		  list->destroy_func = destroy_func;
-		  
-		  /* we need to have updated all structures prior to
-		   * invokation of the destroy function
-		   */
-		  G_UNLOCK (g_dataset_global);
-		  dfunc (ddata);
-		  G_LOCK (g_dataset_global);
-		}
-	      
-	      return;
-	    }
-	  
-	  list = list->next;
+	  dfunc = list->elts[i].destroy_func;
+	  ddata = list->elts[i].data;
 	}
-      
-      if (g_data_cache)
+
+      list->len--;
+      g_memmove (list->elts + i, list->elts + i + 1,
+		 (list->len - i) * sizeof (GDataElt));
+      if (!list->len)
 	{
-	  list = g_data_cache;
-	  g_data_cache = list->next;
-	  g_data_cache_length--;
+	  g_free (list);
+	  g_datalist_unlock (datalist, locked, NULL);
+
+	  /* the dataset destruction *must* be done
+	   * prior to invokation of the data destroy function
+	   */
+	  if (dataset)
+	    g_dataset_destroy_internal (dataset);
 	}
       else
-	list = g_chunk_new (GData, g_data_mem_chunk);
-      list->next = *datalist;
-      list->id = key_id;
-      list->data = data;
-      list->destroy_func = destroy_func;
-      *datalist = list;
+	g_datalist_unlock (datalist, list, list);
+    }
+  else if (g_data_search (list, key_id, &i))
+    {
+      dfunc = list->elts[i].destroy_func;
+      ddata = list->elts[i].data;
+      list->elts[i].data = data;
+      list->elts[i].destroy_func = destroy_func;
+      g_datalist_unlock (datalist, list, list);
+    }
+  else
+    {
+      if (!list || list->len == list->alloc)
+	{
+	  guint alloc = list ? list->alloc * 2 : G_DATA_MIN_ALLOC;
+	  guint len = list ? list->len : 0;
+
+	  list = g_realloc (list, sizeof (GData) + (alloc - 1) * sizeof (GDataElt));
+	  list->len = len;
+	  list->alloc = alloc;
+	}
+      g_memmove (list->elts + i + 1, list->elts + i,
+		 (list->len - i) * sizeof (GDataElt));
+      list->elts[i].id = key_id;
+      list->elts[i].data = data;
+      list->elts[i].destroy_func = destroy_func;
+      list->len++;
+      g_datalist_unlock (datalist, locked, list);
+    }
+
+  /* the element *must* already be unlinked or updated
+   * when invoking the destroy function.
+   */
+  if (dfunc)
+    {
+      if (dataset)
+	G_UNLOCK (g_dataset_global);
+      dfunc (ddata);
+      if (dataset)
+	G_LOCK (g_dataset_global);
     }
 }
 
@@ -365,12 +451,7 @@ g_datalist_id_set_data_full (GData	  **datalist,
 	return;
     }
 
-  G_LOCK (g_dataset_global);
-  if (!g_dataset_location_ht)
-    g_data_initialize ();
-  
   g_data_set_internal (datalist, key_id, data, destroy_func, NULL);
-  G_UNLOCK (g_dataset_global);
 }
 
 void
@@ -397,16 +478,16 @@ g_datalist_id_remove_no_notify (GData	**datalist,
 {
   g_return_if_fail (datalist != NULL);
 
-  G_LOCK (g_dataset_global);
-  if (key_id && g_dataset_location_ht)
+  if (key_id)
     g_data_set_internal (datalist, key_id, NULL, (GDestroyNotify) 42, NULL);
-  G_UNLOCK (g_dataset_global);
 }
 
 gpointer
 g_dataset_id_get_data (gconstpointer  dataset_location,
 		       GQuark         key_id)
 {
+  gpointer data = NULL;
+
   g_return_val_if_fail (dataset_location != NULL, NULL);
   
   G_LOCK (g_dataset_global);
@@ -416,46 +497,48 @@ g_dataset_id_get_data (gconstpointer  dataset_location,
       
       dataset = g_dataset_lookup (dataset_location);
       if (dataset)
-	{
-	  register GData *list;
-	  
-	  for (list = dataset->datalist; list; list = list->next)
-	    if (list->id == key_id)
-	      {
-		G_UNLOCK (g_dataset_global);
-		return list->data;
-	      }
-	}
+	data = g_datalist_id_get_data (&dataset->datalist, key_id);
     }
   G_UNLOCK (g_dataset_global);
  
-  return NULL;
+  return data;
 }
 
 gpointer
 g_datalist_id_get_data (GData	 **datalist,
 			GQuark     key_id)
 {
+  gpointer data = NULL;
+
   g_return_val_if_fail (datalist != NULL, NULL);
   
   if (key_id)
     {
       register GData *list;
+      guint i;
       
-      for (list = *datalist; list; list = list->next)
-	if (list->id == key_id)
-	  return list->data;
+      list = g_datalist_lock (datalist);
+      if (g_data_search (list, key_id, &i))
+	data = list->elts[i].data;
+      g_datalist_unlock (datalist, list, list);
     }
   
-  return NULL;
+  return data;
 }
 
+/* the foreach functions call func for the items present when they were
+ * called and still present when their turn comes, so func may change
+ * the list it is called for
+ */
 void
 g_dataset_foreach (gconstpointer    dataset_location,
 		   GDataForeachFunc func,
 		   gpointer         user_data)
 {
   register GDataset *dataset;
+  GQuark *keys = NULL;
+  guint n_keys = 0;
+  guint i;
   
   g_return_if_fail (dataset_location != NULL);
   g_return_if_fail (func != NULL);
@@ -464,19 +547,19 @@ g_dataset_foreach (gconstpointer    dataset_location,
   if (g_dataset_location_ht)
     {
       dataset = g_dataset_lookup (dataset_location);
-      G_UNLOCK (g_dataset_global);
       if (dataset)
-	{
-	  register GData *list;
-	  
-	  for (list = dataset->datalist; list; list = list->next)
-	      func (list->id, list->data, user_data);
-	}
+	keys = g_datalist_keys (&dataset->datalist, &n_keys);
     }
-  else
+  G_UNLOCK (g_dataset_global);
+
+  for (i = 0; i < n_keys; i++)
     {
-      G_UNLOCK (g_dataset_global);
+      gpointer data = g_dataset_id_get_data (dataset_location, keys[i]);
+
+      if (data)
+	func (keys[i], data, user_data);
     }
+  g_free (keys);
 }
 
 void
@@ -484,13 +567,22 @@ g_datalist_foreach (GData	   **datalist,
 		    GDataForeachFunc func,
 		    gpointer         user_data)
 {
-  register GData *list;
+  GQuark *keys;
+  guint n_keys;
+  guint i;
 
   g_return_if_fail (datalist != NULL);
   g_return_if_fail (func != NULL);
   
-  for (list = *datalist; list; list = list->next)
-    func (list->id, list->data, user_data);
+  keys = g_datalist_keys (datalist, &n_keys);
+  for (i = 0; i < n_keys; i++)
+    {
+      gpointer data = g_datalist_id_get_data (datalist, keys[i]);
+
+      if (data)
+	func (keys[i], data, user_data);
+    }
+  g_free (keys);
 }
 
 void
@@ -514,98 +606,161 @@ g_data_initialize (void)
 		     sizeof (GDataset),
 		     sizeof (GDataset) * G_DATASET_MEM_CHUNK_PREALLOC,
 		     G_ALLOC_AND_FREE);
-  g_data_mem_chunk =
-    g_mem_chunk_new ("GData MemChunk",
-		     sizeof (GData),
-		     sizeof (GData) * G_DATA_MEM_CHUNK_PREALLOC,
-		     G_ALLOC_AND_FREE);
+}
+
+/* quark has to be published already */
+static inline gchar*
+g_quark_string (GQuark quark)
+{
+  gchar ***blocks = g_atomic_pointer_get ((gpointer*) &g_quark_blocks);
+
+  return blocks[(quark - 1) / G_QUARK_BLOCK_SIZE][(quark - 1) % G_QUARK_BLOCK_SIZE];
+}
+
+static GQuark
+g_quark_lookup (const gchar *string,
+		guint	     hash)
+{
+  GQuarkTable *table = g_atomic_pointer_get ((gpointer*) &g_quark_table);
+  guint i;
+
+  if (!table)
+    return 0;
+
+  for (i = hash & table->mask; ; i = (i + 1) & table->mask)
+    {
+      GQuark quark = g_atomic_int_get ((gint*) &table->slots[i].quark);
+
+      if (!quark ||
+	  (table->slots[i].hash == hash && strcmp (g_quark_string (quark), string) == 0))
+	return quark;
+    }
 }
 
 GQuark
 g_quark_try_string (const gchar *string)
 {
-  GQuark quark = 0;
+  GQuark quark;
   g_return_val_if_fail (string != NULL, 0);
   
-  G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = GPOINTER_TO_UINT (g_hash_table_lookup (g_quark_ht, string));
-  G_UNLOCK (g_quark_global);
+  quark = g_quark_lookup (string, g_str_hash (string));
   
   return quark;
 }
 
-GQuark
-g_quark_from_string (const gchar *string)
+static GQuark
+g_quark_from_string_internal (const gchar *string,
+			      gboolean	   duplicate)
 {
   GQuark quark;
+  guint hash = g_str_hash (string);
   
-  g_return_val_if_fail (string != NULL, 0);
+  quark = g_quark_lookup (string, hash);
+  if (quark)
+    return quark;
   
   G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = (gulong) g_hash_table_lookup (g_quark_ht, string);
-  else
-    {
-      g_quark_ht = g_hash_table_new (g_str_hash, g_str_equal);
-      quark = 0;
-    }
-  
+  /* another thread may have created it since */
+  quark = g_quark_lookup (string, hash);
   if (!quark)
-    quark = g_quark_new (g_strdup (string));
+    quark = g_quark_new (duplicate ? g_strdup (string) : (gchar*) string, hash);
   G_UNLOCK (g_quark_global);
   
   return quark;
 }
 
 GQuark
-g_quark_from_static_string (const gchar *string)
+g_quark_from_string (const gchar *string)
 {
-  GQuark quark;
-  
   g_return_val_if_fail (string != NULL, 0);
   
-  G_LOCK (g_quark_global);
-  if (g_quark_ht)
-    quark = (gulong) g_hash_table_lookup (g_quark_ht, string);
-  else
-    {
-      g_quark_ht = g_hash_table_new (g_str_hash, g_str_equal);
-      quark = 0;
-    }
+  return g_quark_from_string_internal (string, TRUE);
+}
 
-  if (!quark)
-    quark = g_quark_new ((gchar*) string);
-  G_UNLOCK (g_quark_global);
- 
-  return quark;
+GQuark
+g_quark_from_static_string (const gchar *string)
+{
+  g_return_val_if_fail (string != NULL, 0);
+  
+  return g_quark_from_string_internal (string, FALSE);
 }
 
 gchar*
 g_quark_to_string (GQuark quark)
 {
   gchar* result = NULL;
-  G_LOCK (g_quark_global);
-  if (quark > 0 && quark <= g_quark_seq_id)
-    result = g_quarks[quark - 1];
-  G_UNLOCK (g_quark_global);
+  if (quark > 0 && quark <= (GQuark) g_atomic_int_get ((gint*) &g_quark_seq_id))
+    result = g_quark_string (quark);
 
   return result;
 }
 
+/* HOLDS: g_quark_global_lock */
+static void
+g_quark_table_insert (GQuarkTable *table,
+		      guint	   hash,
+		      GQuark	   quark)
+{
+  guint i = hash & table->mask;
+
+  while (table->slots[i].quark)
+    i = (i + 1) & table->mask;
+
+  table->slots[i].hash = hash;
+  g_atomic_int_set ((gint*) &table->slots[i].quark, quark);
+}
+
 /* HOLDS: g_quark_global_lock */
 static inline GQuark
-g_quark_new (gchar *string)
+g_quark_new (gchar *string,
+	     guint  hash)
 {
-  GQuark quark;
+  GQuarkTable *table = g_quark_table;
+  GQuark quark = g_quark_seq_id + 1;
+  guint block = g_quark_seq_id / G_QUARK_BLOCK_SIZE;
   
   if (g_quark_seq_id % G_QUARK_BLOCK_SIZE == 0)
-    g_quarks = g_renew (gchar*, g_quarks, g_quark_seq_id + G_QUARK_BLOCK_SIZE);
+    {
+      if (block == g_quark_n_blocks)
+	{
+	  guint n_blocks = MAX (g_quark_n_blocks * 2, G_QUARK_DIRECTORY_MIN_SIZE);
+	  gchar ***blocks = g_new0 (gchar**, n_blocks);
+
+	  if (g_quark_blocks)
+	    {
+	      memcpy (blocks, g_quark_blocks, g_quark_n_blocks * sizeof (gchar**));
+	      g_quark_retired = g_slist_prepend (g_quark_retired, g_quark_blocks);
+	    }
+	  g_atomic_pointer_set ((gpointer*) &g_quark_blocks, blocks);
+	  g_quark_n_blocks = n_blocks;
+	}
+      g_quark_blocks[block] = g_new (gchar*, G_QUARK_BLOCK_SIZE);
+    }
+  
+  g_quark_blocks[block][g_quark_seq_id % G_QUARK_BLOCK_SIZE] = string;
+  g_atomic_int_set ((gint*) &g_quark_seq_id, quark);
   
-  g_quarks[g_quark_seq_id] = string;
-  g_quark_seq_id++;
-  quark = g_quark_seq_id;
-  g_hash_table_insert (g_quark_ht, string, GUINT_TO_POINTER (quark));
+  /* keep the table at most half full */
+  if (!table || (g_quark_table_nnodes + 1) * 2 > table->mask + 1)
+    {
+      guint size = table ? (table->mask + 1) * 2 : G_QUARK_TABLE_MIN_SIZE;
+      GQuarkTable *new_table = g_malloc0 (sizeof (GQuarkTable) +
+					  (size - 1) * sizeof (GQuarkSlot));
+      guint i;
+
+      new_table->mask = size - 1;
+      if (table)
+	{
+	  for (i = 0; i <= table->mask; i++)
+	    if (table->slots[i].quark)
+	      g_quark_table_insert (new_table, table->slots[i].hash, table->slots[i].quark);
+	  g_quark_retired = g_slist_prepend (g_quark_retired, table);
+	}
+      g_atomic_pointer_set ((gpointer*) &g_quark_table, new_table);
+      table = new_table;
+    }
+  g_quark_table_insert (table, hash, quark);
+  g_quark_table_nnodes++;
   
   return quark;
 }
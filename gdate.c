@@ -651,6 +651,47 @@ g_date_prepare_to_parse (const gchar *str, GDateParseTokens *pt)
   g_date_fill_parse_tokens (str, pt);
 }
 
+/* Strict ISO 8601 "YYYY-MM-DD" and "YYYYMMDD" don't depend on the
+ * locale, so they are picked out before going through the whole
+ * machinery.  Their year is always taken literally.
+ */
+#define G_DATE_DIGIT(c)		((guint) ((c) - '0') < 10)
+#define G_DATE_NUM2(s)		(((s)[0] - '0') * 10 + ((s)[1] - '0'))
+
+static gboolean
+g_date_parse_iso (const gchar *str,
+		  guint	      *day,
+		  guint	      *month,
+		  guint	      *year)
+{
+  const gchar *md;
+  
+  if (!(G_DATE_DIGIT (str[0]) && G_DATE_DIGIT (str[1]) &&
+	G_DATE_DIGIT (str[2]) && G_DATE_DIGIT (str[3])))
+    return FALSE;
+  
+  if (str[4] == '-')
+    {
+      if (!(G_DATE_DIGIT (str[5]) && G_DATE_DIGIT (str[6]) && str[7] == '-' &&
+	    G_DATE_DIGIT (str[8]) && G_DATE_DIGIT (str[9]) && str[10] == '\0'))
+	return FALSE;
+      md = str + 5;
+    }
+  else
+    {
+      if (!(G_DATE_DIGIT (str[4]) && G_DATE_DIGIT (str[5]) &&
+	    G_DATE_DIGIT (str[6]) && G_DATE_DIGIT (str[7]) && str[8] == '\0'))
+	return FALSE;
+      md = str + 4;
+    }
+  
+  *year = G_DATE_NUM2 (str) * 100 + G_DATE_NUM2 (str + 2);
+  *month = G_DATE_NUM2 (md);
+  *day = G_DATE_NUM2 (md + (md[2] == '-' ? 3 : 2));
+  
+  return TRUE;
+}
+
 void         
 g_date_set_parse (GDate       *d, 
                   const gchar *str)
@@ -663,6 +704,18 @@ g_date_set_parse (GDate       *d,
   /* set invalid */
   g_date_clear (d, 1);
   
+  if (g_date_parse_iso (str, &day, &m, &y))
+    {
+      if (y < 8000 && g_date_valid_dmy (day, m, y))
+	{
+	  d->month = m;
+	  d->day   = day;
+	  d->year  = y;
+	  d->dmy   = TRUE;
+	}
+      return;
+    }
+  
   G_LOCK (g_date_global);
 
   g_date_prepare_to_parse (str, &pt);
@@ -910,6 +963,127 @@ g_date_set_julian (GDate *d, guint32 j)
 }
 
 
+/* the bulk conversions work through the dates in blocks of this many */
+#define G_DATE_BLOCK_SIZE	256
+
+/* g_date_update_dmy() for a whole array, kept free of branches and
+ * struct accesses so the compiler can vectorize it
+ */
+static void
+g_date_julian_to_dmy_block (const guint32 *julian_days,
+			    guint	   n,
+			    guint32	  *days,
+			    guint32	  *months,
+			    guint32	  *years)
+{
+  guint i;
+  
+  for (i = 0; i < n; i++)
+    {
+      guint32 A, B, C, D, E, M;
+      
+      A = julian_days[i] + 1721425 + 32045;
+      B = ( 4 *(A + 36524) )/ 146097 - 1;
+      C = A - (146097 * B)/4;
+      D = ( 4 * (C + 365) ) / 1461 - 1;
+      E = C - ((1461*D) / 4);
+      M = (5 * (E - 1) + 2)/153;
+      
+      months[i] = M + 3 - (12*(M/10));
+      days[i]   = E - (153*M + 2)/5;
+      years[i]  = 100 * B + D - 4800 + (M/10);
+    }
+}
+
+void
+g_date_set_julian_many (GDate	       *dates,
+			const guint32  *julian_days,
+			guint		n_dates)
+{
+  guint32 days[G_DATE_BLOCK_SIZE];
+  guint32 months[G_DATE_BLOCK_SIZE];
+  guint32 years[G_DATE_BLOCK_SIZE];
+  guint base, i, n;
+  
+  g_return_if_fail (dates != NULL || n_dates == 0);
+  g_return_if_fail (julian_days != NULL || n_dates == 0);
+  
+  for (base = 0; base < n_dates; base += n)
+    {
+      n = MIN (n_dates - base, G_DATE_BLOCK_SIZE);
+      g_date_julian_to_dmy_block (julian_days + base, n, days, months, years);
+      
+      for (i = 0; i < n; i++)
+	{
+	  GDate *d = dates + base + i;
+	  
+	  d->julian_days = julian_days[base + i];
+	  d->julian = g_date_valid_julian (d->julian_days);
+	  d->dmy = d->julian;
+	  d->day = days[i];
+	  d->month = months[i];
+	  d->year = years[i];
+	}
+    }
+}
+
+void
+g_date_to_dmy_many (GDate      *dates,
+		    guint	n_dates,
+		    GDateDay   *days,
+		    GDateMonth *months,
+		    GDateYear  *years)
+{
+  guint32 julian_days[G_DATE_BLOCK_SIZE];
+  guint32 d_days[G_DATE_BLOCK_SIZE];
+  guint32 d_months[G_DATE_BLOCK_SIZE];
+  guint32 d_years[G_DATE_BLOCK_SIZE];
+  guint index[G_DATE_BLOCK_SIZE];
+  guint base, i, n, n_julian;
+  
+  g_return_if_fail (dates != NULL || n_dates == 0);
+  
+  for (base = 0; base < n_dates; base += n)
+    {
+      GDate *block = dates + base;
+      
+      n = MIN (n_dates - base, G_DATE_BLOCK_SIZE);
+      
+      /* convert the dates that only have their julian days at once,
+       * and keep the result in them like g_date_update_dmy() does
+       */
+      n_julian = 0;
+      for (i = 0; i < n; i++)
+	if (block[i].julian && !block[i].dmy)
+	  {
+	    index[n_julian] = i;
+	    julian_days[n_julian++] = block[i].julian_days;
+	  }
+      g_date_julian_to_dmy_block (julian_days, n_julian, d_days, d_months, d_years);
+      for (i = 0; i < n_julian; i++)
+	{
+	  GDate *d = block + index[i];
+	  
+	  d->day = d_days[i];
+	  d->month = d_months[i];
+	  d->year = d_years[i];
+	  d->dmy = TRUE;
+	}
+      
+      for (i = 0; i < n; i++)
+	{
+	  gboolean valid = block[i].dmy;
+	  
+	  if (days)
+	    days[base + i] = valid ? block[i].day : G_DATE_BAD_DAY;
+	  if (months)
+	    months[base + i] = valid ? block[i].month : G_DATE_BAD_MONTH;
+	  if (years)
+	    years[base + i] = valid ? block[i].year : G_DATE_BAD_YEAR;
+	}
+    }
+}
+
 gboolean     
 g_date_is_first_of_month (GDate *d)
 {
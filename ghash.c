@@ -28,12 +28,43 @@
  * MT safe
  */
 
+#include <stdio.h>
+#include <string.h>
 #include "glib.h"
 
 
 #define HASH_TABLE_MIN_SIZE 11
 #define HASH_TABLE_MAX_SIZE 13845163
 
+/* bounds for G_HASH_TABLE_POWER_OF_TWO sized tables */
+#define HASH_TABLE_MIN_POW2_SIZE 16
+#define HASH_TABLE_MAX_POW2_SIZE (1 << 24)
+
+/* hash codes cached for open addressed tables; the two lowest values
+ * are reserved to mark slots that never have been used and slots whose
+ * entry has been removed.
+ */
+#define UNUSED_HASH_VALUE	0
+#define TOMBSTONE_HASH_VALUE	1
+#define HASH_IS_REAL(h_)	((h_) >= 2)
+
+/* number of old buckets an incrementally resizing table migrates per
+ * insert or remove. lookups leave the table alone, so they may still
+ * be done from within g_hash_table_foreach().
+ */
+#define HASH_TABLE_REHASH_STEPS	8
+
+/* number of keys g_hash_table_insert_many() and g_hash_table_lookup_many()
+ * hash and prefetch ahead before they start probing
+ */
+#define HASH_TABLE_BATCH_SIZE	16
+
+#if defined (__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 1))
+#  define HASH_PREFETCH(addr)	__builtin_prefetch (addr)
+#else
+#  define HASH_PREFETCH(addr)
+#endif
+
 
 typedef struct _GHashNode      GHashNode;
 
@@ -52,49 +83,191 @@ struct _GHashTable
   GHashNode **nodes;
   GHashFunc hash_func;
   GCompareFunc key_compare_func;
+  GHashTableFlags flags;
+
+  /* open addressing, G_HASH_TABLE_OPEN_ADDRESSING */
+  gint noccupied;	/* nnodes + tombstones */
+  guint *hashes;
+  gpointer *keys;
+  gpointer *values;
+
+  /* buckets still to be migrated by G_HASH_TABLE_INCREMENTAL_RESIZE,
+   * old_nodes[rehash_index .. old_size - 1] are not yet moved over
+   */
+  GHashNode **old_nodes;
+  gint old_size;
+  gint rehash_index;
 };
 
 
 static void		g_hash_table_resize	 (GHashTable	*hash_table);
+static void		g_hash_table_resize_to	 (GHashTable	*hash_table,
+						  gint		 new_size);
 static GHashNode**	g_hash_table_lookup_node (GHashTable	*hash_table,
-						  gconstpointer	 key);
+						  gconstpointer	 key,
+						  guint		 hash_val);
 static GHashNode*	g_hash_node_new		 (gpointer	 key,
 						  gpointer	 value);
 static void		g_hash_node_destroy	 (GHashNode	*hash_node);
 static void		g_hash_nodes_destroy	 (GHashNode	*hash_node);
+static void		g_hash_table_rehash	 (GHashTable	*hash_table,
+						  gint		 new_size);
+static void		g_hash_table_oa_resize	 (GHashTable	*hash_table,
+						  gint		 n_entries);
+static guint		g_hash_table_lookup_slot (GHashTable	*hash_table,
+						  gconstpointer	 key,
+						  guint		 hash_value);
+static void		g_hash_table_rehash_step (GHashTable	*hash_table,
+						  gint		 n_buckets);
+static guint		g_hash_nodes_foreach_remove (GHashTable	*hash_table,
+						     GHashNode	**nodes,
+						     gint	 first,
+						     gint	 size,
+						     GHRFunc	 func,
+						     gpointer	 user_data);
+
+#define G_HASH_TABLE_IS_POW2(hash_table)	\
+   (((hash_table)->flags & G_HASH_TABLE_POWER_OF_TWO) != 0)
+#define G_HASH_TABLE_MIN_SIZE(hash_table)	\
+   (G_HASH_TABLE_IS_POW2 (hash_table) ? HASH_TABLE_MIN_POW2_SIZE : HASH_TABLE_MIN_SIZE)
+#define G_HASH_TABLE_MAX_SIZE(hash_table)	\
+   (G_HASH_TABLE_IS_POW2 (hash_table) ? HASH_TABLE_MAX_POW2_SIZE : HASH_TABLE_MAX_SIZE)
+
+/* power of two sized tables select buckets by masking, so the hash
+ * value is mixed first to make its high bits contribute to the low
+ * ones (pointers from g_direct_hash() e.g. have their low bits zeroed).
+ */
+#define G_HASH_TABLE_INDEX(hash_table, hash_val, size)			\
+   (G_HASH_TABLE_IS_POW2 (hash_table) ?					\
+    g_hash_mix (hash_val) & ((size) - 1) : (hash_val) % (size))
 
 #define G_HASH_TABLE_RESIZE(hash_table)				\
    G_STMT_START {						\
      if ((hash_table->size >= 3 * hash_table->nnodes &&	        \
-	  hash_table->size > HASH_TABLE_MIN_SIZE) ||		\
+	  hash_table->size > G_HASH_TABLE_MIN_SIZE (hash_table)) ||	\
 	 (3 * hash_table->size <= hash_table->nnodes &&	        \
-	  hash_table->size < HASH_TABLE_MAX_SIZE))		\
+	  hash_table->size < G_HASH_TABLE_MAX_SIZE (hash_table)))	\
 	   g_hash_table_resize (hash_table);			\
    } G_STMT_END
 
+/* open addressed tables need at least one unused slot to terminate
+ * probing, so they grow even while frozen once they get close to
+ * being full.
+ */
+#define G_HASH_TABLE_OA_RESIZE(hash_table)				\
+   G_STMT_START {							\
+     if ((!hash_table->frozen &&					\
+	  ((4 * hash_table->noccupied > 3 * hash_table->size) ||	\
+	   (8 * hash_table->nnodes < hash_table->size &&		\
+	    hash_table->size > G_HASH_TABLE_MIN_SIZE (hash_table)))) ||	\
+	 16 * hash_table->noccupied >= 15 * hash_table->size)		\
+       g_hash_table_oa_resize (hash_table, hash_table->nnodes);		\
+   } G_STMT_END
+
+#define G_HASH_TABLE_IS_OA(hash_table)	\
+   (((hash_table)->flags & G_HASH_TABLE_OPEN_ADDRESSING) != 0)
+
+/* open addressed tables reserve the two lowest hash values */
+#define G_HASH_TABLE_OA_HASH(hash_val)	\
+   (HASH_IS_REAL (hash_val) ? (hash_val) : 2)
+
+#define G_HASH_TABLE_REHASH_STEP(hash_table)				\
+   G_STMT_START {							\
+     if (hash_table->old_nodes)						\
+       g_hash_table_rehash_step (hash_table, HASH_TABLE_REHASH_STEPS);	\
+   } G_STMT_END
+
 G_LOCK_DEFINE_STATIC (g_hash_global);
 
 static GMemChunk *node_mem_chunk = NULL;
 static GHashNode *node_free_list = NULL;
 
 
+static inline guint
+g_hash_mix (guint hash_val)
+{
+  hash_val ^= hash_val >> 16;
+  hash_val *= 0x85ebca6b;
+  hash_val ^= hash_val >> 13;
+  hash_val *= 0xc2b2ae35;
+  hash_val ^= hash_val >> 16;
+
+  return hash_val;
+}
+
+static inline gint
+g_hash_nearest_pow (gint num)
+{
+  gint n = HASH_TABLE_MIN_POW2_SIZE;
+
+  while (n < num && n < HASH_TABLE_MAX_POW2_SIZE)
+    n <<= 1;
+
+  return n;
+}
+
+/* bucket array size of a chained table holding n_entries */
+static inline gint
+g_hash_table_chained_size (GHashTable *hash_table,
+			   gint        n_entries)
+{
+  if (G_HASH_TABLE_IS_POW2 (hash_table))
+    return g_hash_nearest_pow (n_entries);
+  else
+    return CLAMP (g_spaced_primes_closest (n_entries),
+		  HASH_TABLE_MIN_SIZE,
+		  HASH_TABLE_MAX_SIZE);
+}
+
+
 GHashTable*
 g_hash_table_new (GHashFunc    hash_func,
 		  GCompareFunc key_compare_func)
+{
+  return g_hash_table_new_full (hash_func, key_compare_func, 0);
+}
+
+GHashTable*
+g_hash_table_new_full (GHashFunc       hash_func,
+		       GCompareFunc    key_compare_func,
+		       GHashTableFlags flags)
 {
   GHashTable *hash_table;
   guint i;
   
+  /* incremental resizing only applies to chained tables */
+  g_return_val_if_fail ((flags & G_HASH_TABLE_OPEN_ADDRESSING) == 0 ||
+			(flags & G_HASH_TABLE_INCREMENTAL_RESIZE) == 0, NULL);
+  
   hash_table = g_new (GHashTable, 1);
-  hash_table->size = HASH_TABLE_MIN_SIZE;
+  hash_table->flags = flags;
+  hash_table->size = G_HASH_TABLE_MIN_SIZE (hash_table);
   hash_table->nnodes = 0;
   hash_table->frozen = FALSE;
   hash_table->hash_func = hash_func ? hash_func : g_direct_hash;
   hash_table->key_compare_func = key_compare_func;
-  hash_table->nodes = g_new (GHashNode*, hash_table->size);
+  hash_table->noccupied = 0;
+  hash_table->old_nodes = NULL;
+  hash_table->old_size = 0;
+  hash_table->rehash_index = 0;
   
-  for (i = 0; i < hash_table->size; i++)
-    hash_table->nodes[i] = NULL;
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      hash_table->nodes = NULL;
+      hash_table->hashes = g_new0 (guint, hash_table->size);
+      hash_table->keys = g_new (gpointer, hash_table->size);
+      hash_table->values = g_new (gpointer, hash_table->size);
+    }
+  else
+    {
+      hash_table->hashes = NULL;
+      hash_table->keys = NULL;
+      hash_table->values = NULL;
+      hash_table->nodes = g_new (GHashNode*, hash_table->size);
+  
+      for (i = 0; i < hash_table->size; i++)
+	hash_table->nodes[i] = NULL;
+    }
   
   return hash_table;
 }
@@ -106,21 +279,92 @@ g_hash_table_destroy (GHashTable *hash_table)
   
   g_return_if_fail (hash_table != NULL);
   
-  for (i = 0; i < hash_table->size; i++)
-    g_hash_nodes_destroy (hash_table->nodes[i]);
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      g_free (hash_table->hashes);
+      g_free (hash_table->keys);
+      g_free (hash_table->values);
+    }
+  else
+    {
+      for (i = 0; i < hash_table->size; i++)
+	g_hash_nodes_destroy (hash_table->nodes[i]);
+      if (hash_table->old_nodes)
+	for (i = hash_table->rehash_index; i < hash_table->old_size; i++)
+	  g_hash_nodes_destroy (hash_table->old_nodes[i]);
   
-  g_free (hash_table->nodes);
+      g_free (hash_table->nodes);
+      g_free (hash_table->old_nodes);
+    }
   g_free (hash_table);
 }
 
+/* Returns the slot holding `key' if it is contained in the table,
+ * otherwise the slot an insertion of `key' should go to, which is
+ * either the first tombstone or the unused slot that ended the probe
+ * sequence. Callers tell the two cases apart by checking the cached
+ * hash value of the returned slot with HASH_IS_REAL().
+ * `hash_value' must have gone through G_HASH_TABLE_OA_HASH().
+ */
+static inline guint
+g_hash_table_lookup_slot (GHashTable    *hash_table,
+			  gconstpointer  key,
+			  guint          hash_value)
+{
+  guint slot;
+  guint tombstone = 0;
+  gboolean have_tombstone = FALSE;
+  
+  slot = G_HASH_TABLE_INDEX (hash_table, hash_value, hash_table->size);
+  
+  /* the cached hash codes are compared first, so key_compare_func
+   * only gets called for real candidates.
+   */
+  while (hash_table->hashes[slot] != UNUSED_HASH_VALUE)
+    {
+      guint node_hash = hash_table->hashes[slot];
+      
+      if (node_hash == hash_value)
+	{
+	  if (hash_table->key_compare_func)
+	    {
+	      if ((*hash_table->key_compare_func) (hash_table->keys[slot], key))
+		return slot;
+	    }
+	  else if (hash_table->keys[slot] == key)
+	    return slot;
+	}
+      else if (node_hash == TOMBSTONE_HASH_VALUE && !have_tombstone)
+	{
+	  tombstone = slot;
+	  have_tombstone = TRUE;
+	}
+      
+      slot++;
+      if (slot == hash_table->size)
+	slot = 0;
+    }
+  
+  return have_tombstone ? tombstone : slot;
+}
+
 static inline GHashNode**
 g_hash_table_lookup_node (GHashTable	*hash_table,
-			  gconstpointer	 key)
+			  gconstpointer	 key,
+			  guint		 hash_val)
 {
   GHashNode **node;
   
-  node = &hash_table->nodes
-    [(* hash_table->hash_func) (key) % hash_table->size];
+  /* while resizing incrementally, a key lives in the old bucket array
+   * until its bucket got migrated.
+   */
+  if (hash_table->old_nodes &&
+      G_HASH_TABLE_INDEX (hash_table, hash_val, hash_table->old_size) >= hash_table->rehash_index)
+    node = &hash_table->old_nodes[G_HASH_TABLE_INDEX (hash_table, hash_val,
+						      hash_table->old_size)];
+  else
+    node = &hash_table->nodes[G_HASH_TABLE_INDEX (hash_table, hash_val,
+						  hash_table->size)];
   
   /* Hash table lookup needs to be fast.
    *  We therefore remove the extra conditional of testing
@@ -137,29 +381,69 @@ g_hash_table_lookup_node (GHashTable	*hash_table,
   return node;
 }
 
-gpointer
-g_hash_table_lookup (GHashTable	  *hash_table,
-		     gconstpointer key)
+static inline gpointer
+g_hash_table_lookup_hashed (GHashTable	  *hash_table,
+			    gconstpointer  key,
+			    guint	   hash_val)
 {
   GHashNode *node;
   
-  g_return_val_if_fail (hash_table != NULL, NULL);
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      guint slot = g_hash_table_lookup_slot (hash_table, key,
+					     G_HASH_TABLE_OA_HASH (hash_val));
+      
+      return HASH_IS_REAL (hash_table->hashes[slot]) ? hash_table->values[slot] : NULL;
+    }
   
-  node = *g_hash_table_lookup_node (hash_table, key);
+  node = *g_hash_table_lookup_node (hash_table, key, hash_val);
   
   return node ? node->value : NULL;
 }
 
-void
-g_hash_table_insert (GHashTable *hash_table,
-		     gpointer	 key,
-		     gpointer	 value)
+gpointer
+g_hash_table_lookup (GHashTable	  *hash_table,
+		     gconstpointer key)
+{
+  g_return_val_if_fail (hash_table != NULL, NULL);
+  
+  return g_hash_table_lookup_hashed (hash_table, key,
+				     (* hash_table->hash_func) (key));
+}
+
+static inline void
+g_hash_table_insert_hashed (GHashTable *hash_table,
+			    gpointer	key,
+			    gpointer	value,
+			    guint	hash_val)
 {
   GHashNode **node;
   
-  g_return_if_fail (hash_table != NULL);
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      guint hash_value = G_HASH_TABLE_OA_HASH (hash_val);
+      guint slot = g_hash_table_lookup_slot (hash_table, key, hash_value);
+      guint old_hash = hash_table->hashes[slot];
+      
+      if (HASH_IS_REAL (old_hash))
+	{
+	  /* keep the old key, see below */
+	  hash_table->values[slot] = value;
+	}
+      else
+	{
+	  hash_table->hashes[slot] = hash_value;
+	  hash_table->keys[slot] = key;
+	  hash_table->values[slot] = value;
+	  hash_table->nnodes++;
+	  if (old_hash == UNUSED_HASH_VALUE)
+	    hash_table->noccupied++;
+	  G_HASH_TABLE_OA_RESIZE (hash_table);
+	}
+      return;
+    }
   
-  node = g_hash_table_lookup_node (hash_table, key);
+  node = g_hash_table_lookup_node (hash_table, key, hash_val);
   
   if (*node)
     {
@@ -181,14 +465,45 @@ g_hash_table_insert (GHashTable *hash_table,
 }
 
 void
-g_hash_table_remove (GHashTable	     *hash_table,
-		     gconstpointer    key)
+g_hash_table_insert (GHashTable *hash_table,
+		     gpointer	 key,
+		     gpointer	 value)
+{
+  g_return_if_fail (hash_table != NULL);
+  
+  G_HASH_TABLE_REHASH_STEP (hash_table);
+  
+  g_hash_table_insert_hashed (hash_table, key, value,
+			      (* hash_table->hash_func) (key));
+}
+
+static inline void
+g_hash_table_remove_hashed (GHashTable	 *hash_table,
+			    gconstpointer key,
+			    guint	  hash_val)
 {
   GHashNode **node, *dest;
   
-  g_return_if_fail (hash_table != NULL);
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      guint slot = g_hash_table_lookup_slot (hash_table, key,
+					     G_HASH_TABLE_OA_HASH (hash_val));
+      
+      if (HASH_IS_REAL (hash_table->hashes[slot]))
+	{
+	  hash_table->hashes[slot] = TOMBSTONE_HASH_VALUE;
+	  hash_table->keys[slot] = NULL;
+	  hash_table->values[slot] = NULL;
+	  hash_table->nnodes--;
+	  
+	  G_HASH_TABLE_OA_RESIZE (hash_table);
+	}
+      return;
+    }
   
-  node = g_hash_table_lookup_node (hash_table, key);
+  G_HASH_TABLE_REHASH_STEP (hash_table);
+  
+  node = g_hash_table_lookup_node (hash_table, key, hash_val);
 
   if (*node)
     {
@@ -202,17 +517,41 @@ g_hash_table_remove (GHashTable	     *hash_table,
     }
 }
 
-gboolean
-g_hash_table_lookup_extended (GHashTable	*hash_table,
-			      gconstpointer	 lookup_key,
-			      gpointer		*orig_key,
-			      gpointer		*value)
+void
+g_hash_table_remove (GHashTable	     *hash_table,
+		     gconstpointer    key)
+{
+  g_return_if_fail (hash_table != NULL);
+  
+  g_hash_table_remove_hashed (hash_table, key,
+			      (* hash_table->hash_func) (key));
+}
+
+static inline gboolean
+g_hash_table_lookup_extended_hashed (GHashTable	  *hash_table,
+				     gconstpointer  lookup_key,
+				     gpointer	   *orig_key,
+				     gpointer	   *value,
+				     guint	    hash_val)
 {
   GHashNode *node;
   
-  g_return_val_if_fail (hash_table != NULL, FALSE);
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      guint slot = g_hash_table_lookup_slot (hash_table, lookup_key,
+					     G_HASH_TABLE_OA_HASH (hash_val));
+      
+      if (!HASH_IS_REAL (hash_table->hashes[slot]))
+	return FALSE;
+      
+      if (orig_key)
+	*orig_key = hash_table->keys[slot];
+      if (value)
+	*value = hash_table->values[slot];
+      return TRUE;
+    }
   
-  node = *g_hash_table_lookup_node (hash_table, lookup_key);
+  node = *g_hash_table_lookup_node (hash_table, lookup_key, hash_val);
   
   if (node)
     {
@@ -226,6 +565,157 @@ g_hash_table_lookup_extended (GHashTable	*hash_table,
     return FALSE;
 }
 
+gboolean
+g_hash_table_lookup_extended (GHashTable	*hash_table,
+			      gconstpointer	 lookup_key,
+			      gpointer		*orig_key,
+			      gpointer		*value)
+{
+  g_return_val_if_fail (hash_table != NULL, FALSE);
+  
+  return g_hash_table_lookup_extended_hashed (hash_table, lookup_key,
+					      orig_key, value,
+					      (* hash_table->hash_func) (lookup_key));
+}
+
+/* grows the table once so another n_new entries fit without resizing */
+static void
+g_hash_table_presize (GHashTable *hash_table,
+		      guint       n_new)
+{
+  gint n_entries = hash_table->nnodes + MIN (n_new, G_MAXINT / 4);
+  
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      if (4 * (hash_table->noccupied + n_entries - hash_table->nnodes) > 3 * hash_table->size)
+	g_hash_table_oa_resize (hash_table, n_entries);
+    }
+  else
+    {
+      gint new_size = g_hash_table_chained_size (hash_table, n_entries);
+      
+      if (new_size > hash_table->size)
+	g_hash_table_resize_to (hash_table, new_size);
+    }
+}
+
+/* address of the bucket (or first probe slot) a hash value maps to,
+ * used to prefetch it
+ */
+static inline gconstpointer
+g_hash_table_bucket_address (GHashTable *hash_table,
+			     guint       hash_val)
+{
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    return &hash_table->hashes[G_HASH_TABLE_INDEX (hash_table, G_HASH_TABLE_OA_HASH (hash_val),
+						   hash_table->size)];
+  else if (hash_table->old_nodes &&
+	   G_HASH_TABLE_INDEX (hash_table, hash_val, hash_table->old_size) >= hash_table->rehash_index)
+    return &hash_table->old_nodes[G_HASH_TABLE_INDEX (hash_table, hash_val,
+						      hash_table->old_size)];
+  else
+    return &hash_table->nodes[G_HASH_TABLE_INDEX (hash_table, hash_val,
+						  hash_table->size)];
+}
+
+/* Bulk insertion and lookup. The hash values of a batch of keys are
+ * computed and their buckets prefetched before the first one gets
+ * probed, so the cache misses of a batch overlap instead of being
+ * taken one after another.
+ */
+void
+g_hash_table_insert_many (GHashTable *hash_table,
+			  gpointer   *keys,
+			  gpointer   *values,
+			  guint       n_keys)
+{
+  guint hashes[HASH_TABLE_BATCH_SIZE];
+  guint base;
+  guint i, n;
+  
+  g_return_if_fail (hash_table != NULL);
+  g_return_if_fail (keys != NULL || n_keys == 0);
+  g_return_if_fail (values != NULL || n_keys == 0);
+  
+  if (!n_keys)
+    return;
+  
+  /* size the table for all of the keys at once, and keep it frozen
+   * so it doesn't resize while the batch gets inserted.
+   */
+  g_hash_table_presize (hash_table, n_keys);
+  hash_table->frozen++;
+  
+  for (base = 0; base < n_keys; base += n)
+    {
+      n = MIN (n_keys - base, HASH_TABLE_BATCH_SIZE);
+      
+      G_HASH_TABLE_REHASH_STEP (hash_table);
+      
+      for (i = 0; i < n; i++)
+	{
+	  hashes[i] = (* hash_table->hash_func) (keys[base + i]);
+	  HASH_PREFETCH (g_hash_table_bucket_address (hash_table, hashes[i]));
+	}
+      for (i = 0; i < n; i++)
+	g_hash_table_insert_hashed (hash_table, keys[base + i], values[base + i],
+				    hashes[i]);
+    }
+  
+  g_hash_table_thaw (hash_table);
+}
+
+/* stores the value of keys[i] in values[i], or NULL if keys[i]
+ * isn't contained in the table
+ */
+void
+g_hash_table_lookup_many (GHashTable	*hash_table,
+			  gconstpointer *keys,
+			  gpointer	*values,
+			  guint		 n_keys)
+{
+  guint hashes[HASH_TABLE_BATCH_SIZE];
+  guint base;
+  guint i, n;
+  
+  g_return_if_fail (hash_table != NULL);
+  g_return_if_fail (keys != NULL || n_keys == 0);
+  g_return_if_fail (values != NULL || n_keys == 0);
+  
+  for (base = 0; base < n_keys; base += n)
+    {
+      n = MIN (n_keys - base, HASH_TABLE_BATCH_SIZE);
+      
+      for (i = 0; i < n; i++)
+	{
+	  hashes[i] = (* hash_table->hash_func) (keys[base + i]);
+	  HASH_PREFETCH (g_hash_table_bucket_address (hash_table, hashes[i]));
+	}
+      
+      /* now that the buckets are on their way, fetch the first node
+       * of each chain, or the key of each first probe slot.
+       */
+      for (i = 0; i < n; i++)
+	{
+	  if (G_HASH_TABLE_IS_OA (hash_table))
+	    HASH_PREFETCH (&hash_table->keys[G_HASH_TABLE_INDEX (hash_table,
+								 G_HASH_TABLE_OA_HASH (hashes[i]),
+								 hash_table->size)]);
+	  else
+	    {
+	      GHashNode *const *bucket = g_hash_table_bucket_address (hash_table, hashes[i]);
+	      
+	      if (*bucket)
+		HASH_PREFETCH (*bucket);
+	    }
+	}
+      
+      for (i = 0; i < n; i++)
+	values[base + i] = g_hash_table_lookup_hashed (hash_table, keys[base + i],
+						       hashes[i]);
+    }
+}
+
 void
 g_hash_table_freeze (GHashTable *hash_table)
 {
@@ -241,28 +731,33 @@ g_hash_table_thaw (GHashTable *hash_table)
   
   if (hash_table->frozen)
     if (!(--hash_table->frozen))
-      G_HASH_TABLE_RESIZE (hash_table);
+      {
+	if (G_HASH_TABLE_IS_OA (hash_table))
+	  G_HASH_TABLE_OA_RESIZE (hash_table);
+	else
+	  G_HASH_TABLE_RESIZE (hash_table);
+      }
 }
 
-guint
-g_hash_table_foreach_remove (GHashTable	*hash_table,
+static guint
+g_hash_nodes_foreach_remove (GHashTable	*hash_table,
+			     GHashNode	**nodes,
+			     gint	 first,
+			     gint	 size,
 			     GHRFunc	 func,
 			     gpointer	 user_data)
 {
   GHashNode *node, *prev;
-  guint i;
+  gint i;
   guint deleted = 0;
   
-  g_return_val_if_fail (hash_table != NULL, 0);
-  g_return_val_if_fail (func != NULL, 0);
-  
-  for (i = 0; i < hash_table->size; i++)
+  for (i = first; i < size; i++)
     {
     restart:
       
       prev = NULL;
       
-      for (node = hash_table->nodes[i]; node; prev = node, node = node->next)
+      for (node = nodes[i]; node; prev = node, node = node->next)
 	{
 	  if ((* func) (node->key, node->value, user_data))
 	    {
@@ -278,7 +773,7 @@ g_hash_table_foreach_remove (GHashTable	*hash_table,
 		}
 	      else
 		{
-		  hash_table->nodes[i] = node->next;
+		  nodes[i] = node->next;
 		  g_hash_node_destroy (node);
 		  goto restart;
 		}
@@ -286,6 +781,47 @@ g_hash_table_foreach_remove (GHashTable	*hash_table,
 	}
     }
   
+  return deleted;
+}
+
+guint
+g_hash_table_foreach_remove (GHashTable	*hash_table,
+			     GHRFunc	 func,
+			     gpointer	 user_data)
+{
+  guint i;
+  guint deleted = 0;
+  
+  g_return_val_if_fail (hash_table != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+  
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      for (i = 0; i < hash_table->size; i++)
+	if (HASH_IS_REAL (hash_table->hashes[i]) &&
+	    (* func) (hash_table->keys[i], hash_table->values[i], user_data))
+	  {
+	    hash_table->hashes[i] = TOMBSTONE_HASH_VALUE;
+	    hash_table->keys[i] = NULL;
+	    hash_table->values[i] = NULL;
+	    hash_table->nnodes -= 1;
+	    deleted += 1;
+	  }
+      
+      G_HASH_TABLE_OA_RESIZE (hash_table);
+      
+      return deleted;
+    }
+  
+  deleted = g_hash_nodes_foreach_remove (hash_table, hash_table->nodes,
+					 0, hash_table->size,
+					 func, user_data);
+  if (hash_table->old_nodes)
+    deleted += g_hash_nodes_foreach_remove (hash_table, hash_table->old_nodes,
+					    hash_table->rehash_index,
+					    hash_table->old_size,
+					    func, user_data);
+  
   if (!hash_table->frozen)
     G_HASH_TABLE_RESIZE (hash_table);
   
@@ -303,9 +839,21 @@ g_hash_table_foreach (GHashTable *hash_table,
   g_return_if_fail (hash_table != NULL);
   g_return_if_fail (func != NULL);
   
+  if (G_HASH_TABLE_IS_OA (hash_table))
+    {
+      for (i = 0; i < hash_table->size; i++)
+	if (HASH_IS_REAL (hash_table->hashes[i]))
+	  (* func) (hash_table->keys[i], hash_table->values[i], user_data);
+      return;
+    }
+  
   for (i = 0; i < hash_table->size; i++)
     for (node = hash_table->nodes[i]; node; node = node->next)
       (* func) (node->key, node->value, user_data);
+  if (hash_table->old_nodes)
+    for (i = hash_table->rehash_index; i < hash_table->old_size; i++)
+      for (node = hash_table->old_nodes[i]; node; node = node->next)
+	(* func) (node->key, node->value, user_data);
 }
 
 /* Returns the number of elements contained in the hash table. */
@@ -319,17 +867,48 @@ g_hash_table_size (GHashTable *hash_table)
 
 static void
 g_hash_table_resize (GHashTable *hash_table)
+{
+  g_hash_table_resize_to (hash_table,
+			  g_hash_table_chained_size (hash_table, hash_table->nnodes));
+}
+
+static void
+g_hash_table_resize_to (GHashTable *hash_table,
+			gint        new_size)
+{
+  if (hash_table->flags & G_HASH_TABLE_INCREMENTAL_RESIZE)
+    {
+      /* there is only room for one old bucket array, so while a
+       * previous resize is still in progress the new one is put off
+       * until that has been migrated; g_hash_table_rehash_step()
+       * checks the size again then.
+       */
+      if (hash_table->old_nodes)
+	return;
+      
+      hash_table->old_nodes = hash_table->nodes;
+      hash_table->old_size = hash_table->size;
+      hash_table->rehash_index = 0;
+      hash_table->nodes = g_new0 (GHashNode*, new_size);
+      hash_table->size = new_size;
+    }
+  else
+    g_hash_table_rehash (hash_table, new_size);
+}
+
+/* immediately moves all nodes of a chained table into a new bucket
+ * array of new_size
+ */
+static void
+g_hash_table_rehash (GHashTable *hash_table,
+		     gint        new_size)
 {
   GHashNode **new_nodes;
   GHashNode *node;
   GHashNode *next;
   guint hash_val;
-  gint new_size;
   gint i;
 
-  new_size = CLAMP(g_spaced_primes_closest (hash_table->nnodes),
-		   HASH_TABLE_MIN_SIZE,
-		   HASH_TABLE_MAX_SIZE);
   new_nodes = g_new0 (GHashNode*, new_size);
   
   for (i = 0; i < hash_table->size; i++)
@@ -337,7 +916,8 @@ g_hash_table_resize (GHashTable *hash_table)
       {
 	next = node->next;
 
-	hash_val = (* hash_table->hash_func) (node->key) % new_size;
+	hash_val = (* hash_table->hash_func) (node->key);
+	hash_val = G_HASH_TABLE_INDEX (hash_table, hash_val, new_size);
 
 	node->next = new_nodes[hash_val];
 	new_nodes[hash_val] = node;
@@ -348,6 +928,116 @@ g_hash_table_resize (GHashTable *hash_table)
   hash_table->size = new_size;
 }
 
+/* moves the nodes of up to n_buckets old buckets over into the
+ * current bucket array, and releases the old array once it is drained.
+ */
+static void
+g_hash_table_rehash_step (GHashTable *hash_table,
+			  gint        n_buckets)
+{
+  GHashNode *node;
+  GHashNode *next;
+  guint hash_val;
+  gint end;
+  gint i;
+
+  end = MIN (hash_table->rehash_index + n_buckets, hash_table->old_size);
+  
+  for (i = hash_table->rehash_index; i < end; i++)
+    {
+      for (node = hash_table->old_nodes[i]; node; node = next)
+	{
+	  next = node->next;
+	  
+	  hash_val = (* hash_table->hash_func) (node->key);
+	  hash_val = G_HASH_TABLE_INDEX (hash_table, hash_val, hash_table->size);
+	  
+	  node->next = hash_table->nodes[hash_val];
+	  hash_table->nodes[hash_val] = node;
+	}
+      hash_table->old_nodes[i] = NULL;
+    }
+  hash_table->rehash_index = end;
+  
+  if (hash_table->rehash_index >= hash_table->old_size)
+    {
+      g_free (hash_table->old_nodes);
+      hash_table->old_nodes = NULL;
+      hash_table->old_size = 0;
+      hash_table->rehash_index = 0;
+      
+      if (!hash_table->frozen)
+	G_HASH_TABLE_RESIZE (hash_table);
+    }
+}
+
+/* resizes an open addressed table to hold n_entries,
+ * which must be at least nnodes
+ */
+static void
+g_hash_table_oa_resize (GHashTable *hash_table,
+			gint        n_entries)
+{
+  guint *new_hashes;
+  gpointer *new_keys;
+  gpointer *new_values;
+  guint want;
+  gint new_size;
+  gint i;
+
+  /* aim at a load factor between 1/4 and 1/2 after resizing; this
+   * also gets rid of all tombstones. beyond the largest prime we know
+   * about, any odd size will do.
+   */
+  want = MAX (n_entries, HASH_TABLE_MIN_SIZE / 2) * 2;
+  if (G_HASH_TABLE_IS_POW2 (hash_table))
+    {
+      new_size = HASH_TABLE_MIN_POW2_SIZE;
+      while (new_size < want)
+	new_size <<= 1;
+    }
+  else
+    {
+      new_size = g_spaced_primes_closest (want);
+      if (new_size <= want)
+	new_size = want | 1;
+    }
+  
+  new_hashes = g_new0 (guint, new_size);
+  new_keys = g_new (gpointer, new_size);
+  new_values = g_new (gpointer, new_size);
+  
+  /* the cached hash codes spare us calling hash_func again */
+  for (i = 0; i < hash_table->size; i++)
+    {
+      guint hash_value = hash_table->hashes[i];
+      guint slot;
+      
+      if (!HASH_IS_REAL (hash_value))
+	continue;
+      
+      slot = G_HASH_TABLE_INDEX (hash_table, hash_value, new_size);
+      while (new_hashes[slot] != UNUSED_HASH_VALUE)
+	{
+	  slot++;
+	  if (slot == new_size)
+	    slot = 0;
+	}
+      new_hashes[slot] = hash_value;
+      new_keys[slot] = hash_table->keys[i];
+      new_values[slot] = hash_table->values[i];
+    }
+  
+  g_free (hash_table->hashes);
+  g_free (hash_table->keys);
+  g_free (hash_table->values);
+  hash_table->hashes = new_hashes;
+  hash_table->keys = new_keys;
+  hash_table->values = new_values;
+  hash_table->size = new_size;
+  hash_table->noccupied = hash_table->nnodes;
+}
+
 static GHashNode*
 g_hash_node_new (gpointer key,
 		 gpointer value)
@@ -403,3 +1093,600 @@ g_hash_nodes_destroy (GHashNode *hash_node)
       G_UNLOCK (g_hash_global);
     }
 }
+
+
+/* GConcurrentHashTable, a hash table that can be shared between
+ * threads. Keys are striped across a power of two number of shard
+ * tables by the high bits of their hash value, and each shard has a
+ * lock of its own, so threads only contend when they happen to work
+ * on the same shard. The shards are open addressed, which keeps them
+ * off the global node allocator lock of the chained tables.
+ *
+ * The shard locks are allocated through the thread function vtable
+ * when the table is created, so a table meant to be shared must be
+ * created after g_thread_init().
+ */
+#define CONCURRENT_HASH_DEFAULT_SHARDS	16
+#define CONCURRENT_HASH_MAX_SHARDS	256
+
+typedef struct _GHashShard	GHashShard;
+
+struct _GHashShard
+{
+  GMutex *lock;
+  GHashTable *table;
+};
+
+struct _GConcurrentHashTable
+{
+  guint n_shards;
+  guint shard_shift;
+  GHashFunc hash_func;
+  GHashShard *shards;
+};
+
+/* the shard tables select slots by the low bits of g_hash_mix(), so
+ * the shard is picked by a different (multiplicative) hash to keep
+ * the keys of one shard spread over all of its slots.
+ */
+#define G_CONCURRENT_HASH_SHARD(table, hash_val)			\
+   (&(table)->shards[(table)->n_shards > 1 ?				\
+		     ((guint32) ((hash_val) * 2654435769U)) >> (table)->shard_shift : 0])
+
+/* tables created before g_thread_init() have no shard locks */
+#define G_HASH_SHARD_LOCK(shard)		\
+   G_STMT_START {				\
+     if ((shard)->lock)				\
+       g_mutex_lock ((shard)->lock);		\
+   } G_STMT_END
+#define G_HASH_SHARD_UNLOCK(shard)		\
+   G_STMT_START {				\
+     if ((shard)->lock)				\
+       g_mutex_unlock ((shard)->lock);		\
+   } G_STMT_END
+
+GConcurrentHashTable*
+g_concurrent_hash_table_new (GHashFunc    hash_func,
+			     GCompareFunc key_compare_func,
+			     guint	  n_shards)
+{
+  GConcurrentHashTable *table;
+  guint i;
+  
+  if (!n_shards)
+    n_shards = CONCURRENT_HASH_DEFAULT_SHARDS;
+  n_shards = MIN (n_shards, CONCURRENT_HASH_MAX_SHARDS);
+  
+  table = g_new (GConcurrentHashTable, 1);
+  table->hash_func = hash_func ? hash_func : g_direct_hash;
+  table->n_shards = 1;
+  table->shard_shift = 32;
+  while (table->n_shards < n_shards)
+    {
+      table->n_shards <<= 1;
+      table->shard_shift--;
+    }
+  
+  table->shards = g_new (GHashShard, table->n_shards);
+  for (i = 0; i < table->n_shards; i++)
+    {
+      table->shards[i].lock = g_thread_supported () ? g_mutex_new () : NULL;
+      table->shards[i].table = g_hash_table_new_full (table->hash_func, key_compare_func,
+						      G_HASH_TABLE_OPEN_ADDRESSING |
+						      G_HASH_TABLE_POWER_OF_TWO);
+    }
+  
+  return table;
+}
+
+void
+g_concurrent_hash_table_destroy (GConcurrentHashTable *table)
+{
+  guint i;
+  
+  g_return_if_fail (table != NULL);
+  
+  for (i = 0; i < table->n_shards; i++)
+    {
+      g_hash_table_destroy (table->shards[i].table);
+      if (table->shards[i].lock)
+	g_mutex_free (table->shards[i].lock);
+    }
+  g_free (table->shards);
+  g_free (table);
+}
+
+void
+g_concurrent_hash_table_insert (GConcurrentHashTable *table,
+				gpointer	      key,
+				gpointer	      value)
+{
+  GHashShard *shard;
+  guint hash_val;
+  
+  g_return_if_fail (table != NULL);
+  
+  hash_val = (* table->hash_func) (key);
+  shard = G_CONCURRENT_HASH_SHARD (table, hash_val);
+  
+  G_HASH_SHARD_LOCK (shard);
+  g_hash_table_insert_hashed (shard->table, key, value, hash_val);
+  G_HASH_SHARD_UNLOCK (shard);
+}
+
+void
+g_concurrent_hash_table_remove (GConcurrentHashTable *table,
+				gconstpointer	      key)
+{
+  GHashShard *shard;
+  guint hash_val;
+  
+  g_return_if_fail (table != NULL);
+  
+  hash_val = (* table->hash_func) (key);
+  shard = G_CONCURRENT_HASH_SHARD (table, hash_val);
+  
+  G_HASH_SHARD_LOCK (shard);
+  g_hash_table_remove_hashed (shard->table, key, hash_val);
+  G_HASH_SHARD_UNLOCK (shard);
+}
+
+gpointer
+g_concurrent_hash_table_lookup (GConcurrentHashTable *table,
+				gconstpointer	      key)
+{
+  GHashShard *shard;
+  gpointer value;
+  guint hash_val;
+  
+  g_return_val_if_fail (table != NULL, NULL);
+  
+  hash_val = (* table->hash_func) (key);
+  shard = G_CONCURRENT_HASH_SHARD (table, hash_val);
+  
+  G_HASH_SHARD_LOCK (shard);
+  value = g_hash_table_lookup_hashed (shard->table, key, hash_val);
+  G_HASH_SHARD_UNLOCK (shard);
+  
+  return value;
+}
+
+gboolean
+g_concurrent_hash_table_lookup_extended (GConcurrentHashTable *table,
+					 gconstpointer	       lookup_key,
+					 gpointer	      *orig_key,
+					 gpointer	      *value)
+{
+  GHashShard *shard;
+  gboolean found;
+  guint hash_val;
+  
+  g_return_val_if_fail (table != NULL, FALSE);
+  
+  hash_val = (* table->hash_func) (lookup_key);
+  shard = G_CONCURRENT_HASH_SHARD (table, hash_val);
+  
+  G_HASH_SHARD_LOCK (shard);
+  found = g_hash_table_lookup_extended_hashed (shard->table, lookup_key,
+					       orig_key, value, hash_val);
+  G_HASH_SHARD_UNLOCK (shard);
+  
+  return found;
+}
+
+/* the shards are visited one after another, each with its lock held
+ * while `func' runs on its entries, so `func' must not call back into
+ * the table.
+ */
+void
+g_concurrent_hash_table_foreach (GConcurrentHashTable *table,
+				 GHFunc		       func,
+				 gpointer	       user_data)
+{
+  guint i;
+  
+  g_return_if_fail (table != NULL);
+  g_return_if_fail (func != NULL);
+  
+  for (i = 0; i < table->n_shards; i++)
+    {
+      G_HASH_SHARD_LOCK (&table->shards[i]);
+      g_hash_table_foreach (table->shards[i].table, func, user_data);
+      G_HASH_SHARD_UNLOCK (&table->shards[i]);
+    }
+}
+
+guint
+g_concurrent_hash_table_foreach_remove (GConcurrentHashTable *table,
+					GHRFunc		      func,
+					gpointer	      user_data)
+{
+  guint deleted = 0;
+  guint i;
+  
+  g_return_val_if_fail (table != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+  
+  for (i = 0; i < table->n_shards; i++)
+    {
+      G_HASH_SHARD_LOCK (&table->shards[i]);
+      deleted += g_hash_table_foreach_remove (table->shards[i].table, func, user_data);
+      G_HASH_SHARD_UNLOCK (&table->shards[i]);
+    }
+  
+  return deleted;
+}
+
+/* the sum of the shard sizes, which is only a snapshot if other
+ * threads modify the table meanwhile
+ */
+guint
+g_concurrent_hash_table_size (GConcurrentHashTable *table)
+{
+  guint size = 0;
+  guint i;
+  
+  g_return_val_if_fail (table != NULL, 0);
+  
+  for (i = 0; i < table->n_shards; i++)
+    {
+      G_HASH_SHARD_LOCK (&table->shards[i]);
+      size += g_hash_table_size (table->shards[i].table);
+      G_HASH_SHARD_UNLOCK (&table->shards[i]);
+    }
+  
+  return size;
+}
+
+
+/* Snapshots
+ *
+ * An image holds the header, the key and value bytes, then the bucket
+ * index and the entries sorted by bucket: entries[buckets[i]] up to
+ * entries[buckets[i + 1]] are those of bucket i. Offsets count from
+ * the start of the file. Every key is followed by at least one nul
+ * byte of padding, so that string compare functions stop in time
+ * whatever the bytes of the key are.
+ */
+#define HASH_SNAPSHOT_MAGIC	"GHashV1"
+#define HASH_SNAPSHOT_ALIGN(n)	(((n) + 7) & ~((gulong) 7))
+
+typedef struct _GHashSnapshotHeader GHashSnapshotHeader;
+typedef struct _GHashSnapshotEntry  GHashSnapshotEntry;
+typedef struct _GHashSnapshotWriter GHashSnapshotWriter;
+
+struct _GHashSnapshotHeader
+{
+  gchar	  magic[8];
+  guint32 byte_order;
+  guint32 sizeof_long;
+  gulong  length;		/* of the file */
+  gulong  n_entries;
+  gulong  n_buckets;
+  gulong  buckets;
+  gulong  entries;
+};
+
+struct _GHashSnapshotEntry
+{
+  guint	  hash;
+  guint	  key_length;
+  guint	  value_length;
+  guint	  reserved;
+  gulong  key;
+  gulong  value;
+};
+
+struct _GHashSnapshotWriter
+{
+  FILE		     *file;
+  gulong	      offset;
+  gboolean	      failed;
+  GHashFunc	      hash_func;
+  GSnapshotFunc	      key_func;
+  GSnapshotFunc	      value_func;
+  gpointer	      user_data;
+  GHashSnapshotEntry *entries;
+  gulong	      n_entries;
+};
+
+struct _GMappedHashTable
+{
+  GMappedFile		    *file;
+  const gchar		    *image;
+  const GHashSnapshotHeader *header;
+  const gulong		    *buckets;
+  const GHashSnapshotEntry  *entries;
+  GHashFunc		     hash_func;
+  GCompareFunc		     key_compare_func;
+};
+
+static void
+g_hash_snapshot_write (GHashSnapshotWriter *writer,
+		       gconstpointer	    data,
+		       gulong		    length,
+		       gboolean		    terminate)
+{
+  static const gchar padding[8] = { 0, };
+  gulong n_padding = HASH_SNAPSHOT_ALIGN (length + (terminate != FALSE)) - length;
+
+  if (writer->failed)
+    return;
+  if ((length > 0 && fwrite (data, 1, length, writer->file) != length) ||
+      (n_padding > 0 && fwrite (padding, 1, n_padding, writer->file) != n_padding))
+    writer->failed = TRUE;
+  writer->offset += length + n_padding;
+}
+
+static gconstpointer
+g_hash_snapshot_bytes (GSnapshotFunc func,
+		       gpointer	     item,
+		       guint	    *length,
+		       gpointer	     user_data)
+{
+  if (func)
+    return func (item, length, user_data);
+
+  *length = item ? strlen (item) + 1 : 0;
+
+  return item;
+}
+
+static void
+g_hash_snapshot_add (gpointer key,
+		     gpointer value,
+		     gpointer user_data)
+{
+  GHashSnapshotWriter *writer = user_data;
+  GHashSnapshotEntry *entry = &writer->entries[writer->n_entries++];
+  gconstpointer bytes;
+  guint length;
+
+  entry->hash = writer->hash_func (key);
+  entry->reserved = 0;
+
+  bytes = g_hash_snapshot_bytes (writer->key_func, key, &length, writer->user_data);
+  entry->key = writer->offset;
+  entry->key_length = length;
+  g_hash_snapshot_write (writer, bytes, length, TRUE);
+
+  bytes = g_hash_snapshot_bytes (writer->value_func, value, &length, writer->user_data);
+  entry->value = writer->offset;
+  entry->value_length = length;
+  g_hash_snapshot_write (writer, bytes, length, FALSE);
+}
+
+gboolean
+g_hash_table_save (GHashTable	 *hash_table,
+		   const gchar	 *file_name,
+		   GSnapshotFunc  key_func,
+		   GSnapshotFunc  value_func,
+		   gpointer	  user_data)
+{
+  GHashSnapshotWriter writer;
+  GHashSnapshotHeader header;
+  GHashSnapshotEntry *sorted;
+  gulong *buckets, *next;
+  gchar *tmp_name;
+  gulong i;
+
+  g_return_val_if_fail (hash_table != NULL, FALSE);
+  g_return_val_if_fail (file_name != NULL, FALSE);
+
+  /* write a new file and rename it over the old one, which may be
+   * mapped by other processes
+   */
+  tmp_name = g_strconcat (file_name, ".tmp", NULL);
+  writer.file = fopen (tmp_name, "wb");
+  if (!writer.file)
+    {
+      g_free (tmp_name);
+      return FALSE;
+    }
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, HASH_SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.byte_order = G_BYTE_ORDER;
+  header.sizeof_long = sizeof (glong);
+  header.n_entries = hash_table->nnodes;
+  header.n_buckets = g_spaced_primes_closest (MAX (header.n_entries, 1));
+  if (header.n_buckets < header.n_entries)
+    header.n_buckets = header.n_entries | 1;
+
+  writer.offset = 0;
+  writer.failed = FALSE;
+  writer.hash_func = hash_table->hash_func;
+  writer.key_func = key_func;
+  writer.value_func = value_func;
+  writer.user_data = user_data;
+  writer.entries = g_new (GHashSnapshotEntry, MAX (header.n_entries, 1));
+  writer.n_entries = 0;
+
+  g_hash_snapshot_write (&writer, &header, sizeof (header), FALSE);
+  g_hash_table_foreach (hash_table, g_hash_snapshot_add, &writer);
+
+  /* counting sort of the entries by bucket */
+  buckets = g_new0 (gulong, header.n_buckets + 1);
+  for (i = 0; i < writer.n_entries; i++)
+    buckets[writer.entries[i].hash % header.n_buckets + 1]++;
+  for (i = 0; i < header.n_buckets; i++)
+    buckets[i + 1] += buckets[i];
+  next = g_new (gulong, header.n_buckets);
+  memcpy (next, buckets, header.n_buckets * sizeof (gulong));
+  sorted = g_new (GHashSnapshotEntry, MAX (writer.n_entries, 1));
+  for (i = 0; i < writer.n_entries; i++)
+    sorted[next[writer.entries[i].hash % header.n_buckets]++] = writer.entries[i];
+  g_free (next);
+  g_free (writer.entries);
+
+  header.buckets = writer.offset;
+  g_hash_snapshot_write (&writer, buckets, (header.n_buckets + 1) * sizeof (gulong), FALSE);
+  header.entries = writer.offset;
+  g_hash_snapshot_write (&writer, sorted, writer.n_entries * sizeof (GHashSnapshotEntry), FALSE);
+  header.length = writer.offset;
+  g_free (sorted);
+  g_free (buckets);
+
+  if (!writer.failed &&
+      (fseek (writer.file, 0, SEEK_SET) != 0 ||
+       fwrite (&header, sizeof (header), 1, writer.file) != 1))
+    writer.failed = TRUE;
+  if (fclose (writer.file) != 0)
+    writer.failed = TRUE;
+
+#ifdef NATIVE_WIN32
+  if (!writer.failed)
+    remove (file_name);
+#endif /* NATIVE_WIN32 */
+  if (writer.failed || rename (tmp_name, file_name) != 0)
+    {
+      remove (tmp_name);
+      writer.failed = TRUE;
+    }
+  g_free (tmp_name);
+
+  return !writer.failed;
+}
+
+/* whether length bytes at offset lie within the image, followed by a
+ * nul byte if they are a key
+ */
+static gboolean
+g_hash_snapshot_check_bytes (const gchar *image,
+			     gulong	  image_length,
+			     gulong	  offset,
+			     gulong	  length,
+			     gboolean	  terminated)
+{
+  if (offset > image_length || length > image_length - offset)
+    return FALSE;
+
+  return !terminated || (length < image_length - offset && !image[offset + length]);
+}
+
+/* the whole image is checked once here, lookups trust it afterwards */
+static gboolean
+g_hash_snapshot_check (const gchar *image,
+		       gulong	    length)
+{
+  const GHashSnapshotHeader *header = (const GHashSnapshotHeader*) image;
+  const GHashSnapshotEntry *entries;
+  const gulong *buckets;
+  gulong i;
+
+  if (length < sizeof (GHashSnapshotHeader) ||
+      memcmp (header->magic, HASH_SNAPSHOT_MAGIC, sizeof (header->magic)) != 0 ||
+      header->byte_order != G_BYTE_ORDER ||
+      header->sizeof_long != sizeof (glong) ||
+      header->length != length ||
+      header->n_buckets == 0 ||
+      header->buckets % 8 != 0 ||
+      header->entries % 8 != 0 ||
+      header->buckets > length ||
+      (length - header->buckets) / sizeof (gulong) <= header->n_buckets ||
+      header->entries > length ||
+      (length - header->entries) / sizeof (GHashSnapshotEntry) < header->n_entries)
+    return FALSE;
+
+  buckets = (const gulong*) (image + header->buckets);
+  if (buckets[0] != 0 || buckets[header->n_buckets] != header->n_entries)
+    return FALSE;
+  for (i = 0; i < header->n_buckets; i++)
+    if (buckets[i] > buckets[i + 1])
+      return FALSE;
+
+  entries = (const GHashSnapshotEntry*) (image + header->entries);
+  for (i = 0; i < header->n_entries; i++)
+    if (!g_hash_snapshot_check_bytes (image, length, entries[i].key,
+				      entries[i].key_length, TRUE) ||
+	!g_hash_snapshot_check_bytes (image, length, entries[i].value,
+				      entries[i].value_length, FALSE))
+      return FALSE;
+
+  return TRUE;
+}
+
+GMappedHashTable*
+g_hash_table_map (const gchar  *file_name,
+		  GHashFunc	hash_func,
+		  GCompareFunc	key_compare_func)
+{
+  const GHashSnapshotHeader *header;
+  GMappedHashTable *table;
+  GMappedFile *file;
+  gulong length;
+
+  g_return_val_if_fail (file_name != NULL, NULL);
+  g_return_val_if_fail (hash_func != NULL, NULL);
+  g_return_val_if_fail (key_compare_func != NULL, NULL);
+
+  file = g_mapped_file_new (file_name);
+  if (!file)
+    return NULL;
+
+  length = g_mapped_file_get_length (file);
+  header = (const GHashSnapshotHeader*) g_mapped_file_get_contents (file);
+  if (!g_hash_snapshot_check ((const gchar*) header, length))
+    {
+      g_mapped_file_free (file);
+      return NULL;
+    }
+
+  table = g_new (GMappedHashTable, 1);
+  table->file = file;
+  table->image = (const gchar*) header;
+  table->header = header;
+  table->buckets = (const gulong*) (table->image + header->buckets);
+  table->entries = (const GHashSnapshotEntry*) (table->image + header->entries);
+  table->hash_func = hash_func;
+  table->key_compare_func = key_compare_func;
+
+  return table;
+}
+
+void
+g_mapped_hash_table_unmap (GMappedHashTable *table)
+{
+  g_return_if_fail (table != NULL);
+
+  g_mapped_file_free (table->file);
+  g_free (table);
+}
+
+guint
+g_mapped_hash_table_size (GMappedHashTable *table)
+{
+  g_return_val_if_fail (table != NULL, 0);
+
+  return table->header->n_entries;
+}
+
+gconstpointer
+g_mapped_hash_table_lookup (GMappedHashTable *table,
+			    gconstpointer     key,
+			    guint	     *value_length)
+{
+  const GHashSnapshotEntry *entry, *last;
+  gulong bucket;
+  guint hash;
+
+  g_return_val_if_fail (table != NULL, NULL);
+
+  hash = table->hash_func (key);
+  bucket = hash % table->header->n_buckets;
+  last = table->entries + table->buckets[bucket + 1];
+  for (entry = table->entries + table->buckets[bucket]; entry < last; entry++)
+    if (entry->hash == hash &&
+	table->key_compare_func (key, table->image + entry->key))
+      {
+	if (value_length)
+	  *value_length = entry->value_length;
+
+	return table->image + entry->value;
+      }
+
+  if (value_length)
+    *value_length = 0;
+
+  return NULL;
+}
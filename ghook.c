@@ -38,7 +38,129 @@
 #define	G_HOOKS_PREALLOC	(16)
 
 
+/* --- structures --- */
+/* the g_hook_list_invoke() family walks a compiled array of the
+ * hooks that are linked into the list, instead of following the list
+ * and taking a reference on every single hook.  the array holds a
+ * reference on each of its hooks, so they stay around while it exists.
+ * adding or destroying a hook detaches the array from the list, it is
+ * freed once the last emission using it is done.  the seq_id of the
+ * list serves as its generation, every insertion bumps it; emissions
+ * that see it change go back to walking the list from the current hook
+ * on, so new hooks are still called, while destroyed ones are caught
+ * by checking validity per hook anyhow.
+ */
+typedef struct _GHookDispatch GHookDispatch;
+
+struct _GHookDispatch
+{
+  guint	  n_users;
+  guint	  detached : 1;
+  guint	  n_hooks;
+  GHook	 *hooks[1];	/* actually n_hooks */
+};
+
+typedef enum
+{
+  G_HOOK_CALL_INVOKE,
+  G_HOOK_CALL_INVOKE_CHECK,
+  G_HOOK_CALL_MARSHAL,
+  G_HOOK_CALL_MARSHAL_CHECK
+} GHookCallType;
+
+
+/* --- prototypes --- */
+static void	g_hook_list_invalidate	(GHookList	*hook_list);
+
+
+/* --- variables --- */
+/* the compiled arrays are kept in slots numbered by the dispatch_slot
+ * of their lists, so GHookList keeps its size. the slots come in
+ * segments that are never freed, so an emission finds its array
+ * without taking a lock; only handing out and taking back slots does.
+ * slot 0 means none, lists that don't get one compile an array for
+ * every emission.
+ */
+#define	G_HOOK_SLOT_SEGMENT_SIZE	(256)
+#define	G_HOOK_SLOT_N_SEGMENTS		(4096)
+
+G_LOCK_DEFINE_STATIC (hook_slots);
+static GHookDispatch **hook_slot_segments[G_HOOK_SLOT_N_SEGMENTS] = { NULL, };
+static guint	       hook_n_slots = 1;
+static GSList	      *hook_free_slots = NULL;
+
+
 /* --- functions --- */
+static guint
+g_hook_slot_new (void)
+{
+  guint slot = 0;
+  
+  G_LOCK (hook_slots);
+  if (hook_free_slots)
+    {
+      GSList *tmp = hook_free_slots;
+      
+      slot = GPOINTER_TO_UINT (tmp->data);
+      hook_free_slots = tmp->next;
+      g_slist_free_1 (tmp);
+    }
+  else if (hook_n_slots < G_HOOK_SLOT_SEGMENT_SIZE * G_HOOK_SLOT_N_SEGMENTS)
+    {
+      slot = hook_n_slots++;
+      if (!hook_slot_segments[slot / G_HOOK_SLOT_SEGMENT_SIZE])
+	g_atomic_pointer_set ((gpointer*) &hook_slot_segments[slot / G_HOOK_SLOT_SEGMENT_SIZE],
+			      g_new0 (GHookDispatch*, G_HOOK_SLOT_SEGMENT_SIZE));
+    }
+  G_UNLOCK (hook_slots);
+  
+  return slot;
+}
+
+static void
+g_hook_slot_free (guint slot)
+{
+  G_LOCK (hook_slots);
+  hook_free_slots = g_slist_prepend (hook_free_slots, GUINT_TO_POINTER (slot));
+  G_UNLOCK (hook_slots);
+}
+
+static inline GHookDispatch**
+g_hook_list_dispatch_location (GHookList *hook_list)
+{
+  guint slot = hook_list->dispatch_slot;
+  GHookDispatch **segment;
+  
+  if (!slot)
+    return NULL;
+  
+  segment = g_atomic_pointer_get ((gpointer*) &hook_slot_segments[slot / G_HOOK_SLOT_SEGMENT_SIZE]);
+  
+  return &segment[slot % G_HOOK_SLOT_SEGMENT_SIZE];
+}
+
+static inline GHookDispatch*
+g_hook_list_get_dispatch (GHookList *hook_list)
+{
+  GHookDispatch **location = g_hook_list_dispatch_location (hook_list);
+  
+  return location ? *location : NULL;
+}
+
+/* returns FALSE if the list has no slot to keep the array in */
+static inline gboolean
+g_hook_list_set_dispatch (GHookList	*hook_list,
+			  GHookDispatch *dispatch)
+{
+  GHookDispatch **location = g_hook_list_dispatch_location (hook_list);
+  
+  if (!location)
+    return FALSE;
+  *location = dispatch;
+  
+  return TRUE;
+}
+
 void
 g_hook_list_init (GHookList *hook_list,
 		  guint	     hook_size)
@@ -56,6 +178,11 @@ g_hook_list_init (GHookList *hook_list,
 					      G_ALLOC_AND_FREE);
   hook_list->hook_free = NULL;
   hook_list->hook_destroy = NULL;
+  
+  /* the slot of a list that got freed without being cleared is lost,
+   * along with its array
+   */
+  hook_list->dispatch_slot = g_hook_slot_new ();
 }
 
 void
@@ -68,6 +195,12 @@ g_hook_list_clear (GHookList *hook_list)
       GHook *hook;
       
       hook_list->is_setup = FALSE;
+      g_hook_list_invalidate (hook_list);
+      if (hook_list->dispatch_slot)
+	{
+	  g_hook_slot_free (hook_list->dispatch_slot);
+	  hook_list->dispatch_slot = 0;
+	}
       
       hook = hook_list->hooks;
       if (!hook)
@@ -150,6 +283,7 @@ g_hook_destroy_link (GHookList *hook_list,
 	  hook->destroy = NULL;
 	}
       g_hook_unref (hook_list, hook); /* counterpart to g_hook_insert_before */
+      g_hook_list_invalidate (hook_list);
     }
 }
 
@@ -181,8 +315,7 @@ g_hook_unref (GHookList *hook_list,
   g_return_if_fail (hook != NULL);
   g_return_if_fail (hook->ref_count > 0);
   
-  hook->ref_count--;
-  if (!hook->ref_count)
+  if (g_atomic_int_dec_and_test ((gint*) &hook->ref_count))
     {
       g_return_if_fail (hook->hook_id == 0);
       g_return_if_fail (!G_HOOK_IN_CALL (hook));
@@ -223,7 +356,7 @@ g_hook_ref (GHookList *hook_list,
   g_return_if_fail (hook != NULL);
   g_return_if_fail (hook->ref_count > 0);
   
-  hook->ref_count++;
+  g_atomic_int_inc ((gint*) &hook->ref_count);
 }
 
 void
@@ -278,63 +411,164 @@ g_hook_insert_before (GHookList *hook_list,
       else
 	hook_list->hooks = hook;
     }
+  
+  g_hook_list_invalidate (hook_list);
 }
 
-void
-g_hook_list_invoke (GHookList *hook_list,
-		    gboolean   may_recurse)
+static void
+g_hook_dispatch_free (GHookList	    *hook_list,
+		      GHookDispatch *dispatch)
 {
+  guint i;
+  
+  for (i = 0; i < dispatch->n_hooks; i++)
+    g_hook_unref (hook_list, dispatch->hooks[i]);
+  g_free (dispatch);
+}
+
+static void
+g_hook_list_invalidate (GHookList *hook_list)
+{
+  GHookDispatch *dispatch = g_hook_list_get_dispatch (hook_list);
+  
+  if (!dispatch)
+    return;
+  
+  g_hook_list_set_dispatch (hook_list, NULL);
+  if (dispatch->n_users)
+    dispatch->detached = TRUE;
+  else
+    g_hook_dispatch_free (hook_list, dispatch);
+}
+
+static GHookDispatch*
+g_hook_list_compile (GHookList *hook_list)
+{
+  GHookDispatch *dispatch;
   GHook *hook;
+  guint n_hooks = 0;
+  
+  for (hook = hook_list->hooks; hook; hook = hook->next)
+    if (hook->hook_id)
+      n_hooks++;
+  
+  /* inactive hooks are kept, they may get activated again by flipping
+   * G_HOOK_FLAG_ACTIVE, which we don't get to know about
+   */
+  dispatch = g_malloc (sizeof (GHookDispatch) +
+		       sizeof (GHook*) * (MAX (n_hooks, 1) - 1));
+  dispatch->n_users = 0;
+  dispatch->detached = FALSE;
+  dispatch->n_hooks = 0;
+  for (hook = hook_list->hooks; hook; hook = hook->next)
+    if (hook->hook_id)
+      {
+	g_hook_ref (hook_list, hook);
+	dispatch->hooks[dispatch->n_hooks++] = hook;
+      }
+  if (!g_hook_list_set_dispatch (hook_list, dispatch))
+    dispatch->detached = TRUE;	/* freed after this emission */
+  
+  return dispatch;
+}
+
+static inline void
+g_hook_call (GHookList	   *hook_list,
+	     GHook	   *hook,
+	     GHookCallType  call_type,
+	     gpointer	    marshaller,
+	     gpointer	    data)
+{
+  gboolean was_in_call;
+  gboolean need_destroy = FALSE;
   
-  g_return_if_fail (hook_list != NULL);
-  g_return_if_fail (hook_list->is_setup);
+  was_in_call = G_HOOK_IN_CALL (hook);
+  hook->flags |= G_HOOK_FLAG_IN_CALL;
+  switch (call_type)
+    {
+    case G_HOOK_CALL_INVOKE:
+      ((GHookFunc) hook->func) (hook->data);
+      break;
+    case G_HOOK_CALL_INVOKE_CHECK:
+      need_destroy = !((GHookCheckFunc) hook->func) (hook->data);
+      break;
+    case G_HOOK_CALL_MARSHAL:
+      ((GHookMarshaller) marshaller) (hook, data);
+      break;
+    case G_HOOK_CALL_MARSHAL_CHECK:
+      need_destroy = !((GHookCheckMarshaller) marshaller) (hook, data);
+      break;
+    }
+  if (!was_in_call)
+    hook->flags &= ~G_HOOK_FLAG_IN_CALL;
+  if (need_destroy)
+    g_hook_destroy_link (hook_list, hook);
+}
 
-  hook = g_hook_first_valid (hook_list, may_recurse);
-  while (hook)
+static inline void
+g_hook_list_dispatch (GHookList	    *hook_list,
+		      gboolean	     may_recurse,
+		      GHookCallType  call_type,
+		      gpointer	     marshaller,
+		      gpointer	     data)
+{
+  GHookDispatch *dispatch;
+  guint seq_id = hook_list->seq_id;
+  guint i;
+  
+  dispatch = g_hook_list_get_dispatch (hook_list);
+  if (!dispatch)
+    dispatch = g_hook_list_compile (hook_list);
+  dispatch->n_users++;
+  
+  for (i = 0; i < dispatch->n_hooks; i++)
     {
-      GHookFunc func;
-      gboolean was_in_call;
+      GHook *hook = dispatch->hooks[i];
       
-      func = (GHookFunc) hook->func;
+      if (!G_HOOK_IS_VALID (hook) || (!may_recurse && G_HOOK_IN_CALL (hook)))
+	continue;
       
-      was_in_call = G_HOOK_IN_CALL (hook);
-      hook->flags |= G_HOOK_FLAG_IN_CALL;
-      func (hook->data);
-      if (!was_in_call)
-	hook->flags &= ~G_HOOK_FLAG_IN_CALL;
+      g_hook_call (hook_list, hook, call_type, marshaller, data);
       
-      hook = g_hook_next_valid (hook_list, hook, may_recurse);
+      if (hook_list->seq_id != seq_id)
+	{
+	  /* hooks got added, continue the old fashioned way, the array
+	   * still keeps `hook' alive for g_hook_next_valid() to start out
+	   */
+	  g_hook_ref (hook_list, hook);
+	  hook = g_hook_next_valid (hook_list, hook, may_recurse);
+	  while (hook)
+	    {
+	      g_hook_call (hook_list, hook, call_type, marshaller, data);
+	      hook = g_hook_next_valid (hook_list, hook, may_recurse);
+	    }
+	  break;
+	}
     }
+  
+  dispatch->n_users--;
+  if (dispatch->detached && !dispatch->n_users)
+    g_hook_dispatch_free (hook_list, dispatch);
+}
+
+void
+g_hook_list_invoke (GHookList *hook_list,
+		    gboolean   may_recurse)
+{
+  g_return_if_fail (hook_list != NULL);
+  g_return_if_fail (hook_list->is_setup);
+  
+  g_hook_list_dispatch (hook_list, may_recurse, G_HOOK_CALL_INVOKE, NULL, NULL);
 }
 
 void
 g_hook_list_invoke_check (GHookList *hook_list,
 			  gboolean   may_recurse)
 {
-  GHook *hook;
-  
   g_return_if_fail (hook_list != NULL);
   g_return_if_fail (hook_list->is_setup);
   
-  hook = g_hook_first_valid (hook_list, may_recurse);
-  while (hook)
-    {
-      GHookCheckFunc func;
-      gboolean was_in_call;
-      gboolean need_destroy;
-      
-      func = (GHookCheckFunc) hook->func;
-      
-      was_in_call = G_HOOK_IN_CALL (hook);
-      hook->flags |= G_HOOK_FLAG_IN_CALL;
-      need_destroy = !func (hook->data);
-      if (!was_in_call)
-	hook->flags &= ~G_HOOK_FLAG_IN_CALL;
-      if (need_destroy)
-	g_hook_destroy_link (hook_list, hook);
-      
-      hook = g_hook_next_valid (hook_list, hook, may_recurse);
-    }
+  g_hook_list_dispatch (hook_list, may_recurse, G_HOOK_CALL_INVOKE_CHECK, NULL, NULL);
 }
 
 void
@@ -343,28 +577,12 @@ g_hook_list_marshal_check (GHookList	       *hook_list,
 			   GHookCheckMarshaller marshaller,
 			   gpointer		data)
 {
-  GHook *hook;
-  
   g_return_if_fail (hook_list != NULL);
   g_return_if_fail (hook_list->is_setup);
   g_return_if_fail (marshaller != NULL);
   
-  hook = g_hook_first_valid (hook_list, may_recurse);
-  while (hook)
-    {
-      gboolean was_in_call;
-      gboolean need_destroy;
-      
-      was_in_call = G_HOOK_IN_CALL (hook);
-      hook->flags |= G_HOOK_FLAG_IN_CALL;
-      need_destroy = !marshaller (hook, data);
-      if (!was_in_call)
-	hook->flags &= ~G_HOOK_FLAG_IN_CALL;
-      if (need_destroy)
-	g_hook_destroy_link (hook_list, hook);
-      
-      hook = g_hook_next_valid (hook_list, hook, may_recurse);
-    }
+  g_hook_list_dispatch (hook_list, may_recurse, G_HOOK_CALL_MARSHAL_CHECK,
+			(gpointer) marshaller, data);
 }
 
 void
@@ -373,25 +591,12 @@ g_hook_list_marshal (GHookList		     *hook_list,
 		     GHookMarshaller	      marshaller,
 		     gpointer		      data)
 {
-  GHook *hook;
-  
   g_return_if_fail (hook_list != NULL);
   g_return_if_fail (hook_list->is_setup);
   g_return_if_fail (marshaller != NULL);
   
-  hook = g_hook_first_valid (hook_list, may_recurse);
-  while (hook)
-    {
-      gboolean was_in_call;
-      
-      was_in_call = G_HOOK_IN_CALL (hook);
-      hook->flags |= G_HOOK_FLAG_IN_CALL;
-      marshaller (hook, data);
-      if (!was_in_call)
-	hook->flags &= ~G_HOOK_FLAG_IN_CALL;
-      
-      hook = g_hook_next_valid (hook_list, hook, may_recurse);
-    }
+  g_hook_list_dispatch (hook_list, may_recurse, G_HOOK_CALL_MARSHAL,
+			(gpointer) marshaller, data);
 }
 
 GHook*
@@ -37,6 +37,31 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#include <string.h>
+
+/* GIOFuncs can't grow without breaking the implementations outside of
+ * glib, so the vectored hooks are kept aside, keyed by the channel.
+ * Only channels with the flag set are looked up.
+ */
+#define G_IO_CHANNEL_VECTOR_FUNCS	(1 << 0)
+
+G_LOCK_DEFINE_STATIC (vector_funcs);
+static GHashTable *vector_funcs = NULL;
+
+static GIOVectorFuncs*
+g_io_channel_get_vector_funcs (GIOChannel *channel)
+{
+  GIOVectorFuncs *funcs;
+
+  if (!(channel->channel_flags & G_IO_CHANNEL_VECTOR_FUNCS))
+    return NULL;
+
+  G_LOCK (vector_funcs);
+  funcs = g_hash_table_lookup (vector_funcs, channel);
+  G_UNLOCK (vector_funcs);
+
+  return funcs;
+}
 
 void
 g_io_channel_init (GIOChannel *channel)
@@ -45,6 +70,28 @@ g_io_channel_init (GIOChannel *channel)
   channel->ref_count = 1;
 }
 
+void
+g_io_channel_set_vector_funcs (GIOChannel     *channel,
+			       GIOVectorFuncs *funcs)
+{
+  g_return_if_fail (channel != NULL);
+
+  G_LOCK (vector_funcs);
+  if (funcs)
+    {
+      if (!vector_funcs)
+	vector_funcs = g_hash_table_new (g_direct_hash, NULL);
+      g_hash_table_insert (vector_funcs, channel, funcs);
+      channel->channel_flags |= G_IO_CHANNEL_VECTOR_FUNCS;
+    }
+  else if (channel->channel_flags & G_IO_CHANNEL_VECTOR_FUNCS)
+    {
+      g_hash_table_remove (vector_funcs, channel);
+      channel->channel_flags &= ~G_IO_CHANNEL_VECTOR_FUNCS;
+    }
+  G_UNLOCK (vector_funcs);
+}
+
 
 void 
 g_io_channel_ref (GIOChannel *channel)
@@ -61,7 +108,10 @@ g_io_channel_unref (GIOChannel *channel)
 
   channel->ref_count--;
   if (channel->ref_count == 0)
-    channel->funcs->io_free (channel);
+    {
+      g_io_channel_set_vector_funcs (channel, NULL);
+      channel->funcs->io_free (channel);
+    }
 }
 
 GIOError 
@@ -86,6 +136,71 @@ g_io_channel_write (GIOChannel *channel,
   return channel->funcs->io_write (channel, buf, count, bytes_written);
 }
 
+GIOError 
+g_io_channel_readv (GIOChannel *channel, 
+		    GIOVector  *vectors, 
+		    guint       n_vectors,
+		    guint      *bytes_read)
+{
+  GIOVectorFuncs *funcs;
+  GIOError error = G_IO_ERROR_NONE;
+  guint i;
+
+  g_return_val_if_fail (channel != NULL, G_IO_ERROR_UNKNOWN);
+  g_return_val_if_fail (vectors != NULL || n_vectors == 0, G_IO_ERROR_INVAL);
+  g_return_val_if_fail (bytes_read != NULL, G_IO_ERROR_INVAL);
+
+  funcs = g_io_channel_get_vector_funcs (channel);
+  if (funcs && funcs->io_readv)
+    return funcs->io_readv (channel, vectors, n_vectors, bytes_read);
+
+  /* stop at the first short read, the next one might block */
+  *bytes_read = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      guint n_read;
+
+      error = channel->funcs->io_read (channel, vectors[i].buf, vectors[i].len, &n_read);
+      *bytes_read += n_read;
+      if (error != G_IO_ERROR_NONE || n_read < vectors[i].len)
+	break;
+    }
+
+  return *bytes_read > 0 ? G_IO_ERROR_NONE : error;
+}
+
+GIOError 
+g_io_channel_writev (GIOChannel *channel, 
+		     GIOVector  *vectors, 
+		     guint       n_vectors,
+		     guint      *bytes_written)
+{
+  GIOVectorFuncs *funcs;
+  GIOError error = G_IO_ERROR_NONE;
+  guint i;
+
+  g_return_val_if_fail (channel != NULL, G_IO_ERROR_UNKNOWN);
+  g_return_val_if_fail (vectors != NULL || n_vectors == 0, G_IO_ERROR_INVAL);
+  g_return_val_if_fail (bytes_written != NULL, G_IO_ERROR_INVAL);
+
+  funcs = g_io_channel_get_vector_funcs (channel);
+  if (funcs && funcs->io_writev)
+    return funcs->io_writev (channel, vectors, n_vectors, bytes_written);
+
+  *bytes_written = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      guint n_written;
+
+      error = channel->funcs->io_write (channel, vectors[i].buf, vectors[i].len, &n_written);
+      *bytes_written += n_written;
+      if (error != G_IO_ERROR_NONE || n_written < vectors[i].len)
+	break;
+    }
+
+  return *bytes_written > 0 ? G_IO_ERROR_NONE : error;
+}
+
 GIOError 
 g_io_channel_seek  (GIOChannel   *channel,
 		    gint        offset, 
@@ -126,3 +241,617 @@ g_io_add_watch (GIOChannel    *channel,
 {
   return g_io_add_watch_full (channel, 0, condition, func, user_data, NULL);
 }
+
+/*
+ * Buffered IO Channels
+ */
+
+#define G_IO_BUFFER_DEFAULT_SIZE	4096
+
+typedef struct _GIOBufferedChannel GIOBufferedChannel;
+typedef struct _GIOBufferedWatch GIOBufferedWatch;
+
+struct _GIOBufferedChannel
+{
+  GIOChannel channel;
+  GIOChannel *inner;
+
+  /* the read buffer is a ring of read_size bytes, it is only moved
+   * to the front when contiguous data is needed
+   */
+  gchar *read_buf;
+  guint read_size;
+  guint read_start;
+  guint read_len;
+  gulong n_consumed;
+  gboolean eof;
+
+  /* NULL if writes are not buffered */
+  gchar *write_buf;
+  guint write_size;
+  guint write_len;
+};
+
+struct _GIOBufferedWatch
+{
+  GIOChannel *channel;
+  guint ref_count;
+  guint tag;
+  guint idle_tag;
+  gint priority;
+  GIOCondition condition;
+  GIOFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+};
+
+static GIOError g_io_buffered_read  (GIOChannel     *channel, 
+				     gchar          *buf, 
+				     guint           count,
+				     guint          *bytes_read);
+static GIOError g_io_buffered_write (GIOChannel     *channel, 
+				     gchar          *buf, 
+				     guint           count,
+				     guint          *bytes_written);
+static GIOError g_io_buffered_seek  (GIOChannel     *channel,
+				     gint            offset, 
+				     GSeekType       type);
+static void     g_io_buffered_close (GIOChannel     *channel);
+static guint    g_io_buffered_add_watch (GIOChannel     *channel,
+					 gint            priority,
+					 GIOCondition    condition,
+					 GIOFunc         func,
+					 gpointer        user_data,
+					 GDestroyNotify  notify);
+static void     g_io_buffered_free  (GIOChannel     *channel);
+static GIOError g_io_buffered_writev (GIOChannel    *channel,
+				      GIOVector     *vectors,
+				      guint          n_vectors,
+				      guint         *bytes_written);
+
+static GIOFuncs buffered_channel_funcs = {
+  g_io_buffered_read,
+  g_io_buffered_write,
+  g_io_buffered_seek,
+  g_io_buffered_close,
+  g_io_buffered_add_watch,
+  g_io_buffered_free,
+};
+
+static GIOVectorFuncs buffered_vector_funcs = {
+  NULL,
+  g_io_buffered_writev,
+};
+
+#define G_IO_IS_BUFFERED(channel)	((channel)->funcs == &buffered_channel_funcs)
+
+/* Read once from the inner channel into the free space following
+ * the buffered data.
+ */
+static GIOError
+g_io_buffered_fill (GIOBufferedChannel *buffered)
+{
+  GIOError error;
+  guint end, space;
+  guint n_read;
+
+  if (buffered->read_len == 0)
+    buffered->read_start = 0;
+
+  end = buffered->read_start + buffered->read_len;
+  if (end >= buffered->read_size)
+    {
+      end -= buffered->read_size;
+      space = buffered->read_start - end;
+    }
+  else
+    space = buffered->read_size - end;
+
+  if (space == 0)
+    return G_IO_ERROR_NONE;
+
+  error = g_io_channel_read (buffered->inner, buffered->read_buf + end, space, &n_read);
+  buffered->eof = (error == G_IO_ERROR_NONE && n_read == 0);
+  buffered->read_len += n_read;
+
+  return error;
+}
+
+/* Move the buffered data to the front of a buffer of size bytes.
+ */
+static void
+g_io_buffered_compact (GIOBufferedChannel *buffered,
+		       guint               size)
+{
+  if (size == buffered->read_size &&
+      buffered->read_start + buffered->read_len <= buffered->read_size)
+    g_memmove (buffered->read_buf,
+	       buffered->read_buf + buffered->read_start,
+	       buffered->read_len);
+  else
+    {
+      gchar *buf = g_malloc (size);
+      guint first = MIN (buffered->read_len, buffered->read_size - buffered->read_start);
+
+      memcpy (buf, buffered->read_buf + buffered->read_start, first);
+      memcpy (buf + first, buffered->read_buf, buffered->read_len - first);
+      g_free (buffered->read_buf);
+      buffered->read_buf = buf;
+      buffered->read_size = size;
+    }
+  buffered->read_start = 0;
+}
+
+static void
+g_io_buffered_consume (GIOBufferedChannel *buffered,
+		       guint               count)
+{
+  buffered->read_start = (buffered->read_start + count) % buffered->read_size;
+  buffered->read_len -= count;
+  buffered->n_consumed += count;
+  if (buffered->read_len == 0)
+    buffered->read_start = 0;
+}
+
+static GIOError
+g_io_buffered_flush (GIOBufferedChannel *buffered)
+{
+  GIOError error = G_IO_ERROR_NONE;
+  guint done = 0;
+
+  while (done < buffered->write_len)
+    {
+      guint n_written;
+
+      error = g_io_channel_write (buffered->inner,
+				  buffered->write_buf + done,
+				  buffered->write_len - done,
+				  &n_written);
+      if (error != G_IO_ERROR_NONE || n_written == 0)
+	break;
+      done += n_written;
+    }
+
+  g_memmove (buffered->write_buf, buffered->write_buf + done, buffered->write_len - done);
+  buffered->write_len -= done;
+
+  if (error == G_IO_ERROR_NONE && buffered->write_len > 0)
+    error = G_IO_ERROR_AGAIN;
+
+  return error;
+}
+
+static GIOError
+g_io_buffered_read (GIOChannel *channel, 
+		    gchar      *buf, 
+		    guint       count,
+		    guint      *bytes_read)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  guint first;
+
+  if (buffered->read_len == 0)
+    {
+      GIOError error;
+
+      /* large reads bypass the buffer */
+      if (count >= buffered->read_size)
+	return g_io_channel_read (buffered->inner, buf, count, bytes_read);
+
+      error = g_io_buffered_fill (buffered);
+      if (error != G_IO_ERROR_NONE)
+	{
+	  *bytes_read = 0;
+	  return error;
+	}
+    }
+
+  count = MIN (count, buffered->read_len);
+  first = MIN (count, buffered->read_size - buffered->read_start);
+  memcpy (buf, buffered->read_buf + buffered->read_start, first);
+  memcpy (buf + first, buffered->read_buf, count - first);
+  g_io_buffered_consume (buffered, count);
+
+  *bytes_read = count;
+  return G_IO_ERROR_NONE;
+}
+
+static GIOError
+g_io_buffered_write (GIOChannel *channel, 
+		     gchar      *buf, 
+		     guint       count,
+		     guint      *bytes_written)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+
+  if (!buffered->write_buf)
+    return g_io_channel_write (buffered->inner, buf, count, bytes_written);
+
+  if (buffered->write_len + count > buffered->write_size)
+    {
+      GIOError error = g_io_buffered_flush (buffered);
+
+      if (error != G_IO_ERROR_NONE && error != G_IO_ERROR_AGAIN)
+	{
+	  *bytes_written = 0;
+	  return error;
+	}
+      /* large writes bypass the buffer */
+      if (buffered->write_len == 0 && count >= buffered->write_size)
+	return g_io_channel_write (buffered->inner, buf, count, bytes_written);
+    }
+
+  count = MIN (count, buffered->write_size - buffered->write_len);
+  *bytes_written = count;
+  if (count == 0)
+    return G_IO_ERROR_AGAIN;
+
+  memcpy (buffered->write_buf + buffered->write_len, buf, count);
+  buffered->write_len += count;
+
+  return G_IO_ERROR_NONE;
+}
+
+static GIOError
+g_io_buffered_writev (GIOChannel *channel,
+		      GIOVector  *vectors,
+		      guint       n_vectors,
+		      guint      *bytes_written)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  guint count = 0;
+  guint i;
+
+  for (i = 0; i < n_vectors; i++)
+    count += vectors[i].len;
+
+  if (buffered->write_buf && buffered->write_len + count > buffered->write_size)
+    {
+      GIOError error = g_io_buffered_flush (buffered);
+
+      if (error != G_IO_ERROR_NONE)
+	{
+	  *bytes_written = 0;
+	  return error;
+	}
+    }
+
+  /* vectors that don't fit the buffer go out in one call */
+  if (!buffered->write_buf || count > buffered->write_size)
+    return g_io_channel_writev (buffered->inner, vectors, n_vectors, bytes_written);
+
+  for (i = 0; i < n_vectors; i++)
+    {
+      memcpy (buffered->write_buf + buffered->write_len, vectors[i].buf, vectors[i].len);
+      buffered->write_len += vectors[i].len;
+    }
+  *bytes_written = count;
+
+  return G_IO_ERROR_NONE;
+}
+
+static GIOError
+g_io_buffered_seek (GIOChannel *channel,
+		    gint        offset, 
+		    GSeekType   type)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  GIOError error;
+
+  if (buffered->write_len > 0)
+    {
+      error = g_io_buffered_flush (buffered);
+      if (error != G_IO_ERROR_NONE)
+	return error;
+    }
+
+  /* the inner channel is ahead of the reader by the buffered data */
+  if (type == G_SEEK_CUR)
+    offset -= buffered->read_len;
+
+  error = g_io_channel_seek (buffered->inner, offset, type);
+  if (error == G_IO_ERROR_NONE)
+    {
+      buffered->n_consumed += buffered->read_len;
+      buffered->read_start = 0;
+      buffered->read_len = 0;
+      buffered->eof = FALSE;
+    }
+
+  return error;
+}
+
+static void
+g_io_buffered_close (GIOChannel *channel)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+
+  if (buffered->write_len > 0)
+    g_io_buffered_flush (buffered);
+  g_io_channel_close (buffered->inner);
+}
+
+static void
+g_io_buffered_free (GIOChannel *channel)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+
+  if (buffered->write_len > 0)
+    g_io_buffered_flush (buffered);
+  g_io_channel_unref (buffered->inner);
+  g_free (buffered->read_buf);
+  g_free (buffered->write_buf);
+  g_free (buffered);
+}
+
+static void g_io_buffered_watch_ready (GIOBufferedWatch *watch);
+
+static gboolean
+g_io_buffered_dispatch (GIOChannel   *source,
+			GIOCondition  condition,
+			gpointer      data)
+{
+  GIOBufferedWatch *watch = data;
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)watch->channel;
+  gulong n_consumed = buffered->n_consumed;
+  gboolean retval;
+
+  /* buffered input doesn't make the file descriptor readable */
+  if ((watch->condition & G_IO_IN) && buffered->read_len > 0)
+    condition |= G_IO_IN;
+  if (!condition)
+    return TRUE;
+
+  retval = (*watch->func) (watch->channel, condition, watch->user_data);
+
+  /* run again for the input that is left, as long as the callback
+   * keeps reading it
+   */
+  if (retval && watch->tag && (watch->condition & G_IO_IN) &&
+      buffered->read_len > 0 && buffered->n_consumed != n_consumed)
+    g_io_buffered_watch_ready (watch);
+
+  return retval;
+}
+
+static void
+g_io_buffered_watch_unref (gpointer data)
+{
+  GIOBufferedWatch *watch = data;
+
+  watch->ref_count--;
+  if (watch->ref_count == 0)
+    {
+      g_io_channel_unref (watch->channel);
+      g_free (watch);
+    }
+}
+
+static gboolean
+g_io_buffered_idle (gpointer data)
+{
+  GIOBufferedWatch *watch = data;
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)watch->channel;
+
+  watch->idle_tag = 0;
+  if (watch->tag &&
+      !g_io_buffered_dispatch (buffered->inner, 0, watch) && watch->tag)
+    g_source_remove (watch->tag);
+
+  return FALSE;
+}
+
+/* only passive sources can be flagged ready, the watches of other
+ * channels (the Win32 ones are prepared and checked on every
+ * iteration) get the buffered input from an idle at their priority
+ */
+static void
+g_io_buffered_watch_ready (GIOBufferedWatch *watch)
+{
+  if (g_source_set_ready (watch->tag) || watch->idle_tag)
+    return;
+
+  watch->ref_count++;
+  watch->idle_tag = g_idle_add_full (watch->priority, g_io_buffered_idle,
+				     watch, g_io_buffered_watch_unref);
+}
+
+static void
+g_io_buffered_watch_destroy (gpointer data)
+{
+  GIOBufferedWatch *watch = data;
+
+  watch->tag = 0;
+  if (watch->idle_tag)
+    g_source_remove (watch->idle_tag);
+  if (watch->notify)
+    (*watch->notify) (watch->user_data);
+  g_io_buffered_watch_unref (watch);
+}
+
+static guint
+g_io_buffered_add_watch (GIOChannel    *channel,
+			 gint           priority,
+			 GIOCondition   condition,
+			 GIOFunc        func,
+			 gpointer       user_data,
+			 GDestroyNotify notify)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  GIOBufferedWatch *watch = g_new (GIOBufferedWatch, 1);
+
+  watch->channel = channel;
+  g_io_channel_ref (channel);
+
+  watch->ref_count = 1;
+  watch->idle_tag = 0;
+  watch->priority = priority;
+  watch->condition = condition;
+  watch->func = func;
+  watch->user_data = user_data;
+  watch->notify = notify;
+
+  watch->tag = g_io_add_watch_full (buffered->inner, priority, condition,
+				    g_io_buffered_dispatch, watch,
+				    g_io_buffered_watch_destroy);
+
+  if ((condition & G_IO_IN) && buffered->read_len > 0)
+    g_io_buffered_watch_ready (watch);
+
+  return watch->tag;
+}
+
+GIOChannel*
+g_io_channel_buffered_new (GIOChannel *channel,
+			   guint       read_size,
+			   guint       write_size)
+{
+  GIOBufferedChannel *buffered;
+
+  g_return_val_if_fail (channel != NULL, NULL);
+
+  buffered = g_new0 (GIOBufferedChannel, 1);
+  g_io_channel_init (&buffered->channel);
+  buffered->channel.funcs = &buffered_channel_funcs;
+  g_io_channel_set_vector_funcs (&buffered->channel, &buffered_vector_funcs);
+
+  buffered->inner = channel;
+  g_io_channel_ref (channel);
+
+  buffered->read_size = read_size ? read_size : G_IO_BUFFER_DEFAULT_SIZE;
+  buffered->read_buf = g_malloc (buffered->read_size);
+  if (write_size)
+    {
+      buffered->write_size = write_size;
+      buffered->write_buf = g_malloc (write_size);
+    }
+
+  return &buffered->channel;
+}
+
+GIOError
+g_io_channel_flush (GIOChannel *channel)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+
+  g_return_val_if_fail (channel != NULL, G_IO_ERROR_UNKNOWN);
+
+  if (!G_IO_IS_BUFFERED (channel) || buffered->write_len == 0)
+    return G_IO_ERROR_NONE;
+
+  return g_io_buffered_flush (buffered);
+}
+
+GIOError
+g_io_channel_read_line (GIOChannel *channel,
+			gchar     **str_return,
+			guint      *length)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  gchar *newline = NULL;
+  guint scanned = 0;
+  guint count;
+
+  g_return_val_if_fail (channel != NULL, G_IO_ERROR_UNKNOWN);
+  g_return_val_if_fail (G_IO_IS_BUFFERED (channel), G_IO_ERROR_INVAL);
+  g_return_val_if_fail (str_return != NULL, G_IO_ERROR_INVAL);
+
+  *str_return = NULL;
+  if (length)
+    *length = 0;
+
+  while (TRUE)
+    {
+      GIOError error;
+
+      if (buffered->read_start + buffered->read_len > buffered->read_size)
+	g_io_buffered_compact (buffered, buffered->read_size);
+
+      newline = memchr (buffered->read_buf + buffered->read_start + scanned, '\n',
+			buffered->read_len - scanned);
+      if (newline)
+	break;
+      scanned = buffered->read_len;
+
+      /* lines longer than the buffer grow it */
+      if (buffered->read_len == buffered->read_size)
+	g_io_buffered_compact (buffered, buffered->read_size * 2);
+      else if (buffered->read_start + buffered->read_len == buffered->read_size)
+	g_io_buffered_compact (buffered, buffered->read_size);
+
+      /* a partial line stays in the buffer */
+      error = g_io_buffered_fill (buffered);
+      if (error != G_IO_ERROR_NONE)
+	return error;
+      if (buffered->eof)
+	break;
+    }
+
+  if (newline)
+    count = newline - (buffered->read_buf + buffered->read_start) + 1;
+  else
+    count = buffered->read_len;
+
+  /* end of file */
+  if (count == 0)
+    return G_IO_ERROR_NONE;
+
+  *str_return = g_new (gchar, count + 1);
+  memcpy (*str_return, buffered->read_buf + buffered->read_start, count);
+  (*str_return)[count] = 0;
+  g_io_buffered_consume (buffered, count);
+  if (length)
+    *length = count;
+
+  return G_IO_ERROR_NONE;
+}
+
+GIOError
+g_io_channel_peek (GIOChannel *channel,
+		   guint       count,
+		   gchar     **data,
+		   guint      *available)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+  GIOError error = G_IO_ERROR_NONE;
+
+  g_return_val_if_fail (channel != NULL, G_IO_ERROR_UNKNOWN);
+  g_return_val_if_fail (G_IO_IS_BUFFERED (channel), G_IO_ERROR_INVAL);
+  g_return_val_if_fail (data != NULL, G_IO_ERROR_INVAL);
+  g_return_val_if_fail (available != NULL, G_IO_ERROR_INVAL);
+
+  if (count > buffered->read_size)
+    g_io_buffered_compact (buffered, count);
+
+  while (buffered->read_len < count)
+    {
+      if (buffered->read_start + buffered->read_len >= buffered->read_size &&
+	  buffered->read_start > 0)
+	g_io_buffered_compact (buffered, buffered->read_size);
+
+      error = g_io_buffered_fill (buffered);
+      if (error != G_IO_ERROR_NONE || buffered->eof)
+	break;
+    }
+
+  if (buffered->read_start + buffered->read_len > buffered->read_size)
+    g_io_buffered_compact (buffered, buffered->read_size);
+
+  *data = buffered->read_buf + buffered->read_start;
+  *available = buffered->read_len;
+
+  return buffered->read_len >= count ? G_IO_ERROR_NONE : error;
+}
+
+void
+g_io_channel_skip (GIOChannel *channel,
+		   guint       count)
+{
+  GIOBufferedChannel *buffered = (GIOBufferedChannel *)channel;
+
+  g_return_if_fail (channel != NULL);
+  g_return_if_fail (G_IO_IS_BUFFERED (channel));
+  g_return_if_fail (count <= buffered->read_len);
+
+  g_io_buffered_consume (buffered, count);
+}
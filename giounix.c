@@ -33,8 +33,13 @@
 
 #include "glib.h"
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+
+/* vectors converted to struct iovec on the stack */
+#define G_IO_UNIX_STATIC_IOV	16
 
 /*
  * Unix IO Channels
@@ -68,6 +73,14 @@ static GIOError g_io_unix_write(GIOChannel *channel,
 static GIOError g_io_unix_seek (GIOChannel *channel,
 				gint      offset, 
 				GSeekType type);
+static GIOError g_io_unix_readv (GIOChannel *channel, 
+				 GIOVector *vectors, 
+				 guint      n_vectors,
+				 guint     *bytes_read);
+static GIOError g_io_unix_writev (GIOChannel *channel, 
+				  GIOVector *vectors, 
+				  guint      n_vectors,
+				  guint     *bytes_written);
 static void g_io_unix_close    (GIOChannel *channel);
 static void g_io_unix_free     (GIOChannel *channel);
 static guint  g_io_unix_add_watch (GIOChannel      *channel,
@@ -104,6 +117,11 @@ GIOFuncs unix_channel_funcs = {
   g_io_unix_free,
 };
 
+GIOVectorFuncs unix_vector_funcs = {
+  g_io_unix_readv,
+  g_io_unix_writev,
+};
+
 static gboolean 
 g_io_unix_prepare  (gpointer source_data, 
 		    GTimeVal *current_time,
@@ -209,6 +227,99 @@ g_io_unix_write(GIOChannel *channel,
     }
 }
 
+static GIOError
+g_io_unix_error (gint error)
+{
+  switch (error)
+    {
+    case EINVAL:
+      return G_IO_ERROR_INVAL;
+    case EAGAIN:
+      return G_IO_ERROR_AGAIN;
+    default:
+      return G_IO_ERROR_UNKNOWN;
+    }
+}
+
+static struct iovec*
+g_io_unix_iovec (GIOVector    *vectors, 
+		 guint         n_vectors,
+		 struct iovec *static_iov)
+{
+  struct iovec *iov = static_iov;
+  guint i;
+
+  if (n_vectors > G_IO_UNIX_STATIC_IOV)
+    iov = g_new (struct iovec, n_vectors);
+  for (i = 0; i < n_vectors; i++)
+    {
+      iov[i].iov_base = vectors[i].buf;
+      iov[i].iov_len = vectors[i].len;
+    }
+
+  return iov;
+}
+
+static GIOError 
+g_io_unix_readv (GIOChannel *channel, 
+		 GIOVector *vectors, 
+		 guint      n_vectors,
+		 guint     *bytes_read)
+{
+  GIOUnixChannel *unix_channel = (GIOUnixChannel *)channel;
+  struct iovec static_iov[G_IO_UNIX_STATIC_IOV];
+  struct iovec *iov;
+  gint result, error;
+
+#ifdef IOV_MAX
+  n_vectors = MIN (n_vectors, IOV_MAX);
+#endif
+  iov = g_io_unix_iovec (vectors, n_vectors, static_iov);
+  result = readv (unix_channel->fd, iov, n_vectors);
+  error = errno;
+  if (iov != static_iov)
+    g_free (iov);
+
+  if (result < 0)
+    {
+      *bytes_read = 0;
+      return g_io_unix_error (error);
+    }
+
+  *bytes_read = result;
+  return G_IO_ERROR_NONE;
+}
+
+static GIOError 
+g_io_unix_writev (GIOChannel *channel, 
+		  GIOVector *vectors, 
+		  guint      n_vectors,
+		  guint     *bytes_written)
+{
+  GIOUnixChannel *unix_channel = (GIOUnixChannel *)channel;
+  struct iovec static_iov[G_IO_UNIX_STATIC_IOV];
+  struct iovec *iov;
+  gint result, error;
+
+#ifdef IOV_MAX
+  n_vectors = MIN (n_vectors, IOV_MAX);
+#endif
+  iov = g_io_unix_iovec (vectors, n_vectors, static_iov);
+  result = writev (unix_channel->fd, iov, n_vectors);
+  error = errno;
+  if (iov != static_iov)
+    g_free (iov);
+
+  if (result < 0)
+    {
+      *bytes_written = 0;
+      return g_io_unix_error (error);
+    }
+
+  *bytes_written = result;
+  return G_IO_ERROR_NONE;
+}
+
 static GIOError 
 g_io_unix_seek (GIOChannel *channel,
 		gint      offset, 
@@ -277,6 +388,7 @@ g_io_unix_add_watch (GIOChannel    *channel,
 {
   GIOUnixWatch *watch = g_new (GIOUnixWatch, 1);
   GIOUnixChannel *unix_channel = (GIOUnixChannel *)channel;
+  guint tag;
   
   watch->channel = channel;
   g_io_channel_ref (channel);
@@ -287,9 +399,13 @@ g_io_unix_add_watch (GIOChannel    *channel,
   watch->pollfd.fd = unix_channel->fd;
   watch->pollfd.events = condition;
 
-  g_main_add_poll (&watch->pollfd, priority);
+  /* the watch is dispatched when its fd gets ready, without being
+   * checked on every main loop iteration
+   */
+  tag = g_source_add_passive (priority, TRUE, &unix_watch_funcs, watch, user_data, notify);
+  g_main_add_poll_for_source (&watch->pollfd, priority, tag);
 
-  return g_source_add (priority, TRUE, &unix_watch_funcs, watch, user_data, notify);
+  return tag;
 }
 
 GIOChannel *
@@ -300,6 +416,7 @@ g_io_channel_unix_new (gint fd)
 
   g_io_channel_init (channel);
   channel->funcs = &unix_channel_funcs;
+  g_io_channel_set_vector_funcs (channel, &unix_vector_funcs);
 
   unix_channel->fd = fd;
   return channel;
@@ -30,17 +30,24 @@
 
 #include "config.h"
 #include "glib.h"
+#ifdef G_IO_WIN32_COMPLETION_PORT
+#include <winsock2.h>		/* WSARecv() for the completion port */
+#include <windows.h>
+#else
 #include <windows.h>
 #include <winsock.h>		/* Not everybody has winsock2 */
+#endif
 #include <fcntl.h>
 #include <io.h>
 #include <errno.h>
 #include <sys/types.h>
 
 #include <stdio.h>
+#include <string.h>
 
 typedef struct _GIOWin32Channel GIOWin32Channel;
 typedef struct _GIOWin32Watch GIOWin32Watch;
+typedef struct _GIOWin32SockWatch GIOWin32SockWatch;
 
 guint g_pipe_readable_msg;
 
@@ -69,6 +76,9 @@ struct _GIOWin32Channel {
   guint need_wakeups;		/* in output channels whether the
 				 * reader needs wakeups
 				 */
+
+  /* This is used by G_IO_STREAM_SOCKET channels */
+  gboolean on_port;		/* associated with the completion port */
 };
 
 struct _GIOWin32Watch {
@@ -78,6 +88,20 @@ struct _GIOWin32Watch {
   GIOFunc       callback;
 };
 
+#ifdef G_IO_WIN32_COMPLETION_PORT
+/* A stream socket watch does not have a poll record of its own; all
+ * of them are multiplexed on one I/O completion port (see
+ * g_io_win32_sock_port_drain() below).
+ */
+struct _GIOWin32SockWatch {
+  GIOWin32Watch  watch;
+  WSAOVERLAPPED  overlapped;	/* zero byte receive, completes on G_IO_IN */
+  gboolean       pending;	/* the receive has not completed yet */
+  gboolean       destroyed;	/* source is gone, free on completion */
+  GIOCondition   revents;
+};
+#endif /* G_IO_WIN32_COMPLETION_PORT */
+
 static gboolean g_io_win32_msg_prepare  (gpointer  source_data, 
 					 GTimeVal *current_time,
 					 gint     *timeout);
@@ -114,6 +138,9 @@ static gboolean g_io_win32_sock_check    (gpointer  source_data,
 static gboolean g_io_win32_sock_dispatch (gpointer  source_data,
 					  GTimeVal *current_time,
 					  gpointer  user_data);
+#ifdef G_IO_WIN32_COMPLETION_PORT
+static void g_io_win32_sock_destroy	 (gpointer source_data);
+#endif
 
 static void g_io_win32_destroy (gpointer source_data);
 
@@ -152,6 +179,15 @@ static void g_io_win32_fd_close (GIOChannel *channel);
 
 static void g_io_win32_free (GIOChannel *channel);
 
+static GIOError g_io_win32_readv (GIOChannel *channel, 
+				  GIOVector  *vectors, 
+				  guint       n_vectors,
+				  guint      *bytes_read);
+static GIOError g_io_win32_writev (GIOChannel *channel, 
+				   GIOVector  *vectors, 
+				   guint       n_vectors,
+				   guint      *bytes_written);
+
 static guint g_io_win32_fd_add_watch (GIOChannel      *channel,
 				      gint             priority,
 				      GIOCondition     condition,
@@ -221,7 +257,11 @@ GSourceFuncs win32_watch_sock_funcs = {
   g_io_win32_sock_prepare,
   g_io_win32_sock_check,
   g_io_win32_sock_dispatch,
+#ifdef G_IO_WIN32_COMPLETION_PORT
+  g_io_win32_sock_destroy
+#else
   g_io_win32_destroy
+#endif
 };
 
 GIOFuncs win32_channel_msg_funcs = {
@@ -260,6 +300,11 @@ GIOFuncs win32_channel_sock_funcs = {
   g_io_win32_free
 };
 
+GIOVectorFuncs win32_vector_funcs = {
+  g_io_win32_readv,
+  g_io_win32_writev
+};
+
 #define N_WATCHED_PIPES 4
 
 static struct {
@@ -417,6 +462,76 @@ g_io_win32_free (GIOChannel *channel)
   g_free (win32_channel);
 }
 
+/* Win32 has no readv() and writev() for file descriptors, and
+ * winsock 1 has no WSASend(), so the vectors are gathered into one
+ * buffer for a single write, or read into one and scattered.
+ */
+#define G_IO_WIN32_STATIC_BUF	1024
+
+static GIOError 
+g_io_win32_readv (GIOChannel *channel, 
+		  GIOVector  *vectors, 
+		  guint       n_vectors,
+		  guint      *bytes_read)
+{
+  gchar static_buf[G_IO_WIN32_STATIC_BUF];
+  gchar *buf = static_buf;
+  guint count = 0, done = 0;
+  GIOError error;
+  guint i;
+
+  for (i = 0; i < n_vectors; i++)
+    count += vectors[i].len;
+  if (count > sizeof (static_buf))
+    buf = g_malloc (count);
+
+  error = channel->funcs->io_read (channel, buf, count, bytes_read);
+  for (i = 0; i < n_vectors && done < *bytes_read; i++)
+    {
+      guint n = MIN (vectors[i].len, *bytes_read - done);
+
+      memcpy (vectors[i].buf, buf + done, n);
+      done += n;
+    }
+
+  if (buf != static_buf)
+    g_free (buf);
+
+  return error;
+}
+
+static GIOError 
+g_io_win32_writev (GIOChannel *channel, 
+		   GIOVector  *vectors, 
+		   guint       n_vectors,
+		   guint      *bytes_written)
+{
+  gchar static_buf[G_IO_WIN32_STATIC_BUF];
+  gchar *buf = static_buf;
+  guint count = 0;
+  GIOError error;
+  guint i;
+
+  for (i = 0; i < n_vectors; i++)
+    count += vectors[i].len;
+  if (count > sizeof (static_buf))
+    buf = g_malloc (count);
+
+  count = 0;
+  for (i = 0; i < n_vectors; i++)
+    {
+      memcpy (buf + count, vectors[i].buf, vectors[i].len);
+      count += vectors[i].len;
+    }
+
+  error = channel->funcs->io_write (channel, buf, count, bytes_written);
+
+  if (buf != static_buf)
+    g_free (buf);
+
+  return error;
+}
+
 static guint 
 g_io_win32_msg_add_watch (GIOChannel    *channel,
 			  gint           priority,
@@ -483,6 +598,218 @@ g_io_win32_pipe_destroy (gpointer source_data)
   g_free (data);
 }
 
+#ifdef G_IO_WIN32_COMPLETION_PORT
+/* Stream sockets are watched through a single I/O completion port
+ * shared by every socket channel in the process, instead of handing
+ * each socket to WaitForMultipleObjects(), which cannot wait on a
+ * SOCKET and is limited to MAXIMUM_WAIT_OBJECTS handles anyway.
+ * This needs winsock2 and ws2_32 instead of wsock32, so it is only
+ * built when G_IO_WIN32_COMPLETION_PORT is defined.
+ *
+ * A watch for G_IO_IN keeps a zero byte overlapped WSARecv() queued
+ * on its socket. It completes as soon as data (or the end of the
+ * stream) arrives without consuming anything, so the read that the
+ * callback then does goes straight into the caller's buffer and no
+ * intermediate copy or reader thread is needed. Every queued receive
+ * signals the same manual-reset event, which is the only handle the
+ * main loop polls for all sockets together; g_poll() resets it, and
+ * the first watch checked afterwards drains the port and marks each
+ * watch whose receive has completed.
+ *
+ * Winsock has no notification for "send buffer has room again", so
+ * G_IO_OUT is always reported as ready, the same as a socket that
+ * has not had a WSAEWOULDBLOCK from send() would be. (A zero byte
+ * WSASend() completes at once whether there is room or not.) This
+ * means that the main loop never blocks while a G_IO_OUT watch is
+ * installed, so such a watch should only be added while there is
+ * something to write, and be removed once the data is written.
+ */
+G_LOCK_DEFINE_STATIC (sock_port);
+static HANDLE sock_port = NULL;
+static GPollFD sock_port_pollfd;
+static guint sock_port_users = 0;
+
+/* Called with sock_port locked */
+static gboolean
+g_io_win32_sock_port_ref (void)
+{
+  if (!sock_port)
+    {
+      sock_port = CreateIoCompletionPort (INVALID_HANDLE_VALUE, NULL, 0, 0);
+      if (!sock_port)
+	{
+	  g_warning ("giowin32: CreateIoCompletionPort failed");
+	  return FALSE;
+	}
+      sock_port_pollfd.fd = (gint) CreateEvent (NULL, TRUE, FALSE, NULL);
+      sock_port_pollfd.events = G_IO_IN;
+    }
+
+  /* The port has to be polled whatever the priority of the watches
+   * on it, their sources are still dispatched by their own priority.
+   */
+  if (sock_port_users++ == 0)
+    g_main_add_poll (&sock_port_pollfd, G_PRIORITY_HIGH);
+
+  return TRUE;
+}
+
+/* Called with sock_port locked */
+static void
+g_io_win32_sock_port_unref (void)
+{
+  if (--sock_port_users == 0)
+    g_main_remove_poll (&sock_port_pollfd);
+}
+
+/* Called with sock_port locked */
+static void
+g_io_win32_sock_watch_free (GIOWin32SockWatch *watch)
+{
+  g_io_channel_unref (watch->watch.channel);
+  g_free (watch);
+  g_io_win32_sock_port_unref ();
+}
+
+/* Called with sock_port locked. Collects every completion that is
+ * queued on the port without blocking.
+ */
+static void
+g_io_win32_sock_port_drain (void)
+{
+  DWORD bytes;
+  ULONG_PTR key;
+  LPOVERLAPPED overlapped;
+
+  while (1)
+    {
+      GIOWin32SockWatch *watch;
+      BOOL success;
+
+      overlapped = NULL;
+      success = GetQueuedCompletionStatus (sock_port, &bytes, &key,
+					   &overlapped, 0);
+      if (!overlapped)
+	break;
+
+      watch = (GIOWin32SockWatch *) ((gchar *) overlapped -
+				     G_STRUCT_OFFSET (GIOWin32SockWatch,
+						      overlapped));
+      watch->pending = FALSE;
+
+      if (watch->destroyed)
+	g_io_win32_sock_watch_free (watch);
+      else if (success)
+	watch->revents |= G_IO_IN;
+      else if (GetLastError () != ERROR_OPERATION_ABORTED)
+	watch->revents |= G_IO_ERR;
+    }
+}
+
+/* Called with sock_port locked */
+static void
+g_io_win32_sock_watch_arm (GIOWin32SockWatch *watch)
+{
+  GIOWin32Channel *win32_channel = (GIOWin32Channel *) watch->watch.channel;
+  WSABUF buf;
+  DWORD bytes;
+  DWORD flags = 0;
+
+  buf.buf = NULL;
+  buf.len = 0;
+  memset (&watch->overlapped, 0, sizeof (watch->overlapped));
+  watch->overlapped.hEvent = (HANDLE) sock_port_pollfd.fd;
+
+  /* Even an immediate success queues a completion packet, so the
+   * result is always picked up by g_io_win32_sock_port_drain().
+   */
+  if (WSARecv ((SOCKET) win32_channel->fd, &buf, 1, &bytes, &flags,
+	       &watch->overlapped, NULL) == 0
+      || WSAGetLastError () == WSA_IO_PENDING)
+    watch->pending = TRUE;
+  else
+    watch->revents |= G_IO_ERR;
+}
+
+static gboolean
+g_io_win32_sock_prepare  (gpointer source_data,
+			GTimeVal *current_time,
+			gint    *timeout)
+{
+  GIOWin32SockWatch *data = source_data;
+  gboolean ready;
+
+  *timeout = -1;
+
+  G_LOCK (sock_port);
+  if ((data->watch.condition & G_IO_IN) && !data->pending
+      && !(data->revents & (G_IO_IN | G_IO_ERR)))
+    g_io_win32_sock_watch_arm (data);
+  if (data->watch.condition & G_IO_OUT)
+    data->revents |= G_IO_OUT;
+  ready = (data->revents & data->watch.condition) != 0;
+  G_UNLOCK (sock_port);
+
+  return ready;
+}
+
+static gboolean
+g_io_win32_sock_check    (gpointer source_data,
+			GTimeVal *current_time)
+{
+  GIOWin32SockWatch *data = source_data;
+  gboolean ready;
+
+  G_LOCK (sock_port);
+  if (sock_port_pollfd.revents & G_IO_IN)
+    g_io_win32_sock_port_drain ();
+  ready = (data->revents & data->watch.condition) != 0;
+  G_UNLOCK (sock_port);
+
+  return ready;
+}
+
+static gboolean
+g_io_win32_sock_dispatch (gpointer source_data,
+			GTimeVal *current_time,
+			gpointer user_data)
+
+{
+  GIOWin32SockWatch *data = source_data;
+  GIOCondition condition;
+
+  G_LOCK (sock_port);
+  condition = data->revents & data->watch.condition;
+  data->revents = 0;
+  G_UNLOCK (sock_port);
+
+  return (*data->watch.callback)(data->watch.channel, condition, user_data);
+}
+
+static void
+g_io_win32_sock_destroy (gpointer source_data)
+{
+  GIOWin32SockWatch *data = source_data;
+  GIOWin32Channel *win32_channel = (GIOWin32Channel *) data->watch.channel;
+
+  G_LOCK (sock_port);
+  if (data->pending)
+    {
+      /* The kernel still owns the OVERLAPPED; the aborted (or, if
+       * the receive was issued from another thread, eventually
+       * completed) packet frees the watch when it is drained.
+       */
+      data->destroyed = TRUE;
+      CancelIo ((HANDLE) win32_channel->fd);
+    }
+  else
+    g_io_win32_sock_watch_free (data);
+  g_io_win32_sock_port_drain ();
+  G_UNLOCK (sock_port);
+}
+
+#else /* !G_IO_WIN32_COMPLETION_PORT */
+
 static gboolean
 g_io_win32_sock_prepare  (gpointer source_data, 
 			GTimeVal *current_time,
@@ -515,6 +842,8 @@ g_io_win32_sock_dispatch (gpointer source_data,
 			   user_data);
 }
 
+#endif /* !G_IO_WIN32_COMPLETION_PORT */
+
 static GIOError
 g_io_win32_fd_read (GIOChannel *channel, 
 		    gchar     *buf, 
@@ -893,6 +1222,43 @@ g_io_win32_sock_add_watch (GIOChannel    *channel,
 			   gpointer       user_data,
 			   GDestroyNotify notify)
 {
+#ifdef G_IO_WIN32_COMPLETION_PORT
+  GIOWin32SockWatch *watch;
+  GIOWin32Channel *win32_channel = (GIOWin32Channel *) channel;
+  
+  G_LOCK (sock_port);
+  if (!g_io_win32_sock_port_ref ())
+    {
+      G_UNLOCK (sock_port);
+      return 0;
+    }
+  if (!win32_channel->on_port)
+    {
+      if (!CreateIoCompletionPort ((HANDLE) win32_channel->fd, sock_port,
+				   (ULONG_PTR) win32_channel, 0))
+	{
+	  g_warning ("giowin32: CreateIoCompletionPort failed for socket %d",
+		     win32_channel->fd);
+	  g_io_win32_sock_port_unref ();
+	  G_UNLOCK (sock_port);
+	  return 0;
+	}
+      win32_channel->on_port = TRUE;
+    }
+  G_UNLOCK (sock_port);
+
+  watch = g_new0 (GIOWin32SockWatch, 1);
+  watch->watch.channel = channel;
+  g_io_channel_ref (channel);
+
+  watch->watch.callback = func;
+  watch->watch.condition = condition;
+
+  watch->watch.pollfd.fd = -1;
+  watch->watch.pollfd.events = condition;
+
+  return g_source_add (priority, TRUE, &win32_watch_sock_funcs, watch, user_data, notify);
+#else /* !G_IO_WIN32_COMPLETION_PORT */
   GIOWin32Watch *watch = g_new (GIOWin32Watch, 1);
   GIOWin32Channel *win32_channel = (GIOWin32Channel *) channel;
   
@@ -908,6 +1274,7 @@ g_io_win32_sock_add_watch (GIOChannel    *channel,
   g_main_add_poll (&watch->pollfd, priority);
 
   return g_source_add (priority, TRUE, &win32_watch_sock_funcs, watch, user_data, notify);
+#endif /* !G_IO_WIN32_COMPLETION_PORT */
 }
 
 GIOChannel *
@@ -933,6 +1300,7 @@ g_io_channel_unix_new (gint fd)
 
   g_io_channel_init (channel);
   channel->funcs = &win32_channel_fd_funcs;
+  g_io_channel_set_vector_funcs (channel, &win32_vector_funcs);
   win32_channel->fd = fd;
   win32_channel->type = G_IO_FILE_DESC;
 
@@ -959,6 +1327,7 @@ g_io_channel_win32_new_pipe_with_wakeups (int   fd,
 
   g_io_channel_init (channel);
   channel->funcs = &win32_channel_pipe_funcs;
+  g_io_channel_set_vector_funcs (channel, &win32_vector_funcs);
   win32_channel->fd = fd;
   win32_channel->type = G_IO_PIPE;
   win32_channel->peer = peer;
@@ -977,6 +1346,7 @@ g_io_channel_win32_new_pipe (int fd)
 
   g_io_channel_init (channel);
   channel->funcs = &win32_channel_pipe_funcs;
+  g_io_channel_set_vector_funcs (channel, &win32_vector_funcs);
   win32_channel->fd = fd;
   win32_channel->type = G_IO_PIPE;
   win32_channel->offset = 0;
@@ -993,8 +1363,10 @@ g_io_channel_win32_new_stream_socket (int socket)
 
   g_io_channel_init (channel);
   channel->funcs = &win32_channel_sock_funcs;
+  g_io_channel_set_vector_funcs (channel, &win32_vector_funcs);
   win32_channel->fd = socket;
   win32_channel->type = G_IO_STREAM_SOCKET;
+  win32_channel->on_port = FALSE;
 
   return channel;
 }
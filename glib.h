@@ -688,19 +688,27 @@ GUTILS_C_VAR const guint glib_binary_age;
 /* Forward declarations of glib types.
  */
 typedef struct _GAllocator	GAllocator;
+typedef struct _GArena		GArena;
 typedef struct _GArray		GArray;
 typedef struct _GByteArray	GByteArray;
+typedef struct _GRingArray	GRingArray;
 typedef struct _GCache		GCache;
 typedef struct _GCompletion	GCompletion;
+typedef struct _GConcurrentHashTable GConcurrentHashTable;
 typedef	struct _GData		GData;
 typedef struct _GDebugKey	GDebugKey;
+typedef struct _GFrozenTree	GFrozenTree;
 typedef struct _GHashTable	GHashTable;
 typedef struct _GHook		GHook;
 typedef struct _GHookList	GHookList;
 typedef struct _GList		GList;
+typedef struct _GMappedFile	GMappedFile;
+typedef struct _GMappedHashTable GMappedHashTable;
+typedef struct _GMappedTree	GMappedTree;
 typedef struct _GMemChunk	GMemChunk;
 typedef struct _GNode		GNode;
 typedef struct _GPtrArray	GPtrArray;
+typedef struct _GQueue		GQueue;
 typedef struct _GRelation	GRelation;
 typedef struct _GScanner	GScanner;
 typedef struct _GScannerConfig	GScannerConfig;
@@ -709,6 +717,7 @@ typedef struct _GString		GString;
 typedef struct _GStringChunk	GStringChunk;
 typedef struct _GTimer		GTimer;
 typedef struct _GTree		GTree;
+typedef struct _GTreeIter	GTreeIter;
 typedef struct _GTuples		GTuples;
 typedef union  _GTokenValue	GTokenValue;
 typedef struct _GIOChannel	GIOChannel;
@@ -799,8 +808,19 @@ typedef gboolean	(*GNodeTraverseFunc)	(GNode	       *node,
 						 gpointer	data);
 typedef void		(*GNodeForeachFunc)	(GNode	       *node,
 						 gpointer	data);
+typedef gpointer	(*GNodeReduceFunc)	(gpointer	result,
+						 GNode	       *node,
+						 gpointer	data);
+typedef gpointer	(*GNodeMergeFunc)	(gpointer	result1,
+						 gpointer	result2,
+						 gpointer	data);
+typedef void		(*GRelationFunc)	(gpointer      *tuple,
+						 gpointer	user_data);
 typedef gint		(*GSearchFunc)		(gpointer	key,
 						 gpointer	data);
+typedef gconstpointer	(*GSnapshotFunc)	(gpointer	item,
+						 guint	       *length,
+						 gpointer	user_data);
 typedef void		(*GScannerMsgFunc)	(GScanner      *scanner,
 						 gchar	       *message,
 						 gint		error);
@@ -823,6 +843,13 @@ struct _GSList
   GSList *next;
 };
 
+struct _GQueue
+{
+  GList *head;
+  GList *tail;
+  guint  length;
+};
+
 struct _GString
 {
   gchar *str;
@@ -847,6 +874,11 @@ struct _GPtrArray
   guint	    len;
 };
 
+struct _GRingArray
+{
+  guint	    len;
+};
+
 struct _GTuples
 {
   guint len;
@@ -957,10 +989,56 @@ gpointer g_slist_nth_data	(GSList		*list,
 #define g_slist_next(slist)	((slist) ? (((GSList *)(slist))->next) : NULL)
 
 
+/* Double ended queues, a GList with a pointer to its tail to push and
+ * pop at both ends in O(1)
+ */
+GQueue*	 g_queue_new		(void);
+void	 g_queue_free		(GQueue		*queue);
+void	 g_queue_push_head	(GQueue		*queue,
+				 gpointer	 data);
+void	 g_queue_push_tail	(GQueue		*queue,
+				 gpointer	 data);
+gpointer g_queue_pop_head	(GQueue		*queue);
+gpointer g_queue_pop_tail	(GQueue		*queue);
+gpointer g_queue_peek_head	(GQueue		*queue);
+gpointer g_queue_peek_tail	(GQueue		*queue);
+gboolean g_queue_is_empty	(GQueue		*queue);
+guint	 g_queue_get_length	(GQueue		*queue);
+void	 g_queue_push_head_link	(GQueue		*queue,
+				 GList		*link);
+void	 g_queue_push_tail_link	(GQueue		*queue,
+				 GList		*link);
+GList*	 g_queue_pop_head_link	(GQueue		*queue);
+GList*	 g_queue_pop_tail_link	(GQueue		*queue);
+void	 g_queue_sort		(GQueue		*queue,
+				 GCompareFunc	 compare_func);
+
+
 /* Hash tables
  */
+typedef enum
+{
+  /* keep keys, values and hash codes in flat arrays instead of
+   * chaining separately allocated nodes
+   */
+  G_HASH_TABLE_OPEN_ADDRESSING	= 1 << 0,
+  /* spread the rehashing of a resize over subsequent inserts and
+   * removals instead of doing it all at once (chained tables only).
+   * lookups leave the table alone, so as with any table, readers may
+   * run concurrently while writers need it to themselves.
+   */
+  G_HASH_TABLE_INCREMENTAL_RESIZE	= 1 << 1,
+  /* use power of two table sizes, selecting buckets by masking the
+   * mixed hash value instead of a modulo by a prime
+   */
+  G_HASH_TABLE_POWER_OF_TWO	= 1 << 2
+} GHashTableFlags;
+
 GHashTable* g_hash_table_new		(GHashFunc	 hash_func,
 					 GCompareFunc	 key_compare_func);
+GHashTable* g_hash_table_new_full	(GHashFunc	 hash_func,
+					 GCompareFunc	 key_compare_func,
+					 GHashTableFlags flags);
 void	    g_hash_table_destroy	(GHashTable	*hash_table);
 void	    g_hash_table_insert		(GHashTable	*hash_table,
 					 gpointer	 key,
@@ -973,6 +1051,14 @@ gboolean    g_hash_table_lookup_extended(GHashTable	*hash_table,
 					 gconstpointer	 lookup_key,
 					 gpointer	*orig_key,
 					 gpointer	*value);
+void	    g_hash_table_insert_many	(GHashTable	*hash_table,
+					 gpointer	*keys,
+					 gpointer	*values,
+					 guint		 n_keys);
+void	    g_hash_table_lookup_many	(GHashTable	*hash_table,
+					 gconstpointer	*keys,
+					 gpointer	*values,
+					 guint		 n_keys);
 void	    g_hash_table_freeze		(GHashTable	*hash_table);
 void	    g_hash_table_thaw		(GHashTable	*hash_table);
 void	    g_hash_table_foreach	(GHashTable	*hash_table,
@@ -983,9 +1069,92 @@ guint	    g_hash_table_foreach_remove	(GHashTable	*hash_table,
 					 gpointer	 user_data);
 guint	    g_hash_table_size		(GHashTable	*hash_table);
 
+/* Snapshots
+ *
+ * g_hash_table_save() writes a table to file_name as an offset based
+ * image that g_hash_table_map() maps read-only and serves lookups
+ * from in place, so loading it costs no deserialization and the pages
+ * are shared by all processes mapping the file. The keys and values
+ * are stored as the bytes key_func and value_func return for them,
+ * aligned to 8 bytes (NULL functions store nul-terminated strings);
+ * the returned bytes need to stay valid until the next call only.
+ * The buckets come from the hash function of the table, so
+ * g_hash_table_map() needs to be given the same one; key_compare_func
+ * gets a lookup key and the stored bytes of a key with the same hash
+ * value, and returns TRUE if they are equal. For string keys, these
+ * are g_str_hash() and g_str_equal(). The file is replaced atomically,
+ * mappings of the old one stay valid. Images can only be read on
+ * systems with the byte order and long size of the writer.
+ * g_hash_table_map() checks all of the image up front and returns
+ * NULL for a file that is not a consistent one.
+ */
+gboolean    g_hash_table_save		(GHashTable	*hash_table,
+					 const gchar	*file_name,
+					 GSnapshotFunc	 key_func,
+					 GSnapshotFunc	 value_func,
+					 gpointer	 user_data);
+GMappedHashTable* g_hash_table_map	(const gchar	*file_name,
+					 GHashFunc	 hash_func,
+					 GCompareFunc	 key_compare_func);
+void	    g_mapped_hash_table_unmap	(GMappedHashTable *table);
+guint	    g_mapped_hash_table_size	(GMappedHashTable *table);
+gconstpointer g_mapped_hash_table_lookup (GMappedHashTable *table,
+					  gconstpointer	    key,
+					  guint		   *value_length);
+
+/* Hash tables that can be shared between threads, the keys are spread
+ * over n_shards (0 picks a default) locked GHashTables
+ */
+GConcurrentHashTable* g_concurrent_hash_table_new	(GHashFunc	 hash_func,
+							 GCompareFunc	 key_compare_func,
+							 guint		 n_shards);
+void	 g_concurrent_hash_table_destroy	(GConcurrentHashTable *table);
+void	 g_concurrent_hash_table_insert		(GConcurrentHashTable *table,
+						 gpointer	       key,
+						 gpointer	       value);
+void	 g_concurrent_hash_table_remove		(GConcurrentHashTable *table,
+						 gconstpointer	       key);
+gpointer g_concurrent_hash_table_lookup		(GConcurrentHashTable *table,
+						 gconstpointer	       key);
+gboolean g_concurrent_hash_table_lookup_extended (GConcurrentHashTable *table,
+						  gconstpointer	        lookup_key,
+						  gpointer	       *orig_key,
+						  gpointer	       *value);
+void	 g_concurrent_hash_table_foreach	(GConcurrentHashTable *table,
+						 GHFunc		       func,
+						 gpointer	       user_data);
+guint	 g_concurrent_hash_table_foreach_remove	(GConcurrentHashTable *table,
+						 GHRFunc	       func,
+						 gpointer	       user_data);
+guint	 g_concurrent_hash_table_size		(GConcurrentHashTable *table);
+
 
 /* Caches
+ *
+ * By default a value is destroyed as soon as its last reference is
+ * removed.  g_cache_set_max_unused() lets the cache keep up to
+ * max_unused unreferenced values around, so that inserting their key
+ * again is a hit; beyond that the least recently released ones are
+ * destroyed.  g_cache_trim() destroys unreferenced values until at
+ * most n_unused are left, e.g. under memory pressure.
+ *
+ * g_cache_new_concurrent() creates a cache that can be shared between
+ * threads; create it after g_thread_init().  Keys are spread over
+ * n_shards (0 for a default) shards with locks of their own, and
+ * value_new_func is called without any lock held, while concurrent
+ * inserts of the same key wait for that one value instead of building
+ * their own.  The max_unused and n_unused bounds apply per shard, split
+ * evenly.  The foreach functions hold a shard lock around the calls.
  */
+typedef struct _GCacheStats GCacheStats;
+
+struct _GCacheStats
+{
+  gulong hits;			/* inserts of a key already cached */
+  gulong misses;		/* inserts that created a value */
+  gulong evictions;		/* values destroyed when unreferenced */
+};
+
 GCache*	 g_cache_new	       (GCacheNewFunc	   value_new_func,
 				GCacheDestroyFunc  value_destroy_func,
 				GCacheDupFunc	   key_dup_func,
@@ -993,6 +1162,14 @@ GCache*	 g_cache_new	       (GCacheNewFunc	   value_new_func,
 				GHashFunc	   hash_key_func,
 				GHashFunc	   hash_value_func,
 				GCompareFunc	   key_compare_func);
+GCache*	 g_cache_new_concurrent (GCacheNewFunc	   value_new_func,
+				 GCacheDestroyFunc value_destroy_func,
+				 GCacheDupFunc	   key_dup_func,
+				 GCacheDestroyFunc key_destroy_func,
+				 GHashFunc	   hash_key_func,
+				 GHashFunc	   hash_value_func,
+				 GCompareFunc	   key_compare_func,
+				 guint		   n_shards);
 void	 g_cache_destroy       (GCache		  *cache);
 gpointer g_cache_insert	       (GCache		  *cache,
 				gpointer	   key);
@@ -1004,11 +1181,44 @@ void	 g_cache_key_foreach   (GCache		  *cache,
 void	 g_cache_value_foreach (GCache		  *cache,
 				GHFunc		   func,
 				gpointer	   user_data);
+void	 g_cache_set_max_unused (GCache		  *cache,
+				 guint		   max_unused);
+void	 g_cache_trim	       (GCache		  *cache,
+				guint		   n_unused);
+void	 g_cache_get_stats     (GCache		  *cache,
+				GCacheStats	  *stats);
 
 
-/* Balanced binary trees
- */
+/* Balanced trees
+ *
+ * GTree is a B-tree; G_PRE_ORDER and G_POST_ORDER traversals visit the
+ * entries of a node before respectively after those of its children.
+ * g_tree_traverse_range() visits the entries with keys in
+ * [lower_key, upper_key) in order.
+ *
+ * A GTreeIter points at an entry of a tree, g_tree_lower_bound() sets
+ * it to the first entry whose key isn't less than key, and
+ * g_tree_upper_bound() to the first greater one. Stepping costs
+ * amortized O(1); inserting or removing entries invalidates all
+ * iterators of the tree. The functions return FALSE and leave the
+ * iterator invalid when there is no such entry.
+ */
+struct _GTreeIter
+{
+  /* to be considered private */
+  GTree		*tree;
+  gpointer	 node;
+  guint		 index;
+};
+
 GTree*	 g_tree_new	 (GCompareFunc	 key_compare_func);
+/* builds a tree in O(n_keys) from keys in strictly ascending order,
+ * values may be NULL; other key arrays are inserted one by one
+ */
+GTree*	 g_tree_new_from_sorted	(GCompareFunc	 key_compare_func,
+				 gpointer	*keys,
+				 gpointer	*values,
+				 guint		 n_keys);
 void	 g_tree_destroy	 (GTree		*tree);
 void	 g_tree_insert	 (GTree		*tree,
 			  gpointer	 key,
@@ -1021,12 +1231,49 @@ void	 g_tree_traverse (GTree		*tree,
 			  GTraverseFunc	 traverse_func,
 			  GTraverseType	 traverse_type,
 			  gpointer	 data);
+void	 g_tree_traverse_range (GTree	      *tree,
+				gpointer       lower_key,
+				gpointer       upper_key,
+				GTraverseFunc  traverse_func,
+				gpointer       data);
 gpointer g_tree_search	 (GTree		*tree,
 			  GSearchFunc	 search_func,
 			  gpointer	 data);
+gboolean g_tree_lower_bound	(GTree		*tree,
+				 gpointer	 key,
+				 GTreeIter	*iter);
+gboolean g_tree_upper_bound	(GTree		*tree,
+				 gpointer	 key,
+				 GTreeIter	*iter);
+gboolean g_tree_iter_first	(GTree		*tree,
+				 GTreeIter	*iter);
+gboolean g_tree_iter_last	(GTree		*tree,
+				 GTreeIter	*iter);
+gboolean g_tree_iter_next	(GTreeIter	*iter);
+gboolean g_tree_iter_prev	(GTreeIter	*iter);
+gpointer g_tree_iter_get_key	(GTreeIter	*iter);
+gpointer g_tree_iter_get_value	(GTreeIter	*iter);
 gint	 g_tree_height	 (GTree		*tree);
 gint	 g_tree_nnodes	 (GTree		*tree);
 
+/* Snapshots, see g_hash_table_save(). The entries are stored in key
+ * order and looked up by binary search; key_compare_func compares a
+ * lookup key with the stored bytes of a key, consistently with the
+ * order of the tree (strcmp() for string keys).
+ */
+gboolean g_tree_save	 (GTree		*tree,
+			  const gchar	*file_name,
+			  GSnapshotFunc	 key_func,
+			  GSnapshotFunc	 value_func,
+			  gpointer	 user_data);
+GMappedTree* g_tree_map	 (const gchar	*file_name,
+			  GCompareFunc	 key_compare_func);
+void	 g_mapped_tree_unmap	(GMappedTree	*tree);
+gint	 g_mapped_tree_nnodes	(GMappedTree	*tree);
+gconstpointer g_mapped_tree_lookup (GMappedTree	*tree,
+				    gconstpointer key,
+				    guint	 *value_length);
+
 
 
 /* N-way tree implementation
@@ -1127,6 +1374,62 @@ GNode*	 g_node_last_sibling	 (GNode		  *node);
 #define	 g_node_first_child(node)	((node) ? \
 					 ((GNode*) (node))->children : NULL)
 
+/* A frozen tree packs the subtree of `root' into an array in pre order,
+ * with the size of every node's subtree, so traversals and queries of
+ * a tree that is done being built become linear scans over that array
+ * instead of following the node pointers.  The functions below behave
+ * like their g_node_* counterparts for any node of the frozen subtree.
+ * The GNodes must not be changed or destroyed while frozen.
+ */
+GFrozenTree* g_frozen_tree_new	      (GNode		 *root);
+void	 g_frozen_tree_free	      (GFrozenTree	 *tree);
+void	 g_frozen_tree_traverse	      (GFrozenTree	 *tree,
+				       GNode		 *root,
+				       GTraverseType	  order,
+				       GTraverseFlags	  flags,
+				       gint		  max_depth,
+				       GNodeTraverseFunc  func,
+				       gpointer		  data);
+guint	 g_frozen_tree_n_nodes	      (GFrozenTree	 *tree,
+				       GNode		 *root,
+				       GTraverseFlags	  flags);
+guint	 g_frozen_tree_depth	      (GFrozenTree	 *tree,
+				       GNode		 *node);
+guint	 g_frozen_tree_max_height     (GFrozenTree	 *tree,
+				       GNode		 *root);
+guint	 g_frozen_tree_n_children     (GFrozenTree	 *tree,
+				       GNode		 *node);
+GNode*	 g_frozen_tree_nth_child      (GFrozenTree	 *tree,
+				       GNode		 *node,
+				       guint		  n);
+
+/* Parallel traversals call func for every node of the subtree of
+ * `root' matching `flags', in no particular order and from up to
+ * max_threads threads (0 for one per processor) of a GThreadPool at
+ * the same time.  Whenever one thread has visited `granularity' nodes
+ * (0 for a default), the largest pending subtree is handed over to the
+ * pool.  g_node_reduce_parallel() folds the nodes into partial results
+ * with reduce_func and joins the partial results with merge_func, which
+ * must be associative and commutative.  Every partial result starts out
+ * from `initial', so it has to be an identity of merge_func (like 0 for
+ * a sum); only without thread support, when the nodes are folded into
+ * `initial' one after the other, can it be anything else.
+ */
+void	 g_node_traverse_parallel     (GNode		 *root,
+				       GTraverseFlags	  flags,
+				       guint		  granularity,
+				       guint		  max_threads,
+				       GNodeForeachFunc	  func,
+				       gpointer		  data);
+gpointer g_node_reduce_parallel	      (GNode		 *root,
+				       GTraverseFlags	  flags,
+				       guint		  granularity,
+				       guint		  max_threads,
+				       gpointer		  initial,
+				       GNodeReduceFunc	  reduce_func,
+				       GNodeMergeFunc	  merge_func,
+				       gpointer		  data);
+
 
 /* Callback maintenance functions
  */
@@ -1145,6 +1448,7 @@ struct _GHookList
   guint		 seq_id;
   guint		 hook_size;
   guint		 is_setup : 1;
+  guint		 dispatch_slot : 31;	/* private */
   GHook		*hooks;
   GMemChunk	*hook_memchunk;
   GHookFreeFunc	 hook_free; /* virtual function */
@@ -1288,6 +1592,41 @@ void		g_logv			(const gchar	*log_domain,
 GLogLevelFlags	g_log_set_fatal_mask	(const gchar	*log_domain,
 					 GLogLevelFlags	 fatal_mask);
 GLogLevelFlags	g_log_set_always_fatal	(GLogLevelFlags	 fatal_mask);
+
+/* Messages of disabled levels are dropped before they get formatted.
+ * All levels are enabled by default, domains without a mask of their
+ * own follow the default mask; errors and fatal levels can't be
+ * disabled. g_log_is_enabled() lets callers skip building the
+ * arguments of disabled messages, it costs a load and a branch when
+ * the level is disabled in all domains.
+ */
+GUTILS_C_VAR GLogLevelFlags g_log_enabled_levels;
+GLogLevelFlags	g_log_set_enabled_mask	(const gchar	*log_domain,
+					 GLogLevelFlags	 enabled_mask);
+GLogLevelFlags	g_log_set_default_enabled_mask (GLogLevelFlags enabled_mask);
+gboolean	g_log_domain_is_enabled	(const gchar	*log_domain,
+					 GLogLevelFlags	 log_level);
+#define	g_log_is_enabled(log_domain, log_level)			\
+  (((log_level) & g_log_enabled_levels) != 0 &&			\
+   g_log_domain_is_enabled ((log_domain), (log_level)))
+
+/* With an asynchronous sink the default handler hands the formatted
+ * message to a background thread instead of writing it itself; it
+ * needs g_thread_init() and lock-free atomic operations, otherwise
+ * g_log_set_async() returns FALSE and messages are written right away.
+ * Fatal messages flush the sink and are always written synchronously.
+ * n_records is the ring size, overflow decides whether a message that
+ * finds the ring full is dropped or waits for room.
+ */
+typedef enum
+{
+  G_LOG_ASYNC_DROP,
+  G_LOG_ASYNC_BLOCK
+} GLogAsyncOverflow;
+gboolean	g_log_set_async		(guint		   n_records,
+					 GLogAsyncOverflow overflow);
+void		g_log_async_flush	(void);
+gulong		g_log_async_get_dropped	(void);
 #ifndef	G_LOG_DOMAIN
 #define	G_LOG_DOMAIN	((gchar*) 0)
 #endif	/* G_LOG_DOMAIN */
@@ -1399,12 +1738,15 @@ void	 g_free	       (gpointer  mem);
 #endif /* !USE_DMALLOC */
 
 void	 g_mem_profile (void);
+void	 g_mem_profile_set_sample_interval (gulong n_bytes);
 void	 g_mem_check   (gpointer  mem);
 
 /* Generic allocators
  */
 GAllocator* g_allocator_new   (const gchar  *name,
 			       guint         n_preallocs);
+GAllocator* g_allocator_new_for_arena (const gchar *name,
+				       GArena      *arena);
 void        g_allocator_free  (GAllocator   *allocator);
 
 #define	G_ALLOCATOR_LIST	(1)
@@ -1429,10 +1771,21 @@ void        g_allocator_free  (GAllocator   *allocator);
  *  atom. (They are also useful for lists which use MemChunk to allocate
  *  memory but are also part of the MemChunk implementation).
  * ALLOC_AND_FREE MemChunk's can allocate and free memory.
- */
-
-#define G_ALLOC_ONLY	  1
-#define G_ALLOC_AND_FREE  2
+ * ALLOC_AND_FREE_SLAB MemChunk's can allocate and free memory as well,
+ *  but keep their areas aligned to the area size, so freeing an atom
+ *  finds its area in constant time. areas that become empty are given
+ *  back right away, except for one that is kept for reuse until
+ *  g_mem_chunk_clean() or g_blow_chunks().
+ * ALLOC_AND_FREE_MT MemChunk's can be used from several threads at
+ *  once without locking. Freed atoms are cached per thread and only
+ *  handed back to the chunk in batches, memory areas are not released
+ *  before the chunk gets reset or destroyed.
+ */
+
+#define G_ALLOC_ONLY	       1
+#define G_ALLOC_AND_FREE       2
+#define G_ALLOC_AND_FREE_SLAB  3
+#define G_ALLOC_AND_FREE_MT    4
 
 GMemChunk* g_mem_chunk_new     (gchar	  *name,
 				gint	   atom_size,
@@ -1458,6 +1811,22 @@ void	   g_mem_chunk_info    (void);
  */
 void g_blow_chunks (void);
 
+/* Arenas allocate memory by bumping a pointer and free all of it at
+ *  once, either altogether or back to a position taken with
+ *  g_arena_mark(). (block_size 0 selects a default size.)
+ */
+GArena*	 g_arena_new	 (gulong       block_size);
+void	 g_arena_destroy (GArena      *arena);
+gpointer g_arena_alloc	 (GArena      *arena,
+			  gulong       size);
+gpointer g_arena_alloc0	 (GArena      *arena,
+			  gulong       size);
+gchar*	 g_arena_strdup	 (GArena      *arena,
+			  const gchar *str);
+gpointer g_arena_mark	 (GArena      *arena);
+void	 g_arena_reset	 (GArena      *arena,
+			  gpointer     mark);
+
 
 /* Timer
  */
@@ -1530,6 +1899,36 @@ gchar*   g_strjoinv		(const gchar  *separator,
 				 gchar       **str_array);
 void     g_strfreev		(gchar       **str_array);
 
+/* g_strsplit_packed() splits like g_strsplit(), but places the array and
+ * all of its strings in a single block, to be released with g_free().
+ */
+gchar**	 g_strsplit_packed	(const gchar  *string,
+				 const gchar  *delimiter,
+				 gint          max_tokens);
+
+/* Iterate over the tokens g_strsplit() would return without copying
+ * them: each call to g_str_tokenizer_next() points token at the start
+ * of the next token within string and sets length, the token is not
+ * NUL terminated. The tokenizer needs no cleanup.
+ */
+typedef struct _GStrTokenizer	GStrTokenizer;
+
+struct _GStrTokenizer
+{
+  const gchar *string;
+  const gchar *delimiter;
+  guint        delimiter_len;
+  gint         max_splits;
+};
+
+void	 g_str_tokenizer_init	(GStrTokenizer *tokenizer,
+				 const gchar   *string,
+				 const gchar   *delimiter,
+				 gint           max_tokens);
+gboolean g_str_tokenizer_next	(GStrTokenizer *tokenizer,
+				 const gchar  **token,
+				 guint         *length);
+
 
 
 /* calculate a string size, guarranteed to fit format + args.
@@ -1571,6 +1970,14 @@ gchar*  g_path_skip_root	(gchar       *file_name);
 gchar*	g_dirname		(const gchar *file_name);
 gchar*	g_get_current_dir	(void);
 
+/* Maps a file read-only, or reads it into memory where it can't be
+ * mapped; returns NULL if the file can't be opened or read.
+ */
+GMappedFile* g_mapped_file_new		(const gchar *file_name);
+void	g_mapped_file_free		(GMappedFile *file);
+gulong	g_mapped_file_get_length	(GMappedFile *file);
+gchar*	g_mapped_file_get_contents	(GMappedFile *file);
+
 /* return the environment string for the variable. The returned memory
  * must not be freed. */
 gchar*  g_getenv		(const gchar *variable);
@@ -1650,19 +2057,51 @@ gchar*	      g_string_chunk_insert	   (GStringChunk *chunk,
 gchar*	      g_string_chunk_insert_const  (GStringChunk *chunk,
 					    const gchar	 *string);
 
+/* the _len variants copy len bytes of string (all of it if len < 0) and
+ * NUL terminate them, strings may contain embedded NULs.
+ */
+gchar*	      g_string_chunk_insert_len	   (GStringChunk *chunk,
+					    const gchar	 *string,
+					    gint	  len);
+gchar*	      g_string_chunk_insert_const_len (GStringChunk *chunk,
+					    const gchar	 *string,
+					    gint	  len);
+
+/* A string chunk that may be used from several threads at once, split
+ * into n_stripes (0 for a default number) independently locked parts.
+ * Must be created after g_thread_init().
+ */
+GStringChunk* g_string_chunk_new_concurrent (gint  size,
+					    guint n_stripes);
+
 
-/* Strings
+/* Strings, short ones are kept in storage inline with the GString.
+ * the _len variants take len bytes (all of init or val if len < 0),
+ * which may contain embedded NULs. g_string_steal() returns the
+ * buffer for g_free() and leaves the string empty. strings made with
+ * the _in_arena constructors live in the arena until it is reset,
+ * g_string_free() does nothing for them.
  */
 GString* g_string_new	    (const gchar *init);
+GString* g_string_new_len   (const gchar *init,
+			     gint	  len);
 GString* g_string_sized_new (guint	  dfl_size);
+GString* g_string_new_in_arena	    (GArena	 *arena,
+				     const gchar *init);
+GString* g_string_sized_new_in_arena (GArena	 *arena,
+				      guint	  dfl_size);
 void	 g_string_free	    (GString	 *string,
 			     gint	  free_segment);
+gchar*	 g_string_steal	    (GString	 *string);
 GString* g_string_assign    (GString	 *lval,
 			     const gchar *rval);
 GString* g_string_truncate  (GString	 *string,
 			     gint	  len);
 GString* g_string_append    (GString	 *string,
 			     const gchar *val);
+GString* g_string_append_len (GString	  *string,
+			      const gchar *val,
+			      gint	   len);
 GString* g_string_append_c  (GString	 *string,
 			     gchar	  c);
 GString* g_string_prepend   (GString	 *string,
@@ -1686,11 +2125,18 @@ void	 g_string_sprintf   (GString	 *string,
 void	 g_string_sprintfa  (GString	 *string,
 			     const gchar *format,
 			     ...) G_GNUC_PRINTF (2, 3);
+void	 g_string_append_vprintf (GString     *string,
+				  const gchar *format,
+				  va_list      args);
 
 
 /* Resizable arrays, remove fills any cleared spot and shortens the
  * array, while preserving the order. remove_fast will distort the
  * order by moving the last element to the position of the removed 
+ * one.  Both give memory back once the array drains to a quarter of
+ * its allocation, shrink does so explicitly.  sort and binary_search
+ * pass pointers to the elements to compare_func, like qsort() does;
+ * binary_search stores the match or the insertion point in index.
  */
 
 #define g_array_append_val(a,v)	  g_array_append_vals (a, &(v), 1)
@@ -1719,11 +2165,18 @@ GArray* g_array_remove_index	  (GArray	   *array,
 				   guint	    index);
 GArray* g_array_remove_index_fast (GArray	   *array,
 				   guint	    index);
+void	g_array_sort		  (GArray	   *array,
+				   GCompareFunc	    compare_func);
+gboolean g_array_binary_search	  (GArray	   *array,
+				   gconstpointer    target,
+				   GCompareFunc	    compare_func,
+				   guint	   *index);
+void	g_array_shrink		  (GArray	   *array);
 
 /* Resizable pointer array.  This interface is much less complicated
  * than the above.  Add appends appends a pointer.  Remove fills any
  * cleared spot and shortens the array. remove_fast will again distort
- * order.  
+ * order.  sort hands compare_func pointers to the gpointer slots.
  */
 #define	    g_ptr_array_index(array,index) (array->pdata)[index]
 GPtrArray*  g_ptr_array_new		   (void);
@@ -1741,6 +2194,9 @@ gboolean    g_ptr_array_remove_fast        (GPtrArray	*array,
 					    gpointer	 data);
 void	    g_ptr_array_add		   (GPtrArray	*array,
 					    gpointer	 data);
+void	    g_ptr_array_sort		   (GPtrArray	*array,
+					    GCompareFunc compare_func);
+void	    g_ptr_array_shrink		   (GPtrArray	*array);
 
 /* Byte arrays, an array of guint8.  Implemented as a GArray,
  * but type-safe.
@@ -1762,12 +2218,41 @@ GByteArray* g_byte_array_remove_index	   (GByteArray	 *array,
 GByteArray* g_byte_array_remove_index_fast (GByteArray	 *array,
 					    guint	  index);
 
+/* Ring arrays, a circular buffer of fixed size elements.  Pushing
+ * and popping at either end is O(1), index 0 is the head.
+ */
+#define g_ring_array_push_head_val(a,v) g_ring_array_push_head (a, &(v))
+#define g_ring_array_push_tail_val(a,v) g_ring_array_push_tail (a, &(v))
+#define g_ring_array_index(a,t,i)       (*(t*) g_ring_array_peek (a, i))
+
+GRingArray* g_ring_array_new	   (guint	   element_size);
+void	    g_ring_array_free	   (GRingArray	  *array);
+void	    g_ring_array_push_head (GRingArray	  *array,
+				    gconstpointer  data);
+void	    g_ring_array_push_tail (GRingArray	  *array,
+				    gconstpointer  data);
+gboolean    g_ring_array_pop_head  (GRingArray	  *array,
+				    gpointer	   data);
+gboolean    g_ring_array_pop_tail  (GRingArray	  *array,
+				    gpointer	   data);
+gpointer    g_ring_array_peek	   (GRingArray	  *array,
+				    guint	   index);
+void	    g_ring_array_clear	   (GRingArray	  *array);
+
 
 /* Hash Functions
  */
 gint  g_str_equal (gconstpointer   v,
 		   gconstpointer   v2);
 guint g_str_hash  (gconstpointer   v);
+/* word at a time string hash. the seed only varies the distribution,
+ * tables exposed to untrusted keys need a random 16 byte key, which
+ * switches to SipHash-1-3 to defend against hash flooding. neither
+ * must be changed while any table uses g_str_hash_fast().
+ */
+guint g_str_hash_fast		(gconstpointer   v);
+void  g_str_hash_fast_set_seed	(guint32	 seed);
+void  g_str_hash_fast_set_key	(const guint8	*key);
 
 gint  g_int_equal (gconstpointer   v,
 		   gconstpointer   v2);
@@ -2011,12 +2496,29 @@ struct	_GScanner
   
   /* handler function for _warn and _error */
   GScannerMsgFunc	msg_handler;
+
+  /* private, appended to keep the layout of the fields above */
+  guint			buffer_size;
+  gpointer		mapping;
+  guint			mapping_len;
+  gpointer		cset;
 };
 
 GScanner*	g_scanner_new			(GScannerConfig *config_templ);
 void		g_scanner_destroy		(GScanner	*scanner);
 void		g_scanner_input_file		(GScanner	*scanner,
 						 gint		input_fd);
+/* g_scanner_input_mmap() maps the rest of a regular file and scans it
+ * like text input, the descriptor is moved to the end of the file.
+ * It falls back to g_scanner_input_file() and returns FALSE if the
+ * file can't be mapped. The file must not be truncated while it is
+ * scanned. g_scanner_set_buffer_size() sets how much fd input is read
+ * at a time.
+ */
+gboolean	g_scanner_input_mmap		(GScanner	*scanner,
+						 gint		input_fd);
+void		g_scanner_set_buffer_size	(GScanner	*scanner,
+						 guint		buffer_size);
 void		g_scanner_sync_file_offset	(GScanner	*scanner);
 void		g_scanner_input_text		(GScanner	*scanner,
 						 const	gchar	*text,
@@ -2084,6 +2586,9 @@ struct _GCompletion
   
   gchar* prefix;
   GList* cache;
+
+  /* to be considered private */
+  gpointer trie;
 };
 
 GCompletion* g_completion_new	       (GCompletionFunc func);
@@ -2228,6 +2733,8 @@ void         g_date_clear                 (GDate       *date,
 /* The parse routine is meant for dates typed in by a user, so it
  * permits many formats but tries to catch common typos. If your data
  * needs to be strictly validated, it is not an appropriate function.
+ * ISO 8601 "YYYY-MM-DD" and "YYYYMMDD" strings are always read as
+ * year, month and day, without looking at the locale.
  */
 void         g_date_set_parse             (GDate       *date,
                                            const gchar *str);
@@ -2245,6 +2752,21 @@ void         g_date_set_dmy               (GDate       *date,
                                            GDateYear    y);
 void         g_date_set_julian            (GDate       *date,
                                            guint32      julian_date);
+
+/* Bulk conversions, g_date_set_julian_many() sets n_dates dates from
+ * an array of julian days (G_DATE_BAD_JULIAN entries leave the date
+ * invalid), g_date_to_dmy_many() fills the arrays that aren't NULL
+ * with the day, month and year of every date, or the G_DATE_BAD_*
+ * values for invalid ones.
+ */
+void         g_date_set_julian_many       (GDate         *dates,
+                                           const guint32 *julian_dates,
+                                           guint          n_dates);
+void         g_date_to_dmy_many           (GDate       *dates,
+                                           guint        n_dates,
+                                           GDateDay    *days,
+                                           GDateMonth  *months,
+                                           GDateYear   *years);
 gboolean     g_date_is_first_of_month     (GDate       *date);
 gboolean     g_date_is_last_of_month      (GDate       *date);
 
@@ -2307,6 +2829,14 @@ gsize        g_date_strftime              (gchar       *s,
  * g_relation_delete() deletes all relations with KEY in FIELD
  * g_relation_select() returns ...
  * g_relation_count() counts ...
+ *
+ * g_relation_select_foreach() calls FUNC for every tuple with KEY in
+ *   FIELD without copying them, FUNC must not modify the relation.
+ *
+ * g_relation_index_fields() adds a composite index over N_FIELDS
+ *   fields and returns its id, like g_relation_index() it has to be
+ *   called before the first insert.  The _fields variants of select
+ *   and count take one key per indexed field, in index order.
  */
 
 GRelation* g_relation_new     (gint	    fields);
@@ -2328,6 +2858,27 @@ gint	   g_relation_count   (GRelation   *relation,
 			       gint	    field);
 gboolean   g_relation_exists  (GRelation   *relation,
 			       ...);
+void	   g_relation_select_foreach	    (GRelation		*relation,
+					     gconstpointer	 key,
+					     gint		 field,
+					     GRelationFunc	 func,
+					     gpointer		 user_data);
+gint	   g_relation_index_fields	    (GRelation		*relation,
+					     gint		 n_fields,
+					     const gint		*fields,
+					     const GHashFunc	*hash_funcs,
+					     const GCompareFunc	*key_compare_funcs);
+GTuples*   g_relation_select_fields	    (GRelation		*relation,
+					     gint		 index,
+					     gconstpointer	*keys);
+void	   g_relation_select_fields_foreach (GRelation		*relation,
+					     gint		 index,
+					     gconstpointer	*keys,
+					     GRelationFunc	 func,
+					     gpointer		 user_data);
+gint	   g_relation_count_fields	    (GRelation		*relation,
+					     gint		 index,
+					     gconstpointer	*keys);
 void	   g_relation_print   (GRelation   *relation);
 
 void	   g_tuples_destroy   (GTuples	   *tuples);
@@ -2352,6 +2903,8 @@ guint	   g_spaced_primes_closest (guint num);
  */
 
 typedef struct _GIOFuncs GIOFuncs;
+typedef struct _GIOVectorFuncs GIOVectorFuncs;
+typedef struct _GIOVector GIOVector;
 typedef enum
 {
   G_IO_ERROR_NONE,
@@ -2385,6 +2938,11 @@ struct _GIOChannel
 typedef gboolean (*GIOFunc) (GIOChannel   *source,
 			     GIOCondition  condition,
 			     gpointer      data);
+struct _GIOVector
+{
+  gchar *buf;
+  guint  len;
+};
 struct _GIOFuncs
 {
   GIOError (*io_read)   (GIOChannel 	*channel, 
@@ -2407,8 +2965,27 @@ struct _GIOFuncs
 			 GDestroyNotify  notify);
   void (*io_free)       (GIOChannel	*channel);
 };
+/* optional, the vectors are read or written one at a time unless a
+ * channel registers these with g_io_channel_set_vector_funcs()
+ */
+struct _GIOVectorFuncs
+{
+  GIOError (*io_readv)  (GIOChannel	*channel,
+			 GIOVector	*vectors,
+			 guint		 n_vectors,
+			 guint		*bytes_read);
+  GIOError (*io_writev) (GIOChannel	*channel,
+			 GIOVector	*vectors,
+			 guint		 n_vectors,
+			 guint		*bytes_written);
+};
 
 void        g_io_channel_init   (GIOChannel    *channel);
+/* either member of funcs may be NULL, a NULL funcs unregisters them;
+ * funcs has to stay valid for the lifetime of the channel
+ */
+void        g_io_channel_set_vector_funcs (GIOChannel     *channel,
+					   GIOVectorFuncs *funcs);
 void        g_io_channel_ref    (GIOChannel    *channel);
 void        g_io_channel_unref  (GIOChannel    *channel);
 GIOError    g_io_channel_read   (GIOChannel    *channel, 
@@ -2419,6 +2996,17 @@ GIOError  g_io_channel_write    (GIOChannel    *channel,
 			         gchar         *buf, 
 			         guint          count,
 			         guint         *bytes_written);
+/* Scatter/gather IO: like a single read or write of the vectors'
+ * buffers one after another, a short count stops in any of them.
+ */
+GIOError  g_io_channel_readv    (GIOChannel    *channel, 
+			         GIOVector     *vectors, 
+			         guint          n_vectors,
+			         guint         *bytes_read);
+GIOError  g_io_channel_writev   (GIOChannel    *channel, 
+			         GIOVector     *vectors, 
+			         guint          n_vectors,
+			         guint         *bytes_written);
 GIOError  g_io_channel_seek     (GIOChannel    *channel,
 			         gint           offset, 
 			         GSeekType      type);
@@ -2434,12 +3022,49 @@ guint    g_io_add_watch         (GIOChannel    *channel,
 			         GIOFunc        func,
 			         gpointer       user_data);
 
+/* Buffered IO Channels
+ *
+ * A buffered channel wraps another channel with a read buffer of
+ * read_size bytes (0 for the default) and, unless write_size is 0, a
+ * write buffer that is written out when it is full, by
+ * g_io_channel_flush(), by seeking and when the channel is closed or
+ * freed. It holds a reference on the wrapped channel.
+ *
+ * g_io_channel_read_line() returns a newly allocated line including
+ * the terminating newline, or the rest of the input at end of file;
+ * *str_return is NULL once all input was read. A partial line stays
+ * buffered if the wrapped channel returns G_IO_ERROR_AGAIN, and the
+ * buffer grows to hold lines longer than itself.
+ *
+ * g_io_channel_peek() reads until at least count bytes are buffered,
+ * or the end of file or an error, and returns a pointer to the
+ * buffered data without copying it. The data stays valid until the
+ * next read from the channel; g_io_channel_skip() consumes it.
+ *
+ * Watches for G_IO_IN on a buffered channel are also dispatched while
+ * input is buffered, as long as they keep reading it.
+ */
+GIOChannel* g_io_channel_buffered_new (GIOChannel    *channel,
+				       guint          read_size,
+				       guint          write_size);
+GIOError    g_io_channel_flush        (GIOChannel    *channel);
+GIOError    g_io_channel_read_line    (GIOChannel    *channel,
+				       gchar        **str_return,
+				       guint         *length);
+GIOError    g_io_channel_peek         (GIOChannel    *channel,
+				       guint          count,
+				       gchar        **data,
+				       guint         *available);
+void        g_io_channel_skip         (GIOChannel    *channel,
+				       guint          count);
+
 
 /* Main loop
  */
 typedef struct _GTimeVal	GTimeVal;
 typedef struct _GSourceFuncs	GSourceFuncs;
 typedef struct _GMainLoop	GMainLoop;	/* Opaque */
+typedef struct _GMainContext	GMainContext;	/* Opaque */
 
 struct _GTimeVal
 {
@@ -2484,8 +3109,32 @@ gboolean g_source_remove_by_source_data      (gpointer       source_data);
 gboolean g_source_remove_by_funcs_user_data  (GSourceFuncs  *funcs,
 					      gpointer       user_data);
 
+/* Passive sources are not prepared or checked on every iteration,
+ * they are queued by priority and dispatched once they are made ready
+ * by g_source_set_ready() or by a GPollFD added for them with
+ * g_main_add_poll_for_source(). The prepare and check functions of
+ * their GSourceFuncs are not used.
+ */
+guint    g_source_add_passive                (gint           priority, 
+					      gboolean       can_recurse,
+					      GSourceFuncs  *funcs,
+					      gpointer       source_data, 
+					      gpointer       user_data,
+					      GDestroyNotify notify);
+gboolean g_source_set_ready                  (guint          tag);
+
 void g_get_current_time		        (GTimeVal	*result);
 
+/* The monotonic clock counts from an unspecified point and, unlike
+ * g_get_current_time(), is not affected by changes of the system
+ * time, so it is the one to measure intervals with. Timeouts and
+ * GTimer use it.
+ */
+void g_get_monotonic_time		(GTimeVal	*result);
+#ifdef G_HAVE_GINT64
+guint64 g_get_monotonic_nsec		(void);
+#endif /* G_HAVE_GINT64 */
+
 /* Running the main loop */
 GMainLoop*	g_main_new		(gboolean	 is_running);
 void		g_main_run		(GMainLoop	*loop);
@@ -2510,6 +3159,26 @@ guint		g_timeout_add_full	(gint           priority,
 guint		g_timeout_add		(guint          interval,
 					 GSourceFunc    function,
 					 gpointer       data);
+/* Coarse timeouts expire on multiples of their granularity in
+ * milliseconds, which must divide 1000 or be a multiple of 1000, so
+ * that timeouts expiring close to each other are dispatched in a
+ * single wakeup. g_timeout_add_seconds() takes an interval in seconds
+ * and expires on whole seconds.
+ */
+guint		g_timeout_add_coarse_full (gint		priority,
+					 guint          interval, 
+					 guint          granularity,
+					 GSourceFunc    function,
+					 gpointer       data,
+					 GDestroyNotify notify);
+guint		g_timeout_add_seconds_full (gint	priority,
+					 guint          interval, 
+					 GSourceFunc    function,
+					 gpointer       data,
+					 GDestroyNotify notify);
+guint		g_timeout_add_seconds	(guint          interval,
+					 GSourceFunc    function,
+					 gpointer       data);
 guint		g_idle_add	   	(GSourceFunc	function,
 					 gpointer	data);
 guint	   	g_idle_add_full		(gint   	priority,
@@ -2555,9 +3224,173 @@ struct _GPollFD
 
 void        g_main_add_poll          (GPollFD    *fd,
 				      gint        priority);
+void        g_main_add_poll_for_source (GPollFD  *fd,
+					gint      priority,
+					guint     tag);
 void        g_main_remove_poll       (GPollFD    *fd);
 void        g_main_set_poll_func     (GPollFunc   func);
 
+/* Poll backends: G_MAIN_POLL_DEFAULT builds a GPollFD array for the
+ * poll function on every iteration. The kernel backends keep the poll
+ * records registered with epoll (Linux) or kqueue (BSD) and scale with
+ * the number of ready file descriptors; G_MAIN_POLL_KERNEL picks
+ * whichever is available. With a kernel backend, the events of a
+ * GPollFD can't be changed while it is added to the main loop, and
+ * the function set with g_main_set_poll_func() is not used. Setting a
+ * poll function switches back to G_MAIN_POLL_DEFAULT.
+ * g_main_set_poll_backend() returns FALSE if the backend is not
+ * available.
+ */
+typedef enum
+{
+  G_MAIN_POLL_DEFAULT,
+  G_MAIN_POLL_KERNEL,
+  G_MAIN_POLL_EPOLL,
+  G_MAIN_POLL_KQUEUE
+} GMainPollBackend;
+
+gboolean         g_main_set_poll_backend (GMainPollBackend backend);
+GMainPollBackend g_main_get_poll_backend (void);
+
+/* Main contexts
+ *
+ * A GMainContext holds a set of sources and poll records with its own
+ * lock, so that several threads can each run a main loop. The
+ * functions above without a context argument use the thread default
+ * context, which is the default context unless another one has been
+ * set with g_main_context_set_thread_default(). While a context is
+ * iterated, it is the thread default context for its callbacks and
+ * destroy notifiers. Source tags are unique across all contexts.
+ */
+GMainContext*	g_main_context_new		(void);
+void		g_main_context_destroy		(GMainContext	*context);
+GMainContext*	g_main_context_default		(void);
+void		g_main_context_set_thread_default (GMainContext	*context);
+GMainContext*	g_main_context_get_thread_default (void);
+guint		g_main_context_add_source	(GMainContext	*context,
+						 gint		 priority, 
+						 gboolean	 can_recurse,
+						 GSourceFuncs	*funcs,
+						 gpointer	 source_data, 
+						 gpointer	 user_data,
+						 GDestroyNotify	 notify);
+gboolean	g_main_context_remove_source	(GMainContext	*context,
+						 guint		 tag);
+gboolean	g_main_context_set_source_ready	(GMainContext	*context,
+						 guint		 tag);
+guint		g_main_context_add_timeout	(GMainContext	*context,
+						 gint		 priority,
+						 guint		 interval, 
+						 GSourceFunc	 function,
+						 gpointer	 data,
+						 GDestroyNotify	 notify);
+guint		g_main_context_add_coarse_timeout (GMainContext	*context,
+						 gint		 priority,
+						 guint		 interval, 
+						 guint		 granularity,
+						 GSourceFunc	 function,
+						 gpointer	 data,
+						 GDestroyNotify	 notify);
+guint		g_main_context_add_idle		(GMainContext	*context,
+						 gint		 priority,
+						 GSourceFunc	 function,
+						 gpointer	 data,
+						 GDestroyNotify	 notify);
+gboolean	g_main_context_iteration	(GMainContext	*context,
+						 gboolean	 may_block);
+gboolean	g_main_context_pending		(GMainContext	*context);
+GMainLoop*	g_main_context_new_loop		(GMainContext	*context,
+						 gboolean	 is_running);
+gboolean	g_main_context_set_poll_backend	(GMainContext	*context,
+						 GMainPollBackend backend);
+
+/* The monotonic time at which the current iteration started, updated
+ * after poll; cheaper than reading the clock in every source.
+ */
+void		g_main_get_loop_time		(GTimeVal	*result);
+void		g_main_context_get_loop_time	(GMainContext	*context,
+						 GTimeVal	*result);
+
+/* Dispatch budget
+ *
+ * By default an iteration dispatches all of the sources that got
+ * ready. With a budget, an iteration stops after max_dispatches
+ * sources or after max_usec microseconds of dispatching (0 means no
+ * limit), and the remaining sources are dispatched by the next
+ * iterations, after any newly ready sources of higher priority.
+ * At least one source is dispatched per iteration.
+ */
+typedef struct _GMainDispatchStats GMainDispatchStats;
+
+struct _GMainDispatchStats
+{
+  gulong n_dispatches;		/* sources dispatched */
+  gulong n_budget_exceeded;	/* iterations stopped by the budget */
+  gulong n_deferred;		/* dispatches carried over */
+};
+
+void	g_main_set_dispatch_budget		(guint		 max_dispatches,
+						 glong		 max_usec);
+void	g_main_context_set_dispatch_budget	(GMainContext	*context,
+						 guint		 max_dispatches,
+						 glong		 max_usec);
+void	g_main_context_get_dispatch_stats	(GMainContext	*context,
+						 GMainDispatchStats *stats);
+void	g_main_context_reset_dispatch_stats	(GMainContext	*context);
+
+/* Profiling
+ *
+ * While profiling is enabled for a context, it records how long the
+ * prepare, check and dispatch functions of each source take, how long
+ * the context is blocked in poll, and how late timeouts are
+ * dispatched after their expiration (the loop lag). Durations are
+ * measured with g_get_monotonic_time() and kept in histograms with
+ * power of two buckets: buckets[0] counts durations below 1
+ * microsecond, buckets[i] those of 2^(i-1) up to 2^i microseconds,
+ * and the last bucket everything above.
+ *
+ * g_main_context_get_source_profiles() returns copies of the source
+ * profiles, sorted by decreasing total dispatch time; free the
+ * elements with g_free() and the list with g_slist_free(). Profiles
+ * of removed sources are kept until the profile is reset.
+ */
+#define G_MAIN_HISTOGRAM_BUCKETS	24
+
+typedef struct _GMainHistogram		GMainHistogram;
+typedef struct _GMainSourceProfile	GMainSourceProfile;
+typedef struct _GMainLoopProfile	GMainLoopProfile;
+
+struct _GMainHistogram
+{
+  gulong  count;
+  gdouble total_usec;
+  gulong  max_usec;
+  gulong  buckets[G_MAIN_HISTOGRAM_BUCKETS];
+};
+
+struct _GMainSourceProfile
+{
+  guint		  tag;
+  GSourceFuncs	 *funcs;
+  GMainHistogram  prepare;
+  GMainHistogram  check;
+  GMainHistogram  dispatch;
+};
+
+struct _GMainLoopProfile
+{
+  GMainHistogram poll;
+  GMainHistogram timer_lag;
+};
+
+void	g_main_set_profiling			(gboolean	 enabled);
+void	g_main_context_set_profiling		(GMainContext	*context,
+						 gboolean	 enabled);
+GSList*	g_main_context_get_source_profiles	(GMainContext	*context);
+void	g_main_context_get_loop_profile		(GMainContext	*context,
+						 GMainLoopProfile *profile);
+void	g_main_context_reset_profile		(GMainContext	*context);
+
 /* On Unix, IO channels created with this function for any file
  * descriptor or socket.
  *
@@ -2688,6 +3521,57 @@ gint		gwin_closedir  	(DIR		*dir);
 #endif	 /* NATIVE_WIN32 */
 
 
+/* Atomic operations.  The read-modify-write operations are full
+ * memory barriers, g_atomic_*_get() has acquire and g_atomic_*_set()
+ * release semantics.  g_atomic_int_exchange_and_add() returns the
+ * value from before the addition.  g_atomic_memory_barrier() orders
+ * all loads and stores before it with all of those after it.  Where
+ * the compiler allows, these are expanded inline.
+ */
+gint	 g_atomic_int_exchange_and_add		(gint		*atomic,
+						 gint		 val);
+void	 g_atomic_int_add			(gint		*atomic,
+						 gint		 val);
+gboolean g_atomic_int_compare_and_exchange	(gint		*atomic,
+						 gint		 oldval,
+						 gint		 newval);
+gboolean g_atomic_pointer_compare_and_exchange	(gpointer	*atomic,
+						 gpointer	 oldval,
+						 gpointer	 newval);
+gint	 g_atomic_int_get			(gint		*atomic);
+void	 g_atomic_int_set			(gint		*atomic,
+						 gint		 newval);
+gpointer g_atomic_pointer_get			(gpointer	*atomic);
+void	 g_atomic_pointer_set			(gpointer	*atomic,
+						 gpointer	 newval);
+void	 g_atomic_memory_barrier		(void);
+
+#if defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#  define g_atomic_int_exchange_and_add(atomic, val) \
+    (__atomic_fetch_add ((atomic), (val), __ATOMIC_SEQ_CST))
+#  define g_atomic_int_add(atomic, val) \
+    ((void) __atomic_add_fetch ((atomic), (val), __ATOMIC_SEQ_CST))
+#  define g_atomic_int_compare_and_exchange(atomic, oldval, newval) \
+    (__sync_bool_compare_and_swap ((atomic), (oldval), (newval)))
+#  define g_atomic_pointer_compare_and_exchange(atomic, oldval, newval) \
+    (__sync_bool_compare_and_swap ((atomic), (oldval), (newval)))
+#  define g_atomic_int_get(atomic) \
+    (__atomic_load_n ((atomic), __ATOMIC_ACQUIRE))
+#  define g_atomic_int_set(atomic, newval) \
+    (__atomic_store_n ((atomic), (newval), __ATOMIC_RELEASE))
+#  define g_atomic_pointer_get(atomic) \
+    ((gpointer) __atomic_load_n ((atomic), __ATOMIC_ACQUIRE))
+#  define g_atomic_pointer_set(atomic, newval) \
+    (__atomic_store_n ((atomic), (gpointer) (newval), __ATOMIC_RELEASE))
+#  define g_atomic_memory_barrier() \
+    (__atomic_thread_fence (__ATOMIC_SEQ_CST))
+#endif
+
+#define g_atomic_int_inc(atomic) (g_atomic_int_add ((atomic), 1))
+#define g_atomic_int_dec_and_test(atomic) \
+  (g_atomic_int_exchange_and_add ((atomic), -1) == 1)
+
+
 /* GLib Thread support
  */
 typedef struct _GMutex		GMutex;
@@ -2727,6 +3611,22 @@ GUTILS_C_VAR gboolean		g_threads_got_initialized;
  */
 void   g_thread_init   (GThreadFunctions       *vtable);
 
+/* Runs func (data) in a new detached thread. Only the default thread
+ * implementations of -lgthread can create threads; FALSE is returned
+ * if threads aren't initialized, g_thread_init() got a vtable of its
+ * own, or the thread couldn't be created.
+ */
+typedef void		(*GThreadFunc)		(gpointer	 data);
+typedef gboolean	(*GThreadCreateFunc)	(GThreadFunc	 func,
+						 gpointer	 data);
+gboolean g_thread_create (GThreadFunc		 func,
+			  gpointer		 data);
+
+/* Lets other threads run before the calling one continues, for those
+ * spinning on something that another thread holds.
+ */
+void	 g_thread_yield	 (void);
+
 /* internal function for fallback static mutex implementation */
 GMutex*	g_static_mutex_get_mutex_impl	(GMutex	**mutex);
 
@@ -2767,12 +3667,37 @@ GMutex*	g_static_mutex_get_mutex_impl	(GMutex	**mutex);
  * much easier, than having to explicitly allocate the mutex before
  * use
  */
-#define g_static_mutex_lock(mutex) \
+#if defined (G_THREADS_IMPL_POSIX) && defined (__linux__) && \
+    defined (G_ATOMIC_LOCK_FREE)
+/* The default implementation's mutexes are futexes here, given atomic
+ * operations that don't take a lock themselves: one int that is 0 when
+ * unlocked, 1 when locked and 2 when somebody waits for it.
+ * As PTHREAD_MUTEX_INITIALIZER is all zeros on Linux, that int can be
+ * overlaid on the pad of a GStaticMutex, whose uncontended locking and
+ * unlocking is then done inline, without calling through the vtable.
+ */
+#  define G_MUTEX_IMPL_FUTEX
+#  define G_STATIC_MUTEX_FAST(mutex, old, new)				\
+    (g_thread_use_default_impl && g_thread_supported () &&		\
+     g_atomic_int_compare_and_exchange ((gint*) &(mutex)->aligned_pad_u, \
+					(old), (new)))
+#  define g_static_mutex_lock(mutex)					\
+    (G_STATIC_MUTEX_FAST (mutex, 0, 1) ? (void) 0 :			\
+     g_mutex_lock (g_static_mutex_get_mutex (mutex)))
+#  define g_static_mutex_trylock(mutex)					\
+    (G_STATIC_MUTEX_FAST (mutex, 0, 1) ||				\
+     g_mutex_trylock (g_static_mutex_get_mutex (mutex)))
+#  define g_static_mutex_unlock(mutex)					\
+    (G_STATIC_MUTEX_FAST (mutex, 1, 0) ? (void) 0 :			\
+     g_mutex_unlock (g_static_mutex_get_mutex (mutex)))
+#else
+#  define g_static_mutex_lock(mutex) \
     g_mutex_lock (g_static_mutex_get_mutex (mutex))
-#define g_static_mutex_trylock(mutex) \
+#  define g_static_mutex_trylock(mutex) \
     g_mutex_trylock (g_static_mutex_get_mutex (mutex))
-#define g_static_mutex_unlock(mutex) \
+#  define g_static_mutex_unlock(mutex) \
     g_mutex_unlock (g_static_mutex_get_mutex (mutex)) 
+#endif
 struct _GStaticPrivate
 {
   guint index;
@@ -2783,6 +3708,82 @@ void     g_static_private_set (GStaticPrivate	*private_key,
 			       gpointer        	 data,
 			       GDestroyNotify    notify);
 
+/* GStaticRWLocks, initialized with G_STATIC_RW_LOCK_INIT, let any
+ * number of readers or a single writer in at a time.  Writers take
+ * precedence: once one waits, new readers wait too, so a thread must
+ * not take the reader lock recursively.  Uncontended locking and
+ * unlocking only costs an atomic operation.
+ */
+typedef struct _GStaticRWLock GStaticRWLock;
+struct _GStaticRWLock
+{
+  /* to be considered private */
+  GStaticMutex mutex;
+  GCond *read_cond;
+  GCond *write_cond;
+  gint state;
+  gint n_sleeping;
+  guint want_to_write;
+};
+#define G_STATIC_RW_LOCK_INIT { G_STATIC_MUTEX_INIT, NULL, NULL, 0, 0, 0 }
+void     g_static_rw_lock_reader_lock    (GStaticRWLock	*lock);
+gboolean g_static_rw_lock_reader_trylock (GStaticRWLock	*lock);
+void     g_static_rw_lock_reader_unlock  (GStaticRWLock	*lock);
+void     g_static_rw_lock_writer_lock    (GStaticRWLock	*lock);
+gboolean g_static_rw_lock_writer_trylock (GStaticRWLock	*lock);
+void     g_static_rw_lock_writer_unlock  (GStaticRWLock	*lock);
+void     g_static_rw_lock_free           (GStaticRWLock	*lock);
+
+/* Thread pools run func (data, user_data) for every pushed data on up
+ * to max_threads threads (0 for one per processor), spawned through
+ * g_thread_create() as needed.  Each worker keeps the jobs pushed from
+ * inside a job on a deque of its own, that idle workers steal from.
+ * Without threads, g_thread_pool_push() runs the job right away.
+ *
+ * With g_thread_pool_set_completion(), complete_func (data, user_data)
+ * is called from the main loop of context (NULL for the default one)
+ * once func has returned.  g_thread_pool_free() waits for the running
+ * jobs, and either the queued ones too or, if immediate, drops them;
+ * call it from the thread running the completion context.
+ */
+typedef struct _GThreadPool	GThreadPool;
+
+GThreadPool*	g_thread_pool_new		(GFunc		 func,
+						 gpointer	 user_data,
+						 guint		 max_threads);
+void		g_thread_pool_free		(GThreadPool	*pool,
+						 gboolean	 immediate);
+gboolean	g_thread_pool_push		(GThreadPool	*pool,
+						 gpointer	 data);
+void		g_thread_pool_set_completion	(GThreadPool	*pool,
+						 GMainContext	*context,
+						 GFunc		 complete_func);
+void		g_thread_pool_set_max_threads	(GThreadPool	*pool,
+						 guint		 max_threads);
+guint		g_thread_pool_get_max_threads	(GThreadPool	*pool);
+guint		g_thread_pool_get_num_threads	(GThreadPool	*pool);
+guint		g_thread_pool_unprocessed	(GThreadPool	*pool);
+
+/* Asynchronous queues hand data (never NULL) from one set of threads
+ * to another.  g_async_queue_pop() blocks until an item arrives and
+ * g_async_queue_timed_pop() until end_time at the latest, both
+ * returning NULL right away if threads are not initialized and the
+ * queue is empty; g_async_queue_try_pop() never blocks.  While other
+ * threads push and pop, g_async_queue_length() is only a snapshot.
+ */
+typedef struct _GAsyncQueue	GAsyncQueue;
+
+GAsyncQueue*	g_async_queue_new		(void);
+void		g_async_queue_ref		(GAsyncQueue	*queue);
+void		g_async_queue_unref		(GAsyncQueue	*queue);
+void		g_async_queue_push		(GAsyncQueue	*queue,
+						 gpointer	 data);
+gpointer	g_async_queue_pop		(GAsyncQueue	*queue);
+gpointer	g_async_queue_try_pop		(GAsyncQueue	*queue);
+gpointer	g_async_queue_timed_pop		(GAsyncQueue	*queue,
+						 GTimeVal	*end_time);
+gint		g_async_queue_length		(GAsyncQueue	*queue);
+
 /* these are some convenience macros that expand to nothing if GLib
  * was configured with --disable-threads. for using StaticMutexes,
  * you define them with G_LOCK_DEFINE_STATIC (name) or G_LOCK_DEFINE (name)
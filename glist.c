@@ -39,6 +39,7 @@ struct _GAllocator /* from gmem.c */
   guint          type : 4;
   GAllocator    *last;
   GMemChunk     *mem_chunk;
+  GArena        *arena;
   GList		*free_lists; /* implementation specific */
 };
 
@@ -62,7 +63,12 @@ g_list_validate_allocator (GAllocator *allocator)
 	}
     }
 
-  if (!allocator->mem_chunk)
+  if (allocator->arena)
+    {
+      /* nodes freed during an earlier push went away with the arena */
+      allocator->free_lists = NULL;
+    }
+  else if (!allocator->mem_chunk)
     {
       allocator->mem_chunk = g_mem_chunk_new (allocator->name,
 					      sizeof (GList),
@@ -100,12 +106,32 @@ g_list_pop_allocator (void)
   G_UNLOCK (current_allocator);
 }
 
-GList*
-g_list_alloc (void)
+/* Per thread magazines of free nodes. Once threads are initialized,
+ * nodes of the default allocator are handed out from and freed into
+ * the calling thread's magazine without taking current_allocator_lock,
+ * which is only needed to refill an empty magazine from the shared
+ * free lists or to give half of a full one back. Nodes for a pushed
+ * allocator always go through the allocator itself.
+ */
+#define LIST_MAGAZINE_SIZE	64
+
+typedef struct _GListMagazine GListMagazine;
+
+struct _GListMagazine
+{
+  GList *free_lists;	/* laid out like GAllocator.free_lists */
+  guint  n_free_lists;
+};
+
+static GAllocator	*default_allocator = NULL;
+static GStaticPrivate	 list_magazine = G_STATIC_PRIVATE_INIT;
+
+/* HOLDS: current_allocator_lock */
+static GList*
+g_list_alloc_locked (void)
 {
   GList *list;
 
-  G_LOCK (current_allocator);
   if (!current_allocator)
     {
       GAllocator *allocator = g_allocator_new ("GLib default GList allocator",
@@ -113,10 +139,13 @@ g_list_alloc (void)
       g_list_validate_allocator (allocator);
       allocator->last = NULL;
       current_allocator = allocator;
+      default_allocator = allocator;
     }
   if (!current_allocator->free_lists)
     {
-      list = g_chunk_new (GList, current_allocator->mem_chunk);
+      list = current_allocator->arena ?
+	g_arena_alloc (current_allocator->arena, sizeof (GList)) :
+	g_chunk_new (GList, current_allocator->mem_chunk);
       list->data = NULL;
     }
   else
@@ -133,7 +162,143 @@ g_list_alloc (void)
 	  current_allocator->free_lists = list->next;
 	}
     }
+
+  return list;
+}
+
+/* HOLDS: current_allocator_lock */
+static void
+g_list_magazine_release (GListMagazine *magazine,
+			 guint          n_keep)
+{
+  GList *free_lists = magazine->free_lists;
+  GList *last;
+  guint n;
+
+  if (n_keep)
+    {
+      for (n = 1; n < n_keep; n++)
+	free_lists = free_lists->next;
+      last = free_lists;
+      free_lists = last->next;
+      last->next = NULL;
+    }
+  else
+    magazine->free_lists = NULL;
+  magazine->n_free_lists = n_keep;
+
+  if (free_lists)
+    {
+      for (last = free_lists; last->next; last = last->next)
+	;
+      last->next = default_allocator->free_lists;
+      default_allocator->free_lists = free_lists;
+    }
+}
+
+static void
+g_list_magazine_free (gpointer data)
+{
+  GListMagazine *magazine = data;
+
+  G_LOCK (current_allocator);
+  g_list_magazine_release (magazine, 0);
+  G_UNLOCK (current_allocator);
+  g_free (magazine);
+}
+
+static inline GListMagazine*
+g_list_magazine_get (void)
+{
+  GListMagazine *magazine;
+
+  /* the unlocked read of current_allocator is fine here, a thread
+   * that races with another one pushing an allocator could as well
+   * have run a little earlier.
+   */
+  if (!g_thread_supported () ||
+      !default_allocator ||
+      current_allocator != default_allocator)
+    return NULL;
+
+  magazine = g_static_private_get (&list_magazine);
+  if (!magazine)
+    {
+      magazine = g_new0 (GListMagazine, 1);
+      g_static_private_set (&list_magazine, magazine, g_list_magazine_free);
+    }
+
+  return magazine;
+}
+
+static void
+g_list_magazine_refill (GListMagazine *magazine)
+{
+  GList *list;
+
+  G_LOCK (current_allocator);
+  while (magazine->n_free_lists < LIST_MAGAZINE_SIZE / 2)
+    {
+      if (default_allocator->free_lists)
+	{
+	  list = default_allocator->free_lists;
+	  default_allocator->free_lists = list->next;
+	}
+      else
+	{
+	  list = g_chunk_new (GList, default_allocator->mem_chunk);
+	  list->data = NULL;
+	}
+      list->next = magazine->free_lists;
+      magazine->free_lists = list;
+      magazine->n_free_lists++;
+    }
   G_UNLOCK (current_allocator);
+}
+
+static inline void
+g_list_magazine_put (GListMagazine *magazine,
+		     GList         *list)
+{
+  list->next = magazine->free_lists;
+  magazine->free_lists = list;
+  if (++magazine->n_free_lists >= LIST_MAGAZINE_SIZE)
+    {
+      G_LOCK (current_allocator);
+      g_list_magazine_release (magazine, LIST_MAGAZINE_SIZE / 2);
+      G_UNLOCK (current_allocator);
+    }
+}
+
+GList*
+g_list_alloc (void)
+{
+  GListMagazine *magazine = g_list_magazine_get ();
+  GList *list;
+
+  if (magazine)
+    {
+      if (!magazine->free_lists)
+	g_list_magazine_refill (magazine);
+      if (magazine->free_lists->data)
+	{
+	  list = magazine->free_lists->data;
+	  magazine->free_lists->data = list->next;
+	  list->data = NULL;
+	}
+      else
+	{
+	  list = magazine->free_lists;
+	  magazine->free_lists = list->next;
+	  magazine->n_free_lists--;
+	}
+    }
+  else
+    {
+      G_LOCK (current_allocator);
+      list = g_list_alloc_locked ();
+      G_UNLOCK (current_allocator);
+    }
   list->next = NULL;
   list->prev = NULL;
   
@@ -145,11 +310,18 @@ g_list_free (GList *list)
 {
   if (list)
     {
+      GListMagazine *magazine = g_list_magazine_get ();
+
       list->data = list->next;  
-      G_LOCK (current_allocator);
-      list->next = current_allocator->free_lists;
-      current_allocator->free_lists = list;
-      G_UNLOCK (current_allocator);
+      if (magazine)
+	g_list_magazine_put (magazine, list);
+      else
+	{
+	  G_LOCK (current_allocator);
+	  list->next = current_allocator->free_lists;
+	  current_allocator->free_lists = list;
+	  G_UNLOCK (current_allocator);
+	}
     }
 }
 
@@ -158,11 +330,18 @@ g_list_free_1 (GList *list)
 {
   if (list)
     {
+      GListMagazine *magazine = g_list_magazine_get ();
+
       list->data = NULL;  
-      G_LOCK (current_allocator);
-      list->next = current_allocator->free_lists;
-      current_allocator->free_lists = list;
-      G_UNLOCK (current_allocator);
+      if (magazine)
+	g_list_magazine_put (magazine, list);
+      else
+	{
+	  G_LOCK (current_allocator);
+	  list->next = current_allocator->free_lists;
+	  current_allocator->free_lists = list;
+	  G_UNLOCK (current_allocator);
+	}
     }
 }
 
@@ -559,7 +738,7 @@ g_list_sort_merge (GList       *l1,
 
   while (l1 && l2)
     {
-      if (compare_func (l1->data, l2->data) < 0)
+      if (compare_func (l1->data, l2->data) <= 0)
         {
 	  l->next = l1;
 	  l = l->next;
@@ -582,32 +761,47 @@ g_list_sort_merge (GList       *l1,
   return list.next;
 }
 
+/* bottom up merge sort, bins[i] holds a sorted run of 2^i elements
+ * from before the ones in the lower bins, so equal elements keep their
+ * order
+ */
+#define	G_LIST_SORT_BINS	(64)
+
 GList* 
 g_list_sort (GList       *list,
 	     GCompareFunc compare_func)
 {
-  GList *l1, *l2;
-  
-  if (!list) 
-    return NULL;
-  if (!list->next) 
+  GList *bins[G_LIST_SORT_BINS];
+  GList *run;
+  guint n_bins = 0;
+  guint i;
+
+  if (!list || !list->next)
     return list;
-  
-  l1 = list; 
-  l2 = list->next;
 
-  while ((l2 = l2->next) != NULL)
+  while (list)
     {
-      if ((l2 = l2->next) == NULL) 
-	break;
-      l1 = l1->next;
+      run = list;
+      list = list->next;
+      run->next = NULL;
+      run->prev = NULL;
+
+      for (i = 0; i < n_bins && bins[i]; i++)
+	{
+	  run = g_list_sort_merge (bins[i], run, compare_func);
+	  bins[i] = NULL;
+	}
+      if (i == n_bins)
+	n_bins++;
+      bins[i] = run;
     }
-  l2 = l1->next; 
-  l1->next = NULL; 
 
-  return g_list_sort_merge (g_list_sort (list, compare_func),
-			    g_list_sort (l2,   compare_func),
-			    compare_func);
+  run = NULL;
+  for (i = 0; i < n_bins; i++)
+    if (bins[i])
+      run = run ? g_list_sort_merge (bins[i], run, compare_func) : bins[i];
+
+  return run;
 }
 
 GList* 
@@ -40,6 +40,7 @@
 
 #include "glib.h"
 #include <sys/types.h>
+#include <string.h>
 #include <time.h>
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
@@ -53,6 +54,24 @@
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
 #include <errno.h>
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+
+#if defined (HAVE_SYS_EPOLL_H) && defined (HAVE_EPOLL_CREATE)
+#  include <sys/epoll.h>
+#  define G_MAIN_HAVE_EPOLL
+#  define G_MAIN_HAVE_KERNEL_POLL
+#elif defined (HAVE_SYS_EVENT_H) && defined (HAVE_KQUEUE)
+#  include <sys/event.h>
+#  define G_MAIN_HAVE_KQUEUE
+#  define G_MAIN_HAVE_KERNEL_POLL
+#endif
+
+#if defined (HAVE_SYS_EVENTFD_H) && defined (HAVE_EVENTFD)
+#  include <sys/eventfd.h>
+#  define G_MAIN_HAVE_EVENTFD
+#endif
 
 #ifdef NATIVE_WIN32
 #define STRICT
@@ -69,11 +88,16 @@
 typedef struct _GTimeoutData GTimeoutData;
 typedef struct _GSource GSource;
 typedef struct _GPollRec GPollRec;
+typedef struct _GReadyQueue GReadyQueue;
 
 typedef enum
 {
   G_SOURCE_READY = 1 << G_HOOK_FLAG_USER_SHIFT,
-  G_SOURCE_CAN_RECURSE = 1 << (G_HOOK_FLAG_USER_SHIFT + 1)
+  G_SOURCE_CAN_RECURSE = 1 << (G_HOOK_FLAG_USER_SHIFT + 1),
+  G_SOURCE_TIMER = 1 << (G_HOOK_FLAG_USER_SHIFT + 2),
+  G_SOURCE_PASSIVE = 1 << (G_HOOK_FLAG_USER_SHIFT + 3),
+  G_SOURCE_QUEUED = 1 << (G_HOOK_FLAG_USER_SHIFT + 4),
+  G_SOURCE_DEFERRED = 1 << (G_HOOK_FLAG_USER_SHIFT + 5)
 } GSourceFlags;
 
 struct _GSource
@@ -81,10 +105,25 @@ struct _GSource
   GHook hook;
   gint priority;
   gpointer source_data;
+  GSource *ready_next;
+  GMainContext *context;
+};
+
+/* passive sources are never prepared or checked, they are put on
+ * the ready queue of their priority when they get ready, and the
+ * queue holds a reference on them.
+ */
+struct _GReadyQueue
+{
+  gint priority;
+  GSource *head;
+  GSource *tail;
+  GReadyQueue *next;
 };
 
 struct _GMainLoop
 {
+  GMainContext *context;
   gboolean is_running;
 };
 
@@ -92,7 +131,10 @@ struct _GTimeoutData
 {
   GTimeVal    expiration;
   gint        interval;
+  gint        granularity;	/* expirations are rounded up to it, 0 if exact */
   GSourceFunc callback;
+  GSource    *source;
+  guint       heap_index;	/* TIMER_NOT_QUEUED while pending or dispatched */
 };
 
 struct _GPollRec
@@ -100,6 +142,95 @@ struct _GPollRec
   gint priority;
   GPollFD *fd;
   GPollRec *next;
+  GPollRec *fd_next;	/* records of the same fd, for kernel polling */
+  GSource *source;	/* passive source to queue when fd gets ready */
+  gboolean ready;	/* fd->revents was set by the kernel poll */
+};
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+#define G_MAIN_KERNEL_EVENTS	256
+
+typedef struct _GPollKernelFd GPollKernelFd;
+
+struct _GPollKernelFd
+{
+  gint fd;
+  gushort events;		/* as registered with the kernel */
+  gboolean always_ready;	/* the kernel refused to watch fd */
+  GPollRec *records;		/* chained through fd_next */
+  GPollKernelFd *always_next;
+};
+#endif /* G_MAIN_HAVE_KERNEL_POLL */
+
+/* A main context holds a set of sources, the poll records and the
+ * lock protecting both, so each thread can run its own main loop.
+ */
+struct _GMainContext
+{
+  GMutex *mutex;		/* NULL for the default context */
+
+  GSList *pending_dispatches;
+  GHookList source_list;
+  GHookList passive_list;
+  GReadyQueue *ready_queues;	/* sorted by priority */
+  gint in_check_or_prepare;
+
+  /* sources left over when the dispatch budget ran out, they are
+   * dispatched before newly ready sources of the same priority
+   */
+  GSList *deferred_dispatches;
+  gint deferred_priority;
+  guint dispatch_max;
+  glong dispatch_max_usec;
+  GMainDispatchStats dispatch_stats;
+
+  gboolean profiling;
+  GHashTable *source_profiles;	/* hook id -> GMainSourceProfile */
+  GMainLoopProfile loop_profile;
+
+  GTimeoutData **timer_heap;
+  guint n_timers;
+  guint timer_heap_size;
+  GTimeVal loop_time;		/* monotonic time of the current iteration */
+
+  GPollRec *poll_records;
+  GPollRec *poll_free_list;
+  GMemChunk *poll_chunk;
+  guint n_poll_records;
+  GPollFunc poll_func;
+
+#ifdef G_THREADS_ENABLED
+#ifndef NATIVE_WIN32
+  /* this pipe is used to wake up the main loop when a source is added.
+   * with eventfd, both ends are the same file descriptor.
+   */
+  gint wake_up_pipe[2];
+#else /* NATIVE_WIN32 */
+  HANDLE wake_up_semaphore;
+#endif /* NATIVE_WIN32 */
+  GPollFD wake_up_rec;
+  gboolean poll_waiting;
+  gboolean poll_blocking;	/* poll_waiting with a timeout != 0 */
+  gboolean wake_up_pending;	/* a wakeup was written and not yet read */
+
+  /* Flag indicating whether the set of fd's changed during a poll */
+  gboolean poll_changed;
+#endif /* G_THREADS_ENABLED */
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  GMainPollBackend poll_backend;
+  gint poll_kernel_fd;
+  GHashTable *poll_kernel_fds;
+  GPollKernelFd *poll_always_ready;
+  GPollRec **poll_ready;
+  guint n_poll_ready;
+  guint poll_ready_size;
+#ifdef G_MAIN_HAVE_EPOLL
+  struct epoll_event *poll_kernel_events;
+#else /* G_MAIN_HAVE_KQUEUE */
+  struct kevent *poll_kernel_events;
+#endif
+#endif /* G_MAIN_HAVE_KERNEL_POLL */
 };
 
 /* Forward declarations */
@@ -108,12 +239,33 @@ static gint     g_source_compare          (GHook      *a,
 					   GHook      *b);
 static void     g_source_destroy_func     (GHookList  *hook_list,
 					   GHook      *hook);
-static void     g_main_poll               (gint      timeout,
+static void     g_main_poll               (GMainContext *context,
+					   gint      timeout,
 					   gboolean  use_priority, 
 					   gint      priority);
-static void     g_main_add_poll_unlocked  (gint      priority,
-					   GPollFD  *fd);
-static void     g_main_wakeup             (void);
+static void     g_main_add_poll_unlocked  (GMainContext *context,
+					   gint      priority,
+					   GPollFD  *fd,
+					   GSource  *source);
+static void     g_main_wakeup             (GMainContext *context);
+static void     g_main_wakeup_clear       (GMainContext *context);
+static GMainContext* g_main_context_current (void);
+static GMainContext* g_main_context_push  (GMainContext *context);
+static void     g_main_context_pop        (GMainContext *old_context);
+static GSource* g_source_add_unlocked     (GMainContext  *context,
+					   gint           priority,
+					   gboolean       can_recurse,
+					   gboolean       passive,
+					   GSourceFuncs  *funcs,
+					   gpointer       source_data, 
+					   gpointer       user_data,
+					   GDestroyNotify notify);
+static void     g_source_queue_ready      (GSource      *source);
+static void     g_timer_heap_insert       (GTimeoutData *data);
+static void     g_timer_heap_remove       (GTimeoutData *data);
+static gint     g_timer_heap_expire       (GMainContext *context);
+static void     g_timeout_set_expiration  (GTimeoutData *data,
+					   GTimeVal     *current_time);
 
 static gboolean g_timeout_prepare      (gpointer  source_data, 
 					GTimeVal *current_time,
@@ -138,15 +290,43 @@ static gboolean g_idle_dispatch        (gpointer  source_data,
 
 /* Data */
 
-static GSList *pending_dispatches = NULL;
-static GHookList source_list = { 0 };
-static gint in_check_or_prepare = 0;
-
-/* The following lock is used for both the list of sources
- * and the list of poll records
+/* The default context uses the following lock, other contexts
+ * have their own mutex.
  */
 G_LOCK_DEFINE_STATIC (main_loop);
 
+#define LOCK_CONTEXT(context)					\
+  G_STMT_START {						\
+    if ((context)->mutex)					\
+      g_mutex_lock ((context)->mutex);				\
+    else							\
+      G_LOCK (main_loop);					\
+  } G_STMT_END
+#define UNLOCK_CONTEXT(context)					\
+  G_STMT_START {						\
+    if ((context)->mutex)					\
+      g_mutex_unlock ((context)->mutex);			\
+    else							\
+      G_UNLOCK (main_loop);					\
+  } G_STMT_END
+
+#define G_SOURCE_LIST(source)					\
+  ((((GHook*) (source))->flags & G_SOURCE_PASSIVE) ?		\
+   &((GSource*) (source))->context->passive_list :		\
+   &((GSource*) (source))->context->source_list)
+
+#define G_SOURCE_CAN_DISPATCH(source)					\
+  (!G_HOOK_IN_CALL (source) ||						\
+   (((GHook*) (source))->flags & G_SOURCE_CAN_RECURSE))
+
+static GMainContext default_context_data;
+static GMainContext *default_context = NULL;
+static GStaticPrivate thread_context = G_STATIC_PRIVATE_INIT;
+
+/* source ids are unique across contexts */
+G_LOCK_DEFINE_STATIC (source_ids);
+static guint source_seq_id = 1;
+
 static GSourceFuncs timeout_funcs =
 {
   g_timeout_prepare,
@@ -163,32 +343,19 @@ static GSourceFuncs idle_funcs =
   NULL,
 };
 
-static GPollRec *poll_records = NULL;
-static GPollRec *poll_free_list = NULL;
-static GMemChunk *poll_chunk;
-static guint n_poll_records = 0;
-
-#ifdef G_THREADS_ENABLED
-#ifndef NATIVE_WIN32
-/* this pipe is used to wake up the main loop when a source is added.
+/* timeout sources are kept in a binary heap ordered by expiration
+ * instead of being prepared and checked one by one. expired timeouts
+ * are popped off the heap and put on the ready queue, and back on
+ * the heap after they have been dispatched.
  */
-static gint wake_up_pipe[2] = { -1, -1 };
-#else /* NATIVE_WIN32 */
-static HANDLE wake_up_semaphore = NULL;
-#endif /* NATIVE_WIN32 */
-static GPollFD wake_up_rec;
-static gboolean poll_waiting = FALSE;
-
-/* Flag indicating whether the set of fd's changed during a poll */
-static gboolean poll_changed = FALSE;
-#endif /* G_THREADS_ENABLED */
+#define TIMER_NOT_QUEUED	((guint) -1)
 
 #ifdef HAVE_POLL
 /* SunOS has poll, but doesn't provide a prototype. */
 #  if defined (sun) && !defined (__SVR4)
 extern gint poll (GPollFD *ufds, guint nfsd, gint timeout);
 #  endif  /* !sun */
-static GPollFunc poll_func = (GPollFunc) poll;
+static GPollFunc default_poll_func = (GPollFunc) poll;
 #else	/* !HAVE_POLL */
 #ifdef NATIVE_WIN32
 
@@ -406,194 +573,1173 @@ g_poll (GPollFD *fds,
 
 #endif /* !NATIVE_WIN32 */
 
-static GPollFunc poll_func = g_poll;
+static GPollFunc default_poll_func = g_poll;
 #endif	/* !HAVE_POLL */
 
-/* Hooks for adding to the main loop */
+/* Kernel poll backends
+ *
+ * with epoll or kqueue, the poll records are registered with the kernel
+ * as they are added and removed, so a poll costs in proportion to the
+ * number of ready file descriptors instead of the number of records.
+ * records are grouped by file descriptor in poll_kernel_fds, since the
+ * kernel only takes one registration per descriptor. only the records
+ * that became ready are recorded in poll_ready, their revents are
+ * cleared again before the next poll.
+ */
+#ifdef G_MAIN_HAVE_KERNEL_POLL
 
-/* Use knowledge of insert_sorted algorithm here to make
- * sure we insert at the end of equal priority items
+/* HOLDS: main_loop_lock */
+static gboolean
+g_main_kernel_ctl (GMainContext  *context,
+		   GPollKernelFd *kfd,
+		   gushort        events)
+{
+#ifdef G_MAIN_HAVE_EPOLL
+  struct epoll_event event;
+  gint op;
+
+  if (!kfd->events)
+    op = EPOLL_CTL_ADD;
+  else if (!events)
+    op = EPOLL_CTL_DEL;
+  else
+    op = EPOLL_CTL_MOD;
+
+  event.events = ((events & G_IO_IN ? EPOLLIN : 0) |
+		  (events & G_IO_OUT ? EPOLLOUT : 0) |
+		  (events & G_IO_PRI ? EPOLLPRI : 0));
+  event.data.u64 = 0;
+  event.data.fd = kfd->fd;
+
+  return epoll_ctl (context->poll_kernel_fd, op, kfd->fd, &event) == 0;
+#else /* G_MAIN_HAVE_KQUEUE */
+  struct kevent changes[2];
+  gint n_changes = 0;
+  gboolean old_read = (kfd->events & (G_IO_IN | G_IO_PRI)) != 0;
+  gboolean new_read = (events & (G_IO_IN | G_IO_PRI)) != 0;
+  gboolean old_write = (kfd->events & G_IO_OUT) != 0;
+  gboolean new_write = (events & G_IO_OUT) != 0;
+
+  if (old_read != new_read)
+    {
+      EV_SET (&changes[n_changes], kfd->fd, EVFILT_READ,
+	      new_read ? EV_ADD : EV_DELETE, 0, 0, 0);
+      n_changes++;
+    }
+  if (old_write != new_write)
+    {
+      EV_SET (&changes[n_changes], kfd->fd, EVFILT_WRITE,
+	      new_write ? EV_ADD : EV_DELETE, 0, 0, 0);
+      n_changes++;
+    }
+
+  return !n_changes || kevent (context->poll_kernel_fd, changes, n_changes, NULL, 0, NULL) == 0;
+#endif
+}
+
+/* brings the kernel registration of kfd up to date with its records
+ * HOLDS: main_loop_lock
  */
-static gint
-g_source_compare (GHook *a,
-		  GHook *b)
+static void
+g_main_kernel_update (GMainContext  *context,
+		      GPollKernelFd *kfd)
 {
-  GSource *source_a = (GSource *)a;
-  GSource *source_b = (GSource *)b;
+  GPollRec *pollrec;
+  gushort events = 0;
 
-  return (source_a->priority < source_b->priority) ? -1 : 1;
+  for (pollrec = kfd->records; pollrec; pollrec = pollrec->fd_next)
+    events |= pollrec->fd->events;
+  events &= G_IO_IN | G_IO_OUT | G_IO_PRI;
+
+  if (kfd->always_ready)
+    kfd->events = events;
+  else if (events != kfd->events)
+    {
+      if (g_main_kernel_ctl (context, kfd, events))
+	kfd->events = events;
+      else if (events && errno == EPERM)
+	{
+	  /* regular files can't be watched, but poll() considers
+	   * them ready all the time, so we do too
+	   */
+	  kfd->always_ready = TRUE;
+	  kfd->always_next = context->poll_always_ready;
+	  context->poll_always_ready = kfd;
+	  kfd->events = events;
+	}
+      else if (events)
+	g_warning ("g_main_add_poll(): cannot watch fd %d: %s",
+		   kfd->fd, g_strerror (errno));
+      else
+	kfd->events = 0;
+    }
 }
 
-/* HOLDS: main_loop lock */
+/* HOLDS: main_loop_lock */
 static void
-g_source_destroy_func (GHookList *hook_list,
-		       GHook     *hook)
+g_main_kernel_add (GMainContext *context,
+		   GPollRec     *pollrec)
 {
-  GSource *source = (GSource*) hook;
-  GDestroyNotify destroy;
+  GPollKernelFd *kfd;
+
+  kfd = g_hash_table_lookup (context->poll_kernel_fds, GINT_TO_POINTER (pollrec->fd->fd));
+  if (!kfd)
+    {
+      kfd = g_new0 (GPollKernelFd, 1);
+      kfd->fd = pollrec->fd->fd;
+      g_hash_table_insert (context->poll_kernel_fds, GINT_TO_POINTER (kfd->fd), kfd);
+    }
 
-  G_UNLOCK (main_loop);
+  pollrec->ready = FALSE;
+  pollrec->fd_next = kfd->records;
+  kfd->records = pollrec;
 
-  destroy = hook->destroy;
-  if (destroy)
-    destroy (hook->data);
+  g_main_kernel_update (context, kfd);
+}
 
-  destroy = ((GSourceFuncs*) hook->func)->destroy;
-  if (destroy)
-    destroy (source->source_data);
+/* HOLDS: main_loop_lock */
+static void
+g_main_kernel_remove (GMainContext *context,
+		      GPollRec     *pollrec)
+{
+  GPollKernelFd *kfd;
+  GPollRec **link;
+
+  if (pollrec->ready)
+    {
+      guint i;
+
+      for (i = 0; i < context->n_poll_ready; i++)
+	if (context->poll_ready[i] == pollrec)
+	  {
+	    context->poll_ready[i] = context->poll_ready[--context->n_poll_ready];
+	    break;
+	  }
+      pollrec->ready = FALSE;
+    }
+
+  kfd = g_hash_table_lookup (context->poll_kernel_fds, GINT_TO_POINTER (pollrec->fd->fd));
+  if (!kfd)
+    return;
+
+  for (link = &kfd->records; *link; link = &(*link)->fd_next)
+    if (*link == pollrec)
+      {
+	*link = pollrec->fd_next;
+	break;
+      }
+
+  g_main_kernel_update (context, kfd);
 
-  G_LOCK (main_loop);
+  if (!kfd->records)
+    {
+      if (kfd->always_ready)
+	{
+	  GPollKernelFd **always;
+
+	  for (always = &context->poll_always_ready; *always; always = &(*always)->always_next)
+	    if (*always == kfd)
+	      {
+		*always = kfd->always_next;
+		break;
+	      }
+	}
+      g_hash_table_remove (context->poll_kernel_fds, GINT_TO_POINTER (kfd->fd));
+      g_free (kfd);
+    }
 }
 
-guint 
-g_source_add (gint           priority,
-	      gboolean       can_recurse,
-	      GSourceFuncs  *funcs,
-	      gpointer       source_data, 
-	      gpointer       user_data,
-	      GDestroyNotify notify)
+/* clears the records that are about to be polled, like poll() would.
+ * HOLDS: main_loop_lock
+ */
+static void
+g_main_kernel_clear_ready (GMainContext *context,
+			   gboolean      use_priority,
+			   gint          priority)
 {
-  guint return_val;
-  GSource *source;
+  guint i, n = 0;
+
+  for (i = 0; i < context->n_poll_ready; i++)
+    if (use_priority && context->poll_ready[i]->priority > priority)
+      context->poll_ready[n++] = context->poll_ready[i];
+    else
+      {
+	context->poll_ready[i]->fd->revents = 0;
+	context->poll_ready[i]->ready = FALSE;
+      }
+  context->n_poll_ready = n;
+}
 
-  G_LOCK (main_loop);
+/* HOLDS: main_loop_lock */
+static void
+g_main_kernel_report (GMainContext  *context,
+		      GPollKernelFd *kfd,
+		      gushort        revents,
+		      gboolean       use_priority,
+		      gint           priority)
+{
+  GPollRec *pollrec;
 
-  if (!source_list.is_setup)
+  for (pollrec = kfd->records; pollrec; pollrec = pollrec->fd_next)
     {
-      g_hook_list_init (&source_list, sizeof (GSource));
+      gushort mask = pollrec->fd->events;
+
+      if (!mask || (use_priority && pollrec->priority > priority))
+	continue;
 
-      source_list.hook_destroy = G_HOOK_DEFERRED_DESTROY;
-      source_list.hook_free = g_source_destroy_func;
+      if (!pollrec->ready)
+	{
+	  if (context->n_poll_ready == context->poll_ready_size)
+	    {
+	      context->poll_ready_size = MAX (16, 2 * context->poll_ready_size);
+	      context->poll_ready = g_renew (GPollRec*, context->poll_ready, context->poll_ready_size);
+	    }
+	  context->poll_ready[context->n_poll_ready++] = pollrec;
+	  pollrec->ready = TRUE;
+	  pollrec->fd->revents = 0;
+	}
+      pollrec->fd->revents |= revents & (mask | G_IO_ERR | G_IO_HUP | G_IO_NVAL);
+      if (pollrec->source && (pollrec->fd->revents & mask))
+	g_source_queue_ready (pollrec->source);
     }
+}
 
-  source = (GSource*) g_hook_alloc (&source_list);
-  source->priority = priority;
-  source->source_data = source_data;
-  source->hook.func = funcs;
-  source->hook.data = user_data;
-  source->hook.destroy = notify;
-  
-  g_hook_insert_sorted (&source_list, 
-			(GHook *)source, 
-			g_source_compare);
+static void
+g_main_kernel_free_fd (gpointer key,
+		       gpointer value,
+		       gpointer user_data)
+{
+  g_free (value);
+}
 
-  if (can_recurse)
-    source->hook.flags |= G_SOURCE_CAN_RECURSE;
+/* HOLDS: main_loop_lock */
+static void
+g_main_kernel_close (GMainContext *context)
+{
+  GPollRec *pollrec;
 
-  return_val = source->hook.hook_id;
+  if (context->poll_kernel_fd < 0)
+    return;
+
+  g_main_kernel_clear_ready (context, FALSE, 0);
+  for (pollrec = context->poll_records; pollrec; pollrec = pollrec->next)
+    pollrec->fd_next = NULL;
+
+  g_hash_table_foreach (context->poll_kernel_fds, g_main_kernel_free_fd, NULL);
+  g_hash_table_destroy (context->poll_kernel_fds);
+  context->poll_kernel_fds = NULL;
+  context->poll_always_ready = NULL;
+  g_free (context->poll_kernel_events);
+  context->poll_kernel_events = NULL;
+
+  close (context->poll_kernel_fd);
+  context->poll_kernel_fd = -1;
+}
+
+/* HOLDS: main_loop_lock */
+static gboolean
+g_main_kernel_open (GMainContext *context)
+{
+  GPollRec *pollrec;
+
+#ifdef G_MAIN_HAVE_EPOLL
+  context->poll_kernel_fd = epoll_create (MAX (context->n_poll_records, 16));
+#else /* G_MAIN_HAVE_KQUEUE */
+  context->poll_kernel_fd = kqueue ();
+#endif
+  if (context->poll_kernel_fd < 0)
+    return FALSE;
+#ifdef FD_CLOEXEC
+  fcntl (context->poll_kernel_fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+  context->poll_kernel_fds = g_hash_table_new (NULL, NULL);
+#ifdef G_MAIN_HAVE_EPOLL
+  context->poll_kernel_events = g_new (struct epoll_event, G_MAIN_KERNEL_EVENTS);
+#else /* G_MAIN_HAVE_KQUEUE */
+  context->poll_kernel_events = g_new (struct kevent, G_MAIN_KERNEL_EVENTS);
+#endif
+  for (pollrec = context->poll_records; pollrec; pollrec = pollrec->next)
+    g_main_kernel_add (context, pollrec);
+
+  return TRUE;
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_main_poll_kernel (GMainContext *context,
+		    gint          timeout,
+		    gboolean      use_priority,
+		    gint          priority)
+{
+  GPollKernelFd *kfd;
+  gint n_events;
+  gint i;
+
+  g_main_kernel_clear_ready (context, use_priority, priority);
+
+  if (context->poll_always_ready)
+    timeout = 0;
 
 #ifdef G_THREADS_ENABLED
-  /* Now wake up the main loop if it is waiting in the poll() */
-  g_main_wakeup ();
+  context->poll_waiting = TRUE;
+  context->poll_blocking = timeout != 0;
+  context->poll_changed = FALSE;
 #endif
 
-  G_UNLOCK (main_loop);
+  UNLOCK_CONTEXT (context);
+#ifdef G_MAIN_HAVE_EPOLL
+  n_events = epoll_wait (context->poll_kernel_fd, context->poll_kernel_events,
+			 G_MAIN_KERNEL_EVENTS, timeout);
+#else /* G_MAIN_HAVE_KQUEUE */
+  {
+    struct timespec ts;
+
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000;
+    n_events = kevent (context->poll_kernel_fd, NULL, 0, context->poll_kernel_events,
+		       G_MAIN_KERNEL_EVENTS, timeout < 0 ? NULL : &ts);
+  }
+#endif
+  LOCK_CONTEXT (context);
 
-  return return_val;
+#ifdef G_THREADS_ENABLED
+  g_main_wakeup_clear (context);
+
+  /* If the set of poll file descriptors changed, bail out
+   * and let the main loop rerun
+   */
+  if (context->poll_changed)
+    return;
+#endif
+
+  for (i = 0; i < n_events; i++)
+    {
+#ifdef G_MAIN_HAVE_EPOLL
+      guint32 events = context->poll_kernel_events[i].events;
+      gushort revents = ((events & EPOLLIN ? G_IO_IN : 0) |
+			 (events & EPOLLOUT ? G_IO_OUT : 0) |
+			 (events & EPOLLPRI ? G_IO_PRI : 0) |
+			 (events & EPOLLERR ? G_IO_ERR : 0) |
+			 (events & EPOLLHUP ? G_IO_HUP : 0));
+
+      kfd = g_hash_table_lookup (context->poll_kernel_fds,
+				 GINT_TO_POINTER (context->poll_kernel_events[i].data.fd));
+#else /* G_MAIN_HAVE_KQUEUE */
+      struct kevent *event = &context->poll_kernel_events[i];
+      gushort revents;
+
+      if (event->flags & EV_ERROR)
+	revents = G_IO_ERR;
+      else if (event->filter == EVFILT_WRITE)
+	revents = G_IO_OUT;
+      else
+	revents = G_IO_IN | G_IO_PRI;
+      if (event->flags & EV_EOF)
+	revents |= G_IO_HUP;
+
+      kfd = g_hash_table_lookup (context->poll_kernel_fds, GINT_TO_POINTER ((gint) event->ident));
+#endif
+      if (kfd)
+	g_main_kernel_report (context, kfd, revents, use_priority, priority);
+    }
+
+  for (kfd = context->poll_always_ready; kfd; kfd = kfd->always_next)
+    g_main_kernel_report (context, kfd, kfd->events, use_priority, priority);
 }
 
-gboolean
-g_source_remove (guint tag)
+#endif /* G_MAIN_HAVE_KERNEL_POLL */
+
+/* Profiling */
+
+static void
+g_main_histogram_add (GMainHistogram *histogram,
+		      glong           usec)
 {
-  GHook *hook;
+  guint bucket = 0;
 
-  g_return_val_if_fail (tag > 0, FALSE);
+  if (usec < 0)
+    usec = 0;
+  while (bucket < G_MAIN_HISTOGRAM_BUCKETS - 1 && (usec >> bucket) > 0)
+    bucket++;
 
-  G_LOCK (main_loop);
+  histogram->count++;
+  histogram->total_usec += usec;
+  histogram->max_usec = MAX (histogram->max_usec, (gulong) usec);
+  histogram->buckets[bucket]++;
+}
 
-  hook = g_hook_get (&source_list, tag);
-  if (hook)
-    g_hook_destroy_link (&source_list, hook);
+/* returns the microseconds elapsed since start, and stores the
+ * current time in start
+ */
+static glong
+g_main_profile_elapsed (GTimeVal *start)
+{
+  GTimeVal current_time;
+  glong usec;
 
-  G_UNLOCK (main_loop);
+  g_get_monotonic_time (&current_time);
+  usec = ((current_time.tv_sec - start->tv_sec) * 1000000 +
+	  current_time.tv_usec - start->tv_usec);
+  *start = current_time;
 
-  return hook != NULL;
+  return usec;
 }
 
-gboolean
-g_source_remove_by_user_data (gpointer user_data)
+/* HOLDS: main_loop lock */
+static GMainSourceProfile*
+g_main_profile_lookup (GMainContext *context,
+		       guint         tag,
+		       GSourceFuncs *funcs)
 {
-  GHook *hook;
-  
-  G_LOCK (main_loop);
-  
-  hook = g_hook_find_data (&source_list, TRUE, user_data);
-  if (hook)
-    g_hook_destroy_link (&source_list, hook);
+  GMainSourceProfile *profile;
 
-  G_UNLOCK (main_loop);
+  if (!context->source_profiles)
+    context->source_profiles = g_hash_table_new (NULL, NULL);
 
-  return hook != NULL;
+  profile = g_hash_table_lookup (context->source_profiles, GUINT_TO_POINTER (tag));
+  if (!profile)
+    {
+      profile = g_new0 (GMainSourceProfile, 1);
+      profile->tag = tag;
+      profile->funcs = funcs;
+      g_hash_table_insert (context->source_profiles, GUINT_TO_POINTER (tag), profile);
+    }
+
+  return profile;
 }
 
 static gboolean
-g_source_find_source_data (GHook	*hook,
-			   gpointer	 data)
+g_main_profile_free (gpointer key,
+		     gpointer value,
+		     gpointer user_data)
 {
-  GSource *source = (GSource *)hook;
+  g_free (value);
 
-  return (source->source_data == data);
+  return TRUE;
 }
 
-gboolean
-g_source_remove_by_source_data (gpointer source_data)
+static void
+g_main_profile_copy (gpointer key,
+		     gpointer value,
+		     gpointer user_data)
 {
-  GHook *hook;
+  GSList **profiles = user_data;
 
-  G_LOCK (main_loop);
+  *profiles = g_slist_prepend (*profiles, g_memdup (value, sizeof (GMainSourceProfile)));
+}
 
-  hook = g_hook_find (&source_list, TRUE, 
-		      g_source_find_source_data, source_data);
-  if (hook)
-    g_hook_destroy_link (&source_list, hook);
+static gint
+g_main_profile_compare (gconstpointer a,
+			gconstpointer b)
+{
+  const GMainSourceProfile *profile_a = a;
+  const GMainSourceProfile *profile_b = b;
 
-  G_UNLOCK (main_loop);
+  if (profile_a->dispatch.total_usec != profile_b->dispatch.total_usec)
+    return profile_a->dispatch.total_usec < profile_b->dispatch.total_usec ? 1 : -1;
 
-  return hook != NULL;
+  return profile_a->tag < profile_b->tag ? -1 : profile_a->tag > profile_b->tag;
 }
 
-static gboolean
-g_source_find_funcs_user_data (GHook   *hook,
-			       gpointer data)
+void
+g_main_context_set_profiling (GMainContext *context,
+			      gboolean      enabled)
 {
-  gpointer *d = data;
+  g_return_if_fail (context != NULL);
 
-  return hook->func == d[0] && hook->data == d[1];
+  LOCK_CONTEXT (context);
+  context->profiling = enabled != FALSE;
+  UNLOCK_CONTEXT (context);
 }
 
-gboolean
-g_source_remove_by_funcs_user_data (GSourceFuncs *funcs,
-				    gpointer      user_data)
+void
+g_main_set_profiling (gboolean enabled)
 {
-  gpointer d[2];
-  GHook *hook;
+  g_main_context_set_profiling (g_main_context_current (), enabled);
+}
 
-  g_return_val_if_fail (funcs != NULL, FALSE);
+GSList*
+g_main_context_get_source_profiles (GMainContext *context)
+{
+  GSList *profiles = NULL;
 
-  G_LOCK (main_loop);
+  g_return_val_if_fail (context != NULL, NULL);
 
-  d[0] = funcs;
-  d[1] = user_data;
+  LOCK_CONTEXT (context);
+  if (context->source_profiles)
+    g_hash_table_foreach (context->source_profiles, g_main_profile_copy, &profiles);
+  UNLOCK_CONTEXT (context);
 
-  hook = g_hook_find (&source_list, TRUE,
-		      g_source_find_funcs_user_data, d);
-  if (hook)
-    g_hook_destroy_link (&source_list, hook);
+  return g_slist_sort (profiles, g_main_profile_compare);
+}
 
-  G_UNLOCK (main_loop);
+void
+g_main_context_get_loop_profile (GMainContext     *context,
+				 GMainLoopProfile *profile)
+{
+  g_return_if_fail (context != NULL);
+  g_return_if_fail (profile != NULL);
 
-  return hook != NULL;
+  LOCK_CONTEXT (context);
+  *profile = context->loop_profile;
+  UNLOCK_CONTEXT (context);
 }
 
 void
-g_get_current_time (GTimeVal *result)
+g_main_context_reset_profile (GMainContext *context)
 {
-#ifndef _MSC_VER
-  struct timeval r;
-  g_return_if_fail (result != NULL);
+  g_return_if_fail (context != NULL);
 
-  /*this is required on alpha, there the timeval structs are int's
-    not longs and a cast only would fail horribly*/
+  LOCK_CONTEXT (context);
+  if (context->source_profiles)
+    g_hash_table_foreach_remove (context->source_profiles, g_main_profile_free, NULL);
+  memset (&context->loop_profile, 0, sizeof (GMainLoopProfile));
+  UNLOCK_CONTEXT (context);
+}
+
+/* Main contexts */
+
+/* HOLDS: main_loop lock, for the default context */
+static void
+g_main_context_init (GMainContext *context)
+{
+  memset (context, 0, sizeof (GMainContext));
+
+  g_hook_list_init (&context->source_list, sizeof (GSource));
+  context->source_list.hook_destroy = G_HOOK_DEFERRED_DESTROY;
+  context->source_list.hook_free = g_source_destroy_func;
+
+  g_hook_list_init (&context->passive_list, sizeof (GSource));
+  context->passive_list.hook_destroy = G_HOOK_DEFERRED_DESTROY;
+  context->passive_list.hook_free = g_source_destroy_func;
+
+  context->poll_func = default_poll_func;
+
+#ifdef G_THREADS_ENABLED
+#ifndef NATIVE_WIN32
+  context->wake_up_pipe[0] = -1;
+  context->wake_up_pipe[1] = -1;
+#endif
+#endif
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  context->poll_backend = G_MAIN_POLL_DEFAULT;
+  context->poll_kernel_fd = -1;
+#endif
+}
+
+GMainContext*
+g_main_context_default (void)
+{
+  if (!default_context)
+    {
+      G_LOCK (main_loop);
+      if (!default_context)
+	{
+	  g_main_context_init (&default_context_data);
+	  default_context = &default_context_data;
+	}
+      G_UNLOCK (main_loop);
+    }
+
+  return default_context;
+}
+
+/* a context with its own lock, to be run by another thread than
+ * the default context.
+ */
+GMainContext*
+g_main_context_new (void)
+{
+  GMainContext *context = g_new (GMainContext, 1);
+
+  g_main_context_init (context);
+  if (g_thread_supported ())
+    context->mutex = g_mutex_new ();
+
+  return context;
+}
+
+void
+g_main_context_destroy (GMainContext *context)
+{
+  GMainContext *old_context;
+  GReadyQueue *queue;
+
+  g_return_if_fail (context != NULL);
+  g_return_if_fail (context != default_context);
+  g_return_if_fail (context->pending_dispatches == NULL);
+
+  /* run the destroy notifiers of the remaining sources, they may
+   * still remove their poll records
+   */
+  old_context = g_main_context_push (context);
+  LOCK_CONTEXT (context);
+  while (context->deferred_dispatches)
+    {
+      GSList *tmp_list = context->deferred_dispatches;
+      GSource *source = tmp_list->data;
+
+      context->deferred_dispatches = g_slist_remove_link (tmp_list, tmp_list);
+      g_slist_free_1 (tmp_list);
+      source->hook.flags &= ~G_SOURCE_DEFERRED;
+      g_hook_unref (G_SOURCE_LIST (source), (GHook*) source);
+    }
+  for (queue = context->ready_queues; queue; queue = queue->next)
+    while (queue->head)
+      {
+	GSource *source = queue->head;
+
+	queue->head = source->ready_next;
+	if (!queue->head)
+	  queue->tail = NULL;
+	source->ready_next = NULL;
+	source->hook.flags &= ~G_SOURCE_QUEUED;
+	g_hook_unref (&context->passive_list, (GHook*) source);
+      }
+  g_hook_list_clear (&context->source_list);
+  g_hook_list_clear (&context->passive_list);
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  g_main_kernel_close (context);
+  g_free (context->poll_ready);
+#endif
+  UNLOCK_CONTEXT (context);
+  g_main_context_pop (old_context);
+
+  while (context->ready_queues)
+    {
+      queue = context->ready_queues;
+      context->ready_queues = queue->next;
+      g_free (queue);
+    }
+  g_free (context->timer_heap);
+  if (context->source_profiles)
+    {
+      g_hash_table_foreach_remove (context->source_profiles, g_main_profile_free, NULL);
+      g_hash_table_destroy (context->source_profiles);
+    }
+  if (context->poll_chunk)
+    g_mem_chunk_destroy (context->poll_chunk);
+
+#ifdef G_THREADS_ENABLED
+#ifndef NATIVE_WIN32
+  if (context->wake_up_pipe[0] >= 0)
+    {
+      close (context->wake_up_pipe[0]);
+      if (context->wake_up_pipe[1] != context->wake_up_pipe[0])
+	close (context->wake_up_pipe[1]);
+    }
+#else
+  if (context->wake_up_semaphore)
+    CloseHandle (context->wake_up_semaphore);
+#endif
+#endif
+
+  if (context->mutex)
+    g_mutex_free (context->mutex);
+  g_free (context);
+}
+
+/* the context used by the functions without a context argument in
+ * the calling thread. while a context is iterated, it is the thread
+ * default context for its callbacks.
+ */
+void
+g_main_context_set_thread_default (GMainContext *context)
+{
+  g_static_private_set (&thread_context, context, NULL);
+}
+
+GMainContext*
+g_main_context_get_thread_default (void)
+{
+  return g_main_context_current ();
+}
+
+static GMainContext*
+g_main_context_current (void)
+{
+  GMainContext *context = g_static_private_get (&thread_context);
+
+  return context ? context : g_main_context_default ();
+}
+
+static GMainContext*
+g_main_context_push (GMainContext *context)
+{
+  GMainContext *old_context = g_static_private_get (&thread_context);
+
+  if (old_context != context)
+    g_static_private_set (&thread_context, context, NULL);
+
+  return old_context;
+}
+
+static void
+g_main_context_pop (GMainContext *old_context)
+{
+  if (g_static_private_get (&thread_context) != old_context)
+    g_static_private_set (&thread_context, old_context, NULL);
+}
+
+/* Hooks for adding to the main loop */
+
+/* Use knowledge of insert_sorted algorithm here to make
+ * sure we insert at the end of equal priority items
+ */
+static gint
+g_source_compare (GHook *a,
+		  GHook *b)
+{
+  GSource *source_a = (GSource *)a;
+  GSource *source_b = (GSource *)b;
+
+  return (source_a->priority < source_b->priority) ? -1 : 1;
+}
+
+/* HOLDS: main_loop lock */
+static void
+g_source_destroy_func (GHookList *hook_list,
+		       GHook     *hook)
+{
+  GSource *source = (GSource*) hook;
+  GMainContext *context = source->context;
+  GMainContext *old_context;
+  GDestroyNotify destroy;
+
+  if (hook->flags & G_SOURCE_TIMER)
+    g_timer_heap_remove (source->source_data);
+
+  UNLOCK_CONTEXT (context);
+
+  /* the notifiers may remove poll records of this context */
+  old_context = g_main_context_push (context);
+
+  destroy = hook->destroy;
+  if (destroy)
+    destroy (hook->data);
+
+  destroy = ((GSourceFuncs*) hook->func)->destroy;
+  if (destroy)
+    destroy (source->source_data);
+
+  g_main_context_pop (old_context);
+
+  LOCK_CONTEXT (context);
+}
+
+/* HOLDS: main_loop lock */
+static GSource*
+g_source_add_unlocked (GMainContext  *context,
+		       gint           priority,
+		       gboolean       can_recurse,
+		       gboolean       passive,
+		       GSourceFuncs  *funcs,
+		       gpointer       source_data, 
+		       gpointer       user_data,
+		       GDestroyNotify notify)
+{
+  GHookList *hook_list = passive ? &context->passive_list : &context->source_list;
+  GSource *source;
+
+  source = (GSource*) g_hook_alloc (hook_list);
+  source->priority = priority;
+  source->source_data = source_data;
+  source->ready_next = NULL;
+  source->context = context;
+  source->hook.func = funcs;
+  source->hook.data = user_data;
+  source->hook.destroy = notify;
+  
+  /* the hook lists of all contexts share one id sequence */
+  G_LOCK (source_ids);
+  hook_list->seq_id = source_seq_id;
+
+  if (passive)
+    {
+      /* passive sources aren't walked, so they need no sorting */
+      g_hook_prepend (hook_list, (GHook *)source);
+      source->hook.flags |= G_SOURCE_PASSIVE;
+    }
+  else
+    g_hook_insert_sorted (hook_list, 
+			  (GHook *)source, 
+			  g_source_compare);
+
+  source_seq_id = hook_list->seq_id;
+  G_UNLOCK (source_ids);
+
+  if (can_recurse)
+    source->hook.flags |= G_SOURCE_CAN_RECURSE;
+
+#ifdef G_THREADS_ENABLED
+  /* Now wake up the main loop if it is waiting in the poll() */
+  g_main_wakeup (context);
+#endif
+
+  return source;
+}
+
+guint 
+g_main_context_add_source (GMainContext  *context,
+			   gint           priority,
+			   gboolean       can_recurse,
+			   GSourceFuncs  *funcs,
+			   gpointer       source_data, 
+			   gpointer       user_data,
+			   GDestroyNotify notify)
+{
+  guint return_val;
+  GSource *source;
+
+  g_return_val_if_fail (context != NULL, 0);
+
+  LOCK_CONTEXT (context);
+
+  source = g_source_add_unlocked (context, priority, can_recurse, FALSE, funcs,
+				  source_data, user_data, notify);
+  return_val = source->hook.hook_id;
+
+  UNLOCK_CONTEXT (context);
+
+  return return_val;
+}
+
+guint 
+g_source_add (gint           priority,
+	      gboolean       can_recurse,
+	      GSourceFuncs  *funcs,
+	      gpointer       source_data, 
+	      gpointer       user_data,
+	      GDestroyNotify notify)
+{
+  return g_main_context_add_source (g_main_context_current (), priority,
+				    can_recurse, funcs, source_data,
+				    user_data, notify);
+}
+
+/* passive sources are only dispatched after they have been flagged
+ * ready with g_source_set_ready(), or when one of the GPollFDs added
+ * for them with g_main_add_poll_for_source() reports a requested
+ * event. funcs->prepare and funcs->check are never called. a main
+ * loop iteration only looks at the passive sources that are ready.
+ */
+guint 
+g_source_add_passive (gint           priority,
+		      gboolean       can_recurse,
+		      GSourceFuncs  *funcs,
+		      gpointer       source_data, 
+		      gpointer       user_data,
+		      GDestroyNotify notify)
+{
+  GMainContext *context;
+  guint return_val;
+  GSource *source;
+
+  g_return_val_if_fail (funcs != NULL, 0);
+
+  context = g_main_context_current ();
+  LOCK_CONTEXT (context);
+
+  source = g_source_add_unlocked (context, priority, can_recurse, TRUE, funcs,
+				  source_data, user_data, notify);
+  return_val = source->hook.hook_id;
+
+  UNLOCK_CONTEXT (context);
+
+  return return_val;
+}
+
+gboolean
+g_main_context_set_source_ready (GMainContext *context,
+				 guint         tag)
+{
+  GHook *hook;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+  g_return_val_if_fail (tag > 0, FALSE);
+
+  LOCK_CONTEXT (context);
+
+  hook = g_hook_get (&context->passive_list, tag);
+  if (hook && G_HOOK_IS_VALID (hook))
+    {
+      g_source_queue_ready ((GSource*) hook);
+#ifdef G_THREADS_ENABLED
+      g_main_wakeup (context);
+#endif
+    }
+  else
+    hook = NULL;
+
+  UNLOCK_CONTEXT (context);
+
+  return hook != NULL;
+}
+
+gboolean
+g_source_set_ready (guint tag)
+{
+  return g_main_context_set_source_ready (g_main_context_current (), tag);
+}
+
+/* HOLDS: main_loop lock */
+static void
+g_source_queue_ready (GSource *source)
+{
+  GMainContext *context = source->context;
+  GReadyQueue *queue, *prev;
+
+  if (source->hook.flags & G_SOURCE_QUEUED || !G_HOOK_IS_VALID (source))
+    return;
+
+  prev = NULL;
+  queue = context->ready_queues;
+  while (queue && queue->priority < source->priority)
+    {
+      prev = queue;
+      queue = queue->next;
+    }
+  if (!queue || queue->priority != source->priority)
+    {
+      GReadyQueue *new_queue = g_new (GReadyQueue, 1);
+
+      new_queue->priority = source->priority;
+      new_queue->head = NULL;
+      new_queue->tail = NULL;
+      new_queue->next = queue;
+      if (prev)
+	prev->next = new_queue;
+      else
+	context->ready_queues = new_queue;
+      queue = new_queue;
+    }
+
+  g_hook_ref (&context->passive_list, (GHook*) source);
+  source->hook.flags |= G_SOURCE_QUEUED;
+  source->ready_next = NULL;
+  if (queue->tail)
+    queue->tail->ready_next = source;
+  else
+    queue->head = source;
+  queue->tail = source;
+}
+
+/* unlinks the queued sources for which "func" returns TRUE, in
+ * order, and drops those that have been destroyed meanwhile.
+ * HOLDS: main_loop lock
+ */
+static GSList*
+g_ready_queue_take (GReadyQueue *queue,
+		    gboolean     take_all,
+		    GSList     **destroyed)
+{
+  GSList *taken = NULL;
+  GSource *source, *prev;
+
+  prev = NULL;
+  source = queue->head;
+  while (source)
+    {
+      GSource *next = source->ready_next;
+
+      if (!G_HOOK_IS_VALID (source) ||
+	  (take_all && G_SOURCE_CAN_DISPATCH (source)))
+	{
+	  if (prev)
+	    prev->ready_next = next;
+	  else
+	    queue->head = next;
+	  if (queue->tail == source)
+	    queue->tail = prev;
+	  source->ready_next = NULL;
+	  source->hook.flags &= ~G_SOURCE_QUEUED;
+
+	  if (G_HOOK_IS_VALID (source))
+	    taken = g_slist_prepend (taken, source);
+	  else
+	    *destroyed = g_slist_prepend (*destroyed, source);
+	}
+      else
+	prev = source;
+      source = next;
+    }
+
+  return g_slist_reverse (taken);
+}
+
+/* finds the first priority with a passive source that can be
+ * dispatched, if "take" is TRUE, the sources at that priority are
+ * removed from the queue and returned.
+ * HOLDS: main_loop lock
+ */
+static gboolean
+g_ready_queues_first (GMainContext *context,
+		      gint         *priority,
+		      GSList      **taken)
+{
+  GReadyQueue *queue;
+  GSList *destroyed = NULL;
+  gboolean found = FALSE;
+
+  for (queue = context->ready_queues; queue && !found; queue = queue->next)
+    {
+      GSource *source;
+
+      g_slist_free (g_ready_queue_take (queue, FALSE, &destroyed));
+      for (source = queue->head; source; source = source->ready_next)
+	if (G_SOURCE_CAN_DISPATCH (source))
+	  break;
+
+      if (source)
+	{
+	  found = TRUE;
+	  *priority = queue->priority;
+	  if (taken)
+	    *taken = g_ready_queue_take (queue, TRUE, &destroyed);
+	}
+    }
+
+  /* this may run destroy notifiers, so the queues must be
+   * consistent by now
+   */
+  while (destroyed)
+    {
+      GSList *tmp_list = destroyed;
+
+      destroyed = g_slist_remove_link (destroyed, destroyed);
+      g_hook_unref (&context->passive_list, tmp_list->data);
+      g_slist_free_1 (tmp_list);
+    }
+
+  return found;
+}
+
+gboolean
+g_main_context_remove_source (GMainContext *context,
+			      guint         tag)
+{
+  GHook *hook;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+  g_return_val_if_fail (tag > 0, FALSE);
+
+  LOCK_CONTEXT (context);
+
+  hook = g_hook_get (&context->source_list, tag);
+  if (!hook)
+    hook = g_hook_get (&context->passive_list, tag);
+  if (hook)
+    g_hook_destroy_link (G_SOURCE_LIST (hook), hook);
+
+  UNLOCK_CONTEXT (context);
+
+  return hook != NULL;
+}
+
+gboolean
+g_source_remove (guint tag)
+{
+  return g_main_context_remove_source (g_main_context_current (), tag);
+}
+
+gboolean
+g_source_remove_by_user_data (gpointer user_data)
+{
+  GMainContext *context = g_main_context_current ();
+  GHook *hook;
+  
+  LOCK_CONTEXT (context);
+  
+  hook = g_hook_find_data (&context->source_list, TRUE, user_data);
+  if (!hook)
+    hook = g_hook_find_data (&context->passive_list, TRUE, user_data);
+  if (hook)
+    g_hook_destroy_link (G_SOURCE_LIST (hook), hook);
+
+  UNLOCK_CONTEXT (context);
+
+  return hook != NULL;
+}
+
+static gboolean
+g_source_find_source_data (GHook	*hook,
+			   gpointer	 data)
+{
+  GSource *source = (GSource *)hook;
+
+  return (source->source_data == data);
+}
+
+gboolean
+g_source_remove_by_source_data (gpointer source_data)
+{
+  GMainContext *context = g_main_context_current ();
+  GHook *hook;
+
+  LOCK_CONTEXT (context);
+
+  hook = g_hook_find (&context->source_list, TRUE, 
+		      g_source_find_source_data, source_data);
+  if (!hook)
+    hook = g_hook_find (&context->passive_list, TRUE, 
+			g_source_find_source_data, source_data);
+  if (hook)
+    g_hook_destroy_link (G_SOURCE_LIST (hook), hook);
+
+  UNLOCK_CONTEXT (context);
+
+  return hook != NULL;
+}
+
+static gboolean
+g_source_find_funcs_user_data (GHook   *hook,
+			       gpointer data)
+{
+  gpointer *d = data;
+
+  return hook->func == d[0] && hook->data == d[1];
+}
+
+gboolean
+g_source_remove_by_funcs_user_data (GSourceFuncs *funcs,
+				    gpointer      user_data)
+{
+  GMainContext *context;
+  gpointer d[2];
+  GHook *hook;
+
+  g_return_val_if_fail (funcs != NULL, FALSE);
+
+  context = g_main_context_current ();
+  LOCK_CONTEXT (context);
+
+  d[0] = funcs;
+  d[1] = user_data;
+
+  hook = g_hook_find (&context->source_list, TRUE,
+		      g_source_find_funcs_user_data, d);
+  if (!hook)
+    hook = g_hook_find (&context->passive_list, TRUE,
+			g_source_find_funcs_user_data, d);
+  if (hook)
+    g_hook_destroy_link (G_SOURCE_LIST (hook), hook);
+
+  UNLOCK_CONTEXT (context);
+
+  return hook != NULL;
+}
+
+void
+g_get_current_time (GTimeVal *result)
+{
+#ifndef _MSC_VER
+  struct timeval r;
+  g_return_if_fail (result != NULL);
+
+  /*this is required on alpha, there the timeval structs are int's
+    not longs and a cast only would fail horribly*/
   gettimeofday (&r, NULL);
   result->tv_sec = r.tv_sec;
   result->tv_usec = r.tv_usec;
@@ -622,20 +1768,112 @@ g_get_current_time (GTimeVal *result)
 #endif
 }
 
+/* The loop time is the monotonic time (see g_get_monotonic_time())
+ * read when the current iteration of the context started, updated
+ * when it returns from poll. Sources can use it instead of reading
+ * the clock themselves.
+ */
+void
+g_main_context_get_loop_time (GMainContext *context,
+			      GTimeVal     *result)
+{
+  g_return_if_fail (context != NULL);
+  g_return_if_fail (result != NULL);
+
+  LOCK_CONTEXT (context);
+  *result = context->loop_time;
+  UNLOCK_CONTEXT (context);
+
+  /* not iterated yet */
+  if (result->tv_sec == 0 && result->tv_usec == 0)
+    g_get_monotonic_time (result);
+}
+
+void
+g_main_get_loop_time (GTimeVal *result)
+{
+  g_main_context_get_loop_time (g_main_context_current (), result);
+}
+
 /* Running the main loop */
 
 /* HOLDS: main_loop_lock */
 static void
-g_main_dispatch (GTimeVal *dispatch_time)
+g_main_defer_dispatches (GMainContext *context)
 {
-  while (pending_dispatches != NULL)
+  GSList *tmp_list;
+
+  if (!context->deferred_dispatches)
+    context->deferred_priority = ((GSource*) context->pending_dispatches->data)->priority;
+
+  for (tmp_list = context->pending_dispatches; tmp_list; tmp_list = tmp_list->next)
+    {
+      GSource *source = tmp_list->data;
+
+      source->hook.flags |= G_SOURCE_DEFERRED;
+      context->deferred_priority = MIN (context->deferred_priority, source->priority);
+      context->dispatch_stats.n_deferred++;
+    }
+  context->dispatch_stats.n_budget_exceeded++;
+
+  context->deferred_dispatches = g_slist_concat (context->pending_dispatches,
+						 context->deferred_dispatches);
+  context->pending_dispatches = NULL;
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_main_dispatch (GMainContext *context,
+		 GTimeVal     *dispatch_time)
+{
+  GTimeVal deadline = { 0, 0 };
+  guint n_dispatched = 0;
+
+  if (context->dispatch_max_usec > 0)
+    {
+      g_get_monotonic_time (&deadline);
+      deadline.tv_sec += context->dispatch_max_usec / 1000000;
+      deadline.tv_usec += context->dispatch_max_usec % 1000000;
+      if (deadline.tv_usec >= 1000000)
+	{
+	  deadline.tv_usec -= 1000000;
+	  deadline.tv_sec++;
+	}
+    }
+
+  while (context->pending_dispatches != NULL)
     {
       gboolean need_destroy;
-      GSource *source = pending_dispatches->data;
+      GSource *source = context->pending_dispatches->data;
       GSList *tmp_list;
 
-      tmp_list = pending_dispatches;
-      pending_dispatches = g_slist_remove_link (pending_dispatches, pending_dispatches);
+      /* always dispatch at least one source, so the budget can't
+       * stall the main loop
+       */
+      if (n_dispatched > 0)
+	{
+	  gboolean exhausted = FALSE;
+
+	  if (context->dispatch_max > 0 && n_dispatched >= context->dispatch_max)
+	    exhausted = TRUE;
+	  else if (context->dispatch_max_usec > 0)
+	    {
+	      GTimeVal current_time;
+
+	      g_get_monotonic_time (&current_time);
+	      exhausted = (current_time.tv_sec > deadline.tv_sec ||
+			   (current_time.tv_sec == deadline.tv_sec &&
+			    current_time.tv_usec >= deadline.tv_usec));
+	    }
+	  if (exhausted)
+	    {
+	      g_main_defer_dispatches (context);
+	      break;
+	    }
+	}
+
+      tmp_list = context->pending_dispatches;
+      context->pending_dispatches = g_slist_remove_link (context->pending_dispatches, context->pending_dispatches);
       g_slist_free_1 (tmp_list);
 
       if (G_HOOK_IS_VALID (source))
@@ -643,6 +1881,9 @@ g_main_dispatch (GTimeVal *dispatch_time)
 	  gboolean was_in_call;
 	  gpointer hook_data = source->hook.data;
 	  gpointer source_data = source->source_data;
+	  gboolean profiling = context->profiling;
+	  guint tag = source->hook.hook_id;
+	  GTimeVal start;
 	  gboolean (*dispatch) (gpointer,
 				GTimeVal *,
 				gpointer);
@@ -651,21 +1892,41 @@ g_main_dispatch (GTimeVal *dispatch_time)
 	  
 	  was_in_call = G_HOOK_IN_CALL (source);
 	  source->hook.flags |= G_HOOK_FLAG_IN_CALL;
+	  n_dispatched++;
+	  context->dispatch_stats.n_dispatches++;
 
-	  G_UNLOCK (main_loop);
+	  if (profiling)
+	    {
+	      g_get_monotonic_time (&start);
+	      if (source->hook.flags & G_SOURCE_TIMER)
+		{
+		  GTimeVal expiration = ((GTimeoutData*) source_data)->expiration;
+
+		  g_main_histogram_add (&context->loop_profile.timer_lag,
+					g_main_profile_elapsed (&expiration));
+		}
+	    }
+
+	  UNLOCK_CONTEXT (context);
 	  need_destroy = ! dispatch (source_data,
 				     dispatch_time,
 				     hook_data);
-	  G_LOCK (main_loop);
+	  LOCK_CONTEXT (context);
+
+	  if (profiling)
+	    g_main_histogram_add (&g_main_profile_lookup (context, tag, source->hook.func)->dispatch,
+				  g_main_profile_elapsed (&start));
 
 	  if (!was_in_call)
 	    source->hook.flags &= ~G_HOOK_FLAG_IN_CALL;
 	  
 	  if (need_destroy && G_HOOK_IS_VALID (source))
-	    g_hook_destroy_link (&source_list, (GHook *) source);
+	    g_hook_destroy_link (G_SOURCE_LIST (source), (GHook *) source);
+	  else if ((source->hook.flags & G_SOURCE_TIMER) && G_HOOK_IS_VALID (source))
+	    g_timer_heap_insert (source_data);
 	}
 
-      g_hook_unref (&source_list, (GHook*) source);
+      g_hook_unref (G_SOURCE_LIST (source), (GHook*) source);
     }
 }
 
@@ -698,49 +1959,88 @@ g_main_dispatch (GTimeVal *dispatch_time)
  *    call (*dispatch) on each source, removing the source
  *    after the call.
  *
+ * if the dispatch budget runs out in 5), the remaining sources are
+ * deferred. they count as ready at their priority in 2) and 4) of
+ * the next iteration, and are dispatched before the newly ready
+ * sources unless those have a higher priority.
  */
 static gboolean
-g_main_iterate (gboolean block,
-		gboolean dispatch)
+g_main_iterate (GMainContext *context,
+		gboolean      block,
+		gboolean      dispatch)
 {
   GHook *hook;
   GTimeVal current_time  = { 0, 0 };
   gint n_ready = 0;
   gint current_priority = 0;
+  gint queued_priority;
   gint timeout;
+  gint timer_timeout;
   gboolean retval = FALSE;
 
   g_return_val_if_fail (!block || dispatch, FALSE);
 
   g_get_current_time (&current_time);
 
-  G_LOCK (main_loop);
+  LOCK_CONTEXT (context);
 
 #ifdef G_THREADS_ENABLED
-  if (poll_waiting)
+  if (context->poll_waiting)
     {
       g_warning("g_main_iterate(): main loop already active in another thread");
-      G_UNLOCK (main_loop);
+      UNLOCK_CONTEXT (context);
       return FALSE;
     }
 #endif
+
+  g_get_monotonic_time (&context->loop_time);
   
   /* If recursing, finish up current dispatch, before starting over */
-  if (pending_dispatches)
+  if (context->pending_dispatches)
     {
       if (dispatch)
-	g_main_dispatch (&current_time);
+	g_main_dispatch (context, &current_time);
       
-      G_UNLOCK (main_loop);
+      UNLOCK_CONTEXT (context);
 
       return TRUE;
     }
 
-  /* Prepare all sources */
+  /* Prepare all sources, expired timeouts are flagged ready by
+   * the timer heap
+   */
 
   timeout = block ? -1 : 0;
+  timer_timeout = g_timer_heap_expire (context);
+
+  if (context->deferred_dispatches)
+    {
+      if (!dispatch)
+	{
+	  UNLOCK_CONTEXT (context);
+
+	  return TRUE;
+	}
+      n_ready++;
+      current_priority = context->deferred_priority;
+      timeout = 0;
+    }
   
-  hook = g_hook_first_valid (&source_list, TRUE);
+  if (g_ready_queues_first (context, &queued_priority, NULL))
+    {
+      if (!dispatch)
+	{
+	  UNLOCK_CONTEXT (context);
+
+	  return TRUE;
+	}
+      if (n_ready == 0 || queued_priority < current_priority)
+	current_priority = queued_priority;
+      n_ready++;
+      timeout = 0;
+    }
+  
+  hook = g_hook_first_valid (&context->source_list, TRUE);
   while (hook)
     {
       GSource *source = (GSource*) hook;
@@ -748,12 +2048,13 @@ g_main_iterate (gboolean block,
 
       if ((n_ready > 0) && (source->priority > current_priority))
 	{
-	  g_hook_unref (&source_list, hook);
+	  g_hook_unref (&context->source_list, hook);
 	  break;
 	}
-      if (G_HOOK_IN_CALL (hook) && !(hook->flags & G_SOURCE_CAN_RECURSE))
+      if ((G_HOOK_IN_CALL (hook) && !(hook->flags & G_SOURCE_CAN_RECURSE)) ||
+	  (hook->flags & G_SOURCE_DEFERRED))
 	{
-	  hook = g_hook_next_valid (&source_list, hook, TRUE);
+	  hook = g_hook_next_valid (&context->source_list, hook, TRUE);
 	  continue;
 	}
 
@@ -764,23 +2065,32 @@ g_main_iterate (gboolean block,
 				gint     *timeout,
 				gpointer  user_data);
 
+	  gboolean profiling = context->profiling;
+	  guint tag = hook->hook_id;
+	  GTimeVal start;
+
 	  prepare = ((GSourceFuncs *) hook->func)->prepare;
-	  in_check_or_prepare++;
-	  G_UNLOCK (main_loop);
+	  context->in_check_or_prepare++;
+	  if (profiling)
+	    g_get_monotonic_time (&start);
+	  UNLOCK_CONTEXT (context);
 
 	  if ((*prepare) (source->source_data, &current_time, &source_timeout, source->hook.data))
 	    hook->flags |= G_SOURCE_READY;
 	  
-	  G_LOCK (main_loop);
-	  in_check_or_prepare--;
+	  LOCK_CONTEXT (context);
+	  context->in_check_or_prepare--;
+	  if (profiling)
+	    g_main_histogram_add (&g_main_profile_lookup (context, tag, hook->func)->prepare,
+				  g_main_profile_elapsed (&start));
 	}
 
       if (hook->flags & G_SOURCE_READY)
 	{
 	  if (!dispatch)
 	    {
-	      g_hook_unref (&source_list, hook);
-	      G_UNLOCK (main_loop);
+	      g_hook_unref (&context->source_list, hook);
+	      UNLOCK_CONTEXT (context);
 
 	      return TRUE;
 	    }
@@ -800,33 +2110,73 @@ g_main_iterate (gboolean block,
 	    timeout = MIN (timeout, source_timeout);
 	}
 
-      hook = g_hook_next_valid (&source_list, hook, TRUE);
+      hook = g_hook_next_valid (&context->source_list, hook, TRUE);
+    }
+
+  if (timer_timeout >= 0 && timeout != 0)
+    {
+      if (timeout < 0)
+	timeout = timer_timeout;
+      else
+	timeout = MIN (timeout, timer_timeout);
     }
 
   /* poll(), if necessary */
 
-  g_main_poll (timeout, n_ready > 0, current_priority);
+  if (context->profiling)
+    {
+      GTimeVal start;
+
+      g_get_monotonic_time (&start);
+      g_main_poll (context, timeout, n_ready > 0, current_priority);
+      g_main_histogram_add (&context->loop_profile.poll,
+			    g_main_profile_elapsed (&start));
+    }
+  else
+    g_main_poll (context, timeout, n_ready > 0, current_priority);
 
   if (timeout != 0)
-    g_get_current_time (&current_time);
+    {
+      g_get_current_time (&current_time);
+      g_get_monotonic_time (&context->loop_time);
+      g_timer_heap_expire (context);
+    }
   
   /* Check to see what sources need to be dispatched */
 
-  n_ready = 0;
+  n_ready = 0;
+  if (context->deferred_dispatches)
+    {
+      n_ready++;
+      current_priority = context->deferred_priority;
+    }
+  if (g_ready_queues_first (context, &queued_priority, NULL))
+    {
+      if (!dispatch)
+	{
+	  UNLOCK_CONTEXT (context);
+
+	  return TRUE;
+	}
+      if (n_ready == 0 || queued_priority < current_priority)
+	current_priority = queued_priority;
+      n_ready++;
+    }
   
-  hook = g_hook_first_valid (&source_list, TRUE);
+  hook = g_hook_first_valid (&context->source_list, TRUE);
   while (hook)
     {
       GSource *source = (GSource *)hook;
 
       if ((n_ready > 0) && (source->priority > current_priority))
 	{
-	  g_hook_unref (&source_list, hook);
+	  g_hook_unref (&context->source_list, hook);
 	  break;
 	}
-      if (G_HOOK_IN_CALL (hook) && !(hook->flags & G_SOURCE_CAN_RECURSE))
+      if ((G_HOOK_IN_CALL (hook) && !(hook->flags & G_SOURCE_CAN_RECURSE)) ||
+	  (hook->flags & G_SOURCE_DEFERRED))
 	{
-	  hook = g_hook_next_valid (&source_list, hook, TRUE);
+	  hook = g_hook_next_valid (&context->source_list, hook, TRUE);
 	  continue;
 	}
 
@@ -836,15 +2186,24 @@ g_main_iterate (gboolean block,
 			     GTimeVal *current_time,
 			     gpointer  user_data);
 
+	  gboolean profiling = context->profiling;
+	  guint tag = hook->hook_id;
+	  GTimeVal start;
+
 	  check = ((GSourceFuncs *) hook->func)->check;
-	  in_check_or_prepare++;
-	  G_UNLOCK (main_loop);
+	  context->in_check_or_prepare++;
+	  if (profiling)
+	    g_get_monotonic_time (&start);
+	  UNLOCK_CONTEXT (context);
 	  
 	  if ((*check) (source->source_data, &current_time, source->hook.data))
 	    hook->flags |= G_SOURCE_READY;
 
-	  G_LOCK (main_loop);
-	  in_check_or_prepare--;
+	  LOCK_CONTEXT (context);
+	  context->in_check_or_prepare--;
+	  if (profiling)
+	    g_main_histogram_add (&g_main_profile_lookup (context, tag, hook->func)->check,
+				  g_main_profile_elapsed (&start));
 	}
 
       if (hook->flags & G_SOURCE_READY)
@@ -852,87 +2211,206 @@ g_main_iterate (gboolean block,
 	  if (dispatch)
 	    {
 	      hook->flags &= ~G_SOURCE_READY;
-	      g_hook_ref (&source_list, hook);
-	      pending_dispatches = g_slist_prepend (pending_dispatches, source);
+	      g_hook_ref (&context->source_list, hook);
+	      context->pending_dispatches = g_slist_prepend (context->pending_dispatches, source);
 	      current_priority = source->priority;
 	      n_ready++;
 	    }
 	  else
 	    {
-	      g_hook_unref (&source_list, hook);
-	      G_UNLOCK (main_loop);
+	      g_hook_unref (&context->source_list, hook);
+	      UNLOCK_CONTEXT (context);
 
 	      return TRUE;
 	    }
 	}
       
-      hook = g_hook_next_valid (&source_list, hook, TRUE);
+      hook = g_hook_next_valid (&context->source_list, hook, TRUE);
     }
  
-  /* Now invoke the callbacks */
+  /* Add the ready passive sources, if they have the priority
+   * of the checked ones, and invoke the callbacks
+   */
+
+  context->pending_dispatches = g_slist_reverse (context->pending_dispatches);
+  if (n_ready > 0)
+    {
+      GSList *queued = NULL;
+
+      if (g_ready_queues_first (context, &queued_priority, NULL) &&
+	  queued_priority == current_priority)
+	g_ready_queues_first (context, &queued_priority, &queued);
+      context->pending_dispatches = g_slist_concat (context->pending_dispatches, queued);
+    }
+  if (context->deferred_dispatches && context->deferred_priority == current_priority)
+    {
+      GSList *tmp_list;
+
+      for (tmp_list = context->deferred_dispatches; tmp_list; tmp_list = tmp_list->next)
+	((GHook*) tmp_list->data)->flags &= ~G_SOURCE_DEFERRED;
+      context->pending_dispatches = g_slist_concat (context->deferred_dispatches,
+						    context->pending_dispatches);
+      context->deferred_dispatches = NULL;
+    }
 
-  if (pending_dispatches)
+  if (context->pending_dispatches)
     {
-      pending_dispatches = g_slist_reverse (pending_dispatches);
-      g_main_dispatch (&current_time);
+      g_main_dispatch (context, &current_time);
       retval = TRUE;
     }
 
-  G_UNLOCK (main_loop);
+  UNLOCK_CONTEXT (context);
 
   return retval;
 }
 
 /* See if any events are pending
  */
+gboolean 
+g_main_context_pending (GMainContext *context)
+{
+  GMainContext *old_context;
+  gboolean retval;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+
+  if (context->in_check_or_prepare)
+    return FALSE;
+
+  old_context = g_main_context_push (context);
+  retval = g_main_iterate (context, FALSE, FALSE);
+  g_main_context_pop (old_context);
+
+  return retval;
+}
+
 gboolean 
 g_main_pending (void)
 {
-  return in_check_or_prepare ? FALSE : g_main_iterate (FALSE, FALSE);
+  return g_main_context_pending (g_main_context_current ());
+}
+
+/* Limit the number of sources dispatched, or the time spent
+ * dispatching them, in a single iteration. 0 means no limit.
+ */
+void
+g_main_context_set_dispatch_budget (GMainContext *context,
+				    guint         max_dispatches,
+				    glong         max_usec)
+{
+  g_return_if_fail (context != NULL);
+  g_return_if_fail (max_usec >= 0);
+
+  LOCK_CONTEXT (context);
+  context->dispatch_max = max_dispatches;
+  context->dispatch_max_usec = max_usec;
+  UNLOCK_CONTEXT (context);
+}
+
+void
+g_main_set_dispatch_budget (guint max_dispatches,
+			    glong max_usec)
+{
+  g_main_context_set_dispatch_budget (g_main_context_current (),
+				      max_dispatches, max_usec);
+}
+
+void
+g_main_context_get_dispatch_stats (GMainContext       *context,
+				   GMainDispatchStats *stats)
+{
+  g_return_if_fail (context != NULL);
+  g_return_if_fail (stats != NULL);
+
+  LOCK_CONTEXT (context);
+  *stats = context->dispatch_stats;
+  UNLOCK_CONTEXT (context);
+}
+
+void
+g_main_context_reset_dispatch_stats (GMainContext *context)
+{
+  g_return_if_fail (context != NULL);
+
+  LOCK_CONTEXT (context);
+  memset (&context->dispatch_stats, 0, sizeof (GMainDispatchStats));
+  UNLOCK_CONTEXT (context);
 }
 
 /* Run a single iteration of the mainloop. If block is FALSE,
  * will never block
  */
 gboolean
-g_main_iteration (gboolean block)
+g_main_context_iteration (GMainContext *context,
+			  gboolean      block)
 {
-  if (in_check_or_prepare)
+  GMainContext *old_context;
+  gboolean retval;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+
+  if (context->in_check_or_prepare)
     {
       g_warning ("g_main_iteration(): called recursively from within a source's check() or "
 		 "prepare() member or from a second thread, iteration not possible");
       return FALSE;
     }
-  else
-    return g_main_iterate (block, TRUE);
+
+  old_context = g_main_context_push (context);
+  retval = g_main_iterate (context, block, TRUE);
+  g_main_context_pop (old_context);
+
+  return retval;
+}
+
+gboolean
+g_main_iteration (gboolean block)
+{
+  return g_main_context_iteration (g_main_context_current (), block);
 }
 
 GMainLoop*
-g_main_new (gboolean is_running)
+g_main_context_new_loop (GMainContext *context,
+			 gboolean      is_running)
 {
   GMainLoop *loop;
 
+  g_return_val_if_fail (context != NULL, NULL);
+
   loop = g_new0 (GMainLoop, 1);
+  loop->context = context;
   loop->is_running = is_running != FALSE;
 
   return loop;
 }
 
+GMainLoop*
+g_main_new (gboolean is_running)
+{
+  return g_main_context_new_loop (g_main_context_current (), is_running);
+}
+
 void 
 g_main_run (GMainLoop *loop)
 {
+  GMainContext *context;
+  GMainContext *old_context;
+
   g_return_if_fail (loop != NULL);
 
-  if (in_check_or_prepare)
+  context = loop->context;
+  if (context->in_check_or_prepare)
     {
       g_warning ("g_main_run(): called recursively from within a source's check() or "
 		 "prepare() member or from a second thread, iteration not possible");
       return;
     }
   
+  old_context = g_main_context_push (context);
   loop->is_running = TRUE;
   while (loop->is_running)
-    g_main_iterate (TRUE, TRUE);
+    g_main_iterate (context, TRUE, TRUE);
+  g_main_context_pop (old_context);
 }
 
 void 
@@ -940,7 +2418,13 @@ g_main_quit (GMainLoop *loop)
 {
   g_return_if_fail (loop != NULL);
 
+  LOCK_CONTEXT (loop->context);
   loop->is_running = FALSE;
+#ifdef G_THREADS_ENABLED
+  /* the loop may be run by another thread */
+  g_main_wakeup (loop->context);
+#endif
+  UNLOCK_CONTEXT (loop->context);
 }
 
 void 
@@ -961,9 +2445,10 @@ g_main_is_running (GMainLoop *loop)
 
 /* HOLDS: main_loop_lock */
 static void
-g_main_poll (gint     timeout,
-	     gboolean use_priority,
-	     gint     priority)
+g_main_poll (GMainContext *context,
+	     gint          timeout,
+	     gboolean      use_priority,
+	     gint          priority)
 {
 #ifdef  G_MAIN_POLL_DEBUG
   GTimer *poll_timer;
@@ -975,30 +2460,46 @@ g_main_poll (gint     timeout,
 
 #ifdef G_THREADS_ENABLED
 #ifndef NATIVE_WIN32
-  if (wake_up_pipe[0] < 0)
+  if (context->wake_up_pipe[0] < 0)
     {
-      if (pipe (wake_up_pipe) < 0)
+#ifdef G_MAIN_HAVE_EVENTFD
+#ifdef EFD_CLOEXEC
+      context->wake_up_pipe[0] = eventfd (0, EFD_CLOEXEC);
+#else
+      context->wake_up_pipe[0] = eventfd (0, 0);
+#endif
+      context->wake_up_pipe[1] = context->wake_up_pipe[0];
+      if (context->wake_up_pipe[0] < 0)
+#endif
+      if (pipe (context->wake_up_pipe) < 0)
 	g_error ("Cannot create pipe main loop wake-up: %s\n",
 		 g_strerror (errno));
 
-      wake_up_rec.fd = wake_up_pipe[0];
-      wake_up_rec.events = G_IO_IN;
-      g_main_add_poll_unlocked (0, &wake_up_rec);
+      context->wake_up_rec.fd = context->wake_up_pipe[0];
+      context->wake_up_rec.events = G_IO_IN;
+      g_main_add_poll_unlocked (context, 0, &context->wake_up_rec, NULL);
     }
 #else
-  if (wake_up_semaphore == NULL)
+  if (context->wake_up_semaphore == NULL)
     {
-      if ((wake_up_semaphore = CreateSemaphore (NULL, 0, 100, NULL)) == NULL)
+      if ((context->wake_up_semaphore = CreateSemaphore (NULL, 0, 100, NULL)) == NULL)
 	g_error ("Cannot create wake-up semaphore: %d", GetLastError ());
-      wake_up_rec.fd = (gint) wake_up_semaphore;
-      wake_up_rec.events = G_IO_IN;
-      g_main_add_poll_unlocked (0, &wake_up_rec);
+      context->wake_up_rec.fd = (gint) context->wake_up_semaphore;
+      context->wake_up_rec.events = G_IO_IN;
+      g_main_add_poll_unlocked (context, 0, &context->wake_up_rec, NULL);
     }
 #endif
 #endif
-  fd_array = g_new (GPollFD, n_poll_records);
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  if (context->poll_kernel_fd >= 0)
+    {
+      g_main_poll_kernel (context, timeout, use_priority, priority);
+      return;
+    }
+#endif
+  fd_array = g_new (GPollFD, context->n_poll_records);
  
-  pollrec = poll_records;
+  pollrec = context->poll_records;
   i = 0;
   while (pollrec && (!use_priority || priority >= pollrec->priority))
     {
@@ -1018,8 +2519,9 @@ g_main_poll (gint     timeout,
       pollrec = pollrec->next;
     }
 #ifdef G_THREADS_ENABLED
-  poll_waiting = TRUE;
-  poll_changed = FALSE;
+  context->poll_waiting = TRUE;
+  context->poll_blocking = timeout != 0;
+  context->poll_changed = FALSE;
 #endif
   
   npoll = i;
@@ -1030,9 +2532,9 @@ g_main_poll (gint     timeout,
       poll_timer = g_timer_new ();
 #endif
       
-      G_UNLOCK (main_loop);
-      (*poll_func) (fd_array, npoll, timeout);
-      G_LOCK (main_loop);
+      UNLOCK_CONTEXT (context);
+      (*context->poll_func) (fd_array, npoll, timeout);
+      LOCK_CONTEXT (context);
       
 #ifdef	G_MAIN_POLL_DEBUG
       g_print ("g_main_poll(%d) timeout: %d - elapsed %12.10f seconds",
@@ -1040,7 +2542,7 @@ g_main_poll (gint     timeout,
 	       timeout,
 	       g_timer_elapsed (poll_timer, NULL));
       g_timer_destroy (poll_timer);
-      pollrec = poll_records;
+      pollrec = context->poll_records;
       i = 0;
       while (i < npoll)
 	{
@@ -1072,33 +2574,27 @@ g_main_poll (gint     timeout,
     } /* if (npoll || timeout != 0) */
   
 #ifdef G_THREADS_ENABLED
-  if (!poll_waiting)
-    {
-#ifndef NATIVE_WIN32
-      gchar c;
-      read (wake_up_pipe[0], &c, 1);
-#endif
-    }
-  else
-    poll_waiting = FALSE;
+  g_main_wakeup_clear (context);
 
   /* If the set of poll file descriptors changed, bail out
    * and let the main loop rerun
    */
-  if (poll_changed)
+  if (context->poll_changed)
     {
       g_free (fd_array);
       return;
     }
 #endif
 
-  pollrec = poll_records;
+  pollrec = context->poll_records;
   i = 0;
   while (i < npoll)
     {
       if (pollrec->fd->events)
 	{
 	  pollrec->fd->revents = fd_array[i].revents;
+	  if (pollrec->source && (pollrec->fd->revents & pollrec->fd->events))
+	    g_source_queue_ready (pollrec->source);
 	  i++;
 	}
       pollrec = pollrec->next;
@@ -1111,36 +2607,68 @@ void
 g_main_add_poll (GPollFD *fd,
 		 gint     priority)
 {
-  G_LOCK (main_loop);
-  g_main_add_poll_unlocked (priority, fd);
-  G_UNLOCK (main_loop);
+  GMainContext *context = g_main_context_current ();
+
+  LOCK_CONTEXT (context);
+  g_main_add_poll_unlocked (context, priority, fd, NULL);
+  UNLOCK_CONTEXT (context);
+}
+
+/* the passive source "tag" is made ready whenever fd reports one of
+ * the requested events. fd has to be removed with g_main_remove_poll()
+ * before or while the source is destroyed.
+ */
+void
+g_main_add_poll_for_source (GPollFD *fd,
+			    gint     priority,
+			    guint    tag)
+{
+  GMainContext *context;
+  GHook *hook;
+
+  g_return_if_fail (fd != NULL);
+  g_return_if_fail (tag > 0);
+
+  context = g_main_context_current ();
+  LOCK_CONTEXT (context);
+
+  hook = g_hook_get (&context->passive_list, tag);
+  if (hook)
+    g_main_add_poll_unlocked (context, priority, fd, (GSource*) hook);
+  else
+    g_warning ("g_main_add_poll_for_source(): no passive source with id %u", tag);
+
+  UNLOCK_CONTEXT (context);
 }
 
 /* HOLDS: main_loop_lock */
 static void 
-g_main_add_poll_unlocked (gint     priority,
-			  GPollFD *fd)
+g_main_add_poll_unlocked (GMainContext *context,
+			  gint          priority,
+			  GPollFD      *fd,
+			  GSource      *source)
 {
   GPollRec *lastrec, *pollrec, *newrec;
 
-  if (!poll_chunk)
-    poll_chunk = g_mem_chunk_create (GPollRec, 32, G_ALLOC_ONLY);
+  if (!context->poll_chunk)
+    context->poll_chunk = g_mem_chunk_create (GPollRec, 32, G_ALLOC_ONLY);
 
-  if (poll_free_list)
+  if (context->poll_free_list)
     {
-      newrec = poll_free_list;
-      poll_free_list = newrec->next;
+      newrec = context->poll_free_list;
+      context->poll_free_list = newrec->next;
     }
   else
-    newrec = g_chunk_new (GPollRec, poll_chunk);
+    newrec = g_chunk_new (GPollRec, context->poll_chunk);
 
   /* This file descriptor may be checked before we ever poll */
   fd->revents = 0;
   newrec->fd = fd;
   newrec->priority = priority;
+  newrec->source = source;
 
   lastrec = NULL;
-  pollrec = poll_records;
+  pollrec = context->poll_records;
   while (pollrec && priority >= pollrec->priority)
     {
       lastrec = pollrec;
@@ -1150,29 +2678,35 @@ g_main_add_poll_unlocked (gint     priority,
   if (lastrec)
     lastrec->next = newrec;
   else
-    poll_records = newrec;
+    context->poll_records = newrec;
 
   newrec->next = pollrec;
 
-  n_poll_records++;
+  context->n_poll_records++;
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  if (context->poll_kernel_fd >= 0)
+    g_main_kernel_add (context, newrec);
+#endif
 
 #ifdef G_THREADS_ENABLED
-  poll_changed = TRUE;
+  context->poll_changed = TRUE;
 
   /* Now wake up the main loop if it is waiting in the poll() */
-  g_main_wakeup ();
+  g_main_wakeup (context);
 #endif
 }
 
 void 
 g_main_remove_poll (GPollFD *fd)
 {
+  GMainContext *context = g_main_context_current ();
   GPollRec *pollrec, *lastrec;
 
-  G_LOCK (main_loop);
+  LOCK_CONTEXT (context);
   
   lastrec = NULL;
-  pollrec = poll_records;
+  pollrec = context->poll_records;
 
   while (pollrec)
     {
@@ -1181,12 +2715,17 @@ g_main_remove_poll (GPollFD *fd)
 	  if (lastrec != NULL)
 	    lastrec->next = pollrec->next;
 	  else
-	    poll_records = pollrec->next;
+	    context->poll_records = pollrec->next;
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+	  if (context->poll_kernel_fd >= 0)
+	    g_main_kernel_remove (context, pollrec);
+#endif
 
-	  pollrec->next = poll_free_list;
-	  poll_free_list = pollrec;
+	  pollrec->next = context->poll_free_list;
+	  context->poll_free_list = pollrec;
 
-	  n_poll_records--;
+	  context->n_poll_records--;
 	  break;
 	}
       lastrec = pollrec;
@@ -1194,47 +2733,271 @@ g_main_remove_poll (GPollFD *fd)
     }
 
 #ifdef G_THREADS_ENABLED
-  poll_changed = TRUE;
+  context->poll_changed = TRUE;
   
   /* Now wake up the main loop if it is waiting in the poll() */
-  g_main_wakeup ();
+  g_main_wakeup (context);
 #endif
 
-  G_UNLOCK (main_loop);
+  UNLOCK_CONTEXT (context);
 }
 
 void 
 g_main_set_poll_func (GPollFunc func)
 {
+  GMainContext *context = g_main_context_current ();
+
+  /* a custom poll function needs the GPollFD arrays */
   if (func)
-    poll_func = func;
+    g_main_context_set_poll_backend (context, G_MAIN_POLL_DEFAULT);
+
+  if (func)
+    context->poll_func = func;
   else
-#ifdef HAVE_POLL
-    poll_func = (GPollFunc) poll;
+    context->poll_func = default_poll_func;
+}
+
+gboolean
+g_main_context_set_poll_backend (GMainContext     *context,
+				 GMainPollBackend  backend)
+{
+  gboolean retval = TRUE;
+
+  g_return_val_if_fail (context != NULL, FALSE);
+
+  LOCK_CONTEXT (context);
+
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  if (backend == G_MAIN_POLL_KERNEL)
+#  ifdef G_MAIN_HAVE_EPOLL
+    backend = G_MAIN_POLL_EPOLL;
+#  else
+    backend = G_MAIN_POLL_KQUEUE;
+#  endif
+
+  if (backend != context->poll_backend)
+    {
+      g_main_kernel_close (context);
+      context->poll_backend = G_MAIN_POLL_DEFAULT;
+
+#  ifdef G_MAIN_HAVE_EPOLL
+      if (backend == G_MAIN_POLL_EPOLL)
+#  else
+      if (backend == G_MAIN_POLL_KQUEUE)
+#  endif
+	retval = g_main_kernel_open (context);
+      else
+	retval = backend == G_MAIN_POLL_DEFAULT;
+
+      if (retval)
+	context->poll_backend = backend;
+
+#  ifdef G_THREADS_ENABLED
+      context->poll_changed = TRUE;
+      g_main_wakeup (context);
+#  endif
+    }
+#else /* !G_MAIN_HAVE_KERNEL_POLL */
+  retval = backend == G_MAIN_POLL_DEFAULT;
+#endif /* !G_MAIN_HAVE_KERNEL_POLL */
+
+  UNLOCK_CONTEXT (context);
+
+  return retval;
+}
+
+gboolean
+g_main_set_poll_backend (GMainPollBackend backend)
+{
+  return g_main_context_set_poll_backend (g_main_context_current (), backend);
+}
+
+GMainPollBackend
+g_main_get_poll_backend (void)
+{
+#ifdef G_MAIN_HAVE_KERNEL_POLL
+  return g_main_context_current ()->poll_backend;
 #else
-    poll_func = (GPollFunc) g_poll;
+  return G_MAIN_POLL_DEFAULT;
 #endif
 }
 
 /* Wake the main loop up from a poll() */
 static void
-g_main_wakeup (void)
+g_main_wakeup (GMainContext *context)
 {
 #ifdef G_THREADS_ENABLED
-  if (poll_waiting)
+  /* a poll with a timeout of 0 returns by itself, and there is
+   * nothing to do if a wakeup is already pending
+   */
+  if (context->poll_waiting)
     {
-      poll_waiting = FALSE;
+      context->poll_waiting = FALSE;
+      if (context->poll_blocking && !context->wake_up_pending)
+	{
+	  context->wake_up_pending = TRUE;
 #ifndef NATIVE_WIN32
-      write (wake_up_pipe[1], "A", 1);
+#ifdef G_MAIN_HAVE_EVENTFD
+	  if (context->wake_up_pipe[1] == context->wake_up_pipe[0])
+	    eventfd_write (context->wake_up_pipe[1], 1);
+	  else
+#endif
+	  write (context->wake_up_pipe[1], "A", 1);
 #else
-      ReleaseSemaphore (wake_up_semaphore, 1, NULL);
+	  ReleaseSemaphore (context->wake_up_semaphore, 1, NULL);
+#endif
+	}
+    }
+#endif
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_main_wakeup_clear (GMainContext *context)
+{
+#ifdef G_THREADS_ENABLED
+  context->poll_waiting = FALSE;
+  context->poll_blocking = FALSE;
+
+  if (context->wake_up_pending)
+    {
+#ifndef NATIVE_WIN32
+#ifdef G_MAIN_HAVE_EVENTFD
+      eventfd_t value;
+
+      if (context->wake_up_pipe[1] == context->wake_up_pipe[0])
+	eventfd_read (context->wake_up_pipe[0], &value);
+      else
+#endif
+	{
+	  gchar c;
+
+	  read (context->wake_up_pipe[0], &c, 1);
+	}
 #endif
+      context->wake_up_pending = FALSE;
     }
 #endif
 }
 
 /* Timeouts */
 
+#define G_TIMEVAL_BEFORE(a, b)					\
+  ((a)->tv_sec < (b)->tv_sec ||					\
+   ((a)->tv_sec == (b)->tv_sec && (a)->tv_usec < (b)->tv_usec))
+
+/* HOLDS: main_loop_lock */
+static void
+g_timer_heap_sift_up (GMainContext *context,
+		      guint         i)
+{
+  GTimeoutData *data = context->timer_heap[i];
+
+  while (i > 0)
+    {
+      guint parent = (i - 1) / 2;
+
+      if (!G_TIMEVAL_BEFORE (&data->expiration, &context->timer_heap[parent]->expiration))
+	break;
+      context->timer_heap[i] = context->timer_heap[parent];
+      context->timer_heap[i]->heap_index = i;
+      i = parent;
+    }
+  context->timer_heap[i] = data;
+  data->heap_index = i;
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_timer_heap_sift_down (GMainContext *context,
+			guint         i)
+{
+  GTimeoutData *data = context->timer_heap[i];
+
+  while (2 * i + 1 < context->n_timers)
+    {
+      guint child = 2 * i + 1;
+
+      if (child + 1 < context->n_timers &&
+	  G_TIMEVAL_BEFORE (&context->timer_heap[child + 1]->expiration,
+			    &context->timer_heap[child]->expiration))
+	child++;
+      if (!G_TIMEVAL_BEFORE (&context->timer_heap[child]->expiration, &data->expiration))
+	break;
+      context->timer_heap[i] = context->timer_heap[child];
+      context->timer_heap[i]->heap_index = i;
+      i = child;
+    }
+  context->timer_heap[i] = data;
+  data->heap_index = i;
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_timer_heap_insert (GTimeoutData *data)
+{
+  GMainContext *context = data->source->context;
+
+  if (context->n_timers == context->timer_heap_size)
+    {
+      context->timer_heap_size = MAX (16, 2 * context->timer_heap_size);
+      context->timer_heap = g_renew (GTimeoutData*, context->timer_heap, context->timer_heap_size);
+    }
+  context->timer_heap[context->n_timers] = data;
+  g_timer_heap_sift_up (context, context->n_timers++);
+}
+
+/* HOLDS: main_loop_lock */
+static void
+g_timer_heap_remove (GTimeoutData *data)
+{
+  GMainContext *context = data->source->context;
+  guint i = data->heap_index;
+
+  if (i == TIMER_NOT_QUEUED)
+    return;
+
+  data->heap_index = TIMER_NOT_QUEUED;
+  if (i == --context->n_timers)
+    return;
+
+  context->timer_heap[i] = context->timer_heap[context->n_timers];
+  g_timer_heap_sift_down (context, i);
+  g_timer_heap_sift_up (context, context->timer_heap[i]->heap_index);
+}
+
+/* flags the timeouts that expired by the loop time ready and returns
+ * the number of milliseconds until the next one expires, or -1 if
+ * there is none. Expirations are in monotonic time, so they can't be
+ * thrown off by changes of the system time.
+ * HOLDS: main_loop_lock
+ */
+static gint
+g_timer_heap_expire (GMainContext *context)
+{
+  GTimeVal *current_time = &context->loop_time;
+
+  while (context->n_timers > 0)
+    {
+      GTimeoutData *data = context->timer_heap[0];
+      glong msec;
+
+      if (G_TIMEVAL_BEFORE (current_time, &data->expiration))
+	{
+	  /* round up, so we don't wake up just before the expiration */
+	  msec = (data->expiration.tv_sec  - current_time->tv_sec) * 1000 +
+		 (data->expiration.tv_usec - current_time->tv_usec + 999) / 1000;
+
+	  return MAX (msec, 0);
+	}
+
+      g_timer_heap_remove (data);
+      g_source_queue_ready (data->source);
+    }
+
+  return -1;
+}
+
 static void
 g_timeout_set_expiration (GTimeoutData *data,
 			  GTimeVal     *current_time)
@@ -1249,8 +3012,33 @@ g_timeout_set_expiration (GTimeoutData *data,
       data->expiration.tv_usec -= 1000000;
       data->expiration.tv_sec++;
     }
+
+  /* round coarse timeouts up to the next multiple of their
+   * granularity, so that they expire together
+   */
+  if (data->granularity >= 1000)
+    {
+      seconds = data->granularity / 1000;
+      if (data->expiration.tv_usec > 0 || data->expiration.tv_sec % seconds)
+	data->expiration.tv_sec = (data->expiration.tv_sec / seconds + 1) * seconds;
+      data->expiration.tv_usec = 0;
+    }
+  else if (data->granularity > 0)
+    {
+      glong usecs = data->granularity * 1000;
+
+      data->expiration.tv_usec = (data->expiration.tv_usec + usecs - 1) / usecs * usecs;
+      if (data->expiration.tv_usec >= 1000000)
+	{
+	  data->expiration.tv_usec -= 1000000;
+	  data->expiration.tv_sec++;
+	}
+    }
 }
 
+/* The GTimeVal passed to the timeout functions is the system time,
+ * expirations are in the monotonic time of the main context.
+ */
 static gboolean 
 g_timeout_prepare  (gpointer  source_data, 
 		    GTimeVal *current_time,
@@ -1259,21 +3047,13 @@ g_timeout_prepare  (gpointer  source_data,
 {
   glong msec;
   GTimeoutData *data = source_data;
+  GTimeVal *loop_time = &data->source->context->loop_time;
 
-  msec = (data->expiration.tv_sec  - current_time->tv_sec) * 1000 +
-         (data->expiration.tv_usec - current_time->tv_usec) / 1000;
+  msec = (data->expiration.tv_sec  - loop_time->tv_sec) * 1000 +
+         (data->expiration.tv_usec - loop_time->tv_usec) / 1000;
 
   if (msec < 0)
     msec = 0;
-  else if (msec > data->interval)
-    {
-      /* The system time has been set backwards, so we 
-       * reset the expiration time to now + data->interval;
-       * this at least avoids hanging for long periods of time.
-       */
-      g_timeout_set_expiration (data, current_time);
-      msec = data->interval;
-    }
 
   *timeout = msec;
 
@@ -1287,9 +3067,7 @@ g_timeout_check (gpointer  source_data,
 {
   GTimeoutData *data = source_data;
 
-  return (data->expiration.tv_sec < current_time->tv_sec) ||
-         ((data->expiration.tv_sec == current_time->tv_sec) &&
-	  (data->expiration.tv_usec <= current_time->tv_usec));
+  return !G_TIMEVAL_BEFORE (&data->source->context->loop_time, &data->expiration);
 }
 
 static gboolean
@@ -1301,30 +3079,81 @@ g_timeout_dispatch (gpointer source_data,
 
   if (data->callback (user_data))
     {
-      g_timeout_set_expiration (data, dispatch_time);
+      g_timeout_set_expiration (data, &data->source->context->loop_time);
       return TRUE;
     }
   else
     return FALSE;
 }
 
+/* Coarse timeouts expire on multiples of their granularity (in
+ * milliseconds), which must divide 1000 or be a multiple of it.
+ * Timeouts with the same granularity that expire in the same interval
+ * are dispatched in a single wakeup.
+ */
 guint 
-g_timeout_add_full (gint           priority,
-		    guint          interval, 
-		    GSourceFunc    function,
-		    gpointer       data,
-		    GDestroyNotify notify)
+g_main_context_add_coarse_timeout (GMainContext  *context,
+				   gint           priority,
+				   guint          interval, 
+				   guint          granularity,
+				   GSourceFunc    function,
+				   gpointer       data,
+				   GDestroyNotify notify)
 {
-  GTimeoutData *timeout_data = g_new (GTimeoutData, 1);
+  GTimeoutData *timeout_data;
   GTimeVal current_time;
+  guint return_val;
+
+  g_return_val_if_fail (context != NULL, 0);
+  g_return_val_if_fail (granularity == 0 ||
+			1000 % granularity == 0 ||
+			granularity % 1000 == 0, 0);
+
+  timeout_data = g_new (GTimeoutData, 1);
 
   timeout_data->interval = interval;
+  timeout_data->granularity = granularity;
   timeout_data->callback = function;
-  g_get_current_time (&current_time);
+  timeout_data->heap_index = TIMER_NOT_QUEUED;
+  g_get_monotonic_time (&current_time);
 
   g_timeout_set_expiration (timeout_data, &current_time);
 
-  return g_source_add (priority, FALSE, &timeout_funcs, timeout_data, data, notify);
+  LOCK_CONTEXT (context);
+
+  timeout_data->source = g_source_add_unlocked (context, priority, FALSE, TRUE,
+						&timeout_funcs, timeout_data,
+						data, notify);
+  timeout_data->source->hook.flags |= G_SOURCE_TIMER;
+  g_timer_heap_insert (timeout_data);
+  return_val = timeout_data->source->hook.hook_id;
+
+  UNLOCK_CONTEXT (context);
+
+  return return_val;
+}
+
+guint 
+g_main_context_add_timeout (GMainContext  *context,
+			    gint           priority,
+			    guint          interval, 
+			    GSourceFunc    function,
+			    gpointer       data,
+			    GDestroyNotify notify)
+{
+  return g_main_context_add_coarse_timeout (context, priority, interval, 0,
+					    function, data, notify);
+}
+
+guint 
+g_timeout_add_full (gint           priority,
+		    guint          interval, 
+		    GSourceFunc    function,
+		    gpointer       data,
+		    GDestroyNotify notify)
+{
+  return g_main_context_add_timeout (g_main_context_current (), priority,
+				     interval, function, data, notify);
 }
 
 guint 
@@ -1336,6 +3165,42 @@ g_timeout_add (guint32        interval,
 			     interval, function, data, NULL);
 }
 
+guint 
+g_timeout_add_coarse_full (gint           priority,
+			   guint          interval, 
+			   guint          granularity,
+			   GSourceFunc    function,
+			   gpointer       data,
+			   GDestroyNotify notify)
+{
+  return g_main_context_add_coarse_timeout (g_main_context_current (), priority,
+					    interval, granularity,
+					    function, data, notify);
+}
+
+/* timeouts with an interval in seconds, expiring on whole seconds */
+guint 
+g_timeout_add_seconds_full (gint           priority,
+			    guint          interval, 
+			    GSourceFunc    function,
+			    gpointer       data,
+			    GDestroyNotify notify)
+{
+  g_return_val_if_fail (interval <= G_MAXINT / 1000, 0);
+
+  return g_timeout_add_coarse_full (priority, interval * 1000, 1000,
+				    function, data, notify);
+}
+
+guint 
+g_timeout_add_seconds (guint          interval,
+		       GSourceFunc    function,
+		       gpointer       data)
+{
+  return g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, 
+				     interval, function, data, NULL);
+}
+
 /* Idle functions */
 
 static gboolean 
@@ -1367,6 +3232,19 @@ g_idle_dispatch (gpointer source_data,
   return func (user_data);
 }
 
+guint 
+g_main_context_add_idle (GMainContext  *context,
+			 gint           priority,
+			 GSourceFunc    function,
+			 gpointer       data,
+			 GDestroyNotify notify)
+{
+  g_return_val_if_fail (function != NULL, 0);
+
+  return g_main_context_add_source (context, priority, FALSE, &idle_funcs,
+				    (gpointer) function, data, notify);
+}
+
 guint 
 g_idle_add_full (gint           priority,
 		 GSourceFunc    function,
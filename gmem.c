@@ -79,10 +79,34 @@
 #define MEM_ALIGN     SIZEOF_LONG
 #endif
 
+/* the areas of G_ALLOC_AND_FREE_SLAB chunks are aligned to their size,
+ * which is a power of two, so masking an atom's address yields its area
+ */
+#define MEM_AREA_HEADER_SIZE          (sizeof (GMemArea) - MEM_AREA_SIZE)
+#define MEM_SLAB_SIZE(rmem_chunk)     (MEM_AREA_HEADER_SIZE + (rmem_chunk)->area_size)
+#define MEM_SLAB_AREA(rmem_chunk, mem) \
+  ((GMemArea*) ((gulong) (mem) & ~(MEM_SLAB_SIZE (rmem_chunk) - 1)))
+
+/* arenas use blocks of this size unless told otherwise, the memory of
+ *  a block starts at the first aligned address after its header
+ */
+#define ARENA_DEFAULT_BLOCK_SIZE 4096
+#define ARENA_ALIGN(size)        (((size) + MEM_ALIGN - 1) & ~(gulong) (MEM_ALIGN - 1))
+#define ARENA_BLOCK_MEM(block)   ((gchar*) (block) + ARENA_ALIGN (sizeof (GArenaBlock)))
+
+/* G_ALLOC_AND_FREE_MT thread caches move atoms from and to the chunk
+ *  in batches of this many atoms
+ */
+#define MEM_CHUNK_MT_BATCH 32
+
 
 typedef struct _GFreeAtom      GFreeAtom;
 typedef struct _GMemArea       GMemArea;
 typedef struct _GRealMemChunk  GRealMemChunk;
+typedef struct _GMemChunkCache GMemChunkCache;
+typedef struct _GArenaBlock    GArenaBlock;
+typedef struct _GMemSite       GMemSite;
+typedef struct _GMemSample     GMemSample;
 
 struct _GFreeAtom
 {
@@ -97,6 +121,10 @@ struct _GMemArea
   gulong free;               /* the number of free bytes in this mem area */
   gulong allocated;          /* the number of atoms allocated from this area */
   gulong mark;               /* is this mem area marked for deletion */
+  GFreeAtom *free_atoms;     /* the free atoms of a slab area */
+#ifndef HAVE_POSIX_MEMALIGN
+  gpointer block;            /* the allocated block a slab area got aligned in */
+#endif
   gchar mem[MEM_AREA_SIZE];  /* the mem array from which atoms get allocated
 			      * the actual size of this array is determined by
 			      *  the mem chunk "area_size". ANSI says that it
@@ -116,11 +144,70 @@ struct _GRealMemChunk
   gulong area_size;          /* the size of a memory area */
   GMemArea *mem_area;        /* the current memory area */
   GMemArea *mem_areas;       /* a list of all the mem areas owned by this chunk */
-  GMemArea *free_mem_area;   /* the free area...which is about to be destroyed */
+  GMemArea *free_mem_area;   /* the free area...which is about to be destroyed,
+			      *  or the one empty slab area kept around */
   GFreeAtom *free_atoms;     /* the free atoms list */
+  GMemArea *full_mem_areas;  /* the slab areas without a free atom */
   GTree *mem_tree;           /* tree of mem areas sorted by memory address */
   GRealMemChunk *next;       /* pointer to the next chunk */
   GRealMemChunk *prev;       /* pointer to the previous chunk */
+
+  /* G_ALLOC_AND_FREE_MT */
+  GFreeAtom *remote_atoms;   /* atoms handed back by the thread caches */
+  GStaticPrivate cache_key;  /* the calling thread's GMemChunkCache */
+  GMemChunkCache *caches;    /* all thread caches of this chunk */
+  guint generation;          /* bumped by g_mem_chunk_reset() */
+};
+
+struct _GArenaBlock
+{
+  GArenaBlock *next;         /* the previously allocated block */
+  gulong size;               /* the size of the block's memory */
+};
+
+struct _GArena
+{
+  gulong block_size;         /* the memory size of regular blocks */
+  GArenaBlock *blocks;       /* the blocks in use, the current one first */
+  GArenaBlock *free_blocks;  /* regular blocks kept by g_arena_reset() */
+  gchar *pos;                /* the free memory of the current block */
+  gchar *end;
+};
+
+/* the sampling profiler keeps a row per allocation site and size
+ *  class, and a record for every sampled block that is still alive
+ */
+struct _GMemSite
+{
+  gint kind;                 /* MEM_SITE_MALLOC or MEM_SITE_CHUNK */
+  gconstpointer site;        /* the caller of g_malloc() or the chunk, NULL
+			      *  once that chunk is destroyed */
+  gchar *name;               /* the name of a chunk */
+  guint size_class;          /* blocks of up to 1 << size_class bytes */
+  gulong n_samples;
+  gulong allocated;          /* estimated number of bytes allocated */
+  gulong live;               /* estimated number of bytes in use */
+};
+
+struct _GMemSample
+{
+  gpointer mem;
+  gulong weight;             /* the number of bytes this sample stands for */
+  guint site;                /* index into mem_sites */
+};
+
+/* the per thread atom cache of a G_ALLOC_AND_FREE_MT chunk, only
+ *  its owning thread touches the free atoms. "chunk" is reset to NULL
+ *  once the chunk is destroyed, "chunk" and "next" are protected by
+ *  mem_chunks_mt_lock.
+ */
+struct _GMemChunkCache
+{
+  GRealMemChunk *chunk;
+  GFreeAtom *free_atoms;
+  guint n_free_atoms;
+  guint generation;
+  GMemChunkCache *next;
 };
 
 
@@ -130,12 +217,67 @@ static gint   g_mem_chunk_area_compare (GMemArea *a,
 					GMemArea *b);
 static gint   g_mem_chunk_area_search  (GMemArea *a,
 					gchar    *addr);
+static gpointer g_mem_chunk_slab_alloc (GRealMemChunk *rmem_chunk);
+static void   g_mem_chunk_slab_free    (GRealMemChunk *rmem_chunk,
+					gpointer       mem);
+static void   g_mem_area_free          (GRealMemChunk *rmem_chunk,
+					GMemArea      *mem_area);
+static gpointer g_mem_chunk_mt_alloc   (GRealMemChunk *rmem_chunk);
+static void   g_mem_chunk_mt_free      (GRealMemChunk *rmem_chunk,
+					gpointer       mem);
 
 
 /* here we can't use StaticMutexes, as they depend upon a working
  * g_malloc, the same holds true for StaticPrivate */
 static GMutex* mem_chunks_lock = NULL;
 static GRealMemChunk *mem_chunks = NULL;
+/* protects the thread cache lists and the memory areas of
+ *  G_ALLOC_AND_FREE_MT chunks
+ */
+static GMutex* mem_chunks_mt_lock = NULL;
+
+/* the sampling profiler, mem_sample_interval is 0 while it is off.
+ *  the countdown is updated without locking, so concurrent allocations
+ *  can make a sample come a little early or late.
+ */
+#define MEM_SITE_MALLOC 0
+#define MEM_SITE_CHUNK  1
+#define MEM_SITE_NONE   ((guint) -1)
+
+#if defined (__GNUC__)
+#  define MEM_CALLER()  __builtin_return_address (0)
+#else
+#  define MEM_CALLER()  NULL
+#endif
+
+#define MEM_SAMPLE_ALLOC(mem, size, kind, site)				\
+  G_STMT_START {							\
+    if (mem_sample_interval &&						\
+	(mem_sample_countdown -= (glong) (size)) <= 0)			\
+      g_mem_sample_alloc ((mem), (size), (kind), (site));		\
+  } G_STMT_END
+#define MEM_SAMPLE_FREE(mem)						\
+  G_STMT_START {							\
+    if (mem_n_samples)							\
+      g_mem_sample_free (mem);						\
+  } G_STMT_END
+
+static GMutex* mem_sample_lock = NULL;
+static gulong mem_sample_interval = 0;
+static glong mem_sample_countdown = 0;
+static guint32 mem_sample_seed = 1;
+static GMemSite *mem_sites = NULL;
+static guint mem_n_sites = 0;
+static guint mem_sites_alloc = 0;
+static GMemSample *mem_samples = NULL;	/* open addressed by block address */
+static guint mem_samples_size = 0;
+static guint mem_n_samples = 0;
+
+static void g_mem_sample_alloc (gpointer      mem,
+				gulong        size,
+				gint          kind,
+				gconstpointer site);
+static void g_mem_sample_free  (gpointer      mem);
 
 #ifdef ENABLE_MEM_PROFILE
 static GMutex* mem_profile_lock;
@@ -211,6 +353,7 @@ g_malloc (gulong size)
 #endif /* ENABLE_MEM_PROFILE */
 #endif /* ENABLE_MEM_PROFILE || ENABLE_MEM_CHECK */
   
+  MEM_SAMPLE_ALLOC (p, size, MEM_SITE_MALLOC, MEM_CALLER ());
   
   return p;
 }
@@ -276,6 +419,7 @@ g_malloc0 (gulong size)
 #  endif /* ENABLE_MEM_PROFILE */
 #endif /* ENABLE_MEM_PROFILE || ENABLE_MEM_CHECK */
   
+  MEM_SAMPLE_ALLOC (p, size, MEM_SITE_MALLOC, MEM_CALLER ());
   
   return p;
 }
@@ -308,6 +452,9 @@ g_realloc (gpointer mem,
 #endif /* ENABLE_MEM_CHECK */
   
   
+  if (mem)
+    MEM_SAMPLE_FREE (mem);
+  
   if (!mem)
     {
 #ifdef REALLOC_0_WORKS
@@ -374,6 +521,7 @@ g_realloc (gpointer mem,
 #endif /* ENABLE_MEM_PROFILE */
 #endif /* ENABLE_MEM_PROFILE || ENABLE_MEM_CHECK */
   
+  MEM_SAMPLE_ALLOC (p, size, MEM_SITE_MALLOC, MEM_CALLER ());
   
   return p;
 }
@@ -388,6 +536,8 @@ g_free (gpointer mem)
       gulong size;
 #endif /* ENABLE_MEM_PROFILE || ENABLE_MEM_CHECK */
       
+      MEM_SAMPLE_FREE (mem);
+      
 #if defined(ENABLE_MEM_PROFILE) || defined(ENABLE_MEM_CHECK)
       t = (gulong*) ((guchar*) mem - SIZEOF_LONG);
       size = *t;
@@ -416,6 +566,275 @@ g_free (gpointer mem)
 #endif /* ! USE_DMALLOC */
 
 
+static inline guint
+g_mem_sample_hash (gpointer mem)
+{
+  return ((guint) ((gulong) mem >> 3)) * 2654435769U;
+}
+
+/* HOLDS: mem_sample_lock */
+static void
+g_mem_samples_insert (GMemSample *sample)
+{
+  guint i = g_mem_sample_hash (sample->mem) & (mem_samples_size - 1);
+
+  while (mem_samples[i].mem)
+    i = (i + 1) & (mem_samples_size - 1);
+  mem_samples[i] = *sample;
+}
+
+/* rebuilds the sample table with "size" slots, leaving out the samples
+ *  of the chunk "forget_chunk" (if not NULL).
+ * HOLDS: mem_sample_lock
+ */
+static void
+g_mem_samples_resize (guint         size,
+		      gconstpointer forget_chunk)
+{
+  GMemSample *old_samples = mem_samples;
+  guint old_size = mem_samples_size;
+  GMemSample *new_samples;
+  guint i;
+
+  new_samples = calloc (size, sizeof (GMemSample));
+  if (!new_samples)
+    return;
+
+  mem_samples = new_samples;
+  mem_samples_size = size;
+  mem_n_samples = 0;
+  for (i = 0; i < old_size; i++)
+    if (old_samples[i].mem)
+      {
+	GMemSite *site = &mem_sites[old_samples[i].site];
+
+	if (forget_chunk && site->kind == MEM_SITE_CHUNK && site->site == forget_chunk)
+	  site->live -= old_samples[i].weight;
+	else
+	  {
+	    g_mem_samples_insert (&old_samples[i]);
+	    mem_n_samples++;
+	  }
+      }
+  free (old_samples);
+}
+
+/* HOLDS: mem_sample_lock */
+static guint
+g_mem_site_lookup (gint          kind,
+		   gconstpointer site,
+		   guint         size_class)
+{
+  GMemSite *new_site;
+  guint i;
+
+  for (i = 0; i < mem_n_sites; i++)
+    if (mem_sites[i].site == site &&
+	mem_sites[i].kind == kind &&
+	mem_sites[i].size_class == size_class)
+      return i;
+
+  if (mem_n_sites == mem_sites_alloc)
+    {
+      guint n = MAX (64, 2 * mem_sites_alloc);
+      GMemSite *sites = realloc (mem_sites, n * sizeof (GMemSite));
+
+      if (!sites)
+	return MEM_SITE_NONE;
+      mem_sites = sites;
+      mem_sites_alloc = n;
+    }
+
+  new_site = &mem_sites[mem_n_sites];
+  new_site->kind = kind;
+  new_site->site = site;
+  new_site->name = NULL;
+  if (kind == MEM_SITE_CHUNK && ((GRealMemChunk*) site)->name)
+    {
+      gchar *name = ((GRealMemChunk*) site)->name;
+
+      new_site->name = malloc (strlen (name) + 1);
+      if (new_site->name)
+	strcpy (new_site->name, name);
+    }
+  new_site->size_class = size_class;
+  new_site->n_samples = 0;
+  new_site->allocated = 0;
+  new_site->live = 0;
+
+  return mem_n_sites++;
+}
+
+/* records a sampled allocation. the tables are allocated with malloc(),
+ *  so sampling never recurses into g_malloc().
+ */
+static void
+g_mem_sample_alloc (gpointer      mem,
+		    gulong        size,
+		    gint          kind,
+		    gconstpointer site)
+{
+  GMemSample sample;
+  guint size_class = 0;
+
+  g_mutex_lock (mem_sample_lock);
+
+  /* the distance to the next sample is randomized around the
+   *  interval, so periodic allocation patterns don't skew it
+   */
+  mem_sample_seed = mem_sample_seed * 1103515245 + 12345;
+  mem_sample_countdown = mem_sample_interval / 2 +
+    (mem_sample_seed >> 8) % (mem_sample_interval + 1);
+
+  while (size_class < SIZEOF_LONG * 8 - 1 && (1UL << size_class) < size)
+    size_class++;
+
+  sample.mem = mem;
+  sample.weight = MAX (size, mem_sample_interval);
+  sample.site = g_mem_site_lookup (kind, site, size_class);
+  if (sample.site == MEM_SITE_NONE)
+    {
+      g_mutex_unlock (mem_sample_lock);
+      return;
+    }
+
+  mem_sites[sample.site].n_samples += 1;
+  mem_sites[sample.site].allocated += sample.weight;
+  mem_sites[sample.site].live += sample.weight;
+
+  if (2 * (mem_n_samples + 1) > mem_samples_size)
+    g_mem_samples_resize (MAX (64, 2 * mem_samples_size), NULL);
+  if (2 * (mem_n_samples + 1) <= mem_samples_size)
+    {
+      g_mem_samples_insert (&sample);
+      mem_n_samples++;
+    }
+  else
+    mem_sites[sample.site].live -= sample.weight;
+
+  g_mutex_unlock (mem_sample_lock);
+}
+
+static void
+g_mem_sample_free (gpointer mem)
+{
+  guint i, j, k;
+
+  g_mutex_lock (mem_sample_lock);
+
+  if (!mem_n_samples)
+    {
+      g_mutex_unlock (mem_sample_lock);
+      return;
+    }
+
+  i = g_mem_sample_hash (mem) & (mem_samples_size - 1);
+  while (mem_samples[i].mem && mem_samples[i].mem != mem)
+    i = (i + 1) & (mem_samples_size - 1);
+
+  if (mem_samples[i].mem)
+    {
+      mem_sites[mem_samples[i].site].live -= mem_samples[i].weight;
+      mem_n_samples--;
+
+      /* shift the following samples of the probe sequence back, so
+       *  no tombstones are needed
+       */
+      for (j = (i + 1) & (mem_samples_size - 1);
+	   mem_samples[j].mem;
+	   j = (j + 1) & (mem_samples_size - 1))
+	{
+	  k = g_mem_sample_hash (mem_samples[j].mem) & (mem_samples_size - 1);
+	  if ((j > i && (k <= i || k > j)) ||
+	      (j < i && (k <= i && k > j)))
+	    {
+	      mem_samples[i] = mem_samples[j];
+	      i = j;
+	    }
+	}
+      mem_samples[i].mem = NULL;
+    }
+
+  g_mutex_unlock (mem_sample_lock);
+}
+
+/* drops the samples of a chunk that gets reset or destroyed */
+static void
+g_mem_sample_forget_chunk (GRealMemChunk *rmem_chunk,
+			   gboolean       destroyed)
+{
+  guint i;
+
+  g_mutex_lock (mem_sample_lock);
+  if (mem_n_samples)
+    g_mem_samples_resize (mem_samples_size, rmem_chunk);
+  if (destroyed)
+    for (i = 0; i < mem_n_sites; i++)
+      if (mem_sites[i].kind == MEM_SITE_CHUNK && mem_sites[i].site == rmem_chunk)
+	mem_sites[i].site = NULL;
+  g_mutex_unlock (mem_sample_lock);
+}
+
+/* turns the sampling profiler on, taking a sample about every
+ *  "n_bytes" allocated bytes, or off again if "n_bytes" is 0. the
+ *  samples are reported by g_mem_profile().
+ */
+void
+g_mem_profile_set_sample_interval (gulong n_bytes)
+{
+  g_mutex_lock (mem_sample_lock);
+  mem_sample_countdown = n_bytes;
+  mem_sample_interval = n_bytes;
+  g_mutex_unlock (mem_sample_lock);
+}
+
+/* logs a line per allocation site and size class, with tab separated
+ *  fields: kind ("malloc" or "chunk"), site (the caller of g_malloc()
+ *  or the chunk name), size class (the upper bound of the block sizes),
+ *  number of samples, estimated bytes allocated and still in use.
+ */
+static void
+g_mem_profile_samples (void)
+{
+  GMemSite *sites;
+  gulong interval;
+  guint n_sites, i;
+
+  /* logging allocates, so the rows are copied first */
+  g_mutex_lock (mem_sample_lock);
+  interval = mem_sample_interval;
+  n_sites = mem_n_sites;
+  sites = n_sites ? malloc (n_sites * sizeof (GMemSite)) : NULL;
+  if (sites)
+    memcpy (sites, mem_sites, n_sites * sizeof (GMemSite));
+  else
+    n_sites = 0;
+  g_mutex_unlock (mem_sample_lock);
+
+  if (!interval && !n_sites)
+    return;
+
+  g_log (g_log_domain_glib, G_LOG_LEVEL_INFO,
+	 "mem-sample\tinterval\t%lu", interval);
+  for (i = 0; i < n_sites; i++)
+    {
+      gchar site[32];
+
+      if (sites[i].kind == MEM_SITE_MALLOC)
+	g_snprintf (site, sizeof (site), "%p", sites[i].site);
+      g_log (g_log_domain_glib, G_LOG_LEVEL_INFO,
+	     "mem-sample\t%s\t%s\t%lu\t%lu\t%lu\t%lu",
+	     sites[i].kind == MEM_SITE_MALLOC ? "malloc" : "chunk",
+	     sites[i].kind == MEM_SITE_MALLOC ? site :
+	     sites[i].name ? sites[i].name : "(unnamed)",
+	     1UL << sites[i].size_class,
+	     sites[i].n_samples,
+	     sites[i].allocated,
+	     sites[i].live);
+    }
+  free (sites);
+}
+
 void
 g_mem_profile (void)
 {
@@ -445,6 +864,8 @@ g_mem_profile (void)
   g_log (g_log_domain_glib, G_LOG_LEVEL_INFO, "%lu bytes freed", local_freed_mem);
   g_log (g_log_domain_glib, G_LOG_LEVEL_INFO, "%lu bytes in use", local_allocated_mem - local_freed_mem);
 #endif /* ENABLE_MEM_PROFILE */
+
+  g_mem_profile_samples ();
 }
 
 void
@@ -487,6 +908,11 @@ g_mem_chunk_new (gchar  *name,
   mem_chunk->free_atoms = NULL;
   mem_chunk->mem_tree = NULL;
   mem_chunk->mem_areas = NULL;
+  mem_chunk->full_mem_areas = NULL;
+  mem_chunk->remote_atoms = NULL;
+  mem_chunk->cache_key.index = 0;
+  mem_chunk->caches = NULL;
+  mem_chunk->generation = 0;
   mem_chunk->atom_size = atom_size;
   
   if (mem_chunk->type == G_ALLOC_AND_FREE)
@@ -525,12 +951,22 @@ g_mem_chunk_destroy (GMemChunk *mem_chunk)
 
   rmem_chunk = (GRealMemChunk*) mem_chunk;
   
+  if (mem_n_sites)
+    g_mem_sample_forget_chunk (rmem_chunk, TRUE);
+  
   mem_areas = rmem_chunk->mem_areas;
   while (mem_areas)
     {
       temp_area = mem_areas;
       mem_areas = mem_areas->next;
-      g_free (temp_area);
+      g_mem_area_free (rmem_chunk, temp_area);
+    }
+  mem_areas = rmem_chunk->full_mem_areas;
+  while (mem_areas)
+    {
+      temp_area = mem_areas;
+      mem_areas = mem_areas->next;
+      g_mem_area_free (rmem_chunk, temp_area);
     }
   
   if (rmem_chunk->next)
@@ -546,6 +982,17 @@ g_mem_chunk_destroy (GMemChunk *mem_chunk)
   if (rmem_chunk->type == G_ALLOC_AND_FREE)
     g_tree_destroy (rmem_chunk->mem_tree);
   
+  if (rmem_chunk->type == G_ALLOC_AND_FREE_MT)
+    {
+      GMemChunkCache *cache;
+      
+      /* the caches stay around until their threads exit */
+      g_mutex_lock (mem_chunks_mt_lock);
+      for (cache = rmem_chunk->caches; cache; cache = cache->next)
+	cache->chunk = NULL;
+      g_mutex_unlock (mem_chunks_mt_lock);
+    }
+  
   g_free (rmem_chunk);
 
   LEAVE_MEM_CHUNK_ROUTINE();
@@ -564,6 +1011,17 @@ g_mem_chunk_alloc (GMemChunk *mem_chunk)
   
   rmem_chunk = (GRealMemChunk*) mem_chunk;
   
+  if (rmem_chunk->type == G_ALLOC_AND_FREE_SLAB)
+    {
+      mem = g_mem_chunk_slab_alloc (rmem_chunk);
+      goto outa_here;
+    }
+  else if (rmem_chunk->type == G_ALLOC_AND_FREE_MT)
+    {
+      mem = g_mem_chunk_mt_alloc (rmem_chunk);
+      goto outa_here;
+    }
+  
   while (rmem_chunk->free_atoms)
     {
       /* Get the first piece of memory on the "free_atoms" list.
@@ -679,6 +1137,8 @@ g_mem_chunk_alloc (GMemChunk *mem_chunk)
 
 outa_here:
 
+  MEM_SAMPLE_ALLOC (mem, rmem_chunk->atom_size, MEM_SITE_CHUNK, rmem_chunk);
+
   LEAVE_MEM_CHUNK_ROUTINE();
 
   return mem;
@@ -715,6 +1175,9 @@ g_mem_chunk_free (GMemChunk *mem_chunk,
 
   rmem_chunk = (GRealMemChunk*) mem_chunk;
   
+  if (rmem_chunk->type != G_ALLOC_ONLY)
+    MEM_SAMPLE_FREE (mem);
+  
   /* Don't do anything if this is an ALLOC_ONLY chunk
    */
   if (rmem_chunk->type == G_ALLOC_AND_FREE)
@@ -737,6 +1200,10 @@ g_mem_chunk_free (GMemChunk *mem_chunk,
 	  rmem_chunk->num_marked_areas += 1;
 	}
     }
+  else if (rmem_chunk->type == G_ALLOC_AND_FREE_SLAB)
+    g_mem_chunk_slab_free (rmem_chunk, mem);
+  else if (rmem_chunk->type == G_ALLOC_AND_FREE_MT)
+    g_mem_chunk_mt_free (rmem_chunk, mem);
 
   LEAVE_MEM_CHUNK_ROUTINE();
 }
@@ -806,6 +1273,28 @@ g_mem_chunk_clean (GMemChunk *mem_chunk)
 	    }
 	}
     }
+  else if (rmem_chunk->type == G_ALLOC_AND_FREE_SLAB)
+    {
+      GMemArea *next_area;
+      
+      /* release the spare empty area g_mem_chunk_slab_free() keeps */
+      rmem_chunk->free_mem_area = NULL;
+      for (mem_area = rmem_chunk->mem_areas; mem_area; mem_area = next_area)
+	{
+	  next_area = mem_area->next;
+	  if (mem_area->allocated == 0)
+	    {
+	      if (mem_area->next)
+		mem_area->next->prev = mem_area->prev;
+	      if (mem_area->prev)
+		mem_area->prev->next = mem_area->next;
+	      if (mem_area == rmem_chunk->mem_areas)
+		rmem_chunk->mem_areas = mem_area->next;
+	      rmem_chunk->num_mem_areas -= 1;
+	      g_mem_area_free (rmem_chunk, mem_area);
+	    }
+	}
+    }
 }
 
 void
@@ -819,6 +1308,9 @@ g_mem_chunk_reset (GMemChunk *mem_chunk)
   
   rmem_chunk = (GRealMemChunk*) mem_chunk;
   
+  if (mem_n_samples)
+    g_mem_sample_forget_chunk (rmem_chunk, FALSE);
+  
   mem_areas = rmem_chunk->mem_areas;
   rmem_chunk->num_mem_areas = 0;
   rmem_chunk->mem_areas = NULL;
@@ -828,11 +1320,32 @@ g_mem_chunk_reset (GMemChunk *mem_chunk)
     {
       temp_area = mem_areas;
       mem_areas = mem_areas->next;
-      g_free (temp_area);
+      g_mem_area_free (rmem_chunk, temp_area);
+    }
+  mem_areas = rmem_chunk->full_mem_areas;
+  rmem_chunk->full_mem_areas = NULL;
+  while (mem_areas)
+    {
+      temp_area = mem_areas;
+      mem_areas = mem_areas->next;
+      g_mem_area_free (rmem_chunk, temp_area);
     }
   
   rmem_chunk->free_atoms = NULL;
   
+  if (rmem_chunk->type == G_ALLOC_AND_FREE_SLAB)
+    rmem_chunk->free_mem_area = NULL;
+  
+  if (rmem_chunk->type == G_ALLOC_AND_FREE_MT)
+    {
+      /* the thread caches drop their atoms once they notice */
+      g_atomic_pointer_set ((gpointer*) &rmem_chunk->remote_atoms, NULL);
+      rmem_chunk->generation += 1;
+    }
+  
+  if (rmem_chunk->type != G_ALLOC_AND_FREE)
+    return;
+  
   if (rmem_chunk->mem_tree)
     g_tree_destroy (rmem_chunk->mem_tree);
   rmem_chunk->mem_tree = g_tree_new ((GCompareFunc) g_mem_chunk_area_compare);
@@ -856,6 +1369,8 @@ g_mem_chunk_print (GMemChunk *mem_chunk)
       mem += rmem_chunk->area_size - mem_areas->free;
       mem_areas = mem_areas->next;
     }
+  for (mem_areas = rmem_chunk->full_mem_areas; mem_areas; mem_areas = mem_areas->next)
+    mem += rmem_chunk->area_size - mem_areas->free;
   
   g_log (g_log_domain_glib, G_LOG_LEVEL_INFO,
 	 "%s: %ld bytes using %d mem areas",
@@ -907,6 +1422,161 @@ g_blow_chunks (void)
 }
 
 
+/* Arenas hand out memory by bumping a pointer through a block, and
+ *  don't free single allocations, only everything allocated after a
+ *  g_arena_mark() at once.
+ */
+GArena*
+g_arena_new (gulong block_size)
+{
+  GArena *arena;
+
+  arena = g_new (GArena, 1);
+  arena->block_size = ARENA_ALIGN (block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE);
+  arena->blocks = NULL;
+  arena->free_blocks = NULL;
+  arena->pos = NULL;
+  arena->end = NULL;
+
+  return arena;
+}
+
+void
+g_arena_destroy (GArena *arena)
+{
+  g_return_if_fail (arena != NULL);
+
+  g_arena_reset (arena, NULL);
+  while (arena->free_blocks)
+    {
+      GArenaBlock *block = arena->free_blocks;
+
+      arena->free_blocks = block->next;
+      g_free (block);
+    }
+  g_free (arena);
+}
+
+gpointer
+g_arena_alloc (GArena *arena,
+	       gulong  size)
+{
+  gpointer mem;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  size = ARENA_ALIGN (MAX (size, 1));
+  if (size > (gulong) (arena->end - arena->pos))
+    {
+      GArenaBlock *block;
+
+      /* allocations that don't fit into a regular block get a block
+       *  of their own
+       */
+      if (size <= arena->block_size && arena->free_blocks)
+	{
+	  block = arena->free_blocks;
+	  arena->free_blocks = block->next;
+	}
+      else
+	{
+	  gulong block_size = MAX (size, arena->block_size);
+
+	  block = g_malloc (ARENA_ALIGN (sizeof (GArenaBlock)) + block_size);
+	  block->size = block_size;
+	}
+      block->next = arena->blocks;
+      arena->blocks = block;
+      arena->pos = ARENA_BLOCK_MEM (block);
+      arena->end = arena->pos + block->size;
+    }
+
+  mem = arena->pos;
+  arena->pos += size;
+
+  return mem;
+}
+
+gpointer
+g_arena_alloc0 (GArena *arena,
+		gulong  size)
+{
+  gpointer mem;
+
+  mem = g_arena_alloc (arena, size);
+  if (mem)
+    memset (mem, 0, size);
+
+  return mem;
+}
+
+gchar*
+g_arena_strdup (GArena      *arena,
+		const gchar *str)
+{
+  gchar *new_str;
+  gulong length;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  if (!str)
+    return NULL;
+
+  length = strlen (str) + 1;
+  new_str = g_arena_alloc (arena, length);
+  memcpy (new_str, str, length);
+
+  return new_str;
+}
+
+/* returns a position in the arena that g_arena_reset() can go back to */
+gpointer
+g_arena_mark (GArena *arena)
+{
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  return arena->pos;
+}
+
+/* frees everything allocated from the arena after "mark" was taken,
+ *  or everything altogether if "mark" is NULL. regular blocks are
+ *  kept for reuse until the arena gets destroyed.
+ */
+void
+g_arena_reset (GArena   *arena,
+	       gpointer  mark)
+{
+  g_return_if_fail (arena != NULL);
+
+  while (arena->blocks)
+    {
+      GArenaBlock *block = arena->blocks;
+
+      if (mark &&
+	  (gchar*) mark >= ARENA_BLOCK_MEM (block) &&
+	  (gchar*) mark <= ARENA_BLOCK_MEM (block) + block->size)
+	{
+	  arena->pos = mark;
+	  arena->end = ARENA_BLOCK_MEM (block) + block->size;
+	  return;
+	}
+
+      arena->blocks = block->next;
+      if (block->size == arena->block_size)
+	{
+	  block->next = arena->free_blocks;
+	  arena->free_blocks = block;
+	}
+      else
+	g_free (block);
+    }
+
+  g_return_if_fail (mark == NULL);
+
+  arena->pos = NULL;
+  arena->end = NULL;
+}
+
 static gulong
 g_mem_chunk_compute_size (gulong size,
 			  gulong min_size)
@@ -951,6 +1621,337 @@ g_mem_chunk_area_search (GMemArea *a,
   return -1;
 }
 
+static void
+g_mem_area_free (GRealMemChunk *rmem_chunk,
+		 GMemArea      *mem_area)
+{
+  if (rmem_chunk->type != G_ALLOC_AND_FREE_SLAB)
+    g_free (mem_area);
+  else
+#ifdef HAVE_POSIX_MEMALIGN
+    free (mem_area);
+#else
+    g_free (mem_area->block);
+#endif
+}
+
+static gpointer
+g_mem_chunk_slab_alloc (GRealMemChunk *rmem_chunk)
+{
+  GMemArea *mem_area;
+  gpointer mem;
+  
+  /* rmem_chunk->mem_areas only holds areas with free atoms, an
+   * empty list means we need a new area.
+   */
+  mem_area = rmem_chunk->mem_areas;
+  if (!mem_area)
+    {
+      gulong slab_size = MEM_SLAB_SIZE (rmem_chunk);
+#ifdef HAVE_POSIX_MEMALIGN
+      gpointer block = NULL;
+      
+      if (posix_memalign (&block, slab_size, slab_size) != 0 || !block)
+	g_error ("could not allocate %ld bytes", slab_size);
+      mem_area = block;
+#else
+      gpointer block = g_malloc (2 * slab_size);
+      
+      mem_area = (GMemArea*) (((gulong) block + slab_size - 1) & ~(slab_size - 1));
+      mem_area->block = block;
+#endif
+      
+      mem_area->next = NULL;
+      mem_area->prev = NULL;
+      mem_area->index = 0;
+      mem_area->free = rmem_chunk->area_size;
+      mem_area->allocated = 0;
+      mem_area->mark = 0;
+      mem_area->free_atoms = NULL;
+      
+      rmem_chunk->mem_areas = mem_area;
+      rmem_chunk->num_mem_areas += 1;
+    }
+  
+  if (mem_area->free_atoms)
+    {
+      mem = mem_area->free_atoms;
+      mem_area->free_atoms = mem_area->free_atoms->next;
+    }
+  else
+    {
+      mem = (gpointer) &mem_area->mem[mem_area->index];
+      mem_area->index += rmem_chunk->atom_size;
+    }
+  mem_area->free -= rmem_chunk->atom_size;
+  mem_area->allocated += 1;
+  if (mem_area == rmem_chunk->free_mem_area)
+    rmem_chunk->free_mem_area = NULL;
+  
+  /* move full areas over to the full_mem_areas list, flagging them
+   *  with "mark".
+   */
+  if (mem_area->free < rmem_chunk->atom_size)
+    {
+      rmem_chunk->mem_areas = mem_area->next;
+      if (mem_area->next)
+	mem_area->next->prev = NULL;
+      
+      mem_area->mark = 1;
+      mem_area->prev = NULL;
+      mem_area->next = rmem_chunk->full_mem_areas;
+      if (rmem_chunk->full_mem_areas)
+	rmem_chunk->full_mem_areas->prev = mem_area;
+      rmem_chunk->full_mem_areas = mem_area;
+    }
+  
+  return mem;
+}
+
+static void
+g_mem_chunk_slab_free (GRealMemChunk *rmem_chunk,
+		       gpointer       mem)
+{
+  GMemArea *mem_area = MEM_SLAB_AREA (rmem_chunk, mem);
+  GFreeAtom *free_atom = mem;
+  
+  free_atom->next = mem_area->free_atoms;
+  mem_area->free_atoms = free_atom;
+  mem_area->free += rmem_chunk->atom_size;
+  mem_area->allocated -= 1;
+  
+  if (mem_area->mark)
+    {
+      /* the area was full, put it back where allocations find it */
+      if (mem_area->next)
+	mem_area->next->prev = mem_area->prev;
+      if (mem_area->prev)
+	mem_area->prev->next = mem_area->next;
+      else
+	rmem_chunk->full_mem_areas = mem_area->next;
+      
+      mem_area->mark = 0;
+      mem_area->prev = NULL;
+      mem_area->next = rmem_chunk->mem_areas;
+      if (rmem_chunk->mem_areas)
+	rmem_chunk->mem_areas->prev = mem_area;
+      rmem_chunk->mem_areas = mem_area;
+    }
+  
+  /* an area that got empty is given back to the system, unless it is
+   *  the only empty one. keeping one spare area spares a chunk that
+   *  keeps allocating and freeing an atom at the boundary of an area
+   *  from getting and releasing an area (big enough to be mmap()ed by
+   *  most malloc()s) every time.
+   */
+  if (mem_area->allocated == 0)
+    {
+      if (!rmem_chunk->free_mem_area)
+	rmem_chunk->free_mem_area = mem_area;
+      else
+	{
+	  if (mem_area->next)
+	    mem_area->next->prev = mem_area->prev;
+	  if (mem_area->prev)
+	    mem_area->prev->next = mem_area->next;
+	  else
+	    rmem_chunk->mem_areas = mem_area->next;
+	  rmem_chunk->num_mem_areas -= 1;
+	  g_mem_area_free (rmem_chunk, mem_area);
+	}
+    }
+}
+
+/* pushes the atoms first..last onto rmem_chunk->remote_atoms. pushing
+ *  never suffers from ABA, as the only other operation on the stack
+ *  takes all of it.
+ */
+static void
+g_mem_chunk_mt_push (GRealMemChunk *rmem_chunk,
+		     GFreeAtom     *first,
+		     GFreeAtom     *last)
+{
+  GFreeAtom *head;
+  
+  do
+    {
+      head = g_atomic_pointer_get ((gpointer*) &rmem_chunk->remote_atoms);
+      last->next = head;
+    }
+  while (!g_atomic_pointer_compare_and_exchange ((gpointer*) &rmem_chunk->remote_atoms,
+						 head, first));
+}
+
+static GFreeAtom*
+g_mem_chunk_mt_pop_all (GRealMemChunk *rmem_chunk)
+{
+  GFreeAtom *atoms;
+  
+  do
+    atoms = g_atomic_pointer_get ((gpointer*) &rmem_chunk->remote_atoms);
+  while (atoms && !g_atomic_pointer_compare_and_exchange ((gpointer*) &rmem_chunk->remote_atoms,
+							  atoms, NULL));
+  
+  return atoms;
+}
+
+static void
+g_mem_chunk_cache_free (gpointer data)
+{
+  GMemChunkCache *cache = data;
+  GMemChunkCache **node;
+  
+  g_mutex_lock (mem_chunks_mt_lock);
+  if (cache->chunk)
+    {
+      for (node = &cache->chunk->caches; *node != cache; node = &(*node)->next)
+	;
+      *node = cache->next;
+      
+      if (cache->free_atoms && cache->generation == cache->chunk->generation)
+	{
+	  GFreeAtom *last = cache->free_atoms;
+	  
+	  while (last->next)
+	    last = last->next;
+	  g_mem_chunk_mt_push (cache->chunk, cache->free_atoms, last);
+	}
+    }
+  g_mutex_unlock (mem_chunks_mt_lock);
+  
+  g_free (cache);
+}
+
+static GMemChunkCache*
+g_mem_chunk_cache_get (GRealMemChunk *rmem_chunk)
+{
+  GMemChunkCache *cache = g_static_private_get (&rmem_chunk->cache_key);
+  
+  if (!cache)
+    {
+      cache = g_new (GMemChunkCache, 1);
+      cache->chunk = rmem_chunk;
+      cache->free_atoms = NULL;
+      cache->n_free_atoms = 0;
+      cache->generation = rmem_chunk->generation;
+      
+      g_mutex_lock (mem_chunks_mt_lock);
+      cache->next = rmem_chunk->caches;
+      rmem_chunk->caches = cache;
+      g_mutex_unlock (mem_chunks_mt_lock);
+      
+      g_static_private_set (&rmem_chunk->cache_key, cache, g_mem_chunk_cache_free);
+    }
+  else if (cache->generation != rmem_chunk->generation)
+    {
+      /* the chunk got reset, the cached atoms are gone */
+      cache->free_atoms = NULL;
+      cache->n_free_atoms = 0;
+      cache->generation = rmem_chunk->generation;
+    }
+  
+  return cache;
+}
+
+/* HOLDS: mem_chunks_mt_lock */
+static void
+g_mem_chunk_mt_carve (GRealMemChunk  *rmem_chunk,
+		      GMemChunkCache *cache)
+{
+  GFreeAtom *atom;
+  guint i;
+  
+  for (i = 0; i < MEM_CHUNK_MT_BATCH; i++)
+    {
+      if (!rmem_chunk->mem_area ||
+	  rmem_chunk->mem_area->index + rmem_chunk->atom_size > rmem_chunk->area_size)
+	{
+	  rmem_chunk->mem_area = (GMemArea*) g_malloc (sizeof (GMemArea) -
+						       MEM_AREA_SIZE +
+						       rmem_chunk->area_size);
+	  rmem_chunk->num_mem_areas += 1;
+	  rmem_chunk->mem_area->next = rmem_chunk->mem_areas;
+	  rmem_chunk->mem_area->prev = NULL;
+	  if (rmem_chunk->mem_areas)
+	    rmem_chunk->mem_areas->prev = rmem_chunk->mem_area;
+	  rmem_chunk->mem_areas = rmem_chunk->mem_area;
+	  
+	  rmem_chunk->mem_area->index = 0;
+	  rmem_chunk->mem_area->free = rmem_chunk->area_size;
+	  rmem_chunk->mem_area->allocated = 0;
+	  rmem_chunk->mem_area->mark = 0;
+	}
+      
+      atom = (GFreeAtom*) &rmem_chunk->mem_area->mem[rmem_chunk->mem_area->index];
+      rmem_chunk->mem_area->index += rmem_chunk->atom_size;
+      rmem_chunk->mem_area->free -= rmem_chunk->atom_size;
+      rmem_chunk->mem_area->allocated += 1;
+      
+      atom->next = cache->free_atoms;
+      cache->free_atoms = atom;
+    }
+  cache->n_free_atoms += MEM_CHUNK_MT_BATCH;
+}
+
+static gpointer
+g_mem_chunk_mt_alloc (GRealMemChunk *rmem_chunk)
+{
+  GMemChunkCache *cache = g_mem_chunk_cache_get (rmem_chunk);
+  GFreeAtom *atom;
+  
+  if (!cache->free_atoms)
+    {
+      /* take whatever the other threads handed back, and only carve
+       *  up new memory if that's nothing.
+       */
+      cache->free_atoms = g_mem_chunk_mt_pop_all (rmem_chunk);
+      if (cache->free_atoms)
+	{
+	  cache->n_free_atoms = 0;
+	  for (atom = cache->free_atoms; atom; atom = atom->next)
+	    cache->n_free_atoms++;
+	}
+      else
+	{
+	  g_mutex_lock (mem_chunks_mt_lock);
+	  g_mem_chunk_mt_carve (rmem_chunk, cache);
+	  g_mutex_unlock (mem_chunks_mt_lock);
+	}
+    }
+  
+  atom = cache->free_atoms;
+  cache->free_atoms = atom->next;
+  cache->n_free_atoms--;
+  
+  return atom;
+}
+
+static void
+g_mem_chunk_mt_free (GRealMemChunk *rmem_chunk,
+		     gpointer       mem)
+{
+  GMemChunkCache *cache = g_mem_chunk_cache_get (rmem_chunk);
+  GFreeAtom *atom = mem;
+  
+  atom->next = cache->free_atoms;
+  cache->free_atoms = atom;
+  
+  /* hand a batch of atoms back once the cache holds two */
+  if (++cache->n_free_atoms >= 2 * MEM_CHUNK_MT_BATCH)
+    {
+      GFreeAtom *first = cache->free_atoms;
+      GFreeAtom *last = first;
+      guint i;
+      
+      for (i = 1; i < MEM_CHUNK_MT_BATCH; i++)
+	last = last->next;
+      cache->free_atoms = last->next;
+      cache->n_free_atoms -= MEM_CHUNK_MT_BATCH;
+      
+      g_mem_chunk_mt_push (rmem_chunk, first, last);
+    }
+}
+
 /* generic allocators
  */
 struct _GAllocator /* from gmem.c */
@@ -961,6 +1962,7 @@ struct _GAllocator /* from gmem.c */
   guint		 type : 4;
   GAllocator	*last;
   GMemChunk	*mem_chunk;
+  GArena	*arena;
   gpointer	 dummy; /* implementation specific */
 };
 
@@ -979,11 +1981,31 @@ g_allocator_new (const gchar *name,
   allocator->type = 0;
   allocator->last = NULL;
   allocator->mem_chunk = NULL;
+  allocator->arena = NULL;
   allocator->dummy = NULL;
 
   return allocator;
 }
 
+/* an allocator that takes its nodes from "arena", they go away with
+ *  the next g_arena_reset() instead of being freed. lists from such an
+ *  allocator must not be freed once it has been popped again.
+ */
+GAllocator*
+g_allocator_new_for_arena (const gchar *name,
+			   GArena      *arena)
+{
+  GAllocator *allocator;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  allocator = g_allocator_new (name, 1);
+  if (allocator)
+    allocator->arena = arena;
+
+  return allocator;
+}
+
 void
 g_allocator_free (GAllocator *allocator)
 {
@@ -1001,6 +2023,8 @@ void
 g_mem_init (void)
 {
   mem_chunks_lock = g_mutex_new();
+  mem_chunks_mt_lock = g_mutex_new();
+  mem_sample_lock = g_mutex_new();
 #ifdef ENABLE_MEM_PROFILE
   mem_profile_lock = g_mutex_new();
   allocating_for_mem_chunk = g_private_new(NULL);
@@ -36,11 +36,20 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include "glib.h"
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
+/* The asynchronous sink needs lock-free atomic operations and writev() */
+#if defined (G_ATOMIC_LOCK_FREE) && !defined (NATIVE_WIN32)
+#  define G_LOG_HAVE_ASYNC
+#  include <sys/uio.h>
+#  define G_LOG_ATOMIC_GET(ptr)		((guint) g_atomic_int_get ((gint*) (ptr)))
+#  define G_LOG_ATOMIC_SET(ptr, val)	g_atomic_int_set ((gint*) (ptr), (gint) (val))
+#endif
+
 #ifdef NATIVE_WIN32
 #define STRICT
 #include <windows.h>
@@ -79,10 +88,14 @@ ensure_stdout_valid (void)
 /* --- structures --- */
 typedef struct _GLogDomain	GLogDomain;
 typedef struct _GLogHandler	GLogHandler;
+typedef struct _GLogOutput	GLogOutput;
+typedef struct _GLogRecord	GLogRecord;
 struct _GLogDomain
 {
   gchar		*log_domain;
+  GQuark	 quark;
   GLogLevelFlags fatal_mask;
+  GLogLevelFlags enabled_mask;	/* 0 to follow g_log_default_enabled */
   GLogHandler	*handlers;
   GLogDomain	*next;
 };
@@ -95,14 +108,50 @@ struct _GLogHandler
   GLogHandler	*next;
 };
 
+/* what g_log_default_handler() writes a message to, text collects the
+ * message for the asynchronous sink
+ */
+struct _GLogOutput
+{
+#ifdef NATIVE_WIN32
+  FILE		*fd;
+#else
+  gint		 fd;
+#endif
+  gboolean	 async;
+  gchar		*text;
+  guint		 len;
+  guint		 alloc;
+};
+
+/* slot of the asynchronous sink's ring, a producer may fill slot
+ * pos & mask once sequence equals pos, the drain thread may take it
+ * once sequence is pos + 1
+ */
+struct _GLogRecord
+{
+  guint		 sequence;
+  gint		 fd;
+  guint		 len;
+  gchar		*text;
+};
+
 
 /* --- variables --- */
 
-static GMutex* g_messages_lock = NULL;
+static GStaticRWLock g_messages_lock = G_STATIC_RW_LOCK_INIT;
 
 const gchar	     *g_log_domain_glib = "GLib";
 static GLogDomain    *g_log_domains = NULL;
+static GLogDomain   **g_log_domain_index = NULL;	/* by quark */
+static GQuark	      g_log_domain_index_size = 0;
 static GLogLevelFlags g_log_always_fatal = G_LOG_FATAL_MASK;
+static GLogLevelFlags g_log_default_enabled = G_LOG_LEVEL_MASK;
+
+/* the levels that are enabled or fatal in any domain, a message of
+ * other levels can be dropped without looking at its domain
+ */
+GLogLevelFlags	      g_log_enabled_levels = G_LOG_LEVEL_MASK;
 static GPrintFunc     glib_print_func = NULL;
 static GPrintFunc     glib_printerr_func = NULL;
 static GErrorFunc     glib_error_func = NULL;
@@ -111,26 +160,70 @@ static GPrintFunc     glib_message_func = NULL;
 
 static GPrivate* g_log_depth = NULL;
 
+#define	G_LOG_ASYNC_BATCH		(64)
+
+static GLogRecord    *g_log_async_ring = NULL;
+static guint	      g_log_async_mask = 0;
+static guint	      g_log_async_head = 0;	/* next slot to fill */
+static guint	      g_log_async_tail = 0;	/* next slot to drain */
+static guint	      g_log_async_written = 0;	/* records written */
+static GLogAsyncOverflow g_log_async_overflow = G_LOG_ASYNC_DROP;
+static gint	      g_log_async_n_dropped = 0;
+static gboolean	      g_log_async_sleeping = FALSE;
+static guint	      g_log_async_n_waiting = 0;
+static GMutex	     *g_log_async_mutex = NULL;
+static GCond	     *g_log_async_wakeup = NULL;	/* for the drain thread */
+static GCond	     *g_log_async_space = NULL;	/* for blocked producers */
+static GCond	     *g_log_async_drained = NULL;	/* for g_log_async_flush() */
+
 
 /* --- functions --- */
 static inline GLogDomain*
 g_log_find_domain (const gchar	  *log_domain)
 {
-  register GLogDomain *domain;
+  register GLogDomain *domain = NULL;
+  GQuark quark;
   
-  g_mutex_lock (g_messages_lock);
-  domain = g_log_domains;
-  while (domain)
-    {
-      if (strcmp (domain->log_domain, log_domain) == 0)
-	{
-	  g_mutex_unlock (g_messages_lock);
-	  return domain;
-	}
-      domain = domain->next;
-    }
-  g_mutex_unlock (g_messages_lock);
-  return NULL;
+  /* every domain interns its name */
+  quark = g_quark_try_string (log_domain);
+  if (!quark)
+    return NULL;
+
+  g_static_rw_lock_reader_lock (&g_messages_lock);
+  if (quark < g_log_domain_index_size)
+    domain = g_log_domain_index[quark];
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
+
+  return domain;
+}
+
+/* HOLDS: g_messages_lock for writing */
+static void
+g_log_update_enabled_levels (void)
+{
+  register GLogDomain *domain;
+  GLogLevelFlags levels;
+
+  levels = g_log_default_enabled | g_log_always_fatal;
+  for (domain = g_log_domains; domain; domain = domain->next)
+    levels |= domain->enabled_mask | domain->fatal_mask;
+
+  g_log_enabled_levels = levels & G_LOG_LEVEL_MASK;
+}
+
+/* HOLDS: g_messages_lock */
+static inline GLogLevelFlags
+g_log_domain_levels (GLogDomain *domain)
+{
+  GLogLevelFlags enabled_mask;
+
+  if (domain)
+    enabled_mask = (domain->enabled_mask ? domain->enabled_mask : g_log_default_enabled) | 
+      domain->fatal_mask;
+  else
+    enabled_mask = g_log_default_enabled | G_LOG_FATAL_MASK;
+
+  return enabled_mask | g_log_always_fatal;
 }
 
 static inline GLogDomain*
@@ -140,13 +233,27 @@ g_log_domain_new (const gchar *log_domain)
 
   domain = g_new (GLogDomain, 1);
   domain->log_domain = g_strdup (log_domain);
+  domain->quark = g_quark_from_string (log_domain);
   domain->fatal_mask = G_LOG_FATAL_MASK;
+  domain->enabled_mask = 0;
   domain->handlers = NULL;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   domain->next = g_log_domains;
   g_log_domains = domain;
-  g_mutex_unlock (g_messages_lock);
+  if (domain->quark >= g_log_domain_index_size)
+    {
+      GQuark size = MAX (g_log_domain_index_size, 16);
+
+      while (size <= domain->quark)
+	size *= 2;
+      g_log_domain_index = g_renew (GLogDomain*, g_log_domain_index, size);
+      memset (g_log_domain_index + g_log_domain_index_size, 0,
+	      (size - g_log_domain_index_size) * sizeof (GLogDomain*));
+      g_log_domain_index_size = size;
+    }
+  g_log_domain_index[domain->quark] = domain;
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   
   return domain;
 }
@@ -155,13 +262,14 @@ static inline void
 g_log_domain_check_free (GLogDomain *domain)
 {
   if (domain->fatal_mask == G_LOG_FATAL_MASK &&
+      domain->enabled_mask == 0 &&
       domain->handlers == NULL)
     {
       register GLogDomain *last, *work;
       
       last = NULL;  
 
-      g_mutex_lock (g_messages_lock);
+      g_static_rw_lock_writer_lock (&g_messages_lock);
       work = g_log_domains;
       while (work)
 	{
@@ -171,6 +279,7 @@ g_log_domain_check_free (GLogDomain *domain)
 		last->next = domain->next;
 	      else
 		g_log_domains = domain->next;
+	      g_log_domain_index[domain->quark] = NULL;
 	      g_free (domain->log_domain);
 	      g_free (domain);
 	      break;
@@ -178,7 +287,8 @@ g_log_domain_check_free (GLogDomain *domain)
 	  last = work;
 	  work = last->next;
 	}  
-      g_mutex_unlock (g_messages_lock);
+      g_log_update_enabled_levels ();
+      g_static_rw_lock_writer_unlock (&g_messages_lock);
     }
 }
 
@@ -217,14 +327,79 @@ g_log_set_always_fatal (GLogLevelFlags fatal_mask)
   /* remove bogus flag */
   fatal_mask &= ~G_LOG_FLAG_FATAL;
 
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_mask = g_log_always_fatal;
   g_log_always_fatal = fatal_mask;
-  g_mutex_unlock (g_messages_lock);
+  g_log_update_enabled_levels ();
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
+
+  return old_mask;
+}
+
+GLogLevelFlags
+g_log_set_default_enabled_mask (GLogLevelFlags enabled_mask)
+{
+  GLogLevelFlags old_mask;
+
+  /* errors can't be disabled */
+  enabled_mask |= G_LOG_LEVEL_ERROR;
+  enabled_mask &= G_LOG_LEVEL_MASK;
+
+  g_static_rw_lock_writer_lock (&g_messages_lock);
+  old_mask = g_log_default_enabled;
+  g_log_default_enabled = enabled_mask;
+  g_log_update_enabled_levels ();
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
+
+  return old_mask;
+}
 
+GLogLevelFlags
+g_log_set_enabled_mask (const gchar    *log_domain,
+			GLogLevelFlags  enabled_mask)
+{
+  GLogLevelFlags old_mask;
+  register GLogDomain *domain;
+  
+  if (!log_domain)
+    log_domain = "";
+  
+  /* errors can't be disabled */
+  enabled_mask |= G_LOG_LEVEL_ERROR;
+  enabled_mask &= G_LOG_LEVEL_MASK;
+  
+  domain = g_log_find_domain (log_domain);
+  if (!domain)
+    domain = g_log_domain_new (log_domain);
+  
+  g_static_rw_lock_writer_lock (&g_messages_lock);
+  old_mask = domain->enabled_mask ? domain->enabled_mask : g_log_default_enabled;
+  domain->enabled_mask = enabled_mask;
+  g_log_update_enabled_levels ();
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
+  
   return old_mask;
 }
 
+gboolean
+g_log_domain_is_enabled (const gchar	*log_domain,
+			 GLogLevelFlags	 log_level)
+{
+  GLogDomain *domain;
+  GLogLevelFlags levels;
+
+  log_level &= G_LOG_LEVEL_MASK;
+  if (!(log_level & g_log_enabled_levels))
+    return FALSE;
+
+  domain = g_log_find_domain (log_domain ? log_domain : "");
+  g_static_rw_lock_reader_lock (&g_messages_lock);
+  levels = g_log_domain_levels (domain);
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
+
+  return (log_level & levels) != 0;
+}
+
 GLogLevelFlags
 g_log_set_fatal_mask (const gchar    *log_domain,
 		      GLogLevelFlags  fatal_mask)
@@ -246,6 +421,9 @@ g_log_set_fatal_mask (const gchar    *log_domain,
   old_flags = domain->fatal_mask;
   
   domain->fatal_mask = fatal_mask;
+  g_static_rw_lock_writer_lock (&g_messages_lock);
+  g_log_update_enabled_levels ();
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   g_log_domain_check_free (domain);
   
   return old_flags;
@@ -272,9 +450,9 @@ g_log_set_handler (const gchar	  *log_domain,
     domain = g_log_domain_new (log_domain);
   
   handler = g_new (GLogHandler, 1);
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   handler->id = ++handler_id;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   handler->log_level = log_levels;
   handler->log_func = log_func;
   handler->data = user_data;
@@ -332,8 +510,17 @@ g_logv (const gchar    *log_domain,
   va_list args2;
   gchar buffer[1025];
   register gint i;
+  GLogDomain *domain;
   
   log_level &= G_LOG_LEVEL_MASK;
+  if (!(log_level & g_log_enabled_levels))
+    return;
+  
+  /* drop the disabled levels before formatting anything */
+  domain = g_log_find_domain (log_domain ? log_domain : "");
+  g_static_rw_lock_reader_lock (&g_messages_lock);
+  log_level &= g_log_domain_levels (domain);
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
   if (!log_level)
     return;
   
@@ -364,7 +551,6 @@ g_logv (const gchar    *log_domain,
       if (log_level & test_level)
 	{
 	  guint depth = GPOINTER_TO_UINT (g_private_get (g_log_depth));
-	  GLogDomain *domain;
 	  GLogFunc log_func;
 	  gpointer data = NULL;
 	  
@@ -376,11 +562,11 @@ g_logv (const gchar    *log_domain,
 	  depth++;
 	  g_private_set (g_log_depth, GUINT_TO_POINTER (depth));
 
-	  g_mutex_lock (g_messages_lock);
+	  g_static_rw_lock_reader_lock (&g_messages_lock);
 	  if ((((domain ? domain->fatal_mask : G_LOG_FATAL_MASK) | 
 		g_log_always_fatal) & test_level) != 0)
 	    test_level |= G_LOG_FLAG_FATAL;  
-	  g_mutex_unlock (g_messages_lock);
+	  g_static_rw_lock_reader_unlock (&g_messages_lock);
 
 	  log_func = g_log_domain_get_handler (domain, test_level, &data);
 	  log_func (log_domain, test_level, buffer, data);
@@ -409,6 +595,299 @@ g_log (const gchar    *log_domain,
   va_end (args);
 }
 
+/* Asynchronous sink.
+ *
+ * Producers claim ring slots by advancing g_log_async_head with a
+ * compare and swap and publish them through the slot's sequence, the
+ * drain thread takes published records in order and writes runs of
+ * records for the same descriptor with a single writev(). The mutex
+ * and conditions are only touched to put the drain thread to sleep or
+ * wake it, to block producers of a full ring, and for flushing.
+ */
+#ifdef G_LOG_HAVE_ASYNC
+
+static gboolean
+g_log_async_push (gint	 fd,
+		  gchar *text,
+		  guint	 len)
+{
+  guint pos = G_LOG_ATOMIC_GET (&g_log_async_head);
+
+  for (;;)
+    {
+      GLogRecord *record = &g_log_async_ring[pos & g_log_async_mask];
+      gint diff = (gint) (G_LOG_ATOMIC_GET (&record->sequence) - pos);
+
+      if (diff == 0)
+	{
+	  if (g_atomic_int_compare_and_exchange ((gint*) &g_log_async_head, pos, pos + 1))
+	    {
+	      record->fd = fd;
+	      record->len = len;
+	      record->text = text;
+	      G_LOG_ATOMIC_SET (&record->sequence, pos + 1);
+	      break;
+	    }
+	}
+      else if (diff < 0)
+	return FALSE;	/* full */
+
+      pos = G_LOG_ATOMIC_GET (&g_log_async_head);
+    }
+
+  /* pairs with the barrier of the drain thread going to sleep */
+  g_atomic_memory_barrier ();
+
+  return TRUE;
+}
+
+static void
+g_log_async_enqueue (gint   fd,
+		     gchar *text,
+		     guint  len)
+{
+  if (g_log_async_push (fd, text, len))
+    {
+      if (G_LOG_ATOMIC_GET (&g_log_async_sleeping))
+	{
+	  g_mutex_lock (g_log_async_mutex);
+	  g_cond_signal (g_log_async_wakeup);
+	  g_mutex_unlock (g_log_async_mutex);
+	}
+    }
+  else if (g_log_async_overflow == G_LOG_ASYNC_BLOCK)
+    {
+      g_mutex_lock (g_log_async_mutex);
+      g_log_async_n_waiting++;
+      while (!g_log_async_push (fd, text, len))
+	g_cond_wait (g_log_async_space, g_log_async_mutex);
+      g_log_async_n_waiting--;
+      g_cond_signal (g_log_async_wakeup);
+      g_mutex_unlock (g_log_async_mutex);
+    }
+  else
+    {
+      g_atomic_int_inc (&g_log_async_n_dropped);
+      free (text);
+    }
+}
+
+static void
+g_log_async_writev (gint	  fd,
+		    struct iovec *iov,
+		    guint	  n_iov)
+{
+  while (n_iov)
+    {
+      ssize_t written = writev (fd, iov, MIN (n_iov, G_LOG_ASYNC_BATCH));
+
+      if (written < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  break;
+	}
+
+      while (n_iov && (size_t) written >= iov->iov_len)
+	{
+	  written -= iov->iov_len;
+	  iov++;
+	  n_iov--;
+	}
+      if (n_iov)
+	{
+	  iov->iov_base = (gchar*) iov->iov_base + written;
+	  iov->iov_len -= written;
+	}
+    }
+}
+
+static void
+g_log_async_drain (gpointer data)
+{
+  struct iovec iov[G_LOG_ASYNC_BATCH];
+  gchar *texts[G_LOG_ASYNC_BATCH];
+
+  for (;;)
+    {
+      guint n = 0;
+      gint fd = -1;
+      guint i;
+
+      while (n < G_LOG_ASYNC_BATCH)
+	{
+	  GLogRecord *record = &g_log_async_ring[g_log_async_tail & g_log_async_mask];
+
+	  if (G_LOG_ATOMIC_GET (&record->sequence) != g_log_async_tail + 1 ||
+	      (n && record->fd != fd))
+	    break;
+
+	  fd = record->fd;
+	  texts[n] = record->text;
+	  iov[n].iov_base = record->text;
+	  iov[n].iov_len = record->len;
+	  n++;
+	  G_LOG_ATOMIC_SET (&record->sequence, g_log_async_tail + g_log_async_mask + 1);
+	  g_log_async_tail++;
+	}
+
+      if (n)
+	{
+	  g_log_async_writev (fd, iov, n);
+	  for (i = 0; i < n; i++)
+	    free (texts[i]);
+
+	  g_mutex_lock (g_log_async_mutex);
+	  g_log_async_written += n;
+	  if (g_log_async_n_waiting)
+	    g_cond_broadcast (g_log_async_space);
+	  g_cond_broadcast (g_log_async_drained);
+	  g_mutex_unlock (g_log_async_mutex);
+	  continue;
+	}
+
+      g_mutex_lock (g_log_async_mutex);
+      G_LOG_ATOMIC_SET (&g_log_async_sleeping, TRUE);
+      g_atomic_memory_barrier ();
+      if (G_LOG_ATOMIC_GET (&g_log_async_ring[g_log_async_tail & g_log_async_mask].sequence) !=
+	  g_log_async_tail + 1)
+	g_cond_wait (g_log_async_wakeup, g_log_async_mutex);
+      G_LOG_ATOMIC_SET (&g_log_async_sleeping, FALSE);
+      g_mutex_unlock (g_log_async_mutex);
+    }
+}
+
+#endif /* G_LOG_HAVE_ASYNC */
+
+gboolean
+g_log_set_async (guint		   n_records,
+		 GLogAsyncOverflow overflow)
+{
+#ifdef G_LOG_HAVE_ASYNC
+  static gboolean at_exit = FALSE;
+  guint i, size = 1;
+
+  g_return_val_if_fail (n_records > 0, FALSE);
+
+  if (g_log_async_ring)
+    {
+      g_log_async_overflow = overflow;
+      return TRUE;
+    }
+  if (!g_thread_supported ())
+    return FALSE;
+
+  while (size < n_records)
+    size <<= 1;
+
+  g_log_async_mutex = g_mutex_new ();
+  g_log_async_wakeup = g_cond_new ();
+  g_log_async_space = g_cond_new ();
+  g_log_async_drained = g_cond_new ();
+  g_log_async_overflow = overflow;
+  g_log_async_mask = size - 1;
+  g_log_async_ring = g_new (GLogRecord, size);
+  for (i = 0; i < size; i++)
+    g_log_async_ring[i].sequence = i;
+
+  if (!g_thread_create (g_log_async_drain, NULL))
+    {
+      g_free (g_log_async_ring);
+      g_log_async_ring = NULL;
+      g_cond_free (g_log_async_drained);
+      g_cond_free (g_log_async_space);
+      g_cond_free (g_log_async_wakeup);
+      g_mutex_free (g_log_async_mutex);
+      return FALSE;
+    }
+
+  if (!at_exit)
+    {
+      at_exit = TRUE;
+      g_atexit (g_log_async_flush);
+    }
+
+  return TRUE;
+#else	/* !G_LOG_HAVE_ASYNC */
+  return FALSE;
+#endif	/* !G_LOG_HAVE_ASYNC */
+}
+
+void
+g_log_async_flush (void)
+{
+#ifdef G_LOG_HAVE_ASYNC
+  guint target;
+
+  if (!g_log_async_ring)
+    return;
+
+  /* messages that got dropped never get written */
+  target = G_LOG_ATOMIC_GET (&g_log_async_head);
+  g_mutex_lock (g_log_async_mutex);
+  while ((gint) (g_log_async_written - target) < 0)
+    g_cond_wait (g_log_async_drained, g_log_async_mutex);
+  g_mutex_unlock (g_log_async_mutex);
+#endif	/* G_LOG_HAVE_ASYNC */
+}
+
+gulong
+g_log_async_get_dropped (void)
+{
+#ifdef G_LOG_HAVE_ASYNC
+  return (guint) g_atomic_int_get (&g_log_async_n_dropped);
+#else	/* !G_LOG_HAVE_ASYNC */
+  return 0;
+#endif	/* !G_LOG_HAVE_ASYNC */
+}
+
+static void
+g_log_output_write (GLogOutput	*output,
+		    const gchar *buf,
+		    guint	 len)
+{
+  if (output->async)
+    {
+      if (output->len + len > output->alloc)
+	{
+	  guint alloc = MAX (output->alloc * 2, output->len + len);
+	  gchar *text = realloc (output->text, alloc);
+
+	  if (text)
+	    {
+	      output->text = text;
+	      output->alloc = alloc;
+	    }
+	  else
+	    {
+	      /* out of memory, write what we have */
+	      output->async = FALSE;
+	      if (output->len)
+		write (output->fd, output->text, output->len);
+	      free (output->text);
+	      output->text = NULL;
+	    }
+	}
+      if (output->async)
+	{
+	  memcpy (output->text + output->len, buf, len);
+	  output->len += len;
+	  return;
+	}
+    }
+
+  write (output->fd, buf, len);
+}
+
+static void
+g_log_output_finish (GLogOutput *output)
+{
+#ifdef G_LOG_HAVE_ASYNC
+  if (output->async && output->text)
+    g_log_async_enqueue (output->fd, output->text, output->len);
+#endif	/* G_LOG_HAVE_ASYNC */
+}
+
 void
 g_log_default_handler (const gchar    *log_domain,
 		       GLogLevelFlags  log_level,
@@ -425,6 +904,7 @@ g_log_default_handler (const gchar    *log_domain,
   GErrorFunc     local_glib_error_func;
   GWarningFunc   local_glib_warning_func;
   GPrintFunc     local_glib_message_func;
+  GLogOutput     output;
 
   in_recursion = (log_level & G_LOG_FLAG_RECURSION) != 0;
   is_fatal = (log_level & G_LOG_FLAG_FATAL) != 0;
@@ -442,11 +922,22 @@ g_log_default_handler (const gchar    *log_domain,
   fd = (log_level >= G_LOG_LEVEL_MESSAGE) ? 1 : 2;
 #endif
   
-  g_mutex_lock (g_messages_lock);
+  /* fatal messages and messages about failures of the logging itself
+   * are written right away, after the pending ones
+   */
+  output.fd = fd;
+  output.async = g_log_async_ring && !is_fatal && !in_recursion;
+  output.text = NULL;
+  output.len = 0;
+  output.alloc = 0;
+  if (is_fatal)
+    g_log_async_flush ();
+  
+  g_static_rw_lock_reader_lock (&g_messages_lock);
   local_glib_error_func = glib_error_func;
   local_glib_warning_func = glib_warning_func;
   local_glib_message_func = glib_message_func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
 
   switch (log_level)
     {
@@ -461,41 +952,41 @@ g_log_default_handler (const gchar    *log_domain,
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, "\n", 1);
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, "\n", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       else
-	write (fd, "\n** ", 4);
+	g_log_output_write (&output, "\n** ", 4);
       if (in_recursion)
-	write (fd, "ERROR (recursed) **: ", 21);
+	g_log_output_write (&output, "ERROR (recursed) **: ", 21);
       else
-	write (fd, "ERROR **: ", 10);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "ERROR **: ", 10);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     case G_LOG_LEVEL_CRITICAL:
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, "\n", 1);
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, "\n", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       else
-	write (fd, "\n** ", 4);
+	g_log_output_write (&output, "\n** ", 4);
       if (in_recursion)
-	write (fd, "CRITICAL (recursed) **: ", 24);
+	g_log_output_write (&output, "CRITICAL (recursed) **: ", 24);
       else
-	write (fd, "CRITICAL **: ", 13);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "CRITICAL **: ", 13);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     case G_LOG_LEVEL_WARNING:
       if (!log_domain && local_glib_warning_func)
@@ -507,21 +998,21 @@ g_log_default_handler (const gchar    *log_domain,
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, "\n", 1);
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, "\n", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       else
-	write (fd, "\n** ", 4);
+	g_log_output_write (&output, "\n** ", 4);
       if (in_recursion)
-	write (fd, "WARNING (recursed) **: ", 23);
+	g_log_output_write (&output, "WARNING (recursed) **: ", 23);
       else
-	write (fd, "WARNING **: ", 12);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "WARNING **: ", 12);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     case G_LOG_LEVEL_MESSAGE:
       if (!log_domain && local_glib_message_func)
@@ -533,52 +1024,52 @@ g_log_default_handler (const gchar    *log_domain,
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       if (in_recursion)
-	write (fd, "Message (recursed): ", 20);
+	g_log_output_write (&output, "Message (recursed): ", 20);
       else
-	write (fd, "Message: ", 9);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "Message: ", 9);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     case G_LOG_LEVEL_INFO:
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       if (in_recursion)
-	write (fd, "INFO (recursed): ", 17);
+	g_log_output_write (&output, "INFO (recursed): ", 17);
       else
-	write (fd, "INFO: ", 6);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "INFO: ", 6);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     case G_LOG_LEVEL_DEBUG:
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, log_domain, strlen (log_domain));
-	  write (fd, "-", 1);
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, "-", 1);
 	}
       if (in_recursion)
-	write (fd, "DEBUG (recursed): ", 18);
+	g_log_output_write (&output, "DEBUG (recursed): ", 18);
       else
-	write (fd, "DEBUG: ", 7);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "DEBUG: ", 7);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     default:
       /* we are used for a log level that is not defined by GLib itself,
@@ -587,16 +1078,16 @@ g_log_default_handler (const gchar    *log_domain,
       ensure_stdout_valid ();
       if (log_domain)
 	{
-	  write (fd, log_domain, strlen (log_domain));
+	  g_log_output_write (&output, log_domain, strlen (log_domain));
 	  if (in_recursion)
-	    write (fd, "-LOG (recursed:", 15);
+	    g_log_output_write (&output, "-LOG (recursed:", 15);
 	  else
-	    write (fd, "-LOG (", 6);
+	    g_log_output_write (&output, "-LOG (", 6);
 	}
       else if (in_recursion)
-	write (fd, "LOG (recursed:", 14);
+	g_log_output_write (&output, "LOG (recursed:", 14);
       else
-	write (fd, "LOG (", 5);
+	g_log_output_write (&output, "LOG (", 5);
       if (log_level)
 	{
 	  gchar string[] = "0x00): ";
@@ -610,17 +1101,19 @@ g_log_default_handler (const gchar    *log_domain,
 	  if (*p > '9')
 	    *p += 'A' - '9' - 1;
 	  
-	  write (fd, string, 7);
+	  g_log_output_write (&output, string, 7);
 	}
       else
-	write (fd, "): ", 3);
-      write (fd, message, strlen(message));
+	g_log_output_write (&output, "): ", 3);
+      g_log_output_write (&output, message, strlen(message));
       if (is_fatal)
-	write (fd, "\naborting...\n", 13);
+	g_log_output_write (&output, "\naborting...\n", 13);
       else
-	write (fd, "\n", 1);
+	g_log_output_write (&output, "\n", 1);
       break;
     }
+
+  g_log_output_finish (&output);
 }
 
 GPrintFunc
@@ -628,10 +1121,10 @@ g_set_print_handler (GPrintFunc func)
 {
   GPrintFunc old_print_func;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_print_func = glib_print_func;
   glib_print_func = func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   
   return old_print_func;
 }
@@ -650,9 +1143,9 @@ g_print (const gchar *format,
   string = g_strdup_vprintf (format, args);
   va_end (args);
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_reader_lock (&g_messages_lock);
   local_glib_print_func = glib_print_func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
 
   if (local_glib_print_func)
     local_glib_print_func (string);
@@ -670,10 +1163,10 @@ g_set_printerr_handler (GPrintFunc func)
 {
   GPrintFunc old_printerr_func;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_printerr_func = glib_printerr_func;
   glib_printerr_func = func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   
   return old_printerr_func;
 }
@@ -692,9 +1185,9 @@ g_printerr (const gchar *format,
   string = g_strdup_vprintf (format, args);
   va_end (args);
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_reader_lock (&g_messages_lock);
   local_glib_printerr_func = glib_printerr_func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_reader_unlock (&g_messages_lock);
 
   if (local_glib_printerr_func)
     local_glib_printerr_func (string);
@@ -712,10 +1205,10 @@ g_set_error_handler (GErrorFunc func)
 {
   GErrorFunc old_error_func;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_error_func = glib_error_func;
   glib_error_func = func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
  
   return old_error_func;
 }
@@ -726,10 +1219,10 @@ g_set_warning_handler (GWarningFunc func)
 {
   GWarningFunc old_warning_func;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_warning_func = glib_warning_func;
   glib_warning_func = func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   
   return old_warning_func;
 }
@@ -740,10 +1233,10 @@ g_set_message_handler (GPrintFunc func)
 {
   GPrintFunc old_message_func;
   
-  g_mutex_lock (g_messages_lock);
+  g_static_rw_lock_writer_lock (&g_messages_lock);
   old_message_func = glib_message_func;
   glib_message_func = func;
-  g_mutex_unlock (g_messages_lock);
+  g_static_rw_lock_writer_unlock (&g_messages_lock);
   
   return old_message_func;
 }
@@ -751,6 +1244,5 @@ g_set_message_handler (GPrintFunc func)
 void
 g_messages_init (void)
 {
-  g_messages_lock = g_mutex_new();
   g_log_depth = g_private_new(NULL);
 }
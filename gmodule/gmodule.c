@@ -34,12 +34,26 @@
 #include	<string.h>
 
 
-/* We maintain a list of modules, so we can reference count them.
+/* We maintain a registry of modules, so we can reference count them.
  * That's needed because some platforms don't support refernce counts on
  * modules e.g. the shl_* implementation of HP-UX
  * (http://www.stat.umn.edu/~luke/xls/projects/dlbasics/dlbasics.html).
+ * The registry is hashed by file name and by handle, so looking up an
+ * already opened module doesn't depend on the number of open modules.
  * Also, the module for the program itself is kept seperatedly for
  * faster access and because it has special semantics.
+ *
+ * A module is registered before its g_module_check_init() runs, but
+ * until that returned, other threads opening it wait on
+ * module_opened_cond instead of getting a module that may still fail
+ * its initialization.  An initialization that opens its own module
+ * again finds it on the thread's list in module_opening_private, and
+ * gets it right away.
+ *
+ * Every module caches the symbols resolved through it, so repeated
+ * lookups of the same name don't go through dlsym() and friends again.
+ * Only successful lookups are cached, failing ones are retried each
+ * time.
  */
 
 
@@ -48,10 +62,11 @@ struct _GModule
 {
   gchar	*file_name;
   gpointer handle;
-  guint ref_count : 31;
+  guint ref_count : 30;
   guint is_resident : 1;
+  guint is_opening : 1;		/* until g_module_check_init() returned */
   GModuleUnload unload;
-  GModule *next;
+  GHashTable *symbols;
 };
 
 
@@ -68,53 +83,71 @@ static gchar*		_g_module_build_path	(const gchar	*directory,
 static inline void	g_module_set_error	(const gchar	*error);
 static inline GModule*	g_module_find_by_handle (gpointer	 handle);
 static inline GModule*	g_module_find_by_name	(const gchar	*name);
+static gpointer		g_module_resolve	(GModule	*module,
+						 const gchar	*symbol_name);
+static void		g_module_free_symbols	(GModule	*module);
 
 
 /* --- variables --- */
 G_LOCK_DEFINE_STATIC (GModule);
-static GModule	     *modules = NULL;
+static GHashTable    *modules_by_name = NULL;
+static GHashTable    *modules_by_handle = NULL;
 static GModule	     *main_module = NULL;
 static GStaticPrivate module_error_private = G_STATIC_PRIVATE_INIT;
+static GStaticPrivate module_opening_private = G_STATIC_PRIVATE_INIT;
+static GCond	     *module_opened_cond = NULL;
+/* protects the symbol caches of all modules */
+static GStaticRWLock  module_symbols_lock = G_STATIC_RW_LOCK_INIT;
 
 
 /* --- inline functions --- */
+/* the lookups are called with the GModule lock held, so that finding
+ * a module and taking a reference on it can't race with another
+ * thread opening or closing it
+ */
 static inline GModule*
 g_module_find_by_handle (gpointer handle)
 {
-  GModule *module;
-  GModule *retval = NULL;
-  
-  G_LOCK (GModule);
   if (main_module && main_module->handle == handle)
-    retval = main_module;
-  else
-    for (module = modules; module; module = module->next)
-      if (handle == module->handle)
-	{
-	  retval = module;
-	  break;
-	}
-  G_UNLOCK (GModule);
+    return main_module;
+  else if (modules_by_handle)
+    return g_hash_table_lookup (modules_by_handle, handle);
 
-  return retval;
+  return NULL;
 }
 
 static inline GModule*
 g_module_find_by_name (const gchar *name)
 {
-  GModule *module;
-  GModule *retval = NULL;
-  
-  G_LOCK (GModule);
-  for (module = modules; module; module = module->next)
-    if (strcmp (name, module->file_name) == 0)
-	{
-	  retval = module;
-	  break;
-	}
-  G_UNLOCK (GModule);
+  if (modules_by_name)
+    return g_hash_table_lookup (modules_by_name, name);
 
-  return retval;
+  return NULL;
+}
+
+/* HOLDS: GModule lock.  Looks a module up by name, or by handle if
+ * name is NULL, waiting while another thread initializes it.  A failed
+ * initialization unregisters the module, so it is looked up again
+ * after every wait.
+ */
+static GModule*
+g_module_find_opened (const gchar *name,
+		      gpointer	   handle)
+{
+  for (;;)
+    {
+      GModule *module;
+
+      module = name ? g_module_find_by_name (name) : g_module_find_by_handle (handle);
+      if (!module || !module->is_opening ||
+	  g_slist_find (g_static_private_get (&module_opening_private), module))
+	return module;
+
+#ifdef G_THREADS_ENABLED
+      g_cond_wait (module_opened_cond,
+		   g_static_mutex_get_mutex (&G_LOCK_NAME (GModule)));
+#endif
+    }
 }
 
 static inline void
@@ -209,8 +242,9 @@ g_module_open (const gchar    *file_name,
 	      main_module->handle = handle;
 	      main_module->ref_count = 1;
 	      main_module->is_resident = TRUE;
+	      main_module->is_opening = FALSE;
 	      main_module->unload = NULL;
-	      main_module->next = NULL;
+	      main_module->symbols = NULL;
 	    }
 	}
       G_UNLOCK (GModule);
@@ -218,14 +252,16 @@ g_module_open (const gchar    *file_name,
       return main_module;
     }
   
-  /* we first search the module list by name */
-  module = g_module_find_by_name (file_name);
+  /* we first search the module registry by name */
+  G_LOCK (GModule);
+  if (!module_opened_cond && g_thread_supported ())
+    module_opened_cond = g_cond_new ();
+  module = g_module_find_opened (file_name, NULL);
   if (module)
-    {
-      module->ref_count++;
-      
-      return module;
-    }
+    module->ref_count++;
+  G_UNLOCK (GModule);
+  if (module)
+    return module;
   
   /* open the module */
   handle = _g_module_open (file_name, (flags & G_MODULE_BIND_LAZY) != 0);
@@ -233,40 +269,75 @@ g_module_open (const gchar    *file_name,
     {
       gchar *saved_error;
       GModuleCheckInit check_init;
+      GModuleUnload unload = NULL;
       const gchar *check_failed = NULL;
+      GSList *opening;
       
-      /* search the module list by handle, since file names are not unique */
-      module = g_module_find_by_handle (handle);
+      /* search the module registry by handle, since file names are not
+       * unique.  this and the registration are done in one go, otherwise
+       * two threads opening the same file could both register it.
+       */
+      G_LOCK (GModule);
+      module = g_module_find_opened (NULL, handle);
       if (module)
 	{
-	  _g_module_close (module->handle, TRUE);
 	  module->ref_count++;
+	  G_UNLOCK (GModule);
+	  _g_module_close (handle, TRUE);
 	  g_module_set_error (NULL);
 	  
 	  return module;
 	}
       
-      saved_error = g_strdup (g_module_error ());
-      g_module_set_error (NULL);
-      
       module = g_new (GModule, 1);
       module->file_name = g_strdup (file_name);
       module->handle = handle;
       module->ref_count = 1;
       module->is_resident = FALSE;
+      module->is_opening = TRUE;
       module->unload = NULL;
-      G_LOCK (GModule);
-      module->next = modules;
-      modules = module;
+      module->symbols = NULL;
+      if (!modules_by_name)
+	{
+	  modules_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	  modules_by_handle = g_hash_table_new (g_direct_hash, NULL);
+	}
+      g_hash_table_insert (modules_by_name, module->file_name, module);
+      g_hash_table_insert (modules_by_handle, module->handle, module);
       G_UNLOCK (GModule);
       
+      saved_error = g_strdup (g_module_error ());
+      g_module_set_error (NULL);
+      
       /* check initialization */
+      opening = g_static_private_get (&module_opening_private);
+      g_static_private_set (&module_opening_private,
+			    g_slist_prepend (opening, module), NULL);
       if (g_module_symbol (module, "g_module_check_init", (gpointer) &check_init))
 	check_failed = check_init (module);
+      opening = g_slist_remove (g_static_private_get (&module_opening_private), module);
+      g_static_private_set (&module_opening_private, opening, NULL);
       
       /* we don't call unload() if the initialization check failed. */
       if (!check_failed)
-	g_module_symbol (module, "g_module_unload", (gpointer) &module->unload);
+	g_module_symbol (module, "g_module_unload", (gpointer) &unload);
+      
+      /* publish the outcome to the threads waiting for it, a module
+       * that failed is unregistered first, so they open it themselves
+       */
+      G_LOCK (GModule);
+      module->is_opening = FALSE;
+      if (check_failed)
+	{
+	  if (g_hash_table_lookup (modules_by_name, module->file_name) == module)
+	    g_hash_table_remove (modules_by_name, module->file_name);
+	  g_hash_table_remove (modules_by_handle, module->handle);
+	}
+      else
+	module->unload = unload;
+      if (module_opened_cond)
+	g_cond_broadcast (module_opened_cond);
+      G_UNLOCK (GModule);
       
       if (check_failed)
 	{
@@ -287,51 +358,121 @@ g_module_open (const gchar    *file_name,
   return module;
 }
 
+typedef struct
+{
+  GModuleFlags flags;
+} GModuleOpenMany;
+
+static void
+g_module_open_one (gpointer data,
+		   gpointer user_data)
+{
+  GModuleLoad *load = data;
+  GModuleOpenMany *open_many = user_data;
+  GTimeVal start, end;
+
+  g_get_current_time (&start);
+  load->module = g_module_open (load->file_name, open_many->flags);
+  g_get_current_time (&end);
+
+  load->seconds = (end.tv_sec - start.tv_sec) +
+    (end.tv_usec - start.tv_usec) / 1000000.0;
+  load->error = load->module ? NULL : g_strdup (g_module_error ());
+}
+
+guint
+g_module_open_many (GModuleLoad	 *loads,
+		    guint	  n_loads,
+		    GModuleFlags  flags,
+		    guint	  max_threads)
+{
+  GModuleOpenMany open_many;
+  GThreadPool *pool;
+  guint n_opened = 0;
+  guint i;
+
+  SUPPORT_OR_RETURN (0);
+
+  g_return_val_if_fail (loads != NULL || n_loads == 0, 0);
+
+  for (i = 0; i < n_loads; i++)
+    {
+      g_return_val_if_fail (loads[i].file_name != NULL, 0);
+
+      loads[i].module = NULL;
+      loads[i].error = NULL;
+      loads[i].seconds = 0;
+    }
+
+  /* without threads the pool runs each job right away, which gives
+   * plain sequential loading
+   */
+  open_many.flags = flags;
+  pool = g_thread_pool_new (g_module_open_one, &open_many, max_threads);
+  for (i = 0; i < n_loads; i++)
+    g_thread_pool_push (pool, &loads[i]);
+  g_thread_pool_free (pool, FALSE);
+
+  /* the per thread error of the workers is gone, so report the
+   * first failure to the caller
+   */
+  g_module_set_error (NULL);
+  for (i = 0; i < n_loads; i++)
+    if (loads[i].module)
+      n_opened++;
+    else if (!g_module_error ())
+      g_module_set_error (loads[i].error);
+
+  return n_opened;
+}
+
 gboolean
 g_module_close (GModule	       *module)
 {
+  GModuleUnload unload = NULL;
+  gboolean is_unused;
+
   SUPPORT_OR_RETURN (FALSE);
   
   g_return_val_if_fail (module != NULL, FALSE);
   g_return_val_if_fail (module->ref_count > 0, FALSE);
   
+  G_LOCK (GModule);
   module->ref_count--;
-  
-  if (!module->ref_count && !module->is_resident && module->unload)
+  is_unused = !module->ref_count && !module->is_resident;
+  if (is_unused)
     {
-      GModuleUnload unload;
-
       unload = module->unload;
       module->unload = NULL;
-      unload (module);
     }
+  G_UNLOCK (GModule);
+  
+  if (unload)
+    unload (module);
 
-  if (!module->ref_count && !module->is_resident)
+  /* the module may have been opened again meanwhile */
+  if (is_unused)
     {
-      GModule *last;
-      GModule *node;
-      
-      last = NULL;
-      
       G_LOCK (GModule);
-      node = modules;
-      while (node)
+      is_unused = !module->ref_count && !module->is_resident;
+      if (is_unused)
 	{
-	  if (node == module)
-	    {
-	      if (last)
-		last->next = node->next;
-	      else
-		modules = node->next;
-	      break;
-	    }
-	  last = node;
-	  node = last->next;
+	  /* file names are not unique, and a module whose initialization
+	   * failed is unregistered already, so only drop the entries
+	   * that actually refer to this module
+	   */
+	  if (g_hash_table_lookup (modules_by_name, module->file_name) == module)
+	    g_hash_table_remove (modules_by_name, module->file_name);
+	  if (g_hash_table_lookup (modules_by_handle, module->handle) == module)
+	    g_hash_table_remove (modules_by_handle, module->handle);
 	}
-      module->next = NULL;
       G_UNLOCK (GModule);
-      
+    }
+
+  if (is_unused)
+    {
       _g_module_close (module->handle, FALSE);
+      g_module_free_symbols (module);
       g_free (module->file_name);
       
       g_free (module);
@@ -354,31 +495,23 @@ g_module_error (void)
   return g_static_private_get (&module_error_private);
 }
 
-gboolean
-g_module_symbol (GModule	*module,
-		 const gchar	*symbol_name,
-		 gpointer	*symbol)
+static gpointer
+g_module_resolve (GModule     *module,
+		  const gchar *symbol_name)
 {
+  gpointer symbol;
   gchar *module_error;
 
-  if (symbol)
-    *symbol = NULL;
-  SUPPORT_OR_RETURN (FALSE);
-  
-  g_return_val_if_fail (module != NULL, FALSE);
-  g_return_val_if_fail (symbol_name != NULL, FALSE);
-  g_return_val_if_fail (symbol != NULL, FALSE);
-  
 #ifdef	G_MODULE_NEED_USCORE
   {
     gchar *name;
 
     name = g_strconcat ("_", symbol_name, NULL);
-    *symbol = _g_module_symbol (module->handle, name);
+    symbol = _g_module_symbol (module->handle, name);
     g_free (name);
   }
 #else	/* !G_MODULE_NEED_USCORE */
-  *symbol = _g_module_symbol (module->handle, symbol_name);
+  symbol = _g_module_symbol (module->handle, symbol_name);
 #endif	/* !G_MODULE_NEED_USCORE */
   
   module_error = g_module_error ();
@@ -389,11 +522,152 @@ g_module_symbol (GModule	*module,
       error = g_strconcat ("`", symbol_name, "': ", module_error, NULL);
       g_module_set_error (error);
       g_free (error);
-      *symbol = NULL;
 
-      return FALSE;
+      return NULL;
+    }
+
+  return symbol;
+}
+
+static void
+g_module_cache_symbol (GModule	   *module,
+		       const gchar *symbol_name,
+		       gpointer	    symbol)
+{
+  /* callers hold the writer lock of module_symbols_lock */
+  if (!module->symbols)
+    module->symbols = g_hash_table_new (g_str_hash, g_str_equal);
+  else if (g_hash_table_lookup (module->symbols, symbol_name))
+    return;
+
+  g_hash_table_insert (module->symbols, g_strdup (symbol_name), symbol);
+}
+
+static void
+g_module_free_symbol_name (gpointer key,
+			   gpointer value,
+			   gpointer user_data)
+{
+  g_free (key);
+}
+
+static void
+g_module_free_symbols (GModule *module)
+{
+  g_static_rw_lock_writer_lock (&module_symbols_lock);
+  if (module->symbols)
+    {
+      g_hash_table_foreach (module->symbols, g_module_free_symbol_name, NULL);
+      g_hash_table_destroy (module->symbols);
+      module->symbols = NULL;
     }
+  g_static_rw_lock_writer_unlock (&module_symbols_lock);
+}
+
+gboolean
+g_module_symbol (GModule	*module,
+		 const gchar	*symbol_name,
+		 gpointer	*symbol)
+{
+  if (symbol)
+    *symbol = NULL;
+  SUPPORT_OR_RETURN (FALSE);
+  
+  g_return_val_if_fail (module != NULL, FALSE);
+  g_return_val_if_fail (symbol_name != NULL, FALSE);
+  g_return_val_if_fail (symbol != NULL, FALSE);
   
+  g_static_rw_lock_reader_lock (&module_symbols_lock);
+  if (module->symbols)
+    *symbol = g_hash_table_lookup (module->symbols, symbol_name);
+  g_static_rw_lock_reader_unlock (&module_symbols_lock);
+  if (*symbol)
+    return TRUE;
+
+  *symbol = g_module_resolve (module, symbol_name);
+  if (g_module_error ())
+    return FALSE;
+
+  if (*symbol)
+    {
+      g_static_rw_lock_writer_lock (&module_symbols_lock);
+      g_module_cache_symbol (module, symbol_name, *symbol);
+      g_static_rw_lock_writer_unlock (&module_symbols_lock);
+    }
+  
+  return TRUE;
+}
+
+gboolean
+g_module_symbols (GModule	 *module,
+		  const gchar	**symbol_names,
+		  gpointer	 *symbols,
+		  guint		  n_symbols)
+{
+  gboolean *resolved;
+  guint n_resolved = 0;
+  guint i;
+
+  if (symbols)
+    for (i = 0; i < n_symbols; i++)
+      symbols[i] = NULL;
+  SUPPORT_OR_RETURN (FALSE);
+
+  g_return_val_if_fail (module != NULL, FALSE);
+  g_return_val_if_fail (symbol_names != NULL || n_symbols == 0, FALSE);
+  g_return_val_if_fail (symbols != NULL || n_symbols == 0, FALSE);
+
+  for (i = 0; i < n_symbols; i++)
+    g_return_val_if_fail (symbol_names[i] != NULL, FALSE);
+
+  if (!n_symbols)
+    return TRUE;
+
+  /* pick up everything that is already cached with a single pass
+   * under the reader lock
+   */
+  g_static_rw_lock_reader_lock (&module_symbols_lock);
+  if (module->symbols)
+    g_hash_table_lookup_many (module->symbols, (gconstpointer*) symbol_names,
+			      symbols, n_symbols);
+  g_static_rw_lock_reader_unlock (&module_symbols_lock);
+
+  /* resolve the rest, the vtable is filled in completely or not at all */
+  resolved = g_new0 (gboolean, n_symbols);
+  for (i = 0; i < n_symbols; i++)
+    if (!symbols[i])
+      {
+	symbols[i] = g_module_resolve (module, symbol_names[i]);
+	if (g_module_error ())
+	  break;
+	if (symbols[i])
+	  {
+	    resolved[i] = TRUE;
+	    n_resolved++;
+	  }
+      }
+
+  /* and enter the newly resolved symbols with a single writer lock */
+  if (n_resolved)
+    {
+      guint j;
+
+      g_static_rw_lock_writer_lock (&module_symbols_lock);
+      for (j = 0; j < n_symbols; j++)
+	if (resolved[j])
+	  g_module_cache_symbol (module, symbol_names[j], symbols[j]);
+      g_static_rw_lock_writer_unlock (&module_symbols_lock);
+    }
+  g_free (resolved);
+
+  if (i < n_symbols)
+    {
+      for (i = 0; i < n_symbols; i++)
+	symbols[i] = NULL;
+
+      return FALSE;
+    }
+
   return TRUE;
 }
 
@@ -50,9 +50,23 @@ typedef enum
 } GModuleFlags;
 
 typedef	struct _GModule			 GModule;
+typedef struct _GModuleLoad		 GModuleLoad;
 typedef const gchar* (*GModuleCheckInit) (GModule	*module);
 typedef void	     (*GModuleUnload)	 (GModule	*module);
 
+/* one entry of g_module_open_many(), only `file_name' is filled in by
+ * the caller.  `error' is newly allocated and needs to be g_free()d,
+ * `seconds' is the wall clock time spent opening the module, including
+ * its g_module_check_init() function.
+ */
+struct _GModuleLoad
+{
+  const gchar	*file_name;
+  GModule	*module;
+  gchar		*error;
+  gdouble	 seconds;
+};
+
 /* return TRUE if dynamic module loading is supported */
 gboolean	g_module_supported	   (void);
 
@@ -60,6 +74,17 @@ gboolean	g_module_supported	   (void);
 GModule*	g_module_open		   (const gchar		*file_name,
 					    GModuleFlags	 flags);
 
+/* open `n_loads' modules concurrently on a thread pool of up to
+ * `max_threads' threads (0 for one per processor) and wait for all of
+ * them, returns the number of modules opened.  without threads support
+ * they are opened one after another.  note that g_module_check_init()
+ * of different modules may run at the same time.
+ */
+guint		g_module_open_many	   (GModuleLoad		*loads,
+					    guint		 n_loads,
+					    GModuleFlags	 flags,
+					    guint		 max_threads);
+
 /* close a previously opened module, returns TRUE on success */
 gboolean	g_module_close		   (GModule		*module);
 
@@ -74,6 +99,16 @@ gboolean	g_module_symbol		   (GModule		*module,
 					    const gchar		*symbol_name,
 					    gpointer		*symbol);
 
+/* retrive `n_symbols' symbol pointers at once, e.g. to fill in a vtable.
+ * returns TRUE if all of them were found, otherwise `symbols' is
+ * cleared and g_module_error() names the first missing symbol.
+ * resolved symbols are cached per module, for g_module_symbol() as well.
+ */
+gboolean	g_module_symbols	   (GModule		*module,
+					    const gchar	       **symbol_names,
+					    gpointer		*symbols,
+					    guint		 n_symbols);
+
 /* retrive the file name from an existing module */
 gchar*		g_module_name		   (GModule		*module);
 
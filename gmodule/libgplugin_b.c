@@ -36,17 +36,31 @@ LibMain(void         *hinstDll,
 }
 #endif /* NATIVE_WIN32 && __LCC__ */
 
+G_MODULE_EXPORT guint gplugin_b_n_inits = 0;
+G_MODULE_EXPORT gboolean gplugin_b_ready = FALSE;
+
 G_MODULE_EXPORT const gchar*
 g_module_check_init (GModule *module)
 {
+  GTimer *timer;
+
   g_print ("GPluginB: check-init\n");
 
+  /* take a while, so testgmodule's threads opening us overlap */
+  gplugin_b_n_inits++;
+  timer = g_timer_new ();
+  while (g_timer_elapsed (timer, NULL) < 0.1)
+    ;
+  g_timer_destroy (timer);
+  gplugin_b_ready = TRUE;
+
   return NULL;
 }
 
 G_MODULE_EXPORT void
 g_module_unload (GModule *module)
 {
+  gplugin_b_ready = FALSE;
   g_print ("GPluginB: unloaded\n");
 }
 
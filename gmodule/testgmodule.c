@@ -40,6 +40,34 @@ typedef	void (*GModuleFunc) (GModule *);
 
 static SimpleFunc plugin_clash_func = NULL;
 
+typedef struct
+{
+  gchar *file_name;
+  GModule *module;
+  gboolean ready;
+} TestOpen;
+
+static GMutex *test_open_mutex;
+static GCond *test_open_cond;
+static guint test_open_done = 0;
+
+static void
+test_open_func (gpointer data)
+{
+  TestOpen *open = data;
+  gboolean *ready;
+
+  open->module = g_module_open (open->file_name, G_MODULE_BIND_LAZY);
+  if (open->module &&
+      g_module_symbol (open->module, "gplugin_b_ready", (gpointer) &ready))
+    open->ready = *ready;
+
+  g_mutex_lock (test_open_mutex);
+  test_open_done++;
+  g_cond_signal (test_open_cond);
+  g_mutex_unlock (test_open_mutex);
+}
+
 int
 main (int   arg,
       char *argv[])
@@ -50,6 +78,10 @@ main (int   arg,
   SimpleFunc f_a, f_b, f_self;
   GModuleFunc gmod_f;
 
+#ifdef G_THREADS_ENABLED
+  g_thread_init (NULL);
+#endif
+
   string = g_get_current_dir ();
   g_print ("testgmodule (%s):\n", string);
 
@@ -83,6 +115,51 @@ main (int   arg,
       return 1;
     }
   g_print ("retrived symbol `%s' as %p\n", string, f_self);
+  /* open B from two threads at once, neither may get it before its
+   * g_module_check_init() is done, which runs only once
+   */
+  {
+    TestOpen opens[2];
+    guint *n_inits;
+    guint i;
+
+    g_print ("load plugin from \"%s\" in 2 threads\n", plugin_b);
+    test_open_mutex = g_mutex_new ();
+    test_open_cond = g_cond_new ();
+    for (i = 0; i < 2; i++)
+      {
+	opens[i].file_name = plugin_b;
+	opens[i].module = NULL;
+	opens[i].ready = FALSE;
+	if (!g_thread_create (test_open_func, &opens[i]))
+	  test_open_func (&opens[i]);
+      }
+    g_mutex_lock (test_open_mutex);
+    while (test_open_done < 2)
+      g_cond_wait (test_open_cond, test_open_mutex);
+    g_mutex_unlock (test_open_mutex);
+
+    if (!opens[0].module || opens[0].module != opens[1].module)
+      {
+	g_print ("error: %s\n", g_module_error ());
+	return 1;
+      }
+    if (!opens[0].ready || !opens[1].ready ||
+	!g_module_symbol (opens[0].module, "gplugin_b_n_inits", (gpointer) &n_inits) ||
+	*n_inits != 1)
+      {
+	g_print ("error: plugin B handed out before its initialization\n");
+	return 1;
+      }
+    g_module_close (opens[0].module);
+    g_module_close (opens[1].module);
+    if (test_open_mutex)
+      {
+	g_mutex_free (test_open_mutex);
+	g_cond_free (test_open_cond);
+      }
+  }
+
   g_print ("load plugin from \"%s\"\n", plugin_a);
   module_a = g_module_open (plugin_a, G_MODULE_BIND_LAZY);
   if (!module_a)
@@ -98,6 +175,34 @@ main (int   arg,
       return 1;
     }
 
+  /* open both plugins again at once, together with a missing one,
+   * which just hands out new references to the same modules
+   */
+  {
+    GModuleLoad loads[3];
+    guint i;
+
+    loads[0].file_name = plugin_a;
+    loads[1].file_name = plugin_b;
+    loads[2].file_name = "libgplugin_nonexisting.so";
+    g_print ("load 3 plugins at once\n");
+    if (g_module_open_many (loads, 3, G_MODULE_BIND_LAZY, 0) != 2 ||
+	loads[0].module != module_a || loads[1].module != module_b ||
+	loads[2].module || !loads[2].error)
+      {
+	g_print ("error: %s\n", g_module_error ());
+	return 1;
+      }
+    for (i = 0; i < 3; i++)
+      {
+	g_print ("  %s: %s\n", g_basename (loads[i].file_name),
+		 loads[i].error ? loads[i].error : "ok");
+	if (loads[i].module)
+	  g_module_close (loads[i].module);
+	g_free (loads[i].error);
+      }
+  }
+
   /* get plugin specific symbols and call them
    */
   string = "gplugin_a_func";
@@ -186,6 +291,37 @@ main (int   arg,
   gmod_f (module_b);
   g_print ("}\n");
 
+  /* retrive a vtable of symbols from A at once, twice to go through
+   * the symbol cache
+   */
+  {
+    const gchar *names[] = { "gplugin_a_func", "gplugin_clash_func", "g_clash_func" };
+    gpointer vtable[3];
+    guint i;
+
+    for (i = 0; i < 2; i++)
+      {
+	g_print ("retrive 3 symbols at once from \"%s\"\n", g_basename (g_module_name (module_a)));
+	if (!g_module_symbols (module_a, names, vtable, 3))
+	  {
+	    g_print ("error: %s\n", g_module_error ());
+	    return 1;
+	  }
+	if (vtable[1] != (gpointer) f_a)
+	  {
+	    g_print ("error: vtable entry differs from g_module_symbol()\n");
+	    return 1;
+	  }
+      }
+    names[2] = "gplugin_nonexisting_func";
+    if (g_module_symbols (module_a, names, vtable, 3) || vtable[0] != NULL)
+      {
+	g_print ("error: missing symbol went unnoticed\n");
+	return 1;
+      }
+    g_print ("missing symbol reported: %s\n", g_module_error ());
+  }
+
   
   /* unload plugins
    */
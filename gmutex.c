@@ -32,8 +32,21 @@
  * MT safe
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "glib.h"
 
+#ifdef HAVE_SCHED_YIELD
+#include <sched.h>
+#endif
+
+#ifdef NATIVE_WIN32
+#define STRICT
+#include <windows.h>
+#endif
+
 typedef struct _GStaticPrivateNode GStaticPrivateNode;
 
 struct _GStaticPrivateNode
@@ -69,10 +82,30 @@ GThreadFunctions g_thread_functions_for_glib_use = {
 
 /* Local data */
 
+static GThreadCreateFunc g_thread_create_impl = NULL;
 static GMutex   *g_mutex_protect_static_mutex_allocation = NULL;
 static GMutex   *g_thread_specific_mutex = NULL;
 static GPrivate *g_thread_specific_private = NULL;
 
+/* Every thread keeps the data of its GStaticPrivates in an array,
+ * indexed by the keys' index.  The array is set on
+ * g_thread_specific_private so that it gets freed with the thread, and
+ * with compiler supported thread local storage it is also kept in
+ * g_thread_specific_array, to get to it without calling through the
+ * thread vtable.
+ */
+#ifdef HAVE_TLS
+static __thread GArray *g_thread_specific_array = NULL;
+#  define G_THREAD_SPECIFIC_GET()	(g_thread_specific_array)
+#  define G_THREAD_SPECIFIC_SET(array)	G_STMT_START{			\
+     g_thread_specific_array = (array);					\
+     g_private_set (g_thread_specific_private, (array));		\
+   }G_STMT_END
+#else
+#  define G_THREAD_SPECIFIC_GET()	((GArray*) g_private_get (g_thread_specific_private))
+#  define G_THREAD_SPECIFIC_SET(array)	g_private_set (g_thread_specific_private, (array))
+#endif
+
 /* This must be called only once, before any threads are created.
  * It will only be called from g_thread_init() in -lgthread.
  */
@@ -96,6 +129,37 @@ g_mutex_init (void)
   g_thread_specific_mutex = g_mutex_new();
 }
 
+/* This will only be called from g_thread_init() in -lgthread, with
+ * the thread creation function of its default implementation.
+ */
+void
+g_thread_create_init (GThreadCreateFunc create_func)
+{
+  g_thread_create_impl = create_func;
+}
+
+gboolean
+g_thread_create (GThreadFunc func,
+		 gpointer    data)
+{
+  g_return_val_if_fail (func != NULL, FALSE);
+
+  if (!g_thread_supported () || !g_thread_create_impl)
+    return FALSE;
+
+  return g_thread_create_impl (func, data);
+}
+
+void
+g_thread_yield (void)
+{
+#if defined (HAVE_SCHED_YIELD)
+  sched_yield ();
+#elif defined (NATIVE_WIN32)
+  Sleep (0);
+#endif
+}
+
 GMutex *
 g_static_mutex_get_mutex_impl (GMutex** mutex)
 {
@@ -118,15 +182,17 @@ gpointer
 g_static_private_get (GStaticPrivate *private_key)
 {
   GArray *array;
+  guint index;
 
-  array = g_private_get (g_thread_specific_private);
+  array = G_THREAD_SPECIFIC_GET ();
   if (!array)
     return NULL;
 
-  if (!private_key->index)
+  index = g_atomic_int_get ((gint*) &private_key->index);
+  if (!index)
     return NULL;
-  else if (private_key->index <= array->len)
-    return g_array_index (array, GStaticPrivateNode, private_key->index - 1).data;
+  else if (index <= array->len)
+    return g_array_index (array, GStaticPrivateNode, index - 1).data;
   else
     return NULL;
 }
@@ -139,28 +205,34 @@ g_static_private_set (GStaticPrivate *private_key,
   GArray *array;
   static guint next_index = 0;
   GStaticPrivateNode *node;
+  guint index;
   
-  array = g_private_get (g_thread_specific_private);
+  array = G_THREAD_SPECIFIC_GET ();
   if (!array)
     {
       array = g_array_new (FALSE, TRUE, sizeof (GStaticPrivateNode));
-      g_private_set (g_thread_specific_private, array);
+      G_THREAD_SPECIFIC_SET (array);
     }
 
-  if (!private_key->index)
+  index = g_atomic_int_get ((gint*) &private_key->index);
+  if (!index)
     {
       g_mutex_lock (g_thread_specific_mutex);
 
-      if (!private_key->index)
-	private_key->index = ++next_index;
+      index = private_key->index;
+      if (!index)
+	{
+	  index = ++next_index;
+	  g_atomic_int_set ((gint*) &private_key->index, index);
+	}
 
       g_mutex_unlock (g_thread_specific_mutex);
     }
 
-  if (private_key->index > array->len)
-    g_array_set_size (array, private_key->index);
+  if (index > array->len)
+    g_array_set_size (array, index);
 
-  node = &g_array_index (array, GStaticPrivateNode, private_key->index - 1);
+  node = &g_array_index (array, GStaticPrivateNode, index - 1);
   if (node->destroy)
     {
       gpointer ddata = node->data;
@@ -181,6 +253,10 @@ g_static_private_set (GStaticPrivate *private_key,
 static void
 g_static_private_free_data (gpointer data)
 {
+#ifdef HAVE_TLS
+  g_thread_specific_array = NULL;
+#endif
+
   if (data)
     {
       GArray* array = data;
@@ -195,6 +271,262 @@ g_static_private_free_data (gpointer data)
     }
 }
 
+/* A GStaticRWLock's state counts its readers in units of
+ * G_RW_LOCK_READER and has a bit for the writer, and one for writers
+ * waiting to get in, which keeps new readers out (writers take
+ * precedence).  Uncontended readers and writers only compare and
+ * swap the state; the mutex and conditions are for whoever has to
+ * sleep, and are only touched on the way out if somebody does.
+ * The read-modify-write operations are full barriers, so a thread
+ * that lets go of the lock sees the sleeper counted before it looked
+ * at the state.  When the atomic operations would take a lock of
+ * their own, the state is kept under the mutex instead.
+ */
+#ifdef G_ATOMIC_LOCK_FREE
+#  define G_RW_LOCK_HAVE_ATOMICS
+#  define G_RW_GET(ptr)			g_atomic_int_get (ptr)
+#  define G_RW_ADD(ptr, val)		g_atomic_int_add ((ptr), (val))
+#  define G_RW_ADD_FETCH(ptr, val)	(g_atomic_int_exchange_and_add ((ptr), (val)) + (val))
+#  define G_RW_OR(ptr, val)		g_static_rw_lock_update ((ptr), ~0, (val))
+#  define G_RW_AND(ptr, val)		g_static_rw_lock_update ((ptr), (val), 0)
+#  define G_RW_CAS(ptr, old, new)	(g_atomic_int_compare_and_exchange ((ptr), (old), (new)) || \
+					 ((old) = g_atomic_int_get (ptr), FALSE))
+
+/* returns the state with the bits of "and" kept and those of "or" set */
+static inline gint
+g_static_rw_lock_update (gint *state,
+			 gint  and,
+			 gint  or)
+{
+  gint old, new;
+
+  do
+    {
+      old = g_atomic_int_get (state);
+      new = (old & and) | or;
+    }
+  while (!g_atomic_int_compare_and_exchange (state, old, new));
+
+  return new;
+}
+#else
+/* only touched with the lock's mutex held */
+#  define G_RW_GET(ptr)			(*(ptr))
+#  define G_RW_ADD(ptr, val)		(*(ptr) += (val))
+#  define G_RW_ADD_FETCH(ptr, val)	(*(ptr) += (val))
+#  define G_RW_OR(ptr, val)		(*(ptr) |= (val))
+#  define G_RW_AND(ptr, val)		(*(ptr) &= (val))
+#  define G_RW_CAS(ptr, old, new)	(*(ptr) == (old) ? (*(ptr) = (new), TRUE) \
+						 : ((old) = *(ptr), FALSE))
+#endif
+
+#define G_RW_LOCK_WRITER		(1)
+#define G_RW_LOCK_WRITER_WAITING	(2)
+#define G_RW_LOCK_READER		(4)
+
+static inline gboolean
+g_static_rw_lock_try_read (GStaticRWLock *lock)
+{
+  gint state = G_RW_GET (&lock->state);
+
+  while (!(state & (G_RW_LOCK_WRITER | G_RW_LOCK_WRITER_WAITING)))
+    if (G_RW_CAS (&lock->state, state, state + G_RW_LOCK_READER))
+      return TRUE;
+
+  return FALSE;
+}
+
+/* HOLDS: lock->mutex */
+static void
+g_static_rw_lock_signal (GStaticRWLock *lock)
+{
+  if (lock->want_to_write)
+    g_cond_signal (lock->write_cond);
+  else if (lock->read_cond)
+    g_cond_broadcast (lock->read_cond);
+}
+
+/* HOLDS: lock->mutex */
+static void
+g_static_rw_lock_wait (GStaticRWLock *lock,
+		       GCond	    **cond)
+{
+  if (!*cond)
+    *cond = g_cond_new ();
+  g_cond_wait (*cond, g_static_mutex_get_mutex (&lock->mutex));
+}
+
+/* called with the new state, once the lock has been let go of */
+static inline void
+g_static_rw_lock_released (GStaticRWLock *lock,
+			   gint		  state)
+{
+#ifdef G_RW_LOCK_HAVE_ATOMICS
+  if (state < G_RW_LOCK_READER && G_RW_GET (&lock->n_sleeping))
+    {
+      g_static_mutex_lock (&lock->mutex);
+      g_static_rw_lock_signal (lock);
+      g_static_mutex_unlock (&lock->mutex);
+    }
+#else
+  if (state < G_RW_LOCK_READER && lock->n_sleeping)
+    g_static_rw_lock_signal (lock);
+  g_static_mutex_unlock (&lock->mutex);
+#endif
+}
+
+void
+g_static_rw_lock_reader_lock (GStaticRWLock *lock)
+{
+  g_return_if_fail (lock != NULL);
+
+  if (!g_thread_supported ())
+    return;
+
+#ifdef G_RW_LOCK_HAVE_ATOMICS
+  if (g_static_rw_lock_try_read (lock))
+    return;
+#endif
+
+  g_static_mutex_lock (&lock->mutex);
+  G_RW_ADD (&lock->n_sleeping, 1);
+  while (!g_static_rw_lock_try_read (lock))
+    g_static_rw_lock_wait (lock, &lock->read_cond);
+  G_RW_ADD (&lock->n_sleeping, -1);
+  g_static_mutex_unlock (&lock->mutex);
+}
+
+gboolean
+g_static_rw_lock_reader_trylock (GStaticRWLock *lock)
+{
+  gboolean result;
+
+  g_return_val_if_fail (lock != NULL, FALSE);
+
+  if (!g_thread_supported ())
+    return TRUE;
+
+#ifdef G_RW_LOCK_HAVE_ATOMICS
+  result = g_static_rw_lock_try_read (lock);
+#else
+  g_static_mutex_lock (&lock->mutex);
+  result = g_static_rw_lock_try_read (lock);
+  g_static_mutex_unlock (&lock->mutex);
+#endif
+
+  return result;
+}
+
+void
+g_static_rw_lock_reader_unlock (GStaticRWLock *lock)
+{
+  gint state;
+
+  g_return_if_fail (lock != NULL);
+
+  if (!g_thread_supported ())
+    return;
+
+#ifndef G_RW_LOCK_HAVE_ATOMICS
+  g_static_mutex_lock (&lock->mutex);
+#endif
+  state = G_RW_ADD_FETCH (&lock->state, -G_RW_LOCK_READER);
+  g_static_rw_lock_released (lock, state);
+}
+
+void
+g_static_rw_lock_writer_lock (GStaticRWLock *lock)
+{
+  gint state;
+
+  g_return_if_fail (lock != NULL);
+
+  if (!g_thread_supported ())
+    return;
+
+#ifdef G_RW_LOCK_HAVE_ATOMICS
+  state = 0;
+  if (G_RW_CAS (&lock->state, state, G_RW_LOCK_WRITER))
+    return;
+#endif
+
+  g_static_mutex_lock (&lock->mutex);
+  G_RW_ADD (&lock->n_sleeping, 1);
+  if (!lock->want_to_write++)
+    G_RW_OR (&lock->state, G_RW_LOCK_WRITER_WAITING);
+  for (;;)
+    {
+      state = G_RW_GET (&lock->state);
+      if (state == G_RW_LOCK_WRITER_WAITING)
+	{
+	  if (G_RW_CAS (&lock->state, state, state | G_RW_LOCK_WRITER))
+	    break;
+	}
+      else
+	g_static_rw_lock_wait (lock, &lock->write_cond);
+    }
+  if (!--lock->want_to_write)
+    G_RW_AND (&lock->state, ~G_RW_LOCK_WRITER_WAITING);
+  G_RW_ADD (&lock->n_sleeping, -1);
+  g_static_mutex_unlock (&lock->mutex);
+}
+
+gboolean
+g_static_rw_lock_writer_trylock (GStaticRWLock *lock)
+{
+  gint state = 0;
+  gboolean result;
+
+  g_return_val_if_fail (lock != NULL, FALSE);
+
+  if (!g_thread_supported ())
+    return TRUE;
+
+#ifdef G_RW_LOCK_HAVE_ATOMICS
+  result = G_RW_CAS (&lock->state, state, G_RW_LOCK_WRITER);
+#else
+  g_static_mutex_lock (&lock->mutex);
+  result = G_RW_CAS (&lock->state, state, G_RW_LOCK_WRITER);
+  g_static_mutex_unlock (&lock->mutex);
+#endif
+
+  return result;
+}
+
+void
+g_static_rw_lock_writer_unlock (GStaticRWLock *lock)
+{
+  gint state;
+
+  g_return_if_fail (lock != NULL);
+
+  if (!g_thread_supported ())
+    return;
+
+#ifndef G_RW_LOCK_HAVE_ATOMICS
+  g_static_mutex_lock (&lock->mutex);
+#endif
+  state = G_RW_AND (&lock->state, ~G_RW_LOCK_WRITER);
+  g_static_rw_lock_released (lock, state);
+}
+
+void
+g_static_rw_lock_free (GStaticRWLock *lock)
+{
+  g_return_if_fail (lock != NULL);
+
+  if (lock->read_cond)
+    {
+      g_cond_free (lock->read_cond);
+      lock->read_cond = NULL;
+    }
+  if (lock->write_cond)
+    {
+      g_cond_free (lock->write_cond);
+      lock->write_cond = NULL;
+    }
+}
+
 static void
 g_thread_fail (void)
 {
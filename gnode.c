@@ -31,6 +31,7 @@
  * MT safe
  */
 
+#include <string.h>
 #include "glib.h"
 
 /* node allocation
@@ -43,6 +44,7 @@ struct _GAllocator /* from gmem.c */
   guint          type : 4;
   GAllocator    *last;
   GMemChunk     *mem_chunk;
+  GArena        *arena;
   GNode         *free_nodes; /* implementation specific */
 };
 
@@ -66,7 +68,12 @@ g_node_validate_allocator (GAllocator *allocator)
 	}
     }
 
-  if (!allocator->mem_chunk)
+  if (allocator->arena)
+    {
+      /* nodes freed during an earlier push went away with the arena */
+      allocator->free_nodes = NULL;
+    }
+  else if (!allocator->mem_chunk)
     {
       allocator->mem_chunk = g_mem_chunk_new (allocator->name,
 					      sizeof (GNode),
@@ -105,29 +112,146 @@ g_node_pop_allocator (void)
 }
 
 
+/* Per thread magazines of free nodes, see glist.c. Once threads are
+ * initialized, nodes of the default allocator are handed out from and
+ * freed into the calling thread's magazine without taking
+ * current_allocator_lock.
+ */
+#define NODE_MAGAZINE_SIZE	64
+
+typedef struct _GNodeMagazine GNodeMagazine;
+
+struct _GNodeMagazine
+{
+  GNode *free_nodes;
+  guint  n_free_nodes;
+};
+
+static GAllocator	*default_allocator = NULL;
+static GStaticPrivate	 node_magazine = G_STATIC_PRIVATE_INIT;
+
+/* HOLDS: current_allocator_lock */
+static void
+g_node_magazine_release (GNodeMagazine *magazine,
+			 guint          n_keep)
+{
+  GNode *free_nodes = magazine->free_nodes;
+  GNode *last;
+  guint n;
+
+  if (n_keep)
+    {
+      for (n = 1; n < n_keep; n++)
+	free_nodes = free_nodes->next;
+      last = free_nodes;
+      free_nodes = last->next;
+      last->next = NULL;
+    }
+  else
+    magazine->free_nodes = NULL;
+  magazine->n_free_nodes = n_keep;
+
+  if (free_nodes)
+    {
+      for (last = free_nodes; last->next; last = last->next)
+	;
+      last->next = default_allocator->free_nodes;
+      default_allocator->free_nodes = free_nodes;
+    }
+}
+
+static void
+g_node_magazine_free (gpointer data)
+{
+  GNodeMagazine *magazine = data;
+
+  G_LOCK (current_allocator);
+  g_node_magazine_release (magazine, 0);
+  G_UNLOCK (current_allocator);
+  g_free (magazine);
+}
+
+static inline GNodeMagazine*
+g_node_magazine_get (void)
+{
+  GNodeMagazine *magazine;
+
+  /* unlocked read of current_allocator, see glist.c */
+  if (!g_thread_supported () ||
+      !default_allocator ||
+      current_allocator != default_allocator)
+    return NULL;
+
+  magazine = g_static_private_get (&node_magazine);
+  if (!magazine)
+    {
+      magazine = g_new0 (GNodeMagazine, 1);
+      g_static_private_set (&node_magazine, magazine, g_node_magazine_free);
+    }
+
+  return magazine;
+}
+
+static void
+g_node_magazine_refill (GNodeMagazine *magazine)
+{
+  GNode *node;
+
+  G_LOCK (current_allocator);
+  while (magazine->n_free_nodes < NODE_MAGAZINE_SIZE / 2)
+    {
+      if (default_allocator->free_nodes)
+	{
+	  node = default_allocator->free_nodes;
+	  default_allocator->free_nodes = node->next;
+	}
+      else
+	node = g_chunk_new (GNode, default_allocator->mem_chunk);
+      node->next = magazine->free_nodes;
+      magazine->free_nodes = node;
+      magazine->n_free_nodes++;
+    }
+  G_UNLOCK (current_allocator);
+}
+
 /* --- functions --- */
 GNode*
 g_node_new (gpointer data)
 {
+  GNodeMagazine *magazine = g_node_magazine_get ();
   GNode *node;
 
-  G_LOCK (current_allocator);
-  if (!current_allocator)
+  if (magazine)
     {
-       GAllocator *allocator = g_allocator_new ("GLib default GNode allocator",
-						128);
-       g_node_validate_allocator (allocator);
-       allocator->last = NULL;
-       current_allocator = allocator;
+      if (!magazine->free_nodes)
+	g_node_magazine_refill (magazine);
+      node = magazine->free_nodes;
+      magazine->free_nodes = node->next;
+      magazine->n_free_nodes--;
     }
-  if (!current_allocator->free_nodes)
-    node = g_chunk_new (GNode, current_allocator->mem_chunk);
   else
     {
-      node = current_allocator->free_nodes;
-      current_allocator->free_nodes = node->next;
+      G_LOCK (current_allocator);
+      if (!current_allocator)
+	{
+	  GAllocator *allocator = g_allocator_new ("GLib default GNode allocator",
+						   128);
+	  g_node_validate_allocator (allocator);
+	  allocator->last = NULL;
+	  current_allocator = allocator;
+	  default_allocator = allocator;
+	}
+      if (!current_allocator->free_nodes)
+	node = current_allocator->arena ?
+	  g_arena_alloc (current_allocator->arena, sizeof (GNode)) :
+	  g_chunk_new (GNode, current_allocator->mem_chunk);
+      else
+	{
+	  node = current_allocator->free_nodes;
+	  current_allocator->free_nodes = node->next;
+	}
+      G_UNLOCK (current_allocator);
     }
-  G_UNLOCK (current_allocator);
   
   node->data = data;
   node->next = NULL;
@@ -141,7 +265,9 @@ g_node_new (gpointer data)
 static void
 g_nodes_free (GNode *node)
 {
+  GNodeMagazine *magazine;
   GNode *parent;
+  guint n_nodes = 1;
 
   parent = node;
   while (1)
@@ -149,15 +275,34 @@ g_nodes_free (GNode *node)
       if (parent->children)
 	g_nodes_free (parent->children);
       if (parent->next)
-	parent = parent->next;
+	{
+	  parent = parent->next;
+	  n_nodes++;
+	}
       else
 	break;
     }
   
-  G_LOCK (current_allocator);
-  parent->next = current_allocator->free_nodes;
-  current_allocator->free_nodes = node;
-  G_UNLOCK (current_allocator);
+  magazine = g_node_magazine_get ();
+  if (magazine)
+    {
+      parent->next = magazine->free_nodes;
+      magazine->free_nodes = node;
+      magazine->n_free_nodes += n_nodes;
+      if (magazine->n_free_nodes >= NODE_MAGAZINE_SIZE)
+	{
+	  G_LOCK (current_allocator);
+	  g_node_magazine_release (magazine, NODE_MAGAZINE_SIZE / 2);
+	  G_UNLOCK (current_allocator);
+	}
+    }
+  else
+    {
+      G_LOCK (current_allocator);
+      parent->next = current_allocator->free_nodes;
+      current_allocator->free_nodes = node;
+      G_UNLOCK (current_allocator);
+    }
 }
 
 void
@@ -963,3 +1108,614 @@ g_node_children_foreach (GNode		 *node,
 	}
     }
 }
+
+/* frozen trees
+ */
+typedef struct _GFrozenTreeNode GFrozenTreeNode;
+
+struct _GFrozenTreeNode
+{
+  GNode *node;
+  guint	 size;		/* number of nodes in the subtree, including node */
+  guint	 n_children;
+  guint	 depth;		/* g_node_depth (node) */
+};
+
+struct _GFrozenTree
+{
+  GFrozenTreeNode *nodes;	/* the subtree of nodes[0].node in pre order */
+  guint		   n_nodes;
+  guint		   height;	/* largest depth within the tree */
+  GHashTable	  *index;	/* GNode -> position in nodes + 1 */
+};
+
+#define	G_FROZEN_TREE_IS_LEAF(tree, i)	((tree)->nodes[i].n_children == 0)
+#define	G_FROZEN_TREE_VISIT(tree, i, flags, func, data)			\
+  ((G_FROZEN_TREE_IS_LEAF (tree, i) ?					\
+    ((flags) & G_TRAVERSE_LEAFS) : ((flags) & G_TRAVERSE_NON_LEAFS)) &&	\
+   (func) ((tree)->nodes[i].node, (data)))
+/* whether the children of i are within max_level */
+#define	G_FROZEN_TREE_DESCENDS(tree, i, max_level)			\
+  (!G_FROZEN_TREE_IS_LEAF (tree, i) && (tree)->nodes[i].depth < (max_level))
+
+GFrozenTree*
+g_frozen_tree_new (GNode *root)
+{
+  GFrozenTree *tree;
+  GNode *node;
+  guint *ancestors;
+  guint n_ancestors = 0;
+  guint max_ancestors = 16;
+  guint current, depth;
+  guint i;
+  
+  g_return_val_if_fail (root != NULL, NULL);
+  
+  tree = g_new (GFrozenTree, 1);
+  tree->n_nodes = g_node_n_nodes (root, G_TRAVERSE_ALL);
+  tree->nodes = g_new (GFrozenTreeNode, tree->n_nodes);
+  tree->height = 0;
+  tree->index = g_hash_table_new (g_direct_hash, NULL);
+  
+  /* walk the tree in pre order without recursion, each node's subtree
+   * size is known once we leave it on the way up
+   */
+  ancestors = g_new (guint, max_ancestors);
+  node = root;
+  depth = g_node_depth (root);
+  i = 0;
+  for (;;)
+    {
+      tree->nodes[i].node = node;
+      tree->nodes[i].size = 1;
+      tree->nodes[i].n_children = 0;
+      tree->nodes[i].depth = depth;
+      if (n_ancestors)
+	tree->nodes[ancestors[n_ancestors - 1]].n_children++;
+      g_hash_table_insert (tree->index, node, GUINT_TO_POINTER (i + 1));
+      tree->height = MAX (tree->height, depth);
+      current = i++;
+      
+      if (node->children)
+	{
+	  if (n_ancestors == max_ancestors)
+	    {
+	      max_ancestors *= 2;
+	      ancestors = g_renew (guint, ancestors, max_ancestors);
+	    }
+	  ancestors[n_ancestors++] = current;
+	  node = node->children;
+	  depth++;
+	  continue;
+	}
+      
+      while (node != root && !node->next)
+	{
+	  node = node->parent;
+	  depth--;
+	  current = ancestors[--n_ancestors];
+	  tree->nodes[current].size = i - current;
+	}
+      if (node == root)
+	break;
+      
+      node = node->next;
+    }
+  g_free (ancestors);
+  
+  return tree;
+}
+
+void
+g_frozen_tree_free (GFrozenTree *tree)
+{
+  g_return_if_fail (tree != NULL);
+  
+  g_hash_table_destroy (tree->index);
+  g_free (tree->nodes);
+  g_free (tree);
+}
+
+static inline gboolean
+g_frozen_tree_lookup (GFrozenTree *tree,
+		      GNode	  *node,
+		      guint	  *position)
+{
+  guint i;
+  
+  i = GPOINTER_TO_UINT (g_hash_table_lookup (tree->index, node));
+  if (!i)
+    return FALSE;
+  *position = i - 1;
+  
+  return TRUE;
+}
+
+static void
+g_frozen_tree_traverse_pre_order (GFrozenTree	   *tree,
+				  guint		    root,
+				  GTraverseFlags    flags,
+				  guint		    max_level,
+				  GNodeTraverseFunc func,
+				  gpointer	    data)
+{
+  guint end = root + tree->nodes[root].size;
+  guint i = root;
+  
+  while (i < end)
+    {
+      if (G_FROZEN_TREE_VISIT (tree, i, flags, func, data))
+	return;
+      if (G_FROZEN_TREE_DESCENDS (tree, i, max_level))
+	i++;
+      else
+	i += tree->nodes[i].size;
+    }
+}
+
+static void
+g_frozen_tree_traverse_post_order (GFrozenTree	     *tree,
+				   guint	      root,
+				   GTraverseFlags     flags,
+				   guint	      max_level,
+				   GNodeTraverseFunc  func,
+				   gpointer	      data)
+{
+  guint end = root + tree->nodes[root].size;
+  guint *stack;
+  guint sp = 0;
+  guint i = root;
+  
+  /* the ancestors of i whose subtree hasn't been finished yet */
+  stack = g_new (guint, tree->height - tree->nodes[root].depth + 1);
+  while (i < end)
+    {
+      while (sp && i >= stack[sp - 1] + tree->nodes[stack[sp - 1]].size)
+	{
+	  sp--;
+	  if (G_FROZEN_TREE_VISIT (tree, stack[sp], flags, func, data))
+	    goto out;
+	}
+      
+      if (G_FROZEN_TREE_DESCENDS (tree, i, max_level))
+	stack[sp++] = i++;
+      else
+	{
+	  if (G_FROZEN_TREE_VISIT (tree, i, flags, func, data))
+	    goto out;
+	  i += tree->nodes[i].size;
+	}
+    }
+  while (sp)
+    {
+      sp--;
+      if (G_FROZEN_TREE_VISIT (tree, stack[sp], flags, func, data))
+	goto out;
+    }
+  
+ out:
+  g_free (stack);
+}
+
+static void
+g_frozen_tree_traverse_in_order (GFrozenTree	   *tree,
+				 guint		    root,
+				 GTraverseFlags	    flags,
+				 guint		    max_level,
+				 GNodeTraverseFunc  func,
+				 gpointer	    data)
+{
+  struct {
+    guint    node;
+    guint    next_child;
+    gboolean visited;
+  } *stack;
+  guint sp = 0;
+  
+  stack = g_malloc (sizeof (*stack) * (tree->height - tree->nodes[root].depth + 1));
+  stack[sp].node = root;
+  stack[sp].next_child = root + 1;
+  stack[sp].visited = FALSE;
+  sp++;
+  while (sp)
+    {
+      guint i = stack[sp - 1].node;
+      
+      if (!G_FROZEN_TREE_DESCENDS (tree, i, max_level))
+	{
+	  if (G_FROZEN_TREE_VISIT (tree, i, flags, func, data))
+	    break;
+	  sp--;
+	}
+      else if (stack[sp - 1].next_child > i + 1 && !stack[sp - 1].visited)
+	{
+	  /* the first child is done */
+	  if (G_FROZEN_TREE_VISIT (tree, i, flags, func, data))
+	    break;
+	  stack[sp - 1].visited = TRUE;
+	}
+      else if (stack[sp - 1].next_child < i + tree->nodes[i].size)
+	{
+	  guint child = stack[sp - 1].next_child;
+	  
+	  stack[sp - 1].next_child += tree->nodes[child].size;
+	  stack[sp].node = child;
+	  stack[sp].next_child = child + 1;
+	  stack[sp].visited = FALSE;
+	  sp++;
+	}
+      else
+	sp--;
+    }
+  
+  g_free (stack);
+}
+
+static void
+g_frozen_tree_traverse_level_order (GFrozenTree	      *tree,
+				    guint	       root,
+				    GTraverseFlags     flags,
+				    guint	       max_level,
+				    GNodeTraverseFunc  func,
+				    gpointer	       data)
+{
+  guint *stack;
+  guint sp = 0;
+  
+  if (G_FROZEN_TREE_VISIT (tree, root, flags, func, data) ||
+      !G_FROZEN_TREE_DESCENDS (tree, root, max_level))
+    return;
+  
+  /* like g_node_traverse_children(), all children of a node are
+   * visited before the children's subtrees are, one after the other
+   */
+  stack = g_new (guint, tree->nodes[root].size);
+  stack[sp++] = root;
+  while (sp)
+    {
+      guint parent = stack[--sp];
+      guint end = parent + tree->nodes[parent].size;
+      guint first = sp;
+      guint child;
+      
+      for (child = parent + 1; child < end; child += tree->nodes[child].size)
+	{
+	  if (G_FROZEN_TREE_VISIT (tree, child, flags, func, data))
+	    goto out;
+	  if (G_FROZEN_TREE_DESCENDS (tree, child, max_level))
+	    stack[sp++] = child;
+	}
+      
+      /* reverse the new entries, so the first child gets popped first */
+      for (child = sp; first + 1 < child; first++, child--)
+	{
+	  guint tmp = stack[first];
+	  
+	  stack[first] = stack[child - 1];
+	  stack[child - 1] = tmp;
+	}
+    }
+  
+ out:
+  g_free (stack);
+}
+
+void
+g_frozen_tree_traverse (GFrozenTree	  *tree,
+			GNode		  *root,
+			GTraverseType	   order,
+			GTraverseFlags	   flags,
+			gint		   depth,
+			GNodeTraverseFunc  func,
+			gpointer	   data)
+{
+  guint i, max_level;
+  
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (root != NULL);
+  g_return_if_fail (func != NULL);
+  g_return_if_fail (order <= G_LEVEL_ORDER);
+  g_return_if_fail (flags <= G_TRAVERSE_MASK);
+  g_return_if_fail (depth == -1 || depth > 0);
+  
+  if (!g_frozen_tree_lookup (tree, root, &i))
+    {
+      g_warning ("g_frozen_tree_traverse(): node not in the tree");
+      return;
+    }
+  
+  /* nodes deeper than max_level aren't visited */
+  max_level = depth < 0 ? (guint) -1 : tree->nodes[i].depth + depth - 1;
+  
+  switch (order)
+    {
+    case G_PRE_ORDER:
+      g_frozen_tree_traverse_pre_order (tree, i, flags, max_level, func, data);
+      break;
+    case G_POST_ORDER:
+      g_frozen_tree_traverse_post_order (tree, i, flags, max_level, func, data);
+      break;
+    case G_IN_ORDER:
+      g_frozen_tree_traverse_in_order (tree, i, flags, max_level, func, data);
+      break;
+    case G_LEVEL_ORDER:
+      g_frozen_tree_traverse_level_order (tree, i, flags, max_level, func, data);
+      break;
+    }
+}
+
+guint
+g_frozen_tree_n_nodes (GFrozenTree    *tree,
+		       GNode	      *root,
+		       GTraverseFlags  flags)
+{
+  guint i, end, n = 0;
+  
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (flags <= G_TRAVERSE_MASK, 0);
+  
+  if (!root || !g_frozen_tree_lookup (tree, root, &i))
+    return 0;
+  
+  if (flags == G_TRAVERSE_ALL)
+    return tree->nodes[i].size;
+  
+  for (end = i + tree->nodes[i].size; i < end; i++)
+    if (G_FROZEN_TREE_IS_LEAF (tree, i) ?
+	(flags & G_TRAVERSE_LEAFS) : (flags & G_TRAVERSE_NON_LEAFS))
+      n++;
+  
+  return n;
+}
+
+guint
+g_frozen_tree_depth (GFrozenTree *tree,
+		     GNode	 *node)
+{
+  guint i;
+  
+  g_return_val_if_fail (tree != NULL, 0);
+  
+  if (!node || !g_frozen_tree_lookup (tree, node, &i))
+    return 0;
+  
+  return tree->nodes[i].depth;
+}
+
+guint
+g_frozen_tree_max_height (GFrozenTree *tree,
+			  GNode	      *root)
+{
+  guint i, end, depth, max_depth;
+  
+  g_return_val_if_fail (tree != NULL, 0);
+  
+  if (!root || !g_frozen_tree_lookup (tree, root, &i))
+    return 0;
+  
+  depth = max_depth = tree->nodes[i].depth;
+  for (end = i + tree->nodes[i].size; i < end; i++)
+    max_depth = MAX (max_depth, tree->nodes[i].depth);
+  
+  return max_depth - depth + 1;
+}
+
+guint
+g_frozen_tree_n_children (GFrozenTree *tree,
+			  GNode	      *node)
+{
+  guint i;
+  
+  g_return_val_if_fail (tree != NULL, 0);
+  g_return_val_if_fail (node != NULL, 0);
+  
+  if (!g_frozen_tree_lookup (tree, node, &i))
+    return 0;
+  
+  return tree->nodes[i].n_children;
+}
+
+GNode*
+g_frozen_tree_nth_child (GFrozenTree *tree,
+			 GNode	     *node,
+			 guint	      n)
+{
+  guint i, child, end;
+  
+  g_return_val_if_fail (tree != NULL, NULL);
+  g_return_val_if_fail (node != NULL, NULL);
+  
+  if (!g_frozen_tree_lookup (tree, node, &i) ||
+      n >= tree->nodes[i].n_children)
+    return NULL;
+  
+  end = i + tree->nodes[i].size;
+  for (child = i + 1; n > 0 && child < end; n--)
+    child += tree->nodes[child].size;
+  
+  return tree->nodes[child].node;
+}
+
+/* parallel traversals
+ */
+#define	G_NODE_PARALLEL_GRANULARITY	1024
+
+typedef struct _GNodeParallel GNodeParallel;
+
+struct _GNodeParallel
+{
+  GThreadPool	   *pool;
+  GTraverseFlags    flags;
+  guint		    granularity;
+  GNodeForeachFunc  func;
+  GNodeReduceFunc   reduce_func;
+  GNodeMergeFunc    merge_func;
+  gpointer	    data;
+  GMutex	   *mutex;
+  gpointer	    initial;
+  gpointer	    result;
+  gboolean	    has_result;
+};
+
+/* visits the subtree of `job' in pre order, handing the pending
+ * subtrees closest to it over to the pool whenever `granularity'
+ * nodes have been visited since the last split, so idle workers get
+ * big chunks of work to steal
+ */
+static void
+g_node_parallel_job (gpointer job,
+		     gpointer user_data)
+{
+  GNodeParallel *parallel = user_data;
+  GNode **pending;
+  guint n_pending = 0, first = 0, max_pending = 64;
+  guint n_visited = 0;
+  gpointer result = parallel->initial;
+  gboolean can_split = parallel->pool && g_thread_supported ();
+  
+  pending = g_new (GNode*, max_pending);
+  pending[n_pending++] = job;
+  while (n_pending > first)
+    {
+      GNode *node = pending[--n_pending];
+      GNode *child;
+      
+      if (G_NODE_IS_LEAF (node) ?
+	  (parallel->flags & G_TRAVERSE_LEAFS) :
+	  (parallel->flags & G_TRAVERSE_NON_LEAFS))
+	{
+	  if (parallel->reduce_func)
+	    result = parallel->reduce_func (result, node, parallel->data);
+	  else
+	    parallel->func (node, parallel->data);
+	}
+      
+      /* push the children last to first, so they come off in order */
+      for (child = node->children; child && child->next; child = child->next)
+	;
+      for (; child; child = child->prev)
+	{
+	  if (n_pending == max_pending)
+	    {
+	      if (first > 0)
+		{
+		  g_memmove (pending, pending + first,
+			     sizeof (GNode*) * (n_pending - first));
+		  n_pending -= first;
+		  first = 0;
+		}
+	      else
+		{
+		  max_pending *= 2;
+		  pending = g_renew (GNode*, pending, max_pending);
+		}
+	    }
+	  pending[n_pending++] = child;
+	}
+      
+      if (can_split && ++n_visited >= parallel->granularity &&
+	  n_pending - first > 1)
+	{
+	  g_thread_pool_push (parallel->pool, pending[first++]);
+	  n_visited = 0;
+	}
+    }
+  g_free (pending);
+  
+  if (parallel->reduce_func)
+    {
+      /* every job starts out from `initial', so it is not merged in
+       * once more
+       */
+      g_mutex_lock (parallel->mutex);
+      if (parallel->has_result)
+	parallel->result = parallel->merge_func (parallel->result, result,
+						 parallel->data);
+      else
+	parallel->result = result;
+      parallel->has_result = TRUE;
+      g_mutex_unlock (parallel->mutex);
+    }
+}
+
+static void
+g_node_parallel_run (GNode	   *root,
+		     guint	    max_threads,
+		     GNodeParallel *parallel)
+{
+  if (!parallel->granularity)
+    parallel->granularity = G_NODE_PARALLEL_GRANULARITY;
+  
+  if (g_thread_supported ())
+    {
+      parallel->mutex = g_mutex_new ();
+      parallel->pool = g_thread_pool_new (g_node_parallel_job, parallel,
+					  max_threads);
+      g_thread_pool_push (parallel->pool, root);
+      g_thread_pool_free (parallel->pool, FALSE);
+      g_mutex_free (parallel->mutex);
+    }
+  else
+    {
+      parallel->mutex = NULL;
+      parallel->pool = NULL;
+      g_node_parallel_job (root, parallel);
+    }
+}
+
+void
+g_node_traverse_parallel (GNode		   *root,
+			  GTraverseFlags    flags,
+			  guint		    granularity,
+			  guint		    max_threads,
+			  GNodeForeachFunc  func,
+			  gpointer	    data)
+{
+  GNodeParallel parallel;
+  
+  g_return_if_fail (root != NULL);
+  g_return_if_fail (flags <= G_TRAVERSE_MASK);
+  g_return_if_fail (func != NULL);
+  
+  parallel.flags = flags;
+  parallel.granularity = granularity;
+  parallel.func = func;
+  parallel.reduce_func = NULL;
+  parallel.merge_func = NULL;
+  parallel.data = data;
+  parallel.initial = NULL;
+  parallel.result = NULL;
+  parallel.has_result = FALSE;
+  g_node_parallel_run (root, max_threads, &parallel);
+}
+
+gpointer
+g_node_reduce_parallel (GNode		*root,
+			GTraverseFlags	 flags,
+			guint		 granularity,
+			guint		 max_threads,
+			gpointer	 initial,
+			GNodeReduceFunc	 reduce_func,
+			GNodeMergeFunc	 merge_func,
+			gpointer	 data)
+{
+  GNodeParallel parallel;
+  
+  g_return_val_if_fail (root != NULL, initial);
+  g_return_val_if_fail (flags <= G_TRAVERSE_MASK, initial);
+  g_return_val_if_fail (reduce_func != NULL, initial);
+  g_return_val_if_fail (merge_func != NULL, initial);
+  
+  parallel.flags = flags;
+  parallel.granularity = granularity;
+  parallel.func = NULL;
+  parallel.reduce_func = reduce_func;
+  parallel.merge_func = merge_func;
+  parallel.data = data;
+  parallel.initial = initial;
+  parallel.result = initial;
+  parallel.has_result = FALSE;
+  g_node_parallel_run (root, max_threads, &parallel);
+  
+  return parallel.result;
+}
@@ -0,0 +1,239 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+/* 
+ * MT safe
+ */
+
+#include "glib.h"
+
+
+GQueue*
+g_queue_new (void)
+{
+  GQueue *queue;
+
+  queue = g_new (GQueue, 1);
+  queue->head = NULL;
+  queue->tail = NULL;
+  queue->length = 0;
+
+  return queue;
+}
+
+void
+g_queue_free (GQueue *queue)
+{
+  g_return_if_fail (queue != NULL);
+
+  g_list_free (queue->head);
+  g_free (queue);
+}
+
+void
+g_queue_push_head (GQueue  *queue,
+		   gpointer data)
+{
+  GList *list;
+
+  g_return_if_fail (queue != NULL);
+
+  list = g_list_alloc ();
+  list->data = data;
+  g_queue_push_head_link (queue, list);
+}
+
+void
+g_queue_push_tail (GQueue  *queue,
+		   gpointer data)
+{
+  GList *list;
+
+  g_return_if_fail (queue != NULL);
+
+  list = g_list_alloc ();
+  list->data = data;
+  g_queue_push_tail_link (queue, list);
+}
+
+void
+g_queue_push_head_link (GQueue *queue,
+			GList  *link)
+{
+  g_return_if_fail (queue != NULL);
+  g_return_if_fail (link != NULL);
+  g_return_if_fail (link->prev == NULL);
+  g_return_if_fail (link->next == NULL);
+
+  link->next = queue->head;
+  if (queue->head)
+    queue->head->prev = link;
+  else
+    queue->tail = link;
+  queue->head = link;
+  queue->length++;
+}
+
+void
+g_queue_push_tail_link (GQueue *queue,
+			GList  *link)
+{
+  g_return_if_fail (queue != NULL);
+  g_return_if_fail (link != NULL);
+  g_return_if_fail (link->prev == NULL);
+  g_return_if_fail (link->next == NULL);
+
+  link->prev = queue->tail;
+  if (queue->tail)
+    queue->tail->next = link;
+  else
+    queue->head = link;
+  queue->tail = link;
+  queue->length++;
+}
+
+GList*
+g_queue_pop_head_link (GQueue *queue)
+{
+  GList *node;
+
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  node = queue->head;
+  if (node)
+    {
+      queue->head = node->next;
+      if (queue->head)
+	queue->head->prev = NULL;
+      else
+	queue->tail = NULL;
+      node->next = NULL;
+      queue->length--;
+    }
+
+  return node;
+}
+
+GList*
+g_queue_pop_tail_link (GQueue *queue)
+{
+  GList *node;
+
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  node = queue->tail;
+  if (node)
+    {
+      queue->tail = node->prev;
+      if (queue->tail)
+	queue->tail->next = NULL;
+      else
+	queue->head = NULL;
+      node->prev = NULL;
+      queue->length--;
+    }
+
+  return node;
+}
+
+gpointer
+g_queue_pop_head (GQueue *queue)
+{
+  GList *node;
+  gpointer data = NULL;
+
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  node = g_queue_pop_head_link (queue);
+  if (node)
+    {
+      data = node->data;
+      g_list_free_1 (node);
+    }
+
+  return data;
+}
+
+gpointer
+g_queue_pop_tail (GQueue *queue)
+{
+  GList *node;
+  gpointer data = NULL;
+
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  node = g_queue_pop_tail_link (queue);
+  if (node)
+    {
+      data = node->data;
+      g_list_free_1 (node);
+    }
+
+  return data;
+}
+
+gpointer
+g_queue_peek_head (GQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  return queue->head ? queue->head->data : NULL;
+}
+
+gpointer
+g_queue_peek_tail (GQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, NULL);
+
+  return queue->tail ? queue->tail->data : NULL;
+}
+
+gboolean
+g_queue_is_empty (GQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, TRUE);
+
+  return queue->head == NULL;
+}
+
+guint
+g_queue_get_length (GQueue *queue)
+{
+  g_return_val_if_fail (queue != NULL, 0);
+
+  return queue->length;
+}
+
+void
+g_queue_sort (GQueue	   *queue,
+	      GCompareFunc  compare_func)
+{
+  g_return_if_fail (queue != NULL);
+  g_return_if_fail (compare_func != NULL);
+
+  queue->head = g_list_sort (queue->head, compare_func);
+  queue->tail = g_list_last (queue->head);
+}
@@ -31,8 +31,12 @@
 #include <stdarg.h>
 #include <string.h>
 
+#define G_RELATION_INDEX_KEY_PREALLOC  8
+
 typedef struct _GRealRelation      GRealRelation;
 typedef struct _GRealTuples        GRealTuples;
+typedef struct _GRelationIndex     GRelationIndex;
+typedef struct _GRelationSelect    GRelationSelect;
 
 struct _GRealRelation
 {
@@ -42,10 +46,31 @@ struct _GRealRelation
   GHashTable   *all_tuples;
   GHashTable  **hashed_tuple_tables;
   GMemChunk    *tuple_chunk;
+  GPtrArray    *indexes;
   
   gint count;
 };
 
+/* A composite index maps the values of several fields to the table
+ * of tuples carrying them.  Its keys are vectors whose first slot
+ * points back to the index, so the hash and equality functions, which
+ * get no user data, can find the per-field functions.
+ */
+struct _GRelationIndex
+{
+  gint          n_fields;
+  gint         *fields;
+  GHashFunc    *hash_funcs;
+  GCompareFunc *key_compare_funcs;
+  GHashTable   *table;
+};
+
+struct _GRelationSelect
+{
+  GRelationFunc func;
+  gpointer      user_data;
+};
+
 struct _GRealTuples
 {
   gint      len;
@@ -71,6 +96,42 @@ tuple_hash_2 (gconstpointer v_a)
   return (gulong)a[0] ^ (gulong)a[1];
 }
 
+static gboolean
+tuple_equal_3 (gconstpointer v_a,
+	       gconstpointer v_b)
+{
+  gpointer* a = (gpointer*) v_a;
+  gpointer* b = (gpointer*) v_b;
+  
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+static guint
+tuple_hash_3 (gconstpointer v_a)
+{
+  gpointer* a = (gpointer*) v_a;
+  
+  return (gulong)a[0] ^ (gulong)a[1] ^ (gulong)a[2];
+}
+
+static gboolean
+tuple_equal_4 (gconstpointer v_a,
+	       gconstpointer v_b)
+{
+  gpointer* a = (gpointer*) v_a;
+  gpointer* b = (gpointer*) v_b;
+  
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
+static guint
+tuple_hash_4 (gconstpointer v_a)
+{
+  gpointer* a = (gpointer*) v_a;
+  
+  return (gulong)a[0] ^ (gulong)a[1] ^ (gulong)a[2] ^ (gulong)a[3];
+}
+
 static GHashFunc
 tuple_hash (gint fields)
 {
@@ -78,6 +139,10 @@ tuple_hash (gint fields)
     {
     case 2:
       return tuple_hash_2;
+    case 3:
+      return tuple_hash_3;
+    case 4:
+      return tuple_hash_4;
     default:
       g_error ("no tuple hash for %d", fields);
     }
@@ -92,6 +157,10 @@ tuple_equal (gint fields)
     {
     case 2:
       return tuple_equal_2;
+    case 3:
+      return tuple_equal_3;
+    case 4:
+      return tuple_equal_4;
     default:
       g_error ("no tuple equal for %d", fields);
     }
@@ -111,10 +180,65 @@ g_relation_new (gint fields)
 				      G_ALLOC_AND_FREE);
   rel->all_tuples = g_hash_table_new (tuple_hash (fields), tuple_equal (fields));
   rel->hashed_tuple_tables = g_new0 (GHashTable*, fields);
+  rel->indexes = g_ptr_array_new ();
   
   return (GRelation*) rel;
 }
 
+static guint
+g_relation_index_hash (gconstpointer v_key)
+{
+  gpointer       *key = (gpointer*) v_key;
+  GRelationIndex *index = key[0];
+  guint           h = 0;
+  gint            i;
+  
+  for (i = 0; i < index->n_fields; i += 1)
+    h = (h << 5) - h + index->hash_funcs[i] (key[i + 1]);
+  
+  return h;
+}
+
+static gboolean
+g_relation_index_equal (gconstpointer v_a,
+			gconstpointer v_b)
+{
+  gpointer       *a = (gpointer*) v_a;
+  gpointer       *b = (gpointer*) v_b;
+  GRelationIndex *index = a[0];
+  gint            i;
+  
+  for (i = 0; i < index->n_fields; i += 1)
+    if (!index->key_compare_funcs[i] (a[i + 1], b[i + 1]))
+      return FALSE;
+  
+  return TRUE;
+}
+
+/* fills the lookup key for TUPLE into KEY, which has room for
+ * n_fields + 1 slots
+ */
+static void
+g_relation_index_key (GRelationIndex *index,
+		      gpointer       *tuple,
+		      gpointer       *key)
+{
+  gint i;
+  
+  key[0] = index;
+  for (i = 0; i < index->n_fields; i += 1)
+    key[i + 1] = tuple[index->fields[i]];
+}
+
+static void
+g_relation_index_free_key (gpointer key,
+			   gpointer value,
+			   gpointer user_data)
+{
+  g_hash_table_destroy ((GHashTable*) value);
+  g_free (key);
+}
+
 static void
 g_relation_free_array (gpointer key, gpointer value, gpointer user_data)
 {
@@ -141,6 +265,19 @@ g_relation_destroy (GRelation *relation)
 	    }
 	}
       
+      for (i = 0; i < rel->indexes->len; i += 1)
+	{
+	  GRelationIndex *index = g_ptr_array_index (rel->indexes, i);
+	  
+	  g_hash_table_foreach (index->table, g_relation_index_free_key, NULL);
+	  g_hash_table_destroy (index->table);
+	  g_free (index->fields);
+	  g_free (index->hash_funcs);
+	  g_free (index->key_compare_funcs);
+	  g_free (index);
+	}
+      
+      g_ptr_array_free (rel->indexes, TRUE);
       g_free (rel->hashed_tuple_tables);
       g_free (rel);
     }
@@ -161,6 +298,38 @@ g_relation_index (GRelation   *relation,
   rel->hashed_tuple_tables[field] = g_hash_table_new (hash_func, key_compare_func);
 }
 
+gint
+g_relation_index_fields (GRelation          *relation,
+			 gint                n_fields,
+			 const gint         *fields,
+			 const GHashFunc    *hash_funcs,
+			 const GCompareFunc *key_compare_funcs)
+{
+  GRealRelation  *rel = (GRealRelation *) relation;
+  GRelationIndex *index;
+  gint            i;
+  
+  g_return_val_if_fail (relation != NULL, -1);
+  g_return_val_if_fail (rel->count == 0, -1);
+  g_return_val_if_fail (n_fields > 0 && n_fields <= rel->fields, -1);
+  g_return_val_if_fail (fields != NULL, -1);
+  g_return_val_if_fail (hash_funcs != NULL && key_compare_funcs != NULL, -1);
+  
+  for (i = 0; i < n_fields; i += 1)
+    g_return_val_if_fail (fields[i] >= 0 && fields[i] < rel->fields, -1);
+  
+  index = g_new (GRelationIndex, 1);
+  index->n_fields = n_fields;
+  index->fields = g_memdup (fields, sizeof (gint) * n_fields);
+  index->hash_funcs = g_memdup (hash_funcs, sizeof (GHashFunc) * n_fields);
+  index->key_compare_funcs = g_memdup (key_compare_funcs, sizeof (GCompareFunc) * n_fields);
+  index->table = g_hash_table_new (g_relation_index_hash, g_relation_index_equal);
+  
+  g_ptr_array_add (rel->indexes, index);
+  
+  return rel->indexes->len - 1;
+}
+
 void
 g_relation_insert (GRelation   *relation,
 		   ...)
@@ -203,6 +372,26 @@ g_relation_insert (GRelation   *relation,
       
       g_hash_table_insert (per_key_table, tuple, tuple);
     }
+  
+  for (i = 0; i < rel->indexes->len; i += 1)
+    {
+      GRelationIndex *index = g_ptr_array_index (rel->indexes, i);
+      gpointer       *key = g_new (gpointer, index->n_fields + 1);
+      GHashTable     *per_key_table;
+      
+      g_relation_index_key (index, tuple, key);
+      per_key_table = g_hash_table_lookup (index->table, key);
+      
+      if (per_key_table == NULL)
+	{
+	  per_key_table = g_hash_table_new (tuple_hash (rel->fields), tuple_equal (rel->fields));
+	  g_hash_table_insert (index->table, key, per_key_table);
+	}
+      else
+	g_free (key);
+      
+      g_hash_table_insert (per_key_table, tuple, tuple);
+    }
 }
 
 static void
@@ -236,6 +425,36 @@ g_relation_delete_tuple (gpointer tuple_key,
       g_hash_table_remove (per_key_table, tuple);
     }
   
+  for (j = 0; j < rel->indexes->len; j += 1)
+    {
+      GRelationIndex *index = g_ptr_array_index (rel->indexes, j);
+      gpointer        lookup[G_RELATION_INDEX_KEY_PREALLOC + 1];
+      gpointer       *key = lookup;
+      gpointer        orig_key;
+      GHashTable     *per_key_table;
+      
+      if (index->n_fields > G_RELATION_INDEX_KEY_PREALLOC)
+	key = g_new (gpointer, index->n_fields + 1);
+      
+      g_relation_index_key (index, tuple, key);
+      
+      if (g_hash_table_lookup_extended (index->table, key,
+					&orig_key, (gpointer*) &per_key_table))
+	{
+	  g_hash_table_remove (per_key_table, tuple);
+	  
+	  if (g_hash_table_size (per_key_table) == 0)
+	    {
+	      g_hash_table_remove (index->table, orig_key);
+	      g_hash_table_destroy (per_key_table);
+	      g_free (orig_key);
+	    }
+	}
+      
+      if (key != lookup)
+	g_free (key);
+    }
+  
   g_hash_table_remove (rel->all_tuples, tuple);
   
   rel->count -= 1;
@@ -290,29 +509,24 @@ g_relation_select_tuple (gpointer tuple_key,
   tuples->len += 1;
 }
 
-GTuples*
-g_relation_select (GRelation     *relation,
-		   gconstpointer  key,
-		   gint           field)
+/* the per-key table already knows how many tuples it holds, so the
+ * result is sized up front and filled in a single walk
+ */
+static GTuples*
+g_relation_select_table (GRealRelation *rel,
+			 GHashTable    *key_table)
 {
-  GRealRelation *rel = (GRealRelation *) relation;
-  GHashTable  *table = rel->hashed_tuple_tables[field];
-  GHashTable  *key_table;
   GRealTuples *tuples = g_new0 (GRealTuples, 1);
   gint count;
   
-  g_return_val_if_fail (relation != NULL, NULL);
-  g_return_val_if_fail (table != NULL, NULL);
-  
-  key_table = g_hash_table_lookup (table, key);
+  tuples->width = rel->fields;
   
   if (!key_table)
     return (GTuples*)tuples;
   
-  count = g_relation_count (relation, key, field);
+  count = g_hash_table_size (key_table);
   
   tuples->data = g_malloc (sizeof (gpointer) * rel->fields * count);
-  tuples->width = rel->fields;
   
   g_hash_table_foreach (key_table, g_relation_select_tuple, tuples);
   
@@ -321,6 +535,147 @@ g_relation_select (GRelation     *relation,
   return (GTuples*)tuples;
 }
 
+static void
+g_relation_select_one (gpointer tuple_key,
+		       gpointer tuple_value,
+		       gpointer user_data)
+{
+  GRelationSelect *select = (GRelationSelect*) user_data;
+  
+  select->func ((gpointer*) tuple_value, select->user_data);
+}
+
+static void
+g_relation_select_table_foreach (GHashTable   *key_table,
+				 GRelationFunc func,
+				 gpointer      user_data)
+{
+  GRelationSelect select;
+  
+  if (!key_table)
+    return;
+  
+  select.func = func;
+  select.user_data = user_data;
+  
+  g_hash_table_foreach (key_table, g_relation_select_one, &select);
+}
+
+static GHashTable*
+g_relation_lookup_fields (GRealRelation *rel,
+			  gint           index_id,
+			  gconstpointer *keys)
+{
+  GRelationIndex *index = g_ptr_array_index (rel->indexes, index_id);
+  gpointer        lookup[G_RELATION_INDEX_KEY_PREALLOC + 1];
+  gpointer       *key = lookup;
+  GHashTable     *key_table;
+  
+  if (index->n_fields > G_RELATION_INDEX_KEY_PREALLOC)
+    key = g_new (gpointer, index->n_fields + 1);
+  
+  key[0] = index;
+  memcpy (key + 1, keys, sizeof (gpointer) * index->n_fields);
+  
+  key_table = g_hash_table_lookup (index->table, key);
+  
+  if (key != lookup)
+    g_free (key);
+  
+  return key_table;
+}
+
+GTuples*
+g_relation_select (GRelation     *relation,
+		   gconstpointer  key,
+		   gint           field)
+{
+  GRealRelation *rel = (GRealRelation *) relation;
+  GHashTable  *table;
+  
+  g_return_val_if_fail (relation != NULL, NULL);
+  g_return_val_if_fail (field >= 0 && field < rel->fields, NULL);
+  
+  table = rel->hashed_tuple_tables[field];
+  
+  g_return_val_if_fail (table != NULL, NULL);
+  
+  return g_relation_select_table (rel, g_hash_table_lookup (table, key));
+}
+
+void
+g_relation_select_foreach (GRelation     *relation,
+			   gconstpointer  key,
+			   gint           field,
+			   GRelationFunc  func,
+			   gpointer       user_data)
+{
+  GRealRelation *rel = (GRealRelation *) relation;
+  GHashTable  *table;
+  
+  g_return_if_fail (relation != NULL);
+  g_return_if_fail (field >= 0 && field < rel->fields);
+  g_return_if_fail (func != NULL);
+  
+  table = rel->hashed_tuple_tables[field];
+  
+  g_return_if_fail (table != NULL);
+  
+  g_relation_select_table_foreach (g_hash_table_lookup (table, key), func, user_data);
+}
+
+GTuples*
+g_relation_select_fields (GRelation     *relation,
+			  gint           index,
+			  gconstpointer *keys)
+{
+  GRealRelation *rel = (GRealRelation *) relation;
+  
+  g_return_val_if_fail (relation != NULL, NULL);
+  g_return_val_if_fail (index >= 0 && index < rel->indexes->len, NULL);
+  g_return_val_if_fail (keys != NULL, NULL);
+  
+  return g_relation_select_table (rel, g_relation_lookup_fields (rel, index, keys));
+}
+
+void
+g_relation_select_fields_foreach (GRelation     *relation,
+				  gint           index,
+				  gconstpointer *keys,
+				  GRelationFunc  func,
+				  gpointer       user_data)
+{
+  GRealRelation *rel = (GRealRelation *) relation;
+  
+  g_return_if_fail (relation != NULL);
+  g_return_if_fail (index >= 0 && index < rel->indexes->len);
+  g_return_if_fail (keys != NULL);
+  g_return_if_fail (func != NULL);
+  
+  g_relation_select_table_foreach (g_relation_lookup_fields (rel, index, keys),
+				   func, user_data);
+}
+
+gint
+g_relation_count_fields (GRelation     *relation,
+			 gint           index,
+			 gconstpointer *keys)
+{
+  GRealRelation *rel = (GRealRelation *) relation;
+  GHashTable  *key_table;
+  
+  g_return_val_if_fail (relation != NULL, 0);
+  g_return_val_if_fail (index >= 0 && index < rel->indexes->len, 0);
+  g_return_val_if_fail (keys != NULL, 0);
+  
+  key_table = g_relation_lookup_fields (rel, index, keys);
+  
+  if (!key_table)
+    return 0;
+  
+  return g_hash_table_size (key_table);
+}
+
 gint
 g_relation_count (GRelation     *relation,
 		  gconstpointer  key,
@@ -51,6 +51,10 @@
 #ifdef _MSC_VER
 #include	<io.h>		/* For _read() */
 #endif
+#if defined (HAVE_SYS_MMAN_H) && defined (HAVE_MMAP)
+#include	<sys/mman.h>
+#define	G_SCANNER_USE_MMAP
+#endif
 
 /* --- defines --- */
 #define	to_lower(c)				( \
@@ -63,15 +67,47 @@
 )
 #define	READ_BUFFER_SIZE	(4000)
 
+/* character classes of GScannerCset.table */
+#define	G_CSET_SKIP		(1 << 0)	/* in cset_skip_characters */
+#define	G_CSET_ID_FIRST		(1 << 1)	/* in cset_identifier_first */
+#define	G_CSET_ID_NTH		(1 << 2)	/* in cset_identifier_nth */
+#define	G_CSET_SKIP_FAST	(1 << 3)	/* skip character that can't
+						 * start any other token */
+
+/* symbol hash, g_scanner_key_hash() of the same symbol in scope 0 */
+#define	G_SCANNER_HASH_STEP(h, c)	G_STMT_START {		\
+  guint __g;							\
+  (h) = ((h) << 4) + (guchar) (c);				\
+  __g = (h) & 0xf0000000;					\
+  if (__g)							\
+    (h) ^= __g ^ (__g >> 24);					\
+} G_STMT_END
+#define	G_SCANNER_HASH_SCOPE(h, scope_id)	((h) ^ ((scope_id) * 0x9e3779b1))
+
 
 /* --- typedefs --- */
 typedef	struct	_GScannerKey	GScannerKey;
 
+typedef	struct	_GScannerCset	GScannerCset;
+
 struct	_GScannerKey
 {
   guint		 scope_id;
   gchar		*symbol;
   gpointer	 value;
+  guint		 hash;
+};
+
+/* character classes of the config's character sets, rebuilt when one
+ * of the set pointers changes
+ */
+struct	_GScannerCset
+{
+  const gchar	*skip_characters;
+  const gchar	*identifier_first;
+  const gchar	*identifier_nth;
+  const gchar	*comment_single;
+  guint8	 table[256];
 };
 
 
@@ -123,12 +159,19 @@ static GScannerConfig g_scanner_config_template =
 
 /* --- prototypes --- */
 static inline
+GScannerKey*	g_scanner_lookup_hashed	  (GScanner	*scanner,
+					   guint	 scope_id,
+					   const gchar	*symbol,
+					   guint	 hash);
+static inline
 GScannerKey*	g_scanner_lookup_internal (GScanner	*scanner,
 					   guint	 scope_id,
 					   const gchar	*symbol);
 static gint	g_scanner_key_equal	  (gconstpointer v1,
 					   gconstpointer v2);
 static guint	g_scanner_key_hash	  (gconstpointer v);
+static guint	g_scanner_symbol_hash	  (const gchar	*symbol);
+static void	g_scanner_update_cset	  (GScanner	*scanner);
 static void	g_scanner_get_token_ll	  (GScanner	*scanner,
 					   GTokenType	*token_p,
 					   GTokenValue	*value_p,
@@ -140,8 +183,10 @@ static void	g_scanner_get_token_i	  (GScanner	*scanner,
 					   guint	*line_p,
 					   guint	*position_p);
 
-static guchar	g_scanner_peek_next_char  (GScanner	*scanner);
-static guchar	g_scanner_get_char	  (GScanner	*scanner,
+static gboolean	g_scanner_fill_buffer	  (GScanner	*scanner);
+static void	g_scanner_unmap		  (GScanner	*scanner);
+static inline guchar g_scanner_peek_next_char (GScanner	*scanner);
+static inline guchar g_scanner_get_char	  (GScanner	*scanner,
 					   guint	*line_p,
 					   guint	*position_p);
 static void	g_scanner_msg_handler	  (GScanner	*scanner,
@@ -233,10 +278,69 @@ g_scanner_new (GScannerConfig	*config_templ)
   scanner->scope_id = 0;
   
   scanner->msg_handler = g_scanner_msg_handler;
+
+  scanner->buffer_size = READ_BUFFER_SIZE;
+  scanner->mapping = NULL;
+  scanner->mapping_len = 0;
+  scanner->cset = g_new0 (GScannerCset, 1);
+  g_scanner_update_cset (scanner);
   
   return scanner;
 }
 
+static void
+g_scanner_update_cset (GScanner *scanner)
+{
+  GScannerConfig *config = scanner->config;
+  GScannerCset *cset = scanner->cset;
+  const gchar *c;
+  guint i;
+  
+  cset->skip_characters = config->cset_skip_characters;
+  cset->identifier_first = config->cset_identifier_first;
+  cset->identifier_nth = config->cset_identifier_nth;
+  cset->comment_single = config->cpair_comment_single;
+  
+  memset (cset->table, 0, sizeof (cset->table));
+  for (c = config->cset_skip_characters; c && *c; c++)
+    cset->table[(guchar) *c] |= G_CSET_SKIP;
+  for (c = config->cset_identifier_first; c && *c; c++)
+    cset->table[(guchar) *c] |= G_CSET_ID_FIRST;
+  for (c = config->cset_identifier_nth; c && *c; c++)
+    cset->table[(guchar) *c] |= G_CSET_ID_NTH;
+  
+  /* like strchr(), which finds the terminating 0 of the sets */
+  cset->table[0] = G_CSET_SKIP;
+  if (config->cset_identifier_first)
+    cset->table[0] |= G_CSET_ID_FIRST;
+  if (config->cset_identifier_nth)
+    cset->table[0] |= G_CSET_ID_NTH;
+  
+  /* skip characters that always end up as single character tokens, no
+   * matter how the scan_ flags are set, can be skipped in bulk
+   */
+  for (i = 1; i < 256; i++)
+    if ((cset->table[i] & (G_CSET_SKIP | G_CSET_ID_FIRST)) == G_CSET_SKIP &&
+	!strchr ("/'\".$0123456789", i) &&
+	!(config->cpair_comment_single && config->cpair_comment_single[0] == (gchar) i))
+      cset->table[i] |= G_CSET_SKIP_FAST;
+}
+
+static inline const guint8*
+g_scanner_get_cset (GScanner *scanner)
+{
+  GScannerConfig *config = scanner->config;
+  GScannerCset *cset = scanner->cset;
+  
+  if (cset->skip_characters != config->cset_skip_characters ||
+      cset->identifier_first != config->cset_identifier_first ||
+      cset->identifier_nth != config->cset_identifier_nth ||
+      cset->comment_single != config->cpair_comment_single)
+    g_scanner_update_cset (scanner);
+  
+  return cset->table;
+}
+
 static inline void
 g_scanner_free_value (GTokenType     *token_p,
 		      GTokenValue     *value_p)
@@ -281,6 +385,8 @@ g_scanner_destroy (GScanner	*scanner)
   g_scanner_free_value (&scanner->next_token, &scanner->next_value);
   g_free (scanner->config);
   g_free (scanner->buffer);
+  g_scanner_unmap (scanner);
+  g_free (scanner->cset);
   g_free (scanner);
 }
 
@@ -359,53 +465,62 @@ static guint
 g_scanner_key_hash (gconstpointer v)
 {
   const GScannerKey *key = v;
-  gchar *c;
-  guint h;
   
-  h = key->scope_id;
-  for (c = key->symbol; *c; c++)
-    {
-      guint g;
-      
-      h = (h << 4) + *c;
-      g = h & 0xf0000000;
-      if (g)
-	{
-	  h = h ^ (g >> 24);
-	  h = h ^ g;
-	}
-    }
+  return key->hash;
+}
+
+static guint
+g_scanner_symbol_hash (const gchar *symbol)
+{
+  guint h = 0;
+  
+  for (; *symbol; symbol++)
+    G_SCANNER_HASH_STEP (h, *symbol);
   
   return h;
 }
 
+/* symbol is lower case already for case insensitive scanners, hash
+ * is g_scanner_symbol_hash() of it
+ */
+static inline GScannerKey*
+g_scanner_lookup_hashed (GScanner	*scanner,
+			 guint		 scope_id,
+			 const gchar	*symbol,
+			 guint		 hash)
+{
+  GScannerKey key;
+  
+  key.scope_id = scope_id;
+  key.symbol = (gchar*) symbol;
+  key.hash = G_SCANNER_HASH_SCOPE (hash, scope_id);
+  
+  return g_hash_table_lookup (scanner->symbol_table, &key);
+}
+
 static inline GScannerKey*
 g_scanner_lookup_internal (GScanner	*scanner,
 			   guint	 scope_id,
 			   const gchar	*symbol)
 {
   GScannerKey	*key_p;
-  GScannerKey key;
-  
-  key.scope_id = scope_id;
   
   if (!scanner->config->case_sensitive)
     {
-      gchar *d;
+      gchar *d, *lower;
       const gchar *c;
       
-      key.symbol = g_new (gchar, strlen (symbol) + 1);
-      for (d = key.symbol, c = symbol; *c; c++, d++)
+      lower = g_new (gchar, strlen (symbol) + 1);
+      for (d = lower, c = symbol; *c; c++, d++)
 	*d = to_lower (*c);
       *d = 0;
-      key_p = g_hash_table_lookup (scanner->symbol_table, &key);
-      g_free (key.symbol);
+      key_p = g_scanner_lookup_hashed (scanner, scope_id, lower,
+				       g_scanner_symbol_hash (lower));
+      g_free (lower);
     }
   else
-    {
-      key.symbol = (gchar*) symbol;
-      key_p = g_hash_table_lookup (scanner->symbol_table, &key);
-    }
+    key_p = g_scanner_lookup_hashed (scanner, scope_id, symbol,
+				     g_scanner_symbol_hash (symbol));
   
   return key_p;
 }
@@ -440,6 +555,7 @@ g_scanner_scope_add_symbol (GScanner	*scanner,
 	      c++;
 	    }
 	}
+      key->hash = G_SCANNER_HASH_SCOPE (g_scanner_symbol_hash (key->symbol), scope_id);
       g_hash_table_insert (scanner->symbol_table, key, key);
     }
   else
@@ -678,6 +794,7 @@ g_scanner_input_file (GScanner *scanner,
 
   if (scanner->input_fd >= 0)
     g_scanner_sync_file_offset (scanner);
+  g_scanner_unmap (scanner);
 
   scanner->token = G_TOKEN_NONE;
   scanner->value.v_int = 0;
@@ -690,7 +807,103 @@ g_scanner_input_file (GScanner *scanner,
   scanner->text_end = NULL;
 
   if (!scanner->buffer)
-    scanner->buffer = g_new (gchar, READ_BUFFER_SIZE + 1);
+    scanner->buffer = g_new (gchar, scanner->buffer_size + 1);
+}
+
+void
+g_scanner_set_buffer_size (GScanner *scanner,
+			   guint     buffer_size)
+{
+  g_return_if_fail (scanner != NULL);
+  g_return_if_fail (buffer_size > 0);
+
+  if (buffer_size == scanner->buffer_size)
+    return;
+
+  if (scanner->buffer)
+    {
+      gchar *buffer = g_new (gchar, buffer_size + 1);
+
+      /* keep the read ahead that is still to be scanned */
+      if (scanner->input_fd >= 0 && scanner->text < scanner->text_end)
+	{
+	  guint pending = scanner->text_end - scanner->text;
+
+	  if (pending > buffer_size)
+	    {
+	      g_scanner_sync_file_offset (scanner);
+	      pending = 0;
+	    }
+	  memcpy (buffer, scanner->text, pending);
+	  scanner->text = buffer;
+	  scanner->text_end = buffer + pending;
+	}
+      g_free (scanner->buffer);
+      scanner->buffer = buffer;
+    }
+  scanner->buffer_size = buffer_size;
+}
+
+gboolean
+g_scanner_input_mmap (GScanner *scanner,
+		      gint	input_fd)
+{
+#ifdef G_SCANNER_USE_MMAP
+  struct stat st;
+  off_t offset;
+  gpointer mapping;
+  guint length;
+#endif
+
+  g_return_val_if_fail (scanner != NULL, FALSE);
+  g_return_val_if_fail (input_fd >= 0, FALSE);
+
+#ifdef G_SCANNER_USE_MMAP
+  /* map from the descriptor's offset to the end of the file, anything
+   * that can't be mapped gets read through the buffer instead
+   */
+  offset = lseek (input_fd, 0, SEEK_CUR);
+  if (offset >= 0 && fstat (input_fd, &st) == 0 && S_ISREG (st.st_mode) &&
+      st.st_size > offset && st.st_size - offset <= G_MAXINT)
+    {
+      off_t page_offset = offset - offset % sysconf (_SC_PAGESIZE);
+
+      length = st.st_size - page_offset;
+      mapping = mmap (NULL, length, PROT_READ, MAP_PRIVATE, input_fd, page_offset);
+      if (mapping != MAP_FAILED)
+	{
+#ifdef HAVE_MADVISE
+	  madvise (mapping, length, MADV_SEQUENTIAL);
+#endif
+	  g_scanner_input_text (scanner,
+				(gchar*) mapping + (offset - page_offset),
+				st.st_size - offset);
+	  scanner->mapping = mapping;
+	  scanner->mapping_len = length;
+	  lseek (input_fd, st.st_size, SEEK_SET);
+
+	  return TRUE;
+	}
+      errno = 0;
+    }
+#endif	/* G_SCANNER_USE_MMAP */
+
+  g_scanner_input_file (scanner, input_fd);
+
+  return FALSE;
+}
+
+static void
+g_scanner_unmap (GScanner *scanner)
+{
+#ifdef G_SCANNER_USE_MMAP
+  if (scanner->mapping)
+    {
+      munmap (scanner->mapping, scanner->mapping_len);
+      scanner->mapping = NULL;
+      scanner->mapping_len = 0;
+    }
+#endif	/* G_SCANNER_USE_MMAP */
 }
 
 void
@@ -706,6 +919,7 @@ g_scanner_input_text (GScanner	  *scanner,
 
   if (scanner->input_fd >= 0)
     g_scanner_sync_file_offset (scanner);
+  g_scanner_unmap (scanner);
 
   scanner->token = G_TOKEN_NONE;
   scanner->value.v_int = 0;
@@ -724,39 +938,43 @@ g_scanner_input_text (GScanner	  *scanner,
     }
 }
 
-static guchar
-g_scanner_peek_next_char (GScanner *scanner)
+/* read the next block of fd input into the buffer, the inlined
+ * character functions only call this once the buffer is used up
+ */
+static gboolean
+g_scanner_fill_buffer (GScanner *scanner)
 {
-  if (scanner->text < scanner->text_end)
+  gint count;
+  gchar *buffer;
+
+  if (scanner->input_fd < 0)
+    return FALSE;
+
+  buffer = scanner->buffer;
+  do
     {
-      return *scanner->text;
+      count = read (scanner->input_fd, buffer, scanner->buffer_size);
     }
-  else if (scanner->input_fd >= 0)
+  while (count == -1 && (errno == EINTR || errno == EAGAIN));
+
+  if (count < 1)
     {
-      gint count;
-      gchar *buffer;
+      scanner->input_fd = -1;
 
-      buffer = scanner->buffer;
-      do
-	{
-	  count = read (scanner->input_fd, buffer, READ_BUFFER_SIZE);
-	}
-      while (count == -1 && (errno == EINTR || errno == EAGAIN));
+      return FALSE;
+    }
 
-      if (count < 1)
-	{
-	  scanner->input_fd = -1;
+  scanner->text = buffer;
+  scanner->text_end = buffer + count;
 
-	  return 0;
-	}
-      else
-	{
-	  scanner->text = buffer;
-	  scanner->text_end = buffer + count;
+  return TRUE;
+}
 
-	  return *buffer;
-	}
-    }
+static inline guchar
+g_scanner_peek_next_char (GScanner *scanner)
+{
+  if (scanner->text < scanner->text_end || g_scanner_fill_buffer (scanner))
+    return *scanner->text;
   else
     return 0;
 }
@@ -788,7 +1006,7 @@ g_scanner_sync_file_offset (GScanner *scanner)
     }
 }
 
-static guchar
+static inline guchar
 g_scanner_get_char (GScanner	*scanner,
 		    guint	*line_p,
 		    guint	*position_p)
@@ -797,34 +1015,14 @@ g_scanner_get_char (GScanner	*scanner,
 
   if (scanner->text < scanner->text_end)
     fchar = *(scanner->text++);
-  else if (scanner->input_fd >= 0)
+  else if (g_scanner_fill_buffer (scanner))
     {
-      gint count;
-      gchar *buffer;
-
-      buffer = scanner->buffer;
-      do
-	{
-	  count = read (scanner->input_fd, buffer, READ_BUFFER_SIZE);
-	}
-      while (count == -1 && (errno == EINTR || errno == EAGAIN));
-
-      if (count < 1)
+      fchar = *(scanner->text++);
+      if (!fchar)
 	{
+	  g_scanner_sync_file_offset (scanner);
+	  scanner->text_end = scanner->text;
 	  scanner->input_fd = -1;
-	  fchar = 0;
-	}
-      else
-	{
-	  scanner->text = buffer + 1;
-	  scanner->text_end = buffer + count;
-	  fchar = *buffer;
-	  if (!fchar)
-	    {
-	      g_scanner_sync_file_offset (scanner);
-	      scanner->text_end = scanner->text;
-	      scanner->input_fd = -1;
-	    }
 	}
     }
   else
@@ -1156,15 +1354,17 @@ g_scanner_get_token_i (GScanner	*scanner,
 		       guint		*line_p,
 		       guint		*position_p)
 {
+  const guint8 *cset = g_scanner_get_cset (scanner);
+  
   do
     {
       g_scanner_free_value (token_p, value_p);
       g_scanner_get_token_ll (scanner, token_p, value_p, line_p, position_p);
     }
   while (((*token_p > 0 && *token_p < 256) &&
-	  strchr (scanner->config->cset_skip_characters, *token_p)) ||
+	  (cset[*token_p] & G_CSET_SKIP)) ||
 	 (*token_p == G_TOKEN_CHAR &&
-	  strchr (scanner->config->cset_skip_characters, value_p->v_char)) ||
+	  (cset[(guchar) value_p->v_char] & G_CSET_SKIP)) ||
 	 (*token_p == G_TOKEN_COMMENT_MULTI &&
 	  scanner->config->skip_comment_multi) ||
 	 (*token_p == G_TOKEN_COMMENT_SINGLE &&
@@ -1219,9 +1419,36 @@ g_scanner_get_token_ll	(GScanner	*scanner,
   GString	  *gstring;
   GTokenValue	   value;
   guchar	   ch;
+  const guint8	  *cset;
+  guint		   hash;
+  gboolean	   hash_valid;
   
   config = scanner->config;
+  cset = ((GScannerCset*) scanner->cset)->table;
   (*value_p).v_int = 0;
+  hash = 0;
+  hash_valid = FALSE;
+  
+  /* consume whitespace that would only be skipped as single character
+   * tokens anyway
+   */
+  if (scanner->token != G_TOKEN_EOF)
+    {
+      const gchar *text = scanner->text;
+      const gchar *text_end = scanner->text_end;
+      
+      while (text < text_end && (cset[(guchar) *text] & G_CSET_SKIP_FAST))
+	{
+	  if (*text++ == '\n')
+	    {
+	      (*position_p) = 0;
+	      (*line_p)++;
+	    }
+	  else
+	    (*position_p)++;
+	}
+      scanner->text = text;
+    }
   
   if ((scanner->text >= scanner->text_end && scanner->input_fd < 0) ||
       scanner->token == G_TOKEN_EOF)
@@ -1250,7 +1477,7 @@ g_scanner_get_token_ll	(GScanner	*scanner,
        * might interfere with other key chars like slashes or numbers
        */
       if (config->scan_identifier &&
-	  ch && strchr (config->cset_identifier_first, ch))
+	  ch && (cset[ch] & G_CSET_ID_FIRST))
 	goto identifier_precedence;
       
       switch (ch)
@@ -1628,24 +1855,54 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 		}
 	    }
 	  else if (config->scan_identifier && ch &&
-		   strchr (config->cset_identifier_first, ch))
+		   (cset[ch] & G_CSET_ID_FIRST))
 	    {
 	    identifier_precedence:
 	      
 	      if (config->cset_identifier_nth && ch &&
-		  strchr (config->cset_identifier_nth,
-			  g_scanner_peek_next_char (scanner)))
+		  (cset[g_scanner_peek_next_char (scanner)] & G_CSET_ID_NTH))
 		{
+		  const gchar *p = scanner->text;
+		  guint n;
+		  
 		  token = G_TOKEN_IDENTIFIER;
-		  gstring = g_string_new ("");
-		  gstring = g_string_append_c (gstring, ch);
-		  do
+		  hash_valid = TRUE;
+		  G_SCANNER_HASH_STEP (hash, config->case_sensitive ? ch : to_lower (ch));
+		  
+		  /* take the identifier straight from the buffer */
+		  while (p < scanner->text_end && *p && *p != '\n' &&
+			 (cset[(guchar) *p] & G_CSET_ID_NTH))
 		    {
-		      ch = g_scanner_get_char (scanner, line_p, position_p);
-		      gstring = g_string_append_c (gstring, ch);
-		      ch = g_scanner_peek_next_char (scanner);
+		      G_SCANNER_HASH_STEP (hash, config->case_sensitive ? *p : to_lower (*p));
+		      p++;
+		    }
+		  n = p - scanner->text;
+		  value.v_identifier = g_new (gchar, n + 2);
+		  value.v_identifier[0] = ch;
+		  memcpy (value.v_identifier + 1, scanner->text, n);
+		  value.v_identifier[n + 1] = 0;
+		  scanner->text = p;
+		  (*position_p) += n;
+		  
+		  if (!n || p >= scanner->text_end ||
+		      (*p && (cset[(guchar) *p] & G_CSET_ID_NTH)))
+		    {
+		      /* continues in the next block of input */
+		      gstring = g_string_new (value.v_identifier);
+		      g_free (value.v_identifier);
+		      value.v_identifier = NULL;
+		      while (n == 0 ||
+			     ((ch = g_scanner_peek_next_char (scanner)) &&
+			      (cset[ch] & G_CSET_ID_NTH)))
+			{
+			  ch = g_scanner_get_char (scanner, line_p, position_p);
+			  if (!ch)
+			    hash_valid = FALSE;
+			  G_SCANNER_HASH_STEP (hash, config->case_sensitive ? ch : to_lower (ch));
+			  gstring = g_string_append_c (gstring, ch);
+			  n++;
+			}
 		    }
-		  while (ch && strchr (config->cset_identifier_nth, ch));
 		  ch = 0;
 		}
 	      else if (config->scan_identifier_1char)
@@ -1653,6 +1910,8 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 		  token = G_TOKEN_IDENTIFIER;
 		  value.v_identifier = g_new0 (gchar, 2);
 		  value.v_identifier[0] = ch;
+		  hash_valid = TRUE;
+		  G_SCANNER_HASH_STEP (hash, config->case_sensitive ? ch : to_lower (ch));
 		  ch = 0;
 		}
 	    }
@@ -1692,8 +1951,8 @@ g_scanner_get_token_ll	(GScanner	*scanner,
   
   if (gstring)
     {
-      value.v_string = gstring->str;
-      g_string_free (gstring, FALSE);
+      value.v_string = g_string_steal (gstring);
+      g_string_free (gstring, TRUE);
       gstring = NULL;
     }
   
@@ -1705,9 +1964,30 @@ g_scanner_get_token_ll	(GScanner	*scanner,
 	  guint scope_id;
 	  
 	  scope_id = scanner->scope_id;
-	  key = g_scanner_lookup_internal (scanner, scope_id, value.v_identifier);
-	  if (!key && scope_id && scanner->config->scope_0_fallback)
-	    key = g_scanner_lookup_internal (scanner, 0, value.v_identifier);
+	  if (hash_valid)
+	    {
+	      gchar buffer[64], *symbol = value.v_identifier;
+	      
+	      if (!config->case_sensitive)
+		{
+		  guint i, length = strlen (value.v_identifier);
+		  
+		  symbol = length < sizeof (buffer) ? buffer : g_new (gchar, length + 1);
+		  for (i = 0; i <= length; i++)
+		    symbol[i] = to_lower (value.v_identifier[i]);
+		}
+	      key = g_scanner_lookup_hashed (scanner, scope_id, symbol, hash);
+	      if (!key && scope_id && scanner->config->scope_0_fallback)
+		key = g_scanner_lookup_hashed (scanner, 0, symbol, hash);
+	      if (symbol != buffer && symbol != value.v_identifier)
+		g_free (symbol);
+	    }
+	  else
+	    {
+	      key = g_scanner_lookup_internal (scanner, scope_id, value.v_identifier);
+	      if (!key && scope_id && scanner->config->scope_0_fallback)
+		key = g_scanner_lookup_internal (scanner, 0, value.v_identifier);
+	    }
 	  
 	  if (key)
 	    {
@@ -39,6 +39,7 @@ struct _GAllocator /* from gmem.c */
   guint          type : 4;
   GAllocator    *last;
   GMemChunk     *mem_chunk;
+  GArena        *arena;
   GSList        *free_lists; /* implementation specific */
 };
 
@@ -62,7 +63,12 @@ g_slist_validate_allocator (GAllocator *allocator)
 	}
     }
 
-  if (!allocator->mem_chunk)
+  if (allocator->arena)
+    {
+      /* nodes freed during an earlier push went away with the arena */
+      allocator->free_lists = NULL;
+    }
+  else if (!allocator->mem_chunk)
     {
       allocator->mem_chunk = g_mem_chunk_new (allocator->name,
 					      sizeof (GSList),
@@ -100,23 +106,46 @@ g_slist_pop_allocator (void)
   G_UNLOCK (current_allocator);
 }
 
-GSList*
-g_slist_alloc (void)
+/* Per thread magazines of free nodes. Once threads are initialized,
+ * nodes of the default allocator are handed out from and freed into
+ * the calling thread's magazine without taking current_allocator_lock,
+ * which is only needed to refill an empty magazine from the shared
+ * free lists or to give half of a full one back. Nodes for a pushed
+ * allocator always go through the allocator itself.
+ */
+#define SLIST_MAGAZINE_SIZE	64
+
+typedef struct _GSListMagazine GSListMagazine;
+
+struct _GSListMagazine
+{
+  GSList *free_lists;	/* laid out like GAllocator.free_lists */
+  guint   n_free_lists;
+};
+
+static GAllocator	*default_allocator = NULL;
+static GStaticPrivate	 slist_magazine = G_STATIC_PRIVATE_INIT;
+
+/* HOLDS: current_allocator_lock */
+static GSList*
+g_slist_alloc_locked (void)
 {
   GSList *list;
 
-  G_LOCK (current_allocator);
   if (!current_allocator)
     {
       GAllocator *allocator = g_allocator_new ("GLib default GSList allocator",
 					       128);
       g_slist_validate_allocator (allocator);
       allocator->last = NULL;
-      current_allocator = allocator; 
+      current_allocator = allocator;
+      default_allocator = allocator;
     }
   if (!current_allocator->free_lists)
     {
-      list = g_chunk_new (GSList, current_allocator->mem_chunk);
+      list = current_allocator->arena ?
+	g_arena_alloc (current_allocator->arena, sizeof (GSList)) :
+	g_chunk_new (GSList, current_allocator->mem_chunk);
       list->data = NULL;
     }
   else
@@ -133,8 +162,143 @@ g_slist_alloc (void)
 	  current_allocator->free_lists = list->next;
 	}
     }
+
+  return list;
+}
+
+/* HOLDS: current_allocator_lock */
+static void
+g_slist_magazine_release (GSListMagazine *magazine,
+			  guint           n_keep)
+{
+  GSList *free_lists = magazine->free_lists;
+  GSList *last;
+  guint n;
+
+  if (n_keep)
+    {
+      for (n = 1; n < n_keep; n++)
+	free_lists = free_lists->next;
+      last = free_lists;
+      free_lists = last->next;
+      last->next = NULL;
+    }
+  else
+    magazine->free_lists = NULL;
+  magazine->n_free_lists = n_keep;
+
+  if (free_lists)
+    {
+      for (last = free_lists; last->next; last = last->next)
+	;
+      last->next = default_allocator->free_lists;
+      default_allocator->free_lists = free_lists;
+    }
+}
+
+static void
+g_slist_magazine_free (gpointer data)
+{
+  GSListMagazine *magazine = data;
+
+  G_LOCK (current_allocator);
+  g_slist_magazine_release (magazine, 0);
   G_UNLOCK (current_allocator);
-  
+  g_free (magazine);
+}
+
+static inline GSListMagazine*
+g_slist_magazine_get (void)
+{
+  GSListMagazine *magazine;
+
+  /* the unlocked read of current_allocator is fine here, a thread
+   * that races with another one pushing an allocator could as well
+   * have run a little earlier.
+   */
+  if (!g_thread_supported () ||
+      !default_allocator ||
+      current_allocator != default_allocator)
+    return NULL;
+
+  magazine = g_static_private_get (&slist_magazine);
+  if (!magazine)
+    {
+      magazine = g_new0 (GSListMagazine, 1);
+      g_static_private_set (&slist_magazine, magazine, g_slist_magazine_free);
+    }
+
+  return magazine;
+}
+
+static void
+g_slist_magazine_refill (GSListMagazine *magazine)
+{
+  GSList *list;
+
+  G_LOCK (current_allocator);
+  while (magazine->n_free_lists < SLIST_MAGAZINE_SIZE / 2)
+    {
+      if (default_allocator->free_lists)
+	{
+	  list = default_allocator->free_lists;
+	  default_allocator->free_lists = list->next;
+	}
+      else
+	{
+	  list = g_chunk_new (GSList, default_allocator->mem_chunk);
+	  list->data = NULL;
+	}
+      list->next = magazine->free_lists;
+      magazine->free_lists = list;
+      magazine->n_free_lists++;
+    }
+  G_UNLOCK (current_allocator);
+}
+
+static inline void
+g_slist_magazine_put (GSListMagazine *magazine,
+		      GSList         *list)
+{
+  list->next = magazine->free_lists;
+  magazine->free_lists = list;
+  if (++magazine->n_free_lists >= SLIST_MAGAZINE_SIZE)
+    {
+      G_LOCK (current_allocator);
+      g_slist_magazine_release (magazine, SLIST_MAGAZINE_SIZE / 2);
+      G_UNLOCK (current_allocator);
+    }
+}
+
+GSList*
+g_slist_alloc (void)
+{
+  GSListMagazine *magazine = g_slist_magazine_get ();
+  GSList *list;
+
+  if (magazine)
+    {
+      if (!magazine->free_lists)
+	g_slist_magazine_refill (magazine);
+      if (magazine->free_lists->data)
+	{
+	  list = magazine->free_lists->data;
+	  magazine->free_lists->data = list->next;
+	  list->data = NULL;
+	}
+      else
+	{
+	  list = magazine->free_lists;
+	  magazine->free_lists = list->next;
+	  magazine->n_free_lists--;
+	}
+    }
+  else
+    {
+      G_LOCK (current_allocator);
+      list = g_slist_alloc_locked ();
+      G_UNLOCK (current_allocator);
+    }
   list->next = NULL;
 
   return list;
@@ -145,11 +309,18 @@ g_slist_free (GSList *list)
 {
   if (list)
     {
-      list->data = list->next;
-      G_LOCK (current_allocator);
-      list->next = current_allocator->free_lists;
-      current_allocator->free_lists = list;
-      G_UNLOCK (current_allocator);
+      GSListMagazine *magazine = g_slist_magazine_get ();
+
+      list->data = list->next;  
+      if (magazine)
+	g_slist_magazine_put (magazine, list);
+      else
+	{
+	  G_LOCK (current_allocator);
+	  list->next = current_allocator->free_lists;
+	  current_allocator->free_lists = list;
+	  G_UNLOCK (current_allocator);
+	}
     }
 }
 
@@ -158,11 +329,18 @@ g_slist_free_1 (GSList *list)
 {
   if (list)
     {
-      list->data = NULL;
-      G_LOCK (current_allocator);
-      list->next = current_allocator->free_lists;
-      current_allocator->free_lists = list;
-      G_UNLOCK (current_allocator);
+      GSListMagazine *magazine = g_slist_magazine_get ();
+
+      list->data = NULL;  
+      if (magazine)
+	g_slist_magazine_put (magazine, list);
+      else
+	{
+	  G_LOCK (current_allocator);
+	  list->next = current_allocator->free_lists;
+	  current_allocator->free_lists = list;
+	  G_UNLOCK (current_allocator);
+	}
     }
 }
 
@@ -550,7 +728,7 @@ g_slist_sort_merge  (GSList      *l1,
 
   while (l1 && l2)
     {
-      if (compare_func(l1->data,l2->data) < 0)
+      if (compare_func(l1->data,l2->data) <= 0)
         {
 	  l=l->next=l1;
 	  l1=l1->next;
@@ -566,30 +744,41 @@ g_slist_sort_merge  (GSList      *l1,
   return list.next;
 }
 
+/* bottom up merge sort, see g_list_sort() */
+#define	G_SLIST_SORT_BINS	(64)
+
 GSList* 
 g_slist_sort (GSList       *list,
 	      GCompareFunc compare_func)
 {
-  GSList *l1, *l2;
+  GSList *bins[G_SLIST_SORT_BINS];
+  GSList *run;
+  guint n_bins = 0;
+  guint i;
 
-  if (!list) 
-    return NULL;
-  if (!list->next) 
+  if (!list || !list->next)
     return list;
 
-  l1 = list; 
-  l2 = list->next;
-
-  while ((l2 = l2->next) != NULL)
+  while (list)
     {
-      if ((l2 = l2->next) == NULL) 
-	break;
-      l1=l1->next;
+      run = list;
+      list = list->next;
+      run->next = NULL;
+
+      for (i = 0; i < n_bins && bins[i]; i++)
+	{
+	  run = g_slist_sort_merge (bins[i], run, compare_func);
+	  bins[i] = NULL;
+	}
+      if (i == n_bins)
+	n_bins++;
+      bins[i] = run;
     }
-  l2 = l1->next; 
-  l1->next = NULL;
 
-  return g_slist_sort_merge (g_slist_sort (list, compare_func),
-			     g_slist_sort (l2,   compare_func),
-			     compare_func);
+  run = NULL;
+  for (i = 0; i < n_bins; i++)
+    if (bins[i])
+      run = run ? g_slist_sort_merge (bins[i], run, compare_func) : bins[i];
+
+  return run;
 }
@@ -39,6 +39,9 @@
 #include <locale.h>
 #include <errno.h>
 #include <ctype.h>		/* For tolower() */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #if !defined (HAVE_STRSIGNAL) || !defined(NO_SYS_SIGLIST_DECL)
 #include <signal.h>
 #endif
@@ -1129,36 +1132,95 @@ g_printf_string_upper_bound (const gchar* format,
   return len;
 }
 
-void
-g_strdown (gchar *string)
-{
-  register guchar *s;
+/* Case conversion works on whole blocks of ASCII characters at a time:
+ * 16 bytes with SSE2 and a machine word otherwise. Blocks containing a
+ * byte >= 0x80 and locales where the ASCII letters don't map as in the
+ * C locale (the Turkish dotless i) go through toupper()/tolower().
+ */
+#define G_STR_ONES	((gulong) -1 / 0xff)
+#define G_STR_HIGHS	(G_STR_ONES * 0x80)
 
-  g_return_if_fail (string != NULL);
+static void
+g_str_convert_case (guchar  *s,
+		    guint    len,
+		    gboolean upper)
+{
+  const guchar first = upper ? 'a' : 'A';
+  const guchar last = upper ? 'z' : 'Z';
+  guint i = 0;
+  guint j;
 
-  s = string;
+#define G_STR_CONVERT(c)	((c) = upper ? toupper (c) : tolower (c))
 
-  while (*s)
+  if (upper ? toupper ('i') == 'I' : tolower ('I') == 'i')
     {
-      *s = tolower (*s);
-      s++;
+#ifdef __SSE2__
+      const __m128i below = _mm_set1_epi8 (first - 1);
+      const __m128i above = _mm_set1_epi8 (last + 1);
+      const __m128i bit = _mm_set1_epi8 (0x20);
+
+      for (; i + 16 <= len; i += 16)
+	{
+	  __m128i v = _mm_loadu_si128 ((const __m128i*) (s + i));
+	  __m128i letters;
+
+	  if (_mm_movemask_epi8 (v))
+	    {
+	      for (j = i; j < i + 16; j++)
+		G_STR_CONVERT (s[j]);
+	      continue;
+	    }
+	  letters = _mm_and_si128 (_mm_cmpgt_epi8 (v, below),
+				   _mm_cmplt_epi8 (v, above));
+	  v = _mm_xor_si128 (v, _mm_and_si128 (letters, bit));
+	  _mm_storeu_si128 ((__m128i*) (s + i), v);
+	}
+#endif /* __SSE2__ */
+
+      for (; i + sizeof (gulong) <= len; i += sizeof (gulong))
+	{
+	  gulong w;
+	  gulong letters;
+
+	  memcpy (&w, s + i, sizeof (gulong));
+	  if (w & G_STR_HIGHS)
+	    {
+	      for (j = i; j < i + sizeof (gulong); j++)
+		G_STR_CONVERT (s[j]);
+	      continue;
+	    }
+	  /* every byte is < 0x80, so none of these additions carry into
+	   * the next byte; the high bit ends up set for bytes >= first,
+	   * respectively > last
+	   */
+	  letters = ((w + G_STR_ONES * (0x80 - first)) &
+		     ~(w + G_STR_ONES * (0x7f - last)) &
+		     G_STR_HIGHS);
+	  w ^= letters >> 2;
+	  memcpy (s + i, &w, sizeof (gulong));
+	}
     }
+
+  for (; i < len; i++)
+    G_STR_CONVERT (s[i]);
+
+#undef G_STR_CONVERT
 }
 
 void
-g_strup (gchar *string)
+g_strdown (gchar *string)
 {
-  register guchar *s;
-
   g_return_if_fail (string != NULL);
 
-  s = string;
+  g_str_convert_case ((guchar*) string, strlen (string), FALSE);
+}
 
-  while (*s)
-    {
-      *s = toupper (*s);
-      s++;
-    }
+void
+g_strup (gchar *string)
+{
+  g_return_if_fail (string != NULL);
+
+  g_str_convert_case ((guchar*) string, strlen (string), TRUE);
 }
 
 void
@@ -1255,16 +1317,21 @@ g_strdelimit (gchar	  *string,
 	      const gchar *delimiters,
 	      gchar	   new_delim)
 {
-  register gchar *c;
+  register guchar *c;
+  gchar is_delimiter[256];
 
   g_return_val_if_fail (string != NULL, NULL);
 
   if (!delimiters)
     delimiters = G_STR_DELIMITERS;
 
-  for (c = string; *c; c++)
+  memset (is_delimiter, 0, sizeof (is_delimiter));
+  for (c = (guchar*) delimiters; *c; c++)
+    is_delimiter[*c] = TRUE;
+
+  for (c = (guchar*) string; *c; c++)
     {
-      if (strchr (delimiters, *c))
+      if (is_delimiter[*c])
 	*c = new_delim;
     }
 
@@ -1277,28 +1344,33 @@ g_strescape (gchar *string)
   gchar *q;
   gchar *escaped;
   guint backslashes = 0;
-  gchar *p = string;
+  gchar *p;
 
   g_return_val_if_fail (string != NULL, NULL);
 
-  while (*p != '\000')
-    backslashes += (*p++ == '\\');
+  for (p = strchr (string, '\\'); p; p = strchr (p + 1, '\\'))
+    backslashes++;
 
   if (!backslashes)
     return g_strdup (string);
 
   escaped = g_new (gchar, strlen (string) + backslashes + 1);
 
+  /* copy the runs between backslashes in one go */
   p = string;
   q = escaped;
 
-  while (*p != '\000')
+  while (backslashes--)
     {
-      if (*p == '\\')
-	*q++ = '\\';
-      *q++ = *p++;
+      gchar *next = strchr (p, '\\');
+      guint n = next - p + 1;
+
+      memcpy (q, p, n);
+      q += n;
+      *q++ = '\\';
+      p = next + 1;
     }
-  *q = '\000';
+  strcpy (q, p);
 
   return escaped;
 }
@@ -1336,57 +1408,122 @@ g_strchomp (gchar *string)
   return string;
 }
 
+void
+g_str_tokenizer_init (GStrTokenizer *tokenizer,
+		      const gchar   *string,
+		      const gchar   *delimiter,
+		      gint           max_tokens)
+{
+  g_return_if_fail (tokenizer != NULL);
+  g_return_if_fail (string != NULL);
+  g_return_if_fail (delimiter != NULL);
+
+  tokenizer->string = string;
+  tokenizer->delimiter = delimiter;
+  tokenizer->delimiter_len = strlen (delimiter);
+  tokenizer->max_splits = max_tokens < 1 ? G_MAXINT : max_tokens;
+}
+
+gboolean
+g_str_tokenizer_next (GStrTokenizer *tokenizer,
+		      const gchar  **token,
+		      guint         *length)
+{
+  const gchar *string;
+  const gchar *s = NULL;
+
+  g_return_val_if_fail (tokenizer != NULL, FALSE);
+  g_return_val_if_fail (token != NULL, FALSE);
+  g_return_val_if_fail (length != NULL, FALSE);
+
+  string = tokenizer->string;
+  if (!string)
+    return FALSE;
+
+  if (tokenizer->max_splits)
+    s = strstr (string, tokenizer->delimiter);
+
+  if (s)
+    {
+      *token = string;
+      *length = s - string;
+      tokenizer->string = s + tokenizer->delimiter_len;
+      tokenizer->max_splits--;
+
+      return TRUE;
+    }
+
+  /* like g_strsplit(), drop an empty trailing token */
+  tokenizer->string = NULL;
+  if (!*string)
+    return FALSE;
+
+  *token = string;
+  *length = strlen (string);
+
+  return TRUE;
+}
+
 gchar**
 g_strsplit (const gchar *string,
 	    const gchar *delimiter,
 	    gint         max_tokens)
 {
-  GSList *string_list = NULL, *slist;
-  gchar **str_array, *s;
-  guint i, n = 1;
+  GStrTokenizer tokenizer;
+  const gchar *token;
+  gchar **str_array;
+  guint i, n = 0, len;
 
   g_return_val_if_fail (string != NULL, NULL);
   g_return_val_if_fail (delimiter != NULL, NULL);
 
-  if (max_tokens < 1)
-    max_tokens = G_MAXINT;
+  g_str_tokenizer_init (&tokenizer, string, delimiter, max_tokens);
+  while (g_str_tokenizer_next (&tokenizer, &token, &len))
+    n++;
 
-  s = strstr (string, delimiter);
-  if (s)
-    {
-      guint delimiter_len = strlen (delimiter);
+  str_array = g_new (gchar*, n + 1);
 
-      do
-	{
-	  guint len;
-	  gchar *new_string;
-
-	  len = s - string;
-	  new_string = g_new (gchar, len + 1);
-	  strncpy (new_string, string, len);
-	  new_string[len] = 0;
-	  string_list = g_slist_prepend (string_list, new_string);
-	  n++;
-	  string = s + delimiter_len;
-	  s = strstr (string, delimiter);
-	}
-      while (--max_tokens && s);
-    }
-  if (*string)
+  g_str_tokenizer_init (&tokenizer, string, delimiter, max_tokens);
+  for (i = 0; g_str_tokenizer_next (&tokenizer, &token, &len); i++)
+    str_array[i] = g_strndup (token, len);
+  str_array[i] = NULL;
+
+  return str_array;
+}
+
+gchar**
+g_strsplit_packed (const gchar *string,
+		   const gchar *delimiter,
+		   gint         max_tokens)
+{
+  GStrTokenizer tokenizer;
+  const gchar *token;
+  gchar **str_array;
+  gchar *s;
+  guint i, n = 0, len, size = 0;
+
+  g_return_val_if_fail (string != NULL, NULL);
+  g_return_val_if_fail (delimiter != NULL, NULL);
+
+  g_str_tokenizer_init (&tokenizer, string, delimiter, max_tokens);
+  while (g_str_tokenizer_next (&tokenizer, &token, &len))
     {
       n++;
-      string_list = g_slist_prepend (string_list, g_strdup (string));
+      size += len + 1;
     }
 
-  str_array = g_new (gchar*, n);
+  str_array = g_malloc ((n + 1) * sizeof (gchar*) + size);
+  s = (gchar*) (str_array + n + 1);
 
-  i = n - 1;
-
-  str_array[i--] = NULL;
-  for (slist = string_list; slist; slist = slist->next)
-    str_array[i--] = slist->data;
-
-  g_slist_free (string_list);
+  g_str_tokenizer_init (&tokenizer, string, delimiter, max_tokens);
+  for (i = 0; g_str_tokenizer_next (&tokenizer, &token, &len); i++)
+    {
+      str_array[i] = s;
+      memcpy (s, token, len);
+      s[len] = 0;
+      s += len + 1;
+    }
+  str_array[i] = NULL;
 
   return str_array;
 }
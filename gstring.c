@@ -28,6 +28,10 @@
  * MT safe
  */
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -37,27 +41,53 @@
 
 
 typedef struct _GRealStringChunk GRealStringChunk;
+typedef struct _GStringChunkEntry GStringChunkEntry;
 typedef struct _GRealString      GRealString;
 
+/* slot of the open addressed table behind g_string_chunk_insert_const(),
+ * string is NULL for empty slots */
+struct _GStringChunkEntry
+{
+  guint  hash;
+  guint  length;
+  gchar *string;
+};
+
 struct _GRealStringChunk
 {
-  GHashTable *const_table;
+  GStringChunkEntry *const_table;
+  guint       const_size;
+  guint       const_nnodes;
+  guint32     seed;
   GSList     *storage_list;
   gint        storage_next;
   gint        this_size;
   gint        default_size;
+  GMutex     *lock;
+  guint       n_stripes;
+  guint       stripe_shift;
+  GRealStringChunk *stripes;
 };
 
+/* a string is allocated as one block of G_STRING_INLINE_SIZE bytes of
+ * inline storage followed by the GRealString, with str pointing at the
+ * start of the block until the string outgrows it. short strings thus
+ * cost a single allocation, and since str is the block itself,
+ * g_string_free (string, FALSE) still hands out something g_free()
+ * can release.
+ */
+#define G_STRING_INLINE_SIZE	32
+#define G_STRING_INLINE(string)	((gchar*) (string) - G_STRING_INLINE_SIZE)
+#define G_STRING_PRINTF_SIZE	256	/* formatted on the stack */
+
 struct _GRealString
 {
-  gchar *str;
-  gint   len;
-  gint   alloc;
+  gchar  *str;
+  gint    len;
+  gint    alloc;
+  GArena *arena;	/* the arena str and the string itself live in */
 };
 
-G_LOCK_DEFINE_STATIC (string_mem_chunk);
-static GMemChunk *string_mem_chunk = NULL;
-
 /* Hash Functions.
  */
 
@@ -72,44 +102,335 @@ guint
 g_str_hash (gconstpointer key)
 {
   const char *p = key;
-  guint h = *p;
+  guint len = strlen (key);
+  guint h = 0;
   
-  if (h)
-    for (p += 1; *p != '\0'; p++)
-      h = (h << 5) - h + *p;
+  /* h = h * 31 + c, four characters per step so the multiplications
+   * don't form a single dependency chain; the values are unchanged
+   */
+  for (; len >= 4; p += 4, len -= 4)
+    h = (h * 923521U + (guint) p[0] * 29791U + (guint) p[1] * 961U +
+	 (guint) p[2] * 31U + (guint) p[3]);
+  for (; len; p++, len--)
+    h = (h << 5) - h + *p;
   
   return h;
 }
 
+/* Word at a time string hash, in the spirit of MurmurHash3/xxHash. The
+ * seed defaults to 0 and only varies the distribution; it is no
+ * defense against chosen keys, see g_str_hash_fast_set_key() for that.
+ */
+static guint32 str_hash_fast_seed = 0;
+
+void
+g_str_hash_fast_set_seed (guint32 seed)
+{
+  str_hash_fast_seed = seed;
+}
+
+#ifdef G_HAVE_GINT64
+
+#define STR_HASH_ROTL64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+#define STR_HASH_K1		G_GINT64_CONSTANT (0x87c37b91114253d5U)
+#define STR_HASH_K2		G_GINT64_CONSTANT (0x4cf5ad432745937fU)
+
+static guint
+str_hash_fast_len (const guchar *p,
+		   guint         len,
+		   guint32       seed)
+{
+  guint64 h = seed ^ (len * STR_HASH_K2);
+  guint64 k;
+  
+  for (; len >= 8; p += 8, len -= 8)
+    {
+      memcpy (&k, p, 8);
+      k *= STR_HASH_K1;
+      k = STR_HASH_ROTL64 (k, 31);
+      k *= STR_HASH_K2;
+      h ^= k;
+      h = STR_HASH_ROTL64 (h, 27) * 5 + 0x52dce729;
+    }
+  
+  k = 0;
+  switch (len)
+    {
+    case 7: k ^= ((guint64) p[6]) << 48;
+    case 6: k ^= ((guint64) p[5]) << 40;
+    case 5: k ^= ((guint64) p[4]) << 32;
+    case 4: k ^= ((guint64) p[3]) << 24;
+    case 3: k ^= ((guint64) p[2]) << 16;
+    case 2: k ^= ((guint64) p[1]) << 8;
+    case 1: k ^= ((guint64) p[0]);
+      k *= STR_HASH_K1;
+      k = STR_HASH_ROTL64 (k, 31);
+      k *= STR_HASH_K2;
+      h ^= k;
+    }
+  
+  h ^= h >> 33;
+  h *= G_GINT64_CONSTANT (0xff51afd7ed558ccdU);
+  h ^= h >> 33;
+  h *= G_GINT64_CONSTANT (0xc4ceb9fe1a85ec53U);
+  h ^= h >> 33;
+  
+  return (guint) (h ^ (h >> 32));
+}
+
+#else /* !G_HAVE_GINT64 */
+
+#define STR_HASH_ROTL32(x, r)	(((x) << (r)) | ((x) >> (32 - (r))))
+
+static guint
+str_hash_fast_len (const guchar *p,
+		   guint         len,
+		   guint32       seed)
+{
+  guint32 h = seed ^ len;
+  guint32 k;
+  
+  for (; len >= 4; p += 4, len -= 4)
+    {
+      memcpy (&k, p, 4);
+      k *= 0xcc9e2d51;
+      k = STR_HASH_ROTL32 (k, 15);
+      k *= 0x1b873593;
+      h ^= k;
+      h = STR_HASH_ROTL32 (h, 13) * 5 + 0xe6546b64;
+    }
+  
+  k = 0;
+  switch (len)
+    {
+    case 3: k ^= p[2] << 16;
+    case 2: k ^= p[1] << 8;
+    case 1: k ^= p[0];
+      k *= 0xcc9e2d51;
+      k = STR_HASH_ROTL32 (k, 15);
+      k *= 0x1b873593;
+      h ^= k;
+    }
+  
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  
+  return h;
+}
+
+#endif /* !G_HAVE_GINT64 */
+
+/* Keyed hashing for tables exposed to untrusted keys. Seeding the hash
+ * above does not help against hash flooding: its collisions do not
+ * depend on the seed, so a set of colliding keys collides under every
+ * seed. Once g_str_hash_fast_set_key() has been called,
+ * g_str_hash_fast() uses SipHash-1-3 instead, a keyed pseudo random
+ * function with a 128 bit key, or HalfSipHash-1-3 with the first 64
+ * bits of the key where there is no 64 bit integer type.
+ */
+static gboolean str_hash_keyed = FALSE;
+
+#ifdef G_HAVE_GINT64
+
+static guint64 str_hash_key[2];
+
+#define SIP_ROUND(v0, v1, v2, v3)					\
+   G_STMT_START {							\
+     v0 += v1; v1 = STR_HASH_ROTL64 (v1, 13); v1 ^= v0;			\
+     v0 = STR_HASH_ROTL64 (v0, 32);					\
+     v2 += v3; v3 = STR_HASH_ROTL64 (v3, 16); v3 ^= v2;			\
+     v0 += v3; v3 = STR_HASH_ROTL64 (v3, 21); v3 ^= v0;			\
+     v2 += v1; v1 = STR_HASH_ROTL64 (v1, 17); v1 ^= v2;			\
+     v2 = STR_HASH_ROTL64 (v2, 32);					\
+   } G_STMT_END
+
+static guint64
+str_hash_load64 (const guchar *p,
+		 guint         len)
+{
+  guint64 m = 0;
+  
+  while (len--)
+    m |= ((guint64) p[len]) << (8 * len);
+  
+  return m;
+}
+
+static guint
+str_hash_sip_len (const guchar *p,
+		  guint         len)
+{
+  guint64 v0 = str_hash_key[0] ^ G_GINT64_CONSTANT (0x736f6d6570736575U);
+  guint64 v1 = str_hash_key[1] ^ G_GINT64_CONSTANT (0x646f72616e646f6dU);
+  guint64 v2 = str_hash_key[0] ^ G_GINT64_CONSTANT (0x6c7967656e657261U);
+  guint64 v3 = str_hash_key[1] ^ G_GINT64_CONSTANT (0x7465646279746573U);
+  guint64 m;
+  guint n = len;
+  
+  for (; n >= 8; p += 8, n -= 8)
+    {
+      m = str_hash_load64 (p, 8);
+      v3 ^= m;
+      SIP_ROUND (v0, v1, v2, v3);
+      v0 ^= m;
+    }
+  
+  m = str_hash_load64 (p, n) | ((guint64) (len & 0xff)) << 56;
+  v3 ^= m;
+  SIP_ROUND (v0, v1, v2, v3);
+  v0 ^= m;
+  
+  v2 ^= 0xff;
+  SIP_ROUND (v0, v1, v2, v3);
+  SIP_ROUND (v0, v1, v2, v3);
+  SIP_ROUND (v0, v1, v2, v3);
+  
+  m = v0 ^ v1 ^ v2 ^ v3;
+  
+  return (guint) (m ^ (m >> 32));
+}
+
+#else /* !G_HAVE_GINT64 */
+
+static guint32 str_hash_key[2];
+
+#define SIP_ROUND(v0, v1, v2, v3)					\
+   G_STMT_START {							\
+     v0 += v1; v1 = STR_HASH_ROTL32 (v1, 5); v1 ^= v0;			\
+     v0 = STR_HASH_ROTL32 (v0, 16);					\
+     v2 += v3; v3 = STR_HASH_ROTL32 (v3, 8); v3 ^= v2;			\
+     v0 += v3; v3 = STR_HASH_ROTL32 (v3, 7); v3 ^= v0;			\
+     v2 += v1; v1 = STR_HASH_ROTL32 (v1, 13); v1 ^= v2;			\
+     v2 = STR_HASH_ROTL32 (v2, 16);					\
+   } G_STMT_END
+
+static guint32
+str_hash_load32 (const guchar *p,
+		 guint         len)
+{
+  guint32 m = 0;
+  
+  while (len--)
+    m |= ((guint32) p[len]) << (8 * len);
+  
+  return m;
+}
+
+static guint
+str_hash_sip_len (const guchar *p,
+		  guint         len)
+{
+  guint32 v0 = str_hash_key[0];
+  guint32 v1 = str_hash_key[1];
+  guint32 v2 = str_hash_key[0] ^ 0x6c796765;
+  guint32 v3 = str_hash_key[1] ^ 0x74656462;
+  guint32 m;
+  guint n = len;
+  
+  for (; n >= 4; p += 4, n -= 4)
+    {
+      m = str_hash_load32 (p, 4);
+      v3 ^= m;
+      SIP_ROUND (v0, v1, v2, v3);
+      v0 ^= m;
+    }
+  
+  m = str_hash_load32 (p, n) | ((guint32) (len & 0xff)) << 24;
+  v3 ^= m;
+  SIP_ROUND (v0, v1, v2, v3);
+  v0 ^= m;
+  
+  v2 ^= 0xff;
+  SIP_ROUND (v0, v1, v2, v3);
+  SIP_ROUND (v0, v1, v2, v3);
+  SIP_ROUND (v0, v1, v2, v3);
+  
+  return v1 ^ v3;
+}
+
+#endif /* !G_HAVE_GINT64 */
+
+/* key points to 16 random bytes, or is NULL to go back to the unkeyed
+ * hash. like the seed, the key must not be changed while any table
+ * uses g_str_hash_fast().
+ */
+void
+g_str_hash_fast_set_key (const guint8 *key)
+{
+  if (!key)
+    {
+      str_hash_keyed = FALSE;
+      return;
+    }
+  
+#ifdef G_HAVE_GINT64
+  str_hash_key[0] = str_hash_load64 (key, 8);
+  str_hash_key[1] = str_hash_load64 (key + 8, 8);
+#else
+  str_hash_key[0] = str_hash_load32 (key, 4);
+  str_hash_key[1] = str_hash_load32 (key + 4, 4);
+#endif
+  str_hash_keyed = TRUE;
+}
+
+guint
+g_str_hash_fast (gconstpointer key)
+{
+  if (str_hash_keyed)
+    return str_hash_sip_len (key, strlen (key));
+  
+  return str_hash_fast_len (key, strlen (key), str_hash_fast_seed);
+}
+
 /* String Chunks.
+ *
+ * Interned strings are found through an open addressed table of
+ * (hash, length, string) slots kept at most half full, so lookups
+ * compare stored hashes and lengths before touching the strings and
+ * growing the table never needs to rehash them.
+ *
+ * g_string_chunk_new_concurrent() creates a chunk that can be shared
+ * between threads: it is split into a power of two number of stripes,
+ * each with its own storage, table and lock, picked by the high bits of
+ * a string's hash. Like GConcurrentHashTable, the locks come from the
+ * thread function vtable, so such a chunk must be created after
+ * g_thread_init().
  */
+#define STRING_CHUNK_MIN_CONST_SIZE	16
+#define STRING_CHUNK_DEFAULT_STRIPES	16
+#define STRING_CHUNK_MAX_STRIPES	256
 
-GStringChunk*
-g_string_chunk_new (gint default_size)
+static void
+g_string_chunk_init (GRealStringChunk *chunk,
+		     gint              default_size)
 {
-  GRealStringChunk *new_chunk = g_new (GRealStringChunk, 1);
   gint size = 1;
 
   while (size < default_size)
     size <<= 1;
 
-  new_chunk->const_table       = NULL;
-  new_chunk->storage_list      = NULL;
-  new_chunk->storage_next      = size;
-  new_chunk->default_size      = size;
-  new_chunk->this_size         = size;
-
-  return (GStringChunk*) new_chunk;
+  chunk->const_table       = NULL;
+  chunk->const_size        = 0;
+  chunk->const_nnodes      = 0;
+  chunk->seed              = str_hash_fast_seed;
+  chunk->storage_list      = NULL;
+  chunk->storage_next      = size;
+  chunk->default_size      = size;
+  chunk->this_size         = size;
+  chunk->lock              = NULL;
+  chunk->n_stripes         = 0;
+  chunk->stripe_shift      = 0;
+  chunk->stripes           = NULL;
 }
 
-void
-g_string_chunk_free (GStringChunk *fchunk)
+static void
+g_string_chunk_clear (GRealStringChunk *chunk)
 {
-  GRealStringChunk *chunk = (GRealStringChunk*) fchunk;
   GSList *tmp_list;
 
-  g_return_if_fail (chunk != NULL);
-
   if (chunk->storage_list)
     {
       for (tmp_list = chunk->storage_list; tmp_list; tmp_list = tmp_list->next)
@@ -118,21 +439,98 @@ g_string_chunk_free (GStringChunk *fchunk)
       g_slist_free (chunk->storage_list);
     }
 
-  if (chunk->const_table)
-    g_hash_table_destroy (chunk->const_table);
+  g_free (chunk->const_table);
 
-  g_free (chunk);
+  if (chunk->lock)
+    g_mutex_free (chunk->lock);
 }
 
-gchar*
-g_string_chunk_insert (GStringChunk *fchunk,
-		       const gchar  *string)
+GStringChunk*
+g_string_chunk_new (gint default_size)
+{
+  GRealStringChunk *new_chunk = g_new (GRealStringChunk, 1);
+
+  g_string_chunk_init (new_chunk, default_size);
+
+  return (GStringChunk*) new_chunk;
+}
+
+GStringChunk*
+g_string_chunk_new_concurrent (gint  default_size,
+			       guint n_stripes)
+{
+  GRealStringChunk *new_chunk = g_new (GRealStringChunk, 1);
+  guint i;
+
+  if (!n_stripes)
+    n_stripes = STRING_CHUNK_DEFAULT_STRIPES;
+  n_stripes = MIN (n_stripes, STRING_CHUNK_MAX_STRIPES);
+
+  g_string_chunk_init (new_chunk, default_size);
+  new_chunk->n_stripes = 1;
+  new_chunk->stripe_shift = 32;
+  while (new_chunk->n_stripes < n_stripes)
+    {
+      new_chunk->n_stripes <<= 1;
+      new_chunk->stripe_shift--;
+    }
+
+  new_chunk->stripes = g_new (GRealStringChunk, new_chunk->n_stripes);
+  for (i = 0; i < new_chunk->n_stripes; i++)
+    {
+      g_string_chunk_init (&new_chunk->stripes[i], default_size);
+      new_chunk->stripes[i].lock = g_thread_supported () ? g_mutex_new () : NULL;
+    }
+
+  return (GStringChunk*) new_chunk;
+}
+
+void
+g_string_chunk_free (GStringChunk *fchunk)
 {
   GRealStringChunk *chunk = (GRealStringChunk*) fchunk;
-  gint len = strlen (string);
-  char* pos;
+  guint i;
 
-  g_return_val_if_fail (chunk != NULL, NULL);
+  g_return_if_fail (chunk != NULL);
+
+  for (i = 0; i < chunk->n_stripes; i++)
+    g_string_chunk_clear (&chunk->stripes[i]);
+  g_free (chunk->stripes);
+
+  g_string_chunk_clear (chunk);
+
+  g_free (chunk);
+}
+
+/* the stripe a string of the given hash lives in, the chunk itself
+ * for chunks that aren't striped; locked on return */
+static GRealStringChunk*
+g_string_chunk_lock (GRealStringChunk *chunk,
+		     guint             hash)
+{
+  if (chunk->stripes)
+    {
+      chunk = &chunk->stripes[chunk->n_stripes > 1 ? hash >> chunk->stripe_shift : 0];
+      if (chunk->lock)
+	g_mutex_lock (chunk->lock);
+    }
+
+  return chunk;
+}
+
+static void
+g_string_chunk_unlock (GRealStringChunk *chunk)
+{
+  if (chunk->lock)
+    g_mutex_unlock (chunk->lock);
+}
+
+static gchar*
+g_string_chunk_store (GRealStringChunk *chunk,
+		      const gchar      *string,
+		      guint             len)
+{
+  gchar *pos;
 
   if ((chunk->storage_next + len + 1) > chunk->this_size)
     {
@@ -150,32 +548,135 @@ g_string_chunk_insert (GStringChunk *fchunk,
 
   pos = ((char*)chunk->storage_list->data) + chunk->storage_next;
 
-  strcpy (pos, string);
+  memcpy (pos, string, len);
+  pos[len] = 0;
 
   chunk->storage_next += len + 1;
 
   return pos;
 }
 
+static void
+g_string_chunk_grow_const (GRealStringChunk *chunk)
+{
+  GStringChunkEntry *old_table = chunk->const_table;
+  guint old_size = chunk->const_size;
+  guint mask;
+  guint i;
+
+  chunk->const_size = old_size ? old_size * 2 : STRING_CHUNK_MIN_CONST_SIZE;
+  chunk->const_table = g_new0 (GStringChunkEntry, chunk->const_size);
+  mask = chunk->const_size - 1;
+
+  for (i = 0; i < old_size; i++)
+    if (old_table[i].string)
+      {
+	guint j = old_table[i].hash & mask;
+
+	while (chunk->const_table[j].string)
+	  j = (j + 1) & mask;
+	chunk->const_table[j] = old_table[i];
+      }
+
+  g_free (old_table);
+}
+
+static gchar*
+g_string_chunk_intern (GRealStringChunk *chunk,
+		       const gchar      *string,
+		       guint             len,
+		       guint             hash)
+{
+  GStringChunkEntry *entry;
+  guint mask;
+  guint i;
+
+  if ((chunk->const_nnodes + 1) * 2 > chunk->const_size)
+    g_string_chunk_grow_const (chunk);
+
+  mask = chunk->const_size - 1;
+  for (i = hash & mask; chunk->const_table[i].string; i = (i + 1) & mask)
+    {
+      entry = &chunk->const_table[i];
+      if (entry->hash == hash && entry->length == len &&
+	  memcmp (entry->string, string, len) == 0)
+	return entry->string;
+    }
+
+  entry = &chunk->const_table[i];
+  entry->hash = hash;
+  entry->length = len;
+  entry->string = g_string_chunk_store (chunk, string, len);
+  chunk->const_nnodes++;
+
+  return entry->string;
+}
+
 gchar*
-g_string_chunk_insert_const (GStringChunk *fchunk,
-			     const gchar  *string)
+g_string_chunk_insert (GStringChunk *fchunk,
+		       const gchar  *string)
+{
+  g_return_val_if_fail (fchunk != NULL, NULL);
+  g_return_val_if_fail (string != NULL, NULL);
+
+  return g_string_chunk_insert_len (fchunk, string, strlen (string));
+}
+
+gchar*
+g_string_chunk_insert_len (GStringChunk *fchunk,
+			   const gchar  *string,
+			   gint          len)
 {
   GRealStringChunk *chunk = (GRealStringChunk*) fchunk;
-  char* lookup;
+  gchar *pos;
 
   g_return_val_if_fail (chunk != NULL, NULL);
+  g_return_val_if_fail (string != NULL, NULL);
 
-  if (!chunk->const_table)
-    chunk->const_table = g_hash_table_new (g_str_hash, g_str_equal);
-
-  lookup = (char*) g_hash_table_lookup (chunk->const_table, (gchar *)string);
+  if (len < 0)
+    len = strlen (string);
 
-  if (!lookup)
+  if (chunk->stripes)
     {
-      lookup = g_string_chunk_insert (fchunk, string);
-      g_hash_table_insert (chunk->const_table, lookup, lookup);
+      chunk = g_string_chunk_lock (chunk, str_hash_fast_len ((const guchar*) string, len, chunk->seed));
+      pos = g_string_chunk_store (chunk, string, len);
+      g_string_chunk_unlock (chunk);
     }
+  else
+    pos = g_string_chunk_store (chunk, string, len);
+
+  return pos;
+}
+
+gchar*
+g_string_chunk_insert_const (GStringChunk *fchunk,
+			     const gchar  *string)
+{
+  g_return_val_if_fail (fchunk != NULL, NULL);
+  g_return_val_if_fail (string != NULL, NULL);
+
+  return g_string_chunk_insert_const_len (fchunk, string, strlen (string));
+}
+
+gchar*
+g_string_chunk_insert_const_len (GStringChunk *fchunk,
+				 const gchar  *string,
+				 gint          len)
+{
+  GRealStringChunk *chunk = (GRealStringChunk*) fchunk;
+  gchar *lookup;
+  guint hash;
+
+  g_return_val_if_fail (chunk != NULL, NULL);
+  g_return_val_if_fail (string != NULL, NULL);
+
+  if (len < 0)
+    len = strlen (string);
+
+  hash = str_hash_fast_len ((const guchar*) string, len, chunk->seed);
+  chunk = g_string_chunk_lock (chunk, hash);
+  lookup = g_string_chunk_intern (chunk, string, len, hash);
+  g_string_chunk_unlock (chunk);
 
   return lookup;
 }
@@ -194,39 +695,98 @@ nearest_pow (gint num)
 }
 
 static void
-g_string_maybe_expand (GRealString* string, gint len)
+g_string_resize (GRealString *string,
+		 gint	      alloc)
 {
-  if (string->len + len >= string->alloc)
+  gchar *str;
+
+  if (string->arena)
+    str = g_arena_alloc (string->arena, alloc);
+  else if (string->str == G_STRING_INLINE (string))
+    str = g_malloc (alloc);
+  else
     {
-      string->alloc = nearest_pow (string->len + len + 1);
-      string->str = g_realloc (string->str, string->alloc);
+      string->str = g_realloc (string->str, alloc);
+      string->alloc = alloc;
+      return;
     }
+
+  memcpy (str, string->str, string->len + 1);
+  string->str = str;
+  string->alloc = alloc;
 }
 
-GString*
-g_string_sized_new (guint dfl_size)
+static void
+g_string_maybe_expand (GRealString* string, gint len)
 {
-  GRealString *string;
+  if (string->len + len >= string->alloc)
+    g_string_resize (string, nearest_pow (string->len + len + 1));
+}
 
-  G_LOCK (string_mem_chunk);
-  if (!string_mem_chunk)
-    string_mem_chunk = g_mem_chunk_new ("string mem chunk",
-					sizeof (GRealString),
-					1024, G_ALLOC_AND_FREE);
+static GString*
+g_string_alloc (GArena *arena,
+		guint	dfl_size)
+{
+  GRealString *string;
+  gchar *block;
 
-  string = g_chunk_new (GRealString, string_mem_chunk);
-  G_UNLOCK (string_mem_chunk);
+  if (arena)
+    block = g_arena_alloc (arena, G_STRING_INLINE_SIZE + sizeof (GRealString));
+  else
+    block = g_malloc (G_STRING_INLINE_SIZE + sizeof (GRealString));
 
-  string->alloc = 0;
+  string = (GRealString*) (block + G_STRING_INLINE_SIZE);
+  string->arena = arena;
+  string->alloc = G_STRING_INLINE_SIZE;
   string->len   = 0;
-  string->str   = NULL;
-
-  g_string_maybe_expand (string, MAX (dfl_size, 2));
+  string->str   = block;
   string->str[0] = 0;
 
+  /* an explicit size is taken as is, only appending rounds up */
+  if (dfl_size >= G_STRING_INLINE_SIZE)
+    g_string_resize (string, dfl_size + 1);
+
   return (GString*) string;
 }
 
+GString*
+g_string_sized_new (guint dfl_size)
+{
+  return g_string_alloc (NULL, dfl_size);
+}
+
+/* strings created in an arena are allocated from it, also while they
+ * grow, and freed by resetting the arena, g_string_free() leaves them
+ * alone. their ->str therefore must never escape to code that g_free()s
+ * it, use g_string_steal() to get a copy that can be.
+ * GArena is not thread safe, so no other thread may touch such a string
+ * while the arena is allocated from.
+ */
+GString*
+g_string_sized_new_in_arena (GArena *arena,
+			     guint   dfl_size)
+{
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  return g_string_alloc (arena, dfl_size);
+}
+
+GString*
+g_string_new_in_arena (GArena	   *arena,
+		       const gchar *init)
+{
+  GString *string;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+
+  string = g_string_alloc (arena, 2);
+
+  if (init)
+    g_string_append (string, init);
+
+  return string;
+}
+
 GString*
 g_string_new (const gchar *init)
 {
@@ -240,18 +800,78 @@ g_string_new (const gchar *init)
   return string;
 }
 
+/* copies len bytes of init (all of it if len < 0), and allocates room
+ * for exactly that much
+ */
+GString*
+g_string_new_len (const gchar *init,
+		  gint	       len)
+{
+  GString *string;
+
+  g_return_val_if_fail (init != NULL || len <= 0, NULL);
+
+  if (!init)
+    return g_string_sized_new (2);
+
+  if (len < 0)
+    len = strlen (init);
+
+  string = g_string_sized_new (len);
+  g_string_append_len (string, init, len);
+
+  return string;
+}
+
 void
 g_string_free (GString *string,
 	       gint free_segment)
 {
+  gchar *block;
+
   g_return_if_fail (string != NULL);
 
-  if (free_segment)
-    g_free (string->str);
+  if (((GRealString*) string)->arena)
+    return;
+
+  block = G_STRING_INLINE (string);
+
+  /* a string that never left the inline storage is kept by not
+   * freeing the block at all
+   */
+  if (string->str != block)
+    {
+      if (free_segment)
+	g_free (string->str);
+      g_free (block);
+    }
+  else if (free_segment)
+    g_free (block);
+}
+
+/* hands out the buffer of a string, to be released with g_free(),
+ * and leaves the string empty but usable. only strings that live in
+ * the inline storage or in an arena have to be copied for that.
+ */
+gchar*
+g_string_steal (GString *fstring)
+{
+  GRealString *string = (GRealString*) fstring;
+  gchar *str;
+
+  g_return_val_if_fail (string != NULL, NULL);
+
+  if (string->arena || string->str == G_STRING_INLINE (string))
+    str = g_memdup (string->str, string->len + 1);
+  else
+    str = string->str;
+
+  string->str = G_STRING_INLINE (string);
+  string->alloc = G_STRING_INLINE_SIZE;
+  string->len = 0;
+  string->str[0] = 0;
 
-  G_LOCK (string_mem_chunk);
-  g_mem_chunk_free (string_mem_chunk, string);
-  G_UNLOCK (string_mem_chunk);
+  return str;
 }
 
 GString*
@@ -286,20 +906,36 @@ g_string_truncate (GString* fstring,
 GString*
 g_string_append (GString *fstring,
 		 const gchar *val)
+{
+  g_return_val_if_fail (fstring != NULL, NULL);
+  g_return_val_if_fail (val != NULL, fstring);
+
+  return g_string_append_len (fstring, val, strlen (val));
+}
+
+/* appends len bytes of val (all of it if len < 0), which may contain
+ * embedded NULs
+ */
+GString*
+g_string_append_len (GString	 *fstring,
+		     const gchar *val,
+		     gint	  len)
 {
   GRealString *string = (GRealString*)fstring;
-  int len;
 
   g_return_val_if_fail (string != NULL, NULL);
-  g_return_val_if_fail (val != NULL, fstring);
-  
-  len = strlen (val);
+  g_return_val_if_fail (val != NULL || len == 0, fstring);
+
+  if (len < 0)
+    len = strlen (val);
   g_string_maybe_expand (string, len);
 
-  strcpy (string->str + string->len, val);
+  memcpy (string->str + string->len, val, len);
 
   string->len += len;
 
+  string->str[string->len] = 0;
+
   return fstring;
 }
 
@@ -438,18 +1074,9 @@ g_string_erase (GString *fstring,
 GString*
 g_string_down (GString *fstring)
 {
-  GRealString *string = (GRealString*)fstring;
-  guchar *s;
+  g_return_val_if_fail (fstring != NULL, NULL);
 
-  g_return_val_if_fail (string != NULL, NULL);
-
-  s = string->str;
-
-  while (*s)
-    {
-      *s = tolower (*s);
-      s++;
-    }
+  g_strdown (fstring->str);
 
   return fstring;
 }
@@ -457,20 +1084,63 @@ g_string_down (GString *fstring)
 GString*
 g_string_up (GString *fstring)
 {
-  GRealString *string = (GRealString*)fstring;
-  guchar *s;
+  g_return_val_if_fail (fstring != NULL, NULL);
 
-  g_return_val_if_fail (string != NULL, NULL);
+  g_strup (fstring->str);
 
-  s = string->str;
+  return fstring;
+}
 
-  while (*s)
-    {
-      *s = toupper (*s);
-      s++;
-    }
+/* formats into a buffer on the stack, and only formats again into
+ * one of the right size if that is too small
+ */
+void
+g_string_append_vprintf (GString     *fstring,
+			 const gchar *fmt,
+			 va_list      args)
+{
+  GRealString *string = (GRealString*) fstring;
+  gchar *buffer;
 
-  return fstring;
+  g_return_if_fail (string != NULL);
+  g_return_if_fail (fmt != NULL);
+
+#ifdef HAVE_VSNPRINTF
+  {
+    gchar stack_buffer[G_STRING_PRINTF_SIZE];
+    va_list args2;
+    gint n;
+
+    /* the arguments may point into the string itself, so it is left
+     * alone until all of them are formatted
+     */
+    G_VA_COPY (args2, args);
+    n = vsnprintf (stack_buffer, sizeof (stack_buffer), fmt, args2);
+    va_end (args2);
+
+    if (n >= 0 && n < sizeof (stack_buffer))
+      {
+	g_string_append_len (fstring, stack_buffer, n);
+	return;
+      }
+
+    /* vsnprintf() implementations returning -1 on overflow are
+     * left to the slow path
+     */
+    if (n >= 0)
+      {
+	buffer = g_malloc (n + 1);
+	vsnprintf (buffer, n + 1, fmt, args);
+	g_string_append_len (fstring, buffer, n);
+	g_free (buffer);
+	return;
+      }
+  }
+#endif	/* HAVE_VSNPRINTF */
+
+  buffer = g_strdup_vprintf (fmt, args);
+  g_string_append (fstring, buffer);
+  g_free (buffer);
 }
 
 static void
@@ -478,11 +1148,7 @@ g_string_sprintfa_int (GString     *string,
 		       const gchar *fmt,
 		       va_list      args)
 {
-  gchar *buffer;
-
-  buffer = g_strdup_vprintf (fmt, args);
-  g_string_append (string, buffer);
-  g_free (buffer);
+  g_string_append_vprintf (string, fmt, args);
 }
 
 void
@@ -33,3 +33,6 @@
 
 static GThreadFunctions
 g_thread_functions_for_glib_use_default; /* is NULLified */
+
+static GThreadCreateFunc
+g_thread_create_func_default = NULL;
@@ -223,3 +223,14 @@ static GThreadFunctions g_thread_functions_for_glib_use_default =
   g_private_get_nspr_impl,
   g_private_set_nspr_impl
 };
+
+static gboolean
+g_thread_create_nspr_impl (GThreadFunc func,
+			   gpointer    data)
+{
+  return PR_CreateThread (PR_USER_THREAD, func, data, PR_PRIORITY_NORMAL,
+			  PR_GLOBAL_THREAD, PR_UNJOINABLE_THREAD, 0) != NULL;
+}
+
+static GThreadCreateFunc
+g_thread_create_func_default = g_thread_create_nspr_impl;
@@ -37,6 +37,12 @@
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
+#ifdef G_MUTEX_IMPL_FUTEX
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 #define posix_print_error( name, num )                          \
   g_error( "file %s: line %d (%s): error %s during %s",         \
@@ -48,6 +54,11 @@
   if( error ) { posix_print_error( what, error ); }             \
   }G_STMT_END
 
+#define G_MICROSEC 1000000
+#define G_NANOSEC 1000000000
+
+#ifndef G_MUTEX_IMPL_FUTEX
+
 static GMutex *
 g_mutex_new_posix_impl (void)
 {
@@ -100,9 +111,6 @@ g_cond_new_posix_impl (void)
    without error check then!!!!, we might want to change this
    therfore. */
 
-#define G_MICROSEC 1000000
-#define G_NANOSEC 1000000000
-
 static gboolean
 g_cond_timed_wait_posix_impl (GCond * cond,
 			      GMutex * entered_mutex,
@@ -144,6 +152,8 @@ g_cond_free_posix_impl (GCond * cond)
   g_free (cond);
 }
 
+#endif /* !G_MUTEX_IMPL_FUTEX */
+
 static GPrivate *
 g_private_new_posix_impl (GDestroyNotify destructor)
 {
@@ -181,8 +191,176 @@ g_private_get_posix_impl (GPrivate * private_key)
 #endif /* HAVE_PTHREAD_GETSPECIFIC_POSIX */
 }
 
+#ifdef G_MUTEX_IMPL_FUTEX
+
+/* Mutexes and conditions are futexes, see glib.h for the mutex states
+ * (after Ulrich Drepper's "Futexes Are Tricky").  A condition is a
+ * sequence number, bumped by every signal, that waiters sleep on as
+ * long as it stays the same.  Waking up from a condition, a thread
+ * takes the mutex as contended, as others woken with it may be asleep
+ * on the mutex by then and have to be woken in turn.
+ */
+#define G_MUTEX_SPIN 100
+
+#define g_futex(word, op, val, timeout, val3) \
+  syscall (SYS_futex, (word), (op), (val), (timeout), NULL, (val3))
+
+static GMutex *
+g_mutex_new_futex_impl (void)
+{
+  return (GMutex *) g_new0 (gint, 1);
+}
+
+/* marks the mutex as contended, returns whether it was unlocked */
+static inline gboolean
+g_mutex_take_contended (gint *word)
+{
+  gint old;
+
+  do
+    old = g_atomic_int_get (word);
+  while (old != 2 && !g_atomic_int_compare_and_exchange (word, old, 2));
+
+  return old == 0;
+}
+
+static inline void
+g_mutex_lock_contended (gint *word)
+{
+  while (!g_mutex_take_contended (word))
+    g_futex (word, FUTEX_WAIT_PRIVATE, 2, NULL, 0);
+}
+
+static void
+g_mutex_lock_futex_impl (GMutex * mutex)
+{
+  gint *word = (gint *) mutex;
+  guint i;
+
+  for (i = 0; i < G_MUTEX_SPIN; i++)
+    {
+      if (g_atomic_int_compare_and_exchange (word, 0, 1))
+	return;
+      if (g_atomic_int_get (word) == 2)
+	break;
+    }
+
+  g_mutex_lock_contended (word);
+}
+
+static gboolean
+g_mutex_trylock_futex_impl (GMutex * mutex)
+{
+  return g_atomic_int_compare_and_exchange ((gint *) mutex, 0, 1);
+}
+
+static void
+g_mutex_unlock_futex_impl (GMutex * mutex)
+{
+  gint *word = (gint *) mutex;
+
+  if (g_atomic_int_exchange_and_add (word, -1) != 1)
+    {
+      g_atomic_int_set (word, 0);
+      g_futex (word, FUTEX_WAKE_PRIVATE, 1, NULL, 0);
+    }
+}
+
+static void
+g_mutex_free_futex_impl (GMutex * mutex)
+{
+  g_free (mutex);
+}
+
+static GCond *
+g_cond_new_futex_impl (void)
+{
+  return (GCond *) g_new0 (gint, 1);
+}
+
+static void
+g_cond_signal_futex_impl (GCond * cond)
+{
+  g_atomic_int_inc ((gint *) cond);
+  g_futex (cond, FUTEX_WAKE_PRIVATE, 1, NULL, 0);
+}
+
+static void
+g_cond_broadcast_futex_impl (GCond * cond)
+{
+  g_atomic_int_inc ((gint *) cond);
+  g_futex (cond, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, 0);
+}
+
+static void
+g_cond_wait_futex_impl (GCond * cond,
+			GMutex * entered_mutex)
+{
+  gint sequence = g_atomic_int_get ((gint *) cond);
+
+  g_mutex_unlock_futex_impl (entered_mutex);
+  g_futex (cond, FUTEX_WAIT_PRIVATE, sequence, NULL, 0);
+  g_mutex_lock_contended ((gint *) entered_mutex);
+}
+
+static gboolean
+g_cond_timed_wait_futex_impl (GCond * cond,
+			      GMutex * entered_mutex,
+			      GTimeVal * abs_time)
+{
+  struct timespec end_time;
+  gint sequence;
+  gboolean timed_out;
+
+  g_return_val_if_fail (cond != NULL, FALSE);
+  g_return_val_if_fail (entered_mutex != NULL, FALSE);
+
+  if (!abs_time)
+    {
+      g_cond_wait_futex_impl (cond, entered_mutex);
+      return TRUE;
+    }
+
+  end_time.tv_sec = abs_time->tv_sec;
+  end_time.tv_nsec = abs_time->tv_usec * (G_NANOSEC / G_MICROSEC);
+  g_assert (end_time.tv_nsec < G_NANOSEC);
+
+  sequence = g_atomic_int_get ((gint *) cond);
+  g_mutex_unlock_futex_impl (entered_mutex);
+  /* FUTEX_WAIT takes a relative timeout, the bitset variant an
+   * absolute one on the clock asked for
+   */
+  timed_out = (g_futex (cond, FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME,
+			sequence, &end_time, FUTEX_BITSET_MATCH_ANY) == -1 &&
+	       errno == ETIMEDOUT);
+  g_mutex_lock_contended ((gint *) entered_mutex);
+
+  return !timed_out;
+}
+
+static void
+g_cond_free_futex_impl (GCond * cond)
+{
+  g_free (cond);
+}
+
+#endif /* G_MUTEX_IMPL_FUTEX */
+
 static GThreadFunctions g_thread_functions_for_glib_use_default =
 {
+#ifdef G_MUTEX_IMPL_FUTEX
+  g_mutex_new_futex_impl,
+  g_mutex_lock_futex_impl,
+  g_mutex_trylock_futex_impl,
+  g_mutex_unlock_futex_impl,
+  g_mutex_free_futex_impl,
+  g_cond_new_futex_impl,
+  g_cond_signal_futex_impl,
+  g_cond_broadcast_futex_impl,
+  g_cond_wait_futex_impl,
+  g_cond_timed_wait_futex_impl,
+  g_cond_free_futex_impl,
+#else /* !G_MUTEX_IMPL_FUTEX */
   g_mutex_new_posix_impl,
   (void (*)(GMutex *)) pthread_mutex_lock,
   g_mutex_trylock_posix_impl,
@@ -194,7 +372,55 @@ static GThreadFunctions g_thread_functions_for_glib_use_default =
   (void (*)(GCond *, GMutex *)) pthread_cond_wait,
   g_cond_timed_wait_posix_impl,
   g_cond_free_posix_impl,
+#endif /* !G_MUTEX_IMPL_FUTEX */
   g_private_new_posix_impl,
   g_private_get_posix_impl,
   g_private_set_posix_impl
 };
+
+typedef struct _GThreadStartPosix GThreadStartPosix;
+struct _GThreadStartPosix
+{
+  GThreadFunc func;
+  gpointer data;
+};
+
+static void*
+g_thread_start_posix (void *arg)
+{
+  GThreadStartPosix start = *(GThreadStartPosix*) arg;
+
+  g_free (arg);
+  start.func (start.data);
+
+  return NULL;
+}
+
+static gboolean
+g_thread_create_posix_impl (GThreadFunc func,
+			    gpointer    data)
+{
+  GThreadStartPosix *start = g_new (GThreadStartPosix, 1);
+  pthread_attr_t attr;
+  pthread_t thread;
+  int error;
+
+  start->func = func;
+  start->data = data;
+
+  posix_check_for_error (pthread_attr_init (&attr));
+  posix_check_for_error (pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED));
+  error = pthread_create (&thread, &attr, g_thread_start_posix, start);
+  posix_check_for_error (pthread_attr_destroy (&attr));
+
+  if (error)
+    {
+      g_free (start);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GThreadCreateFunc
+g_thread_create_func_default = g_thread_create_posix_impl;
@@ -182,3 +182,42 @@ static GThreadFunctions g_thread_functions_for_glib_use_default =
   g_private_get_solaris_impl,
   g_private_set_solaris_impl
 };
+
+typedef struct _GThreadStartSolaris GThreadStartSolaris;
+struct _GThreadStartSolaris
+{
+  GThreadFunc func;
+  gpointer data;
+};
+
+static void*
+g_thread_start_solaris (void *arg)
+{
+  GThreadStartSolaris start = *(GThreadStartSolaris*) arg;
+
+  g_free (arg);
+  start.func (start.data);
+
+  return NULL;
+}
+
+static gboolean
+g_thread_create_solaris_impl (GThreadFunc func,
+			      gpointer    data)
+{
+  GThreadStartSolaris *start = g_new (GThreadStartSolaris, 1);
+
+  start->func = func;
+  start->data = data;
+
+  if (thr_create (NULL, 0, g_thread_start_solaris, start, THR_DETACHED, NULL))
+    {
+      g_free (start);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GThreadCreateFunc
+g_thread_create_func_default = g_thread_create_solaris_impl;
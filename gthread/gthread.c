@@ -44,6 +44,7 @@ static gboolean thread_system_already_initialized = FALSE;
 void g_mutex_init (void);
 void g_mem_init (void);
 void g_messages_init (void);
+void g_thread_create_init (GThreadCreateFunc create_func);
 
 void
 g_thread_init (GThreadFunctions* init)
@@ -103,6 +104,10 @@ g_thread_init (GThreadFunctions* init)
   g_mem_init ();
   g_messages_init ();
 
+  /* threads can only be created by the default implementation */
+  if (g_thread_use_default_impl)
+    g_thread_create_init (g_thread_create_func_default);
+
   /* now we can set g_threads_got_initialized and thus enable
    * all the thread functions
    */
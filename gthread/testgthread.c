@@ -87,10 +87,11 @@ new_thread(GHookFunc func, gpointer data)
      pthread_attr_setdetachstate (&pthread_attr, PTHREAD_CREATE_JOINABLE);
   */
   pthread_create (&thread, &pthread_attr, (void *(*)(void *)) func, data);
-  return GUINT_TO_POINTER (thread);
+  /* pthread_t doesn't fit into a guint on LP64 systems */
+  return (gpointer) (gulong) thread;
 }
 #define join_thread(thread) \
-  pthread_join ((pthread_t)GPOINTER_TO_UINT (thread), NULL)
+  pthread_join ((pthread_t) (gulong) (thread), NULL)
 #define self_thread() GUINT_TO_POINTER (pthread_self ())
 
 #else /* we are not having a thread implementation, do nothing */
@@ -199,6 +200,970 @@ test_private (void)
   g_print ("\n");
 }
 
+#define TEST_MAX_THREADS 16
+
+/* runs func (GUINT_TO_POINTER (i)) for every i < n_threads in a thread
+ * of its own and waits for all of them, or runs them one after
+ * another without a thread implementation
+ */
+void
+run_test_threads (GHookFunc func, guint n_threads)
+{
+  gpointer threads[TEST_MAX_THREADS];
+  guint i;
+
+  g_assert (n_threads <= TEST_MAX_THREADS);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      threads[i] = new_thread (func, GUINT_TO_POINTER (i));
+      if (!threads[i])
+	func (GUINT_TO_POINTER (i));
+    }
+  for (i = 0; i < n_threads; i++)
+    if (threads[i])
+      join_thread (threads[i]);
+}
+
+#define TEST_RW_LOCK_THREADS 8
+#define TEST_RW_LOCK_ROUNDS 20000
+
+GStaticRWLock rw_lock = G_STATIC_RW_LOCK_INIT;
+guint rw_lock_a = 0, rw_lock_b = 0;
+GMutex *rw_lock_done_mutex;
+GCond *rw_lock_done_cond;
+guint rw_lock_done = 0;
+
+void
+test_rw_lock_func (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < TEST_RW_LOCK_ROUNDS; i++)
+    {
+      if (i % 10 == GPOINTER_TO_UINT (data) % 10)
+	{
+	  g_static_rw_lock_writer_lock (&rw_lock);
+	  rw_lock_a++;
+	  rw_lock_b++;
+	  g_static_rw_lock_writer_unlock (&rw_lock);
+	}
+      else
+	{
+	  g_static_rw_lock_reader_lock (&rw_lock);
+	  g_assert (rw_lock_a == rw_lock_b);
+	  g_static_rw_lock_reader_unlock (&rw_lock);
+	}
+    }
+
+  g_mutex_lock (rw_lock_done_mutex);
+  rw_lock_done++;
+  g_cond_signal (rw_lock_done_cond);
+  g_mutex_unlock (rw_lock_done_mutex);
+}
+
+void
+test_rw_lock (void)
+{
+  guint i;
+
+  g_assert (g_static_rw_lock_reader_trylock (&rw_lock));
+  g_assert (g_static_rw_lock_reader_trylock (&rw_lock));
+  g_assert (!g_static_rw_lock_writer_trylock (&rw_lock));
+  g_static_rw_lock_reader_unlock (&rw_lock);
+  g_static_rw_lock_reader_unlock (&rw_lock);
+  g_assert (g_static_rw_lock_writer_trylock (&rw_lock));
+  g_assert (!g_static_rw_lock_reader_trylock (&rw_lock));
+  g_static_rw_lock_writer_unlock (&rw_lock);
+
+  rw_lock_done_mutex = g_mutex_new ();
+  rw_lock_done_cond = g_cond_new ();
+
+  for (i = 0; i < TEST_RW_LOCK_THREADS; i++)
+    if (!g_thread_create (test_rw_lock_func, GUINT_TO_POINTER (i)))
+      test_rw_lock_func (GUINT_TO_POINTER (i));
+
+  g_mutex_lock (rw_lock_done_mutex);
+  while (rw_lock_done < TEST_RW_LOCK_THREADS)
+    g_cond_wait (rw_lock_done_cond, rw_lock_done_mutex);
+  g_mutex_unlock (rw_lock_done_mutex);
+
+  g_assert (rw_lock_a == TEST_RW_LOCK_THREADS * TEST_RW_LOCK_ROUNDS / 10);
+
+  g_static_rw_lock_free (&rw_lock);
+  g_cond_free (rw_lock_done_cond);
+  g_mutex_free (rw_lock_done_mutex);
+}
+
+#define TEST_MEM_CHUNK_THREADS 4
+#define TEST_MEM_CHUNK_ATOMS 5000
+#define TEST_MEM_CHUNK_ROUNDS 5
+
+typedef struct {
+  guint value;
+  gpointer pad;
+} TestMemChunkAtom;
+
+GMemChunk *mem_chunk_mt;
+TestMemChunkAtom *mem_chunk_atoms[TEST_MEM_CHUNK_THREADS][TEST_MEM_CHUNK_ATOMS];
+
+void
+test_mem_chunk_alloc_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+  guint i;
+
+  for (i = 0; i < TEST_MEM_CHUNK_ATOMS; i++)
+    {
+      mem_chunk_atoms[t][i] = g_chunk_new (TestMemChunkAtom, mem_chunk_mt);
+      mem_chunk_atoms[t][i]->value = t * TEST_MEM_CHUNK_ATOMS + i;
+    }
+
+  /* churn through the thread's own cache */
+  for (i = 0; i < TEST_MEM_CHUNK_ATOMS; i += 2)
+    {
+      g_chunk_free (mem_chunk_atoms[t][i], mem_chunk_mt);
+      mem_chunk_atoms[t][i] = g_chunk_new (TestMemChunkAtom, mem_chunk_mt);
+      mem_chunk_atoms[t][i]->value = t * TEST_MEM_CHUNK_ATOMS + i;
+    }
+}
+
+/* frees the atoms the next thread allocated */
+void
+test_mem_chunk_free_func (gpointer data)
+{
+  guint t = (GPOINTER_TO_UINT (data) + 1) % TEST_MEM_CHUNK_THREADS;
+  guint i;
+
+  for (i = 0; i < TEST_MEM_CHUNK_ATOMS; i++)
+    {
+      g_assert (mem_chunk_atoms[t][i]->value == t * TEST_MEM_CHUNK_ATOMS + i);
+      g_chunk_free (mem_chunk_atoms[t][i], mem_chunk_mt);
+      mem_chunk_atoms[t][i] = NULL;
+    }
+}
+
+void
+test_mem_chunk (void)
+{
+  guint round;
+
+  mem_chunk_mt = g_mem_chunk_new ("mt test chunk", sizeof (TestMemChunkAtom),
+				  sizeof (TestMemChunkAtom) * 64,
+				  G_ALLOC_AND_FREE_MT);
+
+  /* every round allocates in all threads at once, checks that no atom
+   * was handed out twice and frees each thread's atoms in another one,
+   * whose atoms the next round picks up again
+   */
+  for (round = 0; round < TEST_MEM_CHUNK_ROUNDS; round++)
+    {
+      run_test_threads (test_mem_chunk_alloc_func, TEST_MEM_CHUNK_THREADS);
+      run_test_threads (test_mem_chunk_free_func, TEST_MEM_CHUNK_THREADS);
+    }
+
+  g_mem_chunk_destroy (mem_chunk_mt);
+}
+
+#define TEST_MAGAZINE_THREADS 4
+#define TEST_MAGAZINE_NODES 5000	/* per thread, many magazines full */
+#define TEST_MAGAZINE_ROUNDS 5
+
+GList *magazine_lists[TEST_MAGAZINE_THREADS];
+GSList *magazine_slists[TEST_MAGAZINE_THREADS];
+GNode *magazine_nodes[TEST_MAGAZINE_THREADS];
+gulong magazine_bytes[3];
+
+void
+test_magazine_alloc_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+  guint i;
+
+  magazine_nodes[t] = g_node_new (GUINT_TO_POINTER (t));
+  for (i = 0; i < TEST_MAGAZINE_NODES; i++)
+    {
+      gpointer value = GUINT_TO_POINTER ((t << 16) | i);
+
+      magazine_lists[t] = g_list_prepend (magazine_lists[t], value);
+      magazine_slists[t] = g_slist_prepend (magazine_slists[t], value);
+      g_node_prepend_data (magazine_nodes[t], value);
+    }
+}
+
+/* checks and frees the nodes the next thread allocated, the lists a
+ * node at a time for one half and all at once for the other
+ */
+void
+test_magazine_free_func (gpointer data)
+{
+  guint t = (GPOINTER_TO_UINT (data) + 1) % TEST_MAGAZINE_THREADS;
+  GList *list = magazine_lists[t];
+  GSList *slist = magazine_slists[t];
+  GNode *node;
+  guint i = TEST_MAGAZINE_NODES;
+
+  for (node = magazine_nodes[t]->children; node; node = node->next)
+    g_assert (GPOINTER_TO_UINT (node->data) == ((t << 16) | --i));
+  g_assert (i == 0);
+  g_node_destroy (magazine_nodes[t]);
+
+  for (i = TEST_MAGAZINE_NODES; i > TEST_MAGAZINE_NODES / 2; i--)
+    {
+      GList *next = list->next;
+      GSList *snext = slist->next;
+
+      g_assert (GPOINTER_TO_UINT (list->data) == ((t << 16) | (i - 1)));
+      g_assert (GPOINTER_TO_UINT (slist->data) == ((t << 16) | (i - 1)));
+      g_list_free_1 (list);
+      g_slist_free_1 (slist);
+      list = next;
+      slist = snext;
+    }
+  g_assert (g_list_length (list) == TEST_MAGAZINE_NODES / 2);
+  g_assert (g_slist_length (slist) == TEST_MAGAZINE_NODES / 2);
+  g_list_free (list);
+  g_slist_free (slist);
+
+  magazine_lists[t] = NULL;
+  magazine_slists[t] = NULL;
+  magazine_nodes[t] = NULL;
+}
+
+void
+test_magazine_log_handler (const gchar   *log_domain,
+			   GLogLevelFlags log_level,
+			   const gchar   *message,
+			   gpointer       user_data)
+{
+  const gchar *names[] = {
+    "GLib default GList allocator: ",
+    "GLib default GSList allocator: ",
+    "GLib default GNode allocator: ",
+  };
+  guint i;
+
+  for (i = 0; i < 3; i++)
+    if (strncmp (message, names[i], strlen (names[i])) == 0)
+      sscanf (message + strlen (names[i]), "%lu", &magazine_bytes[i]);
+}
+
+/* the bytes the default allocators took from their memory chunks */
+void
+test_magazine_get_bytes (gulong bytes[3])
+{
+  guint handler;
+
+  handler = g_log_set_handler ("GLib", G_LOG_LEVEL_INFO,
+			       test_magazine_log_handler, NULL);
+  g_mem_chunk_info ();
+  g_log_remove_handler ("GLib", handler);
+  memcpy (bytes, magazine_bytes, sizeof (magazine_bytes));
+}
+
+void
+test_magazine (void)
+{
+  gulong bytes[3], first[3];
+  guint round;
+
+  /* every round allocates in threads that exit with their magazines
+   * full, and frees in other threads, which exit as well; once the
+   * first rounds took the memory they need (including a few nodes for
+   * this thread), the later ones get along with the nodes the exiting
+   * threads handed back
+   */
+  for (round = 0; round < TEST_MAGAZINE_ROUNDS; round++)
+    {
+      run_test_threads (test_magazine_alloc_func, TEST_MAGAZINE_THREADS);
+      run_test_threads (test_magazine_free_func, TEST_MAGAZINE_THREADS);
+
+      test_magazine_get_bytes (round > 1 ? bytes : first);
+      if (round > 1)
+	g_assert (memcmp (bytes, first, sizeof (bytes)) == 0);
+    }
+  g_assert (first[0] >= TEST_MAGAZINE_THREADS * TEST_MAGAZINE_NODES * sizeof (GList));
+  g_assert (first[1] >= TEST_MAGAZINE_THREADS * TEST_MAGAZINE_NODES * sizeof (GSList));
+  g_assert (first[2] >= TEST_MAGAZINE_THREADS * TEST_MAGAZINE_NODES * sizeof (GNode));
+}
+
+#define TEST_CONCURRENT_HASH_THREADS 4
+#define TEST_CONCURRENT_HASH_KEYS 20000	/* per thread */
+
+GConcurrentHashTable *concurrent_hash;
+
+/* key i of thread t is i * threads + t + 1, so that all threads hit
+ * all shards; each value is its key plus one
+ */
+#define TEST_CONCURRENT_HASH_KEY(t, i) \
+  GUINT_TO_POINTER ((i) * TEST_CONCURRENT_HASH_THREADS + (t) + 1)
+
+void
+test_concurrent_hash_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+  guint i, o;
+
+  for (i = 0; i < TEST_CONCURRENT_HASH_KEYS; i++)
+    {
+      gpointer key = TEST_CONCURRENT_HASH_KEY (t, i);
+
+      g_concurrent_hash_table_insert (concurrent_hash, key,
+				      GUINT_TO_POINTER (GPOINTER_TO_UINT (key) + 1));
+    }
+
+  /* the thread's own keys are all there, those of the others may or
+   * may not be yet, but are never seen with a wrong value
+   */
+  for (i = 0; i < TEST_CONCURRENT_HASH_KEYS; i++)
+    for (o = 0; o < TEST_CONCURRENT_HASH_THREADS; o++)
+      {
+	gpointer key = TEST_CONCURRENT_HASH_KEY (o, i);
+	gpointer value = g_concurrent_hash_table_lookup (concurrent_hash, key);
+
+	if (o == t)
+	  g_assert (value != NULL);
+	if (value)
+	  g_assert (GPOINTER_TO_UINT (value) == GPOINTER_TO_UINT (key) + 1);
+      }
+
+  /* removing every other key while the others do the same */
+  for (i = 0; i < TEST_CONCURRENT_HASH_KEYS; i += 2)
+    {
+      gpointer key = TEST_CONCURRENT_HASH_KEY (t, i);
+
+      g_concurrent_hash_table_remove (concurrent_hash, key);
+      g_assert (g_concurrent_hash_table_lookup (concurrent_hash, key) == NULL);
+    }
+}
+
+void
+test_concurrent_hash_count (gpointer key, gpointer value, gpointer user_data)
+{
+  guint *n = user_data;
+
+  g_assert (GPOINTER_TO_UINT (value) == GPOINTER_TO_UINT (key) + 1);
+  (*n)++;
+}
+
+void
+test_concurrent_hash (void)
+{
+  guint t, i, n = 0;
+
+  concurrent_hash = g_concurrent_hash_table_new (g_direct_hash, NULL, 0);
+
+  run_test_threads (test_concurrent_hash_func, TEST_CONCURRENT_HASH_THREADS);
+
+  g_assert (g_concurrent_hash_table_size (concurrent_hash) ==
+	    TEST_CONCURRENT_HASH_THREADS * TEST_CONCURRENT_HASH_KEYS / 2);
+  for (t = 0; t < TEST_CONCURRENT_HASH_THREADS; t++)
+    for (i = 0; i < TEST_CONCURRENT_HASH_KEYS; i++)
+      {
+	gpointer key = TEST_CONCURRENT_HASH_KEY (t, i);
+	gpointer value = g_concurrent_hash_table_lookup (concurrent_hash, key);
+
+	if (i % 2)
+	  g_assert (GPOINTER_TO_UINT (value) == GPOINTER_TO_UINT (key) + 1);
+	else
+	  g_assert (value == NULL);
+      }
+  g_concurrent_hash_table_foreach (concurrent_hash, test_concurrent_hash_count, &n);
+  g_assert (n == TEST_CONCURRENT_HASH_THREADS * TEST_CONCURRENT_HASH_KEYS / 2);
+
+  g_concurrent_hash_table_destroy (concurrent_hash);
+}
+
+#define TEST_STRING_ARENA_THREADS 4
+
+gchar *string_arena_strings[TEST_STRING_ARENA_THREADS][2];
+
+void
+test_string_arena_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+  GArena *arena = g_arena_new (0);
+  GString *string;
+  guint i;
+
+  /* every thread builds in its own arena, the strings it makes with
+   * g_string_new() meanwhile are plain ones, to be g_free()d later
+   */
+  string = g_string_new_in_arena (arena, "from the arena");
+  for (i = 0; i < 10; i++)
+    g_string_append (string, " and more");
+  string_arena_strings[t][0] = g_string_steal (string);
+
+  string = g_string_new ("not from the arena");
+  string_arena_strings[t][1] = string->str;
+  g_string_free (string, FALSE);
+
+  g_arena_reset (arena, NULL);
+  for (i = 0; i < 16; i++)
+    memset (g_arena_alloc (arena, 128), 'x', 128);
+  g_arena_destroy (arena);
+}
+
+void
+test_string_arena (void)
+{
+  guint i;
+
+  run_test_threads (test_string_arena_func, TEST_STRING_ARENA_THREADS);
+
+  for (i = 0; i < TEST_STRING_ARENA_THREADS; i++)
+    {
+      g_assert (strncmp (string_arena_strings[i][0], "from the arena and more", 23) == 0);
+      g_assert (strlen (string_arena_strings[i][0]) == 14 + 10 * 9);
+      g_assert (strcmp (string_arena_strings[i][1], "not from the arena") == 0);
+      g_free (string_arena_strings[i][0]);
+      g_free (string_arena_strings[i][1]);
+    }
+}
+
+#define TEST_ASYNC_QUEUE_PRODUCERS 4
+#define TEST_ASYNC_QUEUE_CONSUMERS 4
+#define TEST_ASYNC_QUEUE_ITEMS 20000	/* per producer, more than the ring */
+#define TEST_ASYNC_QUEUE_END ((guint) ~0)
+
+GAsyncQueue *async_queue;
+gint async_queue_producing;
+guint8 async_queue_seen[TEST_ASYNC_QUEUE_PRODUCERS][TEST_ASYNC_QUEUE_ITEMS];
+guint async_queue_popped[TEST_ASYNC_QUEUE_CONSUMERS];
+
+/* the first threads produce, the others consume, until they get one of
+ * the end markers that the last producer queues behind everything else
+ */
+void
+test_async_queue_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+
+  if (t < TEST_ASYNC_QUEUE_PRODUCERS)
+    {
+      guint i;
+
+      for (i = 0; i < TEST_ASYNC_QUEUE_ITEMS; i++)
+	g_async_queue_push (async_queue, GUINT_TO_POINTER ((t << 24) | (i + 1)));
+
+      if (g_atomic_int_dec_and_test (&async_queue_producing))
+	for (i = 0; i < TEST_ASYNC_QUEUE_CONSUMERS; i++)
+	  g_async_queue_push (async_queue, GUINT_TO_POINTER (TEST_ASYNC_QUEUE_END));
+    }
+  else
+    {
+      guint last[TEST_ASYNC_QUEUE_PRODUCERS] = { 0 };
+      guint item;
+
+      t -= TEST_ASYNC_QUEUE_PRODUCERS;
+      while ((item = GPOINTER_TO_UINT (g_async_queue_pop (async_queue))) != TEST_ASYNC_QUEUE_END)
+	{
+	  guint producer = item >> 24;
+	  guint seq = item & 0xffffff;
+
+	  /* a single consumer sees each producer's items in order */
+	  g_assert (producer < TEST_ASYNC_QUEUE_PRODUCERS);
+	  g_assert (seq > last[producer] && seq <= TEST_ASYNC_QUEUE_ITEMS);
+	  last[producer] = seq;
+
+	  g_assert (!async_queue_seen[producer][seq - 1]);
+	  async_queue_seen[producer][seq - 1] = TRUE;
+	  async_queue_popped[t]++;
+	}
+    }
+}
+
+void
+test_async_queue (void)
+{
+  guint i, j, n = 0;
+
+  async_queue = g_async_queue_new ();
+  async_queue_producing = TEST_ASYNC_QUEUE_PRODUCERS;
+
+  run_test_threads (test_async_queue_func,
+		    TEST_ASYNC_QUEUE_PRODUCERS + TEST_ASYNC_QUEUE_CONSUMERS);
+
+  /* nothing got lost */
+  for (i = 0; i < TEST_ASYNC_QUEUE_CONSUMERS; i++)
+    n += async_queue_popped[i];
+  g_assert (n == TEST_ASYNC_QUEUE_PRODUCERS * TEST_ASYNC_QUEUE_ITEMS);
+  for (i = 0; i < TEST_ASYNC_QUEUE_PRODUCERS; i++)
+    for (j = 0; j < TEST_ASYNC_QUEUE_ITEMS; j++)
+      g_assert (async_queue_seen[i][j]);
+  g_assert (g_async_queue_length (async_queue) == 0);
+
+  g_async_queue_unref (async_queue);
+}
+
+#define TEST_THREAD_POOL_THREADS 4
+#define TEST_THREAD_POOL_FANOUT 100	/* more than a deque starts with */
+#define TEST_THREAD_POOL_QUEUED 50
+
+GThreadPool *thread_pool;
+GMutex *thread_pool_mutex;
+GCond *thread_pool_cond;
+guint thread_pool_n = 0;
+gboolean thread_pool_open = FALSE;
+
+void
+test_thread_pool_count (void)
+{
+  g_mutex_lock (thread_pool_mutex);
+  thread_pool_n++;
+  g_cond_broadcast (thread_pool_cond);
+  g_mutex_unlock (thread_pool_mutex);
+}
+
+/* waits up to 10 seconds for thread_pool_n to reach n */
+gboolean
+test_thread_pool_wait (guint n)
+{
+  GTimeVal end_time;
+  gboolean reached;
+
+  g_get_current_time (&end_time);
+  end_time.tv_sec += 10;
+
+  g_mutex_lock (thread_pool_mutex);
+  while (thread_pool_n < n &&
+	 g_cond_timed_wait (thread_pool_cond, thread_pool_mutex, &end_time))
+    ;
+  reached = thread_pool_n >= n;
+  g_mutex_unlock (thread_pool_mutex);
+
+  return reached;
+}
+
+/* jobs of depth 0 and 1 push a fanout of jobs one level deeper from
+ * inside the pool
+ */
+void
+test_thread_pool_recursive_func (gpointer data, gpointer user_data)
+{
+  guint depth = GPOINTER_TO_UINT (data) - 1;
+  guint i;
+
+  if (depth < 2)
+    for (i = 0; i < (depth ? 10 : TEST_THREAD_POOL_FANOUT); i++)
+      g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (depth + 2)));
+
+  test_thread_pool_count ();
+}
+
+/* the root job pushes its children onto its own deque and then blocks
+ * until they are done, so other workers have to steal every one
+ */
+void
+test_thread_pool_steal_func (gpointer data, gpointer user_data)
+{
+  guint i;
+
+  if (GPOINTER_TO_UINT (data) == 1)
+    {
+      for (i = 0; i < TEST_THREAD_POOL_FANOUT; i++)
+	g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (2)));
+      g_assert (test_thread_pool_wait (TEST_THREAD_POOL_FANOUT));
+    }
+  else
+    test_thread_pool_count ();
+}
+
+/* the first job holds the only worker until the gate opens */
+void
+test_thread_pool_gate_func (gpointer data, gpointer user_data)
+{
+  if (GPOINTER_TO_UINT (data) == 1)
+    {
+      test_thread_pool_count ();
+      g_mutex_lock (thread_pool_mutex);
+      while (!thread_pool_open)
+	g_cond_wait (thread_pool_cond, thread_pool_mutex);
+      g_mutex_unlock (thread_pool_mutex);
+    }
+  test_thread_pool_count ();
+}
+
+void
+test_thread_pool_open_gate (gpointer data)
+{
+  wait_thread (0.1);
+
+  g_mutex_lock (thread_pool_mutex);
+  thread_pool_open = TRUE;
+  g_cond_broadcast (thread_pool_cond);
+  g_mutex_unlock (thread_pool_mutex);
+}
+
+/* fills the pool's queue behind a blocked job and frees the pool
+ * while another thread opens the gate
+ */
+void
+test_thread_pool_shutdown (gboolean immediate)
+{
+  gpointer gate_thread;
+  guint i, n;
+
+  thread_pool_n = 0;
+  thread_pool_open = FALSE;
+  thread_pool = g_thread_pool_new (test_thread_pool_gate_func, NULL, 1);
+
+  g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (1)));
+  g_assert (test_thread_pool_wait (1));
+  for (i = 0; i < TEST_THREAD_POOL_QUEUED; i++)
+    g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (2)));
+  g_assert (g_thread_pool_unprocessed (thread_pool) == TEST_THREAD_POOL_QUEUED);
+
+  gate_thread = new_thread (test_thread_pool_open_gate, NULL);
+  if (!gate_thread)
+    test_thread_pool_open_gate (NULL);
+  g_thread_pool_free (thread_pool, immediate);
+  if (gate_thread)
+    join_thread (gate_thread);
+
+  /* the running job always finishes, the queued ones only without
+   * immediate, and nothing runs once the pool is gone
+   */
+  g_mutex_lock (thread_pool_mutex);
+  n = thread_pool_n;
+  g_mutex_unlock (thread_pool_mutex);
+  if (immediate)
+    g_assert (n >= 2 && n <= TEST_THREAD_POOL_QUEUED + 2);
+  else
+    g_assert (n == TEST_THREAD_POOL_QUEUED + 2);
+  wait_thread (0.05);
+  g_assert (thread_pool_n == n);
+}
+
+void
+test_thread_pool (void)
+{
+  thread_pool_mutex = g_mutex_new ();
+  thread_pool_cond = g_cond_new ();
+
+  thread_pool = g_thread_pool_new (test_thread_pool_recursive_func, NULL,
+				   TEST_THREAD_POOL_THREADS);
+  g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (1)));
+  g_assert (test_thread_pool_wait (1 + TEST_THREAD_POOL_FANOUT * 11));
+  g_thread_pool_free (thread_pool, FALSE);
+  g_assert (thread_pool_n == 1 + TEST_THREAD_POOL_FANOUT * 11);
+
+  thread_pool_n = 0;
+  thread_pool = g_thread_pool_new (test_thread_pool_steal_func, NULL,
+				   TEST_THREAD_POOL_THREADS);
+  g_assert (g_thread_pool_push (thread_pool, GUINT_TO_POINTER (1)));
+  g_thread_pool_free (thread_pool, FALSE);
+  g_assert (thread_pool_n == TEST_THREAD_POOL_FANOUT);
+
+  test_thread_pool_shutdown (FALSE);
+  test_thread_pool_shutdown (TRUE);
+
+  g_cond_free (thread_pool_cond);
+  g_mutex_free (thread_pool_mutex);
+}
+
+#define TEST_NODE_PARALLEL_NODES 20000
+
+G_LOCK_DEFINE_STATIC (node_parallel);
+guint node_parallel_n = 0;
+
+void
+test_node_parallel_func (GNode *node, gpointer data)
+{
+  G_LOCK (node_parallel);
+  node_parallel_n++;
+  G_UNLOCK (node_parallel);
+}
+
+gpointer
+test_node_parallel_reduce (gpointer result, GNode *node, gpointer data)
+{
+  return GUINT_TO_POINTER (GPOINTER_TO_UINT (result) +
+			   GPOINTER_TO_UINT (node->data));
+}
+
+gpointer
+test_node_parallel_merge (gpointer result1, gpointer result2, gpointer data)
+{
+  return GUINT_TO_POINTER (GPOINTER_TO_UINT (result1) +
+			   GPOINTER_TO_UINT (result2));
+}
+
+gpointer
+test_node_parallel_min_reduce (gpointer result, GNode *node, gpointer data)
+{
+  return GUINT_TO_POINTER (MIN (GPOINTER_TO_UINT (result),
+				GPOINTER_TO_UINT (node->data) + 1));
+}
+
+gpointer
+test_node_parallel_min_merge (gpointer result1, gpointer result2, gpointer data)
+{
+  return GUINT_TO_POINTER (MIN (GPOINTER_TO_UINT (result1),
+				GPOINTER_TO_UINT (result2)));
+}
+
+void
+test_node_parallel (void)
+{
+  GNode *nodes[TEST_NODE_PARALLEL_NODES];
+  guint i, sum, min;
+
+  nodes[0] = g_node_new (GUINT_TO_POINTER (0));
+  for (i = 1; i < TEST_NODE_PARALLEL_NODES; i++)
+    {
+      nodes[i] = g_node_new (GUINT_TO_POINTER (i));
+      g_node_append (nodes[(i - 1) / 3], nodes[i]);
+    }
+
+  g_node_traverse_parallel (nodes[0], G_TRAVERSE_ALL, 16, 4,
+			    test_node_parallel_func, NULL);
+  g_assert (node_parallel_n == TEST_NODE_PARALLEL_NODES);
+
+  sum = GPOINTER_TO_UINT (g_node_reduce_parallel (nodes[0], G_TRAVERSE_ALL,
+						  16, 4, NULL,
+						  test_node_parallel_reduce,
+						  test_node_parallel_merge,
+						  NULL));
+  g_assert (sum == TEST_NODE_PARALLEL_NODES * (TEST_NODE_PARALLEL_NODES - 1) / 2);
+
+  /* an identity of the merge other than NULL */
+  min = GPOINTER_TO_UINT (g_node_reduce_parallel (nodes[0], G_TRAVERSE_ALL,
+						  16, 4, GUINT_TO_POINTER (~0),
+						  test_node_parallel_min_reduce,
+						  test_node_parallel_min_merge,
+						  NULL));
+  g_assert (min == 1);
+
+  g_node_destroy (nodes[0]);
+}
+
+#if defined (HAVE_UNISTD_H) && !defined (NATIVE_WIN32)
+#include <unistd.h>
+
+#define TEST_LOG_ASYNC_THREADS 4
+#define TEST_LOG_ASYNC_MESSAGES 2000	/* per thread, far more than fit in a pipe */
+#define TEST_LOG_ASYNC_RECORDS 16
+
+gint log_async_pipe[2];
+gboolean log_async_reader_wait;
+guint log_async_lines;
+
+void
+test_log_async_func (gpointer data)
+{
+  guint t = GPOINTER_TO_UINT (data);
+  guint i;
+
+  for (i = 0; i < TEST_LOG_ASYNC_MESSAGES; i++)
+    g_message ("log-async-test %u %u", t, i);
+}
+
+/* counts the lines written to the pipe until it is closed */
+void
+test_log_async_reader (gpointer data)
+{
+  gchar buf[4096];
+  gint n, i;
+
+  if (log_async_reader_wait)
+    wait_thread (0.2);
+
+  while ((n = read (log_async_pipe[0], buf, sizeof (buf))) > 0)
+    for (i = 0; i < n; i++)
+      if (buf[i] == '\n')
+	log_async_lines++;
+}
+
+/* logs from several threads to a pipe that is only read later, so
+ * that the drain thread gets stuck and the ring fills up
+ */
+void
+test_log_async_policy (GLogAsyncOverflow overflow)
+{
+  gpointer reader;
+  gulong dropped;
+  gint saved_stdout;
+
+  g_assert (pipe (log_async_pipe) == 0);
+  saved_stdout = dup (1);
+  g_assert (saved_stdout >= 0);
+  dup2 (log_async_pipe[1], 1);
+  close (log_async_pipe[1]);
+
+  log_async_lines = 0;
+  dropped = g_log_async_get_dropped ();
+  g_assert (g_log_set_async (TEST_LOG_ASYNC_RECORDS, overflow));
+
+  /* blocked producers wait for the reader, which only starts a while
+   * after them; with drop, it starts once they are all done
+   */
+  log_async_reader_wait = overflow == G_LOG_ASYNC_BLOCK;
+  reader = NULL;
+  if (overflow == G_LOG_ASYNC_BLOCK)
+    reader = new_thread (test_log_async_reader, NULL);
+  run_test_threads (test_log_async_func, TEST_LOG_ASYNC_THREADS);
+  if (overflow == G_LOG_ASYNC_DROP)
+    reader = new_thread (test_log_async_reader, NULL);
+  g_assert (reader != NULL);
+
+  /* once the flush returned, closing the pipe leaves the reader with
+   * all that was queued; anything written later ends up on stdout
+   */
+  g_log_async_flush ();
+  dup2 (saved_stdout, 1);
+  close (saved_stdout);
+  join_thread (reader);
+  close (log_async_pipe[0]);
+
+  dropped = g_log_async_get_dropped () - dropped;
+  if (overflow == G_LOG_ASYNC_BLOCK)
+    g_assert (dropped == 0);
+  else
+    g_assert (dropped > 0);
+  g_assert (log_async_lines + dropped ==
+	    TEST_LOG_ASYNC_THREADS * TEST_LOG_ASYNC_MESSAGES);
+}
+
+void
+test_log_async (void)
+{
+  /* the sink stays on for the rest of the tests, with block last so
+   * that none of their messages get lost
+   */
+  test_log_async_policy (G_LOG_ASYNC_DROP);
+  test_log_async_policy (G_LOG_ASYNC_BLOCK);
+}
+#endif /* HAVE_UNISTD_H && !NATIVE_WIN32 */
+
+#if defined (HAVE_POLL) && defined (HAVE_SYS_POLL_H)
+#include <sys/poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define TEST_MAIN_WAKEUP_IDLES 3
+
+GMainContext *main_wakeup_context;
+GMainLoop *main_wakeup_loop;
+GMutex *main_wakeup_mutex;
+GCond *main_wakeup_cond;
+gboolean main_wakeup_polling = FALSE;
+gboolean main_wakeup_done = FALSE;
+gint main_wakeup_woken = -1;	/* the poll's result */
+gint main_wakeup_pending = -1;	/* wakeups waiting to be read */
+guint main_wakeup_n_idles = 0;
+
+gboolean
+test_main_wakeup_idle (gpointer data)
+{
+  main_wakeup_n_idles++;
+  return FALSE;
+}
+
+/* the wakeup descriptor is the only one in the context, so once the
+ * first blocking poll returns, the data on it tells how many wakeups
+ * were written; an eventfd is read and written back, a pipe has one
+ * byte per wakeup
+ */
+gint
+test_main_wakeup_poll (GPollFD *ufds, guint nfds, gint timeout)
+{
+  gint result;
+  gint n;
+  guint64 value;
+
+  if (timeout == 0 || main_wakeup_polling)
+    return poll ((struct pollfd*) ufds, nfds, timeout);
+
+  g_assert (nfds == 1);
+
+  g_mutex_lock (main_wakeup_mutex);
+  main_wakeup_polling = TRUE;
+  g_cond_broadcast (main_wakeup_cond);
+  g_mutex_unlock (main_wakeup_mutex);
+
+  /* sleeps until woken, unless that's broken */
+  result = poll ((struct pollfd*) ufds, nfds, timeout < 0 ? 10000 : timeout);
+
+  g_mutex_lock (main_wakeup_mutex);
+  while (!main_wakeup_done)
+    g_cond_wait (main_wakeup_cond, main_wakeup_mutex);
+  g_mutex_unlock (main_wakeup_mutex);
+
+  main_wakeup_woken = result;
+  if (ioctl (ufds[0].fd, FIONREAD, &n) == 0)
+    main_wakeup_pending = n;
+  else if (read (ufds[0].fd, &value, sizeof (value)) == sizeof (value))
+    {
+      main_wakeup_pending = value;
+      g_assert (write (ufds[0].fd, &value, sizeof (value)) == sizeof (value));
+    }
+  else
+    main_wakeup_pending = 0;
+
+  return result;
+}
+
+/* adds idles and quits the loop while it is blocked in poll */
+void
+test_main_wakeup_func (gpointer data)
+{
+  guint i;
+
+  g_mutex_lock (main_wakeup_mutex);
+  while (!main_wakeup_polling)
+    g_cond_wait (main_wakeup_cond, main_wakeup_mutex);
+  g_mutex_unlock (main_wakeup_mutex);
+
+  wait_thread (0.05);
+
+  for (i = 0; i < TEST_MAIN_WAKEUP_IDLES; i++)
+    g_main_context_add_idle (main_wakeup_context, G_PRIORITY_DEFAULT_IDLE,
+			     test_main_wakeup_idle, NULL, NULL);
+  g_main_quit (main_wakeup_loop);
+
+  g_mutex_lock (main_wakeup_mutex);
+  main_wakeup_done = TRUE;
+  g_cond_broadcast (main_wakeup_cond);
+  g_mutex_unlock (main_wakeup_mutex);
+}
+
+void
+test_main_wakeup (void)
+{
+  gpointer thread;
+
+  main_wakeup_mutex = g_mutex_new ();
+  main_wakeup_cond = g_cond_new ();
+  main_wakeup_context = g_main_context_new ();
+  g_main_context_set_thread_default (main_wakeup_context);
+  g_main_set_poll_func (test_main_wakeup_poll);
+  main_wakeup_loop = g_main_new (TRUE);
+
+  thread = new_thread (test_main_wakeup_func, NULL);
+  if (!thread)
+    return;
+  g_main_run (main_wakeup_loop);
+  join_thread (thread);
+
+  /* the first of the wakeups got the poll to return, and the others
+   * didn't write another one while it was pending
+   */
+  g_assert (main_wakeup_woken == 1);
+  g_assert (main_wakeup_pending == 1);
+
+  while (g_main_context_iteration (main_wakeup_context, FALSE))
+    ;
+  g_assert (main_wakeup_n_idles == TEST_MAIN_WAKEUP_IDLES);
+
+  g_main_destroy (main_wakeup_loop);
+  g_main_context_set_thread_default (NULL);
+  g_main_context_destroy (main_wakeup_context);
+  g_cond_free (main_wakeup_cond);
+  g_mutex_free (main_wakeup_mutex);
+}
+#endif /* HAVE_POLL && HAVE_SYS_POLL_H */
+
 int
 main (void)
 {
@@ -208,6 +1173,30 @@ main (void)
 
   test_mutexes ();
 
+  test_rw_lock ();
+
+  test_mem_chunk ();
+
+  test_magazine ();
+
+  test_concurrent_hash ();
+
+  test_string_arena ();
+
+  test_async_queue ();
+
+  test_thread_pool ();
+
+  test_node_parallel ();
+
+#if defined (HAVE_POLL) && defined (HAVE_SYS_POLL_H)
+  test_main_wakeup ();
+#endif
+
+#if defined (HAVE_UNISTD_H) && !defined (NATIVE_WIN32)
+  test_log_async ();
+#endif
+
   test_private ();
 
   /* later we might want to start n copies of that */
@@ -0,0 +1,692 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+/* 
+ * MT safe
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "glib.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef NATIVE_WIN32
+#define STRICT
+#include <windows.h>
+#endif /* NATIVE_WIN32 */
+
+/* Every worker owns a Chase-Lev deque: it pushes and pops the jobs
+ * it submits itself at the bottom, while idle workers steal from the
+ * top of the others.  Jobs pushed from outside the pool go to a
+ * shared queue under the pool mutex, from which workers take a batch
+ * at a time into their own deques.  The deque positions are unsigned
+ * and only compared through their difference, so they may wrap.
+ */
+#define G_THREAD_POOL_MAX_THREADS	256
+#define G_THREAD_POOL_BATCH		32
+#define G_WORK_DEQUE_MIN_SIZE		64
+
+typedef struct _GWorkArray		GWorkArray;
+typedef struct _GWorkDeque		GWorkDeque;
+typedef struct _GThreadPoolWorker	GThreadPoolWorker;
+
+struct _GWorkArray
+{
+  guint mask;
+  GWorkArray *retired;		/* smaller arrays thieves may still read */
+  gpointer jobs[1];
+};
+
+struct _GWorkDeque
+{
+  guint top;
+  guint bottom;
+  GWorkArray *array;
+};
+
+struct _GThreadPoolWorker
+{
+  GThreadPool *pool;
+  guint index;
+  guint32 seed;
+  gboolean running;		/* protected by the pool mutex */
+  GWorkDeque deque;
+};
+
+struct _GThreadPool
+{
+  GFunc func;
+  gpointer user_data;
+
+  GMutex *mutex;
+  GCond *work_cond;		/* idle workers wait here */
+  GCond *exit_cond;
+  GRingArray *queue;		/* jobs pushed from outside */
+  gint max_threads;
+  gint n_threads;
+  gint n_idle;
+  gint n_unprocessed;
+  gint shutdown;		/* 1 finishes queued jobs, 2 drops them */
+  guint n_slots;
+  GThreadPoolWorker *workers[G_THREAD_POOL_MAX_THREADS];
+
+  GMutex *complete_mutex;
+  GMainContext *context;
+  GFunc complete_func;
+  GRingArray *completed;
+  guint complete_id;
+};
+
+static GStaticPrivate current_worker = G_STATIC_PRIVATE_INIT;
+
+
+static GWorkArray*
+g_work_array_new (guint size)
+{
+  GWorkArray *array;
+
+  array = g_malloc (sizeof (GWorkArray) + sizeof (gpointer) * (size - 1));
+  array->mask = size - 1;
+  array->retired = NULL;
+
+  return array;
+}
+
+static void
+g_work_deque_init (GWorkDeque *deque)
+{
+  deque->top = 0;
+  deque->bottom = 0;
+  deque->array = g_work_array_new (G_WORK_DEQUE_MIN_SIZE);
+}
+
+static void
+g_work_deque_free (GWorkDeque *deque)
+{
+  GWorkArray *array = deque->array;
+
+  while (array)
+    {
+      GWorkArray *retired = array->retired;
+
+      g_free (array);
+      array = retired;
+    }
+}
+
+static gint
+g_work_deque_size (GWorkDeque *deque)
+{
+  guint bottom = g_atomic_int_get ((gint*) &deque->bottom);
+  guint top = g_atomic_int_get ((gint*) &deque->top);
+
+  return (gint) (bottom - top);
+}
+
+/* owner only */
+static void
+g_work_deque_push (GWorkDeque *deque,
+		   gpointer    job)
+{
+  guint bottom = deque->bottom;
+  guint top = g_atomic_int_get ((gint*) &deque->top);
+  GWorkArray *array = deque->array;
+
+  if (bottom - top > array->mask)
+    {
+      GWorkArray *grown = g_work_array_new ((array->mask + 1) * 2);
+      guint i;
+
+      for (i = top; i != bottom; i++)
+	grown->jobs[i & grown->mask] = array->jobs[i & array->mask];
+      grown->retired = array;
+      g_atomic_pointer_set ((gpointer*) &deque->array, grown);
+      array = grown;
+    }
+
+  g_atomic_pointer_set (&array->jobs[bottom & array->mask], job);
+  g_atomic_int_set ((gint*) &deque->bottom, bottom + 1);
+}
+
+/* owner only */
+static gboolean
+g_work_deque_pop (GWorkDeque *deque,
+		  gpointer   *job)
+{
+  guint bottom = deque->bottom - 1;
+  GWorkArray *array = deque->array;
+  gboolean found = TRUE;
+  guint top;
+
+  g_atomic_int_set ((gint*) &deque->bottom, bottom);
+  g_atomic_memory_barrier ();
+  top = g_atomic_int_get ((gint*) &deque->top);
+
+  if ((gint) (bottom - top) >= 0)
+    {
+      *job = g_atomic_pointer_get (&array->jobs[bottom & array->mask]);
+      if (top == bottom)
+	{
+	  /* last job, race the thieves for it */
+	  if (!g_atomic_int_compare_and_exchange ((gint*) &deque->top, top, top + 1))
+	    found = FALSE;
+	  g_atomic_int_set ((gint*) &deque->bottom, bottom + 1);
+	}
+    }
+  else
+    {
+      found = FALSE;
+      g_atomic_int_set ((gint*) &deque->bottom, bottom + 1);
+    }
+
+  return found;
+}
+
+/* any thread; returns -1 if it lost a race and should retry */
+static gint
+g_work_deque_steal (GWorkDeque *deque,
+		    gpointer   *job)
+{
+  guint top = g_atomic_int_get ((gint*) &deque->top);
+  guint bottom;
+
+  g_atomic_memory_barrier ();
+  bottom = g_atomic_int_get ((gint*) &deque->bottom);
+
+  if ((gint) (bottom - top) > 0)
+    {
+      GWorkArray *array = g_atomic_pointer_get ((gpointer*) &deque->array);
+
+      *job = g_atomic_pointer_get (&array->jobs[top & array->mask]);
+      if (!g_atomic_int_compare_and_exchange ((gint*) &deque->top, top, top + 1))
+	return -1;
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+g_thread_pool_steal (GThreadPool       *pool,
+		     GThreadPoolWorker *thief,
+		     gpointer          *job)
+{
+  guint n_slots = g_atomic_int_get ((gint*) &pool->n_slots);
+  gboolean retry = TRUE;
+  guint start, i;
+
+  if (n_slots < 2)
+    return FALSE;
+
+  /* xorshift, to spread the thieves over the victims */
+  thief->seed ^= thief->seed << 13;
+  thief->seed ^= thief->seed >> 17;
+  thief->seed ^= thief->seed << 5;
+  start = thief->seed % n_slots;
+
+  while (retry)
+    {
+      retry = FALSE;
+      for (i = 0; i < n_slots; i++)
+	{
+	  GThreadPoolWorker *victim = pool->workers[(start + i) % n_slots];
+	  gint stolen;
+
+	  if (victim == thief)
+	    continue;
+
+	  stolen = g_work_deque_steal (&victim->deque, job);
+	  if (stolen > 0)
+	    return TRUE;
+	  if (stolen < 0)
+	    retry = TRUE;
+	}
+    }
+
+  return FALSE;
+}
+
+/* called with the pool mutex held */
+static gboolean
+g_thread_pool_has_work (GThreadPool *pool)
+{
+  guint i;
+
+  for (i = 0; i < pool->n_slots; i++)
+    if (g_work_deque_size (&pool->workers[i]->deque) > 0)
+      return TRUE;
+
+  return pool->queue->len > 0;
+}
+
+static void g_thread_pool_worker (gpointer data);
+
+/* called with the pool mutex held */
+static gboolean
+g_thread_pool_spawn (GThreadPool *pool)
+{
+  GThreadPoolWorker *worker = NULL;
+  guint i;
+
+  for (i = 0; i < pool->n_slots; i++)
+    if (!pool->workers[i]->running)
+      {
+	worker = pool->workers[i];
+	break;
+      }
+
+  if (!worker)
+    {
+      if (pool->n_slots == G_THREAD_POOL_MAX_THREADS)
+	return FALSE;
+
+      worker = g_new (GThreadPoolWorker, 1);
+      worker->pool = pool;
+      worker->index = pool->n_slots;
+      worker->seed = 2463534242U + worker->index;
+      worker->running = FALSE;
+      g_work_deque_init (&worker->deque);
+
+      /* thieves read n_slots without the lock */
+      pool->workers[pool->n_slots] = worker;
+      g_atomic_int_set ((gint*) &pool->n_slots, pool->n_slots + 1);
+    }
+
+  worker->running = TRUE;
+  g_atomic_int_inc (&pool->n_threads);
+
+  if (!g_thread_create (g_thread_pool_worker, worker))
+    {
+      worker->running = FALSE;
+      g_atomic_int_add (&pool->n_threads, -1);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Gets the next job for WORKER, sleeping while there is none.  Returns
+ * FALSE once the worker should exit, after dropping its thread from
+ * the pool.
+ */
+static gboolean
+g_thread_pool_next_job (GThreadPool       *pool,
+			GThreadPoolWorker *worker,
+			gpointer          *job)
+{
+  if (g_atomic_int_get (&pool->shutdown) < 2 &&
+      g_work_deque_pop (&worker->deque, job))
+    {
+      g_atomic_int_add (&pool->n_unprocessed, -1);
+      return TRUE;
+    }
+
+  g_mutex_lock (pool->mutex);
+  while (g_atomic_int_get (&pool->shutdown) < 2)
+    {
+      if (g_ring_array_pop_head (pool->queue, job))
+	{
+	  guint batch = MIN (pool->queue->len / pool->n_threads,
+			     G_THREAD_POOL_BATCH);
+	  gpointer next;
+
+	  while (batch-- && g_ring_array_pop_head (pool->queue, &next))
+	    g_work_deque_push (&worker->deque, next);
+	  g_atomic_int_add (&pool->n_unprocessed, -1);
+	  g_mutex_unlock (pool->mutex);
+
+	  return TRUE;
+	}
+
+      g_mutex_unlock (pool->mutex);
+      if (g_thread_pool_steal (pool, worker, job))
+	{
+	  g_atomic_int_add (&pool->n_unprocessed, -1);
+	  return TRUE;
+	}
+      g_mutex_lock (pool->mutex);
+
+      if (pool->queue->len > 0)
+	continue;
+
+      if (pool->shutdown ? !g_thread_pool_has_work (pool)
+			 : pool->n_threads > pool->max_threads)
+	break;
+
+      /* pushers look at n_idle after publishing a job, so either they
+       * see this worker idle or it sees their job here
+       */
+      g_atomic_int_inc (&pool->n_idle);
+      g_atomic_memory_barrier ();
+      if (!g_thread_pool_has_work (pool) && !pool->shutdown)
+	g_cond_wait (pool->work_cond, pool->mutex);
+      g_atomic_int_add (&pool->n_idle, -1);
+    }
+
+  worker->running = FALSE;
+  g_atomic_int_add (&pool->n_threads, -1);
+  g_cond_broadcast (pool->exit_cond);
+  g_mutex_unlock (pool->mutex);
+
+  return FALSE;
+}
+
+static gboolean
+g_thread_pool_dispatch (gpointer data)
+{
+  GThreadPool *pool = data;
+  guint n_jobs;
+
+  /* only what is there already, so busy workers can't starve the loop */
+  g_mutex_lock (pool->complete_mutex);
+  n_jobs = pool->completed->len;
+  g_mutex_unlock (pool->complete_mutex);
+
+  while (n_jobs--)
+    {
+      gpointer job;
+
+      g_mutex_lock (pool->complete_mutex);
+      g_ring_array_pop_head (pool->completed, &job);
+      g_mutex_unlock (pool->complete_mutex);
+
+      pool->complete_func (job, pool->user_data);
+    }
+
+  g_mutex_lock (pool->complete_mutex);
+  if (pool->completed->len)
+    {
+      g_mutex_unlock (pool->complete_mutex);
+      return TRUE;
+    }
+  pool->complete_id = 0;
+  g_mutex_unlock (pool->complete_mutex);
+
+  return FALSE;
+}
+
+static void
+g_thread_pool_run (GThreadPool *pool,
+		   gpointer     job)
+{
+  pool->func (job, pool->user_data);
+
+  if (pool->complete_func)
+    {
+      g_mutex_lock (pool->complete_mutex);
+      g_ring_array_push_tail (pool->completed, &job);
+      if (!pool->complete_id)
+	pool->complete_id = g_main_context_add_idle (pool->context, G_PRIORITY_DEFAULT,
+						     g_thread_pool_dispatch, pool, NULL);
+      g_mutex_unlock (pool->complete_mutex);
+    }
+}
+
+static void
+g_thread_pool_worker (gpointer data)
+{
+  GThreadPoolWorker *worker = data;
+  GThreadPool *pool = worker->pool;
+  gpointer job;
+
+  g_static_private_set (&current_worker, worker, NULL);
+
+  while (g_thread_pool_next_job (pool, worker, &job))
+    g_thread_pool_run (pool, job);
+
+  g_static_private_set (&current_worker, NULL, NULL);
+}
+
+static guint
+g_thread_pool_n_processors (void)
+{
+  glong n = 1;
+
+#if defined (HAVE_UNISTD_H) && defined (_SC_NPROCESSORS_ONLN)
+  n = sysconf (_SC_NPROCESSORS_ONLN);
+#elif defined (NATIVE_WIN32)
+  SYSTEM_INFO info;
+
+  GetSystemInfo (&info);
+  n = info.dwNumberOfProcessors;
+#endif
+
+  return CLAMP (n, 1, G_THREAD_POOL_MAX_THREADS);
+}
+
+GThreadPool*
+g_thread_pool_new (GFunc    func,
+		   gpointer user_data,
+		   guint    max_threads)
+{
+  GThreadPool *pool;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  pool = g_new0 (GThreadPool, 1);
+  pool->func = func;
+  pool->user_data = user_data;
+  if (g_thread_supported ())
+    {
+      pool->mutex = g_mutex_new ();
+      pool->work_cond = g_cond_new ();
+      pool->exit_cond = g_cond_new ();
+      pool->complete_mutex = g_mutex_new ();
+    }
+  pool->queue = g_ring_array_new (sizeof (gpointer));
+  pool->completed = g_ring_array_new (sizeof (gpointer));
+  pool->max_threads = max_threads ? MIN (max_threads, G_THREAD_POOL_MAX_THREADS)
+				  : g_thread_pool_n_processors ();
+
+  return pool;
+}
+
+void
+g_thread_pool_set_completion (GThreadPool  *pool,
+			      GMainContext *context,
+			      GFunc         complete_func)
+{
+  g_return_if_fail (pool != NULL);
+
+  g_mutex_lock (pool->complete_mutex);
+  pool->context = context ? context : g_main_context_default ();
+  pool->complete_func = complete_func;
+  g_mutex_unlock (pool->complete_mutex);
+}
+
+gboolean
+g_thread_pool_push (GThreadPool *pool,
+		    gpointer     data)
+{
+  GThreadPoolWorker *worker;
+
+  g_return_val_if_fail (pool != NULL, FALSE);
+
+  worker = g_static_private_get (&current_worker);
+
+  if (worker && worker->pool == pool)
+    {
+      g_atomic_int_inc (&pool->n_unprocessed);
+      g_work_deque_push (&worker->deque, data);
+
+      /* publish the job before looking for someone idle to take it */
+      g_atomic_memory_barrier ();
+      if (g_atomic_int_get (&pool->n_idle) > 0 ||
+	  g_atomic_int_get (&pool->n_threads) < g_atomic_int_get (&pool->max_threads))
+	{
+	  g_mutex_lock (pool->mutex);
+	  if (pool->n_idle > 0)
+	    g_cond_signal (pool->work_cond);
+	  else if (pool->n_threads < pool->max_threads)
+	    g_thread_pool_spawn (pool);
+	  g_mutex_unlock (pool->mutex);
+	}
+
+      return TRUE;
+    }
+
+  g_mutex_lock (pool->mutex);
+
+  if (pool->shutdown && !(worker && worker->pool == pool))
+    {
+      g_mutex_unlock (pool->mutex);
+      g_warning ("g_thread_pool_push(): pool is being freed");
+      return FALSE;
+    }
+
+  if (pool->n_idle == 0 && pool->n_threads < pool->max_threads)
+    {
+      /* without threads, run the job right here */
+      if (!g_thread_pool_spawn (pool) && pool->n_threads == 0)
+	{
+	  g_mutex_unlock (pool->mutex);
+	  g_thread_pool_run (pool, data);
+
+	  return TRUE;
+	}
+    }
+
+  g_ring_array_push_tail (pool->queue, &data);
+  g_atomic_int_inc (&pool->n_unprocessed);
+  if (pool->n_idle > 0)
+    g_cond_signal (pool->work_cond);
+
+  g_mutex_unlock (pool->mutex);
+
+  return TRUE;
+}
+
+void
+g_thread_pool_set_max_threads (GThreadPool *pool,
+			       guint        max_threads)
+{
+  g_return_if_fail (pool != NULL);
+
+  g_mutex_lock (pool->mutex);
+  g_atomic_int_set (&pool->max_threads, max_threads ? MIN (max_threads, G_THREAD_POOL_MAX_THREADS)
+						    : g_thread_pool_n_processors ());
+
+  /* surplus workers exit once idle, new ones spawn for queued jobs */
+  g_cond_broadcast (pool->work_cond);
+  while (pool->n_threads < pool->max_threads &&
+	 pool->n_threads < g_atomic_int_get (&pool->n_unprocessed) &&
+	 g_thread_pool_spawn (pool))
+    ;
+  g_mutex_unlock (pool->mutex);
+}
+
+guint
+g_thread_pool_get_max_threads (GThreadPool *pool)
+{
+  guint max_threads;
+
+  g_return_val_if_fail (pool != NULL, 0);
+
+  g_mutex_lock (pool->mutex);
+  max_threads = pool->max_threads;
+  g_mutex_unlock (pool->mutex);
+
+  return max_threads;
+}
+
+guint
+g_thread_pool_get_num_threads (GThreadPool *pool)
+{
+  guint n_threads;
+
+  g_return_val_if_fail (pool != NULL, 0);
+
+  g_mutex_lock (pool->mutex);
+  n_threads = pool->n_threads;
+  g_mutex_unlock (pool->mutex);
+
+  return n_threads;
+}
+
+guint
+g_thread_pool_unprocessed (GThreadPool *pool)
+{
+  guint n_unprocessed;
+
+  g_return_val_if_fail (pool != NULL, 0);
+
+  g_mutex_lock (pool->mutex);
+  n_unprocessed = g_atomic_int_get (&pool->n_unprocessed);
+  g_mutex_unlock (pool->mutex);
+
+  return n_unprocessed;
+}
+
+void
+g_thread_pool_free (GThreadPool *pool,
+		    gboolean     immediate)
+{
+  guint i;
+
+  g_return_if_fail (pool != NULL);
+
+  g_mutex_lock (pool->mutex);
+  g_atomic_int_set (&pool->shutdown, immediate ? 2 : 1);
+  g_cond_broadcast (pool->work_cond);
+  while (pool->n_threads > 0)
+    g_cond_wait (pool->exit_cond, pool->mutex);
+  g_mutex_unlock (pool->mutex);
+
+  /* hand out the completions that are still pending */
+  if (pool->complete_id)
+    {
+      g_main_context_remove_source (pool->context, pool->complete_id);
+      pool->complete_id = 0;
+      if (!immediate)
+	{
+	  gpointer job;
+
+	  while (g_ring_array_pop_head (pool->completed, &job))
+	    pool->complete_func (job, pool->user_data);
+	}
+    }
+
+  for (i = 0; i < pool->n_slots; i++)
+    {
+      g_work_deque_free (&pool->workers[i]->deque);
+      g_free (pool->workers[i]);
+    }
+  g_ring_array_free (pool->queue);
+  g_ring_array_free (pool->completed);
+  if (pool->mutex)
+    {
+      g_mutex_free (pool->mutex);
+      g_cond_free (pool->work_cond);
+      g_cond_free (pool->exit_cond);
+      g_mutex_free (pool->complete_mutex);
+    }
+  g_free (pool);
+}
@@ -38,6 +38,7 @@
 #endif /* HAVE_UNISTD_H */
 #ifndef NATIVE_WIN32
 #include <sys/time.h>
+#include <time.h>
 #endif /* NATIVE_WIN32 */
 
 #ifdef NATIVE_WIN32
@@ -45,20 +46,125 @@
 #endif /* NATIVE_WIN32 */
 
 typedef struct _GRealTimer GRealTimer;
+typedef struct _GMonotonicTime GMonotonicTime;
+
+struct _GMonotonicTime
+{
+  glong sec;
+  glong nsec;
+};
 
 struct _GRealTimer
 {
-#ifdef NATIVE_WIN32
-  DWORD start;
-  DWORD end;
-#else /* !NATIVE_WIN32 */
-  struct timeval start;
-  struct timeval end;
-#endif /* !NATIVE_WIN32 */
+  GMonotonicTime start;
+  GMonotonicTime end;
 
   guint active : 1;
 };
 
+G_LOCK_DEFINE_STATIC (monotonic_fallback);
+
+/* Reads the monotonic clock, which counts from an unspecified point
+ * and is not affected by changes of the system time. On Linux,
+ * clock_gettime() reads the TSC from the vDSO without entering the
+ * kernel, so there is no need for a TSC path of our own.
+ */
+static void
+g_monotonic_read (GMonotonicTime *result)
+{
+  static GTimeVal last = { 0, 0 };
+  static GTimeVal offset = { 0, 0 };
+  GTimeVal now;
+
+#if defined (HAVE_CLOCK_GETTIME) && defined (CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    {
+      result->sec = ts.tv_sec;
+      result->nsec = ts.tv_nsec;
+      return;
+    }
+#endif /* HAVE_CLOCK_GETTIME && CLOCK_MONOTONIC */
+
+#ifdef NATIVE_WIN32
+  {
+    static LARGE_INTEGER frequency = { 0 };
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0 && !QueryPerformanceFrequency (&frequency))
+      frequency.QuadPart = -1;
+    if (frequency.QuadPart > 0 && QueryPerformanceCounter (&counter))
+      {
+	result->sec = counter.QuadPart / frequency.QuadPart;
+	result->nsec = ((counter.QuadPart % frequency.QuadPart) * 1000000000 /
+			frequency.QuadPart);
+	return;
+      }
+  }
+#endif /* NATIVE_WIN32 */
+
+  /* Without a monotonic clock, use the system time, but keep going
+   * from the last reading when it has been set backwards.
+   */
+  g_get_current_time (&now);
+
+  G_LOCK (monotonic_fallback);
+  now.tv_sec += offset.tv_sec;
+  now.tv_usec += offset.tv_usec;
+  if (now.tv_usec >= 1000000)
+    {
+      now.tv_usec -= 1000000;
+      now.tv_sec++;
+    }
+  if (now.tv_sec < last.tv_sec ||
+      (now.tv_sec == last.tv_sec && now.tv_usec < last.tv_usec))
+    {
+      offset.tv_sec += last.tv_sec - now.tv_sec;
+      offset.tv_usec += last.tv_usec - now.tv_usec;
+      if (offset.tv_usec < 0)
+	{
+	  offset.tv_usec += 1000000;
+	  offset.tv_sec--;
+	}
+      else if (offset.tv_usec >= 1000000)
+	{
+	  offset.tv_usec -= 1000000;
+	  offset.tv_sec++;
+	}
+      now = last;
+    }
+  last = now;
+  G_UNLOCK (monotonic_fallback);
+
+  result->sec = now.tv_sec;
+  result->nsec = now.tv_usec * 1000;
+}
+
+void
+g_get_monotonic_time (GTimeVal *result)
+{
+  GMonotonicTime now;
+
+  g_return_if_fail (result != NULL);
+
+  g_monotonic_read (&now);
+  result->tv_sec = now.sec;
+  result->tv_usec = now.nsec / 1000;
+}
+
+#ifdef G_HAVE_GINT64
+guint64
+g_get_monotonic_nsec (void)
+{
+  GMonotonicTime now;
+
+  g_monotonic_read (&now);
+
+  return (guint64) now.sec * G_GINT64_CONSTANT (1000000000) + now.nsec;
+}
+#endif /* G_HAVE_GINT64 */
+
 GTimer*
 g_timer_new (void)
 {
@@ -67,11 +173,7 @@ g_timer_new (void)
   timer = g_new (GRealTimer, 1);
   timer->active = TRUE;
 
-#ifdef NATIVE_WIN32
-  timer->start = GetTickCount ();
-#else /* !NATIVE_WIN32 */
-  gettimeofday (&timer->start, NULL);
-#endif /* !NATIVE_WIN32 */
+  g_monotonic_read (&timer->start);
 
   return ((GTimer*) timer);
 }
@@ -94,11 +196,7 @@ g_timer_start (GTimer *timer)
   rtimer = (GRealTimer*) timer;
   rtimer->active = TRUE;
 
-#ifdef NATIVE_WIN32
-  rtimer->start = GetTickCount ();
-#else /* !NATIVE_WIN32 */
-  gettimeofday (&rtimer->start, NULL);
-#endif /* !NATIVE_WIN32 */
+  g_monotonic_read (&rtimer->start);
 }
 
 void
@@ -111,11 +209,7 @@ g_timer_stop (GTimer *timer)
   rtimer = (GRealTimer*) timer;
   rtimer->active = FALSE;
 
-#ifdef NATIVE_WIN32
-  rtimer->end = GetTickCount ();
-#else /* !NATIVE_WIN32 */
-  gettimeofday (&rtimer->end, NULL);
-#endif /* !NATIVE_WIN32 */
+  g_monotonic_read (&rtimer->end);
 }
 
 void
@@ -127,11 +221,7 @@ g_timer_reset (GTimer *timer)
 
   rtimer = (GRealTimer*) timer;
 
-#ifdef NATIVE_WIN32
-   rtimer->start = GetTickCount ();
-#else /* !NATIVE_WIN32 */
-  gettimeofday (&rtimer->start, NULL);
-#endif /* !NATIVE_WIN32 */
+  g_monotonic_read (&rtimer->start);
 }
 
 gdouble
@@ -139,51 +229,25 @@ g_timer_elapsed (GTimer *timer,
 		 gulong *microseconds)
 {
   GRealTimer *rtimer;
+  GMonotonicTime elapsed;
   gdouble total;
-#ifndef NATIVE_WIN32
-  struct timeval elapsed;
-#endif /* NATIVE_WIN32 */
 
   g_return_val_if_fail (timer != NULL, 0);
 
   rtimer = (GRealTimer*) timer;
 
-#ifdef NATIVE_WIN32
-  if (rtimer->active)
-    rtimer->end = GetTickCount ();
-
-  /* Check for wraparound, which happens every 49.7 days.
-   * No, Win95 machines probably are never running for that long,
-   * but NT machines are.
-   */
-  if (rtimer->end < rtimer->start)
-    total = (UINT_MAX - (rtimer->start - rtimer->end)) / 1000.0;
-  else
-    total = (rtimer->end - rtimer->start) / 1000.0;
-
-  if (microseconds)
-    {
-      if (rtimer->end < rtimer->start)
-	*microseconds =
-	  ((UINT_MAX - (rtimer->start - rtimer->end)) % 1000) * 1000;
-      else
-	*microseconds =
-	  ((rtimer->end - rtimer->start) % 1000) * 1000;
-    }
-#else /* !NATIVE_WIN32 */
   if (rtimer->active)
-    gettimeofday (&rtimer->end, NULL);
+    g_monotonic_read (&rtimer->end);
 
-  if (rtimer->start.tv_usec > rtimer->end.tv_usec)
+  elapsed.sec = rtimer->end.sec - rtimer->start.sec;
+  elapsed.nsec = rtimer->end.nsec - rtimer->start.nsec;
+  if (elapsed.nsec < 0)
     {
-      rtimer->end.tv_usec += 1000000;
-      rtimer->end.tv_sec--;
+      elapsed.nsec += 1000000000;
+      elapsed.sec--;
     }
 
-  elapsed.tv_usec = rtimer->end.tv_usec - rtimer->start.tv_usec;
-  elapsed.tv_sec = rtimer->end.tv_sec - rtimer->start.tv_sec;
-
-  total = elapsed.tv_sec + ((gdouble) elapsed.tv_usec / 1e6);
+  total = elapsed.sec + ((gdouble) elapsed.nsec / 1e9);
   if (total < 0)
     {
       total = 0;
@@ -193,9 +257,7 @@ g_timer_elapsed (GTimer *timer,
     }
   else
     if (microseconds)
-      *microseconds = elapsed.tv_usec;
-  
-#endif /* !NATIVE_WIN32 */
+      *microseconds = elapsed.nsec / 1000;
 
   return total;
 }
@@ -28,117 +28,164 @@
  * MT safe
  */
 
+#include <stdio.h>
+#include <string.h>
 #include "glib.h"
 
 
-typedef struct _GRealTree  GRealTree;
-typedef struct _GTreeNode  GTreeNode;
+typedef struct _GRealTree	  GRealTree;
+typedef struct _GTreeNode	  GTreeNode;
+typedef struct _GTreeInternalNode GTreeInternalNode;
+
+/* B-tree of minimum degree G_TREE_MIN_DEGREE, every node but the root
+ * holds between G_TREE_MIN_KEYS and G_TREE_MAX_KEYS entries. A leaf
+ * fills four 64 byte cache lines on LP64 systems, inner nodes have
+ * the child pointers appended.
+ */
+#define	G_TREE_MIN_DEGREE	(8)
+#define	G_TREE_MIN_KEYS		(G_TREE_MIN_DEGREE - 1)
+#define	G_TREE_MAX_KEYS		(2 * G_TREE_MIN_DEGREE - 1)
+
+#define	G_TREE_CHILDREN(node)	(((GTreeInternalNode*) (node))->children)
 
 struct _GRealTree
 {
   GTreeNode *root;
   GCompareFunc key_compare;
+  gint nnodes;
 };
 
 struct _GTreeNode
 {
-  gint balance;      /* height (left) - height (right) */
-  GTreeNode *left;   /* left subtree */
-  GTreeNode *right;  /* right subtree */
-  gpointer key;      /* key for this node */
-  gpointer value;    /* value stored at this node */
+  GTreeNode *parent;
+  guint n_keys;
+  gboolean is_leaf;
+  gpointer keys[G_TREE_MAX_KEYS];
+  gpointer values[G_TREE_MAX_KEYS];
 };
 
+struct _GTreeInternalNode
+{
+  GTreeNode node;
+  GTreeNode *children[G_TREE_MAX_KEYS + 1];
+};
 
-static GTreeNode* g_tree_node_new                   (gpointer        key,
-						     gpointer        value);
+
+static GTreeNode* g_tree_node_new                   (gboolean        is_leaf);
+static void       g_tree_node_free                  (GTreeNode      *node);
 static void       g_tree_node_destroy               (GTreeNode      *node);
-static GTreeNode* g_tree_node_insert                (GTreeNode      *node,
+static inline gboolean g_tree_node_find             (GTreeNode      *node,
 						     GCompareFunc    compare,
+						     gconstpointer   key,
+						     guint          *index);
+static void       g_tree_node_split_child           (GTreeNode      *node,
+						     guint           index);
+static void       g_tree_node_merge_children        (GTreeNode      *node,
+						     guint           index);
+static void       g_tree_node_rotate_left           (GTreeNode      *node,
+						     guint           index);
+static void       g_tree_node_rotate_right          (GTreeNode      *node,
+						     guint           index);
+static void       g_tree_node_insert                (GRealTree      *rtree,
 						     gpointer        key,
-						     gpointer        value,
-						     gint           *inserted);
-static GTreeNode* g_tree_node_remove                (GTreeNode      *node,
-						     GCompareFunc    compare,
+						     gpointer        value);
+static void       g_tree_node_remove                (GRealTree      *rtree,
 						     gpointer        key);
-static GTreeNode* g_tree_node_balance               (GTreeNode      *node);
-static GTreeNode* g_tree_node_remove_leftmost       (GTreeNode      *node,
-						     GTreeNode     **leftmost);
-static GTreeNode* g_tree_node_restore_left_balance  (GTreeNode      *node,
-						     gint            old_balance);
-static GTreeNode* g_tree_node_restore_right_balance (GTreeNode      *node,
-						     gint            old_balance);
-static gpointer   g_tree_node_lookup                (GTreeNode      *node,
+static GTreeNode* g_tree_node_first                 (GTreeNode      *node);
+static gboolean   g_tree_node_next                  (GTreeNode     **node_p,
+						     guint          *index_p);
+static gboolean   g_tree_node_prev                  (GTreeNode     **node_p,
+						     guint          *index_p);
+static gboolean   g_tree_node_bound                 (GTreeNode      *node,
 						     GCompareFunc    compare,
-						     gpointer        key);
-static gint       g_tree_node_count                 (GTreeNode      *node);
+						     gconstpointer   key,
+						     gboolean        upper,
+						     GTreeNode     **node_p,
+						     guint          *index_p);
 static gint       g_tree_node_pre_order             (GTreeNode      *node,
 						     GTraverseFunc   traverse_func,
 						     gpointer        data);
-static gint       g_tree_node_in_order              (GTreeNode      *node,
-						     GTraverseFunc   traverse_func,
-						     gpointer        data);
 static gint       g_tree_node_post_order            (GTreeNode      *node,
 						     GTraverseFunc   traverse_func,
 						     gpointer        data);
-static gpointer   g_tree_node_search                (GTreeNode      *node,
-						     GSearchFunc     search_func,
-						     gpointer        data);
-static gint       g_tree_node_height                (GTreeNode      *node);
-static GTreeNode* g_tree_node_rotate_left           (GTreeNode      *node);
-static GTreeNode* g_tree_node_rotate_right          (GTreeNode      *node);
-static void       g_tree_node_check                 (GTreeNode      *node);
 
 
 G_LOCK_DEFINE_STATIC (g_tree_global);
-static GMemChunk *node_mem_chunk = NULL;
-static GTreeNode *node_free_list = NULL;
+static GMemChunk *leaf_mem_chunk = NULL;
+static GMemChunk *internal_mem_chunk = NULL;
+static GTreeNode *leaf_free_list = NULL;
+static GTreeNode *internal_free_list = NULL;
 
 
 static GTreeNode*
-g_tree_node_new (gpointer key,
-		 gpointer value)
+g_tree_node_new (gboolean is_leaf)
 {
+  GTreeNode **free_list;
   GTreeNode *node;
 
+  free_list = is_leaf ? &leaf_free_list : &internal_free_list;
+
   G_LOCK (g_tree_global);
-  if (node_free_list)
+  if (*free_list)
     {
-      node = node_free_list;
-      node_free_list = node->right;
+      node = *free_list;
+      *free_list = node->parent;
     }
-  else
+  else if (is_leaf)
     {
-      if (!node_mem_chunk)
-	node_mem_chunk = g_mem_chunk_new ("GLib GTreeNode mem chunk",
+      if (!leaf_mem_chunk)
+	leaf_mem_chunk = g_mem_chunk_new ("GLib GTree leaf mem chunk",
 					  sizeof (GTreeNode),
-					  1024,
+					  64 * sizeof (GTreeNode),
 					  G_ALLOC_ONLY);
 
-      node = g_chunk_new (GTreeNode, node_mem_chunk);
-   }
+      node = g_chunk_new (GTreeNode, leaf_mem_chunk);
+    }
+  else
+    {
+      if (!internal_mem_chunk)
+	internal_mem_chunk = g_mem_chunk_new ("GLib GTree node mem chunk",
+					      sizeof (GTreeInternalNode),
+					      16 * sizeof (GTreeInternalNode),
+					      G_ALLOC_ONLY);
+
+      node = (GTreeNode*) g_chunk_new (GTreeInternalNode, internal_mem_chunk);
+    }
   G_UNLOCK (g_tree_global);
 
-  node->balance = 0;
-  node->left = NULL;
-  node->right = NULL;
-  node->key = key;
-  node->value = value;
+  node->parent = NULL;
+  node->n_keys = 0;
+  node->is_leaf = is_leaf;
 
   return node;
 }
 
+static void
+g_tree_node_free (GTreeNode *node)
+{
+  GTreeNode **free_list;
+
+  free_list = node->is_leaf ? &leaf_free_list : &internal_free_list;
+
+  G_LOCK (g_tree_global);
+  node->parent = *free_list;
+  *free_list = node;
+  G_UNLOCK (g_tree_global);
+}
+
 static void
 g_tree_node_destroy (GTreeNode *node)
 {
   if (node)
     {
-      g_tree_node_destroy (node->right);
-      g_tree_node_destroy (node->left);
-      G_LOCK (g_tree_global);
-      node->right = node_free_list;
-      node_free_list = node;
-      G_UNLOCK (g_tree_global);
+      if (!node->is_leaf)
+	{
+	  guint i;
+
+	  for (i = 0; i <= node->n_keys; i++)
+	    g_tree_node_destroy (G_TREE_CHILDREN (node)[i]);
+	}
+      g_tree_node_free (node);
    }
 }
 
@@ -153,6 +200,111 @@ g_tree_new (GCompareFunc key_compare_func)
   rtree = g_new (GRealTree, 1);
   rtree->root = NULL;
   rtree->key_compare = key_compare_func;
+  rtree->nnodes = 0;
+
+  return (GTree*) rtree;
+}
+
+GTree*
+g_tree_new_from_sorted (GCompareFunc key_compare_func,
+			gpointer    *keys,
+			gpointer    *values,
+			guint	     n_keys)
+{
+  GRealTree *rtree;
+  GTreeNode **children;
+  gpointer *level_keys;
+  gpointer *level_values;
+  guint count;
+  guint i;
+
+  g_return_val_if_fail (key_compare_func != NULL, NULL);
+  g_return_val_if_fail (keys != NULL || n_keys == 0, NULL);
+
+  rtree = (GRealTree*) g_tree_new (key_compare_func);
+  if (!n_keys)
+    return (GTree*) rtree;
+
+  /* anything but strictly ascending keys is inserted one by one */
+  for (i = 1; i < n_keys; i++)
+    if ((* key_compare_func) (keys[i - 1], keys[i]) >= 0)
+      {
+	for (i = 0; i < n_keys; i++)
+	  g_tree_insert ((GTree*) rtree, keys[i], values ? values[i] : NULL);
+
+	return (GTree*) rtree;
+      }
+
+  /* build the levels bottom up, each of them with as few nodes as
+   * possible and the entries spread evenly, the entries between the
+   * nodes of one level make up the next one
+   */
+  children = NULL;
+  level_keys = keys;
+  level_values = values;
+  count = n_keys;
+  for (;;)
+    {
+      guint n_nodes = (count + G_TREE_MAX_KEYS + 1) / (G_TREE_MAX_KEYS + 1);
+      guint base = (count - (n_nodes - 1)) / n_nodes;
+      guint extra = (count - (n_nodes - 1)) % n_nodes;
+      GTreeNode **nodes = g_new (GTreeNode*, n_nodes);
+      gpointer *next_keys = NULL;
+      gpointer *next_values = NULL;
+      guint pos = 0, child = 0;
+      guint j;
+
+      if (n_nodes > 1)
+	{
+	  next_keys = g_new (gpointer, n_nodes - 1);
+	  next_values = g_new (gpointer, n_nodes - 1);
+	}
+
+      for (j = 0; j < n_nodes; j++)
+	{
+	  GTreeNode *node = g_tree_node_new (children == NULL);
+	  guint size = base + (j < extra);
+
+	  node->n_keys = size;
+	  for (i = 0; i < size; i++)
+	    {
+	      node->keys[i] = level_keys[pos + i];
+	      node->values[i] = level_values ? level_values[pos + i] : NULL;
+	    }
+	  if (children)
+	    for (i = 0; i <= size; i++)
+	      {
+		G_TREE_CHILDREN (node)[i] = children[child++];
+		G_TREE_CHILDREN (node)[i]->parent = node;
+	      }
+	  pos += size;
+	  if (j + 1 < n_nodes)
+	    {
+	      next_keys[j] = level_keys[pos];
+	      next_values[j] = level_values ? level_values[pos] : NULL;
+	      pos++;
+	    }
+	  nodes[j] = node;
+	}
+
+      if (children)
+	{
+	  g_free (children);
+	  g_free (level_keys);
+	  g_free (level_values);
+	}
+      if (n_nodes == 1)
+	{
+	  rtree->root = nodes[0];
+	  g_free (nodes);
+	  break;
+	}
+      children = nodes;
+      level_keys = next_keys;
+      level_values = next_values;
+      count = n_nodes - 1;
+    }
+  rtree->nnodes = n_keys;
 
   return (GTree*) rtree;
 }
@@ -176,15 +328,12 @@ g_tree_insert (GTree    *tree,
 	       gpointer  value)
 {
   GRealTree *rtree;
-  gint inserted;
 
   g_return_if_fail (tree != NULL);
 
   rtree = (GRealTree*) tree;
 
-  inserted = FALSE;
-  rtree->root = g_tree_node_insert (rtree->root, rtree->key_compare,
-				    key, value, &inserted);
+  g_tree_node_insert (rtree, key, value);
 }
 
 void
@@ -197,7 +346,7 @@ g_tree_remove (GTree    *tree,
 
   rtree = (GRealTree*) tree;
 
-  rtree->root = g_tree_node_remove (rtree->root, rtree->key_compare, key);
+  g_tree_node_remove (rtree, key);
 }
 
 gpointer
@@ -205,12 +354,22 @@ g_tree_lookup (GTree    *tree,
 	       gpointer  key)
 {
   GRealTree *rtree;
+  GTreeNode *node;
+  guint index;
 
   g_return_val_if_fail (tree != NULL, NULL);
 
   rtree = (GRealTree*) tree;
 
-  return g_tree_node_lookup (rtree->root, rtree->key_compare, key);
+  for (node = rtree->root; node; node = G_TREE_CHILDREN (node)[index])
+    {
+      if (g_tree_node_find (node, rtree->key_compare, key, &index))
+	return node->values[index];
+      if (node->is_leaf)
+	break;
+    }
+
+  return NULL;
 }
 
 void
@@ -220,6 +379,8 @@ g_tree_traverse (GTree         *tree,
 		 gpointer       data)
 {
   GRealTree *rtree;
+  GTreeNode *node;
+  guint index;
 
   g_return_if_fail (tree != NULL);
 
@@ -235,7 +396,14 @@ g_tree_traverse (GTree         *tree,
       break;
 
     case G_IN_ORDER:
-      g_tree_node_in_order (rtree->root, traverse_func, data);
+      node = g_tree_node_first (rtree->root);
+      index = 0;
+      do
+	{
+	  if ((*traverse_func) (node->keys[index], node->values[index], data))
+	    break;
+	}
+      while (g_tree_node_next (&node, &index));
       break;
 
     case G_POST_ORDER:
@@ -248,36 +416,237 @@ g_tree_traverse (GTree         *tree,
     }
 }
 
+void
+g_tree_traverse_range (GTree	     *tree,
+		       gpointer	      lower_key,
+		       gpointer	      upper_key,
+		       GTraverseFunc  traverse_func,
+		       gpointer	      data)
+{
+  GRealTree *rtree;
+  GTreeNode *node;
+  guint index;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (traverse_func != NULL);
+
+  rtree = (GRealTree*) tree;
+
+  if (!g_tree_node_bound (rtree->root, rtree->key_compare, lower_key, FALSE,
+			  &node, &index))
+    return;
+
+  do
+    {
+      if ((* rtree->key_compare) (node->keys[index], upper_key) >= 0 ||
+	  (*traverse_func) (node->keys[index], node->values[index], data))
+	break;
+    }
+  while (g_tree_node_next (&node, &index));
+}
+
+static gboolean
+g_tree_iter_set (GTreeIter *iter,
+		 GTree	   *tree,
+		 GTreeNode *node,
+		 guint	    index,
+		 gboolean   valid)
+{
+  iter->tree = tree;
+  iter->node = valid ? node : NULL;
+  iter->index = valid ? index : 0;
+
+  return valid;
+}
+
+gboolean
+g_tree_lower_bound (GTree     *tree,
+		    gpointer   key,
+		    GTreeIter *iter)
+{
+  GRealTree *rtree;
+  GTreeNode *node = NULL;
+  guint index = 0;
+  gboolean found;
+
+  g_return_val_if_fail (tree != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  rtree = (GRealTree*) tree;
+
+  found = g_tree_node_bound (rtree->root, rtree->key_compare, key, FALSE,
+			     &node, &index);
+
+  return g_tree_iter_set (iter, tree, node, index, found);
+}
+
+gboolean
+g_tree_upper_bound (GTree     *tree,
+		    gpointer   key,
+		    GTreeIter *iter)
+{
+  GRealTree *rtree;
+  GTreeNode *node = NULL;
+  guint index = 0;
+  gboolean found;
+
+  g_return_val_if_fail (tree != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  rtree = (GRealTree*) tree;
+
+  found = g_tree_node_bound (rtree->root, rtree->key_compare, key, TRUE,
+			     &node, &index);
+
+  return g_tree_iter_set (iter, tree, node, index, found);
+}
+
+gboolean
+g_tree_iter_first (GTree     *tree,
+		   GTreeIter *iter)
+{
+  GRealTree *rtree;
+
+  g_return_val_if_fail (tree != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  rtree = (GRealTree*) tree;
+
+  if (!rtree->root)
+    return g_tree_iter_set (iter, tree, NULL, 0, FALSE);
+
+  return g_tree_iter_set (iter, tree, g_tree_node_first (rtree->root), 0, TRUE);
+}
+
+gboolean
+g_tree_iter_last (GTree     *tree,
+		  GTreeIter *iter)
+{
+  GRealTree *rtree;
+  GTreeNode *node;
+
+  g_return_val_if_fail (tree != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  rtree = (GRealTree*) tree;
+
+  node = rtree->root;
+  if (!node)
+    return g_tree_iter_set (iter, tree, NULL, 0, FALSE);
+  while (!node->is_leaf)
+    node = G_TREE_CHILDREN (node)[node->n_keys];
+
+  return g_tree_iter_set (iter, tree, node, node->n_keys - 1, TRUE);
+}
+
+gboolean
+g_tree_iter_next (GTreeIter *iter)
+{
+  GTreeNode *node;
+  guint index;
+  gboolean found;
+
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  if (!iter->node)
+    return FALSE;
+
+  node = iter->node;
+  index = iter->index;
+  found = g_tree_node_next (&node, &index);
+
+  return g_tree_iter_set (iter, iter->tree, node, index, found);
+}
+
+gboolean
+g_tree_iter_prev (GTreeIter *iter)
+{
+  GTreeNode *node;
+  guint index;
+  gboolean found;
+
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  if (!iter->node)
+    return FALSE;
+
+  node = iter->node;
+  index = iter->index;
+  found = g_tree_node_prev (&node, &index);
+
+  return g_tree_iter_set (iter, iter->tree, node, index, found);
+}
+
+gpointer
+g_tree_iter_get_key (GTreeIter *iter)
+{
+  g_return_val_if_fail (iter != NULL, NULL);
+  g_return_val_if_fail (iter->node != NULL, NULL);
+
+  return ((GTreeNode*) iter->node)->keys[iter->index];
+}
+
+gpointer
+g_tree_iter_get_value (GTreeIter *iter)
+{
+  g_return_val_if_fail (iter != NULL, NULL);
+  g_return_val_if_fail (iter->node != NULL, NULL);
+
+  return ((GTreeNode*) iter->node)->values[iter->index];
+}
+
 gpointer
 g_tree_search (GTree       *tree,
 	       GSearchFunc  search_func,
 	       gpointer     data)
 {
   GRealTree *rtree;
+  GTreeNode *node;
 
   g_return_val_if_fail (tree != NULL, NULL);
 
   rtree = (GRealTree*) tree;
 
-  if (rtree->root)
-    return g_tree_node_search (rtree->root, search_func, data);
-  else
-    return NULL;
+  for (node = rtree->root; node; )
+    {
+      guint lo = 0, hi = node->n_keys;
+
+      while (lo < hi)
+	{
+	  guint mid = (lo + hi) / 2;
+	  gint dir = (* search_func) (node->keys[mid], data);
+
+	  if (dir == 0)
+	    return node->values[mid];
+	  if (dir < 0)
+	    hi = mid;
+	  else
+	    lo = mid + 1;
+	}
+      if (node->is_leaf)
+	break;
+      node = G_TREE_CHILDREN (node)[lo];
+    }
+
+  return NULL;
 }
 
 gint
 g_tree_height (GTree *tree)
 {
   GRealTree *rtree;
+  GTreeNode *node;
+  gint height;
 
   g_return_val_if_fail (tree != NULL, 0);
 
   rtree = (GRealTree*) tree;
 
-  if (rtree->root)
-    return g_tree_node_height (rtree->root);
-  else
-    return 0;
+  height = 0;
+  for (node = rtree->root; node; node = node->is_leaf ? NULL : G_TREE_CHILDREN (node)[0])
+    height++;
+
+  return height;
 }
 
 gint
@@ -289,286 +658,464 @@ g_tree_nnodes (GTree *tree)
 
   rtree = (GRealTree*) tree;
 
-  if (rtree->root)
-    return g_tree_node_count (rtree->root);
-  else
-    return 0;
+  return rtree->nnodes;
 }
 
-static GTreeNode*
-g_tree_node_insert (GTreeNode    *node,
-		    GCompareFunc  compare,
-		    gpointer      key,
-		    gpointer      value,
-		    gint         *inserted)
+/* binary search of node, index is the position of key or of the child
+ * that would hold it
+ */
+static inline gboolean
+g_tree_node_find (GTreeNode     *node,
+		  GCompareFunc   compare,
+		  gconstpointer  key,
+		  guint		*index)
 {
-  gint old_balance;
-  gint cmp;
+  guint lo = 0, hi = node->n_keys;
 
-  if (!node)
+  while (lo < hi)
     {
-      *inserted = TRUE;
-      return g_tree_node_new (key, value);
+      guint mid = (lo + hi) / 2;
+      gint cmp = (* compare) (key, node->keys[mid]);
+
+      if (cmp == 0)
+	{
+	  *index = mid;
+	  return TRUE;
+	}
+      if (cmp < 0)
+	hi = mid;
+      else
+	lo = mid + 1;
     }
 
-  cmp = (* compare) (key, node->key);
-  if (cmp == 0)
+  *index = lo;
+  return FALSE;
+}
+
+/* moves the median of the full child at index up into node, which
+ * must not be full
+ */
+static void
+g_tree_node_split_child (GTreeNode *node,
+			 guint      index)
+{
+  GTreeNode *child = G_TREE_CHILDREN (node)[index];
+  GTreeNode *sibling = g_tree_node_new (child->is_leaf);
+  guint i;
+
+  sibling->parent = node;
+  sibling->n_keys = G_TREE_MIN_KEYS;
+  g_memmove (sibling->keys, child->keys + G_TREE_MIN_DEGREE,
+	     G_TREE_MIN_KEYS * sizeof (gpointer));
+  g_memmove (sibling->values, child->values + G_TREE_MIN_DEGREE,
+	     G_TREE_MIN_KEYS * sizeof (gpointer));
+  if (!child->is_leaf)
+    for (i = 0; i < G_TREE_MIN_DEGREE; i++)
+      {
+	G_TREE_CHILDREN (sibling)[i] = G_TREE_CHILDREN (child)[G_TREE_MIN_DEGREE + i];
+	G_TREE_CHILDREN (sibling)[i]->parent = sibling;
+      }
+  child->n_keys = G_TREE_MIN_KEYS;
+
+  g_memmove (node->keys + index + 1, node->keys + index,
+	     (node->n_keys - index) * sizeof (gpointer));
+  g_memmove (node->values + index + 1, node->values + index,
+	     (node->n_keys - index) * sizeof (gpointer));
+  g_memmove (G_TREE_CHILDREN (node) + index + 2, G_TREE_CHILDREN (node) + index + 1,
+	     (node->n_keys - index) * sizeof (GTreeNode*));
+  node->keys[index] = child->keys[G_TREE_MIN_KEYS];
+  node->values[index] = child->values[G_TREE_MIN_KEYS];
+  G_TREE_CHILDREN (node)[index + 1] = sibling;
+  node->n_keys++;
+}
+
+/* merges the children at index and index + 1 and the entry between
+ * them, both children hold G_TREE_MIN_KEYS entries
+ */
+static void
+g_tree_node_merge_children (GTreeNode *node,
+			    guint      index)
+{
+  GTreeNode *child = G_TREE_CHILDREN (node)[index];
+  GTreeNode *sibling = G_TREE_CHILDREN (node)[index + 1];
+  guint i;
+
+  child->keys[child->n_keys] = node->keys[index];
+  child->values[child->n_keys] = node->values[index];
+  g_memmove (child->keys + child->n_keys + 1, sibling->keys,
+	     sibling->n_keys * sizeof (gpointer));
+  g_memmove (child->values + child->n_keys + 1, sibling->values,
+	     sibling->n_keys * sizeof (gpointer));
+  if (!child->is_leaf)
+    for (i = 0; i <= sibling->n_keys; i++)
+      {
+	G_TREE_CHILDREN (child)[child->n_keys + 1 + i] = G_TREE_CHILDREN (sibling)[i];
+	G_TREE_CHILDREN (sibling)[i]->parent = child;
+      }
+  child->n_keys += sibling->n_keys + 1;
+
+  node->n_keys--;
+  g_memmove (node->keys + index, node->keys + index + 1,
+	     (node->n_keys - index) * sizeof (gpointer));
+  g_memmove (node->values + index, node->values + index + 1,
+	     (node->n_keys - index) * sizeof (gpointer));
+  g_memmove (G_TREE_CHILDREN (node) + index + 1, G_TREE_CHILDREN (node) + index + 2,
+	     (node->n_keys - index) * sizeof (GTreeNode*));
+
+  g_tree_node_free (sibling);
+}
+
+/* moves the entry at index down into the left child, and the first
+ * entry of the right child up in its place
+ */
+static void
+g_tree_node_rotate_left (GTreeNode *node,
+			 guint      index)
+{
+  GTreeNode *left = G_TREE_CHILDREN (node)[index];
+  GTreeNode *right = G_TREE_CHILDREN (node)[index + 1];
+
+  left->keys[left->n_keys] = node->keys[index];
+  left->values[left->n_keys] = node->values[index];
+  node->keys[index] = right->keys[0];
+  node->values[index] = right->values[0];
+  if (!left->is_leaf)
     {
-      *inserted = FALSE;
-      node->value = value;
-      return node;
+      G_TREE_CHILDREN (left)[left->n_keys + 1] = G_TREE_CHILDREN (right)[0];
+      G_TREE_CHILDREN (left)[left->n_keys + 1]->parent = left;
+      g_memmove (G_TREE_CHILDREN (right), G_TREE_CHILDREN (right) + 1,
+		 right->n_keys * sizeof (GTreeNode*));
     }
+  left->n_keys++;
 
-  if (cmp < 0)
+  right->n_keys--;
+  g_memmove (right->keys, right->keys + 1, right->n_keys * sizeof (gpointer));
+  g_memmove (right->values, right->values + 1, right->n_keys * sizeof (gpointer));
+}
+
+/* moves the entry at index down into the right child, and the last
+ * entry of the left child up in its place
+ */
+static void
+g_tree_node_rotate_right (GTreeNode *node,
+			  guint      index)
+{
+  GTreeNode *left = G_TREE_CHILDREN (node)[index];
+  GTreeNode *right = G_TREE_CHILDREN (node)[index + 1];
+
+  g_memmove (right->keys + 1, right->keys, right->n_keys * sizeof (gpointer));
+  g_memmove (right->values + 1, right->values, right->n_keys * sizeof (gpointer));
+  right->keys[0] = node->keys[index];
+  right->values[0] = node->values[index];
+  if (!right->is_leaf)
     {
-      if (node->left)
-	{
-	  old_balance = node->left->balance;
-	  node->left = g_tree_node_insert (node->left, compare, key, value, inserted);
+      g_memmove (G_TREE_CHILDREN (right) + 1, G_TREE_CHILDREN (right),
+		 (right->n_keys + 1) * sizeof (GTreeNode*));
+      G_TREE_CHILDREN (right)[0] = G_TREE_CHILDREN (left)[left->n_keys];
+      G_TREE_CHILDREN (right)[0]->parent = right;
+    }
+  right->n_keys++;
 
-	  if ((old_balance != node->left->balance) && node->left->balance)
-	    node->balance -= 1;
-	}
-      else
-	{
-	  *inserted = TRUE;
-	  node->left = g_tree_node_new (key, value);
-	  node->balance -= 1;
-	}
+  left->n_keys--;
+  node->keys[index] = left->keys[left->n_keys];
+  node->values[index] = left->values[left->n_keys];
+}
+
+/* single pass from the root down, full nodes are split on the way so
+ * the leaf always has room
+ */
+static void
+g_tree_node_insert (GRealTree *rtree,
+		    gpointer   key,
+		    gpointer   value)
+{
+  GTreeNode *node;
+  guint index;
+
+  if (!rtree->root)
+    rtree->root = g_tree_node_new (TRUE);
+  else if (rtree->root->n_keys == G_TREE_MAX_KEYS)
+    {
+      node = g_tree_node_new (FALSE);
+      G_TREE_CHILDREN (node)[0] = rtree->root;
+      rtree->root->parent = node;
+      rtree->root = node;
+      g_tree_node_split_child (node, 0);
     }
-  else if (cmp > 0)
+
+  node = rtree->root;
+  for (;;)
     {
-      if (node->right)
-	{
-	  old_balance = node->right->balance;
-	  node->right = g_tree_node_insert (node->right, compare, key, value, inserted);
+      GTreeNode *child;
 
-	  if ((old_balance != node->right->balance) && node->right->balance)
-	    node->balance += 1;
-	}
-      else
+      if (g_tree_node_find (node, rtree->key_compare, key, &index))
 	{
-	  *inserted = TRUE;
-	  node->right = g_tree_node_new (key, value);
-	  node->balance += 1;
+	  node->values[index] = value;
+	  return;
 	}
-    }
+      if (node->is_leaf)
+	break;
 
-  if (*inserted)
-    {
-      if ((node->balance < -1) || (node->balance > 1))
-	node = g_tree_node_balance (node);
+      child = G_TREE_CHILDREN (node)[index];
+      if (child->n_keys == G_TREE_MAX_KEYS)
+	{
+	  gint cmp;
+
+	  g_tree_node_split_child (node, index);
+	  cmp = (* rtree->key_compare) (key, node->keys[index]);
+	  if (cmp == 0)
+	    {
+	      node->values[index] = value;
+	      return;
+	    }
+	  if (cmp > 0)
+	    index++;
+	  child = G_TREE_CHILDREN (node)[index];
+	}
+      node = child;
     }
 
-  return node;
+  g_memmove (node->keys + index + 1, node->keys + index,
+	     (node->n_keys - index) * sizeof (gpointer));
+  g_memmove (node->values + index + 1, node->values + index,
+	     (node->n_keys - index) * sizeof (gpointer));
+  node->keys[index] = key;
+  node->values[index] = value;
+  node->n_keys++;
+  rtree->nnodes++;
 }
 
-static GTreeNode*
-g_tree_node_remove (GTreeNode    *node,
-		    GCompareFunc  compare,
-		    gpointer      key)
+/* single pass from the root down, children with the minimum number of
+ * entries are filled up from a sibling or merged with it before the
+ * search descends into them, so the entry can always be taken out
+ */
+static void
+g_tree_node_remove (GRealTree *rtree,
+		    gpointer   key)
 {
-  GTreeNode *new_root;
-  gint old_balance;
-  gint cmp;
+  GTreeNode *node;
+  guint index;
 
+  node = rtree->root;
   if (!node)
-    return NULL;
+    return;
 
-  cmp = (* compare) (key, node->key);
-  if (cmp == 0)
+  for (;;)
     {
-      GTreeNode *garbage;
-
-      garbage = node;
+      GTreeNode *child;
 
-      if (!node->right)
-	{
-	  node = node->left;
-	}
-      else
+      if (g_tree_node_find (node, rtree->key_compare, key, &index))
 	{
-	  old_balance = node->right->balance;
-	  node->right = g_tree_node_remove_leftmost (node->right, &new_root);
-	  new_root->left = node->left;
-	  new_root->right = node->right;
-	  new_root->balance = node->balance;
-	  node = g_tree_node_restore_right_balance (new_root, old_balance);
+	  GTreeNode *left, *right;
+
+	  if (node->is_leaf)
+	    {
+	      node->n_keys--;
+	      g_memmove (node->keys + index, node->keys + index + 1,
+			 (node->n_keys - index) * sizeof (gpointer));
+	      g_memmove (node->values + index, node->values + index + 1,
+			 (node->n_keys - index) * sizeof (gpointer));
+	      rtree->nnodes--;
+	      break;
+	    }
+
+	  /* replace the entry with its predecessor or successor and
+	   * remove that one from the subtree instead
+	   */
+	  left = G_TREE_CHILDREN (node)[index];
+	  right = G_TREE_CHILDREN (node)[index + 1];
+	  if (left->n_keys > G_TREE_MIN_KEYS)
+	    {
+	      child = left;
+	      while (!child->is_leaf)
+		child = G_TREE_CHILDREN (child)[child->n_keys];
+	      node->keys[index] = child->keys[child->n_keys - 1];
+	      node->values[index] = child->values[child->n_keys - 1];
+	      key = node->keys[index];
+	      node = left;
+	    }
+	  else if (right->n_keys > G_TREE_MIN_KEYS)
+	    {
+	      child = right;
+	      while (!child->is_leaf)
+		child = G_TREE_CHILDREN (child)[0];
+	      node->keys[index] = child->keys[0];
+	      node->values[index] = child->values[0];
+	      key = node->keys[index];
+	      node = right;
+	    }
+	  else
+	    {
+	      g_tree_node_merge_children (node, index);
+	      node = left;
+	    }
+	  continue;
 	}
 
-      G_LOCK (g_tree_global);
-      garbage->right = node_free_list;
-      node_free_list = garbage;
-      G_UNLOCK (g_tree_global);
-   }
-  else if (cmp < 0)
-    {
-      if (node->left)
+      if (node->is_leaf)
+	break;
+
+      child = G_TREE_CHILDREN (node)[index];
+      if (child->n_keys == G_TREE_MIN_KEYS)
 	{
-	  old_balance = node->left->balance;
-	  node->left = g_tree_node_remove (node->left, compare, key);
-	  node = g_tree_node_restore_left_balance (node, old_balance);
+	  if (index > 0 &&
+	      G_TREE_CHILDREN (node)[index - 1]->n_keys > G_TREE_MIN_KEYS)
+	    g_tree_node_rotate_right (node, index - 1);
+	  else if (index < node->n_keys &&
+		   G_TREE_CHILDREN (node)[index + 1]->n_keys > G_TREE_MIN_KEYS)
+	    g_tree_node_rotate_left (node, index);
+	  else if (index < node->n_keys)
+	    g_tree_node_merge_children (node, index);
+	  else
+	    {
+	      g_tree_node_merge_children (node, index - 1);
+	      child = G_TREE_CHILDREN (node)[index - 1];
+	    }
 	}
+      node = child;
     }
-  else if (cmp > 0)
+
+  /* merging the root's children may have left it empty */
+  node = rtree->root;
+  if (node->n_keys == 0)
     {
-      if (node->right)
+      if (node->is_leaf)
+	rtree->root = NULL;
+      else
 	{
-	  old_balance = node->right->balance;
-	  node->right = g_tree_node_remove (node->right, compare, key);
-	  node = g_tree_node_restore_right_balance (node, old_balance);
+	  rtree->root = G_TREE_CHILDREN (node)[0];
+	  rtree->root->parent = NULL;
 	}
+      g_tree_node_free (node);
     }
-
-  return node;
 }
 
 static GTreeNode*
-g_tree_node_balance (GTreeNode *node)
+g_tree_node_first (GTreeNode *node)
 {
-  if (node->balance < -1)
-    {
-      if (node->left->balance > 0)
-	node->left = g_tree_node_rotate_left (node->left);
-      node = g_tree_node_rotate_right (node);
-    }
-  else if (node->balance > 1)
-    {
-      if (node->right->balance < 0)
-	node->right = g_tree_node_rotate_right (node->right);
-      node = g_tree_node_rotate_left (node);
-    }
+  while (!node->is_leaf)
+    node = G_TREE_CHILDREN (node)[0];
 
   return node;
 }
 
-static GTreeNode*
-g_tree_node_remove_leftmost (GTreeNode  *node,
-			     GTreeNode **leftmost)
+/* steps to the in order successor, FALSE at the end of the tree */
+static gboolean
+g_tree_node_next (GTreeNode **node_p,
+		  guint	     *index_p)
 {
-  gint old_balance;
+  GTreeNode *node = *node_p;
+  guint index = *index_p + 1;
 
-  if (!node->left)
+  if (!node->is_leaf)
     {
-      *leftmost = node;
-      return node->right;
+      node = g_tree_node_first (G_TREE_CHILDREN (node)[index]);
+      index = 0;
     }
+  else
+    while (index >= node->n_keys)
+      {
+	GTreeNode *parent = node->parent;
 
-  old_balance = node->left->balance;
-  node->left = g_tree_node_remove_leftmost (node->left, leftmost);
-  return g_tree_node_restore_left_balance (node, old_balance);
-}
-
-static GTreeNode*
-g_tree_node_restore_left_balance (GTreeNode *node,
-				  gint       old_balance)
-{
-  if (!node->left)
-    node->balance += 1;
-  else if ((node->left->balance != old_balance) &&
-	   (node->left->balance == 0))
-    node->balance += 1;
-
-  if (node->balance > 1)
-    return g_tree_node_balance (node);
-  return node;
-}
+	if (!parent)
+	  return FALSE;
+	for (index = 0; G_TREE_CHILDREN (parent)[index] != node; index++)
+	  ;
+	node = parent;
+      }
 
-static GTreeNode*
-g_tree_node_restore_right_balance (GTreeNode *node,
-				   gint       old_balance)
-{
-  if (!node->right)
-    node->balance -= 1;
-  else if ((node->right->balance != old_balance) &&
-	   (node->right->balance == 0))
-    node->balance -= 1;
+  *node_p = node;
+  *index_p = index;
 
-  if (node->balance < -1)
-    return g_tree_node_balance (node);
-  return node;
+  return TRUE;
 }
 
-static gpointer
-g_tree_node_lookup (GTreeNode    *node,
-		    GCompareFunc  compare,
-		    gpointer      key)
+/* steps to the in order predecessor, FALSE at the start of the tree */
+static gboolean
+g_tree_node_prev (GTreeNode **node_p,
+		  guint	     *index_p)
 {
-  gint cmp;
-
-  if (!node)
-    return NULL;
-
-  cmp = (* compare) (key, node->key);
-  if (cmp == 0)
-    return node->value;
+  GTreeNode *node = *node_p;
+  guint index = *index_p;
 
-  if (cmp < 0)
+  if (!node->is_leaf)
     {
-      if (node->left)
-	return g_tree_node_lookup (node->left, compare, key);
+      node = G_TREE_CHILDREN (node)[index];
+      while (!node->is_leaf)
+	node = G_TREE_CHILDREN (node)[node->n_keys];
+      index = node->n_keys;
     }
-  else if (cmp > 0)
-    {
-      if (node->right)
-	return g_tree_node_lookup (node->right, compare, key);
-    }
-
-  return NULL;
-}
+  else
+    while (index == 0)
+      {
+	GTreeNode *parent = node->parent;
 
-static gint
-g_tree_node_count (GTreeNode *node)
-{
-  gint count;
+	if (!parent)
+	  return FALSE;
+	for (index = 0; G_TREE_CHILDREN (parent)[index] != node; index++)
+	  ;
+	node = parent;
+      }
 
-  count = 1;
-  if (node->left)
-    count += g_tree_node_count (node->left);
-  if (node->right)
-    count += g_tree_node_count (node->right);
+  *node_p = node;
+  *index_p = index - 1;
 
-  return count;
+  return TRUE;
 }
 
-static gint
-g_tree_node_pre_order (GTreeNode     *node,
-		       GTraverseFunc  traverse_func,
-		       gpointer       data)
+/* finds the first entry not less than key, or greater than key if
+ * upper is set
+ */
+static gboolean
+g_tree_node_bound (GTreeNode	 *node,
+		   GCompareFunc	  compare,
+		   gconstpointer  key,
+		   gboolean	  upper,
+		   GTreeNode	**node_p,
+		   guint	 *index_p)
 {
-  if ((*traverse_func) (node->key, node->value, data))
-    return TRUE;
-  if (node->left)
-    {
-      if (g_tree_node_pre_order (node->left, traverse_func, data))
-	return TRUE;
-    }
-  if (node->right)
+  gboolean found = FALSE;
+
+  while (node)
     {
-      if (g_tree_node_pre_order (node->right, traverse_func, data))
-	return TRUE;
+      guint lo = 0, hi = node->n_keys;
+
+      while (lo < hi)
+	{
+	  guint mid = (lo + hi) / 2;
+	  gint cmp = (* compare) (key, node->keys[mid]);
+
+	  if (cmp < 0 || (cmp == 0 && !upper))
+	    hi = mid;
+	  else
+	    lo = mid + 1;
+	}
+      if (lo < node->n_keys)
+	{
+	  *node_p = node;
+	  *index_p = lo;
+	  found = TRUE;
+	}
+      node = node->is_leaf ? NULL : G_TREE_CHILDREN (node)[lo];
     }
 
-  return FALSE;
+  return found;
 }
 
 static gint
-g_tree_node_in_order (GTreeNode     *node,
-		      GTraverseFunc  traverse_func,
-		      gpointer       data)
+g_tree_node_pre_order (GTreeNode     *node,
+		       GTraverseFunc  traverse_func,
+		       gpointer       data)
 {
-  if (node->left)
-    {
-      if (g_tree_node_in_order (node->left, traverse_func, data))
-	return TRUE;
-    }
-  if ((*traverse_func) (node->key, node->value, data))
-    return TRUE;
-  if (node->right)
-    {
-      if (g_tree_node_in_order (node->right, traverse_func, data))
+  guint i;
+
+  for (i = 0; i < node->n_keys; i++)
+    if ((*traverse_func) (node->keys[i], node->values[i], data))
+      return TRUE;
+  if (!node->is_leaf)
+    for (i = 0; i <= node->n_keys; i++)
+      if (g_tree_node_pre_order (G_TREE_CHILDREN (node)[i], traverse_func, data))
 	return TRUE;
-    }
 
   return FALSE;
 }
@@ -578,167 +1125,307 @@ g_tree_node_post_order (GTreeNode     *node,
 			GTraverseFunc  traverse_func,
 			gpointer       data)
 {
-  if (node->left)
-    {
-      if (g_tree_node_post_order (node->left, traverse_func, data))
-	return TRUE;
-    }
-  if (node->right)
-    {
-      if (g_tree_node_post_order (node->right, traverse_func, data))
+  guint i;
+
+  if (!node->is_leaf)
+    for (i = 0; i <= node->n_keys; i++)
+      if (g_tree_node_post_order (G_TREE_CHILDREN (node)[i], traverse_func, data))
 	return TRUE;
-    }
-  if ((*traverse_func) (node->key, node->value, data))
-    return TRUE;
+  for (i = 0; i < node->n_keys; i++)
+    if ((*traverse_func) (node->keys[i], node->values[i], data))
+      return TRUE;
 
   return FALSE;
 }
 
-static gpointer
-g_tree_node_search (GTreeNode   *node,
-		    GSearchFunc  search_func,
-		    gpointer     data)
+
+/* Snapshots
+ *
+ * An image holds the header, the key and value bytes, then the
+ * entries in key order. Offsets count from the start of the file.
+ * Every key is followed by at least one nul byte of padding, so that
+ * string compare functions stop in time whatever the bytes of the key
+ * are.
+ */
+#define TREE_SNAPSHOT_MAGIC	"GTreeV1"
+#define TREE_SNAPSHOT_ALIGN(n)	(((n) + 7) & ~((gulong) 7))
+
+typedef struct _GTreeSnapshotHeader GTreeSnapshotHeader;
+typedef struct _GTreeSnapshotEntry  GTreeSnapshotEntry;
+
+struct _GTreeSnapshotHeader
 {
-  gint dir;
+  gchar	  magic[8];
+  guint32 byte_order;
+  guint32 sizeof_long;
+  gulong  length;		/* of the file */
+  gulong  n_entries;
+  gulong  entries;
+};
 
-  if (!node)
-    return NULL;
+struct _GTreeSnapshotEntry
+{
+  guint	  key_length;
+  guint	  value_length;
+  gulong  key;
+  gulong  value;
+};
+
+struct _GMappedTree
+{
+  GMappedFile		    *file;
+  const gchar		    *image;
+  const GTreeSnapshotHeader *header;
+  const GTreeSnapshotEntry  *entries;
+  GCompareFunc		     key_compare;
+};
 
-  do {
-    dir = (* search_func) (node->key, data);
-    if (dir == 0)
-      return node->value;
+static gboolean
+g_tree_snapshot_write (FILE	     *file,
+		       gulong	     *offset,
+		       gconstpointer  data,
+		       gulong	      length,
+		       gboolean	      terminate)
+{
+  static const gchar padding[8] = { 0, };
+  gulong n_padding = TREE_SNAPSHOT_ALIGN (length + (terminate != FALSE)) - length;
 
-    if (dir < 0)
-      node = node->left;
-    else if (dir > 0)
-      node = node->right;
-  } while (node && (dir != 0));
+  *offset += length + n_padding;
 
-  return NULL;
+  return ((length == 0 || fwrite (data, 1, length, file) == length) &&
+	  (n_padding == 0 || fwrite (padding, 1, n_padding, file) == n_padding));
 }
 
-static gint
-g_tree_node_height (GTreeNode *node)
+static gconstpointer
+g_tree_snapshot_bytes (GSnapshotFunc func,
+		       gpointer	     item,
+		       guint	    *length,
+		       gpointer	     user_data)
 {
-  gint left_height;
-  gint right_height;
+  if (func)
+    return func (item, length, user_data);
 
-  if (node)
-    {
-      left_height = 0;
-      right_height = 0;
+  *length = item ? strlen (item) + 1 : 0;
 
-      if (node->left)
-	left_height = g_tree_node_height (node->left);
+  return item;
+}
 
-      if (node->right)
-	right_height = g_tree_node_height (node->right);
+gboolean
+g_tree_save (GTree	   *tree,
+	     const gchar   *file_name,
+	     GSnapshotFunc  key_func,
+	     GSnapshotFunc  value_func,
+	     gpointer	    user_data)
+{
+  GRealTree *rtree = (GRealTree*) tree;
+  GTreeSnapshotHeader header;
+  GTreeSnapshotEntry *entries;
+  gboolean failed = FALSE;
+  GTreeIter iter;
+  gulong offset = 0;
+  gulong n = 0;
+  gchar *tmp_name;
+  FILE *file;
+
+  g_return_val_if_fail (tree != NULL, FALSE);
+  g_return_val_if_fail (file_name != NULL, FALSE);
+
+  /* write a new file and rename it over the old one, which may be
+   * mapped by other processes
+   */
+  tmp_name = g_strconcat (file_name, ".tmp", NULL);
+  file = fopen (tmp_name, "wb");
+  if (!file)
+    {
+      g_free (tmp_name);
+      return FALSE;
+    }
 
-      return MAX (left_height, right_height) + 1;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, TREE_SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.byte_order = G_BYTE_ORDER;
+  header.sizeof_long = sizeof (glong);
+  header.n_entries = rtree->nnodes;
+  entries = g_new (GTreeSnapshotEntry, MAX (rtree->nnodes, 1));
+
+  failed |= !g_tree_snapshot_write (file, &offset, &header, sizeof (header), FALSE);
+  if (g_tree_iter_first (tree, &iter))
+    do
+      {
+	GTreeSnapshotEntry *entry = &entries[n++];
+	gconstpointer bytes;
+	guint length;
+
+	bytes = g_tree_snapshot_bytes (key_func, g_tree_iter_get_key (&iter),
+				       &length, user_data);
+	entry->key = offset;
+	entry->key_length = length;
+	failed |= !g_tree_snapshot_write (file, &offset, bytes, length, TRUE);
+
+	bytes = g_tree_snapshot_bytes (value_func, g_tree_iter_get_value (&iter),
+				       &length, user_data);
+	entry->value = offset;
+	entry->value_length = length;
+	failed |= !g_tree_snapshot_write (file, &offset, bytes, length, FALSE);
+      }
+    while (!failed && g_tree_iter_next (&iter));
+
+  header.entries = offset;
+  failed |= !g_tree_snapshot_write (file, &offset, entries, n * sizeof (GTreeSnapshotEntry), FALSE);
+  header.length = offset;
+  g_free (entries);
+
+  if (!failed &&
+      (fseek (file, 0, SEEK_SET) != 0 ||
+       fwrite (&header, sizeof (header), 1, file) != 1))
+    failed = TRUE;
+  if (fclose (file) != 0)
+    failed = TRUE;
+
+#ifdef NATIVE_WIN32
+  if (!failed)
+    remove (file_name);
+#endif /* NATIVE_WIN32 */
+  if (failed || rename (tmp_name, file_name) != 0)
+    {
+      remove (tmp_name);
+      failed = TRUE;
     }
+  g_free (tmp_name);
 
-  return 0;
+  return !failed;
 }
 
-static GTreeNode*
-g_tree_node_rotate_left (GTreeNode *node)
+/* whether length bytes at offset lie within the image, followed by a
+ * nul byte if they are a key
+ */
+static gboolean
+g_tree_snapshot_check_bytes (const gchar *image,
+			     gulong	  image_length,
+			     gulong	  offset,
+			     gulong	  length,
+			     gboolean	  terminated)
 {
-  GTreeNode *left;
-  GTreeNode *right;
-  gint a_bal;
-  gint b_bal;
+  if (offset > image_length || length > image_length - offset)
+    return FALSE;
 
-  left = node->left;
-  right = node->right;
+  return !terminated || (length < image_length - offset && !image[offset + length]);
+}
 
-  node->right = right->left;
-  right->left = node;
+/* the whole image is checked once here, lookups trust it afterwards */
+static gboolean
+g_tree_snapshot_check (const gchar *image,
+		       gulong	    length)
+{
+  const GTreeSnapshotHeader *header = (const GTreeSnapshotHeader*) image;
+  const GTreeSnapshotEntry *entries;
+  gulong i;
+
+  if (length < sizeof (GTreeSnapshotHeader) ||
+      memcmp (header->magic, TREE_SNAPSHOT_MAGIC, sizeof (header->magic)) != 0 ||
+      header->byte_order != G_BYTE_ORDER ||
+      header->sizeof_long != sizeof (glong) ||
+      header->length != length ||
+      header->entries % 8 != 0 ||
+      header->entries > length ||
+      (length - header->entries) / sizeof (GTreeSnapshotEntry) < header->n_entries ||
+      header->n_entries > G_MAXINT)
+    return FALSE;
+
+  entries = (const GTreeSnapshotEntry*) (image + header->entries);
+  for (i = 0; i < header->n_entries; i++)
+    if (!g_tree_snapshot_check_bytes (image, length, entries[i].key,
+				      entries[i].key_length, TRUE) ||
+	!g_tree_snapshot_check_bytes (image, length, entries[i].value,
+				      entries[i].value_length, FALSE))
+      return FALSE;
+
+  return TRUE;
+}
 
-  a_bal = node->balance;
-  b_bal = right->balance;
+GMappedTree*
+g_tree_map (const gchar	 *file_name,
+	    GCompareFunc  key_compare_func)
+{
+  const GTreeSnapshotHeader *header;
+  GMappedTree *tree;
+  GMappedFile *file;
+  gulong length;
 
-  if (b_bal <= 0)
-    {
-      if (a_bal >= 1)
-	right->balance = b_bal - 1;
-      else
-	right->balance = a_bal + b_bal - 2;
-      node->balance = a_bal - 1;
-    }
-  else
+  g_return_val_if_fail (file_name != NULL, NULL);
+  g_return_val_if_fail (key_compare_func != NULL, NULL);
+
+  file = g_mapped_file_new (file_name);
+  if (!file)
+    return NULL;
+
+  length = g_mapped_file_get_length (file);
+  header = (const GTreeSnapshotHeader*) g_mapped_file_get_contents (file);
+  if (!g_tree_snapshot_check ((const gchar*) header, length))
     {
-      if (a_bal <= b_bal)
-	right->balance = a_bal - 2;
-      else
-	right->balance = b_bal - 1;
-      node->balance = a_bal - b_bal - 1;
+      g_mapped_file_free (file);
+      return NULL;
     }
 
-  return right;
+  tree = g_new (GMappedTree, 1);
+  tree->file = file;
+  tree->image = (const gchar*) header;
+  tree->header = header;
+  tree->entries = (const GTreeSnapshotEntry*) (tree->image + header->entries);
+  tree->key_compare = key_compare_func;
+
+  return tree;
 }
 
-static GTreeNode*
-g_tree_node_rotate_right (GTreeNode *node)
+void
+g_mapped_tree_unmap (GMappedTree *tree)
+{
+  g_return_if_fail (tree != NULL);
+
+  g_mapped_file_free (tree->file);
+  g_free (tree);
+}
+
+gint
+g_mapped_tree_nnodes (GMappedTree *tree)
 {
-  GTreeNode *left;
-  gint a_bal;
-  gint b_bal;
+  g_return_val_if_fail (tree != NULL, 0);
 
-  left = node->left;
+  return tree->header->n_entries;
+}
 
-  node->left = left->right;
-  left->right = node;
+gconstpointer
+g_mapped_tree_lookup (GMappedTree   *tree,
+		      gconstpointer  key,
+		      guint	    *value_length)
+{
+  gulong lower, upper;
 
-  a_bal = node->balance;
-  b_bal = left->balance;
+  g_return_val_if_fail (tree != NULL, NULL);
 
-  if (b_bal <= 0)
-    {
-      if (b_bal > a_bal)
-	left->balance = b_bal + 1;
-      else
-	left->balance = a_bal + 2;
-      node->balance = a_bal - b_bal + 1;
-    }
-  else
+  lower = 0;
+  upper = tree->header->n_entries;
+  while (lower < upper)
     {
-      if (a_bal <= -1)
-	left->balance = b_bal + 1;
+      gulong middle = lower + (upper - lower) / 2;
+      const GTreeSnapshotEntry *entry = &tree->entries[middle];
+      gint cmp = tree->key_compare (key, tree->image + entry->key);
+
+      if (cmp == 0)
+	{
+	  if (value_length)
+	    *value_length = entry->value_length;
+
+	  return tree->image + entry->value;
+	}
+      if (cmp < 0)
+	upper = middle;
       else
-	left->balance = a_bal + b_bal + 2;
-      node->balance = a_bal + 1;
+	lower = middle + 1;
     }
 
-  return left;
-}
+  if (value_length)
+    *value_length = 0;
 
-static void
-g_tree_node_check (GTreeNode *node)
-{
-  gint left_height;
-  gint right_height;
-  gint balance;
-  
-  if (node)
-    {
-      left_height = 0;
-      right_height = 0;
-      
-      if (node->left)
-	left_height = g_tree_node_height (node->left);
-      if (node->right)
-	right_height = g_tree_node_height (node->right);
-      
-      balance = right_height - left_height;
-      if (balance != node->balance)
-	g_log (g_log_domain_glib, G_LOG_LEVEL_INFO,
-	       "g_tree_node_check: failed: %d ( %d )\n",
-	       balance, node->balance);
-      
-      if (node->left)
-	g_tree_node_check (node->left);
-      if (node->right)
-	g_tree_node_check (node->right);
-    }
+  return NULL;
 }
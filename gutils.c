@@ -46,9 +46,15 @@
 #include <pwd.h>
 #endif
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #ifdef HAVE_SYS_PARAM_H
 #include <sys/param.h>
 #endif
+#if defined (HAVE_SYS_MMAN_H) && defined (HAVE_MMAP)
+#include <sys/mman.h>
+#define	G_MAPPED_FILE_USE_MMAP
+#endif
 
 #ifdef NATIVE_WIN32
 #  define STRICT			/* Strict typing, please */
@@ -67,6 +73,10 @@
 #define	G_CAN_INLINE 1
 #include "glib.h"
 
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
 #ifdef	MAXPATHLEN
 #define	G_PATH_LENGTH	(MAXPATHLEN + 1)
 #elif	defined (PATH_MAX)
@@ -363,6 +373,105 @@ g_get_current_dir (void)
   return dir;
 }
 
+struct _GMappedFile
+{
+  gchar	  *contents;
+  gulong   length;
+  gboolean mapped;
+};
+
+GMappedFile*
+g_mapped_file_new (const gchar *file_name)
+{
+  GMappedFile *file;
+  struct stat st;
+  gulong n_read;
+  gint fd;
+
+  g_return_val_if_fail (file_name != NULL, NULL);
+
+  fd = open (file_name, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return NULL;
+    }
+
+  file = g_new (GMappedFile, 1);
+  file->length = st.st_size;
+  file->mapped = FALSE;
+
+#ifdef G_MAPPED_FILE_USE_MMAP
+  if (file->length > 0)
+    {
+      gpointer mapping = mmap (NULL, file->length, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (mapping != MAP_FAILED)
+	{
+	  file->contents = mapping;
+	  file->mapped = TRUE;
+	  close (fd);
+
+	  return file;
+	}
+    }
+#endif	/* G_MAPPED_FILE_USE_MMAP */
+
+  file->contents = g_malloc (file->length + 1);
+  for (n_read = 0; n_read < file->length; )
+    {
+      gint n = read (fd, file->contents + n_read, file->length - n_read);
+
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n <= 0)
+	{
+	  g_free (file->contents);
+	  g_free (file);
+	  close (fd);
+
+	  return NULL;
+	}
+      n_read += n;
+    }
+  file->contents[file->length] = 0;
+  close (fd);
+
+  return file;
+}
+
+void
+g_mapped_file_free (GMappedFile *file)
+{
+  g_return_if_fail (file != NULL);
+
+#ifdef G_MAPPED_FILE_USE_MMAP
+  if (file->mapped)
+    munmap (file->contents, file->length);
+  else
+#endif	/* G_MAPPED_FILE_USE_MMAP */
+    g_free (file->contents);
+  g_free (file);
+}
+
+gulong
+g_mapped_file_get_length (GMappedFile *file)
+{
+  g_return_val_if_fail (file != NULL, 0);
+
+  return file->length;
+}
+
+gchar*
+g_mapped_file_get_contents (GMappedFile *file)
+{
+  g_return_val_if_fail (file != NULL, NULL);
+
+  return file->contents;
+}
+
 gchar*
 g_getenv (const gchar *variable)
 {
@@ -143,6 +143,63 @@ int main(int argc, char** argv)
        g_date_year(d) == 2000);
   if (failed)
     g_date_debug_print(d);
+
+  g_date_set_parse(d, "2001-03-07");
+  TEST("Parsed an ISO 8601 date",
+       g_date_valid(d) &&
+       g_date_year(d) == 2001 && g_date_month(d) == 3 && g_date_day(d) == 7);
+  g_date_set_parse(d, "20010307");
+  TEST("Parsed a YYYYMMDD date",
+       g_date_valid(d) &&
+       g_date_year(d) == 2001 && g_date_month(d) == 3 && g_date_day(d) == 7);
+  g_date_set_parse(d, "2001-02-29");
+  TEST("Rejected an invalid ISO 8601 date", !g_date_valid(d));
+  g_date_set_parse(d, "2001-3-7");
+  TEST("Parsed a loose numeric date", g_date_valid(d));
+
+  {
+    GDate dates[1000], single;
+    guint32 julians[1000];
+    GDateDay days[1000];
+    GDateMonth months[1000];
+    GDateYear years[1000];
+    guint k;
+
+    for (j = 0; j < 3000000; j += 1000)
+      {
+        for (k = 0; k < 1000; k++)
+          julians[k] = j + k * 7 % 1000;
+        g_date_set_julian_many (dates, julians, 1000);
+        for (k = 0; k < 1000; k++)
+          if (julians[k] == G_DATE_BAD_JULIAN)
+            TEST("Bad julian gives an invalid date", !g_date_valid (&dates[k]));
+          else
+            {
+              g_date_clear (&single, 1);
+              g_date_set_julian (&single, julians[k]);
+              TEST("Bulk julian conversion matches",
+                   g_date_valid (&dates[k]) &&
+                   g_date_day (&dates[k]) == g_date_day (&single) &&
+                   g_date_month (&dates[k]) == g_date_month (&single) &&
+                   g_date_year (&dates[k]) == g_date_year (&single));
+            }
+
+        for (k = 0; k < 1000; k++)
+          {
+            g_date_clear (&dates[k], 1);
+            if (julians[k] != G_DATE_BAD_JULIAN)
+              g_date_set_julian (&dates[k], julians[k]);
+          }
+        g_date_to_dmy_many (dates, 1000, days, months, years);
+        for (k = 0; k < 1000; k++)
+          TEST("Bulk DMY conversion matches",
+               julians[k] == G_DATE_BAD_JULIAN ?
+               days[k] == G_DATE_BAD_DAY && months[k] == G_DATE_BAD_MONTH && years[k] == G_DATE_BAD_YEAR :
+               days[k] == g_date_day (&dates[k]) &&
+               months[k] == g_date_month (&dates[k]) &&
+               years[k] == g_date_year (&dates[k]));
+      }
+  }
   
   g_date_free(d);
 
@@ -27,6 +27,7 @@
 #undef G_LOG_DOMAIN
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "glib.h"
 
@@ -55,6 +56,152 @@ typedef struct {
 	gchar name[40];
 } GlibTestInfo;
 
+static gint
+int_compare (gconstpointer a,
+	     gconstpointer b)
+{
+  return *(const gint*) a - *(const gint*) b;
+}
+
+static gint
+double_compare (gconstpointer a,
+		gconstpointer b)
+{
+  gdouble d = *(const gdouble*) a - *(const gdouble*) b;
+
+  return d < 0 ? -1 : d > 0;
+}
+
+static gint
+info_compare (gconstpointer a,
+	      gconstpointer b)
+{
+  return ((const GlibTestInfo*) a)->age - ((const GlibTestInfo*) b)->age;
+}
+
+static gint
+pointer_compare (gconstpointer a,
+		 gconstpointer b)
+{
+  return GPOINTER_TO_INT (*(gpointer const*) a) - GPOINTER_TO_INT (*(gpointer const*) b);
+}
+
+static void
+sort_test (void)
+{
+  GArray *garray;
+  GPtrArray *gparray;
+  guint index;
+  gint i, j;
+
+  /* random, presorted, reversed and constant input */
+  for (j = 0; j < 4; j++)
+    {
+      garray = g_array_new (FALSE, FALSE, sizeof (gint));
+      for (i = 0; i < 10000; i++)
+	{
+	  gint v = (j == 0 ? (i * 7919) % 10007 :
+		    j == 1 ? i :
+		    j == 2 ? 10000 - i : 42);
+
+	  g_array_append_val (garray, v);
+	}
+      g_array_sort (garray, int_compare);
+      for (i = 1; i < 10000; i++)
+	g_assert (g_array_index (garray, gint, i - 1) <= g_array_index (garray, gint, i));
+      g_array_free (garray, TRUE);
+    }
+
+  garray = g_array_new (FALSE, FALSE, sizeof (gint));
+  for (i = 0; i < 1000; i++)
+    {
+      gint v = ((i * 131) % 1000) * 2;
+
+      g_array_append_val (garray, v);
+    }
+  g_array_sort (garray, int_compare);
+  for (i = 0; i < 2000; i++)
+    {
+      g_assert (g_array_binary_search (garray, &i, int_compare, &index) == (i % 2 == 0));
+      g_assert (index == (i + 1) / 2);
+    }
+  i = 5000;
+  g_assert (!g_array_binary_search (garray, &i, int_compare, &index));
+  g_assert (index == 1000);
+  g_array_free (garray, TRUE);
+
+  garray = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  for (i = 0; i < 1000; i++)
+    {
+      gdouble v = ((i * 389) % 1000) / 4.0;
+
+      g_array_append_val (garray, v);
+    }
+  g_array_sort (garray, double_compare);
+  for (i = 0; i < 1000; i++)
+    g_assert (g_array_index (garray, gdouble, i) == i / 4.0);
+  g_array_free (garray, TRUE);
+
+  garray = g_array_new (FALSE, TRUE, sizeof (GlibTestInfo));
+  for (i = 0; i < 500; i++)
+    {
+      GlibTestInfo info;
+
+      info.age = (i * 263) % 500;
+      g_snprintf (info.name, sizeof (info.name), "%d", info.age);
+      g_array_append_val (garray, info);
+    }
+  g_array_sort (garray, info_compare);
+  for (i = 0; i < 500; i++)
+    {
+      GlibTestInfo *info = &g_array_index (garray, GlibTestInfo, i);
+
+      g_assert (info->age == i);
+      g_assert (atoi (info->name) == i);
+    }
+  g_array_free (garray, TRUE);
+
+  gparray = g_ptr_array_new ();
+  for (i = 0; i < 10000; i++)
+    g_ptr_array_add (gparray, GINT_TO_POINTER ((i * 7919) % 10000));
+  g_ptr_array_sort (gparray, pointer_compare);
+  for (i = 0; i < 10000; i++)
+    g_assert (g_ptr_array_index (gparray, i) == GINT_TO_POINTER (i));
+  g_ptr_array_free (gparray, TRUE);
+}
+
+static void
+shrink_test (void)
+{
+  GArray *garray;
+  GPtrArray *gparray;
+  gint i;
+
+  garray = g_array_new (TRUE, FALSE, sizeof (gint));
+  for (i = 0; i < 10000; i++)
+    g_array_append_val (garray, i);
+  while (garray->len > 10)
+    g_array_remove_index_fast (garray, 0);
+  g_array_shrink (garray);
+  g_assert (garray->len == 10);
+  g_assert (g_array_index (garray, gint, 10) == 0);
+  for (i = 0; i < 10; i++)
+    g_array_remove_index (garray, 0);
+  g_assert (g_array_index (garray, gint, 0) == 0);
+  g_array_free (garray, TRUE);
+
+  gparray = g_ptr_array_new ();
+  for (i = 0; i < 10000; i++)
+    g_ptr_array_add (gparray, GINT_TO_POINTER (i));
+  for (i = 0; i < 9990; i++)
+    g_assert (g_ptr_array_remove_index (gparray, gparray->len - 1) == GINT_TO_POINTER (9999 - i));
+  g_ptr_array_shrink (gparray);
+  for (i = 0; i < 10; i++)
+    g_assert (g_ptr_array_index (gparray, i) == GINT_TO_POINTER (i));
+  g_ptr_array_set_size (gparray, 100);
+  g_assert (g_ptr_array_index (gparray, 99) == NULL);
+  g_ptr_array_free (gparray, TRUE);
+}
 
 int
 main (int   argc,
@@ -64,6 +211,7 @@ main (int   argc,
   GArray *garray;
   GPtrArray *gparray;
   GByteArray *gbarray;
+  GRingArray *gring;
 
   /* array tests */
   garray = g_array_new (FALSE, FALSE, sizeof (gint));
@@ -110,6 +258,48 @@ main (int   argc,
 
   g_byte_array_free (gbarray, TRUE);
 
+  /* ring arrays */
+  gring = g_ring_array_new (sizeof (gint));
+  for (i = 0; i < 10000; i++)
+    {
+      g_ring_array_push_tail_val (gring, i);
+      if (i % 3 == 0)
+	{
+	  gint v;
+
+	  g_assert (g_ring_array_pop_head (gring, &v));
+	  g_assert (v == i / 3);
+	}
+    }
+
+  g_assert (gring->len == 10000 - 3334);
+  for (i = 0; i < gring->len; i++)
+    g_assert (g_ring_array_index (gring, gint, i) == 3334 + i);
+
+  for (i = 0; i < 3334; i++)
+    g_ring_array_push_head_val (gring, i);
+
+  g_assert (gring->len == 10000);
+  for (i = 0; i < 3334; i++)
+    g_assert (g_ring_array_index (gring, gint, i) == 3333 - i);
+
+  for (i = 9999; i >= 3334; i--)
+    {
+      gint v;
+
+      g_assert (g_ring_array_pop_tail (gring, &v));
+      g_assert (v == i);
+    }
+  while (g_ring_array_pop_tail (gring, NULL))
+    ;
+  g_assert (gring->len == 0);
+  g_assert (!g_ring_array_pop_head (gring, NULL));
+
+  g_ring_array_free (gring);
+
+  sort_test ();
+  shrink_test ();
+
   return 0;
 }
 
@@ -0,0 +1,82 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include "glib.h"
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GAsyncQueue *queue;
+  GTimeVal end_time;
+  gint i, j;
+
+  queue = g_async_queue_new ();
+
+  g_assert (g_async_queue_try_pop (queue) == NULL);
+  g_assert (g_async_queue_length (queue) == 0);
+
+  /* more than fit in the ring, so some spill over, in order */
+  for (i = 1; i <= 5000; i++)
+    g_async_queue_push (queue, GINT_TO_POINTER (i));
+  g_assert (g_async_queue_length (queue) == 5000);
+
+  for (i = 1; i <= 2500; i++)
+    g_assert (GPOINTER_TO_INT (g_async_queue_pop (queue)) == i);
+
+  /* pushes after a spill stay behind the spilled items */
+  for (i = 5001; i <= 6000; i++)
+    g_async_queue_push (queue, GINT_TO_POINTER (i));
+  for (i = 2501; i <= 6000; i++)
+    g_assert (GPOINTER_TO_INT (g_async_queue_try_pop (queue)) == i);
+  g_assert (g_async_queue_length (queue) == 0);
+
+  /* interleaved, across several wraps of the ring */
+  for (i = 0, j = 1; i < 10000; i++)
+    {
+      g_async_queue_push (queue, GINT_TO_POINTER (2 * i + 1));
+      g_async_queue_push (queue, GINT_TO_POINTER (2 * i + 2));
+      g_assert (GPOINTER_TO_INT (g_async_queue_pop (queue)) == j++);
+    }
+  g_assert (g_async_queue_length (queue) == 10000);
+  while (g_async_queue_length (queue))
+    g_assert (GPOINTER_TO_INT (g_async_queue_pop (queue)) == j++);
+  g_assert (j == 20001);
+
+  /* without threads, nothing could arrive while we waited */
+  g_get_current_time (&end_time);
+  end_time.tv_sec += 10;
+  g_assert (g_async_queue_timed_pop (queue, &end_time) == NULL);
+  g_assert (g_async_queue_pop (queue) == NULL);
+
+  g_async_queue_ref (queue);
+  g_async_queue_unref (queue);
+  g_async_queue_unref (queue);
+
+  return 0;
+}
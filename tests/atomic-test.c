@@ -0,0 +1,79 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include "glib.h"
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gint i = 0;
+  gpointer p = NULL;
+  gchar c;
+
+  /* through the macros, where glib.h has them */
+  g_atomic_int_set (&i, 5);
+  g_assert (g_atomic_int_get (&i) == 5);
+  g_assert (g_atomic_int_exchange_and_add (&i, 3) == 5);
+  g_atomic_int_add (&i, -2);
+  g_assert (i == 6);
+  g_atomic_int_inc (&i);
+  g_assert (!g_atomic_int_dec_and_test (&i));
+  g_assert (!g_atomic_int_compare_and_exchange (&i, 5, 0));
+  g_assert (g_atomic_int_compare_and_exchange (&i, 6, 1));
+  g_assert (g_atomic_int_dec_and_test (&i));
+  g_assert (i == 0);
+
+  g_assert (g_atomic_pointer_compare_and_exchange (&p, NULL, &c));
+  g_assert (!g_atomic_pointer_compare_and_exchange (&p, NULL, &i));
+  g_assert (g_atomic_pointer_get (&p) == &c);
+  g_atomic_pointer_set (&p, &i);
+  g_assert (p == &i);
+  g_atomic_memory_barrier ();
+
+  /* and through the functions */
+  (g_atomic_int_set) (&i, 5);
+  g_assert ((g_atomic_int_get) (&i) == 5);
+  g_assert ((g_atomic_int_exchange_and_add) (&i, 3) == 5);
+  (g_atomic_int_add) (&i, -2);
+  g_assert (i == 6);
+  g_assert (!(g_atomic_int_compare_and_exchange) (&i, 5, 0));
+  g_assert ((g_atomic_int_compare_and_exchange) (&i, 6, G_MININT));
+  g_assert ((g_atomic_int_exchange_and_add) (&i, 1) == G_MININT);
+  g_assert (i == G_MININT + 1);
+
+  p = NULL;
+  g_assert ((g_atomic_pointer_compare_and_exchange) (&p, NULL, &c));
+  g_assert (!(g_atomic_pointer_compare_and_exchange) (&p, NULL, &i));
+  g_assert ((g_atomic_pointer_get) (&p) == &c);
+  (g_atomic_pointer_set) (&p, &i);
+  g_assert (p == &i);
+  (g_atomic_memory_barrier) ();
+
+  return 0;
+}
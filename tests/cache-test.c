@@ -0,0 +1,141 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <string.h>
+#include "glib.h"
+
+static gint n_values = 0;
+
+static gpointer
+value_new (gpointer key)
+{
+  n_values += 1;
+
+  return g_strconcat ("value-", (gchar*) key, NULL);
+}
+
+static void
+value_destroy (gpointer value)
+{
+  n_values -= 1;
+  g_free (value);
+}
+
+static gpointer
+key_dup (gpointer key)
+{
+  return g_strdup (key);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GCache *cache;
+  GCacheStats stats;
+  gpointer a, b, c;
+  gchar key[16];
+  gint i;
+
+  cache = g_cache_new (value_new, value_destroy, key_dup, g_free,
+		       g_str_hash, g_direct_hash, g_str_equal);
+
+  /* without a bound, values go away with their last reference */
+  a = g_cache_insert (cache, "a");
+  g_assert (strcmp (a, "value-a") == 0);
+  g_assert (g_cache_insert (cache, "a") == a);
+  g_cache_remove (cache, a);
+  g_cache_remove (cache, a);
+  g_assert (n_values == 0);
+
+  g_cache_get_stats (cache, &stats);
+  g_assert (stats.hits == 1 && stats.misses == 1 && stats.evictions == 1);
+
+  /* with a bound, released values are kept and reused */
+  g_cache_set_max_unused (cache, 2);
+  a = g_cache_insert (cache, "a");
+  b = g_cache_insert (cache, "b");
+  c = g_cache_insert (cache, "c");
+  g_cache_remove (cache, a);
+  g_cache_remove (cache, b);
+  g_assert (n_values == 3);
+  g_assert (g_cache_insert (cache, "a") == a);
+  g_cache_remove (cache, a);
+
+  /* releasing c evicts b, the least recently released one */
+  g_cache_remove (cache, c);
+  g_assert (n_values == 2);
+  g_assert (g_cache_insert (cache, "c") == c);
+  g_assert (g_cache_insert (cache, "a") == a);
+  b = g_cache_insert (cache, "b");
+  g_assert (n_values == 3);
+  g_cache_remove (cache, a);
+  g_cache_remove (cache, b);
+  g_cache_remove (cache, c);
+
+  g_cache_get_stats (cache, &stats);
+  g_assert (stats.hits == 4 && stats.misses == 5 && stats.evictions == 3);
+
+  g_cache_trim (cache, 0);
+  g_assert (n_values == 0);
+
+  /* a hot key released in between stays a hit */
+  for (i = 0; i < 1000; i++)
+    {
+      g_snprintf (key, sizeof (key), "%d", i % 10);
+      g_cache_remove (cache, g_cache_insert (cache, key));
+    }
+  g_assert (n_values == 2);
+
+  /* destroying the cache frees the values it kept */
+  g_cache_destroy (cache);
+  g_assert (n_values == 0);
+
+  /* sharded caches behave the same, bounds are split over the shards */
+  cache = g_cache_new_concurrent (value_new, value_destroy, key_dup, g_free,
+				  g_str_hash, g_direct_hash, g_str_equal, 4);
+  g_cache_set_max_unused (cache, 8);
+  for (i = 0; i < 100; i++)
+    {
+      g_snprintf (key, sizeof (key), "%d", i);
+      a = g_cache_insert (cache, key);
+      g_assert (g_cache_insert (cache, key) == a);
+      g_cache_remove (cache, a);
+      g_cache_remove (cache, a);
+    }
+  g_assert (n_values <= 8);
+
+  g_cache_get_stats (cache, &stats);
+  g_assert (stats.hits == 100 && stats.misses == 100);
+  g_assert (stats.evictions == 100 - n_values);
+
+  g_cache_destroy (cache);
+  g_assert (n_values == 0);
+
+  return 0;
+}
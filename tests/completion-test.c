@@ -0,0 +1,183 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <string.h>
+#include "glib.h"
+
+static gchar *words[] = {
+  "foo", "foobar", "foobaz", "fox", "bar", "barn", "b", "quux", "foo"
+};
+#define N_WORDS (sizeof (words) / sizeof (words[0]))
+
+/* counts the words starting with PREFIX and their common prefix */
+static gint
+naive_complete (gchar **strings,
+		gint    n_strings,
+		gchar  *prefix,
+		gchar **common)
+{
+  gint i, n = 0, len = strlen (prefix);
+
+  *common = NULL;
+  for (i = 0; i < n_strings; i++)
+    if (strncmp (strings[i], prefix, len) == 0)
+      {
+	if (!*common)
+	  *common = g_strdup (strings[i]);
+	else
+	  {
+	    gint j;
+
+	    for (j = 0; (*common)[j] && (*common)[j] == strings[i][j]; j++)
+	      ;
+	    (*common)[j] = 0;
+	  }
+	n++;
+      }
+
+  return n;
+}
+
+static void
+check_complete (GCompletion *cmp,
+		gchar      **strings,
+		gint         n_strings,
+		gchar       *prefix)
+{
+  GList *result, *list;
+  gchar *new_prefix, *common;
+  gint n;
+
+  n = naive_complete (strings, n_strings, prefix, &common);
+  result = g_completion_complete (cmp, prefix, &new_prefix);
+
+  g_assert (g_list_length (result) == n);
+  for (list = result; list; list = list->next)
+    {
+      gchar *string = cmp->func ? cmp->func (list->data) : list->data;
+
+      g_assert (strncmp (string, prefix, strlen (prefix)) == 0);
+    }
+  g_assert ((new_prefix == NULL) == (common == NULL));
+  g_assert (!new_prefix || strcmp (new_prefix, common) == 0);
+
+  g_free (new_prefix);
+  g_free (common);
+}
+
+static gchar*
+item_string (gpointer item)
+{
+  return ((gchar**) item)[0];
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GCompletion *cmp;
+  GList *items = NULL;
+  GList *result;
+  gchar *new_prefix;
+  gchar *strings[2000];
+  gchar *prefix[] = { "f", "fo", "foo", "foob", "fooba", "foobar", "foobarx",
+		      "b", "ba", "bar", "q", "x", "fox", "foxy" };
+  gint i;
+
+  for (i = 0; i < N_WORDS; i++)
+    items = g_list_append (items, words[i]);
+
+  cmp = g_completion_new (NULL);
+  g_completion_add_items (cmp, items);
+
+  for (i = 0; i < sizeof (prefix) / sizeof (prefix[0]); i++)
+    check_complete (cmp, words, N_WORDS, prefix[i]);
+
+  result = g_completion_complete (cmp, "fooba", &new_prefix);
+  g_assert (g_list_length (result) == 2);
+  g_assert (strcmp (new_prefix, "fooba") == 0);
+  g_free (new_prefix);
+
+  /* the empty prefix lists everything */
+  result = g_completion_complete (cmp, "", &new_prefix);
+  g_assert (g_list_length (result) == N_WORDS);
+  g_assert (new_prefix == NULL);
+
+  /* removing "fox" and one "foo" leaves "foo" as the common prefix */
+  g_list_free (items);
+  items = g_list_append (NULL, words[3]);
+  items = g_list_append (items, words[0]);
+  g_completion_remove_items (cmp, items);
+  result = g_completion_complete (cmp, "fo", &new_prefix);
+  g_assert (g_list_length (result) == 3);
+  g_assert (strcmp (new_prefix, "foo") == 0);
+  g_free (new_prefix);
+
+  g_completion_remove_items (cmp, items);
+  result = g_completion_complete (cmp, "f", &new_prefix);
+  g_assert (g_list_length (result) == 2);
+  g_assert (strcmp (new_prefix, "fooba") == 0);
+  g_free (new_prefix);
+  g_list_free (items);
+
+  g_completion_clear_items (cmp);
+  g_assert (g_completion_complete (cmp, "f", &new_prefix) == NULL);
+  g_assert (new_prefix == NULL);
+  g_completion_free (cmp);
+
+  /* generated words, looked up through a GCompletionFunc */
+  items = NULL;
+  for (i = 0; i < 2000; i++)
+    {
+      gchar **item = g_new (gchar*, 1);
+
+      item[0] = g_strdup_printf ("%x", (i * 7919) % 4096);
+      strings[i] = item[0];
+      items = g_list_prepend (items, item);
+    }
+
+  cmp = g_completion_new (item_string);
+  g_completion_add_items (cmp, items);
+  for (i = 0; i < 4096; i += 37)
+    {
+      gchar *p = g_strdup_printf ("%x", i);
+
+      check_complete (cmp, strings, 2000, p);
+      p[1] = 0;
+      check_complete (cmp, strings, 2000, p);
+      g_free (p);
+    }
+  g_completion_free (cmp);
+
+  for (i = 0; i < 2000; i++)
+    g_free (strings[i]);
+  g_list_foreach (items, (GFunc) g_free, NULL);
+  g_list_free (items);
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ * Copyright (C) 1999 The Free Software Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include "glib.h"
+
+static void
+quark_test (void)
+{
+  static const gchar *static_name = "static-quark";
+  GQuark quarks[3000];
+  gchar buffer[32];
+  GQuark quark;
+  guint i;
+
+  g_assert (g_quark_try_string ("no-such-quark") == 0);
+  g_assert (g_quark_to_string (0) == NULL);
+
+  /* enough quarks to grow the table and the block directory */
+  for (i = 0; i < 3000; i++)
+    {
+      g_snprintf (buffer, sizeof (buffer), "quark-%u", i);
+      quarks[i] = g_quark_from_string (buffer);
+      g_assert (quarks[i] != 0);
+      g_assert (strcmp (g_quark_to_string (quarks[i]), buffer) == 0);
+    }
+  for (i = 0; i < 3000; i++)
+    {
+      g_snprintf (buffer, sizeof (buffer), "quark-%u", i);
+      g_assert (g_quark_try_string (buffer) == quarks[i]);
+      g_assert (g_quark_from_string (buffer) == quarks[i]);
+      g_assert (g_quark_from_static_string (buffer) == quarks[i]);
+    }
+
+  quark = g_quark_from_static_string (static_name);
+  g_assert (g_quark_to_string (quark) == static_name);
+  g_assert (g_quark_from_string ("static-quark") == quark);
+  g_assert (g_quark_to_string (quark + 1) == NULL);
+}
+
+static guint destroyed = 0;
+
+static void
+count_destroy (gpointer data)
+{
+  destroyed++;
+}
+
+static void
+count_foreach (GQuark   key_id,
+	       gpointer data,
+	       gpointer user_data)
+{
+  guint *count = user_data;
+
+  g_assert (GPOINTER_TO_UINT (data) == key_id);
+  (*count)++;
+}
+
+static void
+remove_foreach (GQuark   key_id,
+		gpointer data,
+		gpointer user_data)
+{
+  GData **datalist = user_data;
+
+  /* drop the next key, so foreach must skip it */
+  g_datalist_id_remove_data (datalist, key_id + 1);
+}
+
+static void
+datalist_test (void)
+{
+  GData *datalist;
+  GQuark keys[100];
+  gchar buffer[32];
+  guint count;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    {
+      g_snprintf (buffer, sizeof (buffer), "data-%u", i);
+      keys[i] = g_quark_from_string (buffer);
+    }
+
+  g_datalist_init (&datalist);
+  g_assert (g_datalist_id_get_data (&datalist, keys[0]) == NULL);
+
+  /* insert in reverse so the sorted array has to shift */
+  for (i = 100; i-- > 0;)
+    g_datalist_id_set_data_full (&datalist, keys[i], GUINT_TO_POINTER (keys[i]),
+				 count_destroy);
+  for (i = 0; i < 100; i++)
+    g_assert (g_datalist_id_get_data (&datalist, keys[i]) == GUINT_TO_POINTER (keys[i]));
+
+  count = 0;
+  g_datalist_foreach (&datalist, count_foreach, &count);
+  g_assert (count == 100);
+
+  /* replacing and removing notify, stealing doesn't */
+  g_datalist_id_set_data_full (&datalist, keys[0], GUINT_TO_POINTER (keys[0]), NULL);
+  g_assert (destroyed == 1);
+  g_datalist_id_remove_data (&datalist, keys[0]);
+  g_assert (destroyed == 1);
+  g_datalist_id_remove_data (&datalist, keys[1]);
+  g_assert (destroyed == 2);
+  g_datalist_id_remove_no_notify (&datalist, keys[2]);
+  g_assert (destroyed == 2);
+  g_assert (g_datalist_id_get_data (&datalist, keys[1]) == NULL);
+  g_assert (g_datalist_id_get_data (&datalist, keys[3]) == GUINT_TO_POINTER (keys[3]));
+
+  g_datalist_clear (&datalist);
+  g_assert (destroyed == 99);
+  g_assert (datalist == NULL);
+
+  for (i = 0; i < 10; i++)
+    g_datalist_id_set_data (&datalist, keys[i], GUINT_TO_POINTER (keys[i]));
+  g_datalist_foreach (&datalist, remove_foreach, &datalist);
+  count = 0;
+  g_datalist_foreach (&datalist, count_foreach, &count);
+  g_assert (count == 5);
+  g_datalist_clear (&datalist);
+
+  /* datasets go away with their last item */
+  destroyed = 0;
+  g_dataset_id_set_data_full (keys, keys[5], GUINT_TO_POINTER (keys[5]), count_destroy);
+  g_dataset_id_set_data_full (keys, keys[6], GUINT_TO_POINTER (keys[6]), count_destroy);
+  g_assert (g_dataset_id_get_data (keys, keys[5]) == GUINT_TO_POINTER (keys[5]));
+  count = 0;
+  g_dataset_foreach (keys, count_foreach, &count);
+  g_assert (count == 2);
+  g_dataset_id_remove_data (keys, keys[5]);
+  g_assert (destroyed == 1);
+  g_dataset_destroy (keys);
+  g_assert (destroyed == 2);
+  g_assert (g_dataset_id_get_data (keys, keys[6]) == NULL);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  quark_test ();
+  datalist_test ();
+
+  return 0;
+}
@@ -37,6 +37,10 @@
 #include <stdlib.h>
 #endif
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <glib.h>
 
 
@@ -328,6 +332,451 @@ static void direct_hash_test (void)
 }
 
 
+static GHashTable *lookup_foreach_table;
+
+/* lookups must not move entries of the table being iterated, even
+ * while it is resizing incrementally
+ */
+static void lookup_foreach (gpointer key,
+			    gpointer value,
+			    gpointer user_data)
+{
+     g_assert (g_hash_table_lookup (lookup_foreach_table, key) == value);
+     g_assert (g_hash_table_lookup_extended (lookup_foreach_table, key, NULL, NULL));
+     (*(gint*) user_data)++;
+}
+
+static void flags_test (GHashFunc       hash_func,
+			GHashTableFlags flags)
+{
+     gint       i;
+     gpointer   orig_key, orig_val;
+     GHashTable     *h;
+
+     h = g_hash_table_new_full (hash_func, my_hash_compare, flags);
+     g_assert (h != NULL);
+
+     lookup_foreach_table = h;
+     for (i = 0; i < 10000; i++)
+          {
+	  array[i] = i;
+	  g_hash_table_insert (h, &array[i], &array[i]);
+	  if (hash_func == my_hash && i < 2000)
+	       {
+		 gint n = 0;
+
+		 g_hash_table_foreach (h, lookup_foreach, &n);
+		 g_assert (n == i + 1);
+	       }
+          }
+     g_assert (g_hash_table_size (h) == 10000);
+
+     g_hash_table_foreach (h, my_hash_callback, NULL);
+     for (i = 0; i < 10000; i++)
+	  g_assert (array[i] == 1);
+
+     /* removal leaves tombstones behind in open addressed tables,
+      * lookups must probe past them
+      */
+     for (i = 0; i < 10000; i++)
+	  array[i] = i;
+     for (i = 0; i < 10000; i += 2)
+	  g_hash_table_remove (h, &array[i]);
+     g_assert (g_hash_table_size (h) == 5000);
+     for (i = 0; i < 10000; i++)
+          {
+	  gboolean found = g_hash_table_lookup_extended (h, &array[i],
+							 &orig_key, &orig_val);
+	  g_assert (found == (i % 2));
+	  if (found)
+	    g_assert (orig_key == &array[i] && orig_val == &array[i]);
+          }
+
+     /* open addressed tables have to grow while frozen, too */
+     g_hash_table_freeze (h);
+     for (i = 0; i < 10000; i += 2)
+	  g_hash_table_insert (h, &array[i], &array[i]);
+     g_hash_table_thaw (h);
+     g_assert (g_hash_table_size (h) == 10000);
+     for (i = 0; i < 10000; i++)
+	  g_assert (g_hash_table_lookup (h, &array[i]) == &array[i]);
+
+     g_assert (g_hash_table_foreach_remove (h, my_hash_callback_remove, NULL) == 5000);
+     g_assert (g_hash_table_size (h) == 5000);
+     g_hash_table_foreach (h, my_hash_callback_remove_test, NULL);
+
+     for (i = 0; i < 10000; i++)
+	  g_hash_table_remove (h, &array[i]);
+     g_assert (g_hash_table_size (h) == 0);
+     g_assert (g_hash_table_lookup (h, &array[0]) == NULL);
+
+     g_hash_table_destroy (h);
+}
+
+static void bulk_test (GHashTableFlags flags)
+{
+     gint       i;
+     gpointer   keys[10000], values[10000];
+     GHashTable     *h;
+
+     h = g_hash_table_new_full (my_hash, my_hash_compare, flags);
+
+     for (i = 0; i < 10000; i++)
+          {
+	  array[i] = i;
+	  keys[i] = &array[i];
+	  values[i] = GINT_TO_POINTER (i + 1);
+          }
+     /* insert the first half twice, the second insertion only
+      * replaces values.
+      */
+     g_hash_table_insert_many (h, keys, values, 5000);
+     g_hash_table_insert_many (h, keys, values, 10000);
+     g_assert (g_hash_table_size (h) == 10000);
+
+     for (i = 0; i < 10000; i += 2)
+	  g_hash_table_remove (h, &array[i]);
+
+     for (i = 0; i < 10000; i++)
+	  values[i] = NULL;
+     g_hash_table_lookup_many (h, (gconstpointer*) keys, values, 10000);
+     for (i = 0; i < 10000; i++)
+	  if (i % 2)
+	    g_assert (GPOINTER_TO_INT (values[i]) == i + 1);
+	  else
+	    g_assert (values[i] == NULL);
+
+     g_hash_table_destroy (h);
+}
+
+static gboolean odd_remove (gpointer key,
+			    gpointer value,
+			    gpointer user_data)
+{
+     return *(gint*) key % 2 == 1;
+}
+
+static void count_odd_foreach (gpointer key,
+			       gpointer value,
+			       gpointer user_data)
+{
+     g_assert (*(gint*) key % 2 == 1);
+     (*(gint*) user_data)++;
+}
+
+static void concurrent_test (guint n_shards)
+{
+     gint       i;
+     gpointer   orig_key, value;
+     GConcurrentHashTable *h;
+
+     h = g_concurrent_hash_table_new (my_hash, my_hash_compare, n_shards);
+
+     for (i = 0; i < 10000; i++)
+          {
+	  array[i] = i;
+	  g_concurrent_hash_table_insert (h, &array[i], GINT_TO_POINTER (i + 1));
+          }
+     g_assert (g_concurrent_hash_table_size (h) == 10000);
+
+     for (i = 0; i < 10000; i++)
+          {
+	  g_assert (GPOINTER_TO_INT (g_concurrent_hash_table_lookup (h, &i)) == i + 1);
+	  g_assert (g_concurrent_hash_table_lookup_extended (h, &i, &orig_key, &value));
+	  g_assert (orig_key == &array[i]);
+	  g_assert (GPOINTER_TO_INT (value) == i + 1);
+          }
+
+     for (i = 0; i < 10000; i += 2)
+	  g_concurrent_hash_table_remove (h, &array[i]);
+     g_assert (g_concurrent_hash_table_size (h) == 5000);
+     g_assert (!g_concurrent_hash_table_lookup_extended (h, &array[0], NULL, NULL));
+
+     i = 0;
+     g_concurrent_hash_table_foreach (h, count_odd_foreach, &i);
+     g_assert (i == 5000);
+     g_assert (g_concurrent_hash_table_foreach_remove (h, odd_remove, NULL) == 5000);
+     g_assert (g_concurrent_hash_table_size (h) == 0);
+     g_assert (g_concurrent_hash_table_lookup (h, &array[1]) == NULL);
+
+     g_concurrent_hash_table_destroy (h);
+}
+
+static gboolean free_key_remove (gpointer key,
+				 gpointer value,
+				 gpointer user_data)
+{
+  g_free (key);
+
+  return TRUE;
+}
+
+static void str_hash_fast_test (void)
+{
+     gint       i;
+     guint      unkeyed;
+     char       key[40];
+     GHashTable     *h;
+
+     g_assert (g_str_hash_fast ("") == g_str_hash_fast (""));
+     g_assert (g_str_hash_fast ("a") != g_str_hash_fast ("b"));
+     g_assert (g_str_hash_fast ("abcdefgh") != g_str_hash_fast ("abcdefgi"));
+     g_assert (g_str_hash_fast ("abcdefghi") != g_str_hash_fast ("abcdefgh"));
+
+     h = g_hash_table_new_full (g_str_hash_fast, g_str_equal,
+				G_HASH_TABLE_POWER_OF_TWO);
+     for (i = 0; i < 1000; i++)
+          {
+	  sprintf (key, "%d%.*s", i, i % 23, "xxxxxxxxxxxxxxxxxxxxxxx");
+	  g_hash_table_insert (h, g_strdup (key), GINT_TO_POINTER (i + 1));
+          }
+     g_assert (g_hash_table_size (h) == 1000);
+     for (i = 0; i < 1000; i++)
+          {
+	  sprintf (key, "%d%.*s", i, i % 23, "xxxxxxxxxxxxxxxxxxxxxxx");
+	  g_assert (GPOINTER_TO_INT (g_hash_table_lookup (h, key)) == i + 1);
+          }
+     g_hash_table_foreach_remove (h, free_key_remove, NULL);
+     g_assert (g_hash_table_size (h) == 0);
+     g_hash_table_destroy (h);
+
+     /* keyed, the SipHash-1-3 (HalfSipHash-1-3) reference values for the
+      * key 00 01 .. 0f
+      */
+     for (i = 0; i < 16; i++)
+          key[i] = i;
+     unkeyed = g_str_hash_fast ("a");
+     g_str_hash_fast_set_key ((guint8*) key);
+#ifdef G_HAVE_GINT64
+     g_assert (g_str_hash_fast ("") == 0xaea3c584);
+     g_assert (g_str_hash_fast ("a") == 0x644cf59c);
+     g_assert (g_str_hash_fast ("abcdefgh") == 0x3c3126ac);
+     g_assert (g_str_hash_fast ("hello, world!") == 0xd6a8ef99);
+#else
+     g_assert (g_str_hash_fast ("") == 0x5814c896);
+     g_assert (g_str_hash_fast ("a") == 0xfb64f026);
+     g_assert (g_str_hash_fast ("abcdefgh") == 0x65917e9b);
+     g_assert (g_str_hash_fast ("hello, world!") == 0x4238ce22);
+#endif
+     g_str_hash_fast_set_key (NULL);
+     g_assert (g_str_hash_fast ("a") == unkeyed);
+}
+
+static gboolean free_key_value_remove (gpointer key,
+				       gpointer value,
+				       gpointer user_data)
+{
+  g_free (key);
+  g_free (value);
+
+  return TRUE;
+}
+
+static gconstpointer
+int_snapshot (gpointer item,
+	      guint   *length,
+	      gpointer user_data)
+{
+  static gint value;
+
+  value = GPOINTER_TO_INT (item);
+  *length = sizeof (value);
+
+  return &value;
+}
+
+static gint
+int_snapshot_equal (gconstpointer key,
+		    gconstpointer bytes)
+{
+  return *(const gint*) bytes == GPOINTER_TO_INT (key);
+}
+
+static void snapshot_test (void)
+{
+     GMappedHashTable *m, *old;
+     GHashTable *h;
+     gchar *file_name;
+     gconstpointer value;
+     char key[40];
+     FILE *file;
+     guint length;
+     gint i;
+
+     file_name = g_strdup_printf ("%s/hash-test-%d.snapshot",
+				  g_get_tmp_dir (), (gint) getpid ());
+
+     /* string keys and values */
+     h = g_hash_table_new (g_str_hash, g_str_equal);
+     for (i = 0; i < 1000; i++)
+          {
+	  sprintf (key, "key %d", i);
+	  g_hash_table_insert (h, g_strdup (key), g_strdup (key + 4));
+          }
+     g_assert (g_hash_table_save (h, file_name, NULL, NULL, NULL));
+     m = g_hash_table_map (file_name, g_str_hash, g_str_equal);
+     g_assert (m != NULL);
+     g_assert (g_mapped_hash_table_size (m) == 1000);
+     for (i = 0; i < 1000; i++)
+          {
+	  sprintf (key, "key %d", i);
+	  value = g_mapped_hash_table_lookup (m, key, &length);
+	  g_assert (value != NULL);
+	  g_assert (strcmp (value, key + 4) == 0);
+	  g_assert (length == strlen (key + 4) + 1);
+	  g_assert (((gulong) value) % 8 == 0);
+          }
+     g_assert (g_mapped_hash_table_lookup (m, "key 1000", &length) == NULL);
+     g_assert (length == 0);
+     old = m;
+     g_hash_table_foreach_remove (h, free_key_value_remove, NULL);
+     g_hash_table_destroy (h);
+
+     /* integer keys, with the file replaced while it is mapped */
+     h = g_hash_table_new (NULL, NULL);
+     for (i = 0; i < 5000; i++)
+       g_hash_table_insert (h, GINT_TO_POINTER (i), GINT_TO_POINTER (i * 3));
+     g_assert (g_hash_table_save (h, file_name, int_snapshot, int_snapshot, NULL));
+     m = g_hash_table_map (file_name, g_direct_hash, int_snapshot_equal);
+     g_assert (m != NULL);
+     g_assert (g_mapped_hash_table_size (m) == 5000);
+     for (i = 0; i < 5000; i++)
+          {
+	  value = g_mapped_hash_table_lookup (m, GINT_TO_POINTER (i), &length);
+	  g_assert (value != NULL && length == sizeof (gint));
+	  g_assert (*(const gint*) value == i * 3);
+          }
+     g_assert (g_mapped_hash_table_lookup (m, GINT_TO_POINTER (5000), NULL) == NULL);
+     g_mapped_hash_table_unmap (m);
+     g_hash_table_destroy (h);
+
+     g_assert (strcmp (g_mapped_hash_table_lookup (old, "key 7", NULL), "7") == 0);
+     g_mapped_hash_table_unmap (old);
+
+     /* not an image, or none at all */
+     file = fopen (file_name, "w");
+     g_assert (file != NULL);
+     fprintf (file, "GHashV1 but not an image\n");
+     fclose (file);
+     g_assert (g_hash_table_map (file_name, g_str_hash, g_str_equal) == NULL);
+     remove (file_name);
+     g_assert (g_hash_table_map (file_name, g_str_hash, g_str_equal) == NULL);
+     g_free (file_name);
+}
+
+/* the image layout that g_hash_table_save() writes */
+typedef struct
+{
+  gchar	  magic[8];
+  guint32 byte_order;
+  guint32 sizeof_long;
+  gulong  length;
+  gulong  n_entries;
+  gulong  n_buckets;
+  gulong  buckets;
+  gulong  entries;
+} SnapshotHeader;
+
+typedef struct
+{
+  guint	  hash;
+  guint	  key_length;
+  guint	  value_length;
+  guint	  reserved;
+  gulong  key;
+  gulong  value;
+} SnapshotEntry;
+
+/* writes length bytes of image to file_name and maps them */
+static gboolean
+snapshot_maps (const gchar *file_name,
+	       const gchar *image,
+	       gulong	    length)
+{
+  GMappedHashTable *m;
+  FILE *file;
+
+  file = fopen (file_name, "wb");
+  g_assert (file != NULL);
+  g_assert (fwrite (image, 1, length, file) == length);
+  fclose (file);
+
+  m = g_hash_table_map (file_name, g_str_hash, g_str_equal);
+  if (!m)
+    return FALSE;
+  g_mapped_hash_table_unmap (m);
+
+  return TRUE;
+}
+
+static void
+corrupt_snapshot_test (void)
+{
+  GMappedFile *mapped;
+  GHashTable *h;
+  SnapshotHeader *header;
+  SnapshotEntry *entry;
+  gulong *buckets;
+  gchar *file_name, *image, *copy;
+  gulong length;
+  gint i;
+
+  file_name = g_strdup_printf ("%s/hash-test-%d.snapshot",
+			       g_get_tmp_dir (), (gint) getpid ());
+
+  h = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < 10; i++)
+    g_hash_table_insert (h, g_strdup_printf ("key %d", i), g_strdup_printf ("%d", i));
+  g_assert (g_hash_table_save (h, file_name, NULL, NULL, NULL));
+  g_hash_table_foreach_remove (h, free_key_value_remove, NULL);
+  g_hash_table_destroy (h);
+
+  mapped = g_mapped_file_new (file_name);
+  g_assert (mapped != NULL);
+  length = g_mapped_file_get_length (mapped);
+  image = g_memdup (g_mapped_file_get_contents (mapped), length);
+  g_mapped_file_free (mapped);
+
+  copy = g_malloc (length);
+  header = (SnapshotHeader*) copy;
+  g_assert (snapshot_maps (file_name, image, length));
+  memcpy (copy, image, length);
+  g_assert (header->n_entries == 10 && header->n_buckets > 2);
+  buckets = (gulong*) (copy + header->buckets);
+  entry = (SnapshotEntry*) (copy + header->entries);
+
+  /* cut short, with a header that agrees */
+  header->length = length - sizeof (SnapshotEntry);
+  g_assert (!snapshot_maps (file_name, copy, header->length));
+
+  /* buckets past the entries, or going backwards */
+  memcpy (copy, image, length);
+  buckets[1] = header->n_entries + 1;
+  g_assert (!snapshot_maps (file_name, copy, length));
+  memcpy (copy, image, length);
+  buckets[1] = header->n_entries;
+  buckets[2] = 0;
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  /* keys and values outside of the file */
+  memcpy (copy, image, length);
+  entry->key = length;
+  g_assert (!snapshot_maps (file_name, copy, length));
+  memcpy (copy, image, length);
+  entry->value_length = length;
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  /* a key that runs into the next one */
+  memcpy (copy, image, length);
+  copy[entry->key + entry->key_length] = 'x';
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  remove (file_name);
+  g_free (copy);
+  g_free (image);
+  g_free (file_name);
+}
+
 
 int
 main (int   argc,
@@ -369,6 +818,22 @@ main (int   argc,
   second_hash_test (TRUE);
   second_hash_test (FALSE);
   direct_hash_test ();
+  flags_test (my_hash, G_HASH_TABLE_OPEN_ADDRESSING);
+  flags_test (one_hash, G_HASH_TABLE_OPEN_ADDRESSING);
+  flags_test (my_hash, G_HASH_TABLE_INCREMENTAL_RESIZE);
+  flags_test (one_hash, G_HASH_TABLE_INCREMENTAL_RESIZE);
+  flags_test (my_hash, G_HASH_TABLE_POWER_OF_TWO);
+  flags_test (my_hash, G_HASH_TABLE_POWER_OF_TWO | G_HASH_TABLE_OPEN_ADDRESSING);
+  flags_test (my_hash, G_HASH_TABLE_POWER_OF_TWO | G_HASH_TABLE_INCREMENTAL_RESIZE);
+  str_hash_fast_test ();
+  bulk_test (0);
+  bulk_test (G_HASH_TABLE_OPEN_ADDRESSING);
+  bulk_test (G_HASH_TABLE_INCREMENTAL_RESIZE | G_HASH_TABLE_POWER_OF_TWO);
+  concurrent_test (0);
+  concurrent_test (1);
+  concurrent_test (5);
+  snapshot_test ();
+  corrupt_snapshot_test ();
 
   return 0;
 
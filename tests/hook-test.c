@@ -0,0 +1,191 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <string.h>
+#include "glib.h"
+
+
+static GHookList hook_list;
+static GString *trace;
+static GHook *hook_b;
+static guint n_recursions = 0;
+
+static void
+hook_func (gpointer data)
+{
+  gchar c = GPOINTER_TO_INT (data);
+
+  g_string_append_c (trace, c);
+
+  switch (c)
+    {
+      GHook *hook;
+
+    case 'b':
+      /* added while emitting, so it gets called right away too */
+      hook = g_hook_alloc (&hook_list);
+      hook->func = hook_func;
+      hook->data = GINT_TO_POINTER ('x');
+      g_hook_append (&hook_list, hook);
+      break;
+    case 'c':
+      /* destroyed while emitting, before it got called */
+      g_hook_destroy (&hook_list, hook_b->hook_id + 2);
+      break;
+    case 'r':
+      if (n_recursions++ < 2)
+	g_hook_list_invoke (&hook_list, TRUE);
+      break;
+    case 'x':
+      g_hook_destroy (&hook_list, hook_b->hook_id + 3);
+      break;
+    case 'k':
+      /* a destruction detaches the array before the addition */
+      g_hook_destroy (&hook_list, hook_b->hook_id + 1);
+      hook = g_hook_alloc (&hook_list);
+      hook->func = hook_func;
+      hook->data = GINT_TO_POINTER ('y');
+      g_hook_append (&hook_list, hook);
+      break;
+    }
+}
+
+static gboolean
+hook_check_func (gpointer data)
+{
+  g_string_append_c (trace, GPOINTER_TO_INT (data));
+
+  return GPOINTER_TO_INT (data) != 'b';
+}
+
+static void
+hook_marshaller (GHook	 *hook,
+		 gpointer data)
+{
+  g_string_append_c (trace, GPOINTER_TO_INT (hook->data));
+  g_string_append_c (trace, GPOINTER_TO_INT (data));
+}
+
+static GHook*
+hook_add (gpointer func,
+	  gchar	   c)
+{
+  GHook *hook;
+
+  hook = g_hook_alloc (&hook_list);
+  hook->func = func;
+  hook->data = GINT_TO_POINTER (c);
+  g_hook_append (&hook_list, hook);
+
+  return hook;
+}
+
+static void
+check_trace (const gchar *expected)
+{
+  if (strcmp (trace->str, expected) != 0)
+    g_error ("hook emission gave \"%s\" instead of \"%s\"", trace->str, expected);
+  g_string_truncate (trace, 0);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GHook *hook;
+
+  trace = g_string_new (NULL);
+
+  g_hook_list_init (&hook_list, sizeof (GHook));
+  hook_add (hook_func, 'a');
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("a");
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("a");
+
+  /* hooks that are blocked or unblocked between emissions */
+  hook = hook_add (hook_func, 'z');
+  hook->flags &= ~G_HOOK_FLAG_ACTIVE;
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("a");
+  hook->flags |= G_HOOK_FLAG_ACTIVE;
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("az");
+  g_hook_destroy_link (&hook_list, hook);
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("a");
+  g_hook_list_clear (&hook_list);
+
+  /* adding and destroying hooks from inside the emission */
+  g_hook_list_init (&hook_list, sizeof (GHook));
+  hook_b = hook_add (hook_func, 'b');
+  hook_add (hook_func, 'c');
+  hook_add (hook_func, 'd');
+  hook_add (hook_func, 'e');
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("bcex");
+  /* the first 'x' destroyed 'e', 'b' adds another 'x' each time */
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("bcxx");
+  g_hook_list_clear (&hook_list);
+
+  /* destroying and then adding hooks from inside the emission */
+  g_hook_list_init (&hook_list, sizeof (GHook));
+  hook_b = hook_add (hook_func, 'k');
+  hook_add (hook_func, 'l');
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("ky");
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("kyy");
+  g_hook_list_clear (&hook_list);
+
+  /* recursion */
+  g_hook_list_init (&hook_list, sizeof (GHook));
+  hook_add (hook_func, 'r');
+  hook_add (hook_func, 's');
+  g_hook_list_invoke (&hook_list, FALSE);
+  check_trace ("rrrsss");
+  g_hook_list_clear (&hook_list);
+
+  /* check functions destroy their hook when returning FALSE */
+  g_hook_list_init (&hook_list, sizeof (GHook));
+  hook_add (hook_check_func, 'a');
+  hook_add (hook_check_func, 'b');
+  hook_add (hook_check_func, 'c');
+  g_hook_list_invoke_check (&hook_list, FALSE);
+  check_trace ("abc");
+  g_hook_list_invoke_check (&hook_list, FALSE);
+  check_trace ("ac");
+  g_hook_list_marshal (&hook_list, FALSE, hook_marshaller, GINT_TO_POINTER ('-'));
+  check_trace ("a-c-");
+  g_hook_list_clear (&hook_list);
+
+  g_string_free (trace, TRUE);
+
+  return 0;
+}
@@ -0,0 +1,393 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "glib.h"
+
+static GIOChannel*
+buffered_pipe (const gchar *input,
+	       guint        read_size)
+{
+  GIOChannel *channel, *buffered;
+  gint fds[2];
+
+  g_assert (pipe (fds) == 0);
+  g_assert (write (fds[1], input, strlen (input)) == (gint) strlen (input));
+  close (fds[1]);
+
+  channel = g_io_channel_unix_new (fds[0]);
+  buffered = g_io_channel_buffered_new (channel, read_size, 0);
+  g_io_channel_unref (channel);
+
+  return buffered;
+}
+
+static void
+read_line_test (void)
+{
+  static const gchar *lines[] = { "hello, world\n", "\n", "abc\n", "tail" };
+  GIOChannel *channel;
+  gchar *line;
+  guint length;
+  guint i;
+
+  /* a small buffer makes the lines wrap around and grow it */
+  channel = buffered_pipe ("hello, world\n\nabc\ntail", 4);
+  for (i = 0; i < sizeof (lines) / sizeof (lines[0]); i++)
+    {
+      g_assert (g_io_channel_read_line (channel, &line, &length) == G_IO_ERROR_NONE);
+      g_assert (line != NULL);
+      g_assert (strcmp (line, lines[i]) == 0);
+      g_assert (length == strlen (lines[i]));
+      g_free (line);
+    }
+  g_assert (g_io_channel_read_line (channel, &line, &length) == G_IO_ERROR_NONE);
+  g_assert (line == NULL && length == 0);
+
+  g_io_channel_close (channel);
+  g_io_channel_unref (channel);
+}
+
+static void
+peek_test (void)
+{
+  GIOChannel *channel;
+  gchar *data;
+  gchar buf[8];
+  guint available, n_read;
+
+  channel = buffered_pipe ("0123456789", 8);
+
+  g_assert (g_io_channel_peek (channel, 3, &data, &available) == G_IO_ERROR_NONE);
+  g_assert (available >= 3);
+  g_assert (strncmp (data, "012", 3) == 0);
+  g_io_channel_skip (channel, 2);
+
+  g_assert (g_io_channel_read (channel, buf, 2, &n_read) == G_IO_ERROR_NONE);
+  g_assert (n_read == 2 && strncmp (buf, "23", 2) == 0);
+
+  /* peeking more than the buffer holds grows it */
+  g_assert (g_io_channel_peek (channel, 6, &data, &available) == G_IO_ERROR_NONE);
+  g_assert (available == 6 && strncmp (data, "456789", 6) == 0);
+  g_assert (g_io_channel_peek (channel, 7, &data, &available) == G_IO_ERROR_NONE);
+  g_assert (available == 6);
+  g_io_channel_skip (channel, 6);
+
+  g_assert (g_io_channel_read (channel, buf, sizeof (buf), &n_read) == G_IO_ERROR_NONE);
+  g_assert (n_read == 0);
+
+  g_io_channel_close (channel);
+  g_io_channel_unref (channel);
+}
+
+static void
+write_test (void)
+{
+  GIOChannel *channel, *buffered;
+  gchar buf[16];
+  guint n_written;
+  gint fds[2];
+
+  g_assert (pipe (fds) == 0);
+  fcntl (fds[0], F_SETFL, O_NONBLOCK);
+
+  channel = g_io_channel_unix_new (fds[1]);
+  buffered = g_io_channel_buffered_new (channel, 0, 8);
+  g_io_channel_unref (channel);
+
+  /* small writes are kept until the buffer is flushed */
+  g_assert (g_io_channel_write (buffered, "ab", 2, &n_written) == G_IO_ERROR_NONE);
+  g_assert (n_written == 2);
+  g_assert (g_io_channel_write (buffered, "cd", 2, &n_written) == G_IO_ERROR_NONE);
+  g_assert (read (fds[0], buf, sizeof (buf)) < 0);
+  g_assert (g_io_channel_flush (buffered) == G_IO_ERROR_NONE);
+  g_assert (read (fds[0], buf, sizeof (buf)) == 4);
+  g_assert (strncmp (buf, "abcd", 4) == 0);
+
+  /* a write that doesn't fit writes the buffer out first */
+  g_assert (g_io_channel_write (buffered, "0123", 4, &n_written) == G_IO_ERROR_NONE);
+  g_assert (g_io_channel_write (buffered, "456789", 6, &n_written) == G_IO_ERROR_NONE);
+  g_assert (n_written == 6);
+  g_assert (read (fds[0], buf, sizeof (buf)) == 4);
+  g_assert (strncmp (buf, "0123", 4) == 0);
+
+  /* closing flushes */
+  g_io_channel_close (buffered);
+  g_io_channel_unref (buffered);
+  g_assert (read (fds[0], buf, sizeof (buf)) == 6);
+  g_assert (strncmp (buf, "456789", 6) == 0);
+  close (fds[0]);
+}
+
+static void
+vector_test (void)
+{
+  GIOChannel *reader, *writer, *buffered;
+  GIOVector vectors[3];
+  gchar head[4], body[8];
+  guint n;
+  gint fds[2];
+
+  g_assert (pipe (fds) == 0);
+  reader = g_io_channel_unix_new (fds[0]);
+  writer = g_io_channel_unix_new (fds[1]);
+
+  vectors[0].buf = "head";
+  vectors[0].len = 4;
+  vectors[1].buf = "body";
+  vectors[1].len = 4;
+  vectors[2].buf = "tail";
+  vectors[2].len = 4;
+  g_assert (g_io_channel_writev (writer, vectors, 3, &n) == G_IO_ERROR_NONE);
+  g_assert (n == 12);
+
+  vectors[0].buf = head;
+  vectors[0].len = sizeof (head);
+  vectors[1].buf = body;
+  vectors[1].len = sizeof (body);
+  g_assert (g_io_channel_readv (reader, vectors, 2, &n) == G_IO_ERROR_NONE);
+  g_assert (n == 12);
+  g_assert (strncmp (head, "head", 4) == 0);
+  g_assert (strncmp (body, "bodytail", 8) == 0);
+
+  /* buffered channels gather vectors that fit into the buffer, and
+   * read vectors from it one at a time
+   */
+  buffered = g_io_channel_buffered_new (writer, 0, 16);
+  vectors[0].buf = "0123";
+  vectors[0].len = 4;
+  vectors[1].buf = "4567";
+  vectors[1].len = 4;
+  g_assert (g_io_channel_writev (buffered, vectors, 2, &n) == G_IO_ERROR_NONE);
+  g_assert (n == 8);
+  g_assert (g_io_channel_flush (buffered) == G_IO_ERROR_NONE);
+  g_io_channel_unref (buffered);
+
+  buffered = g_io_channel_buffered_new (reader, 0, 0);
+  vectors[0].buf = head;
+  vectors[0].len = sizeof (head);
+  vectors[1].buf = body;
+  vectors[1].len = 2;
+  g_assert (g_io_channel_readv (buffered, vectors, 2, &n) == G_IO_ERROR_NONE);
+  g_assert (n == 6);
+  g_assert (strncmp (head, "0123", 4) == 0);
+  g_assert (strncmp (body, "45", 2) == 0);
+  g_io_channel_unref (buffered);
+
+  g_io_channel_close (reader);
+  g_io_channel_close (writer);
+  g_io_channel_unref (reader);
+  g_io_channel_unref (writer);
+}
+
+static gint n_watch_lines = 0;
+
+static gboolean
+line_watch (GIOChannel   *channel,
+	    GIOCondition  condition,
+	    gpointer      data)
+{
+  gchar *line;
+
+  g_assert (condition != 0);
+  if (g_io_channel_read_line (channel, &line, NULL) != G_IO_ERROR_NONE || !line)
+    return FALSE;
+
+  n_watch_lines++;
+  g_free (line);
+
+  return TRUE;
+}
+
+static void
+watch_test (void)
+{
+  GIOChannel *channel;
+  gchar *line;
+
+  channel = buffered_pipe ("1\n2\n3\n", 0);
+
+  /* all of the input is buffered by the first line */
+  g_assert (g_io_channel_read_line (channel, &line, NULL) == G_IO_ERROR_NONE);
+  g_free (line);
+
+  g_io_add_watch (channel, G_IO_IN | G_IO_HUP, line_watch, NULL);
+  while (g_main_pending ())
+    g_main_iteration (FALSE);
+  g_assert (n_watch_lines == 2);
+
+  g_io_channel_close (channel);
+  g_io_channel_unref (channel);
+}
+
+/* a channel reading from a string whose watches are never ready,
+ * like the ones of Win32 channels that are checked on every iteration
+ */
+typedef struct
+{
+  GIOChannel channel;
+  const gchar *data;
+} StringChannel;
+
+static GIOError
+string_read (GIOChannel *channel,
+	     gchar      *buf,
+	     guint       count,
+	     guint      *bytes_read)
+{
+  StringChannel *string = (StringChannel *)channel;
+
+  *bytes_read = MIN (count, strlen (string->data));
+  memcpy (buf, string->data, *bytes_read);
+  string->data += *bytes_read;
+
+  return G_IO_ERROR_NONE;
+}
+
+static void
+string_close (GIOChannel *channel)
+{
+}
+
+static gboolean
+string_watch_prepare (gpointer  source_data,
+		      GTimeVal *current_time,
+		      gint     *timeout,
+		      gpointer  user_data)
+{
+  return FALSE;
+}
+
+static gboolean
+string_watch_check (gpointer  source_data,
+		    GTimeVal *current_time,
+		    gpointer  user_data)
+{
+  return FALSE;
+}
+
+static gboolean
+string_watch_dispatch (gpointer  source_data,
+		       GTimeVal *dispatch_time,
+		       gpointer  user_data)
+{
+  g_assert_not_reached ();
+  return FALSE;
+}
+
+static void
+string_watch_destroy (gpointer source_data)
+{
+}
+
+static GSourceFuncs string_watch_funcs = {
+  string_watch_prepare,
+  string_watch_check,
+  string_watch_dispatch,
+  string_watch_destroy
+};
+
+static guint
+string_add_watch (GIOChannel    *channel,
+		  gint           priority,
+		  GIOCondition   condition,
+		  GIOFunc        func,
+		  gpointer       user_data,
+		  GDestroyNotify notify)
+{
+  return g_source_add (priority, TRUE, &string_watch_funcs, NULL,
+		       user_data, notify);
+}
+
+static void
+string_free (GIOChannel *channel)
+{
+  g_free (channel);
+}
+
+static GIOFuncs string_channel_funcs = {
+  string_read,
+  NULL,
+  NULL,
+  string_close,
+  string_add_watch,
+  string_free
+};
+
+static void
+active_watch_test (void)
+{
+  StringChannel *string;
+  GIOChannel *channel;
+  gchar *line;
+  guint tag;
+
+  string = g_new (StringChannel, 1);
+  g_io_channel_init (&string->channel);
+  string->channel.funcs = &string_channel_funcs;
+  string->data = "1\n2\n3\n";
+  channel = g_io_channel_buffered_new (&string->channel, 0, 0);
+  g_io_channel_unref (&string->channel);
+
+  g_assert (g_io_channel_read_line (channel, &line, NULL) == G_IO_ERROR_NONE);
+  g_free (line);
+
+  /* the buffered lines are dispatched although the source of the
+   * string channel can't be flagged ready
+   */
+  n_watch_lines = 0;
+  tag = g_io_add_watch (channel, G_IO_IN, line_watch, NULL);
+  while (g_main_pending ())
+    g_main_iteration (FALSE);
+  g_assert (n_watch_lines == 2);
+
+  g_source_remove (tag);
+  g_io_channel_unref (channel);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  read_line_test ();
+  peek_test ();
+  write_test ();
+  vector_test ();
+  watch_test ();
+  active_watch_test ();
+
+  return 0;
+}
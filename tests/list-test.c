@@ -71,6 +71,77 @@ my_list_compare_two (gconstpointer a, gconstpointer b)
   return two-one;
 }
 
+/* compares only the tens, so that sorting by it shows stability */
+static gint
+my_list_compare_tens (gconstpointer a, gconstpointer b)
+{
+  gint one = *((const gint*)a) / 10;
+  gint two = *((const gint*)b) / 10;
+  return one-two;
+}
+
+static void
+sort_test (void)
+{
+  GList *list = NULL, *t;
+  gint i, n;
+
+  for (i = 0; i < 10000; i++)
+    {
+      array[i] = (i * 7919) % 10000;
+      list = g_list_prepend (list, &array[i]);
+    }
+  list = g_list_reverse (list);
+  list = g_list_sort (list, my_list_compare_tens);
+
+  g_assert (list->prev == NULL);
+  for (t = list, n = 1; t->next; t = t->next, n++)
+    {
+      gint one = *(gint*) t->data, two = *(gint*) t->next->data;
+
+      g_assert (t->next->prev == t);
+      g_assert (one / 10 <= two / 10);
+      /* equal tens keep their order in array */
+      if (one / 10 == two / 10)
+	g_assert ((gint*) t->data < (gint*) t->next->data);
+    }
+  g_assert (n == 10000);
+  g_list_free (list);
+}
+
+static void
+queue_test (void)
+{
+  GQueue *queue = g_queue_new ();
+  gint i;
+
+  g_assert (g_queue_is_empty (queue));
+  g_assert (g_queue_pop_head (queue) == NULL);
+  g_assert (g_queue_pop_tail (queue) == NULL);
+
+  for (i = 0; i < 10000; i++)
+    g_queue_push_tail (queue, &array[i]);
+  g_queue_push_head (queue, &array[0]);
+  g_assert (g_queue_get_length (queue) == 10001);
+  g_assert (g_queue_peek_tail (queue) == &array[9999]);
+  g_assert (g_queue_pop_head (queue) == &array[0]);
+  for (i = 0; i < 5000; i++)
+    g_assert (g_queue_pop_head (queue) == &array[i]);
+  g_assert (g_queue_pop_tail (queue) == &array[9999]);
+  g_assert (g_queue_get_length (queue) == 4999);
+
+  g_queue_sort (queue, my_list_compare_one);
+  g_assert (*(gint*) g_queue_peek_head (queue) <= *(gint*) queue->head->next->data);
+  g_assert (queue->tail->next == NULL);
+  g_assert (g_list_length (queue->head) == 4999);
+  while (!g_queue_is_empty (queue))
+    g_queue_pop_tail (queue);
+  g_assert (queue->head == NULL && queue->tail == NULL);
+
+  g_queue_push_head (queue, &array[1]);
+  g_queue_free (queue);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -149,6 +220,9 @@ main (int   argc,
 
   g_list_free (list);
 
+  sort_test ();
+  queue_test ();
+
   return 0;
 }
 
@@ -0,0 +1,496 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include "glib.h"
+
+static gint n_read_events = 0;
+static gint n_hup_events = 0;
+
+static gboolean
+read_watch (GIOChannel   *channel,
+	    GIOCondition  condition,
+	    gpointer      data)
+{
+  gchar buf[16];
+  guint n_read = 0;
+
+  if (condition & G_IO_IN)
+    {
+      n_read_events++;
+      g_io_channel_read (channel, buf, sizeof (buf), &n_read);
+    }
+  if (condition & G_IO_HUP)
+    n_hup_events++;
+
+  return n_read > 0;
+}
+
+static gboolean
+count_idle (gpointer data)
+{
+  gint *count = data;
+
+  return ++(*count) < 5;
+}
+
+static void
+poll_test (GMainPollBackend backend)
+{
+  GIOChannel *channel;
+  gint fds[2];
+  guint watch1, watch2;
+  gint idle_count = 0;
+
+  n_read_events = 0;
+  n_hup_events = 0;
+
+  g_assert (pipe (fds) == 0);
+  channel = g_io_channel_unix_new (fds[0]);
+
+  /* two watches on the same descriptor */
+  watch1 = g_io_add_watch (channel, G_IO_IN | G_IO_HUP, read_watch, NULL);
+  watch2 = g_io_add_watch (channel, G_IO_HUP, read_watch, NULL);
+
+  if (!g_main_set_poll_backend (backend))
+    {
+      g_source_remove (watch1);
+      g_source_remove (watch2);
+      g_io_channel_unref (channel);
+      close (fds[0]);
+      close (fds[1]);
+      return;
+    }
+  g_assert (g_main_get_poll_backend () == backend ||
+	    backend == G_MAIN_POLL_KERNEL);
+
+  while (g_main_iteration (FALSE))
+    ;
+  g_assert (n_read_events == 0);
+
+  g_assert (write (fds[1], "x", 1) == 1);
+  g_main_iteration (TRUE);
+  g_assert (n_read_events == 1);
+  g_assert (n_hup_events == 0);
+
+  g_idle_add (count_idle, &idle_count);
+  while (idle_count < 5)
+    g_main_iteration (TRUE);
+  g_assert (n_read_events == 1);
+
+  close (fds[1]);
+  while (g_main_iteration (FALSE))
+    ;
+  g_assert (n_hup_events >= 2);
+  g_assert (!g_main_pending ());
+
+  g_io_channel_unref (channel);
+  close (fds[0]);
+
+  g_assert (g_main_set_poll_backend (G_MAIN_POLL_DEFAULT));
+}
+
+#define N_TIMEOUTS 100
+
+static gint fired[N_TIMEOUTS];
+static gint n_fired = 0;
+
+static gboolean
+oneshot_timeout (gpointer data)
+{
+  fired[n_fired++] = GPOINTER_TO_INT (data);
+
+  return FALSE;
+}
+
+static gboolean
+repeat_timeout (gpointer data)
+{
+  gint *count = data;
+
+  return ++(*count) < 3;
+}
+
+static void
+timeout_test (void)
+{
+  guint ids[N_TIMEOUTS];
+  gint n_repeats = 0;
+  gint i;
+
+  n_fired = 0;
+  for (i = 0; i < N_TIMEOUTS; i++)
+    ids[i] = g_timeout_add ((N_TIMEOUTS - 1 - i) % 10 * 3, oneshot_timeout,
+			    GINT_TO_POINTER (i));
+  g_timeout_add (1, repeat_timeout, &n_repeats);
+
+  /* removed timeouts must never fire */
+  for (i = 0; i < N_TIMEOUTS; i += 10)
+    g_assert (g_source_remove (ids[i]));
+
+  while (n_fired < N_TIMEOUTS - N_TIMEOUTS / 10 || n_repeats < 3)
+    g_main_iteration (TRUE);
+
+  for (i = 0; i < n_fired; i++)
+    {
+      g_assert (fired[i] % 10 != 0);
+      if (i > 0)
+	g_assert ((N_TIMEOUTS - 1 - fired[i - 1]) % 10 <=
+		  (N_TIMEOUTS - 1 - fired[i]) % 10);
+    }
+  g_assert (n_repeats == 3);
+  g_assert (!g_main_pending ());
+}
+
+static gint n_coarse_fired = 0;
+
+static gboolean
+coarse_timeout (gpointer data)
+{
+  n_coarse_fired++;
+
+  return FALSE;
+}
+
+static void
+coarse_timeout_test (void)
+{
+  gint n_wakeups = 0;
+  gint i;
+
+  /* all of them expire on one of two 250 msec boundaries */
+  for (i = 0; i < 20; i++)
+    g_timeout_add_coarse_full (G_PRIORITY_DEFAULT, 10 + i * 10, 250,
+			       coarse_timeout, NULL, NULL);
+
+  while (n_coarse_fired < 20)
+    if (g_main_iteration (TRUE))
+      n_wakeups++;
+  g_assert (n_wakeups <= 2);
+  g_assert (!g_main_pending ());
+}
+
+static GTimeVal loop_time_fired;
+
+static gboolean
+loop_time_timeout (gpointer data)
+{
+  g_main_get_loop_time (&loop_time_fired);
+
+  return FALSE;
+}
+
+static void
+loop_time_test (void)
+{
+  GTimeVal start, now;
+  guint64 nsec;
+  glong usec;
+
+  g_get_monotonic_time (&start);
+  nsec = g_get_monotonic_nsec ();
+  g_assert (nsec / 1000000000 >= (guint64) start.tv_sec);
+
+  loop_time_fired.tv_sec = 0;
+  g_timeout_add (20, loop_time_timeout, NULL);
+  while (loop_time_fired.tv_sec == 0)
+    g_main_iteration (TRUE);
+
+  /* the loop time of the dispatch is past the expiration */
+  usec = ((loop_time_fired.tv_sec - start.tv_sec) * 1000000 +
+	  loop_time_fired.tv_usec - start.tv_usec);
+  g_assert (usec >= 20000);
+
+  g_get_monotonic_time (&now);
+  g_assert (now.tv_sec > loop_time_fired.tv_sec ||
+	    (now.tv_sec == loop_time_fired.tv_sec &&
+	     now.tv_usec >= loop_time_fired.tv_usec));
+  g_main_get_loop_time (&now);
+  g_assert (now.tv_sec == loop_time_fired.tv_sec &&
+	    now.tv_usec == loop_time_fired.tv_usec);
+}
+
+static gint dispatched[3];
+
+static gboolean
+passive_prepare (gpointer  source_data,
+		 GTimeVal *current_time,
+		 gint     *timeout,
+		 gpointer  user_data)
+{
+  g_assert_not_reached ();
+
+  return FALSE;
+}
+
+static gboolean
+passive_check (gpointer  source_data,
+	       GTimeVal *current_time,
+	       gpointer  user_data)
+{
+  g_assert_not_reached ();
+
+  return FALSE;
+}
+
+static gboolean
+passive_dispatch (gpointer  source_data,
+		  GTimeVal *dispatch_time,
+		  gpointer  user_data)
+{
+  dispatched[GPOINTER_TO_INT (source_data)]++;
+
+  return TRUE;
+}
+
+static GSourceFuncs passive_funcs =
+{
+  passive_prepare,
+  passive_check,
+  passive_dispatch,
+  NULL,
+};
+
+static void
+passive_test (void)
+{
+  guint high, low;
+
+  high = g_source_add_passive (G_PRIORITY_HIGH, FALSE, &passive_funcs,
+			       GINT_TO_POINTER (0), NULL, NULL);
+  low = g_source_add_passive (G_PRIORITY_LOW, FALSE, &passive_funcs,
+			      GINT_TO_POINTER (1), NULL, NULL);
+
+  g_assert (!g_main_pending ());
+
+  /* only the highest ready priority is dispatched per iteration */
+  g_assert (g_source_set_ready (low));
+  g_assert (g_source_set_ready (high));
+  g_assert (g_source_set_ready (high));
+  g_assert (g_main_pending ());
+  g_main_iteration (FALSE);
+  g_assert (dispatched[0] == 1 && dispatched[1] == 0);
+  g_main_iteration (FALSE);
+  g_assert (dispatched[0] == 1 && dispatched[1] == 1);
+  g_assert (!g_main_pending ());
+
+  /* removing a ready source drops it from the queue */
+  g_assert (g_source_set_ready (low));
+  g_assert (g_source_remove (low));
+  g_assert (!g_main_pending ());
+  g_assert (!g_source_set_ready (low));
+  g_assert (dispatched[1] == 1);
+
+  g_assert (g_source_remove (high));
+}
+
+static GMainContext *test_context;
+static gint n_context_idles = 0;
+static gint n_context_notifies = 0;
+
+static gboolean
+context_idle (gpointer data)
+{
+  /* callbacks run with their context as the thread default */
+  g_assert (g_main_context_get_thread_default () == test_context);
+  if (n_context_idles++ == 0)
+    g_idle_add (context_idle, NULL);
+
+  return FALSE;
+}
+
+static void
+context_notify (gpointer data)
+{
+  g_assert (g_main_context_get_thread_default () == test_context);
+  n_context_notifies++;
+}
+
+static void
+context_test (void)
+{
+  guint idle, pending;
+
+  test_context = g_main_context_new ();
+  g_assert (g_main_context_default () == g_main_context_get_thread_default ());
+
+  idle = g_main_context_add_idle (test_context, G_PRIORITY_DEFAULT,
+				  context_idle, NULL, NULL);
+  pending = g_main_context_add_timeout (test_context, G_PRIORITY_DEFAULT,
+					100000, count_idle, NULL,
+					context_notify);
+  g_assert (idle != pending);
+
+  /* sources belong to the context they were added to */
+  g_assert (!g_main_pending ());
+  g_assert (!g_source_remove (idle));
+  g_assert (g_main_context_pending (test_context));
+
+  while (g_main_context_iteration (test_context, FALSE))
+    ;
+  g_assert (n_context_idles == 2);
+  g_assert (!g_main_context_pending (test_context));
+  g_assert (!g_main_context_remove_source (test_context, idle));
+  g_assert (g_main_context_get_thread_default () == g_main_context_default ());
+
+  /* remaining sources are destroyed with their context */
+  g_main_context_destroy (test_context);
+  g_assert (n_context_notifies == 1);
+}
+
+static gint budget_order[6];
+static gint n_budget_dispatched = 0;
+
+static gboolean
+budget_idle (gpointer data)
+{
+  budget_order[n_budget_dispatched++] = GPOINTER_TO_INT (data);
+
+  return FALSE;
+}
+
+static void
+budget_test (void)
+{
+  static const gint expected[6] = { 0, 1, 100, 2, 3, 4 };
+  GMainDispatchStats stats;
+  gint i;
+
+  g_main_context_reset_dispatch_stats (g_main_context_default ());
+  g_main_set_dispatch_budget (2, 0);
+  for (i = 0; i < 5; i++)
+    g_idle_add (budget_idle, GINT_TO_POINTER (i));
+
+  g_assert (g_main_iteration (FALSE));
+  g_assert (n_budget_dispatched == 2);
+  g_assert (g_main_pending ());
+
+  /* higher priority sources go before the deferred ones */
+  g_idle_add_full (G_PRIORITY_HIGH, budget_idle, GINT_TO_POINTER (100), NULL);
+  while (g_main_iteration (FALSE))
+    ;
+  g_assert (!g_main_pending ());
+
+  g_assert (n_budget_dispatched == 6);
+  for (i = 0; i < 6; i++)
+    g_assert (budget_order[i] == expected[i]);
+
+  g_main_context_get_dispatch_stats (g_main_context_default (), &stats);
+  g_assert (stats.n_dispatches == 6);
+  g_assert (stats.n_budget_exceeded == 2);
+  g_assert (stats.n_deferred == 4);
+
+  g_main_set_dispatch_budget (0, 0);
+}
+
+static gboolean
+slow_idle (gpointer data)
+{
+  GTimeVal start, now;
+
+  g_get_current_time (&start);
+  do
+    g_get_current_time (&now);
+  while ((now.tv_sec - start.tv_sec) * 1000000 + now.tv_usec - start.tv_usec < 2000);
+
+  return FALSE;
+}
+
+static void
+profile_test (void)
+{
+  GMainSourceProfile *profile;
+  GMainLoopProfile loop_profile;
+  GSList *profiles;
+  guint slow, timeout;
+  gint n_repeats = 0;
+  gulong n;
+  gint i;
+
+  g_main_set_profiling (TRUE);
+  slow = g_idle_add (slow_idle, NULL);
+  timeout = g_timeout_add (1, repeat_timeout, &n_repeats);
+  while (n_repeats < 3 || g_main_pending ())
+    g_main_iteration (TRUE);
+  g_main_set_profiling (FALSE);
+
+  /* the slowest source comes first */
+  profiles = g_main_context_get_source_profiles (g_main_context_default ());
+  g_assert (g_slist_length (profiles) == 2);
+  profile = profiles->data;
+  g_assert (profile->tag == slow);
+  g_assert (profile->dispatch.count == 1);
+  g_assert (profile->dispatch.max_usec >= 2000);
+  g_assert (profile->prepare.count >= 1);
+  for (i = 0, n = 0; i < G_MAIN_HISTOGRAM_BUCKETS; i++)
+    n += profile->dispatch.buckets[i];
+  g_assert (n == 1);
+  for (i = 0; i < 11; i++)
+    g_assert (profile->dispatch.buckets[i] == 0);
+
+  profile = profiles->next->data;
+  g_assert (profile->tag == timeout);
+  g_assert (profile->dispatch.count == 3);
+  g_assert (profile->prepare.count == 0);
+  g_slist_foreach (profiles, (GFunc) g_free, NULL);
+  g_slist_free (profiles);
+
+  g_main_context_get_loop_profile (g_main_context_default (), &loop_profile);
+  g_assert (loop_profile.timer_lag.count == 3);
+  g_assert (loop_profile.poll.count > 0);
+
+  g_main_context_reset_profile (g_main_context_default ());
+  g_assert (g_main_context_get_source_profiles (g_main_context_default ()) == NULL);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  poll_test (G_MAIN_POLL_DEFAULT);
+  poll_test (G_MAIN_POLL_KERNEL);
+  poll_test (G_MAIN_POLL_EPOLL);
+  poll_test (G_MAIN_POLL_KQUEUE);
+  timeout_test ();
+  coarse_timeout_test ();
+  loop_time_test ();
+  passive_test ();
+  context_test ();
+  budget_test ();
+  profile_test ();
+
+  return 0;
+}
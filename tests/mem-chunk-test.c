@@ -0,0 +1,306 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include "glib.h"
+
+#define N_ATOMS 10000
+
+typedef struct {
+	gint  value;
+	gchar pad[20];
+} TestAtom;
+
+static TestAtom *atoms[N_ATOMS];
+
+static void
+chunk_test (gint type)
+{
+  GMemChunk *chunk;
+  gint i, round;
+
+  chunk = g_mem_chunk_new ("test chunk", sizeof (TestAtom),
+			   sizeof (TestAtom) * 32, type);
+
+  for (round = 0; round < 3; round++)
+    {
+      for (i = 0; i < N_ATOMS; i++)
+	{
+	  atoms[i] = g_chunk_new (TestAtom, chunk);
+	  atoms[i]->value = i;
+	  memset (atoms[i]->pad, i & 0xff, sizeof (atoms[i]->pad));
+	}
+      for (i = 0; i < N_ATOMS; i++)
+	g_assert (atoms[i]->value == i);
+
+      /* free every other atom, then refill the holes */
+      for (i = 0; i < N_ATOMS; i += 2)
+	g_chunk_free (atoms[i], chunk);
+      for (i = 0; i < N_ATOMS; i += 2)
+	{
+	  atoms[i] = g_chunk_new0 (TestAtom, chunk);
+	  g_assert (atoms[i]->value == 0);
+	  atoms[i]->value = i;
+	}
+      for (i = 0; i < N_ATOMS; i++)
+	g_assert (atoms[i]->value == i);
+
+      for (i = N_ATOMS - 1; i >= 0; i--)
+	g_chunk_free (atoms[i], chunk);
+      g_mem_chunk_clean (chunk);
+    }
+
+  /* a single atom allocated and freed over and over */
+  for (i = 0; i < N_ATOMS; i++)
+    {
+      atoms[0] = g_chunk_new (TestAtom, chunk);
+      atoms[0]->value = i;
+      g_chunk_free (atoms[0], chunk);
+    }
+
+  atoms[0] = g_chunk_new (TestAtom, chunk);
+  g_mem_chunk_reset (chunk);
+  atoms[0] = g_chunk_new (TestAtom, chunk);
+  atoms[0]->value = 1;
+  g_mem_chunk_destroy (chunk);
+}
+
+static gint slab_n_areas = -1;
+
+static void
+slab_log_handler (const gchar   *log_domain,
+		  GLogLevelFlags log_level,
+		  const gchar   *message,
+		  gpointer       user_data)
+{
+  const gchar *using = strstr (message, " using ");
+
+  if (strncmp (message, "slab chunk: ", 12) == 0 && using)
+    sscanf (using, " using %d mem areas", &slab_n_areas);
+}
+
+/* the number of areas g_mem_chunk_print() reports */
+static gint
+slab_areas (GMemChunk *chunk)
+{
+  guint handler;
+
+  slab_n_areas = -1;
+  handler = g_log_set_handler ("GLib", G_LOG_LEVEL_INFO,
+			       slab_log_handler, NULL);
+  g_mem_chunk_print (chunk);
+  g_log_remove_handler ("GLib", handler);
+
+  return slab_n_areas;
+}
+
+/* empty slab areas are given back but for a single spare one, which
+ * the next allocation reuses, until the chunk gets cleaned
+ */
+static void
+slab_release_test (void)
+{
+  GMemChunk *chunk;
+  gpointer atom;
+  gint i, round;
+
+  chunk = g_mem_chunk_new ("slab chunk", sizeof (TestAtom),
+			   sizeof (TestAtom) * 32, G_ALLOC_AND_FREE_SLAB);
+
+  for (round = 0; round < 3; round++)
+    {
+      for (i = 0; i < N_ATOMS; i++)
+	atoms[i] = g_chunk_new (TestAtom, chunk);
+      g_assert (slab_areas (chunk) >= N_ATOMS / 64);
+
+      /* the peak isn't kept once the atoms are gone */
+      for (i = 0; i < N_ATOMS; i++)
+	g_chunk_free (atoms[i], chunk);
+      g_assert (slab_areas (chunk) == 1);
+    }
+
+  /* allocating and freeing a single atom doesn't churn areas */
+  atom = g_chunk_new (TestAtom, chunk);
+  g_chunk_free (atom, chunk);
+  for (i = 0; i < 1000; i++)
+    {
+      atoms[0] = g_chunk_new (TestAtom, chunk);
+      g_assert (atoms[0] == atom);
+      g_chunk_free (atoms[0], chunk);
+    }
+  g_assert (slab_areas (chunk) == 1);
+
+  g_mem_chunk_clean (chunk);
+  g_assert (slab_areas (chunk) == 0);
+  atoms[0] = g_chunk_new (TestAtom, chunk);
+  atoms[0]->value = 1;
+  g_assert (slab_areas (chunk) == 1);
+
+  g_mem_chunk_destroy (chunk);
+}
+
+static void
+arena_test (void)
+{
+  GArena *arena;
+  GAllocator *allocator;
+  GList *list = NULL;
+  GString *string, *plain;
+  gpointer mark;
+  gchar *str, *big;
+  gint *ints[1000];
+  gint i, round;
+
+  arena = g_arena_new (256);
+
+  for (round = 0; round < 3; round++)
+    {
+      for (i = 0; i < 500; i++)
+	{
+	  ints[i] = g_arena_alloc (arena, sizeof (gint));
+	  *ints[i] = i;
+	}
+      str = g_arena_strdup (arena, "arena string");
+
+      mark = g_arena_mark (arena);
+      big = g_arena_alloc0 (arena, 10000);
+      g_assert (big[9999] == 0);
+      for (i = 500; i < 1000; i++)
+	{
+	  ints[i] = g_arena_alloc (arena, sizeof (gint));
+	  *ints[i] = -i;
+	}
+      g_arena_reset (arena, mark);
+
+      /* everything before the mark survives */
+      for (i = 0; i < 500; i++)
+	g_assert (*ints[i] == i);
+      g_assert (strcmp (str, "arena string") == 0);
+
+      g_arena_reset (arena, NULL);
+    }
+
+  /* lists and strings drawn from the arena */
+  allocator = g_allocator_new_for_arena ("test arena allocator", arena);
+  g_list_push_allocator (allocator);
+  for (i = 0; i < 1000; i++)
+    list = g_list_prepend (list, GINT_TO_POINTER (i));
+  g_list_pop_allocator ();
+  g_assert (g_list_length (list) == 1000);
+
+  string = g_string_new_in_arena (arena, "abc");
+  for (i = 0; i < 100; i++)
+    g_string_append (string, "defghijklm");
+  g_assert (string->len == 1003);
+  g_assert (strncmp (string->str, "abcdefghijklm", 13) == 0);
+  g_string_free (string, TRUE);
+
+  /* strings made otherwise and stolen ones are not the arena's, they
+   * survive its memory being reused
+   */
+  plain = g_string_new ("not from the arena");
+  str = plain->str;
+  g_string_free (plain, FALSE);
+  plain = g_string_sized_new_in_arena (arena, 64);
+  g_string_append (plain, "stolen from the arena");
+  big = g_string_steal (plain);
+  g_arena_reset (arena, NULL);
+  memset (g_arena_alloc (arena, 2000), 'x', 2000);
+  g_assert (strcmp (str, "not from the arena") == 0);
+  g_assert (strcmp (big, "stolen from the arena") == 0);
+  g_free (str);
+  g_free (big);
+
+  list = NULL;
+  g_arena_reset (arena, NULL);
+
+  g_allocator_free (allocator);
+  g_arena_destroy (arena);
+}
+
+static gulong sample_n_samples = 0;
+static gulong sample_live = 0;
+
+static void
+sample_log_handler (const gchar   *log_domain,
+		    GLogLevelFlags log_level,
+		    const gchar   *message,
+		    gpointer       user_data)
+{
+  const gchar *prefix = "mem-sample\tchunk\tsample-test\t";
+  gulong size_class, allocated;
+
+  if (strncmp (message, prefix, strlen (prefix)) == 0)
+    sscanf (message + strlen (prefix), "%lu\t%lu\t%lu\t%lu",
+	    &size_class, &sample_n_samples, &allocated, &sample_live);
+}
+
+static void
+sample_test (void)
+{
+  GMemChunk *chunk;
+  gpointer mem[100];
+  guint handler;
+  gint i;
+
+  chunk = g_mem_chunk_new ("sample-test", sizeof (TestAtom),
+			   16 * sizeof (TestAtom), G_ALLOC_AND_FREE);
+
+  /* sample every allocation */
+  g_mem_profile_set_sample_interval (1);
+  for (i = 0; i < 100; i++)
+    mem[i] = g_chunk_new (TestAtom, chunk);
+  for (i = 0; i < 50; i++)
+    g_chunk_free (mem[i], chunk);
+  g_mem_profile_set_sample_interval (0);
+
+  handler = g_log_set_handler ("GLib", G_LOG_LEVEL_INFO,
+			       sample_log_handler, NULL);
+  g_mem_profile ();
+  g_log_remove_handler ("GLib", handler);
+
+  g_assert (sample_n_samples == 100);
+  g_assert (sample_live == 50 * sizeof (TestAtom));
+
+  g_mem_chunk_destroy (chunk);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  chunk_test (G_ALLOC_AND_FREE);
+  chunk_test (G_ALLOC_AND_FREE_SLAB);
+  chunk_test (G_ALLOC_AND_FREE_MT);
+  slab_release_test ();
+  arena_test ();
+  sample_test ();
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ * Copyright (C) 1999 The Free Software Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <string.h>
+#include "glib.h"
+
+static guint handled = 0;
+
+static void
+count_handler (const gchar    *log_domain,
+	       GLogLevelFlags  log_level,
+	       const gchar    *message,
+	       gpointer	       user_data)
+{
+  handled++;
+}
+
+static const gchar*
+count_format (guint *count)
+{
+  (*count)++;
+  return "x";
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  GLogLevelFlags levels = G_LOG_LEVEL_DEBUG | G_LOG_LEVEL_INFO | G_LOG_LEVEL_MESSAGE;
+  guint formatted = 0;
+  guint id1, id2;
+
+  id1 = g_log_set_handler ("Test", levels, count_handler, NULL);
+  id2 = g_log_set_handler ("Other", levels, count_handler, NULL);
+
+  /* everything is enabled by default */
+  g_assert (g_log_is_enabled ("Test", G_LOG_LEVEL_DEBUG));
+  g_assert (g_log_is_enabled (NULL, G_LOG_LEVEL_DEBUG));
+  g_log ("Test", G_LOG_LEVEL_DEBUG, "%s", "debug");
+  g_assert (handled == 1);
+
+  /* disable debugging everywhere, then enable it for one domain */
+  g_assert (g_log_set_default_enabled_mask (G_LOG_LEVEL_MASK & ~G_LOG_LEVEL_DEBUG) ==
+	    G_LOG_LEVEL_MASK);
+  g_assert (!g_log_is_enabled ("Test", G_LOG_LEVEL_DEBUG));
+  g_assert (!g_log_is_enabled ("Unknown", G_LOG_LEVEL_DEBUG));
+  g_assert (g_log_is_enabled ("Test", G_LOG_LEVEL_MESSAGE));
+  g_assert (g_log_is_enabled ("Test", G_LOG_LEVEL_ERROR));
+  g_log ("Test", G_LOG_LEVEL_DEBUG, "%s", "debug");
+  g_assert (handled == 1);
+  if (g_log_is_enabled ("Test", G_LOG_LEVEL_DEBUG))
+    g_log ("Test", G_LOG_LEVEL_DEBUG, "%s", count_format (&formatted));
+  g_assert (formatted == 0);
+
+  g_log_set_enabled_mask ("Other", G_LOG_LEVEL_DEBUG);
+  g_assert (g_log_is_enabled ("Other", G_LOG_LEVEL_DEBUG));
+  g_assert (!g_log_is_enabled ("Other", G_LOG_LEVEL_MESSAGE));
+  g_assert (!g_log_is_enabled ("Test", G_LOG_LEVEL_DEBUG));
+  g_log ("Other", G_LOG_LEVEL_DEBUG, "%s", "debug");
+  g_log ("Other", G_LOG_LEVEL_MESSAGE, "%s", "message");
+  g_log ("Test", G_LOG_LEVEL_DEBUG | G_LOG_LEVEL_MESSAGE, "%s", "both");
+  g_assert (handled == 3);
+
+  /* fatal levels stay enabled */
+  g_log_set_fatal_mask ("Other", G_LOG_LEVEL_WARNING);
+  g_assert (g_log_is_enabled ("Other", G_LOG_LEVEL_WARNING));
+  g_log_set_fatal_mask ("Other", 0);
+  g_assert (!g_log_is_enabled ("Other", G_LOG_LEVEL_WARNING));
+
+  g_log_set_default_enabled_mask (G_LOG_LEVEL_MASK);
+  g_log ("Test", G_LOG_LEVEL_DEBUG, "%s", "debug");
+  g_assert (handled == 4);
+
+  g_log_remove_handler ("Test", id1);
+  g_log_remove_handler ("Other", id2);
+
+  return 0;
+}
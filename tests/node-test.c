@@ -81,6 +81,99 @@ node_build_string (GNode    *node,
   return FALSE;
 }
 
+static gboolean
+node_count_to (GNode    *node,
+	       gpointer  data)
+{
+  guint *n = data;
+
+  return --(*n) == 0;
+}
+
+static void
+node_count (GNode    *node,
+	    gpointer  data)
+{
+  guint *n = data;
+
+  (*n)++;
+}
+
+static gpointer
+node_max_depth_reduce (gpointer  result,
+		       GNode    *node,
+		       gpointer  data)
+{
+  return GUINT_TO_POINTER (MAX (GPOINTER_TO_UINT (result), g_node_depth (node)));
+}
+
+static gpointer
+node_max_depth_merge (gpointer result1,
+		      gpointer result2,
+		      gpointer data)
+{
+  return GUINT_TO_POINTER (MAX (GPOINTER_TO_UINT (result1), GPOINTER_TO_UINT (result2)));
+}
+
+static gpointer
+node_count_reduce (gpointer  result,
+		   GNode    *node,
+		   gpointer  data)
+{
+  return GUINT_TO_POINTER (GPOINTER_TO_UINT (result) + 1);
+}
+
+static gpointer
+node_sum_merge (gpointer result1,
+		gpointer result2,
+		gpointer data)
+{
+  return GUINT_TO_POINTER (GPOINTER_TO_UINT (result1) + GPOINTER_TO_UINT (result2));
+}
+
+/* compare every traversal of `node' with the one of its frozen copy */
+static void
+frozen_tree_test (GFrozenTree *tree,
+		  GNode       *node)
+{
+  GTraverseType order;
+  GTraverseFlags flags;
+  gint depth;
+  guint i;
+
+  for (order = G_IN_ORDER; order <= G_LEVEL_ORDER; order++)
+    for (flags = G_TRAVERSE_LEAFS; flags <= G_TRAVERSE_ALL; flags++)
+      for (depth = -1; depth <= 5; depth++)
+	{
+	  gchar *tstring = NULL;
+	  gchar *fstring = NULL;
+	  guint n, m;
+
+	  if (depth == 0)
+	    continue;
+	  g_node_traverse (node, order, flags, depth, node_build_string, &tstring);
+	  g_frozen_tree_traverse (tree, node, order, flags, depth, node_build_string, &fstring);
+	  TEST (fstring, (!tstring && !fstring) || strcmp (tstring, fstring) == 0);
+
+	  /* stopping early */
+	  n = m = 3;
+	  g_node_traverse (node, order, flags, depth, node_count_to, &n);
+	  g_frozen_tree_traverse (tree, node, order, flags, depth, node_count_to, &m);
+	  TEST (NULL, n == m);
+
+	  g_free (tstring);
+	  g_free (fstring);
+	}
+
+  for (flags = G_TRAVERSE_LEAFS; flags <= G_TRAVERSE_ALL; flags++)
+    TEST (NULL, g_frozen_tree_n_nodes (tree, node, flags) == g_node_n_nodes (node, flags));
+  TEST (NULL, g_frozen_tree_depth (tree, node) == g_node_depth (node));
+  TEST (NULL, g_frozen_tree_max_height (tree, node) == g_node_max_height (node));
+  TEST (NULL, g_frozen_tree_n_children (tree, node) == g_node_n_children (node));
+  for (i = 0; i <= g_node_n_children (node); i++)
+    TEST (NULL, g_frozen_tree_nth_child (tree, node, i) == g_node_nth_child (node, i));
+}
+
 static void
 g_node_test (void)
 {
@@ -90,7 +183,8 @@ g_node_test (void)
   GNode *node_F;
   GNode *node_G;
   GNode *node_J;
-  guint i;
+  GFrozenTree *tree;
+  guint i, n;
   gchar *tstring;
 
   failed = FALSE;
@@ -172,6 +266,19 @@ g_node_test (void)
   TEST (tstring, strcmp (tstring, "ABFG") == 0);
   g_free (tstring); tstring = NULL;
 
+  tree = g_frozen_tree_new (root);
+  frozen_tree_test (tree, root);
+  frozen_tree_test (tree, node_B);
+  frozen_tree_test (tree, node_G);
+  frozen_tree_test (tree, node_J);
+  g_frozen_tree_free (tree);
+
+  tree = g_frozen_tree_new (node_F);
+  frozen_tree_test (tree, node_F);
+  frozen_tree_test (tree, node_G);
+  TEST (NULL, g_frozen_tree_n_nodes (tree, node_B, G_TRAVERSE_ALL) == 0);
+  g_frozen_tree_free (tree);
+
   g_node_reverse_children (node_B);
   g_node_reverse_children (node_G);
 
@@ -195,6 +302,25 @@ g_node_test (void)
   TEST (NULL, g_node_max_height (root) > 100);
   TEST (NULL, g_node_n_nodes (root, G_TRAVERSE_ALL) == 1 + 2048);
 
+  n = 0;
+  g_node_traverse_parallel (root, G_TRAVERSE_LEAFS, 0, 0, node_count, &n);
+  TEST (NULL, n == g_node_n_nodes (root, G_TRAVERSE_LEAFS));
+  TEST (NULL, GPOINTER_TO_UINT (g_node_reduce_parallel (root, G_TRAVERSE_ALL, 0, 0, NULL,
+							node_max_depth_reduce,
+							node_max_depth_merge,
+							NULL)) == g_node_max_height (root));
+  /* without threads, `initial' needs not be an identity of the merge */
+  TEST (NULL, GPOINTER_TO_UINT (g_node_reduce_parallel (root, G_TRAVERSE_ALL, 0, 0,
+							GUINT_TO_POINTER (1000),
+							node_count_reduce,
+							node_sum_merge,
+							NULL)) == 1000 + 1 + 2048);
+
+  tree = g_frozen_tree_new (root);
+  TEST (NULL, g_frozen_tree_max_height (tree, root) == g_node_max_height (root));
+  TEST (NULL, g_frozen_tree_n_nodes (tree, root, G_TRAVERSE_LEAFS) == g_node_n_nodes (root, G_TRAVERSE_LEAFS));
+  g_frozen_tree_free (tree);
+
   g_node_destroy (root);
   
   if (failed)
@@ -55,7 +55,80 @@ typedef struct {
 	gchar name[40];
 } GlibTestInfo;
 
+static void
+sum_second_field (gpointer *tuple,
+		  gpointer  user_data)
+{
+  *(gint*) user_data += *(gint*) tuple[1];
+}
 
+static void
+composite_test (void)
+{
+  GRelation *relation;
+  GTuples *tuples;
+  gint data [64];
+  gint fields[2] = { 0, 1 };
+  GHashFunc hash_funcs[2] = { g_int_hash, g_int_hash };
+  GCompareFunc compare_funcs[2] = { g_int_equal, g_int_equal };
+  gconstpointer keys[2];
+  gint index, i, j, sum;
+
+  for (i = 0; i < 64; i += 1)
+    data[i] = i;
+
+  relation = g_relation_new (3);
+  g_relation_index (relation, 2, g_int_hash, g_int_equal);
+  index = g_relation_index_fields (relation, 2, fields, hash_funcs, compare_funcs);
+  g_assert (index == 0);
+
+  /* (i, j, i + j) for all i, j < 8, each (i, j) pair twice */
+  for (i = 0; i < 8; i += 1)
+    for (j = 0; j < 8; j += 1)
+      {
+	g_relation_insert (relation, data + i, data + j, data + i + j);
+	g_relation_insert (relation, data + i, data + j, data + 32 + i + j);
+      }
+
+  for (i = 0; i < 8; i += 1)
+    for (j = 0; j < 8; j += 1)
+      {
+	keys[0] = data + i;
+	keys[1] = data + j;
+	g_assert (g_relation_count_fields (relation, index, keys) == 2);
+      }
+
+  keys[0] = data + 3;
+  keys[1] = data + 5;
+  tuples = g_relation_select_fields (relation, index, keys);
+  g_assert (tuples->len == 2);
+  for (i = 0; i < tuples->len; i += 1)
+    {
+      g_assert (*(gint*) g_tuples_index (tuples, i, 0) == 3);
+      g_assert (*(gint*) g_tuples_index (tuples, i, 1) == 5);
+    }
+  g_tuples_destroy (tuples);
+
+  sum = 0;
+  g_relation_select_fields_foreach (relation, index, keys, sum_second_field, &sum);
+  g_assert (sum == 10);
+
+  /* deleting on another field keeps the composite index in sync */
+  g_relation_delete (relation, data + 8, 2);
+  keys[0] = data + 3;
+  keys[1] = data + 5;
+  g_assert (g_relation_count_fields (relation, index, keys) == 1);
+  keys[0] = data + 1;
+  keys[1] = data + 7;
+  g_assert (g_relation_count_fields (relation, index, keys) == 1);
+  g_relation_delete (relation, data + 40, 2);
+  g_assert (g_relation_count_fields (relation, index, keys) == 0);
+  tuples = g_relation_select_fields (relation, index, keys);
+  g_assert (tuples->len == 0);
+  g_tuples_destroy (tuples);
+
+  g_relation_destroy (relation);
+}
 
 int
 main (int   argc,
@@ -129,10 +202,16 @@ main (int   argc,
 
   g_tuples_destroy (tuples);
 
+  i = 0;
+  g_relation_select_foreach (relation, data + 500, 0, sum_second_field, &i);
+  g_assert (i == 501 + 499);
+
   g_relation_destroy (relation);
 
   relation = NULL;
 
+  composite_test ();
+
   return 0;
 }
 
@@ -0,0 +1,169 @@
+/* GLIB - Library of useful routines for C programming
+ * Copyright (C) 1995-1997  Peter Mattis, Spencer Kimball and Josh MacDonald
+ * Copyright (C) 1999 The Free Software Foundation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Modified by the GLib Team and others 1997-1999.  See the AUTHORS
+ * file for a list of people on the GLib Team.  See the ChangeLog
+ * files for a list of changes.  These files are distributed with
+ * GLib at ftp://ftp.gtk.org/pub/gtk/. 
+ */
+
+
+#undef G_LOG_DOMAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "glib.h"
+
+static const gchar *input =
+  "# a comment\n"
+  "alpha = 42;\n"
+  "beta = \"some string\";\n"
+  "gamma = 3.25; /* multi\nline */ delta = 0x1f;\n"
+  "epsilon { 1 2 3 }\n";
+
+/* token, value and position of every token as a string */
+static GString*
+scan_all (GScanner *scanner)
+{
+  GString *result = g_string_new (NULL);
+  GTokenType token;
+
+  while ((token = g_scanner_get_next_token (scanner)) != G_TOKEN_EOF)
+    {
+      g_string_sprintfa (result, "%d:%u:%u:", token,
+			 g_scanner_cur_line (scanner),
+			 g_scanner_cur_position (scanner));
+      switch (token)
+	{
+	case G_TOKEN_IDENTIFIER:
+	case G_TOKEN_STRING:
+	  g_string_append (result, scanner->value.v_string);
+	  break;
+	case G_TOKEN_INT:
+	  g_string_sprintfa (result, "%lu", scanner->value.v_int);
+	  break;
+	case G_TOKEN_FLOAT:
+	  g_string_sprintfa (result, "%g", scanner->value.v_float);
+	  break;
+	default:
+	  break;
+	}
+      g_string_append_c (result, '\n');
+    }
+
+  return result;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gchar filename[] = "/tmp/scanner-testXXXXXX";
+  GScanner *scanner;
+  GString *expected, *result;
+  guint sizes[] = { 1, 2, 7, 4096 };
+  guint i;
+  gint fd;
+
+  fd = mkstemp (filename);
+  g_assert (fd >= 0);
+  g_assert (write (fd, input, strlen (input)) == (gint) strlen (input));
+
+  scanner = g_scanner_new (NULL);
+  g_scanner_input_text (scanner, input, strlen (input));
+  expected = scan_all (scanner);
+  g_assert (expected->len > 0);
+
+  /* buffered reading with different block sizes */
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    {
+      g_scanner_set_buffer_size (scanner, sizes[i]);
+      lseek (fd, 0, SEEK_SET);
+      g_scanner_input_file (scanner, fd);
+      result = scan_all (scanner);
+      g_assert (strcmp (result->str, expected->str) == 0);
+      g_string_free (result, TRUE);
+    }
+
+  /* resizing keeps what was read ahead */
+  g_scanner_set_buffer_size (scanner, 16);
+  lseek (fd, 0, SEEK_SET);
+  g_scanner_input_file (scanner, fd);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_scanner_set_buffer_size (scanner, 64);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_EQUAL_SIGN);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_INT);
+  g_assert (scanner->value.v_int == 42);
+
+  /* mapped input scans like text, from the descriptor's offset on */
+  lseek (fd, 0, SEEK_SET);
+  if (g_scanner_input_mmap (scanner, fd))
+    g_assert (lseek (fd, 0, SEEK_CUR) == (off_t) strlen (input));
+  result = scan_all (scanner);
+  g_assert (strcmp (result->str, expected->str) == 0);
+  g_string_free (result, TRUE);
+
+  lseek (fd, strlen ("# a comment\n"), SEEK_SET);
+  g_scanner_input_mmap (scanner, fd);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_assert (strcmp (scanner->value.v_string, "alpha") == 0);
+
+  g_string_free (expected, TRUE);
+  g_scanner_destroy (scanner);
+
+  /* symbols, case insensitive by default, and character sets changed
+   * after the scanner was created
+   */
+  scanner = g_scanner_new (NULL);
+  g_scanner_scope_add_symbol (scanner, 0, "Alpha", GINT_TO_POINTER (1));
+  g_scanner_scope_add_symbol (scanner, 1, "beta", GINT_TO_POINTER (2));
+  scanner->config->scope_0_fallback = TRUE;
+  g_scanner_set_scope (scanner, 1);
+  g_scanner_input_text (scanner, "ALPHA  beta:gamma", 17);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_SYMBOL);
+  g_assert (scanner->value.v_symbol == GINT_TO_POINTER (1));
+  g_assert (g_scanner_cur_position (scanner) == 5);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_SYMBOL);
+  g_assert (scanner->value.v_symbol == GINT_TO_POINTER (2));
+  g_assert (g_scanner_get_next_token (scanner) == ':');
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_assert (strcmp (scanner->value.v_identifier, "gamma") == 0);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_EOF);
+
+  scanner->config->cset_skip_characters = " :";
+  scanner->config->cset_identifier_nth = "ab";
+  g_scanner_input_text (scanner, "ab:ba:gab", 9);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_assert (strcmp (scanner->value.v_identifier, "ab") == 0);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_assert (strcmp (scanner->value.v_identifier, "ba") == 0);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_IDENTIFIER);
+  g_assert (strcmp (scanner->value.v_identifier, "gab") == 0);
+  g_assert (g_scanner_get_next_token (scanner) == G_TOKEN_EOF);
+  g_scanner_destroy (scanner);
+
+  close (fd);
+  unlink (filename);
+
+  return 0;
+}
@@ -71,6 +71,41 @@ my_list_compare_two (gconstpointer a, gconstpointer b)
   return two-one;
 }
 
+/* compares only the tens, so that sorting by it shows stability */
+static gint
+my_list_compare_tens (gconstpointer a, gconstpointer b)
+{
+  gint one = *((const gint*)a) / 10;
+  gint two = *((const gint*)b) / 10;
+  return one-two;
+}
+
+static void
+sort_test (void)
+{
+  GSList *slist = NULL, *st;
+  gint i, n;
+
+  for (i = 0; i < 10000; i++)
+    {
+      array[i] = (i * 7919) % 10000;
+      slist = g_slist_prepend (slist, &array[i]);
+    }
+  slist = g_slist_reverse (slist);
+  slist = g_slist_sort (slist, my_list_compare_tens);
+
+  for (st = slist, n = 1; st->next; st = st->next, n++)
+    {
+      gint one = *(gint*) st->data, two = *(gint*) st->next->data;
+
+      g_assert (one / 10 <= two / 10);
+      if (one / 10 == two / 10)
+	g_assert ((gint*) st->data < (gint*) st->next->data);
+    }
+  g_assert (n == 10000);
+  g_slist_free (slist);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -146,5 +181,7 @@ main (int   argc,
 
   g_slist_free(slist);
 
+  sort_test ();
+
   return 0;
 }
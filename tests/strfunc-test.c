@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include "glib.h"
 
 int array[10000];
@@ -55,12 +56,115 @@ typedef struct {
 	gchar name[40];
 } GlibTestInfo;
 
+static guint
+reference_str_hash (const gchar *p)
+{
+  guint h = *p;
+
+  if (h)
+    for (p += 1; *p != '\0'; p++)
+      h = (h << 5) - h + *p;
+
+  return h;
+}
+
+/* check the block-wise case conversion against a byte-wise one for every
+ * length and alignment, with and without non-ASCII bytes */
+static void
+case_test (void)
+{
+  const gchar *sample = "Hello, World! @[`{ AZaz \\_09 The Quick Brown FOX jumps";
+  gchar buffer[128];
+  gchar expected[128];
+  guint start, len, n, i;
+
+  for (start = 0; start < 8; start++)
+    for (len = 0; len < 64; len++)
+      {
+	for (i = 0; i < 2; i++)
+	  {
+	    guint j;
+
+	    strncpy (buffer, sample + start, len);
+	    buffer[len] = '\0';
+	    if (i && len > 3)
+	      buffer[len / 2] = (gchar) 0xc4;
+	    n = strlen (buffer);
+
+	    for (j = 0; j <= n; j++)
+	      expected[j] = tolower ((guchar) buffer[j]);
+	    g_strdown (buffer);
+	    g_assert (strcmp (buffer, expected) == 0);
+
+	    for (j = 0; j <= n; j++)
+	      expected[j] = toupper ((guchar) buffer[j]);
+	    g_strup (buffer);
+	    g_assert (strcmp (buffer, expected) == 0);
+
+	    g_assert (g_str_hash (buffer) == reference_str_hash (buffer));
+	  }
+      }
+}
+
+static void
+split_test (const gchar *string,
+	    const gchar *delimiter,
+	    gint         max_tokens,
+	    guint        n_tokens)
+{
+  GStrTokenizer tokenizer;
+  const gchar *token;
+  guint length;
+  gchar **split = g_strsplit (string, delimiter, max_tokens);
+  gchar **packed = g_strsplit_packed (string, delimiter, max_tokens);
+  guint i;
+
+  g_str_tokenizer_init (&tokenizer, string, delimiter, max_tokens);
+  for (i = 0; split[i]; i++)
+    {
+      g_assert (packed[i] != NULL);
+      g_assert (strcmp (split[i], packed[i]) == 0);
+      g_assert (g_str_tokenizer_next (&tokenizer, &token, &length));
+      g_assert (length == strlen (split[i]));
+      g_assert (strncmp (token, split[i], length) == 0);
+    }
+  g_assert (i == n_tokens);
+  g_assert (packed[i] == NULL);
+  g_assert (!g_str_tokenizer_next (&tokenizer, &token, &length));
+  g_assert (!g_str_tokenizer_next (&tokenizer, &token, &length));
+
+  g_strfreev (split);
+  g_free (packed);
+}
+
 int
 main (int   argc,
       char *argv[])
 {
   gchar *string;
 
+  case_test ();
+
+  split_test ("", ",", 0, 0);
+  split_test ("abc", ",", 0, 1);
+  split_test ("a,b,,c", ",", 0, 4);
+  split_test (",a,b,", ",", 0, 3);
+  split_test ("a::b::c", "::", 0, 3);
+  split_test ("a,b,c,d", ",", 1, 2);
+  split_test ("a,b,c,d", ",", 2, 3);
+
+  string = g_strdup ("a-b_c|d>e f<g.h");
+  g_assert (strcmp (g_strdelimit (string, NULL, ':'), "a:b:c:d:e:f:g:h") == 0);
+  g_assert (strcmp (g_strdelimit (string, "aeh", '#'), "#:b:c:d:#:f:g:#") == 0);
+  g_free (string);
+
+  string = g_strescape ("no backslashes");
+  g_assert (strcmp (string, "no backslashes") == 0);
+  g_free (string);
+  string = g_strescape ("\\a\\\\b\\");
+  g_assert (strcmp (string, "\\\\a\\\\\\\\b\\\\") == 0);
+  g_free (string);
+
   g_assert (g_strcasecmp ("FroboZZ", "frobozz") == 0);
   g_assert (g_strcasecmp ("frobozz", "frobozz") == 0);
   g_assert (g_strcasecmp ("frobozz", "FROBOZZ") == 0);
@@ -62,8 +62,8 @@ main (int   argc,
   GStringChunk *string_chunk;
 
   gchar *tmp_string = NULL, *tmp_string_2;
-  gint i;
-  GString *string1, *string2;
+  gint i, j;
+  GString *string1, *string2, *string3;
 
   string_chunk = g_string_chunk_new (1024);
 
@@ -86,6 +86,42 @@ main (int   argc,
 
   g_string_chunk_free (string_chunk);
 
+  /* interning with explicit lengths, in plain and striped chunks */
+  for (i = 0; i < 2; i++)
+    {
+      gchar buffer[32];
+      gchar **interned = g_new (gchar*, 5000);
+      gint j;
+
+      string_chunk = i ? g_string_chunk_new_concurrent (64, 4) : g_string_chunk_new (64);
+
+      for (j = 0; j < 5000; j++)
+	{
+	  g_snprintf (buffer, sizeof (buffer), "tag-%d", j);
+	  interned[j] = g_string_chunk_insert_const (string_chunk, buffer);
+	  g_assert (strcmp (interned[j], buffer) == 0);
+	}
+      for (j = 0; j < 5000; j++)
+	{
+	  g_snprintf (buffer, sizeof (buffer), "tag-%d", j);
+	  g_assert (g_string_chunk_insert_const_len (string_chunk, buffer, -1) == interned[j]);
+	}
+
+      tmp_string = g_string_chunk_insert_const_len (string_chunk, "tag-12xyz", 6);
+      g_assert (tmp_string == interned[12]);
+      tmp_string = g_string_chunk_insert_const_len (string_chunk, "a\0b", 3);
+      g_assert (memcmp (tmp_string, "a\0b", 4) == 0);
+      g_assert (g_string_chunk_insert_const_len (string_chunk, "a\0b", 3) == tmp_string);
+      g_assert (g_string_chunk_insert_const_len (string_chunk, "a", 1) != tmp_string);
+
+      tmp_string = g_string_chunk_insert_len (string_chunk, "tag-12", 6);
+      g_assert (tmp_string != interned[12] && strcmp (tmp_string, "tag-12") == 0);
+      g_assert (strcmp (g_string_chunk_insert_len (string_chunk, "abcdef", 3), "abc") == 0);
+
+      g_free (interned);
+      g_string_chunk_free (string_chunk);
+    }
+
   string1 = g_string_new ("hi pete!");
   string2 = g_string_new ("");
 
@@ -121,6 +157,72 @@ main (int   argc,
 		    10, 666, 15, 15, 666.666666666, 666.666666666);
 #endif
 
+  /* appending the string to itself, short enough for the stack and
+   * long enough to need a buffer of its own
+   */
+  g_string_assign (string2, "");
+  for (i = 0; i < 100; i++)
+    g_string_append_c (string2, 'a' + i % 26);
+  g_string_sprintfa (string2, "%s|%d", string2->str, 7);
+  g_assert (string2->len == 202);
+  g_assert (strncmp (string2->str, string2->str + 100, 100) == 0);
+  g_assert (strcmp (string2->str + 200, "|7") == 0);
+  g_string_sprintfa (string2, "%s%s", string2->str, string2->str);
+  g_assert (string2->len == 3 * 202);
+  g_assert (strncmp (string2->str, string2->str + 202, 202) == 0);
+  g_assert (strncmp (string2->str, string2->str + 404, 202) == 0);
+
+  /* appending formats on the stack, growing as needed */
+  g_string_assign (string2, "x");
+  for (i = 0; i < 1000; i++)
+    g_string_sprintfa (string2, "%d,%s;", i, i % 100 ? "" : string1->str);
+  g_assert (strlen (string2->str) == string2->len);
+  g_assert (strncmp (string2->str, "x0,hi pete!", 11) == 0);
+  g_assert (strcmp (string2->str + string2->len - 5, "999,;") == 0);
+
+  g_string_sprintf (string2, "%s", "");
+  g_assert (string2->len == 0 && string2->str[0] == 0);
+  g_string_sprintf (string2, "%c%05d", 'z', 42);
+  g_assert (strcmp (string2->str, "z00042") == 0);
+
+  /* lengths instead of strlen(), embedded NULs included */
+  string3 = g_string_new_len ("ab\0cd", 5);
+  g_assert (string3->len == 5 && memcmp (string3->str, "ab\0cd", 6) == 0);
+  g_string_append_len (string3, "efgh", 2);
+  g_assert (string3->len == 7 && memcmp (string3->str, "ab\0cdef", 8) == 0);
+  g_string_append_len (string3, "ijk", -1);
+  g_assert (string3->len == 10 && strcmp (string3->str + 3, "cdefijk") == 0);
+  g_string_free (string3, TRUE);
+
+  /* short strings live inline, growing moves them to the heap and
+   * both kinds survive g_string_free (string, FALSE) and g_string_steal()
+   */
+  for (i = 0; i < 100; i++)
+    {
+      string3 = g_string_new_len (string1->str, i);
+      g_assert (string3->len == i && strncmp (string3->str, string1->str, i) == 0);
+      g_assert (string3->str[i] == 0);
+      tmp_string = g_string_steal (string3);
+      g_assert (strlen (tmp_string) == i && strncmp (tmp_string, string1->str, i) == 0);
+      g_assert (string3->len == 0 && string3->str[0] == 0);
+      g_string_append (string3, "reused");
+      g_assert (strcmp (string3->str, "reused") == 0);
+      g_free (tmp_string);
+      g_string_free (string3, TRUE);
+
+      string3 = g_string_sized_new (i);
+      for (j = 0; j < i; j++)
+	g_string_append_c (string3, 'a' + j % 26);
+      g_assert (string3->len == i && strlen (string3->str) == i);
+      tmp_string = string3->str;
+      g_string_free (string3, FALSE);
+      g_assert (strlen (tmp_string) == i);
+      g_free (tmp_string);
+    }
+
+  g_string_free (string1, TRUE);
+  g_string_free (string2, TRUE);
+
   return 0;
 }
 
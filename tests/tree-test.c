@@ -26,8 +26,16 @@
 
 #undef G_LOG_DOMAIN
 
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #include "glib.h"
 
 int array[10000];
@@ -76,6 +84,376 @@ my_traverse (gpointer key,
   return FALSE;
 }
 
+static gint
+int_compare (gconstpointer a,
+	     gconstpointer b)
+{
+  return GPOINTER_TO_INT (a) - GPOINTER_TO_INT (b);
+}
+
+static gint
+check_order (gpointer key,
+	     gpointer value,
+	     gpointer data)
+{
+  gint *last = data;
+
+  g_assert (GPOINTER_TO_INT (key) > last[0]);
+  g_assert (key == value);
+  last[0] = GPOINTER_TO_INT (key);
+  last[1]++;
+
+  return FALSE;
+}
+
+static gint
+count_all (gpointer key,
+	   gpointer value,
+	   gpointer data)
+{
+  (*(gint*) data)++;
+
+  return FALSE;
+}
+
+static gint
+stop_after_three (gpointer key,
+		  gpointer value,
+		  gpointer data)
+{
+  return ++(*(gint*) data) == 3;
+}
+
+/* random inserts and removes checked against a flag array */
+static void
+large_tree_test (void)
+{
+  GTree *tree = g_tree_new (int_compare);
+  gboolean present[1001];
+  gint i, n = 0, last[2];
+
+  memset (present, 0, sizeof (present));
+  srand (42);
+  for (i = 0; i < 20000; i++)
+    {
+      gint k = 1 + rand () % 1000;
+
+      if (rand () % 3)
+	{
+	  g_tree_insert (tree, GINT_TO_POINTER (k), GINT_TO_POINTER (k));
+	  n += !present[k];
+	  present[k] = TRUE;
+	}
+      else
+	{
+	  g_tree_remove (tree, GINT_TO_POINTER (k));
+	  n -= present[k];
+	  present[k] = FALSE;
+	}
+      g_assert (g_tree_nnodes (tree) == n);
+      g_assert ((g_tree_lookup (tree, GINT_TO_POINTER (k)) != NULL) == present[k]);
+    }
+
+  last[0] = 0;
+  last[1] = 0;
+  g_tree_traverse (tree, check_order, G_IN_ORDER, last);
+  g_assert (last[1] == n);
+  last[1] = 0;
+  g_tree_traverse (tree, count_all, G_PRE_ORDER, &last[1]);
+  g_assert (last[1] == n);
+  last[1] = 0;
+  g_tree_traverse (tree, count_all, G_POST_ORDER, &last[1]);
+  g_assert (last[1] == n);
+  last[1] = 0;
+  g_tree_traverse (tree, stop_after_three, G_IN_ORDER, &last[1]);
+  g_assert (last[1] == 3);
+
+  /* ranges, with bounds that are and aren't in the tree */
+  last[0] = 99;
+  last[1] = 0;
+  g_tree_traverse_range (tree, GINT_TO_POINTER (100), GINT_TO_POINTER (300),
+			 check_order, last);
+  for (i = 100, n = 0; i < 300; i++)
+    n += present[i];
+  g_assert (last[1] == n);
+  g_assert (last[0] < 300);
+  last[1] = 0;
+  g_tree_traverse_range (tree, GINT_TO_POINTER (2000), GINT_TO_POINTER (3000),
+			 count_all, &last[1]);
+  g_assert (last[1] == 0);
+
+  /* iterators, against the flag array */
+  {
+    GTreeIter iter;
+    gint k;
+
+    for (k = 0; k <= 1001; k += 7)
+      {
+	gint j;
+
+	for (j = k; j <= 1000 && (j < 1 || !present[j]); j++)
+	  ;
+	if (g_tree_lower_bound (tree, GINT_TO_POINTER (k), &iter))
+	  g_assert (GPOINTER_TO_INT (g_tree_iter_get_key (&iter)) == j);
+	else
+	  g_assert (j > 1000);
+
+	for (j = k + 1; j <= 1000 && (j < 1 || !present[j]); j++)
+	  ;
+	if (g_tree_upper_bound (tree, GINT_TO_POINTER (k), &iter))
+	  {
+	    g_assert (GPOINTER_TO_INT (g_tree_iter_get_key (&iter)) == j);
+	    g_assert (g_tree_iter_get_value (&iter) == GINT_TO_POINTER (j));
+	  }
+	else
+	  g_assert (j > 1000);
+      }
+
+    n = 0;
+    last[0] = 0;
+    if (g_tree_iter_first (tree, &iter))
+      do
+	{
+	  g_assert (GPOINTER_TO_INT (g_tree_iter_get_key (&iter)) > last[0]);
+	  last[0] = GPOINTER_TO_INT (g_tree_iter_get_key (&iter));
+	  n++;
+	}
+      while (g_tree_iter_next (&iter));
+    g_assert (n == g_tree_nnodes (tree));
+    g_assert (!g_tree_iter_next (&iter));
+
+    n = 0;
+    last[0] = 1001;
+    if (g_tree_iter_last (tree, &iter))
+      do
+	{
+	  g_assert (GPOINTER_TO_INT (g_tree_iter_get_key (&iter)) < last[0]);
+	  last[0] = GPOINTER_TO_INT (g_tree_iter_get_key (&iter));
+	  n++;
+	}
+      while (g_tree_iter_prev (&iter));
+    g_assert (n == g_tree_nnodes (tree));
+  }
+
+  for (i = 1; i <= 1000; i++)
+    g_tree_remove (tree, GINT_TO_POINTER (i));
+  g_assert (g_tree_nnodes (tree) == 0);
+  g_assert (g_tree_height (tree) == 0);
+
+  g_tree_destroy (tree);
+}
+
+static void
+sorted_tree_test (void)
+{
+  gpointer keys[3000];
+  GTree *tree;
+  GTreeIter iter;
+  gint i, n, last[2];
+
+  for (i = 0; i < 3000; i++)
+    keys[i] = GINT_TO_POINTER (i + 1);
+
+  for (n = 0; n <= 3000; n = n < 40 ? n + 1 : n * 2 + 1)
+    {
+      tree = g_tree_new_from_sorted (int_compare, keys, keys, n);
+      g_assert (g_tree_nnodes (tree) == n);
+      last[0] = 0;
+      last[1] = 0;
+      g_tree_traverse (tree, check_order, G_IN_ORDER, last);
+      g_assert (last[1] == n);
+      for (i = 0; i < n; i++)
+	g_assert (g_tree_lookup (tree, keys[i]) == keys[i]);
+
+      /* stays a valid tree when modified */
+      for (i = 0; i < n; i += 3)
+	g_tree_remove (tree, keys[i]);
+      g_tree_insert (tree, GINT_TO_POINTER (5000), GINT_TO_POINTER (5000));
+      g_assert (g_tree_nnodes (tree) == n - (n + 2) / 3 + 1);
+      last[0] = 0;
+      last[1] = 0;
+      g_tree_traverse (tree, check_order, G_IN_ORDER, last);
+      g_assert (last[1] == g_tree_nnodes (tree));
+      g_tree_destroy (tree);
+    }
+
+  /* keys out of order, with a duplicate, and no values */
+  keys[0] = GINT_TO_POINTER (3);
+  keys[1] = GINT_TO_POINTER (1);
+  keys[2] = GINT_TO_POINTER (3);
+  tree = g_tree_new_from_sorted (int_compare, keys, NULL, 3);
+  g_assert (g_tree_nnodes (tree) == 2);
+  g_assert (g_tree_iter_first (tree, &iter));
+  g_assert (g_tree_iter_get_key (&iter) == GINT_TO_POINTER (1));
+  g_assert (g_tree_iter_get_value (&iter) == NULL);
+  g_tree_destroy (tree);
+}
+
+static gint
+str_snapshot_compare (gconstpointer key,
+		      gconstpointer bytes)
+{
+  return strcmp (key, bytes);
+}
+
+static void
+snapshot_test (void)
+{
+  GMappedTree *mapped;
+  GTree *tree;
+  gchar *file_name;
+  gchar *keys[500];
+  gconstpointer value;
+  guint length;
+  gint i;
+
+  file_name = g_strdup_printf ("%s/tree-test-%d.snapshot",
+			       g_get_tmp_dir (), (gint) getpid ());
+
+  tree = g_tree_new ((GCompareFunc) strcmp);
+  for (i = 0; i < 500; i++)
+    {
+      keys[i] = g_strdup_printf ("%d", i * 7);
+      g_tree_insert (tree, keys[i], i % 2 ? keys[i] : NULL);
+    }
+  g_assert (g_tree_save (tree, file_name, NULL, NULL, NULL));
+  mapped = g_tree_map (file_name, str_snapshot_compare);
+  g_assert (mapped != NULL);
+  g_assert (g_mapped_tree_nnodes (mapped) == 500);
+  for (i = 0; i < 500; i++)
+    {
+      value = g_mapped_tree_lookup (mapped, keys[i], &length);
+      g_assert (value != NULL);
+      if (i % 2)
+	g_assert (strcmp (value, keys[i]) == 0 && length == strlen (keys[i]) + 1);
+      else
+	g_assert (length == 0);
+    }
+  g_assert (g_mapped_tree_lookup (mapped, "1", NULL) == NULL);
+  g_assert (g_mapped_tree_lookup (mapped, "", NULL) == NULL);
+  g_assert (g_mapped_tree_lookup (mapped, "zzz", NULL) == NULL);
+  g_mapped_tree_unmap (mapped);
+  g_tree_destroy (tree);
+
+  /* an empty tree */
+  tree = g_tree_new ((GCompareFunc) strcmp);
+  g_assert (g_tree_save (tree, file_name, NULL, NULL, NULL));
+  mapped = g_tree_map (file_name, str_snapshot_compare);
+  g_assert (mapped != NULL);
+  g_assert (g_mapped_tree_nnodes (mapped) == 0);
+  g_assert (g_mapped_tree_lookup (mapped, "7", NULL) == NULL);
+  g_mapped_tree_unmap (mapped);
+  g_tree_destroy (tree);
+
+  remove (file_name);
+  g_assert (g_tree_map (file_name, str_snapshot_compare) == NULL);
+  for (i = 0; i < 500; i++)
+    g_free (keys[i]);
+  g_free (file_name);
+}
+
+/* the image layout that g_tree_save() writes */
+typedef struct
+{
+  gchar	  magic[8];
+  guint32 byte_order;
+  guint32 sizeof_long;
+  gulong  length;
+  gulong  n_entries;
+  gulong  entries;
+} SnapshotHeader;
+
+typedef struct
+{
+  guint	  key_length;
+  guint	  value_length;
+  gulong  key;
+  gulong  value;
+} SnapshotEntry;
+
+/* writes length bytes of image to file_name and maps them */
+static gboolean
+snapshot_maps (const gchar *file_name,
+	       const gchar *image,
+	       gulong	    length)
+{
+  GMappedTree *mapped;
+  FILE *file;
+
+  file = fopen (file_name, "wb");
+  g_assert (file != NULL);
+  g_assert (fwrite (image, 1, length, file) == length);
+  fclose (file);
+
+  mapped = g_tree_map (file_name, str_snapshot_compare);
+  if (!mapped)
+    return FALSE;
+  g_mapped_tree_unmap (mapped);
+
+  return TRUE;
+}
+
+static void
+corrupt_snapshot_test (void)
+{
+  GMappedFile *mapped;
+  GTree *tree;
+  SnapshotHeader *header;
+  SnapshotEntry *entry;
+  gchar *file_name, *image, *copy;
+  gulong length;
+
+  file_name = g_strdup_printf ("%s/tree-test-%d.snapshot",
+			       g_get_tmp_dir (), (gint) getpid ());
+
+  tree = g_tree_new ((GCompareFunc) strcmp);
+  g_tree_insert (tree, "12345678", "a");
+  g_tree_insert (tree, "b", "bb");
+  g_tree_insert (tree, "c", NULL);
+  g_assert (g_tree_save (tree, file_name, NULL, NULL, NULL));
+  g_tree_destroy (tree);
+
+  mapped = g_mapped_file_new (file_name);
+  g_assert (mapped != NULL);
+  length = g_mapped_file_get_length (mapped);
+  image = g_memdup (g_mapped_file_get_contents (mapped), length);
+  g_mapped_file_free (mapped);
+
+  copy = g_malloc (length);
+  header = (SnapshotHeader*) copy;
+  g_assert (snapshot_maps (file_name, image, length));
+  memcpy (copy, image, length);
+  g_assert (header->n_entries == 3);
+  entry = (SnapshotEntry*) (copy + header->entries);
+
+  /* cut short, with a header that agrees */
+  header->length = length - sizeof (SnapshotEntry);
+  g_assert (!snapshot_maps (file_name, copy, header->length));
+
+  /* more entries than there is room for */
+  memcpy (copy, image, length);
+  header->n_entries = ~((gulong) 0) / sizeof (SnapshotEntry);
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  /* keys and values outside of the file */
+  memcpy (copy, image, length);
+  entry->key = length + 8;
+  g_assert (!snapshot_maps (file_name, copy, length));
+  memcpy (copy, image, length);
+  entry->value_length = ~0;
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  /* a key that runs into its value */
+  memcpy (copy, image, length);
+  copy[entry->key + entry->key_length] = 'x';
+  g_assert (!snapshot_maps (file_name, copy, length));
+
+  remove (file_name);
+  g_free (copy);
+  g_free (image);
+  g_free (file_name);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -110,6 +488,12 @@ main (int   argc,
     g_tree_remove (tree, &chars[i]);
 
   g_tree_traverse (tree, my_traverse, G_IN_ORDER, NULL);
+  g_tree_destroy (tree);
+
+  large_tree_test ();
+  sorted_tree_test ();
+  snapshot_test ();
+  corrupt_snapshot_test ();
 
   return 0;
 }